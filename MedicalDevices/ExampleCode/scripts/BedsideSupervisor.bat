@@ -45,7 +45,7 @@ set RTI_DLL_DIR=%RTI_DLL_DIR:"=%
 
 set PATH=%RTI_DLL_DIR%;%PATH%
 
-call java -classpath %dir%\..\src\BedsideSupervisor\bin;%RTI_JAR_DIR%\nddsjava.jar com.rti.medical.BedsideSupervisor
+call java -classpath %dir%\..\src\BedsideSupervisor\bin;%RTI_JAR_DIR%\nddsjava.jar com.rti.medical.BedsideSupervisor %*
 
 
 cd %dir%
\ No newline at end of file
@@ -0,0 +1,31 @@
+#!/bin/sh
+
+# Runs one of the benchmarks, for example:
+#   ./Benchmark.sh RecorderBenchmark --repeat 50
+
+filename=$0
+script_dir=`dirname $filename`
+executable_name=$1
+platform=`uname`
+bin_dir=$script_dir/../objs/$platform/Benchmarks
+
+if [ -z "$executable_name" ]
+then
+    echo "Usage: $0 <benchmark name> [benchmark options]"
+    exit 1
+fi
+shift
+
+if [ -f "$bin_dir/$executable_name" ]
+then
+    cd "$bin_dir"
+    ./$executable_name $*
+else
+    echo "***************************************************************"
+    echo $executable_name executable does not exist in:
+    echo $bin_dir
+    echo ""
+    echo Please, try to recompile the benchmarks using the command:
+    echo " $ make -f make/Makefile.<architecture> Benchmarks"
+    echo "***************************************************************"
+fi
@@ -2,6 +2,7 @@ package com.rti.medical;
 
 import java.util.ArrayList;
 import java.util.HashMap;
+import java.util.HashSet;
 import java.util.Iterator;
 import java.util.Map;
 import java.util.Map.Entry;
@@ -9,31 +10,104 @@ import java.util.Set;
 
 import com.rti.dds.infrastructure.Duration_t;
 import com.rti.dds.infrastructure.RETCODE_TIMEOUT;
-import com.rti.medical.generated.Alarm;
+import com.rti.medical.generated.AlarmKind;
 
 import ice.Numeric;
 
 public class BedsideSupervisor {
+	// Strength of the alarms of the primary and of a standby supervisor.
+	// Readers receive the alarms of the strongest supervisor that is alive.
+	private static final int PRIMARY_ALARM_STRENGTH = 20;
+	private static final int STANDBY_ALARM_STRENGTH = 10;
+
+	// Size of the checkpoint file, and the oldest checkpoint restored
+	private static final int CHECKPOINT_SIZE = 1024 * 1024;
+	private static final long MAX_CHECKPOINT_AGE_MS = 10000;
+
+	// A patient's alarm is active for this long after it was last sent, and
+	// the Numerics of the patient have priority while it is
+	private static final long ALARM_ACTIVE_MS = 10000;
+
+	// Time between two updates of the ingest health
+	private static final long HEALTH_PERIOD_MS = 1000;
+
 	private static DDSNetworkInterface _dataInterface;
 	private static NumericListener _numericListener;
+	private static SupervisorCheckpoint _checkpoint;
+	private static NumericIngestPolicy _ingestPolicy;
+
+	// Time the latest alarm of each patient was sent, in milliseconds
+	private static HashMap<Integer, Long> _alarmTimes =
+			new HashMap<Integer, Long>();
 	
     private static HashMap<Integer, ArrayList<Numeric>> _patientDeviceValues =
     		new HashMap<Integer,ArrayList<Numeric>>();
 	
 	public static void main(String[] args) {
 		boolean multicastAvailable = true;
+		int[] patientGroups = null;
+		boolean standby = false;
+		String checkpointFile = null;
+		long checkpointPeriod = 1000;
+		int maxBacklog = 1000;
+		long maxAgeMs = 500;
+		int shedDeliveries = 256;
 		
 		try {
-			// Is multicast available?
-			if (args.length != 0) {
-				if (args.length == 1 && args[0].equals("--no-multicast")) {
+			// Is multicast available?  Which patient groups are watched?
+			// Is this the standby of another supervisor?
+			for (int i = 0; i < args.length; i++) {
+				if (args[i].equals("--no-multicast")) {
 					multicastAvailable = false;
+				} else if (args[i].equals("--patient-groups") && 
+						i + 1 < args.length) {
+					patientGroups = parsePatientGroups(args[++i]);
+				} else if (args[i].equals("--standby")) {
+					standby = true;
+				} else if (args[i].equals("--checkpoint") &&
+						i + 1 < args.length) {
+					checkpointFile = args[++i];
+				} else if (args[i].equals("--checkpoint-ms") &&
+						i + 1 < args.length) {
+					checkpointPeriod = Long.parseLong(args[++i]);
+				} else if (args[i].equals("--max-backlog") &&
+						i + 1 < args.length) {
+					maxBacklog = Integer.parseInt(args[++i]);
+				} else if (args[i].equals("--max-age-ms") &&
+						i + 1 < args.length) {
+					maxAgeMs = Long.parseLong(args[++i]);
+				} else if (args[i].equals("--shed-deliveries") &&
+						i + 1 < args.length) {
+					shedDeliveries = Integer.parseInt(args[++i]);
 				} else {
 					throw 
 						new Exception("Invalid application argument.  Valid " +
 									"arguments are: \n" +
 									"\t--no-multicast:  Use QoS for a " + 
-									"network with no multicast available.");
+									"network with no multicast available.\n" +
+									"\t--patient-groups <g1,g2,...>:  Only " +
+									"receive the data of the devices of " +
+									"these patient groups.\n" +
+									"\t--standby:  Send alarms with a " +
+									"lower strength, that readers only " +
+									"receive when the primary supervisor " +
+									"is gone.\n" +
+									"\t--checkpoint <file>:  Save the " +
+									"latest values of the patients to " +
+									"this file, and restore them when " +
+									"starting.\n" +
+									"\t--checkpoint-ms <ms>:  Time " +
+									"between checkpoints.  Default: 1000\n" +
+									"\t--max-backlog <n>:  Shed load when " +
+									"more Numerics than this are waiting." +
+									"  Default: 1000\n" +
+									"\t--max-age-ms <ms>:  Shed load when " +
+									"a Numeric waited longer than this." +
+									"  Default: 500\n" +
+									"\t--shed-deliveries <n>:  Numerics " +
+									"of patients without an alarm " +
+									"processed per take while shedding." +
+									"  Default: 256");
 				}
 			}
 
@@ -45,32 +119,117 @@ public class BedsideSupervisor {
 			// alarm data.  This creates the Alarm DataReader that receives
 			// alarms over the network.
 			// ----------------------------------------------------------------
+			// The Numerics are read through an ingest policy that gives
+			// priority to the patients with an active alarm.  If the
+			// supervisor falls behind, it skips the older Numerics of a
+			// device when a newer one has arrived, so the alarms are based
+			// on the latest values.
+			_ingestPolicy = new NumericIngestPolicy();
 			_dataInterface = 
-					new DDSNetworkInterface(multicastAvailable);
+					new DDSNetworkInterface(multicastAvailable, patientGroups,
+							standby ? STANDBY_ALARM_STRENGTH :
+								PRIMARY_ALARM_STRENGTH,
+							_ingestPolicy, maxBacklog,
+							maxAgeMs * 1000000L, shedDeliveries);
+			String applicationId = standby ? "BedsideSupervisorStandby" :
+					"BedsideSupervisor";
 
 			_numericListener = new NumericListener();
 			_dataInterface.addNumericListener(_numericListener);
+
+			// ----------------------------------------------------------------
+			// A supervisor that restarts restores the latest values of its
+			// patients from its last checkpoint, and sends the alarms they
+			// call for at once, instead of waiting for the devices to send
+			// their next values.
+			// ----------------------------------------------------------------
+			if (checkpointFile != null) {
+				_checkpoint = new SupervisorCheckpoint(checkpointFile,
+						CHECKPOINT_SIZE);
+				int restored = _checkpoint.restore(_patientDeviceValues,
+						_numericListener, MAX_CHECKPOINT_AGE_MS);
+				if (restored > 0) {
+					System.out.println("Restored " + restored +
+							" values from " + checkpointFile);
+					CheckForMultipleValuesOutOfRange();
+				}
+			}
 			
+			long lastCheckpoint = System.currentTimeMillis();
+			long lastHealth = lastCheckpoint;
 			while (true) {
 				try {
 					MonitorPatient();
+
+					long now = System.currentTimeMillis();
+					if (now - lastHealth >= HEALTH_PERIOD_MS) {
+						_dataInterface.writeIngestHealth(applicationId,
+								(now - lastHealth) * 1000000L);
+						lastHealth = now;
+					}
+					if (_checkpoint != null &&
+							now - lastCheckpoint >= checkpointPeriod) {
+						_checkpoint.save(_patientDeviceValues,
+								_numericListener);
+						lastCheckpoint = now;
+					}
 				} catch (Exception e) {
 					System.out.println(e.getMessage());
 				}
 			}
 			
 		} catch (Exception e) {
+			System.out.println(e.getMessage());
 		}
 		
 	}
 
+	// Parses a comma-separated list of patient group numbers
+	private static int[] parsePatientGroups(String list) throws Exception {
+		String[] items = list.split(",");
+		int[] groups = new int[items.length];
+		for (int i = 0; i < items.length; i++) {
+			try {
+				groups[i] = Integer.parseInt(items[i].trim());
+			} catch (NumberFormatException e) {
+				throw new Exception("Invalid patient group: " + items[i]);
+			}
+		}
+		return groups;
+	}
+
 	private static void MonitorPatient() {
 
 		GetCurrentPatientValues();
 		CheckForMultipleValuesOutOfRange();
-		
+		UpdatePriorityDevices();
 		
 	}
+
+	// Gives priority to the Numerics of the devices of the patients whose
+	// alarm is active
+	private static void UpdatePriorityDevices() {
+		long now = System.currentTimeMillis();
+		HashSet<String> devices = new HashSet<String>();
+		Iterator<Entry<Integer, Long>> alarms = 
+				_alarmTimes.entrySet().iterator();
+		while (alarms.hasNext()) {
+			Map.Entry<Integer, Long> alarm = alarms.next();
+			if (now - alarm.getValue() > ALARM_ACTIVE_MS) {
+				alarms.remove();
+				continue;
+			}
+			ArrayList<Numeric> values = 
+					_patientDeviceValues.get(alarm.getKey());
+			if (values == null) {
+				continue;
+			}
+			for (int i = 0; i < values.size(); i++) {
+				devices.add(values.get(i).unique_device_identifier);
+			}
+		}
+		_ingestPolicy.setPriorityDevices(devices);
+	}
 	
 	private static void CheckForMultipleValuesOutOfRange() {
 
@@ -97,15 +256,20 @@ public class BedsideSupervisor {
 						patientKey + " due to vitals: ");
 					System.out.println(patientVitals.get(0).metric_id + ": " + patientVitals.get(0).value
 						+ " " + patientVitals.get(1).metric_id + ": " + patientVitals.get(1).value);
-					Alarm alarmData = new Alarm();
-					alarmData.patient_id = patientKey;
-
-					alarmData.device_alarm_values.setMaximum(2);
-					alarmData.device_alarm_values.add(0, patientVitals.get(0));
-					alarmData.device_alarm_values.add(1, patientVitals.get(1));
+					ArrayList<Numeric> alarmValues = new ArrayList<Numeric>();
+					ArrayList<Long> receptionTimes = new ArrayList<Long>();
+					for (int j = 0; j < 2; j++) {
+						alarmValues.add(patientVitals.get(j));
+						receptionTimes.add(_numericListener.getReceptionTime(
+								patientVitals.get(j).unique_device_identifier));
+					}
 
 					try {
-						_dataInterface.getAlarmWriter().write(alarmData);
+						_dataInterface.getAlarmWriter().write(patientKey,
+								AlarmKind.HIGH_PULSE_RATE, alarmValues,
+								receptionTimes);
+						_alarmTimes.put(patientKey,
+								System.currentTimeMillis());
 					} catch (Exception e) {
 						e.printStackTrace();
 					}
@@ -0,0 +1,156 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+
+package com.rti.medical;
+
+import java.util.HashMap;
+import java.util.List;
+import java.util.Random;
+
+import com.rti.dds.publication.DataWriterQos;
+import com.rti.medical.generated.Alarm;
+import com.rti.medical.generated.AlarmCode;
+import com.rti.medical.generated.AlarmCodeKind;
+import com.rti.medical.generated.AlarmCodeTopic;
+import com.rti.medical.generated.AlarmKind;
+import com.rti.medical.generated.AlarmTopic;
+import com.rti.medical.generated.AlarmValue;
+import com.rti.medical.generated.CompactAlarm;
+import com.rti.medical.generated.CompactAlarmTopic;
+import com.rti.medical.generated.ICE_QOS_LIBRARY;
+import com.rti.medical.generated.QOS_PROFILE_ALARM;
+import com.rti.medical.generated.QOS_PROFILE_ALARM_CODES;
+import com.rti.medical.generated.QOS_PROFILE_COMPACT_ALARM;
+
+import ice.Numeric;
+
+// A class that sends CompactAlarms, and the codes they refer to.
+//
+// The device ID and metric ID of each value are replaced by codes.  The
+// first time an ID is used, it is given the next free code, and the code is
+// sent on the AlarmCode topic before the alarm that uses it.  The codes are
+// state data, so applications that start later receive them too.
+//
+// While applications move to CompactAlarm, every alarm is also sent in full
+// on the Alarm topic, so the applications that still read Alarm, such as
+// the WardBridge, keep receiving the alarms of the supervisor.
+//
+// Alarms have exclusive ownership: when a primary and a standby supervisor
+// both send the alarms of a patient, readers only receive those of the
+// writer with the highest ownership strength that is alive.
+public class CompactAlarmWriter {
+
+	// --- Private members --- //
+	private final GenericDataWriter<CompactAlarm> _alarmWriter;
+	private final GenericDataWriter<AlarmCode> _codeWriter;
+	private final GenericDataWriter<Alarm> _fullAlarmWriter;
+
+	// Identifies the codes of this application
+	private final int _tableId;
+
+	private final HashMap<String, Integer> _deviceCodes;
+	private final HashMap<String, Integer> _metricCodes;
+
+	// --- Constructor --- //
+	public CompactAlarmWriter(DDSCommunicator communicator,
+			int ownershipStrength) throws Exception {
+		_alarmWriter = new GenericDataWriter<CompactAlarm>(
+				communicator, CompactAlarmTopic.VALUE,
+				CompactAlarm.class, ICE_QOS_LIBRARY.VALUE,
+				QOS_PROFILE_COMPACT_ALARM.VALUE);
+		setOwnershipStrength(_alarmWriter, ownershipStrength);
+
+		_codeWriter = new GenericDataWriter<AlarmCode>(
+				communicator, AlarmCodeTopic.VALUE,
+				AlarmCode.class, ICE_QOS_LIBRARY.VALUE,
+				QOS_PROFILE_ALARM_CODES.VALUE);
+
+		_fullAlarmWriter = new GenericDataWriter<Alarm>(
+				communicator, AlarmTopic.VALUE,
+				Alarm.class, ICE_QOS_LIBRARY.VALUE,
+				QOS_PROFILE_ALARM.VALUE);
+		setOwnershipStrength(_fullAlarmWriter, ownershipStrength);
+
+		_tableId = new Random().nextInt();
+		_deviceCodes = new HashMap<String, Integer>();
+		_metricCodes = new HashMap<String, Integer>();
+	}
+
+	// --- Write an alarm --- //
+
+	// Sends an alarm for the patient with the values that triggered it.
+	// receptionTimes holds the time each value was received, in nanoseconds
+	// since the epoch.
+	public void write(int patientId, AlarmKind kind, List<Numeric> values,
+			List<Long> receptionTimes) throws Exception {
+		CompactAlarm alarm = new CompactAlarm();
+		alarm.patient_id = patientId;
+		alarm.alarmKind = kind;
+		alarm.table_id = _tableId;
+
+		alarm.values.setMaximum(values.size());
+		for (int i = 0; i < values.size(); i++) {
+			Numeric numeric = values.get(i);
+			AlarmValue value = new AlarmValue();
+			value.device_code = intern(_deviceCodes,
+					AlarmCodeKind.DEVICE_CODE,
+					numeric.unique_device_identifier);
+			value.metric_code = intern(_metricCodes,
+					AlarmCodeKind.METRIC_CODE,
+					numeric.metric_id);
+			value.instance_id = numeric.instance_id;
+			value.value = numeric.value;
+			value.timestamp = receptionTimes.get(i);
+			alarm.values.add(i, value);
+		}
+
+		_alarmWriter.write(alarm);
+
+		Alarm fullAlarm = new Alarm();
+		fullAlarm.patient_id = patientId;
+		fullAlarm.alarmKind = kind;
+		fullAlarm.device_alarm_values.setMaximum(values.size());
+		for (int i = 0; i < values.size(); i++) {
+			fullAlarm.device_alarm_values.add(i, values.get(i));
+		}
+		_fullAlarmWriter.write(fullAlarm);
+	}
+
+	// --- Private methods --- //
+
+	private static void setOwnershipStrength(GenericDataWriter<?> writer,
+			int ownershipStrength) {
+		DataWriterQos qos = new DataWriterQos();
+		writer.getDataWriter().get_qos(qos);
+		qos.ownership_strength.value = ownershipStrength;
+		writer.getDataWriter().set_qos(qos);
+	}
+
+	// Returns the code of the name, sending a new code if the name has
+	// none yet
+	private int intern(HashMap<String, Integer> codes, AlarmCodeKind kind,
+			String name) throws Exception {
+		Integer code = codes.get(name);
+		if (code != null) {
+			return code;
+		}
+
+		AlarmCode alarmCode = new AlarmCode();
+		alarmCode.table_id = _tableId;
+		alarmCode.kind = kind;
+		alarmCode.code = codes.size();
+		alarmCode.name = name;
+		_codeWriter.write(alarmCode);
+
+		codes.put(name, alarmCode.code);
+		return alarmCode.code;
+	}
+}
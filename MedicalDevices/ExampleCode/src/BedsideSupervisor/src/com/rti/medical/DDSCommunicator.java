@@ -21,6 +21,7 @@ import com.rti.dds.domain.DomainParticipantFactoryQos;
 import com.rti.dds.infrastructure.StatusKind;
 import com.rti.dds.publication.Publisher;
 import com.rti.dds.subscription.Subscriber;
+import com.rti.dds.subscription.SubscriberQos;
 import com.rti.dds.topic.Topic;
 import com.rti.dds.topic.TypeSupport;
 
@@ -423,6 +424,38 @@ public class DDSCommunicator {
 
 	}
 	
+	// --------------------------------------------------------------------- //
+	/** Creates a Subscriber object with default QoS in the specified 
+	 *  partitions.  Its DataReaders only match DataWriters in one of the
+	 *  partitions.
+	 *  
+	 * @param partitions Partition names, which may contain wildcards
+	 * @return The newly-created Subscriber
+	 * @throws Exception
+	 */
+	public Subscriber createSubscriber(String[] partitions) throws Exception {
+		if (getParticipant() == null) {
+			throw new Exception(
+				"DomainParticipant NULL - communicator not properly " +
+					"initialized");
+		}
+
+		SubscriberQos qos = new SubscriberQos();
+		getParticipant().get_default_subscriber_qos(qos);
+		qos.partition.name.clear();
+		for (int i = 0; i < partitions.length; i++) {
+			qos.partition.name.add(partitions[i]);
+		}
+
+		_sub = getParticipant().create_subscriber(
+									qos, null, StatusKind.STATUS_MASK_NONE);	
+		if (_sub == null) {
+			throw new Exception("Failed to create Subscriber");
+		}
+
+		return _sub;
+	}
+	
 	// --- Getting the Subscriber --- //
 	/**
 	 * Gets the Subscriber
@@ -14,13 +14,14 @@ package com.rti.medical;
 import java.util.ArrayList;
 
 import com.rti.dds.infrastructure.Duration_t;
-import com.rti.medical.generated.Alarm;
-import com.rti.medical.generated.AlarmTopic;
 import com.rti.medical.generated.DevicePatientMapping;
 import com.rti.medical.generated.DevicePatientMappingTopic;
 import com.rti.medical.generated.ICE_QOS_LIBRARY;
-import com.rti.medical.generated.QOS_PROFILE_ALARM;
+import com.rti.medical.generated.IngestHealth;
+import com.rti.medical.generated.IngestHealthTopic;
+import com.rti.medical.generated.PatientGroupPartitionPrefix;
 import com.rti.medical.generated.QOS_PROFILE_PARTICIPANT;
+import com.rti.medical.generated.QOS_PROFILE_INGEST_HEALTH;
 import com.rti.medical.generated.QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
 import com.rti.medical.generated.QOS_PROFILE_PATIENT_DEVICES;
 import com.rti.medical.generated.QOS_PROFILE_STREAMING;
@@ -36,15 +37,20 @@ public class DDSNetworkInterface {
 	// the DDS object that discovers other DDS objects.
 	private final DDSCommunicator _communicator;
 	
-	// DataReader for Numeric data
-	private final GenericDataReader<Numeric> _numericReader;
+	// DataReader for Numeric data, that sheds load when the supervisor
+	// falls behind
+	private final OverloadControlledReader<Numeric> _numericReader;
 	
 
 	// DataReader for Patient-Device mapping data
 	private final PatientValueDataReader _patientDevicesReader;
 	
-	// DataWriter for sending Alarms
-	private final GenericDataWriter<Alarm> _alarmDataWriter;
+	// DataWriters for sending compact Alarms and their codes, and the same
+	// alarms in full
+	private final CompactAlarmWriter _alarmWriter;
+
+	// DataWriter for sending the health of the Numeric ingest
+	private final GenericDataWriter<IngestHealth> _healthWriter;
 
 	// --- Public Methods --- //
 	
@@ -52,9 +58,28 @@ public class DDSNetworkInterface {
 	// Instantiates the DDS Communicator object. Uses the DDS Communicator to 
 	// instantiate a DDS DomainParticipant, and the DataReaders for the
 	// Numeric data type that is defined in the ice.idl file.  
-	// 
+	//
+	// The Numeric data of routed devices is sent in the partition of their
+	// patient group (see DDSPatientRouting.h).  If patientGroups is null,
+	// this receives the Numeric data of every group and of the devices that
+	// are not routed.  Otherwise, it only receives the data of the devices
+	// of those groups, and the data of the other patients is not sent to
+	// this application at all.
+	//
+	// The alarms of the writer with the highest alarm strength that is alive
+	// hide those of the others, so a standby supervisor uses a lower
+	// strength than the primary.
+	//
+	// The Numerics are read through the ingest policy, and load is shed
+	// when more than maxBacklog Numerics are waiting, or when a Numeric is
+	// processed more than maxSampleAge nanoseconds after it was received
+	// (see OverloadControlledReader).  At most maxDeliveries Numerics
+	// without priority are processed per take while shedding.
 	// ------------------------------------------------------------------------
-	public DDSNetworkInterface(boolean multicastAvailable) throws Exception {
+	public DDSNetworkInterface(boolean multicastAvailable, 
+			int[] patientGroups, int alarmStrength,
+			IngestPolicy<Numeric> ingestPolicy, int maxBacklog,
+			long maxSampleAge, int maxDeliveries) throws Exception {
 		
 		_communicator = new DDSCommunicator();
 		String profileName = null;
@@ -80,11 +105,13 @@ public class DDSNetworkInterface {
 		// --- Create a Numeric Data Reader --- //
 		// This uses a topic name that has been defined as a constant in the
 		// ice.idl file.
-		_numericReader = new GenericDataReader<Numeric>(
+		_numericReader = new OverloadControlledReader<Numeric>(
 				_communicator, NumericTopic.VALUE,
 				Numeric.class,
 				ICE_QOS_LIBRARY.VALUE,
-				QOS_PROFILE_STREAMING.VALUE);
+				QOS_PROFILE_STREAMING.VALUE,
+				getNumericPartitions(patientGroups),
+				ingestPolicy, maxBacklog, maxSampleAge, maxDeliveries);
 				
 		
 		// --- Create a Patient-Device mapping Data Reader --- //
@@ -96,12 +123,42 @@ public class DDSNetworkInterface {
 				ICE_QOS_LIBRARY.VALUE,
 				QOS_PROFILE_PATIENT_DEVICES.VALUE);
 		
-		_alarmDataWriter = new GenericDataWriter<Alarm> (
-				_communicator, AlarmTopic.VALUE,
-				Alarm.class, ICE_QOS_LIBRARY.VALUE,
-				QOS_PROFILE_ALARM.VALUE);
+		// --- Create the compact Alarm Data Writers --- //
+		// Alarms refer to devices and metrics by code, and the codes are
+		// sent on their own topic.  Until every application reads
+		// CompactAlarms, the alarms are also sent in full on the Alarm
+		// topic.  The topic names have been defined as constants in the
+		// alarm.idl file.
+		_alarmWriter = new CompactAlarmWriter(_communicator, alarmStrength);
+
+		// --- Create the Ingest Health Data Writer --- //
+		// This uses a topic name that has been defined as a constant in the
+		// alarm.idl file.
+		_healthWriter = new GenericDataWriter<IngestHealth>(
+				_communicator, IngestHealthTopic.VALUE,
+				IngestHealth.class,
+				ICE_QOS_LIBRARY.VALUE,
+				QOS_PROFILE_INGEST_HEALTH.VALUE);
 	}
 	
+	// ------------------------------------------------------------------------
+	// Partitions of the Numeric data of the patient groups.  The empty name
+	// is the default partition, and the wildcard matches every group.
+	// ------------------------------------------------------------------------
+	private static String[] getNumericPartitions(int[] patientGroups) {
+		if (patientGroups == null) {
+			return new String[] { "", 
+					PatientGroupPartitionPrefix.VALUE + "*" };
+		}
+
+		String[] partitions = new String[patientGroups.length];
+		for (int i = 0; i < patientGroups.length; i++) {
+			partitions[i] = PatientGroupPartitionPrefix.VALUE + 
+					patientGroups[i];
+		}
+		return partitions;
+	}
+
 	// ------------------------------------------------------------------------
 	// Add a listener to the Numeric DataReader that receives Numeric updates
 	// ------------------------------------------------------------------------
@@ -122,12 +179,35 @@ public class DDSNetworkInterface {
 		return _patientDevicesReader;
 	}
 	
-	public GenericDataReader<Numeric> getNumericReader() {
+	public OverloadControlledReader<Numeric> getNumericReader() {
 		return _numericReader;
 	}
+
+	// ------------------------------------------------------------------------
+	// Sends the health of the Numeric ingest over the period, in
+	// nanoseconds, that ended now.  The statistics start again from zero.
+	// ------------------------------------------------------------------------
+	public void writeIngestHealth(String applicationId, long period) 
+			throws Exception {
+		IngestStatistics statistics = new IngestStatistics();
+		_numericReader.takeStatistics(statistics);
+
+		IngestHealth health = new IngestHealth();
+		health.application_id = applicationId;
+		health.topic_name = NumericTopic.VALUE;
+		health.shedding = _numericReader.isShedding();
+		health.period = period;
+		health.samples_taken = statistics.samplesTaken;
+		health.samples_delivered = statistics.samplesDelivered;
+		health.samples_shed = statistics.samplesShed;
+		health.max_backlog = statistics.maxBacklog;
+		health.max_sample_age = statistics.maxSampleAge;
+		health.pending_instances = _numericReader.getPendingCount();
+		_healthWriter.write(health);
+	}
 	
-	public GenericDataWriter<Alarm> getAlarmWriter() {
-		return _alarmDataWriter;
+	public CompactAlarmWriter getAlarmWriter() {
+		return _alarmWriter;
 	}
 
 }
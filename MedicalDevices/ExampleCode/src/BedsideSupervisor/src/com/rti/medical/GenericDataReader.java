@@ -40,9 +40,9 @@ public class GenericDataReader<T> {
 	private final DDSCommunicator _communicator;
 	protected final DataReader _reader;
 	private final WaitSet _waitSet;
-	private final Sequence _dataSeq;
-	private final SampleInfoSeq _infoSeq;
-	private final int _maxSamplesPerTake;
+	protected final Sequence _dataSeq;
+	protected final SampleInfoSeq _infoSeq;
+	protected final int _maxSamplesPerTake;
 	private StatusCondition _statusCondition;
 	private ArrayList<SampleListener<T>> _sampleListenerList;
 
@@ -62,6 +62,19 @@ public class GenericDataReader<T> {
 			Class<T> typeClass,
 			String qosLibrary,
 			String qosProfile) throws Exception {
+		this(communicator, topicName, typeClass, qosLibrary, qosProfile, 
+				null);
+	}
+
+	// Same as above, but the DataReader only receives data from DataWriters
+	// in one of the partitions, or in the default partition if partitions
+	// is null.
+	public GenericDataReader(DDSCommunicator communicator,
+			String topicName,
+			Class<T> typeClass,
+			String qosLibrary,
+			String qosProfile,
+			String[] partitions) throws Exception {
 
 		_maxSamplesPerTake = 256;
 		_communicator = communicator;
@@ -69,7 +82,12 @@ public class GenericDataReader<T> {
 		// --- Creating the Topic for this DataReader --- //
 		String typeClassName = typeClass.getName();
 		Topic topic = _communicator.createTopic(topicName, typeClass);
-		Subscriber subscriber = communicator.createSubscriber();
+		Subscriber subscriber = null;
+		if (partitions == null) {
+			subscriber = communicator.createSubscriber();
+		} else {
+			subscriber = communicator.createSubscriber(partitions);
+		}
 		 	 		 
 		_reader = subscriber.create_datareader_with_profile(topic, 
 				qosLibrary, qosProfile, null, 
@@ -120,8 +138,10 @@ public class GenericDataReader<T> {
 		
 	}
 	
+	// Takes the available data, and passes it to the listeners.  Returns
+	// false if there was none.
 	@SuppressWarnings("unchecked")
-	private boolean takeData() {
+	protected boolean takeData() {
 		
 		try {
 			_reader.take_untyped(_dataSeq, _infoSeq, 
@@ -131,9 +151,7 @@ public class GenericDataReader<T> {
 						InstanceStateKind.ANY_INSTANCE_STATE);
 			
 			for (int i = 0; i < _dataSeq.size(); i++) {
-				for (int j = 0; j < _sampleListenerList.size(); j++) {
-					_sampleListenerList.get(j).processSample((T)_dataSeq.get(i));
-				}
+				notifyListeners((T)_dataSeq.get(i));
 			}
 
 		} catch(RETCODE_NO_DATA noData) {
@@ -149,5 +167,12 @@ public class GenericDataReader<T> {
 		return true;
 		
 	}
+
+	// Passes a sample to every listener
+	protected void notifyListeners(T sample) {
+		for (int j = 0; j < _sampleListenerList.size(); j++) {
+			_sampleListenerList.get(j).processSample(sample);
+		}
+	}
 	
 }
@@ -0,0 +1,26 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+
+
+package com.rti.medical;
+
+// Tells an OverloadControlledReader how to collapse and order the samples
+// it takes while the application is behind.
+public interface IngestPolicy<T> {
+
+	// Identifies the instance of a sample.  While shedding, only the latest
+	// sample of each instance is kept.
+	public String getInstanceKey(T sample);
+
+	// True if the sample must be delivered in the take it arrived in, such
+	// as a value of a patient with an active alarm
+	public boolean isPriority(T sample);
+}
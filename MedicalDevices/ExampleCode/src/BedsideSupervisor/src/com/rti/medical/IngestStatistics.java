@@ -0,0 +1,52 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+
+
+package com.rti.medical;
+
+// Counts of an OverloadControlledReader over a period.  Times are in
+// nanoseconds.
+public class IngestStatistics {
+
+	// Samples taken from the DataReader, passed to the listeners, and
+	// skipped because a newer sample of their instance was taken
+	public int samplesTaken;
+	public int samplesDelivered;
+	public int samplesShed;
+
+	// Takes made while shedding
+	public int sheddingTakes;
+
+	// Largest number of samples waiting in the DataReader before a take
+	public int maxBacklog;
+
+	// Largest time from the reception of a sample by the middleware to its
+	// delivery to the listeners
+	public long maxSampleAge;
+
+	public void reset() {
+		samplesTaken = 0;
+		samplesDelivered = 0;
+		samplesShed = 0;
+		sheddingTakes = 0;
+		maxBacklog = 0;
+		maxSampleAge = 0;
+	}
+
+	public void copyFrom(IngestStatistics other) {
+		samplesTaken = other.samplesTaken;
+		samplesDelivered = other.samplesDelivered;
+		samplesShed = other.samplesShed;
+		sheddingTakes = other.sheddingTakes;
+		maxBacklog = other.maxBacklog;
+		maxSampleAge = other.maxSampleAge;
+	}
+}
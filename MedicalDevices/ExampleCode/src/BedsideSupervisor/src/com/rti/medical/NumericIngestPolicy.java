@@ -0,0 +1,43 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+
+
+package com.rti.medical;
+
+import java.util.HashSet;
+
+import ice.Numeric;
+
+// The ingest policy of the supervisor's Numerics.  An instance is one
+// metric of one device, and the Numerics of the devices of patients with
+// an active alarm have priority, so the alarms of those patients are
+// updated or cleared from their latest values first.
+public class NumericIngestPolicy implements IngestPolicy<Numeric> {
+
+	// --- Private members --- //
+	private HashSet<String> _priorityDevices = new HashSet<String>();
+
+	@Override
+	public String getInstanceKey(Numeric sample) {
+		return sample.unique_device_identifier + "|" + sample.metric_id +
+				"|" + sample.instance_id;
+	}
+
+	@Override
+	public boolean isPriority(Numeric sample) {
+		return _priorityDevices.contains(sample.unique_device_identifier);
+	}
+
+	// Replaces the devices whose Numerics have priority
+	public void setPriorityDevices(HashSet<String> devices) {
+		_priorityDevices = devices;
+	}
+}
@@ -8,6 +8,10 @@ public class NumericListener implements SampleListener<Numeric> {
 
 	private HashMap<String, Numeric> _mostRecentDeviceValues = new 
 			HashMap<String, Numeric>();
+
+	// Time each device value was received, in nanoseconds since the epoch
+	private HashMap<String, Long> _receptionTimes = new 
+			HashMap<String, Long>();
 	
 
 
@@ -18,11 +22,33 @@ public class NumericListener implements SampleListener<Numeric> {
 			_mostRecentDeviceValues.put(
 					sample.unique_device_identifier,
 					new Numeric(sample));
+			_receptionTimes.put(sample.unique_device_identifier,
+					System.currentTimeMillis() * 1000000L);
 		}		
 	}
 	
+	// Adds a value restored from a checkpoint, received at the given time,
+	// unless the device has already sent a newer one
+	public void restoreSample(Numeric sample, long receptionTime) {
+		if (!_mostRecentDeviceValues.containsKey(
+				sample.unique_device_identifier)) {
+			_mostRecentDeviceValues.put(sample.unique_device_identifier,
+					new Numeric(sample));
+			_receptionTimes.put(sample.unique_device_identifier,
+					receptionTime);
+		}
+	}
+
 	public HashMap<String, Numeric> getMostRecentDeviceValues() {
 		return _mostRecentDeviceValues;
 	}
 
+	public long getReceptionTime(String deviceId) {
+		Long time = _receptionTimes.get(deviceId);
+		if (time == null) {
+			return 0;
+		}
+		return time;
+	}
+
 }
@@ -0,0 +1,272 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+
+package com.rti.medical;
+
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+
+import com.rti.dds.infrastructure.Copyable;
+import com.rti.dds.infrastructure.RETCODE_NO_DATA;
+import com.rti.dds.infrastructure.Time_t;
+import com.rti.dds.subscription.DataReaderCacheStatus;
+import com.rti.dds.subscription.InstanceStateKind;
+import com.rti.dds.subscription.SampleInfo;
+import com.rti.dds.subscription.SampleStateKind;
+import com.rti.dds.subscription.ViewStateKind;
+
+// A DataReader that keeps the decisions of the application based on fresh
+// data when the application falls behind.
+//
+// Each take measures the backlog, the number of samples waiting in the
+// DataReader, and the age of each sample delivered: the time since the
+// middleware received it.  While both are within their budgets, every
+// sample is delivered to the listeners in order, as GenericDataReader does.
+//
+// Once either is over its budget, the reader sheds load.  It takes every
+// sample that is waiting, and keeps only the latest sample of each
+// instance.  The samples the policy gives priority to are delivered at
+// once.  The others are pending, and at most maxDeliveries of them are
+// delivered per take, those pending the longest first.  A pending sample
+// that is replaced by a newer sample of its instance is shed.  Intermediate
+// values are skipped, but every value delivered is the newest one received,
+// and the cost of a take stays bounded however fast the data arrives.
+//
+// Shedding stops once the backlog is within budget and no sample is
+// pending.
+public class OverloadControlledReader<T> extends GenericDataReader<T> {
+
+	// --- Private types --- //
+	private static class PendingSample<T> {
+		T sample;
+		long receptionTime;
+	}
+
+	// --- Private members --- //
+	private final Class<T> _typeClass;
+	private final IngestPolicy<T> _policy;
+	private final int _maxBacklog;
+	private final long _maxSampleAge;
+	private final int _maxDeliveries;
+
+	private final DataReaderCacheStatus _cacheStatus =
+			new DataReaderCacheStatus();
+	private final Time_t _now = new Time_t(0, 0);
+
+	// Latest sample of each instance, in the order their instances started
+	// waiting
+	private final LinkedHashMap<String, PendingSample<T>> _pending =
+			new LinkedHashMap<String, PendingSample<T>>();
+	private final LinkedHashMap<String, PendingSample<T>> _priority =
+			new LinkedHashMap<String, PendingSample<T>>();
+
+	private boolean _shedding;
+	private final IngestStatistics _statistics = new IngestStatistics();
+
+	// --- Constructor --- //
+
+	// Same as the GenericDataReader constructor, with the policy and
+	// budgets of the overload control.  maxBacklog is in samples, and
+	// maxSampleAge in nanoseconds.
+	public OverloadControlledReader(DDSCommunicator communicator,
+			String topicName,
+			Class<T> typeClass,
+			String qosLibrary,
+			String qosProfile,
+			String[] partitions,
+			IngestPolicy<T> policy,
+			int maxBacklog,
+			long maxSampleAge,
+			int maxDeliveries) throws Exception {
+		super(communicator, topicName, typeClass, qosLibrary, qosProfile,
+				partitions);
+		_typeClass = typeClass;
+		_policy = policy;
+		_maxBacklog = maxBacklog;
+		_maxSampleAge = maxSampleAge;
+		_maxDeliveries = maxDeliveries;
+	}
+
+	// --- Health --- //
+
+	public boolean isShedding() {
+		return _shedding;
+	}
+
+	public int getPendingCount() {
+		return _pending.size();
+	}
+
+	// Copies the counts since the last call, and starts counting again
+	public void takeStatistics(IngestStatistics statistics) {
+		statistics.copyFrom(_statistics);
+		_statistics.reset();
+	}
+
+	// --- Taking data --- //
+
+	// Returns true if any sample was delivered, so a caller that waits for
+	// data does not wait while samples are pending
+	@Override
+	protected boolean takeData() {
+		try {
+			long now = getCurrentTime();
+			_reader.get_datareader_cache_status(_cacheStatus);
+			int backlog = (int) _cacheStatus.sample_count;
+			if (backlog > _statistics.maxBacklog) {
+				_statistics.maxBacklog = backlog;
+			}
+			if (backlog > _maxBacklog) {
+				_shedding = true;
+			}
+
+			if (!_shedding) {
+				return takeInOrder(now);
+			}
+
+			_statistics.sheddingTakes++;
+			boolean delivered = takeAndShed(now);
+			if (_pending.isEmpty() && backlog <= _maxBacklog) {
+				_shedding = false;
+			}
+			return delivered;
+		} catch (Exception e) {
+			System.out.println("Exception: " + e.getLocalizedMessage());
+			return false;
+		}
+	}
+
+	// --- Private methods --- //
+
+	// Delivers one batch in order.  Starts shedding from the next take if a
+	// sample was older than the budget.
+	@SuppressWarnings("unchecked")
+	private boolean takeInOrder(long now) {
+		try {
+			_reader.take_untyped(_dataSeq, _infoSeq,
+					_maxSamplesPerTake,
+					SampleStateKind.ANY_SAMPLE_STATE,
+					ViewStateKind.ANY_VIEW_STATE,
+					InstanceStateKind.ANY_INSTANCE_STATE);
+
+			for (int i = 0; i < _dataSeq.size(); i++) {
+				SampleInfo info = (SampleInfo) _infoSeq.get(i);
+				if (!info.valid_data) {
+					continue;
+				}
+				_statistics.samplesTaken++;
+				long age = now - toNanoseconds(info.reception_timestamp);
+				if (age > _maxSampleAge) {
+					_shedding = true;
+				}
+				deliver((T) _dataSeq.get(i), age);
+			}
+		} catch (RETCODE_NO_DATA noData) {
+			return false;
+		} finally {
+			_reader.return_loan_untyped(_dataSeq, _infoSeq);
+		}
+		return true;
+	}
+
+	// Takes every waiting sample, keeps the latest of each instance, and
+	// delivers the priority samples and the oldest pending ones
+	private boolean takeAndShed(long now) throws Exception {
+		boolean more = true;
+		while (more) {
+			try {
+				_reader.take_untyped(_dataSeq, _infoSeq,
+						_maxSamplesPerTake,
+						SampleStateKind.ANY_SAMPLE_STATE,
+						ViewStateKind.ANY_VIEW_STATE,
+						InstanceStateKind.ANY_INSTANCE_STATE);
+				for (int i = 0; i < _dataSeq.size(); i++) {
+					SampleInfo info = (SampleInfo) _infoSeq.get(i);
+					if (info.valid_data) {
+						keepLatest(_dataSeq.get(i),
+								toNanoseconds(info.reception_timestamp));
+					}
+				}
+				more = _dataSeq.size() == _maxSamplesPerTake;
+			} catch (RETCODE_NO_DATA noData) {
+				more = false;
+			} finally {
+				_reader.return_loan_untyped(_dataSeq, _infoSeq);
+			}
+		}
+
+		int delivered = 0;
+		Iterator<PendingSample<T>> priority = _priority.values().iterator();
+		while (priority.hasNext()) {
+			PendingSample<T> pending = priority.next();
+			deliver(pending.sample, now - pending.receptionTime);
+			delivered++;
+		}
+		_priority.clear();
+
+		Iterator<PendingSample<T>> others = _pending.values().iterator();
+		for (int i = 0; i < _maxDeliveries && others.hasNext(); i++) {
+			PendingSample<T> pending = others.next();
+			deliver(pending.sample, now - pending.receptionTime);
+			others.remove();
+			delivered++;
+		}
+		return delivered > 0;
+	}
+
+	// Copies a loaned sample into the pending samples, replacing the older
+	// sample of its instance
+	@SuppressWarnings("unchecked")
+	private void keepLatest(Object loaned, long receptionTime)
+			throws Exception {
+		_statistics.samplesTaken++;
+		T sample = (T) loaned;
+		String key = _policy.getInstanceKey(sample);
+
+		PendingSample<T> pending = new PendingSample<T>();
+		pending.sample = _typeClass.newInstance();
+		((Copyable) pending.sample).copy_from(sample);
+		pending.receptionTime = receptionTime;
+
+		if (_policy.isPriority(sample)) {
+			if (_priority.put(key, pending) != null) {
+				_statistics.samplesShed++;
+			}
+			if (_pending.remove(key) != null) {
+				_statistics.samplesShed++;
+			}
+		} else if (_pending.containsKey(key)) {
+			// Replacing the value keeps the place of the instance, so an
+			// instance that is updated often is not delivered last
+			_pending.put(key, pending);
+			_statistics.samplesShed++;
+		} else {
+			_pending.put(key, pending);
+		}
+	}
+
+	private void deliver(T sample, long age) {
+		_statistics.samplesDelivered++;
+		if (age > _statistics.maxSampleAge) {
+			_statistics.maxSampleAge = age;
+		}
+		notifyListeners(sample);
+	}
+
+	private long getCurrentTime() {
+		_reader.get_subscriber().get_participant().get_current_time(_now);
+		return toNanoseconds(_now);
+	}
+
+	private static long toNanoseconds(Time_t time) {
+		return (long) time.sec * 1000000000L + time.nanosec;
+	}
+}
@@ -0,0 +1,186 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+
+package com.rti.medical;
+
+import java.io.RandomAccessFile;
+import java.nio.BufferOverflowException;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.Charset;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.Map;
+
+import ice.Numeric;
+
+// A class that saves the evaluation state of the supervisor to a
+// memory-mapped file, and restores it when the supervisor restarts.
+//
+// The state is the latest value of each device of each patient, with the
+// time it was received.  A supervisor that restores it can evaluate its
+// patients, and send the alarms that were active, as soon as it starts,
+// instead of waiting for every device to send again.
+//
+// The file is mapped once, and each checkpoint is written to the mapping
+// without a system call, so checkpoints are cheap enough to take every
+// second.  The pages of the mapping belong to the operating system, so a
+// checkpoint survives the supervisor being killed, but not the host
+// crashing.
+//
+// The generation in the header is odd while a checkpoint is written, so a
+// checkpoint that was interrupted is not restored.  Values that do not fit
+// in the file are not saved.
+public class SupervisorCheckpoint {
+
+	// --- Private constants --- //
+	private static final int MAGIC = 0x53555043;
+	private static final int VERSION = 1;
+
+	// Header: magic, version, generation, time of the checkpoint in
+	// milliseconds since the epoch, and number of values
+	private static final int GENERATION_OFFSET = 8;
+	private static final int HEADER_SIZE = 28;
+
+	private static final Charset UTF8 = Charset.forName("UTF-8");
+
+	// --- Private members --- //
+	private final MappedByteBuffer _buffer;
+	private long _generation;
+
+	// --- Constructor --- //
+
+	// Maps the first size bytes of the file, creating it if needed
+	public SupervisorCheckpoint(String fileName, int size) throws Exception {
+		if (size < HEADER_SIZE) {
+			throw new Exception("Checkpoint size too small: " + size);
+		}
+		RandomAccessFile file = new RandomAccessFile(fileName, "rw");
+		try {
+			file.setLength(size);
+			_buffer = file.getChannel().map(FileChannel.MapMode.READ_WRITE,
+					0, size);
+		} finally {
+			// The mapping stays valid after the file is closed
+			file.close();
+		}
+		_generation = _buffer.getInt(0) == MAGIC ?
+				_buffer.getLong(GENERATION_OFFSET) : 0;
+	}
+
+	// --- Save and restore --- //
+
+	// Saves the latest values of every patient.  Returns the number of
+	// values saved.
+	public int save(HashMap<Integer, ArrayList<Numeric>> patientValues,
+			NumericListener listener) {
+		_generation |= 1;
+		_buffer.putLong(GENERATION_OFFSET, _generation);
+
+		int count = 0;
+		_buffer.position(HEADER_SIZE);
+		Iterator<Map.Entry<Integer, ArrayList<Numeric>>> patients =
+				patientValues.entrySet().iterator();
+		try {
+			while (patients.hasNext()) {
+				Map.Entry<Integer, ArrayList<Numeric>> patient =
+						patients.next();
+				for (Numeric numeric : patient.getValue()) {
+					int start = _buffer.position();
+					try {
+						_buffer.putInt(patient.getKey());
+						putString(numeric.unique_device_identifier);
+						putString(numeric.metric_id);
+						_buffer.putInt(numeric.instance_id);
+						_buffer.putFloat(numeric.value);
+						_buffer.putLong(listener.getReceptionTime(
+								numeric.unique_device_identifier));
+					} catch (BufferOverflowException e) {
+						_buffer.position(start);
+						throw e;
+					}
+					count++;
+				}
+			}
+		} catch (BufferOverflowException e) {
+			// The file is full, the values saved so far are kept
+		}
+
+		_buffer.putInt(0, MAGIC);
+		_buffer.putInt(4, VERSION);
+		_buffer.putLong(16, System.currentTimeMillis());
+		_buffer.putInt(24, count);
+		_generation++;
+		_buffer.putLong(GENERATION_OFFSET, _generation);
+		return count;
+	}
+
+	// Restores the values of the last complete checkpoint, if it was taken
+	// less than maxAgeMillis ago.  Returns the number of values restored.
+	public int restore(HashMap<Integer, ArrayList<Numeric>> patientValues,
+			NumericListener listener, long maxAgeMillis) {
+		if (_buffer.getInt(0) != MAGIC || _buffer.getInt(4) != VERSION ||
+				(_buffer.getLong(GENERATION_OFFSET) & 1) != 0) {
+			return 0;
+		}
+		long age = System.currentTimeMillis() - _buffer.getLong(16);
+		if (age < 0 || age > maxAgeMillis) {
+			return 0;
+		}
+
+		// Read every value before restoring any, so a damaged file
+		// restores nothing
+		int count = _buffer.getInt(24);
+		ArrayList<Integer> patientIds = new ArrayList<Integer>();
+		ArrayList<Numeric> numerics = new ArrayList<Numeric>();
+		ArrayList<Long> receptionTimes = new ArrayList<Long>();
+		_buffer.position(HEADER_SIZE);
+		try {
+			for (int i = 0; i < count; i++) {
+				patientIds.add(_buffer.getInt());
+				Numeric numeric = new Numeric();
+				numeric.unique_device_identifier = getString();
+				numeric.metric_id = getString();
+				numeric.instance_id = _buffer.getInt();
+				numeric.value = _buffer.getFloat();
+				numerics.add(numeric);
+				receptionTimes.add(_buffer.getLong());
+			}
+		} catch (RuntimeException e) {
+			return 0;
+		}
+
+		for (int i = 0; i < numerics.size(); i++) {
+			Integer patientId = patientIds.get(i);
+			if (patientValues.get(patientId) == null) {
+				patientValues.put(patientId, new ArrayList<Numeric>());
+			}
+			patientValues.get(patientId).add(numerics.get(i));
+			listener.restoreSample(numerics.get(i), receptionTimes.get(i));
+		}
+		return numerics.size();
+	}
+
+	// --- Private methods --- //
+
+	private void putString(String value) {
+		byte[] bytes = value.getBytes(UTF8);
+		_buffer.putShort((short) bytes.length);
+		_buffer.put(bytes);
+	}
+
+	private String getString() {
+		byte[] bytes = new byte[_buffer.getShort()];
+		_buffer.get(bytes);
+		return new String(bytes, UTF8);
+	}
+}
@@ -0,0 +1,287 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../EarlyWarning/EarlyWarningEngine.h"
+#include "ReplayRecording.h"
+
+using namespace std;
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures the EarlyWarningEngine on one thread, with a
+// large number of simulated patients.  Time is simulated: every simulated
+// second, each patient gets a new heart rate, respiration rate and SpO2,
+// and a new blood pressure or temperature when one is due, then the scores
+// of every patient are computed, and the changed scores are taken.  Most
+// patients have normal vitals, and a share of them are deteriorating.  It
+// reports:
+//
+//  - The cost of storing a vital.
+//  - The cost of computing the scores of every patient, per patient, with
+//    SSE2 and with the portable scalar version, and the number of patients
+//    one core can score once a second at that cost.
+//  - The cost of taking the changed scores, and how many changed.
+//  - Correctness: both versions must compute the same score and count of
+//    recent vitals for every patient, at every simulated second.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+// Seconds between two measurements of the blood pressure and temperature
+static const int32_t SYSTOLIC_PERIOD = 900;
+static const int32_t TEMPERATURE_PERIOD = 1800;
+
+// Normal and deteriorating value, and noise, of each vital
+static const float NORMAL_VALUES[EARLY_WARNING_VITAL_COUNT] =
+	{ 75.0f, 15.0f, 97.0f, 125.0f, 37.0f };
+static const float DETERIORATING_VALUES[EARLY_WARNING_VITAL_COUNT] =
+	{ 115.0f, 23.0f, 92.0f, 98.0f, 38.6f };
+static const float NOISE[EARLY_WARNING_VITAL_COUNT] =
+	{ 8.0f, 2.0f, 1.5f, 10.0f, 0.4f };
+
+// A vital update, generated before the updates are timed
+struct VitalUpdate
+{
+	unsigned int slot;
+	EarlyWarningVital vital;
+	float value;
+};
+
+// Uniform noise in [-1, 1]
+static float Noise()
+{
+	return 2.0f * (float)rand() / (float)RAND_MAX - 1.0f;
+}
+
+// The updates of one simulated second.  The blood pressure and temperature
+// of the patients are spread over their period.
+static void GenerateUpdates(unsigned int patientCount,
+	const std::vector<bool> &deteriorating, int32_t second,
+	std::vector<VitalUpdate> &updates)
+{
+	updates.clear();
+	for (unsigned int slot = 0; slot < patientCount; slot++)
+	{
+		for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+		{
+			if ((i == EARLY_WARNING_SYSTOLIC &&
+					(second + (int32_t)slot) % SYSTOLIC_PERIOD != 0) ||
+				(i == EARLY_WARNING_TEMPERATURE &&
+					(second + (int32_t)slot) % TEMPERATURE_PERIOD != 0))
+			{
+				continue;
+			}
+			VitalUpdate update;
+			update.slot = slot;
+			update.vital = (EarlyWarningVital)i;
+			update.value = (deteriorating[slot] ? DETERIORATING_VALUES[i] :
+				NORMAL_VALUES[i]) + NOISE[i] * Noise();
+			updates.push_back(update);
+		}
+	}
+}
+
+// Counts the slots whose score or count of recent vitals differ
+static unsigned int CompareScores(const EarlyWarningEngine &engine,
+	const std::vector<int32_t> &scores,
+	const std::vector<int32_t> &vitalCounts)
+{
+	unsigned int differences = 0;
+	for (unsigned int slot = 0; slot < engine.GetPatientCount(); slot++)
+	{
+		if (engine.GetScore(slot) != scores[slot] ||
+			engine.GetVitalCount(slot) != vitalCounts[slot])
+		{
+			differences++;
+		}
+	}
+	return differences;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --patients <n>" <<
+		"                 Number of patients (default: 100000)" << endl;
+	cout << "    --seconds <n>" <<
+		"                  Simulated time (default: 60)" << endl;
+	cout << "    --deteriorating <share>" <<
+		"        Share of deteriorating patients (default: 0.05)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int patientCount = 100000;
+	long seconds = 60;
+	double deterioratingShare = 0.05;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--patients") && i + 1 < argc)
+		{
+			patientCount = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (0 == strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			seconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--deteriorating") && i + 1 < argc)
+		{
+			deterioratingShare = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (patientCount == 0 || seconds <= 0)
+	{
+		cout << "The patients and seconds must be positive" << endl;
+		return -1;
+	}
+
+	try
+	{
+		srand(42);
+		EarlyWarningEngine engine(EARLY_WARNING_DEFAULT_MAX_AGES);
+		std::vector<bool> deteriorating(patientCount);
+		for (unsigned int i = 0; i < patientCount; i++)
+		{
+			engine.GetSlot((int)i);
+			deteriorating[i] = (double)rand() / RAND_MAX < deterioratingShare;
+		}
+
+		// Every patient starts with a value of each vital
+		for (unsigned int slot = 0; slot < patientCount; slot++)
+		{
+			for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+			{
+				engine.SetVital(slot, (EarlyWarningVital)i,
+					NORMAL_VALUES[i], 0);
+			}
+		}
+
+		cout << "Scoring " << patientCount << " patients for " << seconds
+			<< " simulated seconds ("
+			<< (IsEarlyWarningVectorized() ? "SSE2" : "no SSE2") << ")"
+			<< endl;
+
+		std::vector<VitalUpdate> updates;
+		std::vector<EarlyWarningScoreChange> changes;
+		std::vector<int32_t> scores(patientCount);
+		std::vector<int32_t> vitalCounts(patientCount);
+		uint64_t updateCount = 0;
+		uint64_t changeCount = 0;
+		int64_t updateTime = 0;
+		int64_t vectorTime = 0;
+		int64_t scalarTime = 0;
+		int64_t changeTime = 0;
+		int64_t worstVector = 0;
+		unsigned int differences = 0;
+
+		for (int32_t second = 1; second <= (int32_t)seconds; second++)
+		{
+			GenerateUpdates(patientCount, deteriorating, second, updates);
+
+			int64_t start = BenchmarkClock();
+			for (size_t j = 0; j < updates.size(); j++)
+			{
+				engine.SetVital(updates[j].slot, updates[j].vital,
+					updates[j].value, second);
+			}
+			int64_t scalarStart = BenchmarkClock();
+			updateTime += scalarStart - start;
+			updateCount += updates.size();
+
+			// The scalar scores are kept to be compared with the SSE2 ones
+			engine.ComputeScoresScalar(second);
+			scalarTime += BenchmarkClock() - scalarStart;
+			for (unsigned int slot = 0; slot < patientCount; slot++)
+			{
+				scores[slot] = engine.GetScore(slot);
+				vitalCounts[slot] = engine.GetVitalCount(slot);
+			}
+
+			int64_t vectorStart = BenchmarkClock();
+			engine.ComputeScores(second);
+			int64_t changeStart = BenchmarkClock();
+			vectorTime += changeStart - vectorStart;
+			if (changeStart - vectorStart > worstVector)
+			{
+				worstVector = changeStart - vectorStart;
+			}
+
+			changes.clear();
+			engine.TakeChangedScores(changes);
+			changeTime += BenchmarkClock() - changeStart;
+			changeCount += changes.size();
+
+			differences += CompareScores(engine, scores, vitalCounts);
+		}
+
+		// Distribution of the scores at the end of the run
+		unsigned int distribution[4] = { 0, 0, 0, 0 };
+		for (unsigned int slot = 0; slot < patientCount; slot++)
+		{
+			int32_t score = engine.GetScore(slot);
+			unsigned int band = score < 0 ? 0 : score <= 4 ? 1 :
+				score <= 6 ? 2 : 3;
+			distribution[band]++;
+		}
+
+		double passes = (double)seconds;
+		double vectorCost = (double)vectorTime / passes / patientCount;
+		double scalarCost = (double)scalarTime / passes / patientCount;
+		cout << "Updates:     " << updateCount << ", "
+			<< (updateCount == 0 ? 0.0 :
+				(double)updateTime / (double)updateCount)
+			<< " ns per vital" << endl;
+		cout << "SSE2:        " << (double)vectorTime / passes / 1000.0
+			<< " us per pass (" << (double)worstVector / 1000.0
+			<< " us worst), " << vectorCost << " ns per patient, "
+			<< (vectorCost <= 0.0 ? 0.0 :
+				(double)NANOSECONDS_PER_SECOND / vectorCost / 1e6)
+			<< " M patients per core at 1 Hz" << endl;
+		cout << "Scalar:      " << (double)scalarTime / passes / 1000.0
+			<< " us per pass, " << scalarCost << " ns per patient, "
+			<< (scalarCost <= 0.0 ? 0.0 :
+				(double)NANOSECONDS_PER_SECOND / scalarCost / 1e6)
+			<< " M patients per core at 1 Hz" << endl;
+		cout << "Changes:     " << (double)changeCount / passes
+			<< " scores per second, taken in "
+			<< (double)changeTime / passes / 1000.0 << " us per pass"
+			<< endl;
+		cout << "Scores:      " << distribution[1] << " low (0-4), "
+			<< distribution[2] << " medium (5-6), " << distribution[3]
+			<< " high (7+), " << distribution[0] << " unknown" << endl;
+		cout << "Differences: " << differences
+			<< " scores between SSE2 and scalar" << endl;
+		if (differences > 0)
+		{
+			return -1;
+		}
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,426 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#ifndef RTI_WIN32
+  #include <signal.h>
+#endif
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSReactor.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../Generated/alarm.h"
+#include "../Generated/alarmSupport.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+#include "../Generated/profiles.h"
+
+using namespace std;
+using namespace com::rti::medical::generated;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures how long a patient goes without alarms when the
+// primary BedsideSupervisor is killed, and its standby takes over.
+//
+// Start a primary and a standby supervisor first:
+//   ./BedsideSupervisor.sh --checkpoint primary.ckpt
+//   ./BedsideSupervisor.sh --standby --checkpoint standby.ckpt
+//
+// The benchmark assigns two devices to a patient, and sends a pulse rate
+// from each at a fixed rate, high enough for the supervisors to send an
+// alarm for every update.  Both supervisors send these alarms, and the
+// benchmark receives those of the supervisor with the highest ownership
+// strength that is alive.  After a while, it kills the primary (or the
+// primary is killed by hand), and it reports:
+//  - The interval between alarms while the primary is alive
+//  - The largest gap between two alarms
+//  - The time from the kill to the first alarm of the standby, and the
+//    coverage gap: the time from the last alarm of the primary to it
+//  - The number of times the alarms switched from one supervisor to another
+//
+// The switch happens when the readers see that the primary lost its
+// liveliness, so the coverage gap is about the liveliness lease of the
+// Alarms profile.
+//
+// ------------------------------------------------------------------------- //
+
+static const char *PULSE_RATE_METRICS[] =
+	{ "MDC_PULS_RATE", "MDC_PULS_OXIM_PULS_RATE" };
+static const int DEVICE_COUNT = 2;
+
+struct FailoverOptions
+{
+	int seconds;
+	int rate;
+	int killAfter;
+	int primaryPid;
+	int patient;
+};
+
+// An alarm received, and the DataWriter that sent it
+struct AlarmArrival
+{
+	int64_t time;
+	DDS_InstanceHandle_t writer;
+};
+
+// ----------------------------------------------------------------------------
+// Records the time and the writer of each alarm of the patient
+class AlarmArrivalHandler : public ReactorHandler<CompactAlarm>
+{
+public:
+	AlarmArrivalHandler(int patient) : _patient(patient)
+	{
+	}
+
+	virtual void OnData(LoanedBatch<CompactAlarm> &batch)
+	{
+		int64_t now = OSGetMonotonicTime();
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			if (!batch.IsValid(i) || batch.GetData(i).patient_id != _patient)
+			{
+				continue;
+			}
+			AlarmArrival arrival;
+			arrival.time = now;
+			arrival.writer = batch.GetInfo(i).publication_handle;
+			arrivals.push_back(arrival);
+		}
+	}
+
+	std::vector<AlarmArrival> arrivals;
+
+private:
+	int _patient;
+};
+
+// ----------------------------------------------------------------------------
+// Waits for a DataWriter to match a DataReader, so the run does not start
+// before the supervisors are discovered
+static void WaitForMatch(DDS::DataWriter *writer)
+{
+	DDS_Duration_t pollPeriod = {0, 100000000};
+	for (int i = 0; i < 100; i++)
+	{
+		DDS_PublicationMatchedStatus status;
+		writer->get_publication_matched_status(status);
+		if (status.current_count > 0)
+		{
+			return;
+		}
+		NDDSUtility::sleep(pollPeriod);
+	}
+	std::stringstream errss;
+	errss << "No BedsideSupervisor was discovered";
+	throw errss.str();
+}
+
+static void SleepUntil(int64_t time)
+{
+	int64_t wait = time - OSGetMonotonicTime();
+	if (wait > 0)
+	{
+		DDS_Duration_t sleepTime = {(DDS_Long)(wait / 1000000000LL),
+			(DDS_UnsignedLong)(wait % 1000000000LL)};
+		NDDSUtility::sleep(sleepTime);
+	}
+}
+
+static bool KillPrimary(int pid)
+{
+#ifdef RTI_WIN32
+	cout << "Killing the primary is not supported on Windows, kill it "
+		<< "by hand" << endl;
+	return false;
+#else
+	if (kill(pid, SIGKILL) != 0)
+	{
+		cout << "Failed to kill process " << pid << endl;
+		return false;
+	}
+	return true;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Prints the alarm gaps, and the failover time if the kill time is known
+static void Report(const std::vector<AlarmArrival> &arrivals,
+	int64_t killTime)
+{
+	if (arrivals.size() < 2)
+	{
+		cout << arrivals.size() << " alarms received.  Are both supervisors "
+			<< "running, and assigned this patient's devices?" << endl;
+		return;
+	}
+
+	std::vector<int64_t> normalGaps;
+	int64_t largestGap = 0;
+	int switchovers = 0;
+	for (size_t i = 1; i < arrivals.size(); i++)
+	{
+		int64_t gap = arrivals[i].time - arrivals[i - 1].time;
+		if (gap > largestGap)
+		{
+			largestGap = gap;
+		}
+		if (!DDS_InstanceHandle_equals(&arrivals[i].writer,
+			&arrivals[i - 1].writer))
+		{
+			switchovers++;
+		} else if (killTime == 0 || arrivals[i].time < killTime)
+		{
+			normalGaps.push_back(gap);
+		}
+	}
+	std::sort(normalGaps.begin(), normalGaps.end());
+
+	cout << arrivals.size() << " alarms, interval p50 "
+		<< (normalGaps.empty() ? 0.0 :
+			normalGaps[normalGaps.size() / 2] / 1e6)
+		<< " ms, largest gap " << largestGap / 1e6 << " ms, "
+		<< switchovers << " switchovers" << endl;
+
+	if (killTime == 0)
+	{
+		return;
+	}
+
+	// The last alarm of the primary, and the first alarm of another
+	// writer after the kill
+	size_t last = arrivals.size();
+	for (size_t i = 0; i < arrivals.size() && arrivals[i].time < killTime;
+		i++)
+	{
+		last = i;
+	}
+	if (last == arrivals.size())
+	{
+		cout << "No alarm was received before the kill" << endl;
+		return;
+	}
+	for (size_t i = last + 1; i < arrivals.size(); i++)
+	{
+		if (!DDS_InstanceHandle_equals(&arrivals[i].writer,
+			&arrivals[last].writer))
+		{
+			cout << "Failover: first standby alarm "
+				<< (arrivals[i].time - killTime) / 1e6
+				<< " ms after the kill, coverage gap "
+				<< (arrivals[i].time - arrivals[last].time) / 1e6 << " ms"
+				<< endl;
+			return;
+		}
+	}
+	cout << "Failover: no alarm from another supervisor after the kill"
+		<< endl;
+}
+
+// ----------------------------------------------------------------------------
+// Sends the pulse rates of the patient, kills the primary, and reports the
+// alarms received
+static void Run(const FailoverOptions &options)
+{
+	DDSCommunicator communicator;
+	std::vector<std::string> xmlFiles;
+	xmlFiles.push_back("file://../../../src/Config/qos_profiles.xml");
+	if (communicator.CreateParticipant(5, xmlFiles, ICE_QOS_LIBRARY,
+		QOS_PROFILE_PARTICIPANT) == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	DDS::Publisher *pub = communicator.CreatePublisher();
+	DDS::Subscriber *sub = communicator.CreateSubscriber();
+	DDS::Topic *mappingTopic =
+		communicator.CreateTopic<DevicePatientMapping>(
+			DevicePatientMappingTopic);
+	DDS::Topic *numericTopic =
+		communicator.CreateTopic<ice::Numeric>(ice::NumericTopic);
+	DDS::Topic *alarmTopic =
+		communicator.CreateTopic<CompactAlarm>(CompactAlarmTopic);
+
+	DevicePatientMappingDataWriter *mappingWriter =
+		DevicePatientMappingDataWriter::narrow(
+			pub->create_datawriter_with_profile(mappingTopic,
+				ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES, NULL,
+				DDS_STATUS_MASK_NONE));
+	ice::NumericDataWriter *numericWriter = ice::NumericDataWriter::narrow(
+		pub->create_datawriter_with_profile(numericTopic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_STREAMING, NULL, DDS_STATUS_MASK_NONE));
+	CompactAlarmDataReader *alarmReader = CompactAlarmDataReader::narrow(
+		sub->create_datareader_with_profile(alarmTopic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_COMPACT_ALARM, NULL, DDS_STATUS_MASK_NONE));
+	if (mappingWriter == NULL || numericWriter == NULL ||
+		alarmReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create benchmark DataWriters and DataReaders";
+		throw errss.str();
+	}
+
+	WaitForMatch(numericWriter);
+
+	// Assign the devices to the patient
+	DdsAutoType<DevicePatientMapping> mapping;
+	DdsAutoType<ice::Numeric> numerics[DEVICE_COUNT];
+	for (int d = 0; d < DEVICE_COUNT; d++)
+	{
+		sprintf(mapping.device_id, "failover-device-%d", d);
+		mapping.patient_id = options.patient;
+		mappingWriter->write(mapping, DDS_HANDLE_NIL);
+
+		strcpy(numerics[d].unique_device_identifier, mapping.device_id);
+		strcpy(numerics[d].metric_id, PULSE_RATE_METRICS[d]);
+		numerics[d].instance_id = 0;
+		numerics[d].value = 120.0f;
+	}
+
+	AlarmArrivalHandler handler(options.patient);
+	DDSReactor reactor(1);
+	reactor.Register<CompactAlarm>(alarmReader, &handler, 0);
+	reactor.Start();
+
+	int64_t period = 1000000000LL / options.rate;
+	int64_t start = OSGetMonotonicTime();
+	int64_t end = start + (int64_t)options.seconds * 1000000000LL;
+	int64_t killAt = start + (int64_t)options.killAfter * 1000000000LL;
+	int64_t killTime = 0;
+	bool killed = false;
+	for (int64_t next = start; next < end; next += period)
+	{
+		SleepUntil(next);
+		if (!killed && options.primaryPid > 0 && next >= killAt)
+		{
+			killed = true;
+			if (KillPrimary(options.primaryPid))
+			{
+				killTime = OSGetMonotonicTime();
+				cout << "Killed the primary supervisor (process "
+					<< options.primaryPid << ")" << endl;
+			}
+		}
+		for (int d = 0; d < DEVICE_COUNT; d++)
+		{
+			numericWriter->write(numerics[d], DDS_HANDLE_NIL);
+		}
+	}
+
+	// Give the last alarms time to arrive
+	DDS_Duration_t drainTime = {1, 0};
+	NDDSUtility::sleep(drainTime);
+	reactor.Stop();
+
+	Report(handler.arrivals, killTime);
+}
+
+int main(int argc, char *argv[])
+{
+	FailoverOptions options;
+	options.seconds = 20;
+	options.rate = 10;
+	options.killAfter = 10;
+	options.primaryPid = 0;
+	options.patient = 9000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			options.seconds = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--rate") && i + 1 < argc)
+		{
+			options.rate = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--kill-after") && i + 1 < argc)
+		{
+			options.killAfter = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--primary-pid") && i + 1 < argc)
+		{
+			options.primaryPid = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--patient") && i + 1 < argc)
+		{
+			options.patient = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	if (options.seconds <= 0 || options.rate <= 0 ||
+		options.killAfter < 0 || options.killAfter >= options.seconds)
+	{
+		cout << "Seconds and rate must be positive, and the kill must "
+			<< "happen before the end" << endl;
+		return -1;
+	}
+
+	try
+	{
+		cout << "Patient " << options.patient << ", " << options.rate
+			<< " updates/s for " << options.seconds << " s";
+		if (options.primaryPid > 0)
+		{
+			cout << ", killing process " << options.primaryPid << " after "
+				<< options.killAfter << " s";
+		}
+		cout << endl;
+		Run(options);
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --seconds <n>" <<
+		"                  Duration of the run (default: 20)"
+		<< endl;
+	cout <<
+		"    --rate <n>" <<
+		"                     Pulse rate updates per second (default: 10)"
+		<< endl;
+	cout <<
+		"    --primary-pid <pid>" <<
+		"            Process of the primary supervisor to kill"
+		<< endl;
+	cout <<
+		"    --kill-after <n>" <<
+		"               Seconds before the kill (default: 10)"
+		<< endl;
+	cout <<
+		"    --patient <id>" <<
+		"                 Patient of the test devices (default: 9000)"
+		<< endl;
+}
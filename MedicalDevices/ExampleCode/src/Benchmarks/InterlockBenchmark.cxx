@@ -0,0 +1,583 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataReader.h"
+#include "../CommonInfrastructure/DDSGenericDataWriter.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+#include "../Generated/profiles.h"
+#include "../InfusionInterlock/DDSInfusionInterlockInterface.h"
+#include "../InfusionInterlock/InterlockEngine.h"
+
+using namespace std;
+using namespace com::rti::medical::generated;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures the latency of the closed-loop infusion
+// interlock, from the sensor to the stopped pump, and checks it against a
+// latency budget.
+//
+// One participant simulates the devices of --patients patients: a pulse
+// oximeter, and two infusion pumps that send their InfusionStatus and stop
+// as soon as they receive a stop objective.  A background thread sends the
+// normal pulse rate and SpO2 of every patient, at --load-rate numerics per
+// second in total.  The interlock runs in the same process, with its own
+// participant and its default rules.
+//
+// Each trial sends one SpO2 below the threshold for one patient, and waits
+// until both of its pumps have stopped.  The pumps are then restarted, and
+// the next trial is for the next patient.  The benchmark reports:
+//
+//  - Sensor to pump stop: from the write of the SpO2 to the reception of
+//    the objective by the pump, measured with the monotonic clock of the
+//    process.
+//  - Sensor to command, and sensor to confirmation: the times the interlock
+//    recorded for the same stop, from the source timestamp of the SpO2 to
+//    the write of the objective, and to the reception of the InfusionStatus
+//    that confirms it.
+//
+// A stop whose confirmation takes longer than --budget-ms, or that the
+// pump never confirms, is a budget violation.  The benchmark exits with an
+// error if there are any.
+//
+// The devices use device IDs that start with "interlock-bench-".
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+static const int PUMPS_PER_PATIENT = 2;
+static const float NORMAL_SPO2 = 97.0f;
+static const float LOW_SPO2 = 80.0f;
+static const float NORMAL_PULSE_RATE = 72.0f;
+
+// Patient IDs of the benchmark, so they do not collide with other patients
+// on the domain
+static const int FIRST_PATIENT_ID = 9000;
+
+struct InterlockOptions
+{
+	int patients;
+	int trials;
+	int budgetMs;
+	int loadRate;
+};
+
+// ----------------------------------------------------------------------------
+// State shared with the load, pump and interlock threads
+struct InterlockRun
+{
+	InterlockRun() :
+		stop(false),
+		patients(0),
+		loadRate(0),
+		numericWriter(NULL),
+		statusWriter(NULL),
+		objectiveReader(NULL),
+		interlock(NULL),
+		engine(NULL)
+	{
+	}
+
+	volatile bool stop;
+	int patients;
+	int loadRate;
+
+	GenericDataWriter<ice::Numeric> *numericWriter;
+	GenericDataWriter<ice::InfusionStatus> *statusWriter;
+	GenericDataReader<ice::InfusionObjective> *objectiveReader;
+
+	// Monotonic time each pump received its last stop objective, or zero,
+	// by pump index.  Set by the pump thread, and cleared by the trials.
+	OSMutex pumpMutex;
+	std::vector<int64_t> pumpStopTimes;
+
+	// Owned by the interlock thread until it is joined
+	DDSInfusionInterlockInterface *interlock;
+	InterlockEngine *engine;
+	std::vector<InterlockStop> confirmedStops;
+	std::vector<InterlockStop> lateStops;
+};
+
+static void MakeSensorId(int patient, char *deviceId)
+{
+	sprintf(deviceId, "interlock-bench-oximeter-%04d", patient);
+}
+
+static void MakePumpId(int pump, char *deviceId)
+{
+	sprintf(deviceId, "interlock-bench-pump-%04d", pump);
+}
+
+// Returns the index of a pump from its device ID, or -1
+static int ParsePumpId(const char *deviceId)
+{
+	int pump = -1;
+	if (sscanf(deviceId, "interlock-bench-pump-%d", &pump) != 1)
+	{
+		return -1;
+	}
+	return pump;
+}
+
+static void WriteNumeric(GenericDataWriter<ice::Numeric> *writer,
+	ice::Numeric &numeric, int patient, const char *metricId, float value)
+{
+	MakeSensorId(patient, numeric.unique_device_identifier);
+	strcpy(numeric.metric_id, metricId);
+	numeric.value = value;
+	writer->Write(numeric);
+}
+
+static void WriteStatus(GenericDataWriter<ice::InfusionStatus> *writer,
+	ice::InfusionStatus &status, int pump, bool infusing)
+{
+	MakePumpId(pump, status.unique_device_identifier);
+	status.infusionActive = infusing ? DDS_BOOLEAN_TRUE : DDS_BOOLEAN_FALSE;
+	writer->Write(status);
+}
+
+// ----------------------------------------------------------------------------
+// Sends the normal numerics of every patient, every 10 ms, until stopped
+static void *LoadThread(void *param)
+{
+	InterlockRun *run = (InterlockRun *)param;
+	DdsAutoType<ice::Numeric> numeric;
+	numeric.instance_id = 0;
+
+	// Numerics per 10 ms tick, two per patient
+	int perTick = run->loadRate / 100;
+	if (perTick < 1)
+	{
+		perTick = 1;
+	}
+
+	DDS_Duration_t tick = {0, 10000000};
+	int next = 0;
+	while (!run->stop)
+	{
+		for (int i = 0; i < perTick; i += 2)
+		{
+			int patient = next++ % run->patients;
+			WriteNumeric(run->numericWriter, numeric, patient,
+				"MDC_PULS_RATE", NORMAL_PULSE_RATE);
+			WriteNumeric(run->numericWriter, numeric, patient,
+				"MDC_PULS_OXIM_SAT_O2", NORMAL_SPO2);
+		}
+		NDDSUtility::sleep(tick);
+	}
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Simulates the pumps: a pump that receives a stop objective records the
+// time, and reports at once that it is no longer infusing
+static void *PumpThread(void *param)
+{
+	InterlockRun *run = (InterlockRun *)param;
+	DdsAutoType<ice::InfusionStatus> status;
+
+	DDS::WaitSet waitSet;
+	waitSet.attach_condition(run->objectiveReader->GetCondition());
+	DDS::ConditionSeq activeConditions;
+	DDS_Duration_t waitTime = {0, 100000000};
+
+	LoanedBatch<ice::InfusionObjective> batch;
+	while (!run->stop)
+	{
+		waitSet.wait(activeConditions, waitTime);
+		while (run->objectiveReader->Take(batch))
+		{
+			int64_t now = OSGetMonotonicTime();
+			for (LoanedBatch<ice::InfusionObjective>::ValidIterator it =
+				batch.begin(); it != batch.end(); ++it)
+			{
+				int pump = ParsePumpId(it->unique_device_identifier);
+				if (pump < 0 || pump >= (int)run->pumpStopTimes.size() ||
+					!it->stopInfusion)
+				{
+					continue;
+				}
+				run->pumpMutex.Lock();
+				run->pumpStopTimes[pump] = now;
+				run->pumpMutex.Unlock();
+				WriteStatus(run->statusWriter, status, pump, false);
+			}
+		}
+	}
+
+	waitSet.detach_condition(run->objectiveReader->GetCondition());
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Runs the interlock until stopped, and keeps the stops it reports
+static void *InterlockThread(void *param)
+{
+	InterlockRun *run = (InterlockRun *)param;
+	DDS_Duration_t waitTime = {0, 10000000};
+	std::vector<InterlockStop> stops;
+	try
+	{
+		while (!run->stop)
+		{
+			run->interlock->ProcessAvailableData(*run->engine, waitTime,
+				run->confirmedStops);
+			run->engine->CheckBudget(run->interlock->GetCurrentTime(),
+				run->lateStops);
+		}
+	}
+	catch (string message)
+	{
+		cout << "Interlock exception: " << message << endl;
+	}
+	return NULL;
+}
+
+static DDS::DomainParticipant *CreateParticipant(DDSCommunicator &communicator)
+{
+	std::vector<std::string> xmlFiles;
+	xmlFiles.push_back("file://../../../src/Config/qos_profiles.xml");
+	DDS::DomainParticipant *participant = communicator.CreateParticipant(5,
+		xmlFiles, ICE_QOS_LIBRARY, QOS_PROFILE_PARTICIPANT);
+	if (participant == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+	return participant;
+}
+
+// Waits until the interlock has matched a DataWriter of the devices
+static void WaitForMatch(DDS::DataWriter *writer)
+{
+	DDS_Duration_t pollPeriod = {0, 100000000};
+	for (int i = 0; i < 100; i++)
+	{
+		DDS_PublicationMatchedStatus status;
+		writer->get_publication_matched_status(status);
+		if (status.current_count > 0)
+		{
+			return;
+		}
+		NDDSUtility::sleep(pollPeriod);
+	}
+	std::stringstream errss;
+	errss << "The interlock was not discovered";
+	throw errss.str();
+}
+
+static int64_t Percentile(const std::vector<int64_t> &sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	size_t index = (size_t)(p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+static void PrintLatencies(const char *name, std::vector<int64_t> &latencies)
+{
+	std::sort(latencies.begin(), latencies.end());
+	cout << name << latencies.size() << " stops, 50% in "
+		<< Percentile(latencies, 0.5) / 1e6 << " ms, 99% in "
+		<< Percentile(latencies, 0.99) / 1e6 << " ms, max "
+		<< Percentile(latencies, 1.0) / 1e6 << " ms" << endl;
+}
+
+// ----------------------------------------------------------------------------
+// Runs the trials.  Returns the number of stops the pumps did not receive
+// within the timeout.
+static int RunTrials(InterlockRun &run, const InterlockOptions &options,
+	std::vector<int64_t> &pumpLatencies)
+{
+	DdsAutoType<ice::Numeric> numeric;
+	DdsAutoType<ice::InfusionStatus> status;
+	numeric.instance_id = 0;
+
+	// A stop is missed if it takes four budgets, and at least a second
+	int64_t timeout = 4 * (int64_t)options.budgetMs *
+		NANOSECONDS_PER_MILLISECOND;
+	if (timeout < NANOSECONDS_PER_SECOND)
+	{
+		timeout = NANOSECONDS_PER_SECOND;
+	}
+
+	// Time for the interlock to see the restarted pumps before the next
+	// trial
+	DDS_Duration_t rearmTime = {0, 50000000};
+	DDS_Duration_t pollPeriod = {0, 1000000};
+
+	int missed = 0;
+	for (int t = 0; t < options.trials; t++)
+	{
+		int patient = t % options.patients;
+		int firstPump = patient * PUMPS_PER_PATIENT;
+
+		run.pumpMutex.Lock();
+		for (int p = 0; p < PUMPS_PER_PATIENT; p++)
+		{
+			run.pumpStopTimes[firstPump + p] = 0;
+		}
+		run.pumpMutex.Unlock();
+
+		int64_t sensorTime = OSGetMonotonicTime();
+		WriteNumeric(run.numericWriter, numeric, patient,
+			"MDC_PULS_OXIM_SAT_O2", LOW_SPO2);
+
+		int stopped = 0;
+		while (stopped < PUMPS_PER_PATIENT &&
+			OSGetMonotonicTime() - sensorTime < timeout)
+		{
+			NDDSUtility::sleep(pollPeriod);
+			stopped = 0;
+			run.pumpMutex.Lock();
+			for (int p = 0; p < PUMPS_PER_PATIENT; p++)
+			{
+				if (run.pumpStopTimes[firstPump + p] != 0)
+				{
+					stopped++;
+				}
+			}
+			run.pumpMutex.Unlock();
+		}
+
+		run.pumpMutex.Lock();
+		for (int p = 0; p < PUMPS_PER_PATIENT; p++)
+		{
+			int64_t stopTime = run.pumpStopTimes[firstPump + p];
+			if (stopTime != 0)
+			{
+				pumpLatencies.push_back(stopTime - sensorTime);
+			} else
+			{
+				missed++;
+			}
+		}
+		run.pumpMutex.Unlock();
+
+		// Restart the pumps, as a clinician would once the patient is
+		// safe, and send a normal SpO2
+		for (int p = 0; p < PUMPS_PER_PATIENT; p++)
+		{
+			WriteStatus(run.statusWriter, status, firstPump + p, true);
+		}
+		WriteNumeric(run.numericWriter, numeric, patient,
+			"MDC_PULS_OXIM_SAT_O2", NORMAL_SPO2);
+		NDDSUtility::sleep(rearmTime);
+	}
+	return missed;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --patients <n>" <<
+		"                 Simulated patients (default: 20)" << endl;
+	cout << "    --trials <n>" <<
+		"                   Alarm conditions sent (default: 200)" << endl;
+	cout << "    --budget-ms <n>" <<
+		"                Sensor to pump stop latency budget" << endl <<
+		"                                   (default: 250)" << endl;
+	cout << "    --load-rate <n>" <<
+		"                Background numerics per second" << endl <<
+		"                                   (default: 2000)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	InterlockOptions options;
+	options.patients = 20;
+	options.trials = 200;
+	options.budgetMs = 250;
+	options.loadRate = 2000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--patients") && i + 1 < argc)
+		{
+			options.patients = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--trials") && i + 1 < argc)
+		{
+			options.trials = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--budget-ms") && i + 1 < argc)
+		{
+			options.budgetMs = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--load-rate") && i + 1 < argc)
+		{
+			options.loadRate = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (options.patients <= 0 || options.trials <= 0 ||
+		options.budgetMs <= 0)
+	{
+		cout << "The patients, trials and budget must be positive" << endl;
+		return -1;
+	}
+
+	int violations = 0;
+	try
+	{
+		InterlockRun run;
+		run.patients = options.patients;
+		run.loadRate = options.loadRate;
+		run.pumpStopTimes.resize(options.patients * PUMPS_PER_PATIENT, 0);
+
+		// The interlock, with its default rules
+		std::vector<InterlockRule> rules;
+		AddDefaultInterlockRules(rules);
+		InterlockEngine engine(rules,
+			(int64_t)options.budgetMs * NANOSECONDS_PER_MILLISECOND);
+		run.engine = &engine;
+		run.interlock = new DDSInfusionInterlockInterface(true);
+
+		// The devices
+		DDSCommunicator devices;
+		CreateParticipant(devices);
+		GenericDataWriter<DevicePatientMapping> mappingWriter(&devices,
+			DevicePatientMappingTopic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_PATIENT_DEVICES);
+		run.numericWriter = new GenericDataWriter<ice::Numeric>(&devices,
+			ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+		run.statusWriter = new GenericDataWriter<ice::InfusionStatus>(
+			&devices, ice::InfusionStatusTopic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_INFUSION_CONTROL);
+		run.objectiveReader = new GenericDataReader<ice::InfusionObjective>(
+			&devices, ice::InfusionObjectiveTopic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_INFUSION_CONTROL);
+
+		// Map the devices to their patients, and start every pump
+		DdsAutoType<DevicePatientMapping> mapping;
+		DdsAutoType<ice::InfusionStatus> status;
+		strcpy(status.drug_name, "morphine");
+		for (int patient = 0; patient < options.patients; patient++)
+		{
+			mapping.patient_id = FIRST_PATIENT_ID + patient;
+			MakeSensorId(patient, mapping.device_id);
+			mappingWriter.Write(mapping);
+			for (int p = 0; p < PUMPS_PER_PATIENT; p++)
+			{
+				int pump = patient * PUMPS_PER_PATIENT + p;
+				MakePumpId(pump, mapping.device_id);
+				mappingWriter.Write(mapping);
+				WriteStatus(run.statusWriter, status, pump, true);
+			}
+		}
+
+		OSThread interlockThread(InterlockThread, &run);
+		OSThread pumpThread(PumpThread, &run);
+		OSThread loadThread(LoadThread, &run);
+		interlockThread.Run();
+		pumpThread.Run();
+
+		// The numerics are volatile, so the trials start once the interlock
+		// receives them, and has had time to receive the mappings and the
+		// pump status
+		WaitForMatch(run.numericWriter->GetDataWriter());
+		DDS_Duration_t warmup = {2, 0};
+		NDDSUtility::sleep(warmup);
+		loadThread.Run();
+
+		cout << options.patients << " patients with " << PUMPS_PER_PATIENT
+			<< " pumps each, " << options.trials << " trials, budget "
+			<< options.budgetMs << " ms, background load "
+			<< options.loadRate << " numerics/s" << endl;
+
+		std::vector<int64_t> pumpLatencies;
+		int missed = RunTrials(run, options, pumpLatencies);
+
+		run.stop = true;
+		loadThread.Join();
+		pumpThread.Join();
+		interlockThread.Join();
+
+		// The interlock's own view of each stop
+		std::vector<int64_t> commandLatencies;
+		std::vector<int64_t> confirmedLatencies;
+		int lateConfirmations = 0;
+		for (size_t i = 0; i < run.confirmedStops.size(); i++)
+		{
+			const InterlockStop &stop = run.confirmedStops[i];
+			commandLatencies.push_back(stop.commandTime - stop.sensorTime);
+			confirmedLatencies.push_back(
+				stop.confirmedTime - stop.sensorTime);
+			if (stop.overBudget)
+			{
+				lateConfirmations++;
+			}
+		}
+
+		PrintLatencies("Sensor to pump stop:     ", pumpLatencies);
+		PrintLatencies("Sensor to command:       ", commandLatencies);
+		PrintLatencies("Sensor to confirmation:  ", confirmedLatencies);
+
+		// A stop that was reported late and then confirmed is counted
+		// once, as a late confirmation
+		int neverConfirmed = (int)(options.trials * PUMPS_PER_PATIENT) -
+			(int)run.confirmedStops.size();
+		if (neverConfirmed < 0)
+		{
+			neverConfirmed = 0;
+		}
+		violations = lateConfirmations + neverConfirmed;
+		cout << "Budget violations: " << violations << " ("
+			<< lateConfirmations << " confirmed late, " << neverConfirmed
+			<< " never confirmed, " << missed
+			<< " never received by the pump)" << endl;
+		for (size_t i = 0; i < run.confirmedStops.size(); i++)
+		{
+			const InterlockStop &stop = run.confirmedStops[i];
+			if (stop.overBudget)
+			{
+				cout << "    pump " << stop.pumpId << ": "
+					<< (stop.confirmedTime - stop.sensorTime) / 1e6
+					<< " ms" << endl;
+			}
+		}
+		cout << (violations == 0 ? "PASSED" : "FAILED") << endl;
+
+		delete run.objectiveReader;
+		delete run.statusWriter;
+		delete run.numericWriter;
+		delete run.interlock;
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return violations == 0 ? 0 : 1;
+}
@@ -0,0 +1,337 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../CommonInfrastructure/WaveformJitterBuffer.h"
+#include "ReplayRecording.h"
+
+using namespace std;
+
+// ------------------------------------------------------------------------- //
+// This benchmark plays one simulated waveform stream through the
+// WaveformJitterBuffer, with an adaptive delay and with fixed delays, over
+// the same simulated network.  Time is simulated, so the run takes far less
+// than the time it simulates.  The device sends a frame of 250 Hz samples
+// every 100 ms, with its own clock.  The network adds a random delay to
+// each frame, which reorders frames that are sent close together, loses a
+// share of them, and stalls now and then, delivering the frames sent during
+// the stall all at once when it ends.  The random delay can change halfway
+// through the run, which no single fixed delay suits.  The renderer asks for
+// a block every 40 ms.  For each delay, it reports:
+//
+//  - The latency of the samples played, from the time they were measured
+//    to the time they are handed out: the mean, the 99th percentile and
+//    the largest.  Samples are measured one sample period apart, starting
+//    at time 0 on the local clock, so the latency of a sample follows from
+//    its index.  A frame is only sent once its last sample is measured, so
+//    no latency is below the duration of a frame.
+//  - The underruns, and the samples played, concealed and missing.
+//  - The samples skipped and repeated to follow the delay.
+//  - Correctness: each value is the index of its sample, so the values
+//    handed out must never go backwards.
+//  - The cost of adding a frame and of getting a block.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+// Stream and renderer
+static const int64_t SAMPLE_PERIOD = 4 * NANOSECONDS_PER_MILLISECOND;
+static const unsigned int FRAME_SAMPLES = 25;
+static const int64_t BLOCK_DURATION = 40 * NANOSECONDS_PER_MILLISECOND;
+
+// The device's clock is ahead of the local clock, which the buffer must
+// not care about
+static const int64_t DEVICE_CLOCK_OFFSET = 5 * NANOSECONDS_PER_SECOND;
+
+// Fixed delays compared with the adaptive delay, in milliseconds
+static const int64_t FIXED_DELAYS_MS[] = {20, 40, 60, 100, 250};
+static const unsigned int FIXED_DELAY_COUNT = 5;
+
+// A frame as it arrives from the simulated network
+struct SimulatedFrame
+{
+	int64_t sourceTime;
+	int64_t arrivalTime;
+	unsigned int firstSample;
+
+	bool operator<(const SimulatedFrame &other) const
+	{
+		return arrivalTime < other.arrivalTime;
+	}
+};
+
+// Settings of the simulated network
+struct NetworkOptions
+{
+	double jitterMs;
+	double laterJitterMs;
+	double loss;
+	double stallsPerMinute;
+	double stallMs;
+};
+
+static double Uniform()
+{
+	return ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+}
+
+// Frames in order of arrival.  The extra delay of a frame is exponential,
+// with the mean jitter, plus the rest of the stall it is sent in, if any.
+static void SimulateNetwork(const NetworkOptions &options, long seconds,
+	std::vector<SimulatedFrame> &frames)
+{
+	const int64_t frameDuration = (int64_t)FRAME_SAMPLES * SAMPLE_PERIOD;
+	const int64_t baseDelay = 2 * NANOSECONDS_PER_MILLISECOND;
+	unsigned int frameCount = (unsigned int)(seconds *
+		NANOSECONDS_PER_SECOND / frameDuration);
+
+	srand(42);
+	double stallChance = options.stallsPerMinute * (double)frameDuration /
+		(60.0 * (double)NANOSECONDS_PER_SECOND);
+	int64_t stallEnd = 0;
+
+	frames.clear();
+	for (unsigned int i = 0; i < frameCount; i++)
+	{
+		int64_t sendTime = (int64_t)(i + 1) * frameDuration;
+		if (sendTime >= stallEnd && Uniform() < stallChance)
+		{
+			stallEnd = sendTime +
+				(int64_t)(options.stallMs * NANOSECONDS_PER_MILLISECOND);
+		}
+		if (Uniform() < options.loss)
+		{
+			continue;
+		}
+
+		double jitterMs = i < frameCount / 2 ? options.jitterMs :
+			options.laterJitterMs;
+		int64_t delay = baseDelay + (int64_t)(-jitterMs *
+			log(Uniform()) * NANOSECONDS_PER_MILLISECOND);
+		if (sendTime < stallEnd)
+		{
+			delay += stallEnd - sendTime;
+		}
+
+		SimulatedFrame frame;
+		frame.sourceTime = DEVICE_CLOCK_OFFSET + (int64_t)i * frameDuration;
+		frame.arrivalTime = sendTime + delay;
+		frame.firstSample = i * FRAME_SAMPLES;
+		frames.push_back(frame);
+	}
+	std::stable_sort(frames.begin(), frames.end());
+}
+
+// Plays the frames through a jitter buffer, and prints one line of results
+static void Play(const std::string &name, const WaveformJitterConfig &config,
+	const std::vector<SimulatedFrame> &frames, long seconds)
+{
+	WaveformJitterBuffer buffer(config);
+	std::vector<float> values(FRAME_SAMPLES);
+	std::vector<float> block;
+
+	const int64_t end = (int64_t)seconds * NANOSECONDS_PER_SECOND;
+	size_t next = 0;
+	int64_t addTime = 0;
+	int64_t blockTime = 0;
+	uint64_t blocks = 0;
+	std::vector<int64_t> latencies;
+	uint64_t backwards = 0;
+	float lastValue = -1.0f;
+
+	for (int64_t now = BLOCK_DURATION; now <= end; now += BLOCK_DURATION)
+	{
+		int64_t start = BenchmarkClock();
+		for (; next < frames.size() && frames[next].arrivalTime <= now; next++)
+		{
+			const SimulatedFrame &frame = frames[next];
+			for (unsigned int i = 0; i < FRAME_SAMPLES; i++)
+			{
+				values[i] = (float)(frame.firstSample + i);
+			}
+			buffer.AddFrame(frame.sourceTime, frame.arrivalTime, &values[0],
+				FRAME_SAMPLES, SAMPLE_PERIOD);
+		}
+		int64_t blockStart = BenchmarkClock();
+		addTime += blockStart - start;
+
+		unsigned int count = buffer.GetBlock(now, block);
+		blockTime += BenchmarkClock() - blockStart;
+		if (count == 0)
+		{
+			continue;
+		}
+		blocks++;
+
+		// The samples of a block are rendered one sample period apart,
+		// from now
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (block[i] != block[i])
+			{
+				continue;
+			}
+			if (block[i] < lastValue)
+			{
+				backwards++;
+			}
+			lastValue = block[i];
+			latencies.push_back(now + (int64_t)i * SAMPLE_PERIOD -
+				(int64_t)block[i] * SAMPLE_PERIOD);
+		}
+	}
+
+	double totalLatency = 0.0;
+	for (size_t i = 0; i < latencies.size(); i++)
+	{
+		totalLatency += (double)latencies[i];
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	WaveformJitterMetrics metrics;
+	buffer.GetMetrics(metrics);
+	uint64_t samples = metrics.samplesPlayed + metrics.samplesConcealed +
+		metrics.samplesMissing;
+
+	char line[256];
+	sprintf(line, "%-14s %7.1f %7.1f %7.1f %9llu %8.3f%% %8.3f%% %7llu "
+		"%7llu %9llu %6.0f %6.0f",
+		name.c_str(),
+		latencies.empty() ? 0.0 : totalLatency / latencies.size() / 1e6,
+		latencies.empty() ? 0.0 :
+			(double)latencies[latencies.size() * 99 / 100] / 1e6,
+		latencies.empty() ? 0.0 : (double)latencies.back() / 1e6,
+		(unsigned long long)metrics.underruns,
+		samples == 0 ? 0.0 : 100.0 * metrics.samplesConcealed / samples,
+		samples == 0 ? 0.0 : 100.0 * metrics.samplesMissing / samples,
+		(unsigned long long)metrics.samplesSkipped,
+		(unsigned long long)metrics.samplesRepeated,
+		(unsigned long long)backwards,
+		frames.empty() ? 0.0 : (double)addTime / frames.size(),
+		blocks == 0 ? 0.0 : (double)blockTime / blocks);
+	cout << line << endl;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --seconds <n>" <<
+		"                  Simulated time (default: 600)" << endl;
+	cout << "    --jitter-ms <x>" <<
+		"                Mean random delay of a frame (default: 10)"
+		<< endl;
+	cout << "    --later-jitter-ms <x>" <<
+		"          Mean random delay in the second half of" << endl <<
+		"                                   " <<
+		"the run (default: the --jitter-ms)" << endl;
+	cout << "    --loss <share>" <<
+		"                 Share of frames lost (default: 0.01)" << endl;
+	cout << "    --stalls <n>" <<
+		"                   Network stalls per minute (default: 2)" << endl;
+	cout << "    --stall-ms <x>" <<
+		"                 Duration of a stall (default: 300)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	long seconds = 600;
+	NetworkOptions network;
+	network.jitterMs = 10.0;
+	network.laterJitterMs = -1.0;
+	network.loss = 0.01;
+	network.stallsPerMinute = 2.0;
+	network.stallMs = 300.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			seconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--jitter-ms") && i + 1 < argc)
+		{
+			network.jitterMs = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--later-jitter-ms") && i + 1 < argc)
+		{
+			network.laterJitterMs = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--loss") && i + 1 < argc)
+		{
+			network.loss = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--stalls") && i + 1 < argc)
+		{
+			network.stallsPerMinute = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--stall-ms") && i + 1 < argc)
+		{
+			network.stallMs = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (network.laterJitterMs < 0.0)
+	{
+		network.laterJitterMs = network.jitterMs;
+	}
+	if (seconds <= 0 || network.jitterMs < 0.0 || network.stallMs < 0.0)
+	{
+		cout << "The seconds must be positive, and the delays not negative"
+			<< endl;
+		return -1;
+	}
+
+	try
+	{
+		std::vector<SimulatedFrame> frames;
+		SimulateNetwork(network, seconds, frames);
+		cout << "Playing " << frames.size() << " frames over " << seconds
+			<< " s, jitter " << network.jitterMs << " ms then "
+			<< network.laterJitterMs << " ms, loss "
+			<< network.loss * 100.0 << "%, " << network.stallsPerMinute
+			<< " stalls of " << network.stallMs << " ms per minute" << endl;
+		cout << "Latency        mean ms  99% ms  max ms underruns concealed"
+			<< "   missing skipped repeats backwards add ns blk ns" << endl;
+
+		WaveformJitterConfig config;
+		config.blockDuration = BLOCK_DURATION;
+		Play("adaptive", config, frames, seconds);
+
+		for (unsigned int i = 0; i < FIXED_DELAY_COUNT; i++)
+		{
+			WaveformJitterConfig fixed = config;
+			fixed.minimumDelay = FIXED_DELAYS_MS[i] *
+				NANOSECONDS_PER_MILLISECOND;
+			fixed.maximumDelay = fixed.minimumDelay;
+			char name[32];
+			sprintf(name, "fixed %lld ms", (long long)FIXED_DELAYS_MS[i]);
+			Play(name, fixed, frames, seconds);
+		}
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,502 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSReactor.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../Generated/alarm.h"
+#include "../Generated/alarmSupport.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/profiles.h"
+
+using namespace std;
+using namespace com::rti::medical::generated;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures the latency of alarms sent while the same
+// DomainParticipant saturates the network with waveform data, with and
+// without priority lanes.
+//
+// One participant sends ice::SampleArray data as fast as it can from one
+// thread, and sends alarms at a fixed rate from another thread.  A second
+// participant in the same process receives both, and measures the time from
+// the write of each alarm to its delivery to the handler.
+//
+//  - Shared: the alarm and streaming DataWriters use the CompactAlarms and
+//    StreamingData profiles in the same Publisher, and all threads have the
+//    default scheduling.  This is how applications send both today.
+//  - Lanes: the DataWriters are in separate Publishers with the AlarmLane and
+//    StreamingLane profiles, the streaming data goes through a flow
+//    controller, and the alarm sending and receiving threads run at
+//    real-time priority (when the process is allowed to).
+//
+// The benchmark uses its own topic names, so it does not disturb other
+// applications on the domain.
+//
+// ------------------------------------------------------------------------- //
+
+static const char *BENCHMARK_ALARM_TOPIC = "LaneBenchmark::Alarm";
+static const char *BENCHMARK_STREAMING_TOPIC = "LaneBenchmark::SampleArray";
+
+struct LaneOptions
+{
+	int seconds;
+	int alarmRate;
+	int streams;
+	OSThreadOptions alarmThreads;
+};
+
+// ----------------------------------------------------------------------------
+// State shared by the threads of one run
+struct LaneRun
+{
+	LaneRun() :
+		stopStreaming(false),
+		alarmWriter(NULL),
+		streamingWriter(NULL),
+		streamingWritten(0)
+	{
+	}
+
+	volatile bool stopStreaming;
+	CompactAlarmDataWriter *alarmWriter;
+	ice::SampleArrayDataWriter *streamingWriter;
+	int alarmCount;
+	int alarmPeriodNanoseconds;
+	int streams;
+
+	// Time each alarm was written, by alarm index
+	std::vector<int64_t> sendTimes;
+	uint64_t streamingWritten;
+};
+
+// ----------------------------------------------------------------------------
+// Receives alarms, and measures their latency from the send times
+class AlarmLatencyHandler : public ReactorHandler<CompactAlarm>
+{
+public:
+	AlarmLatencyHandler(const LaneRun &run) : _run(run)
+	{
+	}
+
+	virtual void OnData(LoanedBatch<CompactAlarm> &batch)
+	{
+		int64_t now = OSGetMonotonicTime();
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			if (!batch.IsValid(i) ||
+				batch.GetData(i).values.length() == 0)
+			{
+				continue;
+			}
+			int index = batch.GetData(i).values[0].instance_id;
+			if (index >= 0 && index < (int)_run.sendTimes.size())
+			{
+				latencies.push_back(now - _run.sendTimes[index]);
+			}
+		}
+	}
+
+	std::vector<int64_t> latencies;
+
+private:
+	const LaneRun &_run;
+};
+
+class StreamingCountHandler : public ReactorHandler<ice::SampleArray>
+{
+public:
+	StreamingCountHandler() : received(0)
+	{
+	}
+
+	virtual void OnData(LoanedBatch<ice::SampleArray> &batch)
+	{
+		received += batch.GetLength();
+	}
+
+	uint64_t received;
+};
+
+// ----------------------------------------------------------------------------
+// Writes full waveform frames round-robin over the streams until stopped
+static void *StreamingThread(void *param)
+{
+	LaneRun *run = (LaneRun *)param;
+	DdsAutoType<ice::SampleArray> frame;
+	frame.values.ensure_length(400, 400);
+	for (int i = 0; i < 400; i++)
+	{
+		frame.values[i] = (float)i;
+	}
+	frame.millisecondsPerSample = 2;
+	strcpy(frame.metric_id, "MDC_ECG_LEAD_II");
+
+	DDS_InstanceHandle_t handle = DDS_HANDLE_NIL;
+	while (!run->stopStreaming)
+	{
+		for (int s = 0; s < run->streams && !run->stopStreaming; s++)
+		{
+			sprintf(frame.unique_device_identifier, "lane-device-%d", s);
+			if (run->streamingWriter->write(frame, handle) == DDS_RETCODE_OK)
+			{
+				run->streamingWritten++;
+			}
+		}
+	}
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Writes the alarms at the alarm rate, recording the time of each write
+static void *AlarmThread(void *param)
+{
+	LaneRun *run = (LaneRun *)param;
+	DdsAutoType<CompactAlarm> alarm;
+	alarm.alarmKind = HIGH_PULSE_RATE;
+	alarm.table_id = 0;
+	alarm.values.ensure_length(1, 1);
+	alarm.values[0].device_code = 0;
+	alarm.values[0].metric_code = 0;
+	alarm.values[0].timestamp = 0;
+
+	DDS_InstanceHandle_t handle = DDS_HANDLE_NIL;
+	int64_t next = OSGetMonotonicTime();
+	for (int i = 0; i < run->alarmCount; i++)
+	{
+		next += run->alarmPeriodNanoseconds;
+		int64_t wait = next - OSGetMonotonicTime();
+		if (wait > 0)
+		{
+			DDS_Duration_t sleepTime = {(DDS_Long)(wait / 1000000000LL),
+				(DDS_UnsignedLong)(wait % 1000000000LL)};
+			NDDSUtility::sleep(sleepTime);
+		}
+
+		alarm.patient_id = i % 16;
+		alarm.values[0].instance_id = i;
+		alarm.values[0].value = 150.0f;
+		run->sendTimes[i] = OSGetMonotonicTime();
+		run->alarmWriter->write(alarm, handle);
+	}
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Waits for a DataWriter to match a DataReader, so the measurement does not
+// include discovery
+static void WaitForMatch(DDS::DataWriter *writer)
+{
+	DDS_Duration_t pollPeriod = {0, 100000000};
+	for (int i = 0; i < 100; i++)
+	{
+		DDS_PublicationMatchedStatus status;
+		writer->get_publication_matched_status(status);
+		if (status.current_count > 0)
+		{
+			return;
+		}
+		NDDSUtility::sleep(pollPeriod);
+	}
+	std::stringstream errss;
+	errss << "Benchmark DataReaders were not discovered";
+	throw errss.str();
+}
+
+static DDS::DomainParticipant *CreateParticipant(DDSCommunicator &communicator,
+	const char *profile)
+{
+	std::vector<std::string> xmlFiles;
+	xmlFiles.push_back("file://../../../src/Config/qos_profiles.xml");
+	DDS::DomainParticipant *participant = communicator.CreateParticipant(5,
+		xmlFiles, ICE_QOS_LIBRARY, profile);
+	if (participant == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+	return participant;
+}
+
+static int64_t Percentile(const std::vector<int64_t> &sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	size_t index = (size_t)(p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+// ----------------------------------------------------------------------------
+// Runs one mode of the benchmark, and prints its results
+static void RunMode(bool lanes, const LaneOptions &options)
+{
+	LaneRun run;
+	run.alarmCount = options.seconds * options.alarmRate;
+	run.alarmPeriodNanoseconds = 1000000000 / options.alarmRate;
+	run.streams = options.streams;
+	run.sendTimes.resize(run.alarmCount, 0);
+
+	// Receiving participant, the same in both modes
+	DDSCommunicator receiver;
+	CreateParticipant(receiver, QOS_PROFILE_PARTICIPANT);
+	DDS::Subscriber *sub = receiver.CreateSubscriber();
+	DDS::Topic *alarmTopic = receiver.CreateTopic<CompactAlarm>(
+		BENCHMARK_ALARM_TOPIC);
+	DDS::Topic *streamingTopic = receiver.CreateTopic<ice::SampleArray>(
+		BENCHMARK_STREAMING_TOPIC);
+	CompactAlarmDataReader *alarmReader = CompactAlarmDataReader::narrow(
+		sub->create_datareader_with_profile(alarmTopic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_COMPACT_ALARM, NULL, DDS_STATUS_MASK_NONE));
+	ice::SampleArrayDataReader *streamingReader =
+		ice::SampleArrayDataReader::narrow(
+			sub->create_datareader_with_profile(streamingTopic,
+				ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING, NULL,
+				DDS_STATUS_MASK_NONE));
+	if (alarmReader == NULL || streamingReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create benchmark DataReaders";
+		throw errss.str();
+	}
+
+	// Sending participant: both DataWriters share a Publisher, or each has
+	// its own lane
+	DDSCommunicator sender;
+	CreateParticipant(sender, lanes ? QOS_PROFILE_PRIORITY_LANES :
+		QOS_PROFILE_PARTICIPANT);
+	DDS::Topic *sendAlarmTopic = sender.CreateTopic<CompactAlarm>(
+		BENCHMARK_ALARM_TOPIC);
+	DDS::Topic *sendStreamingTopic = sender.CreateTopic<ice::SampleArray>(
+		BENCHMARK_STREAMING_TOPIC);
+
+	DDS::Publisher *alarmPub = NULL;
+	DDS::Publisher *streamingPub = NULL;
+	if (lanes)
+	{
+		alarmPub = sender.CreatePublisher(ICE_QOS_LIBRARY,
+			QOS_PROFILE_ALARM_LANE);
+		streamingPub = sender.CreatePublisher(ICE_QOS_LIBRARY,
+			QOS_PROFILE_STREAMING_LANE);
+	} else
+	{
+		alarmPub = sender.CreatePublisher();
+		streamingPub = alarmPub;
+	}
+
+	run.alarmWriter = CompactAlarmDataWriter::narrow(
+		alarmPub->create_datawriter_with_profile(sendAlarmTopic,
+			ICE_QOS_LIBRARY,
+			lanes ? QOS_PROFILE_ALARM_LANE : QOS_PROFILE_COMPACT_ALARM,
+			NULL, DDS_STATUS_MASK_NONE));
+	run.streamingWriter = ice::SampleArrayDataWriter::narrow(
+		streamingPub->create_datawriter_with_profile(sendStreamingTopic,
+			ICE_QOS_LIBRARY,
+			lanes ? QOS_PROFILE_STREAMING_LANE : QOS_PROFILE_STREAMING,
+			NULL, DDS_STATUS_MASK_NONE));
+	if (run.alarmWriter == NULL || run.streamingWriter == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create benchmark DataWriters. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	WaitForMatch(run.alarmWriter);
+	WaitForMatch(run.streamingWriter);
+
+	// Alarms are evaluated on their own real-time reactor thread in the
+	// lanes mode, and share the thread of the streaming data otherwise
+	AlarmLatencyHandler alarmHandler(run);
+	StreamingCountHandler streamingHandler;
+	OSThreadOptions defaultOptions;
+	DDSReactor streamingReactor(1);
+	DDSReactor alarmReactor(1, DDS_LENGTH_UNLIMITED, options.alarmThreads);
+	if (lanes)
+	{
+		alarmReactor.Register<CompactAlarm>(alarmReader, &alarmHandler, 1);
+		alarmReactor.Start();
+	} else
+	{
+		streamingReactor.Register<CompactAlarm>(alarmReader, &alarmHandler, 0);
+	}
+	streamingReactor.Register<ice::SampleArray>(streamingReader,
+		&streamingHandler, 0);
+	streamingReactor.Start();
+
+	OSThread streamingThread(StreamingThread, &run);
+	OSThread alarmThread(AlarmThread, &run,
+		lanes ? options.alarmThreads : defaultOptions);
+	int64_t start = OSGetMonotonicTime();
+	streamingThread.Run();
+	alarmThread.Run();
+
+	alarmThread.Join();
+	run.stopStreaming = true;
+	streamingThread.Join();
+	int64_t elapsed = OSGetMonotonicTime() - start;
+
+	// Give the last alarms time to arrive
+	DDS_Duration_t drainTime = {1, 0};
+	NDDSUtility::sleep(drainTime);
+	bool realTime = alarmThread.HasRequestedScheduling() &&
+		alarmReactor.HasRequestedScheduling();
+	alarmReactor.Stop();
+	streamingReactor.Stop();
+
+	std::vector<int64_t> latencies = alarmHandler.latencies;
+	std::sort(latencies.begin(), latencies.end());
+	int64_t total = 0;
+	for (size_t i = 0; i < latencies.size(); i++)
+	{
+		total += latencies[i];
+	}
+
+	cout << (lanes ? "Lanes:  " : "Shared: ")
+		<< latencies.size() << "/" << run.alarmCount << " alarms, latency"
+		<< " mean " << (latencies.empty() ? 0.0 :
+			(double)total / latencies.size() / 1e6)
+		<< " ms, p50 " << Percentile(latencies, 0.5) / 1e6
+		<< " ms, p99 " << Percentile(latencies, 0.99) / 1e6
+		<< " ms, max " << Percentile(latencies, 1.0) / 1e6 << " ms; "
+		<< (double)streamingHandler.received * 1e9 / elapsed
+		<< " frames/s received of "
+		<< (double)run.streamingWritten * 1e9 / elapsed << " written"
+		<< endl;
+	if (lanes && options.alarmThreads.realTime && !realTime)
+	{
+		cout << "        (real-time scheduling was not allowed, so the "
+			<< "alarm threads ran with the default scheduling)" << endl;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	LaneOptions options;
+	options.seconds = 10;
+	options.alarmRate = 50;
+	options.streams = 32;
+	options.alarmThreads.realTime = true;
+	options.alarmThreads.priority = 80;
+	bool runShared = true;
+	bool runLanes = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			options.seconds = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--alarm-rate") && i + 1 < argc)
+		{
+			options.alarmRate = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--streams") && i + 1 < argc)
+		{
+			options.streams = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--priority") && i + 1 < argc)
+		{
+			options.alarmThreads.priority = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--no-realtime"))
+		{
+			options.alarmThreads.realTime = false;
+		} else if (0 == strcmp(argv[i], "--cpu") && i + 1 < argc)
+		{
+			options.alarmThreads.cpu = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--mode") && i + 1 < argc)
+		{
+			i++;
+			runShared = (0 == strcmp(argv[i], "shared") ||
+				0 == strcmp(argv[i], "both"));
+			runLanes = (0 == strcmp(argv[i], "lanes") ||
+				0 == strcmp(argv[i], "both"));
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	if (options.seconds <= 0 || options.alarmRate <= 0 ||
+		options.streams <= 0)
+	{
+		cout << "Seconds, alarm rate and streams must be positive" << endl;
+		return -1;
+	}
+
+	try
+	{
+		cout << options.streams << " waveform streams at full rate, "
+			<< options.alarmRate << " alarms/s for " << options.seconds
+			<< " s" << endl;
+		if (runShared)
+		{
+			RunMode(false, options);
+		}
+		if (runLanes)
+		{
+			RunMode(true, options);
+		}
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --seconds <n>" <<
+		"                  Duration of each run (default: 10)"
+		<< endl;
+	cout <<
+		"    --alarm-rate <n>" <<
+		"               Alarms per second (default: 50)"
+		<< endl;
+	cout <<
+		"    --streams <n>" <<
+		"                  Waveform streams (default: 32)"
+		<< endl;
+	cout <<
+		"    --mode <shared|lanes|both>" <<
+		"     Runs to measure (default: both)"
+		<< endl;
+	cout <<
+		"    --priority <n>" <<
+		"                 SCHED_FIFO priority of alarm threads (default: 80)"
+		<< endl;
+	cout <<
+		"    --no-realtime" <<
+		"                  Do not use real-time scheduling for alarm threads"
+		<< endl;
+	cout <<
+		"    --cpu <n>" <<
+		"                      Pin the alarm threads to a CPU"
+		<< endl;
+}
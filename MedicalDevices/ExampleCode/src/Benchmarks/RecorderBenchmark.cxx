@@ -0,0 +1,417 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <sstream>
+#include <sqlite3.h>
+#include "../CommonInfrastructure/ColumnarSegment.h"
+#include "../Recorder/SegmentStore.h"
+#include "ReplayRecording.h"
+
+using namespace std;
+
+// ------------------------------------------------------------------------- //
+// This benchmark compares the columnar segment recorder with the SQLite
+// format written by RTI Recording Service.  It loads the device recordings
+// in the replay directory, replays their samples a number of times, and
+// measures:
+//
+//  - Ingest rate: values per second written to a Recording Service style
+//    SQLite database (one row per Numeric, one 400-column row per
+//    SampleArray, committed in batches), and to columnar segments through
+//    the SegmentStore used by the DeviceRecorder.
+//  - Scan rate: values per second read back from each format.
+//  - Size on disk of each format.
+//
+// ------------------------------------------------------------------------- //
+
+static const int SQLITE_VALUE_COLUMNS = 400;
+static const int SQLITE_BATCH_ROWS = 1000;
+
+static double Rate(uint64_t count, int64_t elapsed)
+{
+	return elapsed <= 0 ? 0.0 : (double)count * 1e9 / (double)elapsed;
+}
+
+static void Execute(sqlite3 *db, const std::string &sql)
+{
+	char *error = NULL;
+	if (sqlite3_exec(db, sql.c_str(), NULL, NULL, &error) != SQLITE_OK)
+	{
+		std::stringstream errss;
+		errss << "SQLite error: " << (error == NULL ? "" : error);
+		sqlite3_free(error);
+		throw errss.str();
+	}
+}
+
+// Span of the recording, used to shift timestamps on each repetition
+static int64_t RecordingSpan(const ReplayRecording &recording)
+{
+	int64_t first = 0;
+	int64_t last = 0;
+	bool any = false;
+	for (size_t i = 0; i < recording.GetNumerics().size(); i++)
+	{
+		int64_t t = recording.GetNumerics()[i].timestamp;
+		first = (!any || t < first) ? t : first;
+		last = (!any || t > last) ? t : last;
+		any = true;
+	}
+	for (size_t i = 0; i < recording.GetSampleArrays().size(); i++)
+	{
+		int64_t t = recording.GetSampleArrays()[i].timestamp;
+		first = (!any || t < first) ? t : first;
+		last = (!any || t > last) ? t : last;
+		any = true;
+	}
+	return last - first + 1000000000LL;
+}
+
+// ------------------------------------------------------------------------- //
+// SQLite ingest, using the table layout of Recording Service
+static void IngestSqlite(const ReplayRecording &recording, int repeat,
+	const std::string &fileName)
+{
+	remove(fileName.c_str());
+	sqlite3 *db = NULL;
+	if (sqlite3_open(fileName.c_str(), &db) != SQLITE_OK)
+	{
+		throw std::string("Failed to create SQLite benchmark database");
+	}
+
+	std::stringstream createNumeric;
+	createNumeric << "CREATE TABLE \"" << ReplayRecording::NUMERIC_TABLE
+		<< "\" (\"SampleInfo_reception_timestamp\" INTEGER,"
+		<< "\"SampleInfo_valid_data\" INTEGER,"
+		<< "\"unique_device_identifier\" TEXT,\"metric_id\" TEXT,"
+		<< "\"instance_id\" INTEGER,\"value\" REAL)";
+	Execute(db, createNumeric.str());
+
+	std::stringstream createArray;
+	std::stringstream insertArray;
+	createArray << "CREATE TABLE \"" << ReplayRecording::SAMPLE_ARRAY_TABLE
+		<< "\" (\"SampleInfo_reception_timestamp\" INTEGER,"
+		<< "\"SampleInfo_valid_data\" INTEGER,"
+		<< "\"unique_device_identifier\" TEXT,\"metric_id\" TEXT,"
+		<< "\"instance_id\" INTEGER,\"values$length\" INTEGER";
+	insertArray << "INSERT INTO \"" << ReplayRecording::SAMPLE_ARRAY_TABLE
+		<< "\" VALUES (?,1,?,?,?,?";
+	for (int i = 0; i < SQLITE_VALUE_COLUMNS; i++)
+	{
+		createArray << ",\"values[" << i << "]\" REAL";
+		insertArray << ",?";
+	}
+	createArray << ",\"millisecondsPerSample\" INTEGER)";
+	insertArray << ",?)";
+	Execute(db, createArray.str());
+
+	std::stringstream insertNumeric;
+	insertNumeric << "INSERT INTO \"" << ReplayRecording::NUMERIC_TABLE
+		<< "\" VALUES (?,1,?,?,?,?)";
+
+	sqlite3_stmt *numericInsert = NULL;
+	sqlite3_stmt *arrayInsert = NULL;
+	sqlite3_prepare_v2(db, insertNumeric.str().c_str(), -1,
+		&numericInsert, NULL);
+	sqlite3_prepare_v2(db, insertArray.str().c_str(), -1,
+		&arrayInsert, NULL);
+
+	const std::vector<RecordedNumeric> &numerics = recording.GetNumerics();
+	const std::vector<RecordedSampleArray> &frames =
+		recording.GetSampleArrays();
+	int64_t span = RecordingSpan(recording);
+
+	int64_t start = BenchmarkClock();
+	int rows = 0;
+	Execute(db, "BEGIN");
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		int64_t shift = span * pass;
+		for (size_t i = 0; i < numerics.size(); i++)
+		{
+			sqlite3_bind_int64(numericInsert, 1,
+				numerics[i].timestamp + shift);
+			sqlite3_bind_text(numericInsert, 2,
+				numerics[i].deviceId.c_str(), -1, SQLITE_STATIC);
+			sqlite3_bind_text(numericInsert, 3,
+				numerics[i].metricId.c_str(), -1, SQLITE_STATIC);
+			sqlite3_bind_int(numericInsert, 4, numerics[i].instanceId);
+			sqlite3_bind_double(numericInsert, 5, numerics[i].value);
+			sqlite3_step(numericInsert);
+			sqlite3_reset(numericInsert);
+			if (++rows % SQLITE_BATCH_ROWS == 0)
+			{
+				Execute(db, "COMMIT");
+				Execute(db, "BEGIN");
+			}
+		}
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			const RecordedSampleArray &frame = frames[i];
+			sqlite3_bind_int64(arrayInsert, 1, frame.timestamp + shift);
+			sqlite3_bind_text(arrayInsert, 2, frame.deviceId.c_str(), -1,
+				SQLITE_STATIC);
+			sqlite3_bind_text(arrayInsert, 3, frame.metricId.c_str(), -1,
+				SQLITE_STATIC);
+			sqlite3_bind_int(arrayInsert, 4, frame.instanceId);
+			sqlite3_bind_int(arrayInsert, 5, (int)frame.values.size());
+			for (int v = 0; v < SQLITE_VALUE_COLUMNS; v++)
+			{
+				if (v < (int)frame.values.size())
+				{
+					sqlite3_bind_double(arrayInsert, 6 + v, frame.values[v]);
+				} else
+				{
+					sqlite3_bind_null(arrayInsert, 6 + v);
+				}
+			}
+			sqlite3_bind_int(arrayInsert, 6 + SQLITE_VALUE_COLUMNS,
+				frame.millisecondsPerSample);
+			sqlite3_step(arrayInsert);
+			sqlite3_reset(arrayInsert);
+			if (++rows % SQLITE_BATCH_ROWS == 0)
+			{
+				Execute(db, "COMMIT");
+				Execute(db, "BEGIN");
+			}
+		}
+	}
+	Execute(db, "COMMIT");
+	int64_t elapsed = BenchmarkClock() - start;
+
+	sqlite3_finalize(numericInsert);
+	sqlite3_finalize(arrayInsert);
+	sqlite3_close(db);
+
+	OSMappedFile file;
+	file.Open(fileName);
+	cout << "SQLite ingest:    "
+		<< Rate(recording.GetValueCount() * repeat, elapsed) / 1e6
+		<< " M values/s, " << file.GetSize() / (1024 * 1024) << " MB on disk"
+		<< endl;
+}
+
+// ------------------------------------------------------------------------- //
+// SQLite scan: reads every value back, as a trend or export query would
+static void ScanSqlite(const std::string &fileName)
+{
+	sqlite3 *db = NULL;
+	sqlite3_open_v2(fileName.c_str(), &db, SQLITE_OPEN_READONLY, NULL);
+
+	int64_t start = BenchmarkClock();
+	uint64_t values = 0;
+	double sum = 0;
+
+	std::stringstream numericss;
+	numericss << "SELECT SampleInfo_reception_timestamp, value FROM \""
+		<< ReplayRecording::NUMERIC_TABLE << "\"";
+	sqlite3_stmt *statement = NULL;
+	sqlite3_prepare_v2(db, numericss.str().c_str(), -1, &statement, NULL);
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		sum += sqlite3_column_double(statement, 1);
+		values++;
+	}
+	sqlite3_finalize(statement);
+
+	std::stringstream arrayss;
+	arrayss << "SELECT * FROM \"" << ReplayRecording::SAMPLE_ARRAY_TABLE
+		<< "\"";
+	sqlite3_prepare_v2(db, arrayss.str().c_str(), -1, &statement, NULL);
+	while (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		int length = sqlite3_column_int(statement, 5);
+		for (int v = 0; v < length; v++)
+		{
+			sum += sqlite3_column_double(statement, 6 + v);
+		}
+		values += length;
+	}
+	sqlite3_finalize(statement);
+	sqlite3_close(db);
+
+	int64_t elapsed = BenchmarkClock() - start;
+	cout << "SQLite scan:      " << Rate(values, elapsed) / 1e6
+		<< " M values/s (" << values << " values, checksum " << sum << ")"
+		<< endl;
+}
+
+// ------------------------------------------------------------------------- //
+// Columnar ingest, through the same SegmentStore used by the recorder
+static void IngestColumnar(const ReplayRecording &recording, int repeat,
+	const std::string &directory)
+{
+	const std::vector<RecordedNumeric> &numerics = recording.GetNumerics();
+	const std::vector<RecordedSampleArray> &frames =
+		recording.GetSampleArrays();
+	int64_t span = RecordingSpan(recording);
+
+	int64_t start = BenchmarkClock();
+	{
+		// One segment per stream for the whole benchmark
+		SegmentStore store(directory, span * (repeat + 1));
+		for (int pass = 0; pass < repeat; pass++)
+		{
+			int64_t shift = span * pass;
+			int64_t received = OSGetMonotonicTime();
+			for (size_t i = 0; i < numerics.size(); i++)
+			{
+				store.AppendNumeric(numerics[i].deviceId.c_str(),
+					numerics[i].metricId.c_str(), numerics[i].instanceId,
+					numerics[i].timestamp + shift, numerics[i].value,
+					received);
+			}
+			for (size_t i = 0; i < frames.size(); i++)
+			{
+				if (frames[i].values.empty())
+				{
+					continue;
+				}
+				store.AppendSampleArray(frames[i].deviceId.c_str(),
+					frames[i].metricId.c_str(), frames[i].instanceId,
+					frames[i].timestamp + shift,
+					(int64_t)frames[i].millisecondsPerSample * 1000000LL,
+					&frames[i].values[0],
+					(unsigned int)frames[i].values.size(), received);
+			}
+		}
+		store.CloseAll();
+	}
+	int64_t elapsed = BenchmarkClock() - start;
+
+	cout << "Columnar ingest:  "
+		<< Rate(recording.GetValueCount() * repeat, elapsed) / 1e6
+		<< " M values/s" << endl;
+}
+
+// ------------------------------------------------------------------------- //
+// Columnar scan: maps each segment and decodes every block in place
+static void ScanColumnar(const std::string &directory)
+{
+	std::vector<std::string> segments;
+	FindSegmentFiles(directory, segments);
+
+	int64_t start = BenchmarkClock();
+	uint64_t values = 0;
+	uint64_t bytes = 0;
+	double sum = 0;
+	std::vector<int64_t> timestamps;
+	std::vector<float> decoded;
+
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		ColumnarSegmentReader reader(segments[i]);
+		for (unsigned int b = 0; b < reader.GetBlockCount(); b++)
+		{
+			const SegmentBlockHeader &block = reader.GetBlockHeader(b);
+			if (decoded.size() < block.sampleCount)
+			{
+				timestamps.resize(block.sampleCount);
+				decoded.resize(block.sampleCount);
+			}
+			unsigned int count = reader.DecodeBlock(b, &timestamps[0],
+				&decoded[0]);
+			for (unsigned int v = 0; v < count; v++)
+			{
+				sum += decoded[v];
+			}
+			values += count;
+			bytes += sizeof(SegmentBlockHeader) + block.timestampBytes +
+				block.valueBytes;
+		}
+	}
+	int64_t elapsed = BenchmarkClock() - start;
+
+	cout << "Columnar scan:    " << Rate(values, elapsed) / 1e6
+		<< " M values/s (" << values << " values, checksum " << sum << ")"
+		<< endl;
+	cout << "Columnar size:    " << bytes / (1024 * 1024) << " MB in "
+		<< segments.size() << " segments" << endl;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --repeat <n>" <<
+		"                   Number of times the recordings are replayed"
+		<< " (default: 20)" << endl;
+	cout << "    --dir <path>" <<
+		"                   Directory for the benchmark output"
+		<< " (default: bench_recording)" << endl;
+	cout << "    <file> ..." <<
+		"                     Recording Service databases to load"
+		<< " (default: the files in the replay directory)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	int repeat = 20;
+	std::string directory = "bench_recording";
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--repeat") && i + 1 < argc)
+		{
+			repeat = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--dir") && i + 1 < argc)
+		{
+			directory = argv[++i];
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			files.push_back(argv[i]);
+		}
+	}
+	if (files.empty())
+	{
+		files = DefaultReplayFiles();
+	}
+
+	try
+	{
+		ReplayRecording recording;
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			recording.Load(files[i]);
+		}
+		cout << "Loaded " << recording.GetNumerics().size() << " Numerics and "
+			<< recording.GetSampleArrays().size() << " SampleArrays ("
+			<< recording.GetValueCount() << " values), replayed " << repeat
+			<< " times" << endl;
+
+		if (!OSCreateDirectory(directory))
+		{
+			throw std::string("Failed to create benchmark directory");
+		}
+
+		std::string sqliteFile = directory + "/recording.dat";
+		IngestSqlite(recording, repeat, sqliteFile);
+		ScanSqlite(sqliteFile);
+
+		std::string columnarDirectory = directory + "/columnar";
+		IngestColumnar(recording, repeat, columnarDirectory);
+		ScanColumnar(columnarDirectory);
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
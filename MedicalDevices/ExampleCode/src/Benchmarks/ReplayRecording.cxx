@@ -0,0 +1,133 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <sstream>
+#include <sqlite3.h>
+#include "../CommonInfrastructure/OSAPI.h"
+#include "ReplayRecording.h"
+
+const char *ReplayRecording::NUMERIC_TABLE = "ice::Numeric$RecordAll$domain5";
+const char *ReplayRecording::SAMPLE_ARRAY_TABLE =
+	"ice::SampleArray$RecordAll$domain5";
+
+static std::string ColumnText(sqlite3_stmt *statement, int column)
+{
+	const unsigned char *text = sqlite3_column_text(statement, column);
+	return text == NULL ? std::string() : std::string((const char *)text);
+}
+
+void ReplayRecording::Load(const std::string &fileName)
+{
+	sqlite3 *db = NULL;
+	if (sqlite3_open_v2(fileName.c_str(), &db, SQLITE_OPEN_READONLY, NULL)
+		!= SQLITE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failed to open recording " << fileName;
+		sqlite3_close(db);
+		throw errss.str();
+	}
+
+	// Numeric table: one row per sample
+	std::stringstream numericss;
+	numericss << "SELECT SampleInfo_reception_timestamp, "
+		<< "unique_device_identifier, metric_id, instance_id, value FROM \""
+		<< NUMERIC_TABLE << "\" WHERE SampleInfo_valid_data = 1 "
+		<< "ORDER BY SampleInfo_reception_timestamp";
+
+	sqlite3_stmt *statement = NULL;
+	if (sqlite3_prepare_v2(db, numericss.str().c_str(), -1, &statement, NULL)
+		== SQLITE_OK)
+	{
+		while (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			RecordedNumeric numeric;
+			numeric.timestamp = sqlite3_column_int64(statement, 0);
+			numeric.deviceId = ColumnText(statement, 1);
+			numeric.metricId = ColumnText(statement, 2);
+			numeric.instanceId = sqlite3_column_int(statement, 3);
+			numeric.value = (float)sqlite3_column_double(statement, 4);
+			_numerics.push_back(numeric);
+		}
+	}
+	sqlite3_finalize(statement);
+
+	// SampleArray table: one row per frame, with one column per element of
+	// the values sequence after the length column
+	std::stringstream arrayss;
+	arrayss << "SELECT * FROM \"" << SAMPLE_ARRAY_TABLE
+		<< "\" WHERE SampleInfo_valid_data = 1 "
+		<< "ORDER BY SampleInfo_reception_timestamp";
+
+	statement = NULL;
+	if (sqlite3_prepare_v2(db, arrayss.str().c_str(), -1, &statement, NULL)
+		== SQLITE_OK)
+	{
+		int columns = sqlite3_column_count(statement);
+		int lengthColumn = -1;
+		int periodColumn = -1;
+		for (int i = 0; i < columns; i++)
+		{
+			std::string name = sqlite3_column_name(statement, i);
+			if (name == "values$length")
+			{
+				lengthColumn = i;
+			} else if (name == "millisecondsPerSample")
+			{
+				periodColumn = i;
+			}
+		}
+
+		while (lengthColumn >= 0 && sqlite3_step(statement) == SQLITE_ROW)
+		{
+			RecordedSampleArray frame;
+			frame.timestamp = sqlite3_column_int64(statement, 0);
+			frame.deviceId = ColumnText(statement, 2);
+			frame.metricId = ColumnText(statement, 3);
+			frame.instanceId = sqlite3_column_int(statement, 4);
+			frame.millisecondsPerSample = periodColumn < 0 ? 0 :
+				sqlite3_column_int(statement, periodColumn);
+
+			int length = sqlite3_column_int(statement, lengthColumn);
+			for (int i = 0; i < length && lengthColumn + 1 + i < columns; i++)
+			{
+				frame.values.push_back((float)sqlite3_column_double(
+					statement, lengthColumn + 1 + i));
+			}
+			_sampleArrays.push_back(frame);
+		}
+	}
+	sqlite3_finalize(statement);
+	sqlite3_close(db);
+}
+
+uint64_t ReplayRecording::GetValueCount() const
+{
+	uint64_t count = _numerics.size();
+	for (size_t i = 0; i < _sampleArrays.size(); i++)
+	{
+		count += _sampleArrays[i].values.size();
+	}
+	return count;
+}
+
+std::vector<std::string> DefaultReplayFiles()
+{
+	std::vector<std::string> files;
+	files.push_back("../../../replay/rti_ice_devices.dat_0_0");
+	files.push_back("../../../replay/rti_ice_devices_ecg.dat_0_0");
+	files.push_back("../../../replay/rti_ice_devices_pulseoxim.dat_0_0");
+	return files;
+}
+
+int64_t BenchmarkClock()
+{
+	return OSGetMonotonicTime();
+}
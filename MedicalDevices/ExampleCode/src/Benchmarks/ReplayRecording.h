@@ -0,0 +1,88 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef REPLAY_RECORDING_H
+#define REPLAY_RECORDING_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------- //
+//
+// ReplayRecording:
+// Loads the ice::Numeric and ice::SampleArray samples of an RTI Recording
+// Service database (such as the files in the replay directory) into memory,
+// so that benchmarks can run on real device data.
+//
+// Recording Service stores each topic in an SQLite table with one column per
+// field, and the reception timestamp of each sample in nanoseconds.
+//
+// ------------------------------------------------------------------------- //
+
+struct RecordedNumeric
+{
+	int64_t timestamp;
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+	float value;
+};
+
+struct RecordedSampleArray
+{
+	int64_t timestamp;
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+	int millisecondsPerSample;
+	std::vector<float> values;
+};
+
+class ReplayRecording
+{
+public:
+	// --- Loading a recording ---
+	// Appends the samples of the database to this recording.  Throws a
+	// std::string if the file cannot be read.
+	void Load(const std::string &fileName);
+
+	// --- Recorded samples, in reception order ---
+	const std::vector<RecordedNumeric> &GetNumerics() const
+	{
+		return _numerics;
+	}
+
+	const std::vector<RecordedSampleArray> &GetSampleArrays() const
+	{
+		return _sampleArrays;
+	}
+
+	// Total number of values: one per Numeric, and one per element of each
+	// SampleArray
+	uint64_t GetValueCount() const;
+
+	// --- Table names used by Recording Service ---
+	static const char *NUMERIC_TABLE;
+	static const char *SAMPLE_ARRAY_TABLE;
+
+private:
+	std::vector<RecordedNumeric> _numerics;
+	std::vector<RecordedSampleArray> _sampleArrays;
+};
+
+// Default recordings shipped with this example, relative to the directory
+// the benchmarks are run from
+std::vector<std::string> DefaultReplayFiles();
+
+// Monotonic clock used by the benchmarks, in nanoseconds
+int64_t BenchmarkClock();
+
+#endif
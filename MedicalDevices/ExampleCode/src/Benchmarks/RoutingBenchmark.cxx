@@ -0,0 +1,474 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSLoanedBatch.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/profiles.h"
+
+using namespace std;
+using namespace com::rti::medical::generated;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures the bandwidth and CPU that a station uses to
+// receive the numerics of the patients it watches, with and without patient
+// routing.  It runs in two roles, in separate processes so the CPU time of
+// the station is its own:
+//
+//  - unit: simulates the devices of every patient of a unit, each sending
+//    numerics at a fixed rate.
+//  - station: receives the numerics for a fixed time, keeps those of the
+//    devices of the patient groups it watches, and prints the samples and
+//    bytes it received, the samples it kept, and its CPU time.
+//
+// Both roles run in one of two modes, which must be the same:
+//
+//  - flat: the devices share a Publisher in the default partition, and the
+//    station receives the data of every device and filters it by patient.
+//    This is how applications receive device data today.
+//  - routed: each device has its own Publisher in the partition of its
+//    patient group, created by a DDSPatientRouter, and the station only
+//    subscribes to the partitions of the groups it watches.
+//
+// The station filters the samples in both modes, so the difference between
+// them is what the station receives.  The benchmark uses its own topic name,
+// so it does not disturb other applications on the domain.
+//
+// ------------------------------------------------------------------------- //
+
+static const char *BENCHMARK_NUMERIC_TOPIC = "RoutingBenchmark::Numeric";
+
+// Metrics sent by each simulated device
+static const char *DEVICE_METRICS[] =
+{
+	"MDC_PULS_RATE",
+	"MDC_PULS_OXIM_SAT_O2",
+	"MDC_PRESS_BLD_NONINV_SYS",
+	"MDC_PRESS_BLD_NONINV_DIA"
+};
+static const int DEVICE_METRIC_COUNT = 4;
+
+struct RoutingOptions
+{
+	bool station;
+	bool routed;
+	int patients;
+	int devicesPerPatient;
+	int rate;
+	int patientsPerGroup;
+	int groups;
+	int seconds;
+};
+
+static std::string GetDeviceId(int patient, int device)
+{
+	std::stringstream deviceId;
+	deviceId << "routing-device-" << patient << "-" << device;
+	return deviceId.str();
+}
+
+static DDS::DomainParticipant *CreateParticipant(DDSCommunicator &communicator)
+{
+	std::vector<std::string> xmlFiles;
+	xmlFiles.push_back("file://../../../src/Config/qos_profiles.xml");
+	DDS::DomainParticipant *participant = communicator.CreateParticipant(5,
+		xmlFiles, ICE_QOS_LIBRARY, QOS_PROFILE_PARTICIPANT);
+	if (participant == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+	return participant;
+}
+
+// ----------------------------------------------------------------------------
+// Sends the numerics of every device of the unit until the time is up, or
+// forever if it is 0
+static void RunUnit(const RoutingOptions &options)
+{
+	DDSCommunicator communicator;
+	DDS::DomainParticipant *participant = CreateParticipant(communicator);
+	DDS::Topic *topic = communicator.CreateTopic<ice::Numeric>(
+		BENCHMARK_NUMERIC_TOPIC);
+
+	// The router is deleted before the communicator, with the Publishers
+	// and DataWriters it created
+	DDSPatientRouter router(participant, ICE_QOS_LIBRARY,
+		QOS_PROFILE_STREAMING, options.patientsPerGroup);
+	DDS::Publisher *sharedPub = NULL;
+	if (options.routed)
+	{
+		// The mappings are known before the DataWriters are created, so
+		// each Publisher is created in its group's partition
+		std::vector<PatientMappingChange> mappings;
+		for (int p = 0; p < options.patients; p++)
+		{
+			for (int d = 0; d < options.devicesPerPatient; d++)
+			{
+				PatientMappingChange change;
+				change.deviceId = GetDeviceId(p, d);
+				change.patientId = p;
+				change.removed = false;
+				mappings.push_back(change);
+			}
+		}
+		router.MappingsChanged(mappings);
+	} else
+	{
+		sharedPub = communicator.CreatePublisher();
+	}
+
+	std::vector<std::string> deviceIds;
+	std::vector<ice::NumericDataWriter *> writers;
+	for (int p = 0; p < options.patients; p++)
+	{
+		for (int d = 0; d < options.devicesPerPatient; d++)
+		{
+			std::string deviceId = GetDeviceId(p, d);
+			DDS::Publisher *pub = options.routed ?
+				router.GetPublisher(deviceId) : sharedPub;
+			ice::NumericDataWriter *writer = ice::NumericDataWriter::narrow(
+				pub->create_datawriter_with_profile(topic, ICE_QOS_LIBRARY,
+					QOS_PROFILE_STREAMING, NULL, DDS_STATUS_MASK_NONE));
+			if (writer == NULL)
+			{
+				std::stringstream errss;
+				errss << "Failure to create benchmark DataWriter. " <<
+					"Inconsistent Qos?";
+				throw errss.str();
+			}
+			deviceIds.push_back(deviceId);
+			writers.push_back(writer);
+		}
+	}
+
+	cout << (options.routed ? "Routed" : "Flat") << " unit: "
+		<< options.patients << " patients, " << writers.size()
+		<< " devices sending " << DEVICE_METRIC_COUNT << " numerics at "
+		<< options.rate << " Hz" << endl;
+
+	DdsAutoType<ice::Numeric> sample;
+	DDS_InstanceHandle_t handle = DDS_HANDLE_NIL;
+	int64_t period = 1000000000LL / options.rate;
+	int64_t start = OSGetMonotonicTime();
+	int64_t next = start;
+	int64_t lastReport = start;
+	uint64_t written = 0;
+	while (options.seconds == 0 ||
+		next - start < (int64_t)options.seconds * 1000000000LL)
+	{
+		for (size_t i = 0; i < writers.size(); i++)
+		{
+			strcpy(sample.unique_device_identifier, deviceIds[i].c_str());
+			for (int m = 0; m < DEVICE_METRIC_COUNT; m++)
+			{
+				strcpy(sample.metric_id, DEVICE_METRICS[m]);
+				sample.instance_id = 0;
+				sample.value = (float)(60 + (written % 40));
+				if (writers[i]->write(sample, handle) == DDS_RETCODE_OK)
+				{
+					written++;
+				}
+			}
+		}
+
+		next += period;
+		int64_t wait = next - OSGetMonotonicTime();
+		if (wait > 0)
+		{
+			DDS_Duration_t sleepTime = {(DDS_Long)(wait / 1000000000LL),
+				(DDS_UnsignedLong)(wait % 1000000000LL)};
+			NDDSUtility::sleep(sleepTime);
+		}
+
+		int64_t now = OSGetMonotonicTime();
+		if (now - lastReport >= 10 * 1000000000LL)
+		{
+			cout << "Written: " << (double)written * 1e9 / (now - start)
+				<< " samples/s" << endl;
+			lastReport = now;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Receives the numerics for the duration of the run, and prints what the
+// station received, kept and spent
+static void RunStation(const RoutingOptions &options)
+{
+	DDSCommunicator communicator;
+	CreateParticipant(communicator);
+	DDS::Subscriber *sub = communicator.CreateSubscriber();
+	DDS::Topic *topic = communicator.CreateTopic<ice::Numeric>(
+		BENCHMARK_NUMERIC_TOPIC);
+
+	// The devices of the patients of the watched groups, which a station
+	// would look up in the patient-device mappings
+	std::vector<long> groups;
+	for (int g = 0; g < options.groups; g++)
+	{
+		groups.push_back(g);
+	}
+	std::map<std::string, PatientId> watchedDevices;
+	for (int p = 0; p < options.patients; p++)
+	{
+		if (GetPatientGroup(p, options.patientsPerGroup) < options.groups)
+		{
+			for (int d = 0; d < options.devicesPerPatient; d++)
+			{
+				watchedDevices[GetDeviceId(p, d)] = p;
+			}
+		}
+	}
+
+	if (options.routed)
+	{
+		SubscribeToPatientGroups(sub, groups);
+	}
+
+	ice::NumericDataReader *reader = ice::NumericDataReader::narrow(
+		sub->create_datareader_with_profile(topic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_STREAMING, NULL, DDS_STATUS_MASK_NONE));
+	if (reader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create benchmark DataReader. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	DDS::ReadCondition *condition = reader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	DDS::WaitSet waitSet;
+	waitSet.attach_condition(condition);
+
+	cout << (options.routed ? "Routed" : "Flat") << " station: watching "
+		<< options.groups << " patient groups of " << options.patientsPerGroup
+		<< " patients (" << watchedDevices.size() << " devices)" << endl;
+
+	// The measurement starts with the first sample, so it does not include
+	// discovery
+	LoanedBatch<ice::Numeric> batch;
+	DDS::ConditionSeq activeConditions;
+	DDS_Duration_t waitTime = {0, 100000000};
+	int64_t firstDeadline = OSGetMonotonicTime() + 30 * 1000000000LL;
+	while (!batch.TakeNext(reader, condition))
+	{
+		if (OSGetMonotonicTime() > firstDeadline)
+		{
+			std::stringstream errss;
+			errss << "No data received.  Is a unit running in the same mode?";
+			throw errss.str();
+		}
+		waitSet.wait(activeConditions, waitTime);
+	}
+	batch.Return();
+
+	DDS_DataReaderProtocolStatus startStatus;
+	reader->get_datareader_protocol_status(startStatus);
+	int64_t start = OSGetMonotonicTime();
+	int64_t startCpu = OSGetProcessCpuTime();
+	int64_t end = start + (int64_t)options.seconds * 1000000000LL;
+
+	uint64_t received = 0;
+	uint64_t kept = 0;
+	while (OSGetMonotonicTime() < end)
+	{
+		waitSet.wait(activeConditions, waitTime);
+		while (batch.TakeNext(reader, condition))
+		{
+			for (int i = 0; i < batch.GetLength(); i++)
+			{
+				if (!batch.IsValid(i))
+				{
+					continue;
+				}
+				received++;
+				if (watchedDevices.find(
+					batch.GetData(i).unique_device_identifier) !=
+					watchedDevices.end())
+				{
+					kept++;
+				}
+			}
+		}
+	}
+
+	int64_t cpu = OSGetProcessCpuTime() - startCpu;
+	int64_t elapsed = OSGetMonotonicTime() - start;
+	DDS_DataReaderProtocolStatus endStatus;
+	reader->get_datareader_protocol_status(endStatus);
+	double seconds = (double)elapsed / 1e9;
+
+	cout << (options.routed ? "Routed: " : "Flat:   ")
+		<< (double)received / seconds << " samples/s received ("
+		<< (double)(endStatus.received_sample_bytes -
+			startStatus.received_sample_bytes) / seconds / 1024.0
+		<< " KB/s), " << (double)kept / seconds << " samples/s kept ("
+		<< (received == 0 ? 0.0 : 100.0 * kept / received) << "%), CPU "
+		<< (double)cpu / 1e6 / seconds << " ms/s" << endl;
+
+	waitSet.detach_condition(condition);
+	reader->delete_readcondition(condition);
+}
+
+int main(int argc, char *argv[])
+{
+	RoutingOptions options;
+	options.station = false;
+	options.routed = true;
+	options.patients = 48;
+	options.devicesPerPatient = 4;
+	options.rate = 10;
+	options.patientsPerGroup = 1;
+	options.groups = 4;
+	options.seconds = -1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--role") && i + 1 < argc)
+		{
+			i++;
+			options.station = (0 == strcmp(argv[i], "station"));
+			if (!options.station && 0 != strcmp(argv[i], "unit"))
+			{
+				cout << "Bad role: " << argv[i] << endl;
+				PrintHelp();
+				return -1;
+			}
+		} else if (0 == strcmp(argv[i], "--mode") && i + 1 < argc)
+		{
+			i++;
+			options.routed = (0 == strcmp(argv[i], "routed"));
+			if (!options.routed && 0 != strcmp(argv[i], "flat"))
+			{
+				cout << "Bad mode: " << argv[i] << endl;
+				PrintHelp();
+				return -1;
+			}
+		} else if (0 == strcmp(argv[i], "--patients") && i + 1 < argc)
+		{
+			options.patients = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--devices") && i + 1 < argc)
+		{
+			options.devicesPerPatient = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--rate") && i + 1 < argc)
+		{
+			options.rate = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--group-size") && i + 1 < argc)
+		{
+			options.patientsPerGroup = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--groups") && i + 1 < argc)
+		{
+			options.groups = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			options.seconds = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	// The unit runs until it is stopped, and the station measures 20 s
+	if (options.seconds < 0)
+	{
+		options.seconds = options.station ? 20 : 0;
+	}
+
+	if (options.patients <= 0 || options.devicesPerPatient <= 0 ||
+		options.rate <= 0 || options.patientsPerGroup <= 0 ||
+		options.groups <= 0 || (options.station && options.seconds == 0))
+	{
+		cout << "Counts, rate and group size must be positive" << endl;
+		return -1;
+	}
+
+	try
+	{
+		if (options.station)
+		{
+			RunStation(options);
+		} else
+		{
+			RunUnit(options);
+		}
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --role <unit|station>" <<
+		"          Simulate the devices of the unit, or measure" <<
+		endl << "                                   " <<
+		"a station (default: unit)"
+		<< endl;
+	cout <<
+		"    --mode <flat|routed>" <<
+		"           Send and receive without or with patient" <<
+		endl << "                                   " <<
+		"routing, the same in both roles (default: routed)"
+		<< endl;
+	cout <<
+		"    --patients <n>" <<
+		"                 Patients in the unit (default: 48)"
+		<< endl;
+	cout <<
+		"    --devices <n>" <<
+		"                  Devices per patient (default: 4)"
+		<< endl;
+	cout <<
+		"    --rate <n>" <<
+		"                     Numerics per second of each metric" <<
+		endl << "                                   " <<
+		"of a device (default: 10)"
+		<< endl;
+	cout <<
+		"    --group-size <n>" <<
+		"               Patients per group (default: 1)"
+		<< endl;
+	cout <<
+		"    --groups <n>" <<
+		"                   Groups watched by the station (default: 4)"
+		<< endl;
+	cout <<
+		"    --seconds <n>" <<
+		"                  Duration of the measurement of a station" <<
+		endl << "                                   " <<
+		"(default: 20), or of a unit (default: until stopped)"
+		<< endl;
+}
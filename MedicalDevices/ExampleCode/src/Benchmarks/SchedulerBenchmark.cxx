@@ -0,0 +1,741 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataReader.h"
+#include "../CommonInfrastructure/DDSGenericDataWriter.h"
+#include "../CommonInfrastructure/DDSReaderScheduler.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/profiles.h"
+
+using namespace std;
+using namespace com::rti::medical::generated;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This benchmark compares two ways for one process to run --consumers
+// independent consumers, each following the numerics of one device through
+// its own DataReader of a ContentFilteredTopic:
+//
+//  - Threads: each consumer has its own thread, that waits for the data of
+//    its DataReader and takes it.
+//  - Scheduled readers: the consumers are shared between --threads threads,
+//    each running a DDSReaderScheduler, and each consumer asks its
+//    ScheduledReader for its next batch.
+//
+// Every --paced-every consumer is paced, like a display that refreshes at
+// 20 Hz: it takes a batch, and only asks for the next one 50 ms later.
+// While it waits, its ScheduledReader is detached from the WaitSet of the
+// scheduler, and it is attached again when the consumer asks, so the
+// benchmark runs the detach and attach of the scheduler all the time.
+//
+// One participant simulates one device per consumer, and sends their
+// numerics in turn, at --rate numerics per second in total.  The value of
+// each numeric is a sequence number, and the monotonic time each one was
+// written is kept, so every consumer knows the latency of each sample.
+//
+// For each way, the benchmark reports:
+//
+//  - Latency: from the write of a numeric to the time its consumer has it,
+//    for the consumers that ask right away and for the paced consumers.
+//    Only numerics written while measuring are counted.
+//  - Threads, memory and CPU: the threads that run the consumers, the
+//    growth of the resident memory of the process when they start, and
+//    the CPU time of the process while they run, including the simulated
+//    devices.
+//  - Foreign samples: samples a consumer got for another device, which
+//    must be zero.
+//
+// The scheduled readers also report the number of times paced consumers
+// were attached again.
+//
+// The devices use device IDs that start with "sched-bench-".
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+
+static const char *DEVICE_PREFIX = "sched-bench-";
+
+// The sequence numbers sent as values wrap at this count, which floats hold
+// exactly
+static const int SEND_SLOTS = 1 << 20;
+
+// Samples a consumer takes at a time
+static const DDS_Long MAX_BATCH = 32;
+
+// Time a paced consumer waits before it asks for its next batch
+static const int64_t PACE_NANOSECONDS = 50 * NANOSECONDS_PER_MILLISECOND;
+
+struct SchedulerOptions
+{
+	int consumers;
+	int threads;
+	int pacedEvery;
+	int rate;
+	int seconds;
+};
+
+// ----------------------------------------------------------------------------
+// State shared with the device and consumer threads
+struct SchedulerRun
+{
+	SchedulerRun() :
+		stopLoad(false),
+		stopConsumers(false),
+		measuring(false),
+		measureStart(0),
+		devices(0),
+		rate(0),
+		numericWriter(NULL)
+	{
+	}
+
+	volatile bool stopLoad;
+	volatile bool stopConsumers;
+	volatile bool measuring;
+
+	// Numerics written before this time are not measured
+	volatile int64_t measureStart;
+
+	int devices;
+	int rate;
+
+	GenericDataWriter<ice::Numeric> *numericWriter;
+
+	// Monotonic time each sequence number was written
+	std::vector<int64_t> sendTimes;
+};
+
+// Results of one way of running the consumers
+struct SchedulerResult
+{
+	SchedulerResult() :
+		threads(0),
+		memoryGrowth(0),
+		cpuTime(0),
+		elapsed(0),
+		batches(0),
+		attaches(0),
+		foreignSamples(0)
+	{
+	}
+
+	std::vector<int64_t> latencies;
+	std::vector<int64_t> pacedLatencies;
+	int threads;
+	int64_t memoryGrowth;
+	int64_t cpuTime;
+	int64_t elapsed;
+	int64_t batches;
+	int64_t attaches;
+	int64_t foreignSamples;
+};
+
+static void MakeDeviceId(int device, char *deviceId)
+{
+	sprintf(deviceId, "%s%04d", DEVICE_PREFIX, device);
+}
+
+// ----------------------------------------------------------------------------
+// Sends the numerics of every device in turn, every 10 ms, until stopped
+static void *DeviceThread(void *param)
+{
+	SchedulerRun *run = (SchedulerRun *)param;
+	DdsAutoType<ice::Numeric> numeric;
+	numeric.instance_id = 0;
+	strcpy(numeric.metric_id, "MDC_PULS_RATE");
+
+	int perTick = run->rate / 100;
+	if (perTick < 1)
+	{
+		perTick = 1;
+	}
+
+	DDS_Duration_t tick = {0, 10000000};
+	int device = 0;
+	int sequence = 0;
+	while (!run->stopLoad)
+	{
+		for (int i = 0; i < perTick; i++)
+		{
+			MakeDeviceId(device, numeric.unique_device_identifier);
+			device = (device + 1) % run->devices;
+
+			run->sendTimes[sequence] = OSGetMonotonicTime();
+			numeric.value = (float)sequence;
+			run->numericWriter->Write(numeric);
+			sequence = (sequence + 1) % SEND_SLOTS;
+		}
+		NDDSUtility::sleep(tick);
+	}
+	return NULL;
+}
+
+// ------------------------------------------------------------------------- //
+//
+// DeviceConsumer:
+// Follows the numerics of one device, either on its own thread, or as the
+// consumer of a ScheduledReader.
+//
+// ------------------------------------------------------------------------- //
+class DeviceConsumer
+{
+public:
+	// --- Constructor and destructor ---
+	DeviceConsumer(SchedulerRun *run, int device, bool paced,
+		GenericDataReader<ice::Numeric> *reader) :
+		_run(run),
+		_paced(paced),
+		_reader(reader),
+		_scheduled(NULL),
+		_resumeTime(0),
+		_batches(0),
+		_attaches(0),
+		_foreignSamples(0)
+	{
+		char deviceId[64];
+		MakeDeviceId(device, deviceId);
+		_deviceId = deviceId;
+	}
+
+	~DeviceConsumer()
+	{
+		delete _reader;
+	}
+
+	// --- Scheduled readers ---
+	// Starts to ask a ScheduledReader of the DataReader for batches.  This
+	// and the other scheduled methods are called from the thread of the
+	// scheduler.
+	void Start(ScheduledReader<ice::Numeric> *scheduled)
+	{
+		_scheduled = scheduled;
+		_scheduled->NextBatch(this, &DeviceConsumer::OnNumerics);
+	}
+
+	void OnNumerics(LoanedBatch<ice::Numeric> &batch)
+	{
+		Process(batch);
+		if (_paced)
+		{
+			// Not asking now detaches the ScheduledReader
+			_resumeTime = OSGetMonotonicTime() + PACE_NANOSECONDS;
+			return;
+		}
+		_scheduled->NextBatch(this, &DeviceConsumer::OnNumerics);
+	}
+
+	// Asks for the next batch once a paced consumer has waited its time
+	void ResumeIfDue(int64_t now)
+	{
+		if (_scheduled->IsWaiting() || now < _resumeTime)
+		{
+			return;
+		}
+		_attaches++;
+		_scheduled->NextBatch(this, &DeviceConsumer::OnNumerics);
+	}
+
+	void Stop()
+	{
+		_scheduled->Cancel();
+		_scheduled = NULL;
+	}
+
+	// --- Threads ---
+	// Waits for data and takes it until the consumers are stopped
+	void RunThread()
+	{
+		DDS_Duration_t waitTime = {0, 100000000};
+		LoanedBatch<ice::Numeric> batch;
+		while (!_run->stopConsumers)
+		{
+			if (!_reader->WaitForData(waitTime) || !_reader->Take(batch))
+			{
+				continue;
+			}
+			Process(batch);
+			batch.Return();
+			if (_paced)
+			{
+				OSSleep(PACE_NANOSECONDS);
+			}
+		}
+	}
+
+	// --- Results ---
+	// Adds the results of the consumer to the result, and starts again
+	void CollectResult(SchedulerResult &result)
+	{
+		std::vector<int64_t> &latencies = _paced ?
+			result.pacedLatencies : result.latencies;
+		latencies.insert(latencies.end(), _latencies.begin(),
+			_latencies.end());
+		result.batches += _batches;
+		result.attaches += _attaches;
+		result.foreignSamples += _foreignSamples;
+
+		_latencies.clear();
+		_batches = 0;
+		_attaches = 0;
+		_foreignSamples = 0;
+	}
+
+	GenericDataReader<ice::Numeric> *GetReader()
+	{
+		return _reader;
+	}
+
+private:
+	// --- Private methods ---
+	void Process(LoanedBatch<ice::Numeric> &batch)
+	{
+		int64_t now = OSGetMonotonicTime();
+		_batches++;
+		for (LoanedBatch<ice::Numeric>::ValidIterator it = batch.begin();
+			it != batch.end(); ++it)
+		{
+			if (_deviceId != it->unique_device_identifier)
+			{
+				_foreignSamples++;
+				continue;
+			}
+
+			int sequence = (int)it->value;
+			if (!_run->measuring || sequence < 0 || sequence >= SEND_SLOTS)
+			{
+				continue;
+			}
+			int64_t sendTime = _run->sendTimes[sequence];
+			if (sendTime >= _run->measureStart)
+			{
+				_latencies.push_back(now - sendTime);
+			}
+		}
+	}
+
+	// --- Private members ---
+	SchedulerRun *_run;
+	std::string _deviceId;
+	bool _paced;
+	GenericDataReader<ice::Numeric> *_reader;
+	ScheduledReader<ice::Numeric> *_scheduled;
+
+	// When a paced consumer asks for its next batch
+	int64_t _resumeTime;
+
+	std::vector<int64_t> _latencies;
+	int64_t _batches;
+	int64_t _attaches;
+	int64_t _foreignSamples;
+};
+
+// ----------------------------------------------------------------------------
+// The consumers of one scheduler thread
+struct SchedulerThreadState
+{
+	SchedulerThreadState() :
+		run(NULL)
+	{
+	}
+
+	SchedulerRun *run;
+	std::vector<DeviceConsumer *> consumers;
+};
+
+// ----------------------------------------------------------------------------
+// Runs a scheduler for its consumers until they are stopped.  The
+// scheduler, the ScheduledReaders and their consumers are only used from
+// this thread.
+static void *SchedulerThread(void *param)
+{
+	SchedulerThreadState *state = (SchedulerThreadState *)param;
+	std::vector<DeviceConsumer *> &consumers = state->consumers;
+
+	try
+	{
+		DDSReaderScheduler scheduler;
+		std::vector<ScheduledReader<ice::Numeric> *> readers;
+		for (size_t i = 0; i < consumers.size(); i++)
+		{
+			readers.push_back(new ScheduledReader<ice::Numeric>(&scheduler,
+				consumers[i]->GetReader()->GetDataReader(), MAX_BATCH));
+			consumers[i]->Start(readers.back());
+		}
+
+		// Wakes up at least every 10 ms to ask for the next batches of the
+		// paced consumers
+		DDS_Duration_t timeout = {0, 10000000};
+		while (!state->run->stopConsumers)
+		{
+			scheduler.RunOnce(timeout);
+			int64_t now = OSGetMonotonicTime();
+			for (size_t i = 0; i < consumers.size(); i++)
+			{
+				consumers[i]->ResumeIfDue(now);
+			}
+		}
+
+		for (size_t i = 0; i < consumers.size(); i++)
+		{
+			consumers[i]->Stop();
+			delete readers[i];
+		}
+	}
+	catch (string message)
+	{
+		cout << "Scheduler exception: " << message << endl;
+	}
+	return NULL;
+}
+
+static void *ConsumerThread(void *param)
+{
+	DeviceConsumer *consumer = (DeviceConsumer *)param;
+	try
+	{
+		consumer->RunThread();
+	}
+	catch (string message)
+	{
+		cout << "Consumer exception: " << message << endl;
+	}
+	return NULL;
+}
+
+static DDS::DomainParticipant *CreateParticipant(DDSCommunicator &communicator)
+{
+	std::vector<std::string> xmlFiles;
+	xmlFiles.push_back("file://../../../src/Config/qos_profiles.xml");
+	DDS::DomainParticipant *participant = communicator.CreateParticipant(5,
+		xmlFiles, ICE_QOS_LIBRARY, QOS_PROFILE_PARTICIPANT);
+	if (participant == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+	return participant;
+}
+
+// Waits until the numerics DataWriter has matched count DataReaders
+static void WaitForMatches(DDS::DataWriter *writer, int count)
+{
+	DDS_Duration_t pollPeriod = {0, 100000000};
+	for (int i = 0; i < 200; i++)
+	{
+		DDS_PublicationMatchedStatus status;
+		writer->get_publication_matched_status(status);
+		if (status.current_count >= count)
+		{
+			return;
+		}
+		NDDSUtility::sleep(pollPeriod);
+	}
+	std::stringstream errss;
+	errss << "The consumers were not discovered";
+	throw errss.str();
+}
+
+// ----------------------------------------------------------------------------
+// Creates a consumer for each device, with a DataReader of a
+// ContentFilteredTopic for the numerics of the device only
+static void CreateConsumers(SchedulerRun &run, const SchedulerOptions &options,
+	DDSCommunicator &communicator, std::vector<DeviceConsumer *> &consumers)
+{
+	DDS::DomainParticipant *participant = CreateParticipant(communicator);
+	DDS::Topic *topic =
+		communicator.CreateTopic<ice::Numeric>(ice::NumericTopic);
+	DDS::Subscriber *sub = communicator.CreateSubscriber();
+	if (sub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Subscriber";
+		throw errss.str();
+	}
+
+	DDS_StringSeq noParameters;
+	for (int i = 0; i < options.consumers; i++)
+	{
+		char deviceId[64];
+		MakeDeviceId(i, deviceId);
+		std::stringstream name;
+		name << "SchedulerBenchmark" << i;
+		std::stringstream expression;
+		expression << "unique_device_identifier = '" << deviceId << "'";
+
+		DDS::ContentFilteredTopic *filtered =
+			participant->create_contentfilteredtopic(name.str().c_str(),
+				topic, expression.str().c_str(), noParameters);
+		if (filtered == NULL)
+		{
+			std::stringstream errss;
+			errss << "Failed to create ContentFilteredTopic "
+				<< name.str();
+			throw errss.str();
+		}
+
+		bool paced = options.pacedEvery > 0 &&
+			i % options.pacedEvery == options.pacedEvery - 1;
+		consumers.push_back(new DeviceConsumer(&run, i, paced,
+			new GenericDataReader<ice::Numeric>(sub, filtered,
+				ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING, MAX_BATCH)));
+	}
+	WaitForMatches(run.numericWriter->GetDataWriter(), options.consumers);
+}
+
+// ----------------------------------------------------------------------------
+// Lets the consumers run for the warmup, then measures them for the length
+// of the benchmark, and stops them
+static void MeasureConsumers(SchedulerRun &run,
+	const SchedulerOptions &options, std::vector<OSThread *> &threads,
+	std::vector<DeviceConsumer *> &consumers, int64_t memoryBefore,
+	SchedulerResult &result)
+{
+	result.threads = (int)threads.size();
+	result.memoryGrowth = OSGetProcessResidentMemory() - memoryBefore;
+
+	DDS_Duration_t warmup = {2, 0};
+	NDDSUtility::sleep(warmup);
+	for (size_t i = 0; i < consumers.size(); i++)
+	{
+		// Drops the counts of the warmup
+		SchedulerResult warmupResult;
+		consumers[i]->CollectResult(warmupResult);
+	}
+
+	int64_t cpuBefore = OSGetProcessCpuTime();
+	int64_t start = OSGetMonotonicTime();
+	run.measureStart = start;
+	run.measuring = true;
+	DDS_Duration_t length = {options.seconds, 0};
+	NDDSUtility::sleep(length);
+	run.measuring = false;
+	result.elapsed = OSGetMonotonicTime() - start;
+	result.cpuTime = OSGetProcessCpuTime() - cpuBefore;
+
+	run.stopConsumers = true;
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i]->Join();
+		delete threads[i];
+	}
+	threads.clear();
+	run.stopConsumers = false;
+
+	for (size_t i = 0; i < consumers.size(); i++)
+	{
+		consumers[i]->CollectResult(result);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Each consumer on its own thread
+static void RunThreads(SchedulerRun &run, const SchedulerOptions &options,
+	std::vector<DeviceConsumer *> &consumers, SchedulerResult &result)
+{
+	int64_t memoryBefore = OSGetProcessResidentMemory();
+
+	std::vector<OSThread *> threads;
+	for (size_t i = 0; i < consumers.size(); i++)
+	{
+		threads.push_back(new OSThread(ConsumerThread, consumers[i]));
+		threads.back()->Run();
+	}
+
+	MeasureConsumers(run, options, threads, consumers, memoryBefore, result);
+}
+
+// ----------------------------------------------------------------------------
+// The consumers shared between a few scheduler threads
+static void RunSchedulers(SchedulerRun &run, const SchedulerOptions &options,
+	std::vector<DeviceConsumer *> &consumers, SchedulerResult &result)
+{
+	int64_t memoryBefore = OSGetProcessResidentMemory();
+
+	std::vector<SchedulerThreadState> states(options.threads);
+	for (size_t i = 0; i < consumers.size(); i++)
+	{
+		SchedulerThreadState &state = states[i % options.threads];
+		state.run = &run;
+		state.consumers.push_back(consumers[i]);
+	}
+
+	std::vector<OSThread *> threads;
+	for (int i = 0; i < options.threads; i++)
+	{
+		threads.push_back(new OSThread(SchedulerThread, &states[i]));
+		threads.back()->Run();
+	}
+
+	MeasureConsumers(run, options, threads, consumers, memoryBefore, result);
+}
+
+static int64_t Percentile(const std::vector<int64_t> &sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	size_t index = (size_t)(p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+static void PrintLatencies(const char *name, std::vector<int64_t> &latencies)
+{
+	std::sort(latencies.begin(), latencies.end());
+	cout << "    " << name << latencies.size() << " samples, latency 50% "
+		<< Percentile(latencies, 0.5) / 1e3 << " us, 99% "
+		<< Percentile(latencies, 0.99) / 1e3 << " us, max "
+		<< Percentile(latencies, 1.0) / 1e3 << " us" << endl;
+}
+
+static void PrintResult(const char *name, SchedulerResult &result)
+{
+	cout << name << result.threads << " threads, memory growth "
+		<< result.memoryGrowth / 1024 << " KB, CPU "
+		<< 100.0 * result.cpuTime / result.elapsed << "%, "
+		<< result.batches << " batches, " << result.attaches
+		<< " attached again, " << result.foreignSamples
+		<< " foreign samples" << endl;
+	PrintLatencies("asking: ", result.latencies);
+	PrintLatencies("paced:  ", result.pacedLatencies);
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --consumers <n>" <<
+		"                Consumers and devices (default: 400)" << endl;
+	cout << "    --threads <n>" <<
+		"                  Scheduler threads (default: 2)" << endl;
+	cout << "    --paced-every <n>" <<
+		"              Every nth consumer is paced, 0 for none " <<
+		"(default: 4)" << endl;
+	cout << "    --rate <n>" <<
+		"                     Numerics per second (default: 4000)" << endl;
+	cout << "    --seconds <n>" <<
+		"                  Measured time of each way (default: 10)"
+		<< endl;
+}
+
+int main(int argc, char *argv[])
+{
+	SchedulerOptions options;
+	options.consumers = 400;
+	options.threads = 2;
+	options.pacedEvery = 4;
+	options.rate = 4000;
+	options.seconds = 10;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--consumers") && i + 1 < argc)
+		{
+			options.consumers = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--threads") && i + 1 < argc)
+		{
+			options.threads = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--paced-every") && i + 1 < argc)
+		{
+			options.pacedEvery = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--rate") && i + 1 < argc)
+		{
+			options.rate = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			options.seconds = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (options.consumers <= 0 || options.threads <= 0 ||
+		options.pacedEvery < 0 || options.rate <= 0 || options.seconds <= 0)
+	{
+		cout << "The consumers, threads, rate and seconds must be positive, "
+			<< "and the paced consumers must not be negative" << endl;
+		return -1;
+	}
+
+	try
+	{
+		SchedulerRun run;
+		run.devices = options.consumers;
+		run.rate = options.rate;
+		run.sendTimes.resize(SEND_SLOTS, 0);
+
+		DDSCommunicator devices;
+		CreateParticipant(devices);
+		run.numericWriter = new GenericDataWriter<ice::Numeric>(&devices,
+			ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+
+		// The consumers keep their DataReaders for both ways, so both are
+		// measured with the same entities
+		DDSCommunicator consumerCommunicator;
+		std::vector<DeviceConsumer *> consumers;
+		CreateConsumers(run, options, consumerCommunicator, consumers);
+
+		cout << options.consumers << " consumers, " << options.threads
+			<< " scheduler threads, " << options.rate << " numerics/s"
+			<< endl;
+
+		OSThread deviceThread(DeviceThread, &run);
+		deviceThread.Run();
+
+		SchedulerResult threadResult;
+		RunThreads(run, options, consumers, threadResult);
+		SchedulerResult schedulerResult;
+		RunSchedulers(run, options, consumers, schedulerResult);
+
+		run.stopLoad = true;
+		deviceThread.Join();
+
+		PrintResult("Threads:           ", threadResult);
+		PrintResult("Scheduled readers: ", schedulerResult);
+
+		for (size_t i = 0; i < consumers.size(); i++)
+		{
+			delete consumers[i];
+		}
+		delete run.numericWriter;
+
+		if (threadResult.foreignSamples != 0 ||
+			schedulerResult.foreignSamples != 0)
+		{
+			cout << "Consumers got samples of other devices" << endl;
+			return -1;
+		}
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,600 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataReader.h"
+#include "../CommonInfrastructure/DDSGenericDataWriter.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/profiles.h"
+#include "../Generated/trend.h"
+#include "../SnapshotService/DDSSnapshotClient.h"
+#include "../SnapshotService/DDSSnapshotServiceInterface.h"
+#include "../SnapshotService/SnapshotStore.h"
+
+using namespace std;
+using namespace com::rti::medical::generated;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures the time to full display of a station that is
+// restarted: the time from its start until it shows every stream of every
+// device, with and without the snapshot service.
+//
+// One participant simulates the devices.  Each device sends three numerics
+// every second, a waveform frame every 250 ms, and a blood pressure every
+// --slow-seconds, like a non-invasive blood pressure cuff.  A snapshot
+// service runs in the same process, with its own participant.  After a
+// warmup, so the service has seen every stream, the benchmark starts a
+// station twice, each time with a new participant:
+//
+//  - Live only: the station reads the live data, as stations do today.  A
+//    stream is shown when its device next sends it.
+//  - Snapshot: the station also asks the snapshot service for the latest
+//    data of every stream as soon as the service is discovered, and shows
+//    each stream from the snapshot or the live data, whichever comes first.
+//
+// For each station, it reports the time to show half, 90% and all of the
+// streams, from the creation of the participant, so both include discovery.
+// The snapshot station also reports the time to discover the service, and
+// the time from the request to the last reply.
+//
+// The devices use the ice topics with device IDs that start with
+// "snapshot-bench-", and only those streams are counted.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+static const char *const FAST_METRIC_IDS[] = {
+	"MDC_PULS_RATE", "MDC_PULS_OXIM_SAT_O2", "MDC_RESP_RATE"
+};
+static const int FAST_METRICS = 3;
+static const char *SLOW_METRIC_ID = "MDC_PRESS_BLD_NONINV_MEAN";
+static const char *WAVEFORM_METRIC_ID = "MDC_ECG_LEAD_II";
+
+// A frame of 125 values at 500 Hz every 250 ms
+static const int FRAME_VALUES = 125;
+static const int MILLISECONDS_PER_SAMPLE = 2;
+static const int64_t FRAME_PERIOD = 250 * NANOSECONDS_PER_MILLISECOND;
+
+struct SnapshotOptions
+{
+	int devices;
+	int slowSeconds;
+	int warmupSeconds;
+	int timeoutSeconds;
+	int windowMs;
+};
+
+// A simulated stream, and the monotonic time of its next sample
+struct SimulatedStream
+{
+	std::string deviceId;
+	const char *metricId;
+	bool waveform;
+	int64_t period;
+	int64_t next;
+};
+
+// ----------------------------------------------------------------------------
+// State shared with the device and service threads
+struct SnapshotRun
+{
+	SnapshotRun() :
+		stop(false),
+		numericWriter(NULL),
+		frameWriter(NULL),
+		service(NULL),
+		store(NULL)
+	{
+	}
+
+	volatile bool stop;
+	std::vector<SimulatedStream> streams;
+	GenericDataWriter<ice::Numeric> *numericWriter;
+	GenericDataWriter<ice::SampleArray> *frameWriter;
+	DDSSnapshotServiceInterface *service;
+	SnapshotStore *store;
+};
+
+// Results of one station start.  Times are from the start of the station.
+struct StationResult
+{
+	StationResult() :
+		discoveryTime(0),
+		snapshotTime(0),
+		batches(0),
+		fromSnapshot(0)
+	{
+	}
+
+	std::vector<int64_t> showTimes;
+	int64_t discoveryTime;
+	int64_t snapshotTime;
+	unsigned int batches;
+	unsigned int fromSnapshot;
+};
+
+// Built the same way as the stream keys of the snapshot store and client
+static std::string MakeStreamKey(const char *deviceId, const char *metricId,
+	int instanceId)
+{
+	char instance[16];
+	sprintf(instance, "%d", instanceId);
+	std::string key(deviceId);
+	key.append("|").append(metricId).append("|").append(instance);
+	return key;
+}
+
+// ----------------------------------------------------------------------------
+// Records when each benchmark stream is first shown by a station, from the
+// live data or from the snapshot
+class StationDisplay : public SnapshotListener
+{
+public:
+	StationDisplay(const std::vector<SimulatedStream> &streams,
+		int64_t start) :
+		_start(start),
+		_remaining((unsigned int)streams.size()),
+		fromSnapshot(0)
+	{
+		for (size_t i = 0; i < streams.size(); i++)
+		{
+			_showTimes[MakeStreamKey(streams[i].deviceId.c_str(),
+				streams[i].metricId, 0)] = 0;
+		}
+	}
+
+	void Show(const char *deviceId, const char *metricId, int instanceId,
+		bool snapshot)
+	{
+		std::map<std::string, int64_t>::iterator it = _showTimes.find(
+			MakeStreamKey(deviceId, metricId, instanceId));
+		if (it == _showTimes.end() || it->second != 0)
+		{
+			return;
+		}
+		it->second = OSGetMonotonicTime() - _start;
+		_remaining--;
+		if (snapshot)
+		{
+			fromSnapshot++;
+		}
+	}
+
+	virtual void SnapshotNumericReceived(const SnapshotNumeric &numeric)
+	{
+		Show(numeric.device_id, numeric.metric_id, numeric.instance_id,
+			true);
+	}
+
+	virtual void SnapshotWaveformReceived(const SnapshotWaveform &waveform)
+	{
+		if (waveform.values.length() > 0)
+		{
+			Show(waveform.device_id, waveform.metric_id,
+				waveform.instance_id, true);
+		}
+	}
+
+	bool IsComplete() const
+	{
+		return _remaining == 0;
+	}
+
+	// The show times of the streams that were shown, sorted
+	void GetShowTimes(std::vector<int64_t> &times) const
+	{
+		for (std::map<std::string, int64_t>::const_iterator it =
+			_showTimes.begin(); it != _showTimes.end(); ++it)
+		{
+			if (it->second != 0)
+			{
+				times.push_back(it->second);
+			}
+		}
+		std::sort(times.begin(), times.end());
+	}
+
+private:
+	int64_t _start;
+	std::map<std::string, int64_t> _showTimes;
+	unsigned int _remaining;
+
+public:
+	unsigned int fromSnapshot;
+};
+
+// ----------------------------------------------------------------------------
+// Streams of the simulated devices.  The first samples are spread over the
+// period of each stream, so the devices do not all send at once.
+static void CreateStreams(const SnapshotOptions &options, int64_t start,
+	std::vector<SimulatedStream> &streams)
+{
+	srand(42);
+	for (int d = 0; d < options.devices; d++)
+	{
+		char deviceId[32];
+		sprintf(deviceId, "snapshot-bench-%04d", d);
+
+		SimulatedStream stream;
+		stream.deviceId = deviceId;
+		stream.waveform = false;
+		for (int m = 0; m < FAST_METRICS; m++)
+		{
+			stream.metricId = FAST_METRIC_IDS[m];
+			stream.period = NANOSECONDS_PER_SECOND;
+			streams.push_back(stream);
+		}
+
+		stream.metricId = SLOW_METRIC_ID;
+		stream.period = options.slowSeconds * NANOSECONDS_PER_SECOND;
+		streams.push_back(stream);
+
+		stream.metricId = WAVEFORM_METRIC_ID;
+		stream.waveform = true;
+		stream.period = FRAME_PERIOD;
+		streams.push_back(stream);
+	}
+
+	for (size_t i = 0; i < streams.size(); i++)
+	{
+		int64_t periodMs = streams[i].period / NANOSECONDS_PER_MILLISECOND;
+		streams[i].next = start +
+			(int64_t)(rand() % periodMs) * NANOSECONDS_PER_MILLISECOND;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Sends the samples of the streams that are due, every 10 ms, until stopped
+static void *DeviceThread(void *param)
+{
+	SnapshotRun *run = (SnapshotRun *)param;
+	DdsAutoType<ice::Numeric> numeric;
+	DdsAutoType<ice::SampleArray> frame;
+	frame.values.ensure_length(FRAME_VALUES, FRAME_VALUES);
+	frame.millisecondsPerSample = MILLISECONDS_PER_SAMPLE;
+	numeric.instance_id = 0;
+	frame.instance_id = 0;
+
+	DDS_Duration_t tick = {0, 10000000};
+	int phase = 0;
+	while (!run->stop)
+	{
+		int64_t now = OSGetMonotonicTime();
+		for (size_t i = 0; i < run->streams.size(); i++)
+		{
+			SimulatedStream &stream = run->streams[i];
+			if (stream.next > now)
+			{
+				continue;
+			}
+			stream.next += stream.period;
+
+			if (stream.waveform)
+			{
+				strcpy(frame.unique_device_identifier,
+					stream.deviceId.c_str());
+				strcpy(frame.metric_id, stream.metricId);
+				for (int v = 0; v < FRAME_VALUES; v++)
+				{
+					frame.values[v] = (float)((phase + v) % 250);
+				}
+				run->frameWriter->Write(frame);
+			} else
+			{
+				strcpy(numeric.unique_device_identifier,
+					stream.deviceId.c_str());
+				strcpy(numeric.metric_id, stream.metricId);
+				numeric.value = (float)(60 + i % 40);
+				run->numericWriter->Write(numeric);
+			}
+		}
+		phase = (phase + FRAME_VALUES) % 250;
+		NDDSUtility::sleep(tick);
+	}
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Runs the snapshot service until stopped
+static void *ServiceThread(void *param)
+{
+	SnapshotRun *run = (SnapshotRun *)param;
+	DDS_Duration_t waitTime = {0, 100000000};
+	try
+	{
+		while (!run->stop)
+		{
+			run->service->ProcessAvailableData(*run->store, waitTime);
+		}
+	}
+	catch (string message)
+	{
+		cout << "Snapshot service exception: " << message << endl;
+	}
+	return NULL;
+}
+
+static DDS::DomainParticipant *CreateParticipant(DDSCommunicator &communicator)
+{
+	std::vector<std::string> xmlFiles;
+	xmlFiles.push_back("file://../../../src/Config/qos_profiles.xml");
+	DDS::DomainParticipant *participant = communicator.CreateParticipant(5,
+		xmlFiles, ICE_QOS_LIBRARY, QOS_PROFILE_PARTICIPANT);
+	if (participant == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+	return participant;
+}
+
+static int64_t Percentile(const std::vector<int64_t> &sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	size_t index = (size_t)(p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+// Takes the live samples of a reader, and shows their streams
+template <typename T>
+static void ShowLiveData(GenericDataReader<T> &reader,
+	StationDisplay &display, DDSSnapshotClient *client)
+{
+	LoanedBatch<T> batch;
+	while (reader.Take(batch))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			if (!batch.IsValid(i))
+			{
+				continue;
+			}
+			const T &sample = batch.GetData(i);
+			if (client != NULL)
+			{
+				const DDS_Time_t &time = batch.GetInfo(i).source_timestamp;
+				client->OnLiveSample(sample.unique_device_identifier,
+					sample.metric_id, sample.instance_id,
+					(int64_t)time.sec * NANOSECONDS_PER_SECOND +
+						time.nanosec);
+			}
+			display.Show(sample.unique_device_identifier, sample.metric_id,
+				sample.instance_id, false);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Starts a station with a new participant, and waits until it shows every
+// stream or the timeout passes
+static void RunStation(bool useSnapshot, const SnapshotOptions &options,
+	const std::vector<SimulatedStream> &streams, StationResult &result)
+{
+	int64_t start = OSGetMonotonicTime();
+	int64_t deadline = start +
+		(int64_t)options.timeoutSeconds * NANOSECONDS_PER_SECOND;
+	StationDisplay display(streams, start);
+
+	DDSCommunicator station;
+	CreateParticipant(station);
+	GenericDataReader<ice::Numeric> numericReader(&station,
+		ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+	GenericDataReader<ice::SampleArray> frameReader(&station,
+		ice::SampleArrayTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+
+	DDS::WaitSet waitSet;
+	waitSet.attach_condition(numericReader.GetCondition());
+	waitSet.attach_condition(frameReader.GetCondition());
+
+	// The live DataReaders exist before the request is sent, so no sample
+	// falls between the snapshot and the live data
+	DDSSnapshotClient *client = NULL;
+	int64_t requestTime = 0;
+	if (useSnapshot)
+	{
+		client = new DDSSnapshotClient(&station, "snapshot-bench-station");
+		DDS_Duration_t discoveryTimeout = {10, 0};
+		if (!client->WaitForService(discoveryTimeout))
+		{
+			delete client;
+			std::stringstream errss;
+			errss << "The snapshot service was not discovered";
+			throw errss.str();
+		}
+		requestTime = OSGetMonotonicTime();
+		result.discoveryTime = requestTime - start;
+		client->Request(SNAPSHOT_ALL_PATIENTS, options.windowMs);
+		waitSet.attach_condition(client->GetCondition());
+	}
+
+	DDS_Duration_t waitTime = {0, 100000000};
+	DDS::ConditionSeq activeConditions;
+	while (!display.IsComplete() && OSGetMonotonicTime() < deadline)
+	{
+		waitSet.wait(activeConditions, waitTime);
+
+		ShowLiveData<ice::Numeric>(numericReader, display, client);
+		ShowLiveData<ice::SampleArray>(frameReader, display, client);
+		if (client != NULL && client->IsPending() &&
+			client->ProcessReplies(display))
+		{
+			result.snapshotTime = OSGetMonotonicTime() - requestTime;
+			result.batches = client->GetBatchCount();
+		}
+	}
+
+	waitSet.detach_condition(numericReader.GetCondition());
+	waitSet.detach_condition(frameReader.GetCondition());
+	if (client != NULL)
+	{
+		waitSet.detach_condition(client->GetCondition());
+		delete client;
+	}
+
+	display.GetShowTimes(result.showTimes);
+	result.fromSnapshot = display.fromSnapshot;
+}
+
+static void PrintResult(const char *name, const StationResult &result,
+	size_t streamCount)
+{
+	cout << name << result.showTimes.size() << "/" << streamCount
+		<< " streams shown, 50% in "
+		<< Percentile(result.showTimes, 0.5) / 1e6 << " ms, 90% in "
+		<< Percentile(result.showTimes, 0.9) / 1e6 << " ms, "
+		<< (result.showTimes.size() == streamCount ?
+			"full display in " : "timed out, last shown in ")
+		<< Percentile(result.showTimes, 1.0) / 1e6 << " ms" << endl;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --devices <n>" <<
+		"                  Simulated devices (default: 40)" << endl;
+	cout << "    --slow-seconds <n>" <<
+		"             Blood pressure period (default: 30)" << endl;
+	cout << "    --warmup-seconds <n>" <<
+		"           Time before the stations start (default:" << endl <<
+		"                                   slow period + 2)" << endl;
+	cout << "    --timeout-seconds <n>" <<
+		"          Longest wait for a full display (default:" << endl <<
+		"                                   2 slow periods)" << endl;
+	cout << "    --window-ms <n>" <<
+		"                Waveform window requested (default: 6000)"
+		<< endl;
+}
+
+int main(int argc, char *argv[])
+{
+	SnapshotOptions options;
+	options.devices = 40;
+	options.slowSeconds = 30;
+	options.warmupSeconds = 0;
+	options.timeoutSeconds = 0;
+	options.windowMs = 6000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--devices") && i + 1 < argc)
+		{
+			options.devices = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--slow-seconds") && i + 1 < argc)
+		{
+			options.slowSeconds = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--warmup-seconds") && i + 1 < argc)
+		{
+			options.warmupSeconds = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--timeout-seconds") &&
+			i + 1 < argc)
+		{
+			options.timeoutSeconds = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--window-ms") && i + 1 < argc)
+		{
+			options.windowMs = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (options.devices <= 0 || options.slowSeconds <= 0)
+	{
+		cout << "The devices and slow period must be positive" << endl;
+		return -1;
+	}
+	if (options.warmupSeconds <= 0)
+	{
+		options.warmupSeconds = options.slowSeconds + 2;
+	}
+	if (options.timeoutSeconds <= 0)
+	{
+		options.timeoutSeconds = 2 * options.slowSeconds;
+	}
+
+	try
+	{
+		SnapshotRun run;
+		CreateStreams(options, OSGetMonotonicTime(), run.streams);
+
+		DDSCommunicator devices;
+		CreateParticipant(devices);
+		run.numericWriter = new GenericDataWriter<ice::Numeric>(&devices,
+			ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+		run.frameWriter = new GenericDataWriter<ice::SampleArray>(&devices,
+			ice::SampleArrayTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+
+		SnapshotStore store;
+		run.store = &store;
+		run.service = new DDSSnapshotServiceInterface(true);
+
+		OSThread deviceThread(DeviceThread, &run);
+		OSThread serviceThread(ServiceThread, &run);
+		deviceThread.Run();
+		serviceThread.Run();
+
+		cout << run.streams.size() << " streams of " << options.devices
+			<< " devices, warming up for " << options.warmupSeconds
+			<< " s" << endl;
+		DDS_Duration_t warmup = {options.warmupSeconds, 0};
+		NDDSUtility::sleep(warmup);
+
+		StationResult live;
+		RunStation(false, options, run.streams, live);
+		PrintResult("Live only: ", live, run.streams.size());
+
+		StationResult snapshot;
+		RunStation(true, options, run.streams, snapshot);
+		PrintResult("Snapshot:  ", snapshot, run.streams.size());
+		cout << "           service discovered in "
+			<< snapshot.discoveryTime / 1e6 << " ms, "
+			<< snapshot.batches << " replies received "
+			<< snapshot.snapshotTime / 1e6 << " ms after the request, "
+			<< snapshot.fromSnapshot << " streams shown from the snapshot"
+			<< endl;
+
+		run.stop = true;
+		deviceThread.Join();
+		serviceThread.Join();
+
+		delete run.service;
+		delete run.frameWriter;
+		delete run.numericWriter;
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
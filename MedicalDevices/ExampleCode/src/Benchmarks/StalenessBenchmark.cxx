@@ -0,0 +1,431 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../CommonInfrastructure/StalenessMonitor.h"
+#include "ReplayRecording.h"
+
+using namespace std;
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures the StalenessMonitor used by the recorder with a
+// large number of simulated streams.  Time is simulated, so the run takes
+// far less than the time it simulates, and the detection latency does not
+// depend on the speed of the machine.  Every stream sends on a fixed
+// period: a quarter of them are waveforms with 250 ms frames, and the others
+// are numerics sent every second or every five seconds.  Part of the
+// streams stop sending halfway through the run.  It reports:
+//
+//  - The cost of one sample, which finds the stream and reschedules its
+//    timer, and the cost of rescheduling a timer alone.
+//  - The cost of a Check(), on average and at worst, compared with a scan
+//    of every stream on each check.
+//  - The detection latency of the stopped streams, beyond their timeout,
+//    and the streams reported stale that had not stopped.
+//  - The memory used per stream.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+
+// Periods of the simulated streams, and the share of streams of each
+static const int64_t STREAM_PERIODS_MS[] = {250, 1000, 1000, 5000};
+static const unsigned int STREAM_KINDS = 4;
+
+static const char *const METRIC_IDS[] = {
+	"MDC_ECG_LEAD_II", "MDC_PULS_OXIM_SAT_O2", "MDC_PULS_RATE",
+	"MDC_PRESS_BLD_ART_MEAN"
+};
+
+// A simulated stream.  The instance ID of a stream is its index.
+struct SimulatedStream
+{
+	std::string deviceId;
+	const char *metricId;
+	bool waveform;
+	int64_t period;
+	int64_t offset;
+	bool stopped;
+
+	// Simulated time of the last sample, and when it was reported stale
+	int64_t lastSampleTime;
+	int64_t staleTime;
+};
+
+// Records when each stream is reported stale
+class BenchmarkListener : public StalenessListener
+{
+public:
+	BenchmarkListener(std::vector<SimulatedStream> &streams) :
+		_streams(streams),
+		now(0),
+		staleEvents(0),
+		recoveredEvents(0),
+		forgottenEvents(0)
+	{
+	}
+
+	virtual void StreamStale(const StreamStatus &stream)
+	{
+		SimulatedStream &simulated = _streams[stream.instanceId];
+		if (simulated.staleTime == 0)
+		{
+			simulated.staleTime = now;
+		}
+		staleEvents++;
+	}
+
+	virtual void StreamRecovered(const StreamStatus &stream)
+	{
+		recoveredEvents++;
+	}
+
+	virtual void StreamForgotten(const StreamStatus &stream)
+	{
+		forgottenEvents++;
+	}
+
+private:
+	std::vector<SimulatedStream> &_streams;
+
+public:
+	int64_t now;
+	uint64_t staleEvents;
+	uint64_t recoveredEvents;
+	uint64_t forgottenEvents;
+};
+
+// ------------------------------------------------------------------------- //
+// The streams are spread over the devices, eight streams per device, and
+// their first samples are spread over their period
+static void CreateStreams(unsigned int count, double stoppedShare,
+	std::vector<SimulatedStream> &streams)
+{
+	streams.resize(count);
+	srand(42);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		SimulatedStream &stream = streams[i];
+		char deviceId[32];
+		sprintf(deviceId, "bench-device-%06u", i / 8);
+		unsigned int kind = i % STREAM_KINDS;
+		stream.deviceId = deviceId;
+		stream.metricId = METRIC_IDS[kind];
+		stream.waveform = kind == 0;
+		stream.period = STREAM_PERIODS_MS[kind] * NANOSECONDS_PER_MILLISECOND;
+		stream.offset = (int64_t)(rand() % STREAM_PERIODS_MS[kind]) *
+			NANOSECONDS_PER_MILLISECOND;
+		stream.stopped = (double)rand() / RAND_MAX < stoppedShare;
+		stream.lastSampleTime = 0;
+		stream.staleTime = 0;
+	}
+}
+
+// Same work as a monitor without timers would do on each check: look at
+// every stream, and compare its last sample time with its timeout
+static unsigned int ScanStreams(const std::vector<SimulatedStream> &streams,
+	int64_t now, double staleFactor)
+{
+	unsigned int stale = 0;
+	for (size_t i = 0; i < streams.size(); i++)
+	{
+		const SimulatedStream &stream = streams[i];
+		if (stream.lastSampleTime != 0 && now - stream.lastSampleTime >
+			(int64_t)(staleFactor * (double)stream.period))
+		{
+			stale++;
+		}
+	}
+	return stale;
+}
+
+// ------------------------------------------------------------------------- //
+// Reschedules one timer per stream, passes times, and returns the cost of
+// one reschedule in nanoseconds
+static double MeasureReschedule(unsigned int count, int passes)
+{
+	TimerWheel wheel(10 * NANOSECONDS_PER_MILLISECOND, 0);
+	std::vector<TimerWheelNode> nodes(count);
+
+	int64_t start = BenchmarkClock();
+	for (int pass = 0; pass < passes; pass++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			wheel.Schedule(nodes[i],
+				(int64_t)(pass + 1 + i % 500) * NANOSECONDS_PER_MILLISECOND);
+		}
+	}
+	int64_t elapsed = BenchmarkClock() - start;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		wheel.Cancel(nodes[i]);
+	}
+	return (double)elapsed / ((double)count * passes);
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --streams <n>" <<
+		"                  Number of streams (default: 100000)" << endl;
+	cout << "    --seconds <n>" <<
+		"                  Simulated time (default: 30)" << endl;
+	cout << "    --check-ms <n>" <<
+		"                 Time between checks (default: 10)" << endl;
+	cout << "    --stopped <share>" <<
+		"              Share of streams that stop (default: 0.01)" << endl;
+	cout << "    --stale-factor <x>" <<
+		"             Periods before a stream is stale (default: 3)"
+		<< endl;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int streamCount = 100000;
+	long seconds = 30;
+	long checkMs = 10;
+	double stoppedShare = 0.01;
+	double staleFactor = 3.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--streams") && i + 1 < argc)
+		{
+			streamCount = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (0 == strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			seconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--check-ms") && i + 1 < argc)
+		{
+			checkMs = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--stopped") && i + 1 < argc)
+		{
+			stoppedShare = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--stale-factor") && i + 1 < argc)
+		{
+			staleFactor = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (streamCount == 0 || seconds <= 0 || checkMs <= 0)
+	{
+		cout << "The streams, seconds and check interval must be positive"
+			<< endl;
+		return -1;
+	}
+
+	try
+	{
+		std::vector<SimulatedStream> streams;
+		CreateStreams(streamCount, stoppedShare, streams);
+
+		StalenessConfig config;
+		config.staleFactor = staleFactor;
+		BenchmarkListener listener(streams);
+
+		// The simulated clock starts one second in, since a last sample
+		// time of zero means that a stream has not sent yet
+		const int64_t begin = 1000 * NANOSECONDS_PER_MILLISECOND;
+		const int64_t end = begin + (int64_t)seconds * 1000 *
+			NANOSECONDS_PER_MILLISECOND;
+		const int64_t stopTime = begin + (end - begin) / 2;
+		const int64_t step = checkMs * NANOSECONDS_PER_MILLISECOND;
+		StalenessMonitor monitor(config, begin, listener);
+
+		cout << "Simulating " << streamCount << " streams for " << seconds
+			<< " s, checked every " << checkMs << " ms" << endl;
+
+		// The streams due in each step, found without looking at every
+		// stream on every step
+		size_t stepCount = (size_t)((end - begin) / step);
+		std::vector<std::vector<unsigned int> > calendar(stepCount + 1);
+		for (unsigned int i = 0; i < streamCount; i++)
+		{
+			size_t slot = (size_t)((streams[i].offset + step - 1) / step);
+			if (slot == 0)
+			{
+				slot = 1;
+			}
+			if (slot <= stepCount)
+			{
+				calendar[slot].push_back(i);
+			}
+		}
+
+		uint64_t samples = 0;
+		int64_t sampleTime = 0;
+		int64_t checkTime = 0;
+		int64_t worstCheck = 0;
+		uint64_t checks = 0;
+		std::vector<unsigned int> batch;
+
+		// Each step delivers the samples due since the previous step, then
+		// checks the monitor.  Only the calls to the monitor are timed.
+		for (size_t stepIndex = 1; stepIndex <= stepCount; stepIndex++)
+		{
+			int64_t now = begin + (int64_t)stepIndex * step;
+			listener.now = now;
+
+			batch.clear();
+			for (size_t j = 0; j < calendar[stepIndex].size(); j++)
+			{
+				unsigned int i = calendar[stepIndex][j];
+				SimulatedStream &stream = streams[i];
+				stream.lastSampleTime = stream.lastSampleTime == 0 ?
+					begin + stream.offset :
+					stream.lastSampleTime + stream.period;
+				if (stream.stopped && stream.lastSampleTime > stopTime)
+				{
+					stream.lastSampleTime -= stream.period;
+					continue;
+				}
+				batch.push_back(i);
+
+				size_t slot = (size_t)((stream.lastSampleTime +
+					stream.period - begin + step - 1) / step);
+				if (slot <= stepCount)
+				{
+					calendar[slot].push_back(i);
+				}
+			}
+			std::vector<unsigned int>().swap(calendar[stepIndex]);
+
+			int64_t start = BenchmarkClock();
+			for (size_t j = 0; j < batch.size(); j++)
+			{
+				const SimulatedStream &stream = streams[batch[j]];
+				if (stream.waveform)
+				{
+					monitor.OnFrame(stream.deviceId.c_str(), stream.metricId,
+						(int)batch[j], stream.lastSampleTime, stream.period);
+				} else
+				{
+					monitor.OnNumeric(stream.deviceId.c_str(),
+						stream.metricId, (int)batch[j],
+						stream.lastSampleTime);
+				}
+			}
+			int64_t checkStart = BenchmarkClock();
+			sampleTime += checkStart - start;
+			samples += batch.size();
+
+			monitor.Check(now);
+
+			int64_t elapsed = BenchmarkClock() - checkStart;
+			checkTime += elapsed;
+			if (elapsed > worstCheck)
+			{
+				worstCheck = elapsed;
+			}
+			checks++;
+		}
+
+		// Detection latency of the stopped streams, beyond their timeout
+		unsigned int stoppedCount = 0;
+		unsigned int missed = 0;
+		unsigned int falseAlarms = 0;
+		int64_t totalExcess = 0;
+		int64_t worstExcess = 0;
+		for (unsigned int i = 0; i < streamCount; i++)
+		{
+			const SimulatedStream &stream = streams[i];
+			if (!stream.stopped)
+			{
+				if (stream.staleTime != 0)
+				{
+					falseAlarms++;
+				}
+				continue;
+			}
+			stoppedCount++;
+			int64_t timeout = (int64_t)(staleFactor * (double)stream.period);
+			if (timeout < config.minimumTimeout)
+			{
+				timeout = config.minimumTimeout;
+			}
+			if (stream.staleTime == 0)
+			{
+				// Not reported, and not due by the end of the run
+				if (stream.lastSampleTime + timeout + step < end)
+				{
+					missed++;
+				}
+				continue;
+			}
+			int64_t excess = stream.staleTime - stream.lastSampleTime -
+				timeout;
+			totalExcess += excess;
+			if (excess > worstExcess)
+			{
+				worstExcess = excess;
+			}
+		}
+		unsigned int detected = (unsigned int)listener.staleEvents;
+
+		// A scan of every stream on each check
+		int scans = 100;
+		int64_t scanStart = BenchmarkClock();
+		unsigned int scanned = 0;
+		for (int scan = 0; scan < scans; scan++)
+		{
+			scanned += ScanStreams(streams, end, staleFactor);
+		}
+		double scanCost = (double)(BenchmarkClock() - scanStart) / scans;
+
+		StalenessMetrics metrics;
+		monitor.GetMetrics(metrics);
+
+		double sampleCost = samples == 0 ? 0.0 :
+			(double)sampleTime / (double)samples;
+		cout << "Samples:     " << samples << ", " << sampleCost
+			<< " ns per sample (find the stream and reschedule)" << endl;
+		cout << "Reschedule:  " << MeasureReschedule(streamCount, 20)
+			<< " ns per timer" << endl;
+		cout << "Check:       " << (checks == 0 ? 0.0 :
+				(double)checkTime / (double)checks) / 1000.0
+			<< " us average, " << (double)worstCheck / 1000.0
+			<< " us worst, over " << checks << " checks" << endl;
+		cout << "Full scan:   " << scanCost / 1000.0 << " us per check ("
+			<< scanned / scans << " stale found)" << endl;
+		cout << "Detection:   " << detected << " of " << stoppedCount
+			<< " stopped streams, " << missed << " missed, "
+			<< (detected == 0 ? 0.0 :
+				(double)totalExcess / detected / 1e6)
+			<< " ms average and " << (double)worstExcess / 1e6
+			<< " ms worst beyond the timeout" << endl;
+		cout << "False stale: " << falseAlarms << " streams" << endl;
+		cout << "Memory:      " << metrics.memorySize / 1024 << " KB, "
+			<< (metrics.streamCount == 0 ? 0 :
+				metrics.memorySize / metrics.streamCount)
+			<< " bytes per stream" << endl;
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
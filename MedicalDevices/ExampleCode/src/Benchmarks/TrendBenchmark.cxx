@@ -0,0 +1,254 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <sstream>
+#include "../TrendService/TrendStore.h"
+#include "ReplayRecording.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures the time to open a trend view with the TrendStore
+// used by the TrendService application.  It generates a number of hours of
+// 1 Hz numeric data for a number of patients, each monitored by devices with
+// several metrics, and measures:
+//
+//  - Ingest rate: samples per second added to the trend pyramids.
+//  - Query latency: time to build the trend of all metrics of one patient
+//    over the whole time range, at the requested number of points.
+//  - Scan latency: time to build the same trend by scanning the raw samples,
+//    which is what a query on a recording database has to do.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+// Raw samples of one stream, kept for the scan comparison
+struct RawStream
+{
+	std::string deviceId;
+	std::string metricId;
+	std::vector<int64_t> timestamps;
+	std::vector<float> values;
+};
+
+// Builds points the way a query on raw data has to: by visiting every sample
+// in the range.  Returns the number of samples visited.
+static uint64_t ScanTrend(const RawStream &stream, int64_t start, int64_t end,
+	unsigned int maxPoints, std::vector<TrendPoint> &points)
+{
+	int64_t width = (end - start + maxPoints - 1) / maxPoints;
+	points.clear();
+	std::vector<double> sums;
+	uint64_t visited = 0;
+
+	for (size_t i = 0; i < stream.timestamps.size(); i++)
+	{
+		int64_t t = stream.timestamps[i];
+		if (t < start || t >= end)
+		{
+			continue;
+		}
+		visited++;
+		int64_t startTime = start + (t - start) / width * width;
+		float value = stream.values[i];
+		if (points.empty() || points.back().startTime != startTime)
+		{
+			TrendPoint point;
+			point.startTime = startTime;
+			point.minValue = value;
+			point.maxValue = value;
+			point.meanValue = 0;
+			point.count = 0;
+			points.push_back(point);
+			sums.push_back(0);
+		}
+		TrendPoint &point = points.back();
+		point.minValue = value < point.minValue ? value : point.minValue;
+		point.maxValue = value > point.maxValue ? value : point.maxValue;
+		point.count++;
+		sums.back() += value;
+	}
+
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		points[i].meanValue = (float)(sums[i] / points[i].count);
+	}
+	return visited;
+}
+
+int main(int argc, char *argv[])
+{
+	int patients = 10;
+	int devicesPerPatient = 2;
+	int metricsPerDevice = 4;
+	int hours = 24;
+	unsigned int maxPoints = 1000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--patients") && i + 1 < argc)
+		{
+			patients = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--hours") && i + 1 < argc)
+		{
+			hours = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--points") && i + 1 < argc)
+		{
+			maxPoints = (unsigned int)atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	try
+	{
+		// Generate the raw data: a slow sine wave with some noise per metric
+		int64_t start = 1400000000LL * NANOSECONDS_PER_SECOND;
+		int64_t end = start + (int64_t)hours * 3600 * NANOSECONDS_PER_SECOND;
+		std::vector<RawStream> streams;
+		TrendStore store;
+
+		for (int p = 0; p < patients; p++)
+		{
+			for (int d = 0; d < devicesPerPatient; d++)
+			{
+				std::stringstream devicess;
+				devicess << "device-" << p << "-" << d;
+				store.SetDevicePatient(devicess.str(), p);
+
+				for (int m = 0; m < metricsPerDevice; m++)
+				{
+					RawStream stream;
+					std::stringstream metricss;
+					metricss << "MDC_METRIC_" << m;
+					stream.deviceId = devicess.str();
+					stream.metricId = metricss.str();
+					for (int64_t t = start; t < end;
+						t += NANOSECONDS_PER_SECOND)
+					{
+						double phase = (double)(t - start) / 1e12 + m;
+						stream.timestamps.push_back(t);
+						stream.values.push_back((float)(80.0 +
+							20.0 * sin(phase) + (rand() % 100) / 50.0));
+					}
+					streams.push_back(stream);
+				}
+			}
+		}
+
+		uint64_t sampleCount = 0;
+		for (size_t s = 0; s < streams.size(); s++)
+		{
+			sampleCount += streams[s].timestamps.size();
+		}
+		cout << patients << " patients, " << streams.size() << " streams, "
+			<< hours << " hours, " << sampleCount << " samples" << endl;
+
+		// Ingest: interleave the streams the way they arrive from devices
+		int64_t clock = BenchmarkClock();
+		size_t length = streams.empty() ? 0 : streams[0].timestamps.size();
+		for (size_t i = 0; i < length; i++)
+		{
+			for (size_t s = 0; s < streams.size(); s++)
+			{
+				store.AddNumeric(streams[s].deviceId.c_str(),
+					streams[s].metricId.c_str(), 0,
+					streams[s].timestamps[i], streams[s].values[i]);
+			}
+		}
+		int64_t elapsed = BenchmarkClock() - clock;
+		cout << "Trend ingest:  " << (double)sampleCount * 1e3 / elapsed
+			<< " M samples/s, " << store.GetMemorySize() / (1024 * 1024)
+			<< " MB of trends" << endl;
+
+		// Query every patient's trend over the whole range
+		std::vector<TrendPoint> points;
+		int64_t worst = 0;
+		uint64_t pointCount = 0;
+		clock = BenchmarkClock();
+		for (int p = 0; p < patients; p++)
+		{
+			int64_t patientStart = BenchmarkClock();
+			std::vector<const TrendSeries *> series;
+			store.FindSeries(p, "", series);
+			for (size_t s = 0; s < series.size(); s++)
+			{
+				series[s]->pyramid.Query(start, end, maxPoints, points);
+				pointCount += points.size();
+			}
+			int64_t patientTime = BenchmarkClock() - patientStart;
+			worst = patientTime > worst ? patientTime : worst;
+		}
+		elapsed = BenchmarkClock() - clock;
+		cout << "Trend query:   " << (double)elapsed / patients / 1e6
+			<< " ms per patient (worst " << (double)worst / 1e6 << " ms), "
+			<< pointCount / (patients * devicesPerPatient * metricsPerDevice)
+			<< " points per series" << endl;
+
+		// Build the same trends from the raw samples
+		uint64_t visited = 0;
+		worst = 0;
+		clock = BenchmarkClock();
+		int streamsPerPatient = devicesPerPatient * metricsPerDevice;
+		for (int p = 0; p < patients; p++)
+		{
+			int64_t patientStart = BenchmarkClock();
+			for (int s = 0; s < streamsPerPatient; s++)
+			{
+				visited += ScanTrend(streams[p * streamsPerPatient + s],
+					start, end, maxPoints, points);
+			}
+			int64_t patientTime = BenchmarkClock() - patientStart;
+			worst = patientTime > worst ? patientTime : worst;
+		}
+		elapsed = BenchmarkClock() - clock;
+		cout << "Raw scan:      " << (double)elapsed / patients / 1e6
+			<< " ms per patient (worst " << (double)worst / 1e6 << " ms), "
+			<< visited / patients << " samples visited per patient" << endl;
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --patients <n>" <<
+		"                 Number of patients (default: 10)"
+		<< endl;
+	cout <<
+		"    --hours <n>" <<
+		"                    Hours of 1 Hz data per metric (default: 24)"
+		<< endl;
+	cout <<
+		"    --points <n>" <<
+		"                   Points per trend series (default: 1000)"
+		<< endl;
+}
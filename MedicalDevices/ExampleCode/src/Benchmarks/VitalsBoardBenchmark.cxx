@@ -0,0 +1,641 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataReader.h"
+#include "../CommonInfrastructure/DDSGenericDataWriter.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../CommonInfrastructure/SharedVitalsBoard.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+#include "../Generated/profiles.h"
+#include "../VitalsBoard/DDSVitalsBoardInterface.h"
+
+using namespace std;
+using namespace com::rti::medical::generated;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This benchmark compares two ways for --readers display processes of one
+// host to follow the latest numerics of every patient:
+//
+//  - DDS readers: each display has its own participant and ice::Numeric
+//    DataReader, and keeps its own copy of every latest value.
+//  - Vitals board: one ingest participant writes the latest values to a
+//    shared vitals board, and each display reads them from the board with
+//    a VitalsBoardReader, waiting for the board to change.
+//
+// One participant simulates a monitor for each of --patients patients,
+// that sends three numerics, at --rate numerics per second in total.  The
+// value of each numeric is a sequence number, and the monotonic time each
+// one was written is kept, so every display knows the latency of each
+// value it sees.  The displays run as threads of this process, so they are
+// measured on the same clock.
+//
+// For each way, the benchmark reports:
+//
+//  - Read latency: from the write of a numeric to the time a display has
+//    the value.  A display of the board only sees the latest value of a
+//    stream, so a value replaced before the display read the board is not
+//    counted.
+//  - Memory: the growth of the resident memory of the process while the
+//    displays run.  The pages of the board are counted once for every
+//    display that maps it, although they are in memory only once, so the
+//    size of the board is printed too.
+//  - CPU: the CPU time of the process while the displays run, including
+//    the simulated monitors.
+//
+// The board benchmark also reports the time to copy the values of one
+// patient, and of every patient, from the board.
+//
+// The devices use device IDs that start with "vitals-bench-".
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+static const char *const METRIC_IDS[] = {
+	"MDC_PULS_RATE", "MDC_PULS_OXIM_SAT_O2", "MDC_RESP_RATE"
+};
+static const int METRICS = 3;
+
+static const char *DEVICE_PREFIX = "vitals-bench-";
+
+// Patient IDs of the benchmark, so they do not collide with other patients
+// on the domain
+static const int FIRST_PATIENT_ID = 9500;
+
+// The sequence numbers sent as values wrap at this count, which floats hold
+// exactly
+static const int SEND_SLOTS = 1 << 20;
+
+// Board used by the benchmark, so it does not replace a running board
+static const char *BOARD_NAME = "VitalsBoardBenchmark";
+
+struct BoardOptions
+{
+	int readers;
+	int patients;
+	int rate;
+	int seconds;
+};
+
+// ----------------------------------------------------------------------------
+// State shared with the monitor, ingest and display threads
+struct BoardRun
+{
+	BoardRun() :
+		stopLoad(false),
+		stopDisplays(false),
+		measuring(false),
+		patients(0),
+		rate(0),
+		numericWriter(NULL),
+		ingest(NULL),
+		board(NULL)
+	{
+	}
+
+	volatile bool stopLoad;
+	volatile bool stopDisplays;
+	volatile bool measuring;
+	int patients;
+	int rate;
+
+	GenericDataWriter<ice::Numeric> *numericWriter;
+
+	// Monotonic time each sequence number was written
+	std::vector<int64_t> sendTimes;
+
+	// Used by the board benchmark only
+	DDSVitalsBoardInterface *ingest;
+	VitalsBoardWriter *board;
+};
+
+// One display, with either a DataReader or a board reader
+struct Display
+{
+	Display() :
+		run(NULL),
+		communicator(NULL),
+		reader(NULL),
+		boardReader(NULL),
+		streams(0)
+	{
+	}
+
+	BoardRun *run;
+	DDSCommunicator *communicator;
+	GenericDataReader<ice::Numeric> *reader;
+	VitalsBoardReader *boardReader;
+	std::vector<int64_t> latencies;
+	size_t streams;
+};
+
+// Results of one way of reading
+struct BoardResult
+{
+	BoardResult() :
+		memoryGrowth(0),
+		cpuTime(0),
+		elapsed(0)
+	{
+	}
+
+	std::vector<int64_t> latencies;
+	int64_t memoryGrowth;
+	int64_t cpuTime;
+	int64_t elapsed;
+};
+
+static void MakeDeviceId(int patient, char *deviceId)
+{
+	sprintf(deviceId, "%s%04d", DEVICE_PREFIX, patient);
+}
+
+static bool IsBenchmarkDevice(const char *deviceId)
+{
+	return strncmp(deviceId, DEVICE_PREFIX, strlen(DEVICE_PREFIX)) == 0;
+}
+
+// Latency of a value written by the monitors, or -1 if the value is not a
+// sequence number
+static int64_t GetLatency(const BoardRun *run, float value, int64_t now)
+{
+	int sequence = (int)value;
+	if (sequence < 0 || sequence >= SEND_SLOTS)
+	{
+		return -1;
+	}
+	return now - run->sendTimes[sequence];
+}
+
+// ----------------------------------------------------------------------------
+// Sends the numerics of every patient, every 10 ms, until stopped
+static void *MonitorThread(void *param)
+{
+	BoardRun *run = (BoardRun *)param;
+	DdsAutoType<ice::Numeric> numeric;
+	numeric.instance_id = 0;
+
+	int perTick = run->rate / 100;
+	if (perTick < 1)
+	{
+		perTick = 1;
+	}
+
+	DDS_Duration_t tick = {0, 10000000};
+	int stream = 0;
+	int sequence = 0;
+	while (!run->stopLoad)
+	{
+		for (int i = 0; i < perTick; i++)
+		{
+			MakeDeviceId(stream / METRICS % run->patients,
+				numeric.unique_device_identifier);
+			strcpy(numeric.metric_id, METRIC_IDS[stream % METRICS]);
+			stream = (stream + 1) % (run->patients * METRICS);
+
+			run->sendTimes[sequence] = OSGetMonotonicTime();
+			numeric.value = (float)sequence;
+			run->numericWriter->Write(numeric);
+			sequence = (sequence + 1) % SEND_SLOTS;
+		}
+		NDDSUtility::sleep(tick);
+	}
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// A display with its own DataReader, that keeps its own copy of the latest
+// value of every stream
+static void *ReaderDisplayThread(void *param)
+{
+	Display *display = (Display *)param;
+	BoardRun *run = display->run;
+
+	DDS::WaitSet waitSet;
+	waitSet.attach_condition(display->reader->GetCondition());
+	DDS::ConditionSeq activeConditions;
+	DDS_Duration_t waitTime = {0, 100000000};
+
+	std::map<std::string, float> latestValues;
+	std::string key;
+	LoanedBatch<ice::Numeric> batch;
+	while (!run->stopDisplays)
+	{
+		waitSet.wait(activeConditions, waitTime);
+		while (display->reader->Take(batch))
+		{
+			int64_t now = OSGetMonotonicTime();
+			for (LoanedBatch<ice::Numeric>::ValidIterator it =
+				batch.begin(); it != batch.end(); ++it)
+			{
+				key.assign(it->unique_device_identifier);
+				key.append("|").append(it->metric_id);
+				latestValues[key] = it->value;
+
+				int64_t latency = GetLatency(run, it->value, now);
+				if (run->measuring && latency >= 0 &&
+					IsBenchmarkDevice(it->unique_device_identifier))
+				{
+					display->latencies.push_back(latency);
+				}
+			}
+		}
+	}
+
+	waitSet.detach_condition(display->reader->GetCondition());
+	display->streams = latestValues.size();
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// A display that reads every value from the board each time it changes.
+// The values are in the order of the slots, which stays the same while the
+// streams stay on the board, so a changed value is found by position.
+static void *BoardDisplayThread(void *param)
+{
+	Display *display = (Display *)param;
+	BoardRun *run = display->run;
+
+	std::vector<VitalsBoardValue> values;
+	std::vector<float> lastValues;
+	uint32_t generation = display->boardReader->GetGeneration();
+	while (!run->stopDisplays)
+	{
+		generation = display->boardReader->WaitForChange(generation,
+			100 * NANOSECONDS_PER_MILLISECOND);
+
+		values.clear();
+		if (!display->boardReader->ReadValues(VITALS_BOARD_ALL_PATIENTS,
+			values))
+		{
+			cout << "The vitals board is stalled" << endl;
+			break;
+		}
+		int64_t now = OSGetMonotonicTime();
+		lastValues.resize(values.size(), -1.0f);
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			if (values[i].value == lastValues[i])
+			{
+				continue;
+			}
+			lastValues[i] = values[i].value;
+
+			int64_t latency = GetLatency(run, values[i].value, now);
+			if (run->measuring && latency >= 0 &&
+				IsBenchmarkDevice(values[i].deviceId))
+			{
+				display->latencies.push_back(latency);
+			}
+		}
+	}
+
+	display->streams = values.size();
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Runs the ingest of the board until the displays are stopped
+static void *IngestThread(void *param)
+{
+	BoardRun *run = (BoardRun *)param;
+	DDS_Duration_t waitTime = {0, 100000000};
+	try
+	{
+		while (!run->stopDisplays)
+		{
+			run->ingest->ProcessAvailableData(*run->board, waitTime);
+		}
+	}
+	catch (string message)
+	{
+		cout << "Ingest exception: " << message << endl;
+	}
+	return NULL;
+}
+
+static DDS::DomainParticipant *CreateParticipant(DDSCommunicator &communicator)
+{
+	std::vector<std::string> xmlFiles;
+	xmlFiles.push_back("file://../../../src/Config/qos_profiles.xml");
+	DDS::DomainParticipant *participant = communicator.CreateParticipant(5,
+		xmlFiles, ICE_QOS_LIBRARY, QOS_PROFILE_PARTICIPANT);
+	if (participant == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+	return participant;
+}
+
+// Waits until the numerics DataWriter has matched count DataReaders
+static void WaitForMatches(DDS::DataWriter *writer, int count)
+{
+	DDS_Duration_t pollPeriod = {0, 100000000};
+	for (int i = 0; i < 200; i++)
+	{
+		DDS_PublicationMatchedStatus status;
+		writer->get_publication_matched_status(status);
+		if (status.current_count >= count)
+		{
+			return;
+		}
+		NDDSUtility::sleep(pollPeriod);
+	}
+	std::stringstream errss;
+	errss << "The displays were not discovered";
+	throw errss.str();
+}
+
+// ----------------------------------------------------------------------------
+// Lets the displays run for the warmup, then measures them for the length
+// of the benchmark, and stops them
+static void MeasureDisplays(BoardRun &run, const BoardOptions &options,
+	std::vector<OSThread *> &threads, std::vector<Display> &displays,
+	int64_t memoryBefore, BoardResult &result)
+{
+	DDS_Duration_t warmup = {2, 0};
+	NDDSUtility::sleep(warmup);
+
+	int64_t cpuBefore = OSGetProcessCpuTime();
+	int64_t start = OSGetMonotonicTime();
+	run.measuring = true;
+	DDS_Duration_t length = {options.seconds, 0};
+	NDDSUtility::sleep(length);
+	run.measuring = false;
+	result.elapsed = OSGetMonotonicTime() - start;
+	result.cpuTime = OSGetProcessCpuTime() - cpuBefore;
+	result.memoryGrowth = OSGetProcessResidentMemory() - memoryBefore;
+
+	run.stopDisplays = true;
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i]->Join();
+		delete threads[i];
+	}
+	threads.clear();
+	run.stopDisplays = false;
+
+	for (size_t i = 0; i < displays.size(); i++)
+	{
+		result.latencies.insert(result.latencies.end(),
+			displays[i].latencies.begin(), displays[i].latencies.end());
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Each display with its own participant and DataReader
+static void RunReaderDisplays(BoardRun &run, const BoardOptions &options,
+	BoardResult &result)
+{
+	int64_t memoryBefore = OSGetProcessResidentMemory();
+
+	std::vector<Display> displays(options.readers);
+	std::vector<OSThread *> threads;
+	for (int i = 0; i < options.readers; i++)
+	{
+		displays[i].run = &run;
+		displays[i].communicator = new DDSCommunicator();
+		CreateParticipant(*displays[i].communicator);
+		displays[i].reader = new GenericDataReader<ice::Numeric>(
+			displays[i].communicator, ice::NumericTopic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_STREAMING);
+	}
+	WaitForMatches(run.numericWriter->GetDataWriter(), options.readers);
+
+	for (int i = 0; i < options.readers; i++)
+	{
+		threads.push_back(new OSThread(ReaderDisplayThread, &displays[i]));
+		threads.back()->Run();
+	}
+
+	MeasureDisplays(run, options, threads, displays, memoryBefore, result);
+
+	for (int i = 0; i < options.readers; i++)
+	{
+		delete displays[i].reader;
+		delete displays[i].communicator;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// One ingest participant writing the board, and each display reading it
+static void RunBoardDisplays(BoardRun &run, const BoardOptions &options,
+	BoardResult &result)
+{
+	int64_t memoryBefore = OSGetProcessResidentMemory();
+
+	VitalsBoardWriter board(BOARD_NAME,
+		(unsigned int)(options.patients * METRICS * 2));
+	run.board = &board;
+	run.ingest = new DDSVitalsBoardInterface(true);
+	WaitForMatches(run.numericWriter->GetDataWriter(), 1);
+
+	std::vector<OSThread *> threads;
+	threads.push_back(new OSThread(IngestThread, &run));
+	threads.back()->Run();
+
+	std::vector<Display> displays(options.readers);
+	for (int i = 0; i < options.readers; i++)
+	{
+		displays[i].run = &run;
+		displays[i].boardReader = new VitalsBoardReader();
+		if (!displays[i].boardReader->Open(BOARD_NAME))
+		{
+			std::stringstream errss;
+			errss << "Failed to open the vitals board " << BOARD_NAME;
+			throw errss.str();
+		}
+		threads.push_back(new OSThread(BoardDisplayThread, &displays[i]));
+		threads.back()->Run();
+	}
+
+	MeasureDisplays(run, options, threads, displays, memoryBefore, result);
+
+	// The cost of a read, once every stream is on the board
+	VitalsBoardReader reader;
+	reader.Open(BOARD_NAME);
+	std::vector<VitalsBoardValue> values;
+	const int reads = 10000;
+	int64_t start = OSGetMonotonicTime();
+	for (int i = 0; i < reads; i++)
+	{
+		values.clear();
+		reader.ReadValues(FIRST_PATIENT_ID + i % options.patients, values);
+	}
+	int64_t patientRead = (OSGetMonotonicTime() - start) / reads;
+	start = OSGetMonotonicTime();
+	for (int i = 0; i < reads; i++)
+	{
+		values.clear();
+		reader.ReadValues(VITALS_BOARD_ALL_PATIENTS, values);
+	}
+	int64_t allRead = (OSGetMonotonicTime() - start) / reads;
+
+	cout << "Board: " << board.GetStreamCount() << " streams in "
+		<< board.GetBoardSize() / 1024 << " KB, one patient read in "
+		<< patientRead << " ns, every patient (" << values.size()
+		<< " values) in " << allRead << " ns" << endl;
+
+	for (int i = 0; i < options.readers; i++)
+	{
+		delete displays[i].boardReader;
+	}
+	delete run.ingest;
+	run.ingest = NULL;
+	run.board = NULL;
+}
+
+static int64_t Percentile(const std::vector<int64_t> &sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	size_t index = (size_t)(p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+static void PrintResult(const char *name, BoardResult &result,
+	const BoardOptions &options)
+{
+	std::sort(result.latencies.begin(), result.latencies.end());
+	cout << name << result.latencies.size() << " values seen, latency 50% "
+		<< Percentile(result.latencies, 0.5) / 1e3 << " us, 99% "
+		<< Percentile(result.latencies, 0.99) / 1e3 << " us, max "
+		<< Percentile(result.latencies, 1.0) / 1e3 << " us" << endl;
+	cout << "    memory growth " << result.memoryGrowth / 1024 << " KB ("
+		<< result.memoryGrowth / 1024 / options.readers
+		<< " KB per display), CPU "
+		<< 100.0 * result.cpuTime / result.elapsed << "%" << endl;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --readers <n>" <<
+		"                  Display processes simulated (default: 8)" << endl;
+	cout << "    --patients <n>" <<
+		"                 Simulated patients (default: 20)" << endl;
+	cout << "    --rate <n>" <<
+		"                     Numerics per second (default: 2000)" << endl;
+	cout << "    --seconds <n>" <<
+		"                  Measured time of each way (default: 10)"
+		<< endl;
+}
+
+int main(int argc, char *argv[])
+{
+	BoardOptions options;
+	options.readers = 8;
+	options.patients = 20;
+	options.rate = 2000;
+	options.seconds = 10;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--readers") && i + 1 < argc)
+		{
+			options.readers = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--patients") && i + 1 < argc)
+		{
+			options.patients = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--rate") && i + 1 < argc)
+		{
+			options.rate = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			options.seconds = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (options.readers <= 0 || options.patients <= 0 ||
+		options.rate <= 0 || options.seconds <= 0)
+	{
+		cout << "The readers, patients, rate and seconds must be positive"
+			<< endl;
+		return -1;
+	}
+
+	try
+	{
+		BoardRun run;
+		run.patients = options.patients;
+		run.rate = options.rate;
+		run.sendTimes.resize(SEND_SLOTS, 0);
+
+		// The monitors, mapped to their patients
+		DDSCommunicator devices;
+		CreateParticipant(devices);
+		GenericDataWriter<DevicePatientMapping> mappingWriter(&devices,
+			DevicePatientMappingTopic, ICE_QOS_LIBRARY,
+			QOS_PROFILE_PATIENT_DEVICES);
+		run.numericWriter = new GenericDataWriter<ice::Numeric>(&devices,
+			ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+
+		DdsAutoType<DevicePatientMapping> mapping;
+		for (int patient = 0; patient < options.patients; patient++)
+		{
+			mapping.patient_id = FIRST_PATIENT_ID + patient;
+			MakeDeviceId(patient, mapping.device_id);
+			mappingWriter.Write(mapping);
+		}
+
+		cout << options.readers << " displays, " << options.patients
+			<< " patients, " << options.rate << " numerics/s" << endl;
+
+		OSThread monitorThread(MonitorThread, &run);
+		monitorThread.Run();
+
+		BoardResult readerResult;
+		RunReaderDisplays(run, options, readerResult);
+		BoardResult boardResult;
+		RunBoardDisplays(run, options, boardResult);
+
+		run.stopLoad = true;
+		monitorThread.Join();
+
+		PrintResult("DDS readers:  ", readerResult, options);
+		PrintResult("Vitals board: ", boardResult, options);
+
+		delete run.numericWriter;
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
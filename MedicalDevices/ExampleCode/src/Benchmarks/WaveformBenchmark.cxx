@@ -0,0 +1,261 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+#include "../CommonInfrastructure/WaveformCodec.h"
+#include "ReplayRecording.h"
+
+using namespace std;
+
+// ------------------------------------------------------------------------- //
+// This benchmark measures the waveform codec used by the
+// CompressedSampleArray topic on the SampleArray frames of the device
+// recordings in the replay directory.  It reports:
+//
+//  - Compression: bytes of float values in the frames, and bytes of their
+//    encoding, including the per-frame header fields of the topic.
+//  - Encode and decode rates in MB of float values per second, for the
+//    vectorized codec and for the portable scalar codec.
+//  - Correctness: every frame is decoded and compared bit by bit with the
+//    original, and both encoders must produce the same bytes.
+//
+// ------------------------------------------------------------------------- //
+
+// Bytes of the fields that CompressedSampleArray adds to the encoded values:
+// the value count and the length of the encoded sequence
+static const size_t COMPRESSED_FRAME_OVERHEAD = 2 + 4;
+
+typedef size_t (*EncodeFunction)(const float *, unsigned int,
+	unsigned char *);
+typedef bool (*DecodeFunction)(const unsigned char *, size_t, float *,
+	unsigned int);
+
+static double Rate(uint64_t bytes, int64_t elapsed)
+{
+	return elapsed <= 0 ? 0.0 : (double)bytes * 1e9 / (double)elapsed;
+}
+
+// Frames that have values, with the offset of each in a buffer of encodings
+struct EncodedFrames
+{
+	std::vector<const RecordedSampleArray *> frames;
+	std::vector<size_t> offsets;
+	std::vector<size_t> lengths;
+	std::vector<unsigned char> bytes;
+	uint64_t rawBytes;
+};
+
+static void PrepareFrames(const ReplayRecording &recording,
+	EncodedFrames &encoded)
+{
+	const std::vector<RecordedSampleArray> &frames =
+		recording.GetSampleArrays();
+	size_t total = 0;
+	encoded.rawBytes = 0;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		if (frames[i].values.empty())
+		{
+			continue;
+		}
+		unsigned int count = (unsigned int)frames[i].values.size();
+		encoded.frames.push_back(&frames[i]);
+		encoded.offsets.push_back(total);
+		encoded.lengths.push_back(0);
+		total += WaveformEncodedBound(count);
+		encoded.rawBytes += count * sizeof(float);
+	}
+	encoded.bytes.resize(total + 1);
+}
+
+// ------------------------------------------------------------------------- //
+// Encodes every frame repeat times, and returns the rate in MB/s
+static double Encode(EncodedFrames &encoded, int repeat,
+	EncodeFunction encode)
+{
+	int64_t start = BenchmarkClock();
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		for (size_t i = 0; i < encoded.frames.size(); i++)
+		{
+			const std::vector<float> &values = encoded.frames[i]->values;
+			encoded.lengths[i] = encode(&values[0],
+				(unsigned int)values.size(),
+				&encoded.bytes[encoded.offsets[i]]);
+		}
+	}
+	int64_t elapsed = BenchmarkClock() - start;
+	return Rate(encoded.rawBytes * repeat, elapsed) / 1e6;
+}
+
+// Decodes every frame repeat times, and returns the rate in MB/s.  Counts the
+// frames that fail to decode or differ from the original.
+static double Decode(const EncodedFrames &encoded, int repeat,
+	DecodeFunction decode, unsigned long &mismatches)
+{
+	std::vector<float> decoded(WAVEFORM_BLOCK_SIZE);
+	mismatches = 0;
+
+	int64_t start = BenchmarkClock();
+	for (int pass = 0; pass < repeat; pass++)
+	{
+		for (size_t i = 0; i < encoded.frames.size(); i++)
+		{
+			const std::vector<float> &values = encoded.frames[i]->values;
+			if (decoded.size() < values.size())
+			{
+				decoded.resize(values.size());
+			}
+			if (!decode(&encoded.bytes[encoded.offsets[i]],
+				encoded.lengths[i], &decoded[0],
+				(unsigned int)values.size()))
+			{
+				mismatches++;
+			}
+		}
+	}
+	int64_t elapsed = BenchmarkClock() - start;
+
+	// Compared once outside the timed loop
+	for (size_t i = 0; i < encoded.frames.size(); i++)
+	{
+		const std::vector<float> &values = encoded.frames[i]->values;
+		if (!decode(&encoded.bytes[encoded.offsets[i]], encoded.lengths[i],
+			&decoded[0], (unsigned int)values.size()) ||
+			memcmp(&decoded[0], &values[0],
+				values.size() * sizeof(float)) != 0)
+		{
+			mismatches++;
+		}
+	}
+	return Rate(encoded.rawBytes * repeat, elapsed) / 1e6;
+}
+
+// ------------------------------------------------------------------------- //
+// Encodes every frame with both encoders and counts the frames whose
+// encodings differ
+static unsigned long CompareEncoders(const EncodedFrames &encoded)
+{
+	std::vector<unsigned char> vectorized;
+	std::vector<unsigned char> scalar;
+	unsigned long differences = 0;
+	for (size_t i = 0; i < encoded.frames.size(); i++)
+	{
+		const std::vector<float> &values = encoded.frames[i]->values;
+		unsigned int count = (unsigned int)values.size();
+		vectorized.resize(WaveformEncodedBound(count));
+		scalar.resize(WaveformEncodedBound(count));
+		size_t vectorizedLength = EncodeWaveform(&values[0], count,
+			&vectorized[0]);
+		size_t scalarLength = EncodeWaveformScalar(&values[0], count,
+			&scalar[0]);
+		if (vectorizedLength != scalarLength ||
+			memcmp(&vectorized[0], &scalar[0], scalarLength) != 0)
+		{
+			differences++;
+		}
+	}
+	return differences;
+}
+
+static void RunCodec(const char *name, EncodedFrames &encoded, int repeat,
+	EncodeFunction encode, DecodeFunction decode)
+{
+	double encodeRate = Encode(encoded, repeat, encode);
+	unsigned long mismatches = 0;
+	double decodeRate = Decode(encoded, repeat, decode, mismatches);
+
+	uint64_t compressedBytes = 0;
+	for (size_t i = 0; i < encoded.lengths.size(); i++)
+	{
+		compressedBytes += encoded.lengths[i] + COMPRESSED_FRAME_OVERHEAD;
+	}
+
+	cout << name << " encode: " << encodeRate << " MB/s, decode: "
+		<< decodeRate << " MB/s" << endl;
+	cout << name << " size:   " << compressedBytes << " bytes, ratio "
+		<< (compressedBytes == 0 ? 0.0 :
+			(double)encoded.rawBytes / (double)compressedBytes)
+		<< ", " << mismatches << " frames not restored exactly" << endl;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout << "    --repeat <n>" <<
+		"                   Number of times the frames are encoded and"
+		<< " decoded (default: 200)" << endl;
+	cout << "    <file> ..." <<
+		"                     Recording Service databases to load"
+		<< " (default: the files in the replay directory)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	int repeat = 200;
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--repeat") && i + 1 < argc)
+		{
+			repeat = atoi(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else
+		{
+			files.push_back(argv[i]);
+		}
+	}
+	if (files.empty())
+	{
+		files = DefaultReplayFiles();
+	}
+
+	try
+	{
+		ReplayRecording recording;
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			recording.Load(files[i]);
+		}
+
+		EncodedFrames encoded;
+		PrepareFrames(recording, encoded);
+		cout << "Loaded " << encoded.frames.size() << " SampleArrays ("
+			<< encoded.rawBytes << " bytes of values), coded " << repeat
+			<< " times" << endl;
+		if (encoded.frames.empty())
+		{
+			throw std::string("No SampleArray values in the recordings");
+		}
+
+		RunCodec(IsWaveformCodecVectorized() ? "SSE2  " : "Native",
+			encoded, repeat, EncodeWaveform, DecodeWaveform);
+		RunCodec("Scalar", encoded, repeat, EncodeWaveformScalar,
+			DecodeWaveformScalar);
+
+		cout << "Encoder differences: " << CompareEncoders(encoded)
+			<< " frames" << endl;
+	}
+	catch (string message)
+	{
+		cout << "Benchmark exception: " << message << endl;
+		return -1;
+	}
+
+	return 0;
+}
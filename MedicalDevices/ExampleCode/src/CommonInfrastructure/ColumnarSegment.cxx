@@ -0,0 +1,586 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include <sstream>
+#include "ColumnarSegment.h"
+
+static const char SEGMENT_MAGIC[8] = { 'I', 'C', 'E', 'S', 'E', 'G', '0', '1' };
+static const char SEGMENT_INDEX_MAGIC[8] =
+	{ 'I', 'C', 'E', 'S', 'E', 'G', 'I', 'X' };
+static const uint32_t SEGMENT_BYTE_ORDER = 0x01020304;
+static const uint32_t SEGMENT_VERSION = 1;
+
+// ------------------------------------------------------------------------- //
+// Bit and byte level helpers used to compress the columns of a block
+// ------------------------------------------------------------------------- //
+
+static unsigned int CountLeadingZeros(uint32_t value)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_clz(value);
+#else
+	unsigned int count = 0;
+	while ((value & 0x80000000u) == 0)
+	{
+		value <<= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+static unsigned int CountTrailingZeros(uint32_t value)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_ctz(value);
+#else
+	unsigned int count = 0;
+	while ((value & 1u) == 0)
+	{
+		value >>= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+static uint32_t FloatToBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static float BitsToFloat(uint32_t bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void PadToEightBytes(std::vector<unsigned char> &buffer, size_t start)
+{
+	while ((buffer.size() - start) % 8 != 0)
+	{
+		buffer.push_back(0);
+	}
+}
+
+// Writes bit fields most-significant bit first
+class BitWriter
+{
+public:
+	BitWriter(std::vector<unsigned char> &out) :
+		_out(out), _accumulator(0), _bitCount(0)
+	{}
+
+	// Writes the low bitCount bits of value.  bitCount must be <= 32.
+	void Write(uint32_t value, unsigned int bitCount)
+	{
+		_accumulator = (_accumulator << bitCount) |
+			(value & (uint32_t)((1ull << bitCount) - 1));
+		_bitCount += bitCount;
+		while (_bitCount >= 8)
+		{
+			_out.push_back(
+				(unsigned char)(_accumulator >> (_bitCount - 8)));
+			_bitCount -= 8;
+		}
+	}
+
+	void Finish()
+	{
+		if (_bitCount > 0)
+		{
+			_out.push_back(
+				(unsigned char)(_accumulator << (8 - _bitCount)));
+			_bitCount = 0;
+		}
+	}
+
+private:
+	std::vector<unsigned char> &_out;
+	uint64_t _accumulator;
+	unsigned int _bitCount;
+};
+
+// Reads bit fields written by BitWriter.  Reading past the end of the
+// column returns zero bits rather than reading past the mapping.
+class BitReader
+{
+public:
+	BitReader(const unsigned char *data, size_t length) :
+		_data(data), _end(data + length), _accumulator(0), _bitCount(0)
+	{}
+
+	uint32_t Read(unsigned int bitCount)
+	{
+		while (_bitCount < bitCount)
+		{
+			_accumulator = (_accumulator << 8) |
+				(_data < _end ? *_data++ : 0);
+			_bitCount += 8;
+		}
+		_bitCount -= bitCount;
+		return (uint32_t)(_accumulator >> _bitCount) &
+			(uint32_t)((1ull << bitCount) - 1);
+	}
+
+private:
+	const unsigned char *_data;
+	const unsigned char *_end;
+	uint64_t _accumulator;
+	unsigned int _bitCount;
+};
+
+static void WriteVarint(std::vector<unsigned char> &out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+static uint64_t ReadVarint(const unsigned char *&data,
+	const unsigned char *end)
+{
+	uint64_t value = 0;
+	unsigned int shift = 0;
+	while (data < end && shift < 64)
+	{
+		unsigned char byte = *data++;
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			break;
+		}
+		shift += 7;
+	}
+	return value;
+}
+
+// Timestamps: zig-zag encoded delta-of-deltas.  The first timestamp is kept
+// in the block header, so it is not repeated in the column.
+static void EncodeTimestamps(const std::vector<int64_t> &timestamps,
+	std::vector<unsigned char> &out)
+{
+	int64_t previousDelta = 0;
+	for (size_t i = 1; i < timestamps.size(); i++)
+	{
+		int64_t delta = timestamps[i] - timestamps[i - 1];
+		int64_t deltaOfDelta = delta - previousDelta;
+		WriteVarint(out,
+			((uint64_t)deltaOfDelta << 1) ^ (uint64_t)(deltaOfDelta >> 63));
+		previousDelta = delta;
+	}
+}
+
+static void DecodeTimestamps(const unsigned char *data, size_t length,
+	int64_t firstTimestamp, unsigned int count, int64_t *timestamps)
+{
+	const unsigned char *end = data + length;
+	int64_t delta = 0;
+	int64_t timestamp = firstTimestamp;
+	timestamps[0] = timestamp;
+	for (unsigned int i = 1; i < count; i++)
+	{
+		uint64_t zigzag = ReadVarint(data, end);
+		delta += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+		timestamp += delta;
+		timestamps[i] = timestamp;
+	}
+}
+
+// Values: XOR of each float with the previous one.  A repeated value costs a
+// single bit.  Otherwise only the meaningful bits of the XOR are written,
+// reusing the previous leading/trailing zero window when it still fits.
+static void EncodeValues(const std::vector<float> &values,
+	std::vector<unsigned char> &out)
+{
+	BitWriter writer(out);
+	uint32_t previous = FloatToBits(values[0]);
+	writer.Write(previous, 32);
+
+	unsigned int windowLeading = 33;
+	unsigned int windowTrailing = 0;
+	for (size_t i = 1; i < values.size(); i++)
+	{
+		uint32_t current = FloatToBits(values[i]);
+		uint32_t xorValue = current ^ previous;
+		previous = current;
+
+		if (xorValue == 0)
+		{
+			writer.Write(0, 1);
+			continue;
+		}
+
+		unsigned int leading = CountLeadingZeros(xorValue);
+		unsigned int trailing = CountTrailingZeros(xorValue);
+		if (windowLeading <= 32 && leading >= windowLeading &&
+			trailing >= windowTrailing)
+		{
+			writer.Write(2, 2);
+			writer.Write(xorValue >> windowTrailing,
+				32 - windowLeading - windowTrailing);
+		}
+		else
+		{
+			unsigned int meaningful = 32 - leading - trailing;
+			writer.Write(3, 2);
+			writer.Write(leading, 5);
+			writer.Write(meaningful - 1, 5);
+			writer.Write(xorValue >> trailing, meaningful);
+			windowLeading = leading;
+			windowTrailing = trailing;
+		}
+	}
+	writer.Finish();
+}
+
+static void DecodeValues(const unsigned char *data, size_t length,
+	unsigned int count, float *values)
+{
+	BitReader reader(data, length);
+	uint32_t previous = reader.Read(32);
+	values[0] = BitsToFloat(previous);
+
+	unsigned int windowLeading = 0;
+	unsigned int windowTrailing = 0;
+	for (unsigned int i = 1; i < count; i++)
+	{
+		if (reader.Read(1) != 0)
+		{
+			if (reader.Read(1) != 0)
+			{
+				windowLeading = reader.Read(5);
+				unsigned int meaningful = reader.Read(5) + 1;
+				windowTrailing = 32 - windowLeading - meaningful;
+			}
+			unsigned int meaningful = 32 - windowLeading - windowTrailing;
+			previous ^= reader.Read(meaningful) << windowTrailing;
+		}
+		values[i] = BitsToFloat(previous);
+	}
+}
+
+// ------------------------------------------------------------------------- //
+// ColumnarSegmentWriter
+// ------------------------------------------------------------------------- //
+ColumnarSegmentWriter::ColumnarSegmentWriter(const std::string &fileName,
+	SegmentStreamKind kind,
+	const std::string &deviceId,
+	const std::string &metricId,
+	int instanceId,
+	unsigned int samplesPerBlock) :
+	_fileName(fileName),
+	_partialFileName(fileName + ".partial"),
+	_file(NULL),
+	_samplesPerBlock(samplesPerBlock == 0 ? 1 : samplesPerBlock),
+	_offset(0),
+	_sampleCount(0),
+	_firstTimestamp(0)
+{
+	_file = fopen(_partialFileName.c_str(), "wb");
+	if (_file == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create segment file " << _partialFileName;
+		throw errss.str();
+	}
+
+	_timestamps.reserve(_samplesPerBlock);
+	_values.reserve(_samplesPerBlock);
+
+	SegmentFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SEGMENT_MAGIC, sizeof(header.magic));
+	header.byteOrder = SEGMENT_BYTE_ORDER;
+	header.version = SEGMENT_VERSION;
+	header.instanceId = instanceId;
+	header.streamKind = kind;
+	strncpy(header.deviceId, deviceId.c_str(), sizeof(header.deviceId) - 1);
+	strncpy(header.metricId, metricId.c_str(), sizeof(header.metricId) - 1);
+	WriteBytes(&header, sizeof(header));
+}
+
+ColumnarSegmentWriter::~ColumnarSegmentWriter()
+{
+	try
+	{
+		Close();
+	}
+	catch (std::string)
+	{
+		// Nothing more can be done from a destructor - the partial file
+		// is left behind and can still be recovered by a reader.
+	}
+}
+
+void ColumnarSegmentWriter::Append(int64_t timestamp, float value)
+{
+	if (_sampleCount == 0 && _timestamps.empty())
+	{
+		_firstTimestamp = timestamp;
+	}
+
+	_timestamps.push_back(timestamp);
+	_values.push_back(value);
+
+	if (_timestamps.size() >= _samplesPerBlock)
+	{
+		Flush();
+	}
+}
+
+void ColumnarSegmentWriter::Append(int64_t firstTimestamp, int64_t period,
+	const float *values, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Append(firstTimestamp + period * i, values[i]);
+	}
+}
+
+void ColumnarSegmentWriter::Flush()
+{
+	if (_file == NULL || _timestamps.empty())
+	{
+		return;
+	}
+
+	SegmentBlockHeader block;
+	memset(&block, 0, sizeof(block));
+	block.firstTimestamp = _timestamps.front();
+	block.lastTimestamp = _timestamps.back();
+	block.sampleCount = (uint32_t)_timestamps.size();
+	block.minValue = _values[0];
+	block.maxValue = _values[0];
+	for (size_t i = 0; i < _values.size(); i++)
+	{
+		block.sum += _values[i];
+		if (_values[i] < block.minValue)
+		{
+			block.minValue = _values[i];
+		}
+		if (_values[i] > block.maxValue)
+		{
+			block.maxValue = _values[i];
+		}
+	}
+
+	// Compress both columns into the scratch buffer, so the block is
+	// written with as few calls as possible
+	_encoded.clear();
+	EncodeTimestamps(_timestamps, _encoded);
+	PadToEightBytes(_encoded, 0);
+	block.timestampBytes = (uint32_t)_encoded.size();
+
+	EncodeValues(_values, _encoded);
+	PadToEightBytes(_encoded, block.timestampBytes);
+	block.valueBytes = (uint32_t)_encoded.size() - block.timestampBytes;
+
+	_blockOffsets.push_back(_offset);
+	WriteBytes(&block, sizeof(block));
+	WriteBytes(&_encoded[0], _encoded.size());
+
+	_sampleCount += _timestamps.size();
+	_timestamps.clear();
+	_values.clear();
+}
+
+void ColumnarSegmentWriter::Close()
+{
+	if (_file == NULL)
+	{
+		return;
+	}
+
+	Flush();
+
+	SegmentFileTrailer trailer;
+	memset(&trailer, 0, sizeof(trailer));
+	trailer.indexOffset = _offset;
+	trailer.sampleCount = _sampleCount;
+	trailer.blockCount = (uint32_t)_blockOffsets.size();
+	memcpy(trailer.magic, SEGMENT_INDEX_MAGIC, sizeof(trailer.magic));
+
+	if (!_blockOffsets.empty())
+	{
+		WriteBytes(&_blockOffsets[0],
+			_blockOffsets.size() * sizeof(uint64_t));
+	}
+	WriteBytes(&trailer, sizeof(trailer));
+
+	fclose(_file);
+	_file = NULL;
+
+	if (!OSRenameFile(_partialFileName, _fileName))
+	{
+		std::stringstream errss;
+		errss << "Failed to rename segment file " << _partialFileName;
+		throw errss.str();
+	}
+}
+
+void ColumnarSegmentWriter::WriteBytes(const void *data, size_t length)
+{
+	if (fwrite(data, 1, length, _file) != length)
+	{
+		std::stringstream errss;
+		errss << "Failed to write segment file " << _partialFileName;
+		throw errss.str();
+	}
+	_offset += length;
+}
+
+// ------------------------------------------------------------------------- //
+// ColumnarSegmentReader
+// ------------------------------------------------------------------------- //
+ColumnarSegmentReader::ColumnarSegmentReader(const std::string &fileName) :
+	_header(NULL),
+	_finished(false)
+{
+	if (!_file.Open(fileName) ||
+		_file.GetSize() < sizeof(SegmentFileHeader))
+	{
+		std::stringstream errss;
+		errss << "Failed to map segment file " << fileName;
+		throw errss.str();
+	}
+
+	const unsigned char *data = _file.GetData();
+	size_t size = _file.GetSize();
+
+	_header = (const SegmentFileHeader *)data;
+	if (memcmp(_header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 ||
+		_header->byteOrder != SEGMENT_BYTE_ORDER ||
+		_header->version != SEGMENT_VERSION)
+	{
+		std::stringstream errss;
+		errss << "Not a segment file, or written on a different platform: "
+			<< fileName;
+		throw errss.str();
+	}
+
+	// A finished segment has a trailer that points to the block index
+	if (size >= sizeof(SegmentFileHeader) + sizeof(SegmentFileTrailer))
+	{
+		const SegmentFileTrailer *trailer = (const SegmentFileTrailer *)
+			(data + size - sizeof(SegmentFileTrailer));
+		if (memcmp(trailer->magic, SEGMENT_INDEX_MAGIC,
+				sizeof(SEGMENT_INDEX_MAGIC)) == 0 &&
+			trailer->indexOffset +
+				(uint64_t)trailer->blockCount * sizeof(uint64_t) +
+				sizeof(SegmentFileTrailer) == size)
+		{
+			const uint64_t *index =
+				(const uint64_t *)(data + trailer->indexOffset);
+			_blocks.reserve(trailer->blockCount);
+			for (uint32_t i = 0; i < trailer->blockCount; i++)
+			{
+				if (index[i] + sizeof(SegmentBlockHeader) >
+					trailer->indexOffset)
+				{
+					break;
+				}
+				_blocks.push_back(
+					(const SegmentBlockHeader *)(data + index[i]));
+			}
+			_finished = (_blocks.size() == trailer->blockCount);
+		}
+	}
+
+	if (!_finished)
+	{
+		RecoverBlocks();
+	}
+}
+
+// Walks a segment that was not closed, and keeps every complete block
+void ColumnarSegmentReader::RecoverBlocks()
+{
+	const unsigned char *data = _file.GetData();
+	size_t size = _file.GetSize();
+	size_t offset = sizeof(SegmentFileHeader);
+
+	_blocks.clear();
+	while (offset + sizeof(SegmentBlockHeader) <= size)
+	{
+		const SegmentBlockHeader *block =
+			(const SegmentBlockHeader *)(data + offset);
+		size_t next = offset + sizeof(SegmentBlockHeader) +
+			block->timestampBytes + block->valueBytes;
+		if (block->sampleCount == 0 || next > size)
+		{
+			break;
+		}
+		_blocks.push_back(block);
+		offset = next;
+	}
+}
+
+uint64_t ColumnarSegmentReader::GetSampleCount() const
+{
+	uint64_t count = 0;
+	for (size_t i = 0; i < _blocks.size(); i++)
+	{
+		count += _blocks[i]->sampleCount;
+	}
+	return count;
+}
+
+unsigned int ColumnarSegmentReader::DecodeBlock(unsigned int block,
+	int64_t *timestamps,
+	float *values) const
+{
+	const SegmentBlockHeader *header = _blocks[block];
+	const unsigned char *columns = (const unsigned char *)(header + 1);
+
+	if (timestamps != NULL)
+	{
+		DecodeTimestamps(columns, header->timestampBytes,
+			header->firstTimestamp, header->sampleCount, timestamps);
+	}
+	if (values != NULL)
+	{
+		DecodeValues(columns + header->timestampBytes, header->valueBytes,
+			header->sampleCount, values);
+	}
+	return header->sampleCount;
+}
+
+void FindSegmentFiles(const std::string &directory,
+	std::vector<std::string> &segments)
+{
+	std::vector<std::string> entries;
+	if (!OSListDirectory(directory, entries))
+	{
+		return;
+	}
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		std::string path = directory + "/" + entries[i];
+		if (path.size() > 4 && path.compare(path.size() - 4, 4, ".seg") == 0)
+		{
+			segments.push_back(path);
+		} else if (path.size() > 12 &&
+			path.compare(path.size() - 12, 12, ".seg.partial") == 0)
+		{
+			segments.push_back(path);
+		} else
+		{
+			FindSegmentFiles(path, segments);
+		}
+	}
+}
@@ -0,0 +1,252 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef COLUMNAR_SEGMENT_H
+#define COLUMNAR_SEGMENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "OSAPI.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Columnar segment files:
+// A segment file holds the recorded values of a single device metric (one
+// ice::Numeric or ice::SampleArray instance) over a period of time.  Samples
+// are grouped into blocks, and each block stores its timestamps and its
+// values as two separately compressed columns:
+//
+//  - Timestamps are stored as zig-zag varint encoded delta-of-deltas, so a
+//    stream sampled at a constant rate costs about one byte per sample.
+//  - Values are stored as a bit-packed XOR of each float with the previous
+//    one, which removes the sign, exponent and high mantissa bits that
+//    correlated physiological signals share.
+//
+// Each block header also keeps the time range, min, max and sum of the block,
+// so range aggregates can be answered without decompressing whole blocks.
+//
+// Layout of a file:
+//   SegmentFileHeader
+//   SegmentBlockHeader, timestamp column, value column  (repeated)
+//   block index (one 64-bit file offset per block)
+//   SegmentFileTrailer
+//
+// The index and trailer are written when the segment is closed.  A segment
+// without a trailer (for example after a crash) can still be read: the
+// reader recovers every complete block by walking the file from the start.
+//
+// All structures are 8-byte aligned, so a finished segment can be memory-
+// mapped and scanned in place without copying it into application buffers.
+//
+// ------------------------------------------------------------------------- //
+
+// Kind of stream recorded in a segment
+enum SegmentStreamKind
+{
+	SEGMENT_NUMERIC = 1,
+	SEGMENT_SAMPLE_ARRAY = 2
+};
+
+// Identity of the recorded stream.  The string lengths match the bounds of
+// ice::UniqueDeviceIdentifier and ice::MetricIdentifier.
+struct SegmentFileHeader
+{
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t version;
+	int32_t instanceId;
+	uint32_t streamKind;
+	char deviceId[72];
+	char metricId[72];
+};
+
+// Summary of one block of samples, followed in the file by the compressed
+// timestamp and value columns.  Column sizes are padded to 8 bytes.
+struct SegmentBlockHeader
+{
+	int64_t firstTimestamp;
+	int64_t lastTimestamp;
+	double sum;
+	float minValue;
+	float maxValue;
+	uint32_t sampleCount;
+	uint32_t timestampBytes;
+	uint32_t valueBytes;
+	uint32_t reserved;
+};
+
+// Written at the end of a finished segment
+struct SegmentFileTrailer
+{
+	uint64_t indexOffset;
+	uint64_t sampleCount;
+	uint32_t blockCount;
+	uint32_t reserved;
+	char magic[8];
+};
+
+// ------------------------------------------------------------------------- //
+//
+// ColumnarSegmentWriter:
+// Appends samples of one stream to a segment file.  Samples are buffered
+// until a block is full, and then compressed and written with a single
+// write call.  The file is created with a ".partial" suffix and renamed to
+// its final name when the segment is closed, so readers only ever see
+// finished segments under the final name.
+//
+// Timestamps are nanoseconds, and must be appended in increasing order.
+//
+// ------------------------------------------------------------------------- //
+class ColumnarSegmentWriter
+{
+public:
+	// --- Constructor and destructor ---
+	// Creates the segment file, and writes the file header.  Throws a
+	// std::string if the file cannot be created.
+	ColumnarSegmentWriter(const std::string &fileName,
+		SegmentStreamKind kind,
+		const std::string &deviceId,
+		const std::string &metricId,
+		int instanceId,
+		unsigned int samplesPerBlock = 1024);
+
+	// Closes the segment if it has not been closed already
+	~ColumnarSegmentWriter();
+
+	// --- Appending samples ---
+
+	// Append a single value, for example from an ice::Numeric
+	void Append(int64_t timestamp, float value);
+
+	// Append a frame of values sampled at a constant period, for example
+	// from an ice::SampleArray.
+	void Append(int64_t firstTimestamp, int64_t period,
+		const float *values, unsigned int count);
+
+	// --- Finishing the segment ---
+
+	// Compresses and writes the samples buffered so far as a block
+	void Flush();
+
+	// Flushes, writes the block index and trailer, and renames the file to
+	// its final name.
+	void Close();
+
+	// --- Statistics ---
+	uint64_t GetSampleCount() const
+	{
+		return _sampleCount;
+	}
+
+	uint64_t GetBytesWritten() const
+	{
+		return _offset;
+	}
+
+	// Timestamp of the first sample in the segment, or zero if empty
+	int64_t GetFirstTimestamp() const
+	{
+		return _firstTimestamp;
+	}
+
+private:
+	// --- Private methods ---
+	void WriteBytes(const void *data, size_t length);
+
+	// --- Private members ---
+
+	// Final and in-progress file names
+	std::string _fileName;
+	std::string _partialFileName;
+	FILE *_file;
+
+	// Samples buffered for the current block
+	unsigned int _samplesPerBlock;
+	std::vector<int64_t> _timestamps;
+	std::vector<float> _values;
+
+	// Encoding scratch buffer, reused between blocks
+	std::vector<unsigned char> _encoded;
+
+	// File offsets of the blocks written so far
+	std::vector<uint64_t> _blockOffsets;
+	uint64_t _offset;
+	uint64_t _sampleCount;
+	int64_t _firstTimestamp;
+};
+
+// ------------------------------------------------------------------------- //
+//
+// ColumnarSegmentReader:
+// Memory-maps a segment file and gives access to its blocks.  Block headers
+// are read directly from the mapped file, and blocks are decompressed
+// straight from the mapping into caller-provided buffers.
+//
+// ------------------------------------------------------------------------- //
+class ColumnarSegmentReader
+{
+public:
+	// --- Constructor ---
+	// Maps the file, and validates the header.  Throws a std::string if the
+	// file is not a segment file.
+	ColumnarSegmentReader(const std::string &fileName);
+
+	// --- Stream information ---
+	const SegmentFileHeader &GetFileHeader() const
+	{
+		return *_header;
+	}
+
+	// True if the segment was closed normally, false if the blocks were
+	// recovered from a partial file.
+	bool IsFinished() const
+	{
+		return _finished;
+	}
+
+	// --- Block access ---
+	unsigned int GetBlockCount() const
+	{
+		return (unsigned int)_blocks.size();
+	}
+
+	const SegmentBlockHeader &GetBlockHeader(unsigned int block) const
+	{
+		return *_blocks[block];
+	}
+
+	uint64_t GetSampleCount() const;
+
+	// Decompresses one block.  Either output pointer may be NULL when only
+	// one column is needed.  The buffers must hold at least sampleCount
+	// elements.  Returns the number of samples decoded.
+	unsigned int DecodeBlock(unsigned int block,
+		int64_t *timestamps,
+		float *values) const;
+
+private:
+	// --- Private methods ---
+	void RecoverBlocks();
+
+	// --- Private members ---
+	OSMappedFile _file;
+	const SegmentFileHeader *_header;
+	std::vector<const SegmentBlockHeader *> _blocks;
+	bool _finished;
+};
+
+// Appends the paths of all segment files under a directory, searching its
+// subdirectories, to segments.  Partial segments are included.
+void FindSegmentFiles(const std::string &directory,
+	std::vector<std::string> &segments);
+
+#endif
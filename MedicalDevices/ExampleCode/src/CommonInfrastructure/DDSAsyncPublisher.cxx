@@ -0,0 +1,449 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include "DDSAsyncPublisher.h"
+
+// ------------------------------------------------------------------------- //
+// Shared state of one publication.  It is referenced by every copy of its
+// future, and by the publisher while it is pending, and is deleted when the
+// last reference is released.
+class PublicationState
+{
+public:
+	PublicationState() :
+		references(0),
+		status(PUBLICATION_PENDING),
+		writer(NULL),
+		deadline(0),
+		listener(NULL)
+	{
+		sequenceNumber.high = 0;
+		sequenceNumber.low = 0;
+	}
+
+	// Protects all the members below
+	OSCondition condition;
+
+	int references;
+	PublicationStatus status;
+	DDS::DataWriter *writer;
+	DDS_SequenceNumber_t sequenceNumber;
+	std::vector<ReaderAcknowledgment> readers;
+	int64_t deadline;
+	PublicationListener *listener;
+};
+
+static void AddReference(PublicationState *state)
+{
+	state->condition.Lock();
+	state->references++;
+	state->condition.Unlock();
+}
+
+static void RemoveReference(PublicationState *state)
+{
+	state->condition.Lock();
+	bool last = (--state->references == 0);
+	state->condition.Unlock();
+	if (last)
+	{
+		delete state;
+	}
+}
+
+// Deadline of a publication that never times out
+static const int64_t NO_DEADLINE = 0x7fffffffffffffffLL;
+
+static int64_t ToNanoseconds(const DDS_Duration_t &duration)
+{
+	return (int64_t)duration.sec * 1000000000LL + duration.nanosec;
+}
+
+static bool IsInfinite(const DDS_Duration_t &duration)
+{
+	return duration.sec == DDS_DURATION_INFINITE_SEC;
+}
+
+// A DataReader has acknowledged a sample when the first sample it has not
+// acknowledged comes after it.  The first unacknowledged sequence number is
+// unknown when the DataReader has acknowledged everything.
+static bool IsAcknowledged(const DDS_SequenceNumber_t &firstUnacknowledged,
+	const DDS_SequenceNumber_t &sample)
+{
+	if (firstUnacknowledged.high < 0)
+	{
+		return true;
+	}
+	if (firstUnacknowledged.high != sample.high)
+	{
+		return firstUnacknowledged.high > sample.high;
+	}
+	return firstUnacknowledged.low > sample.low;
+}
+
+// ------------------------------------------------------------------------- //
+// PublicationFuture
+
+PublicationFuture::PublicationFuture() : _state(NULL)
+{
+}
+
+PublicationFuture::PublicationFuture(PublicationState *state) :
+	_state(state)
+{
+	AddReference(_state);
+}
+
+PublicationFuture::PublicationFuture(const PublicationFuture &rhs) :
+	_state(rhs._state)
+{
+	if (_state != NULL)
+	{
+		AddReference(_state);
+	}
+}
+
+PublicationFuture &PublicationFuture::operator=(const PublicationFuture &rhs)
+{
+	if (rhs._state != NULL)
+	{
+		AddReference(rhs._state);
+	}
+	if (_state != NULL)
+	{
+		RemoveReference(_state);
+	}
+	_state = rhs._state;
+	return *this;
+}
+
+PublicationFuture::~PublicationFuture()
+{
+	if (_state != NULL)
+	{
+		RemoveReference(_state);
+	}
+}
+
+bool PublicationFuture::IsDone() const
+{
+	return GetStatus() != PUBLICATION_PENDING;
+}
+
+PublicationStatus PublicationFuture::GetStatus() const
+{
+	if (_state == NULL)
+	{
+		return PUBLICATION_FAILED;
+	}
+	_state->condition.Lock();
+	PublicationStatus status = _state->status;
+	_state->condition.Unlock();
+	return status;
+}
+
+PublicationStatus PublicationFuture::Wait(const DDS_Duration_t &timeout) const
+{
+	if (_state == NULL)
+	{
+		return PUBLICATION_FAILED;
+	}
+
+	int64_t end = OSGetMonotonicTime() + ToNanoseconds(timeout);
+
+	_state->condition.Lock();
+	while (_state->status == PUBLICATION_PENDING)
+	{
+		if (IsInfinite(timeout))
+		{
+			_state->condition.Wait();
+			continue;
+		}
+		int64_t remaining = end - OSGetMonotonicTime();
+		if (remaining <= 0)
+		{
+			break;
+		}
+		_state->condition.TimedWait(remaining);
+	}
+	PublicationStatus status = _state->status;
+	_state->condition.Unlock();
+	return status;
+}
+
+void PublicationFuture::GetReaderAcknowledgments(
+	std::vector<ReaderAcknowledgment> &readers) const
+{
+	readers.clear();
+	if (_state == NULL)
+	{
+		return;
+	}
+	_state->condition.Lock();
+	readers = _state->readers;
+	_state->condition.Unlock();
+}
+
+DDS_SequenceNumber_t PublicationFuture::GetSequenceNumber() const
+{
+	DDS_SequenceNumber_t sequenceNumber = {0, 0};
+	if (_state != NULL)
+	{
+		sequenceNumber = _state->sequenceNumber;
+	}
+	return sequenceNumber;
+}
+
+// ------------------------------------------------------------------------- //
+// DDSAsyncPublisher
+
+DDSAsyncPublisher::DDSAsyncPublisher(const DDS_Duration_t &checkPeriod) :
+	_checkPeriod(ToNanoseconds(checkPeriod)),
+	_running(true)
+{
+	_thread = new OSThread(CheckThread, this);
+	_thread->Run();
+}
+
+DDSAsyncPublisher::~DDSAsyncPublisher()
+{
+	_condition.Lock();
+	_running = false;
+	_condition.Signal();
+	_condition.Unlock();
+
+	_thread->Join();
+	delete _thread;
+
+	// Nothing else can add or check publications now
+	while (!_pending.empty())
+	{
+		PublicationState *state = _pending.front();
+		_pending.pop_front();
+		Complete(state, PUBLICATION_FAILED);
+	}
+}
+
+unsigned int DDSAsyncPublisher::GetPendingCount()
+{
+	_condition.Lock();
+	unsigned int count = (unsigned int)_pending.size();
+	_condition.Unlock();
+	return count;
+}
+
+// ----------------------------------------------------------------------------
+// Best-effort DataReaders never acknowledge samples, so only the reliable
+// ones are waited for.
+void DDSAsyncPublisher::GetReliableReaders(DDS::DataWriter *writer,
+	std::vector<DDS_InstanceHandle_t> &readers)
+{
+	DDS_InstanceHandleSeq handles;
+	if (writer->get_matched_subscriptions(handles) != DDS_RETCODE_OK)
+	{
+		return;
+	}
+
+	for (int i = 0; i < handles.length(); i++)
+	{
+		DDS_SubscriptionBuiltinTopicData data =
+			DDS_SubscriptionBuiltinTopicData_INITIALIZER;
+		if (writer->get_matched_subscription_data(data, handles[i])
+				== DDS_RETCODE_OK &&
+			data.reliability.kind == DDS_RELIABLE_RELIABILITY_QOS)
+		{
+			readers.push_back(handles[i]);
+		}
+		DDS_SubscriptionBuiltinTopicData_finalize(&data);
+	}
+}
+
+PublicationFuture DDSAsyncPublisher::Track(DDS::DataWriter *writer,
+	DDS_ReturnCode_t writeResult,
+	const DDS_SequenceNumber_t &sequenceNumber,
+	const std::vector<DDS_InstanceHandle_t> &readers,
+	const DDS_Duration_t &deadline,
+	PublicationListener *listener)
+{
+	PublicationState *state = new PublicationState();
+	state->writer = writer;
+	state->sequenceNumber = sequenceNumber;
+	state->listener = listener;
+	state->deadline = IsInfinite(deadline) ? NO_DEADLINE :
+		OSGetMonotonicTime() + ToNanoseconds(deadline);
+
+	for (size_t i = 0; i < readers.size(); i++)
+	{
+		ReaderAcknowledgment reader;
+		reader.reader = readers[i];
+		reader.status = PUBLICATION_PENDING;
+		state->readers.push_back(reader);
+	}
+
+	PublicationFuture future(state);
+
+	// A failed write, or a write with no reliable DataReader to wait for,
+	// completes right away
+	if (writeResult != DDS_RETCODE_OK || readers.empty())
+	{
+		AddReference(state);
+		Complete(state, writeResult == DDS_RETCODE_OK ?
+			PUBLICATION_ACKNOWLEDGED : PUBLICATION_FAILED);
+		return future;
+	}
+
+	// The publisher keeps a reference while the publication is pending
+	AddReference(state);
+
+	_condition.Lock();
+	bool wasEmpty = _pending.empty();
+	_pending.push_back(state);
+	if (wasEmpty)
+	{
+		_condition.Signal();
+	}
+	_condition.Unlock();
+
+	return future;
+}
+
+void *DDSAsyncPublisher::CheckThread(void *param)
+{
+	DDSAsyncPublisher *publisher = (DDSAsyncPublisher *)param;
+	publisher->CheckPending();
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Background thread.  Pending publications are moved out of the list while
+// they are checked, so writers are never blocked by the checks.
+void DDSAsyncPublisher::CheckPending()
+{
+	_condition.Lock();
+	while (_running)
+	{
+		if (_pending.empty())
+		{
+			_condition.Wait();
+			continue;
+		}
+
+		std::list<PublicationState *> checking;
+		checking.swap(_pending);
+		_condition.Unlock();
+
+		int64_t now = OSGetMonotonicTime();
+		std::list<PublicationState *>::iterator it = checking.begin();
+		while (it != checking.end())
+		{
+			if (CheckPublication(*it, now))
+			{
+				it = checking.erase(it);
+			} else
+			{
+				++it;
+			}
+		}
+
+		_condition.Lock();
+		_pending.splice(_pending.begin(), checking);
+		if (_running && !_pending.empty())
+		{
+			_condition.TimedWait(_checkPeriod);
+		}
+	}
+	_condition.Unlock();
+}
+
+// ----------------------------------------------------------------------------
+// Updates the state of each DataReader of a publication, and completes the
+// publication if no DataReader is pending or the deadline has passed.
+// Returns true if the publication was completed.
+bool DDSAsyncPublisher::CheckPublication(PublicationState *state,
+	int64_t now)
+{
+	bool pending = false;
+	bool unmatched = false;
+	bool timedOut = false;
+
+	state->condition.Lock();
+	for (size_t i = 0; i < state->readers.size(); i++)
+	{
+		ReaderAcknowledgment &reader = state->readers[i];
+		if (reader.status == PUBLICATION_PENDING)
+		{
+			DDS_DataWriterProtocolStatus status;
+			if (state->writer->
+				get_matched_subscription_datawriter_protocol_status(
+					status, reader.reader) != DDS_RETCODE_OK)
+			{
+				reader.status = PUBLICATION_UNMATCHED;
+			}
+			else if (IsAcknowledged(
+				status.first_unacknowledged_sample_sequence_number,
+				state->sequenceNumber))
+			{
+				reader.status = PUBLICATION_ACKNOWLEDGED;
+			}
+			else if (now >= state->deadline)
+			{
+				reader.status = PUBLICATION_TIMED_OUT;
+			}
+		}
+
+		pending = pending || reader.status == PUBLICATION_PENDING;
+		unmatched = unmatched || reader.status == PUBLICATION_UNMATCHED;
+		timedOut = timedOut || reader.status == PUBLICATION_TIMED_OUT;
+	}
+	state->condition.Unlock();
+
+	if (pending)
+	{
+		return false;
+	}
+
+	if (timedOut)
+	{
+		Complete(state, PUBLICATION_TIMED_OUT);
+	} else if (unmatched)
+	{
+		Complete(state, PUBLICATION_UNMATCHED);
+	} else
+	{
+		Complete(state, PUBLICATION_ACKNOWLEDGED);
+	}
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// Sets the final status, wakes anyone waiting on the future, notifies the
+// listener, and releases the publisher's reference to the publication.
+void DDSAsyncPublisher::Complete(PublicationState *state,
+	PublicationStatus status)
+{
+	state->condition.Lock();
+	state->status = status;
+	for (size_t i = 0; i < state->readers.size(); i++)
+	{
+		if (state->readers[i].status == PUBLICATION_PENDING)
+		{
+			state->readers[i].status = status;
+		}
+	}
+	state->condition.Broadcast();
+	state->condition.Unlock();
+
+	if (state->listener != NULL)
+	{
+		state->listener->OnPublicationComplete(PublicationFuture(state));
+	}
+
+	RemoveReference(state);
+}
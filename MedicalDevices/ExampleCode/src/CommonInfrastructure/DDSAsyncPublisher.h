@@ -0,0 +1,221 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_ASYNC_PUBLISHER_H
+#define DDS_ASYNC_PUBLISHER_H
+
+#include <list>
+#include <vector>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "OSAPI.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Asynchronous publication with acknowledgment:
+// A DataWriter's write call returns as soon as the sample is queued, and the
+// only standard way to know that reliable DataReaders have received it is
+// wait_for_acknowledgments, which blocks the writing thread until every
+// sample of the DataWriter is acknowledged.
+//
+// The DDSAsyncPublisher writes a sample and immediately returns a
+// PublicationFuture.  The future completes when every reliable DataReader
+// that was matched at the time of the write has acknowledged the sample, or
+// when the deadline of the write passes.  The result says, for each of those
+// DataReaders, whether it acknowledged the sample, did not acknowledge it
+// before the deadline, or stopped matching the DataWriter.
+//
+// A single background thread per DDSAsyncPublisher completes all pending
+// futures, for any number of DataWriters.  It checks the acknowledgment state
+// that the middleware keeps for each matched DataReader (see
+// get_matched_subscription_datawriter_protocol_status), so checking is cheap
+// and never blocks the middleware.
+//
+// ------------------------------------------------------------------------- //
+
+// State of a publication, or of one DataReader of a publication
+enum PublicationStatus
+{
+	// Not yet acknowledged, and the deadline has not passed
+	PUBLICATION_PENDING,
+
+	// Acknowledged by every reliable DataReader matched at the time of the
+	// write (or by this DataReader)
+	PUBLICATION_ACKNOWLEDGED,
+
+	// The deadline passed before every DataReader acknowledged the sample
+	PUBLICATION_TIMED_OUT,
+
+	// A DataReader stopped matching the DataWriter before acknowledging the
+	// sample
+	PUBLICATION_UNMATCHED,
+
+	// The write itself failed, or the publisher was deleted before the
+	// publication completed
+	PUBLICATION_FAILED
+};
+
+// Acknowledgment state of one DataReader for one publication
+struct ReaderAcknowledgment
+{
+	DDS_InstanceHandle_t reader;
+	PublicationStatus status;
+};
+
+class DDSAsyncPublisher;
+class PublicationState;
+
+// ------------------------------------------------------------------------- //
+//
+// PublicationFuture:
+// Handle to the result of one asynchronous write.  Futures can be copied
+// freely, and remain valid after the DDSAsyncPublisher that created them is
+// deleted.
+//
+// ------------------------------------------------------------------------- //
+class PublicationFuture
+{
+public:
+	// --- Constructors and destructor ---
+	// A default-constructed future is not associated with any publication
+	PublicationFuture();
+	PublicationFuture(const PublicationFuture &rhs);
+	PublicationFuture &operator=(const PublicationFuture &rhs);
+	~PublicationFuture();
+
+	bool IsValid() const
+	{
+		return _state != NULL;
+	}
+
+	// --- Result of the publication ---
+
+	// True once the status is no longer PUBLICATION_PENDING
+	bool IsDone() const;
+
+	PublicationStatus GetStatus() const;
+
+	// Blocks the calling thread up to the timeout for the publication to
+	// complete, and returns its status
+	PublicationStatus Wait(const DDS_Duration_t &timeout) const;
+
+	// The state of each reliable DataReader that was matched when the sample
+	// was written
+	void GetReaderAcknowledgments(
+		std::vector<ReaderAcknowledgment> &readers) const;
+
+	// Sequence number of the sample written
+	DDS_SequenceNumber_t GetSequenceNumber() const;
+
+private:
+	friend class DDSAsyncPublisher;
+
+	// --- Private constructor ---
+	PublicationFuture(PublicationState *state);
+
+	// --- Private members ---
+	PublicationState *_state;
+};
+
+// ------------------------------------------------------------------------- //
+//
+// PublicationListener:
+// Optional callback for the completion of a publication.  It is called from
+// the background thread of the DDSAsyncPublisher, so it should return
+// quickly.  A publication that completes immediately calls it from Publish.
+//
+// ------------------------------------------------------------------------- //
+class PublicationListener
+{
+public:
+	virtual ~PublicationListener()
+	{
+	}
+
+	virtual void OnPublicationComplete(const PublicationFuture &future) = 0;
+};
+
+// ------------------------------------------------------------------------- //
+//
+// DDSAsyncPublisher:
+// Writes samples with any typed DataWriter, and completes the futures of the
+// writes from one background thread.
+//
+// ------------------------------------------------------------------------- //
+class DDSAsyncPublisher
+{
+public:
+	// --- Constructor and destructor ---
+	// The background thread checks pending publications every checkPeriod
+	DDSAsyncPublisher(const DDS_Duration_t &checkPeriod);
+
+	// Stops the background thread.  Publications that are still pending
+	// complete with PUBLICATION_FAILED.
+	~DDSAsyncPublisher();
+
+	// --- Asynchronous write ---
+	// Writes the sample, and returns a future that completes when all
+	// reliable DataReaders matched now have acknowledged it, or when the
+	// deadline (relative to now) passes.  This never blocks on
+	// acknowledgments.  If there is no reliable DataReader to wait for, or
+	// the write fails, the future is already complete when this returns.
+	// The DataWriter must not be deleted while it has pending publications.
+	template <typename T>
+	PublicationFuture Publish(typename T::DataWriter *writer,
+		const T &sample,
+		const DDS_Duration_t &deadline,
+		PublicationListener *listener = NULL)
+	{
+		// The readers that must acknowledge the sample are the ones matched
+		// before the write
+		std::vector<DDS_InstanceHandle_t> readers;
+		GetReliableReaders(writer, readers);
+
+		DDS_WriteParams_t params = DDS_WRITEPARAMS_DEFAULT;
+		params.replace_auto = DDS_BOOLEAN_TRUE;
+		DDS_ReturnCode_t retcode = writer->write_w_params(sample, params);
+
+		return Track(writer, retcode, params.identity.sequence_number,
+			readers, deadline, listener);
+	}
+
+	// --- Statistics ---
+	unsigned int GetPendingCount();
+
+private:
+	// --- Private methods ---
+	static void GetReliableReaders(DDS::DataWriter *writer,
+		std::vector<DDS_InstanceHandle_t> &readers);
+
+	PublicationFuture Track(DDS::DataWriter *writer,
+		DDS_ReturnCode_t writeResult,
+		const DDS_SequenceNumber_t &sequenceNumber,
+		const std::vector<DDS_InstanceHandle_t> &readers,
+		const DDS_Duration_t &deadline,
+		PublicationListener *listener);
+
+	static void *CheckThread(void *param);
+	void CheckPending();
+	bool CheckPublication(PublicationState *state, int64_t now);
+	void Complete(PublicationState *state, PublicationStatus status);
+
+	// --- Private members ---
+	int64_t _checkPeriod;
+
+	// Protects the pending list and the running flag, and wakes the
+	// background thread when there is work or when it must stop
+	OSCondition _condition;
+	std::list<PublicationState *> _pending;
+	bool _running;
+
+	OSThread *_thread;
+};
+
+#endif
@@ -143,11 +143,105 @@ DomainParticipant* DDSCommunicator::CreateParticipant(long domain,
 	const std::string &participantQosLibrary, 
 	const std::string &participantQosProfile) 
 {
+	LoadQosFiles(fileNames);
+
+	// Actually creating the DomainParticipant
+	return CreateParticipantWithProfile(domain, participantQosLibrary,
+		participantQosProfile);
+}
+
+// ------------------------------------------------------------------------- //
+// Creating a disabled DomainParticipant with a specified domain ID, 
+// specified QoS file names, and specified QoS.  The entities it creates are
+// also disabled until the DomainParticipant is enabled.
+DomainParticipant* DDSCommunicator::CreateDisabledParticipant(long domain, 
+	std::vector<std::string>fileNames, 
+	const std::string &participantQosLibrary, 
+	const std::string &participantQosProfile) 
+{
+	LoadQosFiles(fileNames);
 
-	// Adding a list of explicit file names to the DomainParticipantFactory
-	// This gives the middleware a set of places to search for the files
 	DomainParticipantFactoryQos factoryQos;
 	TheParticipantFactory->get_qos(factoryQos);
+	DDS_Boolean autoenable = 
+		factoryQos.entity_factory.autoenable_created_entities;
+	factoryQos.entity_factory.autoenable_created_entities = DDS_BOOLEAN_FALSE;
+	if (TheParticipantFactory->set_qos(factoryQos) != RETCODE_OK) 
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	try 
+	{
+		CreateParticipantWithProfile(domain, participantQosLibrary,
+			participantQosProfile);
+	}
+	catch (std::string message)
+	{
+		factoryQos.entity_factory.autoenable_created_entities = autoenable;
+		TheParticipantFactory->set_qos(factoryQos);
+		throw message;
+	}
+
+	// Only the DomainParticipant is created disabled.  The entities created
+	// from a disabled DomainParticipant are disabled too, and are enabled
+	// with it because its own entity_factory QoS is not changed.
+	factoryQos.entity_factory.autoenable_created_entities = autoenable;
+	TheParticipantFactory->set_qos(factoryQos);
+
+	return _participant;
+}
+
+// ------------------------------------------------------------------------- //
+// Enabling a DomainParticipant that was created disabled.  This starts
+// discovery, and announces all the entities created so far at once.
+void DDSCommunicator::EnableParticipant()
+{
+	if (GetParticipant() == NULL) 
+	{
+		std::stringstream errss;
+		errss << 
+			"DomainParticipant NULL - communicator not properly " << 
+				"initialized";
+		throw errss.str();
+	}
+
+	StartupPhaseTimer timer(_startupProfile, "participant enable");
+	if (GetParticipant()->enable() != RETCODE_OK) 
+	{
+		std::stringstream errss;
+		errss << "Failed to enable DomainParticipant";
+		throw errss.str();
+	}
+}
+
+// ------------------------------------------------------------------------- //
+// Adding a list of explicit file names to the DomainParticipantFactory, and
+// parsing them.  The factory keeps the parsed profiles, so when the same
+// files are already loaded (for example, by an earlier communicator in the
+// same process) nothing is parsed again.
+void DDSCommunicator::LoadQosFiles(const std::vector<std::string> &fileNames)
+{
+	StartupPhaseTimer timer(_startupProfile, "QoS load");
+
+	DomainParticipantFactoryQos factoryQos;
+	TheParticipantFactory->get_qos(factoryQos);
+
+	bool loaded = 
+		(factoryQos.profile.url_profile.length() == (int)fileNames.size());
+	for (unsigned int i = 0; loaded && i < fileNames.size(); i++) 
+	{
+		loaded = (factoryQos.profile.url_profile[i] != NULL &&
+			fileNames[i] == factoryQos.profile.url_profile[i]);
+	}
+	if (loaded) 
+	{
+		return;
+	}
+
+	// This gives the middleware a set of places to search for the files
 	factoryQos.profile.url_profile.ensure_length(fileNames.size(),
 												fileNames.size());
 
@@ -168,7 +262,26 @@ DomainParticipant* DDSCommunicator::CreateParticipant(long domain,
 		throw errss.str();
 	}
 
-	// Actually creating the DomainParticipant
+	// Parsing the files now rather than when the first entity is created,
+	// so errors in the files and the parsing time show up here
+	retcode = TheParticipantFactory->load_profiles();
+	if (retcode != RETCODE_OK) 
+	{
+		std::stringstream errss;
+		errss << "Failed to load QoS profiles";
+		throw errss.str();
+	}
+}
+
+// ------------------------------------------------------------------------- //
+// Creating the DomainParticipant from QoS profiles that are already loaded
+DomainParticipant* DDSCommunicator::CreateParticipantWithProfile(
+	long domain, 
+	const std::string &participantQosLibrary, 
+	const std::string &participantQosProfile) 
+{
+	StartupPhaseTimer timer(_startupProfile, "participant creation");
+
 	_participant = 
 		TheParticipantFactory->create_participant_with_profile(
 									domain, 
@@ -185,7 +298,6 @@ DomainParticipant* DDSCommunicator::CreateParticipant(long domain,
 	} 
 
 	return _participant;
-
 }
 
 
@@ -207,6 +319,7 @@ Publisher* DDSCommunicator::CreatePublisher()
 	// This object is used to create type-specific DataWriter objects that 
 	// can actually send data.  
 	// 
+	StartupPhaseTimer timer(_startupProfile, "entity creation");
 	_pub = GetParticipant()->create_publisher(
 									PUBLISHER_QOS_DEFAULT, 
 									NULL, STATUS_MASK_NONE);	
@@ -241,6 +354,7 @@ Publisher* DDSCommunicator::CreatePublisher(
 	// This object is used to create type-specific DataWriter objects that 
 	// can actually send data.  
 	// 
+	StartupPhaseTimer timer(_startupProfile, "entity creation");
 	_pub = GetParticipant()->create_publisher_with_profile(
 						qosLibrary.c_str(), 
 						qosProfile.c_str(),
@@ -277,6 +391,7 @@ Subscriber* DDSCommunicator::CreateSubscriber()
 	//  in the DDSCommunicator class because one Subscriber can be used to
 	//  create multiple DDS DataReaders. 
 	// 
+	StartupPhaseTimer timer(_startupProfile, "entity creation");
 	_sub = GetParticipant()->create_subscriber(
 								SUBSCRIBER_QOS_DEFAULT, 
 								NULL, STATUS_MASK_NONE);	
@@ -313,6 +428,7 @@ Subscriber* DDSCommunicator::CreateSubscriber(
 	//  in the DDSCommunicator class because one Subscriber can be used to
 	//  create multiple DDS DataReaders. 
 	// 
+	StartupPhaseTimer timer(_startupProfile, "entity creation");
 	_sub = GetParticipant()->create_subscriber_with_profile(
 						qosLibrary.c_str(), 
 						qosProfile.c_str(), 
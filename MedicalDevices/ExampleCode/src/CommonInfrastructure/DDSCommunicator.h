@@ -17,7 +17,7 @@
 #include <map>
 #include "ndds/ndds_cpp.h"
 #include "ndds/ndds_namespace_cpp.h"
-
+#include "StartupProfile.h"
 
 // ------------------------------------------------------------------------- //
 // Function that is used to unregister types from the DomainParticipant.
@@ -55,7 +55,8 @@ class DDSCommunicator
 
 public:
 	// --- Constructor and Destructor --- 
-	DDSCommunicator() : _participant(NULL), _pub(NULL), _sub(NULL)
+	DDSCommunicator() : _participant(NULL), _pub(NULL), _sub(NULL),
+		_startupProfile(NULL)
 	{}
 
 	~DDSCommunicator();
@@ -96,6 +97,36 @@ public:
 		const std::string &participantQosLibrary, 
 		const std::string &participantQosProfile);
 
+	// Same as above, but the DomainParticipant is created disabled: it does
+	// not start discovery, and the entities created from it are not
+	// announced, until EnableParticipant() is called.  This lets an
+	// application create all of its Topics, DataWriters and DataReaders
+	// first, so remote applications discover them in the first discovery
+	// round instead of one at a time.
+	DDS::DomainParticipant* CreateDisabledParticipant(long domain, 
+		std::vector<std::string>fileNames, 
+		const std::string &participantQosLibrary, 
+		const std::string &participantQosProfile);
+
+	// Enables a DomainParticipant created disabled, and all the entities
+	// created from it
+	void EnableParticipant();
+
+	// --- Profiling startup --- 
+
+	// Records the time spent loading QoS, creating the DomainParticipant,
+	// registering types and creating entities into the profile.  The profile
+	// is not owned by the communicator, and may be NULL.
+	void SetStartupProfile(StartupProfile *profile)
+	{
+		_startupProfile = profile;
+	}
+
+	StartupProfile *GetStartupProfile()
+	{
+		return _startupProfile;
+	}
+
 	// --- Getting the DomainParticipant --- 
 
 	// Returns the DomainParticipant created by the Communicator.
@@ -160,21 +191,28 @@ public:
 		// serialize/deserialize this data type.
 		const char *typeName = T::TypeSupport::get_type_name();
 
-		DDS_ReturnCode_t retcode = T::TypeSupport::register_type(
-				GetParticipant(), typeName);
-		if (retcode != DDS_RETCODE_OK) 
 		{
-			std::stringstream errss;
-			errss << "Failure to register type. Regisetered twice?";
-			throw errss.str();
+			StartupPhaseTimer timer(_startupProfile, "type registration");
+			DDS_ReturnCode_t retcode = T::TypeSupport::register_type(
+					GetParticipant(), typeName);
+			if (retcode != DDS_RETCODE_OK) 
+			{
+				std::stringstream errss;
+				errss << "Failure to register type. Regisetered twice?";
+				throw errss.str();
+			}
 		}
 
 		// Create the Topic object, using the associated data type that
 		// was registered above.
-		DDS::Topic *topic = GetParticipant()->create_topic(
-			topicName.c_str(),
-			typeName, DDS_TOPIC_QOS_DEFAULT, NULL /* listener */,
-			DDS_STATUS_MASK_NONE);
+		DDS::Topic *topic = NULL;
+		{
+			StartupPhaseTimer timer(_startupProfile, "entity creation");
+			topic = GetParticipant()->create_topic(
+				topicName.c_str(),
+				typeName, DDS_TOPIC_QOS_DEFAULT, NULL /* listener */,
+				DDS_STATUS_MASK_NONE);
+		}
 		if (topic == NULL) 
 		{
 			std::stringstream errss;
@@ -197,6 +235,14 @@ public:
 private:
 	// --- Private methods ---
 
+	// Loads the QoS XML files, unless the DomainParticipantFactory already
+	// has exactly these files loaded
+	void LoadQosFiles(const std::vector<std::string> &fileNames);
+
+	DDS::DomainParticipant* CreateParticipantWithProfile(long domain, 
+		const std::string &participantQosLibrary, 
+		const std::string &participantQosProfile);
+
 
 	// --- Private members ---
 
@@ -215,6 +261,9 @@ private:
 	// that would otherwise appear as a memory leak at shutdown.
 	std::map<std::string, UnregisterInfo> _typeCleanupFunctions;
 
+	// Not owned, may be NULL
+	StartupProfile *_startupProfile;
+
 
 };
 
@@ -0,0 +1,178 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_GENERIC_DATA_READER_H
+#define DDS_GENERIC_DATA_READER_H
+
+#include <sstream>
+#include <string>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "DDSCommunicator.h"
+#include "DDSLoanedBatch.h"
+
+// ------------------------------------------------------------------------- //
+//
+// GenericDataReader:
+// A DataReader of type T, the C++ counterpart of the GenericDataReader of
+// the Java applications.  It creates the DataReader with a QoS profile, and
+// takes samples in loaned batches: the samples stay in the DataReader's
+// buffers, and the batch returns them when it is destroyed or filled again,
+// so reading data never copies it.
+//
+//     GenericDataReader<ice::Numeric> reader(communicator,
+//         ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+//     LoanedBatch<ice::Numeric> batch;
+//     while (reader.Take(batch))
+//     {
+//         for (const ice::Numeric &numeric : batch)
+//         {
+//             ...
+//         }
+//     }
+//
+// Each take returns at most the maximum batch size samples, so a reader
+// that is flooded still returns its loans, and gives other readers a turn,
+// at regular intervals.  The reader has a ReadCondition that triggers when
+// there is any sample in its queue, to attach to a WaitSet or a DDSReactor.
+//
+// ------------------------------------------------------------------------- //
+template <typename T>
+class GenericDataReader
+{
+public:
+	// --- Constructors and destructor ---
+	// Creates the Topic from the communicator, and the DataReader from the
+	// communicator's Subscriber, which is created with default QoS if the
+	// communicator has none yet.  Throws a std::string on failure.
+	GenericDataReader(DDSCommunicator *communicator,
+		const std::string &topicName, const std::string &qosLibrary,
+		const std::string &qosProfile,
+		DDS_Long maxBatchSize = DDS_LENGTH_UNLIMITED) :
+		_maxBatchSize(maxBatchSize)
+	{
+		DDS::Subscriber *sub = communicator->GetSubscriber();
+		if (sub == NULL)
+		{
+			sub = communicator->CreateSubscriber();
+		}
+		DDS::Topic *topic = communicator->CreateTopic<T>(topicName);
+
+		StartupPhaseTimer timer(communicator->GetStartupProfile(),
+			"entity creation");
+		Create(sub, topic, qosLibrary, qosProfile);
+	}
+
+	// Creates the DataReader from a Subscriber, for a Topic or
+	// ContentFilteredTopic that already exists.  Throws a std::string on
+	// failure.
+	GenericDataReader(DDS::Subscriber *sub, DDS::TopicDescription *topic,
+		const std::string &qosLibrary, const std::string &qosProfile,
+		DDS_Long maxBatchSize = DDS_LENGTH_UNLIMITED) :
+		_maxBatchSize(maxBatchSize)
+	{
+		Create(sub, topic, qosLibrary, qosProfile);
+	}
+
+	~GenericDataReader()
+	{
+		_waitSet.detach_condition(_condition);
+		_reader->delete_readcondition(_condition);
+
+		DDS::Subscriber *sub = _reader->get_subscriber();
+		sub->delete_datareader(_reader);
+		_reader = NULL;
+	}
+
+	// --- Take ---
+	// Returns the previous loan of the batch, and takes up to the maximum
+	// batch size samples.  Returns false if there were no samples.  Throws
+	// a std::string if the DataReader fails.
+	bool Take(LoanedBatch<T> &batch)
+	{
+		return batch.TakeNext(_reader, _condition, _maxBatchSize);
+	}
+
+	// Same as above, for the samples that match a condition created from
+	// this reader
+	bool Take(LoanedBatch<T> &batch, DDS::ReadCondition *condition)
+	{
+		return batch.TakeNext(_reader, condition, _maxBatchSize);
+	}
+
+	// --- Wait ---
+	// Blocks until there is data to take, or the timeout passes.  Returns
+	// false on timeout.
+	bool WaitForData(const DDS_Duration_t &timeout)
+	{
+		DDS::ConditionSeq activeConditions;
+		return _waitSet.wait(activeConditions, timeout) == DDS_RETCODE_OK;
+	}
+
+	// --- Settings ---
+	// Largest number of samples in a batch, DDS_LENGTH_UNLIMITED for all
+	// the samples available
+	void SetMaxBatchSize(DDS_Long maxBatchSize)
+	{
+		_maxBatchSize = maxBatchSize;
+	}
+
+	DDS_Long GetMaxBatchSize() const
+	{
+		return _maxBatchSize;
+	}
+
+	// --- Accessors ---
+	// Triggers when there is any sample in the DataReader's queue
+	DDS::ReadCondition *GetCondition()
+	{
+		return _condition;
+	}
+
+	typename T::DataReader *GetDataReader()
+	{
+		return _reader;
+	}
+
+private:
+	// --- Not copyable ---
+	GenericDataReader(const GenericDataReader &);
+	GenericDataReader &operator=(const GenericDataReader &);
+
+	// --- Private methods ---
+	void Create(DDS::Subscriber *sub, DDS::TopicDescription *topic,
+		const std::string &qosLibrary, const std::string &qosProfile)
+	{
+		_reader = T::DataReader::narrow(sub->create_datareader_with_profile(
+			topic, qosLibrary.c_str(), qosProfile.c_str(), NULL,
+			DDS_STATUS_MASK_NONE));
+		if (_reader == NULL)
+		{
+			std::stringstream errss;
+			errss << "Failure to create " << topic->get_name() <<
+				" reader. Inconsistent Qos?";
+			throw errss.str();
+		}
+
+		// Samples that only report an instance state change have no valid
+		// data, so the condition triggers on any state
+		_condition = _reader->create_readcondition(DDS_ANY_SAMPLE_STATE,
+			DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+		_waitSet.attach_condition(_condition);
+	}
+
+	// --- Private members ---
+	typename T::DataReader *_reader;
+	DDS::ReadCondition *_condition;
+	DDS::WaitSet _waitSet;
+	DDS_Long _maxBatchSize;
+};
+
+#endif
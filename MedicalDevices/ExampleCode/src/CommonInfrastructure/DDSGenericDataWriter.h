@@ -0,0 +1,165 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_GENERIC_DATA_WRITER_H
+#define DDS_GENERIC_DATA_WRITER_H
+
+#include <sstream>
+#include <string>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "DDSCommunicator.h"
+
+// ------------------------------------------------------------------------- //
+//
+// GenericDataWriter:
+// A DataWriter of type T, the C++ counterpart of the GenericDataWriter of
+// the Java applications.  It creates the DataWriter with a QoS profile.
+//
+// A writer that sends the same instances again and again, such as the
+// numerics of a device, should register each instance once and write it
+// with its handle: the middleware then does not look the instance up from
+// its key on every write.  The handle of an instance is only valid with
+// the writer that registered it.
+//
+// Write, Dispose and Unregister return false if the DataWriter fails, the
+// same way as the publishing interfaces.
+//
+// ------------------------------------------------------------------------- //
+template <typename T>
+class GenericDataWriter
+{
+public:
+	// --- Constructors and destructor ---
+	// Creates the Topic from the communicator, and the DataWriter from the
+	// communicator's Publisher, which is created with default QoS if the
+	// communicator has none yet.  Throws a std::string on failure.
+	GenericDataWriter(DDSCommunicator *communicator,
+		const std::string &topicName, const std::string &qosLibrary,
+		const std::string &qosProfile)
+	{
+		DDS::Publisher *pub = communicator->GetPublisher();
+		if (pub == NULL)
+		{
+			pub = communicator->CreatePublisher();
+		}
+		DDS::Topic *topic = communicator->CreateTopic<T>(topicName);
+
+		StartupPhaseTimer timer(communicator->GetStartupProfile(),
+			"entity creation");
+		Create(pub, topic, qosLibrary, qosProfile);
+	}
+
+	// Creates the DataWriter from a Publisher, for a Topic that already
+	// exists.  Throws a std::string on failure.
+	GenericDataWriter(DDS::Publisher *pub, DDS::Topic *topic,
+		const std::string &qosLibrary, const std::string &qosProfile)
+	{
+		Create(pub, topic, qosLibrary, qosProfile);
+	}
+
+	~GenericDataWriter()
+	{
+		DDS::Publisher *pub = _writer->get_publisher();
+		pub->delete_datawriter(_writer);
+		_writer = NULL;
+	}
+
+	// --- Instances ---
+	// Returns the handle of the instance with the key of the sample, or
+	// DDS_HANDLE_NIL if it cannot be registered
+	DDS_InstanceHandle_t RegisterInstance(const T &instance)
+	{
+		return _writer->register_instance(instance);
+	}
+
+	// --- Write ---
+	// Sends the sample.  The handle is the one registered for its key, or
+	// DDS_HANDLE_NIL to look the instance up from the key.
+	bool Write(const T &sample,
+		const DDS_InstanceHandle_t &handle = DDS_HANDLE_NIL)
+	{
+		return _writer->write(sample, handle) == DDS_RETCODE_OK;
+	}
+
+	// Same as above, with the source timestamp of the sample
+	bool Write(const T &sample, const DDS_InstanceHandle_t &handle,
+		const DDS_Time_t &sourceTimestamp)
+	{
+		return _writer->write_w_timestamp(sample, handle,
+			sourceTimestamp) == DDS_RETCODE_OK;
+	}
+
+	// Sends count samples, each with the handle at the same index, or with
+	// DDS_HANDLE_NIL if handles is NULL.  Stops at the first failure, and
+	// returns the number of samples sent.
+	unsigned int Write(const T *samples, const DDS_InstanceHandle_t *handles,
+		unsigned int count)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (!Write(samples[i],
+				handles == NULL ? DDS_HANDLE_NIL : handles[i]))
+			{
+				return i;
+			}
+		}
+		return count;
+	}
+
+	// --- Instance lifecycle ---
+	// Tells readers that the instance no longer exists
+	bool Dispose(const T &instance,
+		const DDS_InstanceHandle_t &handle = DDS_HANDLE_NIL)
+	{
+		return _writer->dispose(instance, handle) == DDS_RETCODE_OK;
+	}
+
+	// Tells readers that this writer no longer updates the instance, and
+	// frees its resources in the writer
+	bool Unregister(const T &instance,
+		const DDS_InstanceHandle_t &handle = DDS_HANDLE_NIL)
+	{
+		return _writer->unregister_instance(instance, handle) ==
+			DDS_RETCODE_OK;
+	}
+
+	// --- Accessors ---
+	typename T::DataWriter *GetDataWriter()
+	{
+		return _writer;
+	}
+
+private:
+	// --- Not copyable ---
+	GenericDataWriter(const GenericDataWriter &);
+	GenericDataWriter &operator=(const GenericDataWriter &);
+
+	// --- Private methods ---
+	void Create(DDS::Publisher *pub, DDS::Topic *topic,
+		const std::string &qosLibrary, const std::string &qosProfile)
+	{
+		_writer = T::DataWriter::narrow(pub->create_datawriter_with_profile(
+			topic, qosLibrary.c_str(), qosProfile.c_str(), NULL,
+			DDS_STATUS_MASK_NONE));
+		if (_writer == NULL)
+		{
+			std::stringstream errss;
+			errss << "Failure to create " << topic->get_name() <<
+				" writer. Inconsistent Qos?";
+			throw errss.str();
+		}
+	}
+
+	// --- Private members ---
+	typename T::DataWriter *_writer;
+};
+
+#endif
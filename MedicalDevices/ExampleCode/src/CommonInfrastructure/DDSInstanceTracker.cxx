@@ -0,0 +1,126 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include "DDSInstanceTracker.h"
+
+// ----------------------------------------------------------------------------
+// The maximum replaces the limit of the profile.  The initial instances
+// cannot be more than the maximum.
+DDS::DataReader *CreateInstanceLimitedReader(DDS::Subscriber *sub,
+	DDS::TopicDescription *topic, const std::string &qosLibrary,
+	const std::string &qosProfile, unsigned int maxInstances)
+{
+	DDS_DataReaderQos qos;
+	if (TheParticipantFactory->get_datareader_qos_from_profile(qos,
+		qosLibrary.c_str(), qosProfile.c_str()) != DDS_RETCODE_OK)
+	{
+		return NULL;
+	}
+
+	if (maxInstances != UNLIMITED_INSTANCES)
+	{
+		qos.resource_limits.max_instances = (DDS_Long)maxInstances;
+		if (qos.resource_limits.initial_instances > (DDS_Long)maxInstances)
+		{
+			qos.resource_limits.initial_instances = (DDS_Long)maxInstances;
+		}
+	}
+
+	return sub->create_datareader(topic, qos, NULL, DDS_STATUS_MASK_NONE);
+}
+
+// ----------------------------------------------------------------------------
+InstanceTracker::InstanceTracker(DDS::DataReader *reader,
+	int64_t staleTimeout) :
+	_reader(reader),
+	_staleTimeout(staleTimeout)
+{
+	_metrics.instanceCount = 0;
+	_metrics.peakInstanceCount = 0;
+	_metrics.staleCount = 0;
+	_metrics.addedCount = 0;
+	_metrics.purgedCount = 0;
+	_metrics.readerSampleCount = 0;
+	_metrics.rejectedSampleCount = 0;
+}
+
+InstanceTracker::~InstanceTracker()
+{
+}
+
+// ----------------------------------------------------------------------------
+// Moves the instance to the front of the list, adding it if it is new, or
+// forgets it if it is no longer alive.  An instance that comes back after
+// being forgotten is counted as added again.
+void InstanceTracker::OnSample(const DDS_SampleInfo &info, int64_t now)
+{
+	InstanceIndex::iterator found = _index.find(info.instance_handle);
+
+	if (info.instance_state != DDS_ALIVE_INSTANCE_STATE)
+	{
+		if (found != _index.end())
+		{
+			_instances.erase(found->second);
+			_index.erase(found);
+			_metrics.purgedCount++;
+		}
+		return;
+	}
+
+	if (found != _index.end())
+	{
+		found->second->lastUpdate = now;
+		_instances.splice(_instances.begin(), _instances, found->second);
+		return;
+	}
+
+	TrackedInstance instance;
+	instance.handle = info.instance_handle;
+	instance.lastUpdate = now;
+	_instances.push_front(instance);
+	_index[info.instance_handle] = _instances.begin();
+	_metrics.addedCount++;
+
+	if (_instances.size() > _metrics.peakInstanceCount)
+	{
+		_metrics.peakInstanceCount = (unsigned int)_instances.size();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// The list is ordered by update time, so the stale instances are all at its
+// end
+void InstanceTracker::GetMetrics(InstanceMetrics &metrics, int64_t now) const
+{
+	metrics = _metrics;
+	metrics.instanceCount = (unsigned int)_instances.size();
+
+	metrics.staleCount = 0;
+	if (_staleTimeout > 0)
+	{
+		for (InstanceList::const_reverse_iterator it = _instances.rbegin();
+			it != _instances.rend() && now - it->lastUpdate > _staleTimeout;
+			++it)
+		{
+			metrics.staleCount++;
+		}
+	}
+
+	DDS_DataReaderCacheStatus cacheStatus;
+	if (_reader->get_datareader_cache_status(cacheStatus) == DDS_RETCODE_OK)
+	{
+		metrics.readerSampleCount = cacheStatus.sample_count;
+	}
+	DDS_SampleRejectedStatus rejectedStatus;
+	if (_reader->get_sample_rejected_status(rejectedStatus) == DDS_RETCODE_OK)
+	{
+		metrics.rejectedSampleCount = rejectedStatus.total_count;
+	}
+}
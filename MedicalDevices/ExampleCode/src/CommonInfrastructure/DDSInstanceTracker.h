@@ -0,0 +1,139 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_INSTANCE_TRACKER_H
+#define DDS_INSTANCE_TRACKER_H
+
+#include <string.h>
+#include <list>
+#include <map>
+#include <string>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "OSAPI.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Instance tracker:
+// Keeps track of the instances of a keyed DataReader, such as the ice::Numeric
+// DataReader of a central station, which sees one instance per device, metric
+// and instance ID.  Devices are unplugged and replaced all the time, so
+// without management the instance table of such a DataReader only grows.
+//
+// The DataReader itself keeps its instance table bounded:
+//  - The reader_data_lifecycle QoS of the StreamingData profile purges the
+//    instances that are no longer alive (their DataWriter is gone, or they
+//    were disposed or unregistered).
+//  - CreateInstanceLimitedReader sets resource_limits.max_instances, so an
+//    instance that is alive is never removed, but once the DataReader holds
+//    the maximum, it rejects the samples of new instances.  A reliable
+//    DataReader does not acknowledge the samples it rejects, so their
+//    DataWriters send them again until instances are purged.
+//
+// The application passes the SampleInfo of every sample it takes to the
+// tracker, which counts the alive instances and the instances added and
+// purged, and the instances that have not been updated for the stale
+// timeout.  Stale instances stay in the DataReader until their DataWriter
+// is gone.  The metrics also include the samples the DataReader holds and
+// the samples it rejected, read from its statuses, so a long-running
+// application can show that its DataReader stays within its limits.
+//
+// ------------------------------------------------------------------------- //
+
+// ------------------------------------------------------------------------- //
+// Counters of an instance tracker
+struct InstanceMetrics
+{
+	// Alive instances the application has taken samples of, the most ever
+	// tracked at once, and those not updated for the stale timeout
+	unsigned int instanceCount;
+	unsigned int peakInstanceCount;
+	unsigned int staleCount;
+
+	// Instances first seen, and forgotten because they were no longer alive
+	uint64_t addedCount;
+	uint64_t purgedCount;
+
+	// Samples held by the DataReader, and samples it rejected, such as the
+	// samples of new instances once it holds its maximum of instances
+	int64_t readerSampleCount;
+	int64_t rejectedSampleCount;
+};
+
+// ------------------------------------------------------------------------- //
+// Keeps the instance limit of the QoS profile
+const unsigned int UNLIMITED_INSTANCES = 0;
+
+// Creates a DataReader with the QoS profile, holding at most maxInstances
+// instances.
+// Returns NULL if the DataReader cannot be created.
+DDS::DataReader *CreateInstanceLimitedReader(DDS::Subscriber *sub,
+	DDS::TopicDescription *topic, const std::string &qosLibrary,
+	const std::string &qosProfile, unsigned int maxInstances);
+
+// ------------------------------------------------------------------------- //
+// Tracks the instances of a DataReader
+class InstanceTracker
+{
+public:
+	// --- Constructor and destructor ---
+	// A staleTimeout of zero counts no instance as stale.  Times are in
+	// nanoseconds.
+	InstanceTracker(DDS::DataReader *reader, int64_t staleTimeout = 0);
+	~InstanceTracker();
+
+	// --- Tracking ---
+	// Records a sample taken from the DataReader at time now, including the
+	// samples with no valid data that report a change of instance state.
+	void OnSample(const DDS_SampleInfo &info, int64_t now);
+
+	// --- Metrics ---
+	unsigned int GetInstanceCount() const
+	{
+		return (unsigned int)_instances.size();
+	}
+
+	void GetMetrics(InstanceMetrics &metrics, int64_t now) const;
+
+private:
+	// --- Private types ---
+	struct TrackedInstance
+	{
+		DDS_InstanceHandle_t handle;
+		int64_t lastUpdate;
+	};
+
+	// Most recently updated first
+	typedef std::list<TrackedInstance> InstanceList;
+
+	// Orders handles by their key hash
+	struct HandleLess
+	{
+		bool operator()(const DDS_InstanceHandle_t &left,
+			const DDS_InstanceHandle_t &right) const
+		{
+			return memcmp(&left, &right, sizeof(left.keyHash)) < 0;
+		}
+	};
+
+	typedef std::map<DDS_InstanceHandle_t, InstanceList::iterator,
+		HandleLess> InstanceIndex;
+
+	// --- Private members ---
+	DDS::DataReader *_reader;
+	int64_t _staleTimeout;
+
+	InstanceList _instances;
+	InstanceIndex _index;
+
+	InstanceMetrics _metrics;
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_LOANED_BATCH_H
+#define DDS_LOANED_BATCH_H
+
+#include <sstream>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+
+// ------------------------------------------------------------------------- //
+//
+// LoanedBatch:
+// A batch of samples taken from a DataReader without copying them.  The
+// samples stay in the DataReader's buffers, and are loaned to the batch until
+// it is returned or destroyed, so a batch should be processed and released
+// quickly: the DataReader cannot reuse those buffers until then.
+//
+// A batch cannot be copied.  It is filled by the TakeNext methods, and
+// returned automatically when it is destroyed or filled again.
+//
+// Iterating over a batch, for example with a range-based for loop, visits
+// the data of the samples that have valid data, and skips the samples that
+// only carry an instance state change.  GetData() and GetInfo() give access
+// to every sample by index.
+//
+// ------------------------------------------------------------------------- //
+template <typename T>
+class LoanedBatch
+{
+public:
+	// --- Iterator over the samples with valid data ---
+	class ValidIterator
+	{
+	public:
+		ValidIterator(const LoanedBatch *batch, int index) :
+			_batch(batch), _index(index)
+		{
+			SkipInvalid();
+		}
+
+		const T &operator*() const
+		{
+			return _batch->GetData(_index);
+		}
+
+		const T *operator->() const
+		{
+			return &_batch->GetData(_index);
+		}
+
+		ValidIterator &operator++()
+		{
+			_index++;
+			SkipInvalid();
+			return *this;
+		}
+
+		bool operator==(const ValidIterator &other) const
+		{
+			return _index == other._index;
+		}
+
+		bool operator!=(const ValidIterator &other) const
+		{
+			return _index != other._index;
+		}
+
+		// SampleInfo of the current sample
+		const DDS_SampleInfo &GetInfo() const
+		{
+			return _batch->GetInfo(_index);
+		}
+
+	private:
+		void SkipInvalid()
+		{
+			int length = _batch->GetLength();
+			while (_index < length && !_batch->IsValid(_index))
+			{
+				_index++;
+			}
+		}
+
+		const LoanedBatch *_batch;
+		int _index;
+	};
+
+	// --- Constructor and destructor ---
+	LoanedBatch() : _reader(NULL)
+	{
+	}
+
+	~LoanedBatch()
+	{
+		Return();
+	}
+
+	// --- Take ---
+	// Returns any previous loan, and takes up to maxSamples samples that
+	// match the condition.  Returns false if there were no samples.
+	bool TakeNext(typename T::DataReader *reader,
+		DDS::ReadCondition *condition,
+		DDS_Long maxSamples = DDS_LENGTH_UNLIMITED)
+	{
+		Return();
+
+		DDS_ReturnCode_t retcode = reader->take_w_condition(_data, _info,
+			maxSamples, condition);
+		if (retcode == DDS_RETCODE_NO_DATA)
+		{
+			return false;
+		}
+		if (retcode != DDS_RETCODE_OK)
+		{
+			std::stringstream errss;
+			errss << "LoanedBatch: failure to take data";
+			throw errss.str();
+		}
+		_reader = reader;
+		return true;
+	}
+
+	// Returns the loan to the DataReader.  The batch is empty afterwards.
+	void Return()
+	{
+		if (_reader != NULL)
+		{
+			_reader->return_loan(_data, _info);
+			_reader = NULL;
+		}
+	}
+
+	// --- Accessors ---
+	int GetLength() const
+	{
+		return _reader == NULL ? 0 : _data.length();
+	}
+
+	// Samples that only carry an instance state change (such as a deleted
+	// instance) have no valid data
+	bool IsValid(int i) const
+	{
+		return _info[i].valid_data ? true : false;
+	}
+
+	const T &GetData(int i) const
+	{
+		return _data[i];
+	}
+
+	const DDS_SampleInfo &GetInfo(int i) const
+	{
+		return _info[i];
+	}
+
+	typename T::DataReader *GetReader() const
+	{
+		return _reader;
+	}
+
+	// --- Iteration ---
+	ValidIterator begin() const
+	{
+		return ValidIterator(this, 0);
+	}
+
+	ValidIterator end() const
+	{
+		return ValidIterator(this, GetLength());
+	}
+
+private:
+	// --- Not copyable ---
+	LoanedBatch(const LoanedBatch &);
+	LoanedBatch &operator=(const LoanedBatch &);
+
+	// --- Private members ---
+	typename T::DataReader *_reader;
+	typename T::Seq _data;
+	DDS_SampleInfoSeq _info;
+};
+
+#endif
@@ -0,0 +1,216 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <sstream>
+#include "DDSPatientRouting.h"
+
+using namespace com::rti::medical::generated;
+
+// ----------------------------------------------------------------------------
+// Replaces the names of a partition QoS.  The sequence owns its strings.
+static void SetPartitionNames(DDS_PartitionQosPolicy &partition,
+	const std::vector<std::string> &names)
+{
+	for (int i = 0; i < partition.name.length(); i++)
+	{
+		DDS_String_free(partition.name[i]);
+		partition.name[i] = NULL;
+	}
+
+	partition.name.ensure_length((DDS_Long)names.size(),
+		(DDS_Long)names.size());
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		partition.name[(DDS_Long)i] = DDS_String_dup(names[i].c_str());
+	}
+}
+
+static void SetSubscriberPartitions(DDS::Subscriber *sub,
+	const std::vector<std::string> &names)
+{
+	DDS_SubscriberQos qos;
+	sub->get_qos(qos);
+	SetPartitionNames(qos.partition, names);
+	if (sub->set_qos(qos) != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failed to set the partitions of a Subscriber to " <<
+			names.size() << " patient groups. Too many groups?";
+		throw errss.str();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Partition names
+long GetPatientGroup(PatientId patientId, unsigned int patientsPerGroup)
+{
+	long perGroup = patientsPerGroup == 0 ? 1 : (long)patientsPerGroup;
+	long group = (long)patientId / perGroup;
+
+	// Round down, so negative IDs do not share group 0
+	if ((long)patientId < 0 && (long)patientId % perGroup != 0)
+	{
+		group--;
+	}
+	return group;
+}
+
+std::string GetPatientGroupPartition(long group)
+{
+	std::stringstream name;
+	name << PatientGroupPartitionPrefix << group;
+	return name.str();
+}
+
+// ----------------------------------------------------------------------------
+// Subscribing
+void SubscribeToPatientGroups(DDS::Subscriber *sub,
+	const std::vector<long> &groups)
+{
+	std::vector<std::string> names;
+	for (size_t i = 0; i < groups.size(); i++)
+	{
+		names.push_back(GetPatientGroupPartition(groups[i]));
+	}
+	SetSubscriberPartitions(sub, names);
+}
+
+void SubscribeToAllPatientGroups(DDS::Subscriber *sub)
+{
+	// The empty name is the default partition.  The wildcard matches the
+	// partition of every group, and the unassigned partition.
+	std::vector<std::string> names;
+	names.push_back("");
+	names.push_back(std::string(PatientGroupPartitionPrefix) + "*");
+	SetSubscriberPartitions(sub, names);
+}
+
+// ----------------------------------------------------------------------------
+// Patient router
+DDSPatientRouter::DDSPatientRouter(DDS::DomainParticipant *participant,
+	const std::string &qosLibrary, const std::string &qosProfile,
+	unsigned int patientsPerGroup) :
+	_participant(participant),
+	_qosLibrary(qosLibrary),
+	_qosProfile(qosProfile),
+	_patientsPerGroup(patientsPerGroup),
+	_moveCount(0),
+	_failedMoveCount(0)
+{
+}
+
+DDSPatientRouter::~DDSPatientRouter()
+{
+	std::map<std::string, DDS::Publisher *>::iterator it;
+	for (it = _publishers.begin(); it != _publishers.end(); it++)
+	{
+		it->second->delete_contained_entities();
+		_participant->delete_publisher(it->second);
+	}
+	_publishers.clear();
+}
+
+// ----------------------------------------------------------------------------
+// The Publisher is created directly in its partition, so the device's
+// DataWriters are never matched with stations of another group.
+DDS::Publisher *DDSPatientRouter::GetPublisher(const std::string &deviceId)
+{
+	std::map<std::string, DDS::Publisher *>::iterator it =
+		_publishers.find(deviceId);
+	if (it != _publishers.end())
+	{
+		return it->second;
+	}
+
+	DDS_PublisherQos qos;
+	if (TheParticipantFactory->get_publisher_qos_from_profile(qos,
+		_qosLibrary.c_str(), _qosProfile.c_str()) != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failed to get the Publisher QoS of profile " <<
+			_qosLibrary << "::" << _qosProfile;
+		throw errss.str();
+	}
+
+	std::string partition = GetDevicePartition(deviceId);
+	std::vector<std::string> names(1, partition);
+	SetPartitionNames(qos.partition, names);
+
+	DDS::Publisher *pub = _participant->create_publisher(qos, NULL,
+		DDS_STATUS_MASK_NONE);
+	if (pub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create the Publisher of device " << deviceId;
+		throw errss.str();
+	}
+
+	_publishers[deviceId] = pub;
+	_publisherPartitions[deviceId] = partition;
+	return pub;
+}
+
+// ----------------------------------------------------------------------------
+// A device that moves to another patient of the same group keeps its
+// partition, so its DataWriters stay matched with the same stations.
+void DDSPatientRouter::MappingsChanged(
+	const std::vector<PatientMappingChange> &changes)
+{
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		const PatientMappingChange &change = changes[i];
+		if (change.removed)
+		{
+			_devicePartitions.erase(change.deviceId);
+		} else
+		{
+			_devicePartitions[change.deviceId] = GetPatientGroupPartition(
+				GetPatientGroup(change.patientId, _patientsPerGroup));
+		}
+
+		std::map<std::string, DDS::Publisher *>::iterator it =
+			_publishers.find(change.deviceId);
+		if (it == _publishers.end())
+		{
+			continue;
+		}
+
+		std::string partition = GetDevicePartition(change.deviceId);
+		if (partition == _publisherPartitions[change.deviceId])
+		{
+			continue;
+		}
+
+		DDS_PublisherQos qos;
+		it->second->get_qos(qos);
+		std::vector<std::string> names(1, partition);
+		SetPartitionNames(qos.partition, names);
+		if (it->second->set_qos(qos) == DDS_RETCODE_OK)
+		{
+			_publisherPartitions[change.deviceId] = partition;
+			_moveCount++;
+		} else
+		{
+			_failedMoveCount++;
+		}
+	}
+}
+
+std::string DDSPatientRouter::GetDevicePartition(
+	const std::string &deviceId) const
+{
+	std::map<std::string, std::string>::const_iterator it =
+		_devicePartitions.find(deviceId);
+	if (it == _devicePartitions.end())
+	{
+		return UnassignedPatientPartition;
+	}
+	return it->second;
+}
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_PATIENT_ROUTING_H
+#define DDS_PATIENT_ROUTING_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "DDSPatientTransfer.h"
+#include "../Generated/patient.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Patient routing:
+// Without routing, every DataReader of the device data matches every
+// device's DataWriter.  A station that watches four beds receives the data
+// of the whole unit, and throws away what belongs to other patients after
+// looking up the patient-device mapping of each sample.
+//
+// With routing, the device data is sent in DDS partitions.  The patients
+// are divided into patient groups, and the devices of the patients of a
+// group send their data in the partition of that group.  A station's
+// Subscriber lists only the partitions of the groups it watches.  DataWriters
+// and DataReaders whose partitions do not match are not matched at all, so
+// the data of other groups is never sent to the station.
+//
+// The group of a patient is its ID divided by the number of patients per
+// group, which all the applications of a unit must agree on.  With one
+// patient per group, each patient has its own partition.  The partition
+// names are built from the prefixes in patient.idl.  Devices that monitor no
+// patient send in the unassigned partition, which stations do not list.
+//
+// The partition is a Publisher QoS, so each routed device has its own
+// Publisher.  The DDSPatientRouter listens to the patient-device mappings,
+// and changes the partition of a device's Publisher when the device is
+// mapped to a patient of another group.  The device's DataWriters are then
+// unmatched from the stations of the old group, and matched with those of
+// the new group.
+//
+// The DevicePatientMapping topic and the alarms are not routed, and stay in
+// the default partition.  Applications that process the whole unit
+// subscribe to all the patient groups, which includes the default partition,
+// so the same Subscriber still receives the mappings, the alarms and the
+// data of devices that are not routed.
+//
+// ------------------------------------------------------------------------- //
+
+// --- Partition names ---
+
+// Group of a patient, when the patients are divided into groups of
+// patientsPerGroup patients
+long GetPatientGroup(com::rti::medical::generated::PatientId patientId,
+	unsigned int patientsPerGroup);
+
+// Partition in which the devices of a patient group send their data
+std::string GetPatientGroupPartition(long group);
+
+// --- Subscribing ---
+
+// Sets the partitions of the Subscriber to those of the patient groups.  The
+// Subscriber no longer receives data from the default partition, so it
+// should only contain DataReaders of the device data.  Throws a std::string
+// if the QoS cannot be changed.
+void SubscribeToPatientGroups(DDS::Subscriber *sub,
+	const std::vector<long> &groups);
+
+// Sets the partitions of the Subscriber to match all the patient groups,
+// the devices that monitor no patient, and the default partition.  Throws a
+// std::string if the QoS cannot be changed.
+void SubscribeToAllPatientGroups(DDS::Subscriber *sub);
+
+// ------------------------------------------------------------------------- //
+// Creates the Publishers of routed devices, and moves them to the partition
+// of their patient's group when the mappings change.  The publishers are
+// created and moved from the thread that calls GetPublisher() and
+// MappingsChanged(), which must be the same.
+class DDSPatientRouter : public PatientMappingListener
+{
+public:
+	// --- Constructor and destructor ---
+	// The Publishers are created in the participant with the QoS of the
+	// profile, which can be any Publisher profile, and the partition of
+	// their device's patient group.
+	DDSPatientRouter(DDS::DomainParticipant *participant,
+		const std::string &qosLibrary, const std::string &qosProfile,
+		unsigned int patientsPerGroup);
+
+	// Deletes the Publishers and the DataWriters created from them
+	~DDSPatientRouter();
+
+	// --- Publishers ---
+	// Returns the Publisher of a device, creating it in the partition of the
+	// device's current patient group the first time.  The DataWriters of all
+	// the device's data should be created from it.  Throws a std::string if
+	// the Publisher cannot be created.
+	DDS::Publisher *GetPublisher(const std::string &deviceId);
+
+	// --- Mapping changes ---
+	// Moves the Publishers of the devices that changed group.  The mappings
+	// of devices that have no Publisher yet are kept, so their Publisher is
+	// created in the right partition.  A Publisher that cannot be moved
+	// stays in its old partition, and is moved again at the next change of
+	// its device.
+	virtual void MappingsChanged(
+		const std::vector<PatientMappingChange> &changes);
+
+	// --- Statistics ---
+	// Publishers moved to another partition, and moves that failed
+	unsigned long GetMoveCount() const
+	{
+		return _moveCount;
+	}
+
+	unsigned long GetFailedMoveCount() const
+	{
+		return _failedMoveCount;
+	}
+
+private:
+	// --- Private methods ---
+	std::string GetDevicePartition(const std::string &deviceId) const;
+
+	// --- Private members ---
+	DDS::DomainParticipant *_participant;
+	std::string _qosLibrary;
+	std::string _qosProfile;
+	unsigned int _patientsPerGroup;
+
+	// Publisher of each device, and the partition it is in
+	std::map<std::string, DDS::Publisher *> _publishers;
+	std::map<std::string, std::string> _publisherPartitions;
+
+	// Partition of every device that is mapped to a patient
+	std::map<std::string, std::string> _devicePartitions;
+
+	unsigned long _moveCount;
+	unsigned long _failedMoveCount;
+};
+
+#endif
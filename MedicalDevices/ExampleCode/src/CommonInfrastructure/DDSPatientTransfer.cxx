@@ -0,0 +1,156 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <sstream>
+#include "DDSPatientTransfer.h"
+#include "DDSTypeWrapper.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+// ----------------------------------------------------------------------------
+// Patient transfer
+void PatientTransfer::Map(const std::string &deviceId, PatientId patientId)
+{
+	PatientMappingChange change;
+	change.deviceId = deviceId;
+	change.patientId = patientId;
+	change.removed = false;
+	_changes.push_back(change);
+}
+
+void PatientTransfer::Unmap(const std::string &deviceId)
+{
+	PatientMappingChange change;
+	change.deviceId = deviceId;
+	change.patientId = 0;
+	change.removed = true;
+	_changes.push_back(change);
+}
+
+// ----------------------------------------------------------------------------
+// Patient mapping reader
+DDSPatientMappingReader::DDSPatientMappingReader(
+	DDS::DomainParticipant *participant, DDS::Topic *topic,
+	const std::string &qosLibrary, const std::string &qosProfile) :
+	_reader(NULL),
+	_subscriber(NULL),
+	_changeSetCount(0)
+{
+	_subscriber = participant->create_subscriber_with_profile(
+		qosLibrary.c_str(), QOS_PROFILE_PATIENT_TRANSFER, NULL,
+		DDS_STATUS_MASK_NONE);
+	if (_subscriber == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create the patient transfer Subscriber";
+		throw errss.str();
+	}
+
+	try
+	{
+		_reader = new GenericDataReader<DevicePatientMapping>(_subscriber,
+			topic, qosLibrary, qosProfile);
+	}
+	catch (std::string message)
+	{
+		participant->delete_subscriber(_subscriber);
+		throw;
+	}
+}
+
+DDSPatientMappingReader::DDSPatientMappingReader(DDS::Subscriber *sub,
+	DDS::Topic *topic, const std::string &qosLibrary,
+	const std::string &qosProfile) :
+	_subscriber(NULL),
+	_changeSetCount(0)
+{
+	// Samples that report that a mapping is no longer alive have no valid
+	// data, and the condition of the reader triggers on any instance state
+	_reader = new GenericDataReader<DevicePatientMapping>(sub, topic,
+		qosLibrary, qosProfile);
+}
+
+DDSPatientMappingReader::~DDSPatientMappingReader()
+{
+	delete _reader;
+	_reader = NULL;
+
+	if (_subscriber != NULL)
+	{
+		_subscriber->get_participant()->delete_subscriber(_subscriber);
+		_subscriber = NULL;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// With coherent access, the DataReader makes a coherent set available only
+// once all of its samples have arrived, so taking everything that is
+// available never returns part of a set.  The sets that arrived since the
+// last call are merged into a single call of the listener.
+unsigned int DDSPatientMappingReader::ProcessChanges(
+	PatientMappingListener &listener)
+{
+	LoanedBatch<DevicePatientMapping> batch;
+
+	_changes.clear();
+	_changeIndex.clear();
+
+	while (_reader->Take(batch))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			if (info.valid_data)
+			{
+				AddChange(batch.GetData(i).device_id,
+					batch.GetData(i).patient_id, false);
+			}
+			else if (info.instance_state != DDS_ALIVE_INSTANCE_STATE)
+			{
+				DdsAutoType<DevicePatientMapping> key;
+				if (_reader->GetDataReader()->get_key_value(key,
+					info.instance_handle) == DDS_RETCODE_OK)
+				{
+					AddChange(key.device_id, 0, true);
+				}
+			}
+		}
+	}
+
+	if (_changes.empty())
+	{
+		return 0;
+	}
+
+	_changeSetCount++;
+	listener.MappingsChanged(_changes);
+	return (unsigned int)_changes.size();
+}
+
+// Keeps only the latest change of each device, in the order the devices
+// first changed
+void DDSPatientMappingReader::AddChange(const std::string &deviceId,
+	PatientId patientId, bool removed)
+{
+	std::map<std::string, size_t>::iterator found =
+		_changeIndex.find(deviceId);
+	if (found == _changeIndex.end())
+	{
+		_changeIndex[deviceId] = _changes.size();
+		_changes.push_back(PatientMappingChange());
+		_changes.back().deviceId = deviceId;
+		found = _changeIndex.find(deviceId);
+	}
+
+	PatientMappingChange &change = _changes[found->second];
+	change.patientId = patientId;
+	change.removed = removed;
+}
@@ -0,0 +1,171 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_PATIENT_TRANSFER_H
+#define DDS_PATIENT_TRANSFER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "DDSGenericDataReader.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Patient transfers:
+// Moving a patient to another bed, or remapping a whole ward at a shift
+// change, changes the patient-device mapping of many devices.  Sent one
+// device at a time, every application that reads the mappings sees each
+// half-remapped state, and recomputes everything that depends on the
+// mappings once per device.
+//
+// A PatientTransfer collects the mapping changes, and the
+// DDSPatientDevicePubInterface sends them as one coherent set: the
+// Publisher of the mappings uses the PatientTransfer QoS profile, which
+// enables coherent access.  A Subscriber that uses the same profile makes
+// the changes of a set available only once all of them have arrived.
+//
+// The DDSPatientMappingReader reads the mappings on such a Subscriber, and
+// calls its listener once for all the changes that are available, so
+// applications see one "mappings changed" event per transfer instead of one
+// per device.
+//
+// PRESENTATION is requested by the Subscriber and offered by the Publisher,
+// so a DataReader on a coherent Subscriber only matches DataWriters whose
+// Publisher enables coherent access too.  The device data, requests and
+// status of the other applications use the default presentation, so their
+// DataReaders must be created on another Subscriber.
+//
+// ------------------------------------------------------------------------- //
+
+// ------------------------------------------------------------------------- //
+// A change to the mapping of one device
+struct PatientMappingChange
+{
+	std::string deviceId;
+
+	// Patient now monitored by the device, unused if the mapping is removed
+	com::rti::medical::generated::PatientId patientId;
+
+	// The device no longer monitors any patient
+	bool removed;
+};
+
+// ------------------------------------------------------------------------- //
+// A set of mapping changes that are sent and applied together
+class PatientTransfer
+{
+public:
+	// --- Adding changes ---
+	// The device now monitors the patient
+	void Map(const std::string &deviceId,
+		com::rti::medical::generated::PatientId patientId);
+
+	// The device no longer monitors any patient
+	void Unmap(const std::string &deviceId);
+
+	// --- Getters ---
+	const std::vector<PatientMappingChange> &GetChanges() const
+	{
+		return _changes;
+	}
+
+	bool IsEmpty() const
+	{
+		return _changes.empty();
+	}
+
+	void Clear()
+	{
+		_changes.clear();
+	}
+
+private:
+	std::vector<PatientMappingChange> _changes;
+};
+
+// ------------------------------------------------------------------------- //
+// Receives the mapping changes read by a DDSPatientMappingReader
+class PatientMappingListener
+{
+public:
+	virtual ~PatientMappingListener()
+	{
+	}
+
+	// Called once with all the changes that were available, each device
+	// appearing at most once with its latest mapping.  Complete coherent
+	// sets are never split between calls.
+	virtual void MappingsChanged(
+		const std::vector<PatientMappingChange> &changes) = 0;
+};
+
+// ------------------------------------------------------------------------- //
+// Reads patient-device mappings, and delivers them as change sets
+class DDSPatientMappingReader
+{
+public:
+	// --- Constructors and destructor ---
+	// Creates a Subscriber with the PatientTransfer QoS profile of the
+	// library, used by this DataReader only, and the DataReader of the
+	// mappings on it.  Throws a std::string on failure.
+	DDSPatientMappingReader(DDS::DomainParticipant *participant,
+		DDS::Topic *topic, const std::string &qosLibrary,
+		const std::string &qosProfile);
+
+	// Creates the DataReader of the mappings on the Subscriber, which should
+	// use the PatientTransfer QoS profile for transfers to be applied
+	// atomically, and then can contain no DataReader of other data.
+	DDSPatientMappingReader(DDS::Subscriber *sub, DDS::Topic *topic,
+		const std::string &qosLibrary, const std::string &qosProfile);
+	~DDSPatientMappingReader();
+
+	// --- Condition ---
+	// Triggers when mapping changes are available, to attach to a WaitSet
+	DDS::ReadCondition *GetCondition()
+	{
+		return _reader->GetCondition();
+	}
+
+	// --- Processing changes ---
+	// Takes all available mapping changes, and passes them to the listener
+	// in a single call.  Returns the number of changes passed, and does not
+	// call the listener if there are none.
+	unsigned int ProcessChanges(PatientMappingListener &listener);
+
+	// Number of times the listener was called
+	unsigned long long GetChangeSetCount() const
+	{
+		return _changeSetCount;
+	}
+
+private:
+	// --- Private methods ---
+	void AddChange(const std::string &deviceId,
+		com::rti::medical::generated::PatientId patientId, bool removed);
+
+	// --- Private members ---
+	GenericDataReader<com::rti::medical::generated::DevicePatientMapping>
+		*_reader;
+
+	// The coherent Subscriber of the reader, if it created it
+	DDS::Subscriber *_subscriber;
+
+	// Changes of the current call, and the position of each device in them
+	std::vector<PatientMappingChange> _changes;
+	std::map<std::string, size_t> _changeIndex;
+
+	unsigned long long _changeSetCount;
+};
+
+#endif
@@ -0,0 +1,318 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <iostream>
+#include <sstream>
+#include "DDSReactor.h"
+
+// ------------------------------------------------------------------------- //
+// ReactorEntry
+
+ReactorEntry::ReactorEntry(DDS::DataReader *reader, int priority,
+	DDS_Long maxBatch) :
+	reader(reader),
+	maxBatch(maxBatch)
+{
+	condition = reader->create_readcondition(DDS_ANY_SAMPLE_STATE,
+		DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	if (condition == NULL)
+	{
+		std::stringstream errss;
+		errss << "DDSReactor: failure to create ReadCondition";
+		throw errss.str();
+	}
+
+	metrics.topicName = reader->get_topicdescription()->get_name();
+	metrics.priority = priority;
+	metrics.thread = 0;
+	metrics.batches = 0;
+	metrics.samples = 0;
+	metrics.totalDispatchLatency = 0;
+	metrics.maxDispatchLatency = 0;
+	metrics.totalHandlerTime = 0;
+	metrics.maxHandlerTime = 0;
+}
+
+ReactorEntry::~ReactorEntry()
+{
+	reader->delete_readcondition(condition);
+}
+
+// ------------------------------------------------------------------------- //
+// DDSReactor
+
+DDSReactor::DDSReactor(unsigned int threadCount, DDS_Long maxBatch,
+	const OSThreadOptions &options) :
+	_maxBatch(maxBatch),
+	_threadOptions(options),
+	_started(false)
+{
+	if (threadCount == 0)
+	{
+		std::stringstream errss;
+		errss << "DDSReactor(): at least one thread is required";
+		throw errss.str();
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		ReactorThread *thread = new ReactorThread();
+		thread->reactor = this;
+		thread->index = i;
+		thread->thread = NULL;
+		thread->waitSet = new DDS::WaitSet();
+		thread->stopCondition = new DDS::GuardCondition();
+		thread->waitSet->attach_condition(thread->stopCondition);
+		_threads.push_back(thread);
+	}
+}
+
+DDSReactor::~DDSReactor()
+{
+	Stop();
+
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		ReactorThread *thread = _threads[i];
+		for (size_t e = 0; e < thread->entries.size(); e++)
+		{
+			thread->waitSet->detach_condition(thread->entries[e]->condition);
+			delete thread->entries[e];
+		}
+		thread->waitSet->detach_condition(thread->stopCondition);
+		delete thread->stopCondition;
+		delete thread->waitSet;
+		delete thread;
+	}
+}
+
+void DDSReactor::CheckNotStarted()
+{
+	if (_started)
+	{
+		std::stringstream errss;
+		errss << "DDSReactor: DataReaders must be registered before Start";
+		throw errss.str();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Attaches the entry to the WaitSet of its thread, and keeps the entries of
+// the thread sorted by priority.  Entries of equal priority stay in the
+// order they were registered.
+void DDSReactor::AddEntry(ReactorEntry *entry, unsigned int thread)
+{
+	if (thread == ANY_THREAD)
+	{
+		thread = 0;
+		for (unsigned int i = 1; i < _threads.size(); i++)
+		{
+			if (_threads[i]->entries.size() <
+				_threads[thread]->entries.size())
+			{
+				thread = i;
+			}
+		}
+	} else if (thread >= _threads.size())
+	{
+		delete entry;
+		std::stringstream errss;
+		errss << "DDSReactor: no reactor thread " << thread;
+		throw errss.str();
+	}
+
+	ReactorThread *reactorThread = _threads[thread];
+	if (reactorThread->waitSet->attach_condition(entry->condition)
+		!= DDS_RETCODE_OK)
+	{
+		delete entry;
+		std::stringstream errss;
+		errss << "DDSReactor: failure to attach ReadCondition";
+		throw errss.str();
+	}
+	entry->metrics.thread = thread;
+
+	std::vector<ReactorEntry *>::iterator it =
+		reactorThread->entries.begin();
+	while (it != reactorThread->entries.end() &&
+		(*it)->metrics.priority >= entry->metrics.priority)
+	{
+		++it;
+	}
+	reactorThread->entries.insert(it, entry);
+}
+
+void DDSReactor::Start()
+{
+	if (_started)
+	{
+		return;
+	}
+	_started = true;
+
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		_threads[i]->stopCondition->set_trigger_value(DDS_BOOLEAN_FALSE);
+		_threads[i]->thread = new OSThread(ThreadFunction, _threads[i],
+			_threadOptions);
+		_threads[i]->thread->Run();
+	}
+}
+
+void DDSReactor::Stop()
+{
+	if (!_started)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		_threads[i]->stopCondition->set_trigger_value(DDS_BOOLEAN_TRUE);
+	}
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		_threads[i]->thread->Join();
+		delete _threads[i]->thread;
+		_threads[i]->thread = NULL;
+	}
+	_started = false;
+}
+
+bool DDSReactor::HasRequestedScheduling() const
+{
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		if (_threads[i]->thread != NULL &&
+			!_threads[i]->thread->HasRequestedScheduling())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void DDSReactor::GetMetrics(std::vector<ReactorTopicMetrics> &metrics,
+	bool reset)
+{
+	metrics.clear();
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		ReactorThread *thread = _threads[i];
+		thread->metricsMutex.Lock();
+		for (size_t e = 0; e < thread->entries.size(); e++)
+		{
+			ReactorTopicMetrics &entryMetrics = thread->entries[e]->metrics;
+			metrics.push_back(entryMetrics);
+			if (reset)
+			{
+				entryMetrics.batches = 0;
+				entryMetrics.samples = 0;
+				entryMetrics.totalDispatchLatency = 0;
+				entryMetrics.maxDispatchLatency = 0;
+				entryMetrics.totalHandlerTime = 0;
+				entryMetrics.maxHandlerTime = 0;
+			}
+		}
+		thread->metricsMutex.Unlock();
+	}
+}
+
+void *DDSReactor::ThreadFunction(void *param)
+{
+	ReactorThread *thread = (ReactorThread *)param;
+	try
+	{
+		thread->reactor->RunThread(thread);
+	}
+	catch (std::string message)
+	{
+		std::cout << "Reactor thread " << thread->index << " stopped: "
+			<< message << std::endl;
+	}
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Waits for data, and dispatches one batch per DataReader with data, in
+// order of priority.  The entries are already sorted, so the active
+// conditions only need to be matched against them.
+void DDSReactor::RunThread(ReactorThread *thread)
+{
+	DDS::ConditionSeq activeConditions;
+	DDS_Duration_t timeout = DDS_DURATION_INFINITE;
+	std::vector<bool> active(thread->entries.size());
+
+	while (!thread->stopCondition->get_trigger_value())
+	{
+		DDS_ReturnCode_t retcode = thread->waitSet->wait(activeConditions,
+			timeout);
+		if (retcode == DDS_RETCODE_TIMEOUT)
+		{
+			continue;
+		}
+		if (retcode != DDS_RETCODE_OK)
+		{
+			std::stringstream errss;
+			errss << "failure waiting for data";
+			throw errss.str();
+		}
+		int64_t wakeup = OSGetMonotonicTime();
+
+		for (size_t e = 0; e < thread->entries.size(); e++)
+		{
+			active[e] = false;
+			for (int i = 0; i < activeConditions.length(); i++)
+			{
+				if (activeConditions[i] == thread->entries[e]->condition)
+				{
+					active[e] = true;
+					break;
+				}
+			}
+		}
+
+		for (size_t e = 0; e < thread->entries.size(); e++)
+		{
+			if (!active[e])
+			{
+				continue;
+			}
+			ReactorEntry *entry = thread->entries[e];
+
+			int64_t start = OSGetMonotonicTime();
+			int samples = entry->Dispatch();
+			int64_t end = OSGetMonotonicTime();
+			if (samples == 0)
+			{
+				continue;
+			}
+
+			int64_t latency = start - wakeup;
+			int64_t handlerTime = end - start;
+
+			thread->metricsMutex.Lock();
+			ReactorTopicMetrics &metrics = entry->metrics;
+			metrics.batches++;
+			metrics.samples += samples;
+			metrics.totalDispatchLatency += latency;
+			if (latency > metrics.maxDispatchLatency)
+			{
+				metrics.maxDispatchLatency = latency;
+			}
+			metrics.totalHandlerTime += handlerTime;
+			if (handlerTime > metrics.maxHandlerTime)
+			{
+				metrics.maxHandlerTime = handlerTime;
+			}
+			thread->metricsMutex.Unlock();
+		}
+	}
+}
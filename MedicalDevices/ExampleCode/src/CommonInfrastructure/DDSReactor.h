@@ -0,0 +1,230 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_REACTOR_H
+#define DDS_REACTOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "DDSLoanedBatch.h"
+#include "OSAPI.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Reactor:
+// Dispatches the data of any number of DataReaders to their handlers on a
+// fixed number of threads.  Each reactor thread waits on its own WaitSet,
+// with the ReadConditions of the DataReaders assigned to it attached, so
+// adding topics adds no threads.
+//
+// When a thread wakes up, it takes one batch from each DataReader that has
+// data, in order of topic priority (highest first), and passes the batch to
+// the DataReader's handler.  A DataReader that still has data is dispatched
+// again on the next wakeup, after the higher priority topics, so a busy
+// topic cannot hold back the others.
+//
+// Each DataReader is always dispatched by the same thread, so its handler is
+// never called concurrently and receives its samples in order.  Handlers of
+// DataReaders on different threads do run concurrently.
+//
+// The reactor measures, per topic:
+//  - Dispatch latency: the time from the wakeup of the thread to the start
+//    of the handler, which includes the handlers of higher priority topics
+//    that ran first.
+//  - Handler time: the time spent in the handler.
+//
+// ------------------------------------------------------------------------- //
+
+// ------------------------------------------------------------------------- //
+// Receives the batches of one typed DataReader from a reactor thread
+template <typename T>
+class ReactorHandler
+{
+public:
+	virtual ~ReactorHandler()
+	{
+	}
+
+	// The samples are loaned, and are returned when this returns
+	virtual void OnData(LoanedBatch<T> &batch) = 0;
+};
+
+// ------------------------------------------------------------------------- //
+// Measurements of one topic registered with a reactor.  Times are in
+// nanoseconds.
+struct ReactorTopicMetrics
+{
+	std::string topicName;
+	int priority;
+	unsigned int thread;
+
+	uint64_t batches;
+	uint64_t samples;
+
+	int64_t totalDispatchLatency;
+	int64_t maxDispatchLatency;
+
+	int64_t totalHandlerTime;
+	int64_t maxHandlerTime;
+};
+
+// ------------------------------------------------------------------------- //
+// A registered DataReader, independent of the data type
+class ReactorEntry
+{
+public:
+	ReactorEntry(DDS::DataReader *reader, int priority,
+		DDS_Long maxBatch);
+	virtual ~ReactorEntry();
+
+	// Takes one batch and passes it to the handler.  Returns the number of
+	// samples dispatched.
+	virtual int Dispatch() = 0;
+
+	// --- Members ---
+	DDS::DataReader *reader;
+	DDS::ReadCondition *condition;
+	DDS_Long maxBatch;
+
+	// Updated by the reactor thread, under the thread's metrics mutex
+	ReactorTopicMetrics metrics;
+};
+
+template <typename T>
+class TypedReactorEntry : public ReactorEntry
+{
+public:
+	TypedReactorEntry(typename T::DataReader *reader,
+		ReactorHandler<T> *handler, int priority, DDS_Long maxBatch) :
+		ReactorEntry(reader, priority, maxBatch),
+		_reader(reader),
+		_handler(handler)
+	{
+	}
+
+	virtual int Dispatch()
+	{
+		if (!_batch.TakeNext(_reader, condition, maxBatch))
+		{
+			return 0;
+		}
+		int count = _batch.GetLength();
+		try
+		{
+			_handler->OnData(_batch);
+		}
+		catch (...)
+		{
+			_batch.Return();
+			throw;
+		}
+		_batch.Return();
+		return count;
+	}
+
+private:
+	typename T::DataReader *_reader;
+	ReactorHandler<T> *_handler;
+	LoanedBatch<T> _batch;
+};
+
+// ------------------------------------------------------------------------- //
+//
+// DDSReactor:
+// Owns the reactor threads and their WaitSets.  DataReaders are registered
+// before the reactor is started.
+//
+// ------------------------------------------------------------------------- //
+class DDSReactor
+{
+public:
+	// Register lets the reactor choose the thread
+	static const unsigned int ANY_THREAD = 0xffffffff;
+
+	// --- Constructor and destructor ---
+	// Creates threadCount threads, which take batches of up to maxBatch
+	// samples.  The threads are scheduled with the options, so a reactor
+	// that handles latency-critical topics can run at real-time priority.
+	DDSReactor(unsigned int threadCount,
+		DDS_Long maxBatch = DDS_LENGTH_UNLIMITED,
+		const OSThreadOptions &options = OSThreadOptions());
+
+	// Stops the threads if they are running.  The DataReaders must outlive
+	// the reactor.
+	~DDSReactor();
+
+	// --- Registration ---
+	// Dispatches the data of the DataReader to the handler.  Topics with a
+	// higher priority are dispatched first.  By default, the DataReader is
+	// assigned to the thread with the fewest DataReaders.
+	template <typename T>
+	void Register(typename T::DataReader *reader, ReactorHandler<T> *handler,
+		int priority = 0, unsigned int thread = ANY_THREAD)
+	{
+		CheckNotStarted();
+		AddEntry(new TypedReactorEntry<T>(reader, handler, priority,
+			_maxBatch), thread);
+	}
+
+	// --- Running ---
+	void Start();
+
+	// Waits for the handlers that are running to return, and stops the
+	// threads
+	void Stop();
+
+	unsigned int GetThreadCount() const
+	{
+		return (unsigned int)_threads.size();
+	}
+
+	// False if a thread could not be given the requested scheduling
+	bool HasRequestedScheduling() const;
+
+	// --- Metrics ---
+	// Copies the metrics of every topic, and optionally resets them
+	void GetMetrics(std::vector<ReactorTopicMetrics> &metrics,
+		bool reset = false);
+
+private:
+	// --- One reactor thread ---
+	struct ReactorThread
+	{
+		DDSReactor *reactor;
+		unsigned int index;
+		OSThread *thread;
+		DDS::WaitSet *waitSet;
+		DDS::GuardCondition *stopCondition;
+
+		// Sorted by decreasing priority
+		std::vector<ReactorEntry *> entries;
+
+		// Protects the metrics of the entries
+		OSMutex metricsMutex;
+	};
+
+	// --- Private methods ---
+	void CheckNotStarted();
+	void AddEntry(ReactorEntry *entry, unsigned int thread);
+
+	static void *ThreadFunction(void *param);
+	void RunThread(ReactorThread *thread);
+
+	// --- Private members ---
+	DDS_Long _maxBatch;
+	OSThreadOptions _threadOptions;
+	std::vector<ReactorThread *> _threads;
+	bool _started;
+};
+
+#endif
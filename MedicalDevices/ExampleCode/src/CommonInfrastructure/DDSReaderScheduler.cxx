@@ -0,0 +1,177 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <sstream>
+#include "DDSReaderScheduler.h"
+
+// ------------------------------------------------------------------------- //
+// ScheduledReaderBase
+
+ScheduledReaderBase::ScheduledReaderBase(DDSReaderScheduler *scheduler,
+	DDS::DataReader *reader) :
+	_scheduler(scheduler),
+	_reader(reader),
+	_waiting(false),
+	_attached(false)
+{
+	_condition = reader->create_readcondition(DDS_ANY_SAMPLE_STATE,
+		DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	if (_condition == NULL)
+	{
+		std::stringstream errss;
+		errss << "ScheduledReader(): failure to create ReadCondition";
+		throw errss.str();
+	}
+	_scheduler->AddReader(this);
+}
+
+ScheduledReaderBase::~ScheduledReaderBase()
+{
+	_scheduler->RemoveReader(this);
+	_reader->delete_readcondition(_condition);
+}
+
+void ScheduledReaderBase::Wait()
+{
+	_waiting = true;
+	if (!_attached)
+	{
+		_scheduler->Attach(this);
+	}
+}
+
+// ------------------------------------------------------------------------- //
+// DDSReaderScheduler
+
+DDSReaderScheduler::DDSReaderScheduler()
+{
+	_waitSet = new DDS::WaitSet();
+	_stopCondition = new DDS::GuardCondition();
+	if (_waitSet->attach_condition(_stopCondition) != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "DDSReaderScheduler(): failure to attach GuardCondition";
+		throw errss.str();
+	}
+}
+
+DDSReaderScheduler::~DDSReaderScheduler()
+{
+	_waitSet->detach_condition(_stopCondition);
+	delete _stopCondition;
+	delete _waitSet;
+}
+
+unsigned int DDSReaderScheduler::GetWaitingCount() const
+{
+	unsigned int count = 0;
+	for (std::map<DDS::Condition *, ScheduledReaderBase *>::const_iterator
+		it = _readers.begin(); it != _readers.end(); ++it)
+	{
+		if (it->second->IsWaiting())
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+// ----------------------------------------------------------------------------
+// Resumes each consumer with data at most once per call, so a consumer that
+// always has data cannot starve the others.
+unsigned int DDSReaderScheduler::RunOnce(const DDS_Duration_t &timeout)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode == DDS_RETCODE_TIMEOUT)
+	{
+		return 0;
+	}
+	if (retcode != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "DDSReaderScheduler: failure waiting for data";
+		throw errss.str();
+	}
+
+	unsigned int resumed = 0;
+	for (int i = 0; i < activeConditions.length(); i++)
+	{
+		std::map<DDS::Condition *, ScheduledReaderBase *>::iterator it =
+			_readers.find(activeConditions[i]);
+		if (it == _readers.end())
+		{
+			continue;
+		}
+
+		ScheduledReaderBase *reader = it->second;
+		if (reader->_waiting)
+		{
+			reader->_waiting = false;
+			reader->Resume();
+			resumed++;
+		}
+
+		// The consumer did not ask for more data: stop waiting for it, so
+		// its samples queue up in the DataReader
+		if (!reader->_waiting)
+		{
+			Detach(reader);
+		}
+	}
+	return resumed;
+}
+
+void DDSReaderScheduler::Run()
+{
+	DDS_Duration_t timeout = DDS_DURATION_INFINITE;
+	while (!_stopCondition->get_trigger_value())
+	{
+		RunOnce(timeout);
+	}
+	_stopCondition->set_trigger_value(DDS_BOOLEAN_FALSE);
+}
+
+void DDSReaderScheduler::Stop()
+{
+	_stopCondition->set_trigger_value(DDS_BOOLEAN_TRUE);
+}
+
+void DDSReaderScheduler::AddReader(ScheduledReaderBase *reader)
+{
+	_readers[reader->_condition] = reader;
+}
+
+void DDSReaderScheduler::RemoveReader(ScheduledReaderBase *reader)
+{
+	Detach(reader);
+	_readers.erase(reader->_condition);
+}
+
+void DDSReaderScheduler::Attach(ScheduledReaderBase *reader)
+{
+	if (_waitSet->attach_condition(reader->_condition) != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "DDSReaderScheduler: failure to attach ReadCondition";
+		throw errss.str();
+	}
+	reader->_attached = true;
+}
+
+void DDSReaderScheduler::Detach(ScheduledReaderBase *reader)
+{
+	if (reader->_attached)
+	{
+		_waitSet->detach_condition(reader->_condition);
+		reader->_attached = false;
+	}
+}
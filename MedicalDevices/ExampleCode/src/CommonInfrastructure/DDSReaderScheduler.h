@@ -0,0 +1,284 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_READER_SCHEDULER_H
+#define DDS_READER_SCHEDULER_H
+
+#include <map>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "DDSLoanedBatch.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Scheduled readers:
+// The applications in this example wait for data in a loop on one thread, or
+// receive it in listener callbacks on the middleware's receive threads.
+// Neither works well when one process has many independent consumers: a loop
+// per consumer needs a thread per consumer, and listeners run application
+// code on middleware threads.
+//
+// A ScheduledReader lets a consumer ask for its next batch of samples, and
+// names the method that continues its processing when the batch arrives:
+//
+//     void VitalsConsumer::Start()
+//     {
+//         _numerics->NextBatch(this, &VitalsConsumer::OnNumerics);
+//     }
+//
+//     void VitalsConsumer::OnNumerics(LoanedBatch<ice::Numeric> &batch)
+//     {
+//         ... process the batch ...
+//         _numerics->NextBatch(this, &VitalsConsumer::OnNumerics);
+//     }
+//
+// Until the consumer asks again, it is suspended: its DataReader is not
+// waited for, and new samples stay queued in the DataReader.  A consumer can
+// continue with a different method each time, so processing that happens in
+// steps is written as a sequence of methods rather than a state machine.
+//
+// All the ScheduledReaders of one DDSReaderScheduler share its WaitSet, and
+// are resumed by the thread that runs the scheduler, so hundreds of
+// consumers can run on one thread, or on a few threads with one scheduler
+// each.  A ScheduledReader and its consumer must only be used from the
+// thread that runs its scheduler.
+//
+// ------------------------------------------------------------------------- //
+
+class DDSReaderScheduler;
+
+// ------------------------------------------------------------------------- //
+// Part of a ScheduledReader that does not depend on the data type
+class ScheduledReaderBase
+{
+public:
+	virtual ~ScheduledReaderBase();
+
+	// True if the consumer is waiting for a batch
+	bool IsWaiting() const
+	{
+		return _waiting;
+	}
+
+protected:
+	// --- Constructor ---
+	ScheduledReaderBase(DDSReaderScheduler *scheduler,
+		DDS::DataReader *reader);
+
+	// Suspends the consumer until data is available
+	void Wait();
+
+	// Stops waiting, without resuming the consumer
+	void CancelWait()
+	{
+		_waiting = false;
+	}
+
+	// Called by the scheduler when data is available for a waiting consumer
+	virtual void Resume() = 0;
+
+	// --- Protected members ---
+	DDS::ReadCondition *_condition;
+
+private:
+	friend class DDSReaderScheduler;
+
+	// --- Private members ---
+	DDSReaderScheduler *_scheduler;
+	DDS::DataReader *_reader;
+
+	// The consumer is waiting for data
+	bool _waiting;
+
+	// The condition is attached to the scheduler's WaitSet.  It stays
+	// attached while the consumer keeps asking for data, and is detached
+	// when the consumer stops.
+	bool _attached;
+};
+
+// ------------------------------------------------------------------------- //
+//
+// ScheduledReader:
+// Delivers the samples of one typed DataReader to one consumer, a batch at a
+// time, when the consumer asks for them.
+//
+// ------------------------------------------------------------------------- //
+template <typename T>
+class ScheduledReader : public ScheduledReaderBase
+{
+public:
+	// --- Constructor and destructor ---
+	// Batches have up to maxBatch samples.  The DataReader must outlive the
+	// ScheduledReader.
+	ScheduledReader(DDSReaderScheduler *scheduler,
+		typename T::DataReader *reader,
+		DDS_Long maxBatch = DDS_LENGTH_UNLIMITED) :
+		ScheduledReaderBase(scheduler, reader),
+		_reader(reader),
+		_maxBatch(maxBatch),
+		_continuation(NULL)
+	{
+	}
+
+	virtual ~ScheduledReader()
+	{
+		delete _continuation;
+	}
+
+	// --- Ask for the next batch ---
+	// Suspends the consumer until samples are available, then calls
+	// (consumer->*resume)(batch) from the scheduler's thread.  The batch is
+	// returned to the DataReader when that call returns.  Asking again
+	// before the consumer is resumed replaces the previous request.
+	template <typename C>
+	void NextBatch(C *consumer, void (C::*resume)(LoanedBatch<T> &))
+	{
+		delete _continuation;
+		_continuation = new MemberContinuation<C>(consumer, resume);
+		Wait();
+	}
+
+	// Drops the pending request, if any.  Samples stay in the DataReader.
+	void Cancel()
+	{
+		delete _continuation;
+		_continuation = NULL;
+		CancelWait();
+	}
+
+protected:
+	// ------------------------------------------------------------------------
+	// Takes the batch and continues the consumer.  The consumer may ask for
+	// its next batch from the continuation, but must not delete this
+	// ScheduledReader there.
+	virtual void Resume()
+	{
+		if (_continuation == NULL)
+		{
+			return;
+		}
+
+		if (!_batch.TakeNext(_reader, _condition, _maxBatch))
+		{
+			// Nothing to take after all: keep waiting
+			Wait();
+			return;
+		}
+
+		Continuation *continuation = _continuation;
+		_continuation = NULL;
+
+		try
+		{
+			continuation->Resume(_batch);
+		}
+		catch (...)
+		{
+			delete continuation;
+			_batch.Return();
+			throw;
+		}
+		delete continuation;
+		_batch.Return();
+	}
+
+private:
+	// --- Continuations ---
+	class Continuation
+	{
+	public:
+		virtual ~Continuation()
+		{
+		}
+		virtual void Resume(LoanedBatch<T> &batch) = 0;
+	};
+
+	template <typename C>
+	class MemberContinuation : public Continuation
+	{
+	public:
+		MemberContinuation(C *consumer, void (C::*method)(LoanedBatch<T> &)) :
+			_consumer(consumer),
+			_method(method)
+		{
+		}
+
+		virtual void Resume(LoanedBatch<T> &batch)
+		{
+			(_consumer->*_method)(batch);
+		}
+
+	private:
+		C *_consumer;
+		void (C::*_method)(LoanedBatch<T> &);
+	};
+
+	// --- Private members ---
+	typename T::DataReader *_reader;
+	DDS_Long _maxBatch;
+	Continuation *_continuation;
+	LoanedBatch<T> _batch;
+};
+
+// ------------------------------------------------------------------------- //
+//
+// DDSReaderScheduler:
+// Waits for data for all its waiting ScheduledReaders on one WaitSet, and
+// resumes their consumers on the thread that runs the scheduler.
+//
+// ------------------------------------------------------------------------- //
+class DDSReaderScheduler
+{
+public:
+	// --- Constructor and destructor ---
+	DDSReaderScheduler();
+
+	// All ScheduledReaders of the scheduler must be deleted first
+	~DDSReaderScheduler();
+
+	// --- Running the scheduler ---
+	// Waits up to the timeout for data for any waiting consumer, and resumes
+	// every consumer that has data.  Returns the number of consumers resumed.
+	unsigned int RunOnce(const DDS_Duration_t &timeout);
+
+	// Resumes consumers until Stop is called
+	void Run();
+
+	// Makes Run return.  This can be called from any thread.
+	void Stop();
+
+	// --- Statistics ---
+	unsigned int GetReaderCount() const
+	{
+		return (unsigned int)_readers.size();
+	}
+
+	unsigned int GetWaitingCount() const;
+
+private:
+	friend class ScheduledReaderBase;
+
+	// --- Private methods ---
+	void AddReader(ScheduledReaderBase *reader);
+	void RemoveReader(ScheduledReaderBase *reader);
+	void Attach(ScheduledReaderBase *reader);
+	void Detach(ScheduledReaderBase *reader);
+
+	// --- Private members ---
+	DDS::WaitSet *_waitSet;
+
+	// Wakes up Run when Stop is called
+	DDS::GuardCondition *_stopCondition;
+
+	// Readers by their ReadCondition
+	std::map<DDS::Condition *, ScheduledReaderBase *> _readers;
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include <sstream>
+#include "DDSWaveformAdapter.h"
+
+using namespace com::rti::medical::generated;
+
+// Bound of the identifier fields in ice.idl
+static const size_t IDENTIFIER_BOUND = 64;
+
+// Copies an identifier into a string field of a sample
+static void CopyIdentifier(char *destination, const char *source)
+{
+	strncpy(destination, source, IDENTIFIER_BOUND);
+	destination[IDENTIFIER_BOUND] = '\0';
+}
+
+// ----------------------------------------------------------------------------
+// Conversions
+bool CompressSampleArray(const ice::SampleArray &frame,
+	CompressedSampleArray &compressed)
+{
+	unsigned int count = (unsigned int)frame.values.length();
+	if (count > MAX_SAMPLE_ARRAY_VALUES)
+	{
+		return false;
+	}
+
+	CopyIdentifier(compressed.unique_device_identifier,
+		frame.unique_device_identifier);
+	CopyIdentifier(compressed.metric_id, frame.metric_id);
+	compressed.instance_id = frame.instance_id;
+	compressed.millisecondsPerSample = frame.millisecondsPerSample;
+	compressed.value_count = (DDS_UnsignedShort)count;
+
+	// Encode straight into the sequence, then trim it to the bytes used
+	size_t bound = WaveformEncodedBound(count);
+	if (!compressed.encoded_values.ensure_length((DDS_Long)bound,
+		MAX_COMPRESSED_WAVEFORM_BYTES))
+	{
+		return false;
+	}
+	size_t length = 0;
+	if (count > 0)
+	{
+		length = EncodeWaveform(frame.values.get_contiguous_buffer(), count,
+			compressed.encoded_values.get_contiguous_buffer());
+	}
+	compressed.encoded_values.length((DDS_Long)length);
+	return true;
+}
+
+bool DecompressWaveformValues(const CompressedSampleArray &compressed,
+	float *values)
+{
+	return DecodeWaveform(compressed.encoded_values.get_contiguous_buffer(),
+		compressed.encoded_values.length(), values, compressed.value_count);
+}
+
+bool DecompressSampleArray(const CompressedSampleArray &compressed,
+	ice::SampleArray &frame)
+{
+	if (compressed.value_count > MAX_SAMPLE_ARRAY_VALUES ||
+		!frame.values.ensure_length(compressed.value_count,
+			MAX_SAMPLE_ARRAY_VALUES))
+	{
+		return false;
+	}
+
+	CopyIdentifier(frame.unique_device_identifier,
+		compressed.unique_device_identifier);
+	CopyIdentifier(frame.metric_id, compressed.metric_id);
+	frame.instance_id = compressed.instance_id;
+	frame.millisecondsPerSample = compressed.millisecondsPerSample;
+
+	if (compressed.value_count == 0)
+	{
+		return compressed.encoded_values.length() == 0;
+	}
+	return DecompressWaveformValues(compressed,
+		frame.values.get_contiguous_buffer());
+}
+
+// ----------------------------------------------------------------------------
+// Compressed SampleArray writer
+DDSCompressedSampleArrayWriter::DDSCompressedSampleArrayWriter(
+	DDS::Publisher *pub, DDS::Topic *topic, const std::string &qosLibrary,
+	const std::string &qosProfile) :
+	_rawBytes(0),
+	_compressedBytes(0)
+{
+	DDS::DataWriter *writer = pub->create_datawriter_with_profile(topic,
+		qosLibrary.c_str(), qosProfile.c_str(), NULL, DDS_STATUS_MASK_NONE);
+	_writer = CompressedSampleArrayDataWriter::narrow(writer);
+	if (_writer == NULL)
+	{
+		std::stringstream errss;
+		errss <<
+			"Failure to create CompressedSampleArray writer. Inconsistent Qos?";
+		throw errss.str();
+	}
+}
+
+DDSCompressedSampleArrayWriter::~DDSCompressedSampleArrayWriter()
+{
+	DDS::Publisher *pub = _writer->get_publisher();
+	pub->delete_datawriter(_writer);
+	_writer = NULL;
+}
+
+bool DDSCompressedSampleArrayWriter::Write(const ice::SampleArray &frame)
+{
+	if (!CompressSampleArray(frame, _sample))
+	{
+		return false;
+	}
+	if (_writer->write(_sample, DDS_HANDLE_NIL) != DDS_RETCODE_OK)
+	{
+		return false;
+	}
+
+	CountFrame(frame);
+	return true;
+}
+
+bool DDSCompressedSampleArrayWriter::Write(const ice::SampleArray &frame,
+	const DDS_Time_t &sourceTime)
+{
+	if (!CompressSampleArray(frame, _sample))
+	{
+		return false;
+	}
+	if (_writer->write_w_timestamp(_sample, DDS_HANDLE_NIL, sourceTime) !=
+		DDS_RETCODE_OK)
+	{
+		return false;
+	}
+
+	CountFrame(frame);
+	return true;
+}
+
+void DDSCompressedSampleArrayWriter::CountFrame(const ice::SampleArray &frame)
+{
+	_rawBytes += frame.values.length() * sizeof(float);
+	_compressedBytes += _sample.encoded_values.length();
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_WAVEFORM_ADAPTER_H
+#define DDS_WAVEFORM_ADAPTER_H
+
+#include <string>
+#include "ndds/ndds_cpp.h"
+#include "ndds/ndds_namespace_cpp.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/waveform.h"
+#include "../Generated/waveformSupport.h"
+#include "DDSTypeWrapper.h"
+#include "WaveformCodec.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Waveform adapters:
+// Convert between ice::SampleArray and the CompressedSampleArray type of
+// waveform.idl, so applications keep working with ice::SampleArray while
+// the waveforms travel compressed.  The conversion is lossless: a frame
+// that is compressed and decompressed has exactly the same bits.
+//
+// The samples passed to the conversions must have their strings allocated
+// to their full bound, as DdsAutoType and the samples loaned by a
+// DataReader do.
+//
+// ------------------------------------------------------------------------- //
+
+// Bound of the values of an ice::SampleArray in ice.idl
+static const unsigned int MAX_SAMPLE_ARRAY_VALUES = 400;
+
+// Compresses the frame.  Returns false if the frame has more values than
+// ice::SampleArray allows.
+bool CompressSampleArray(const ice::SampleArray &frame,
+	com::rti::medical::generated::CompressedSampleArray &compressed);
+
+// Decompresses the frame.  Returns false if the encoded values are not
+// valid.
+bool DecompressSampleArray(
+	const com::rti::medical::generated::CompressedSampleArray &compressed,
+	ice::SampleArray &frame);
+
+// Decompresses only the values of the frame, into a buffer of at least
+// compressed.value_count floats
+bool DecompressWaveformValues(
+	const com::rti::medical::generated::CompressedSampleArray &compressed,
+	float *values);
+
+// ------------------------------------------------------------------------- //
+//
+// DDSCompressedSampleArrayWriter:
+// Writes ice::SampleArray frames on the CompressedSampleArray topic.  A
+// device gateway can use it in place of an ice::SampleArray DataWriter to
+// reduce the waveform bandwidth to the central station.
+//
+// ------------------------------------------------------------------------- //
+class DDSCompressedSampleArrayWriter
+{
+public:
+	// --- Constructor and destructor ---
+	// Creates the DataWriter on the Publisher.  Throws a std::string if the
+	// DataWriter cannot be created.
+	DDSCompressedSampleArrayWriter(DDS::Publisher *pub, DDS::Topic *topic,
+		const std::string &qosLibrary, const std::string &qosProfile);
+	~DDSCompressedSampleArrayWriter();
+
+	// --- Writing frames ---
+	// Compresses and writes the frame.  Returns false if it cannot be
+	// compressed or written.
+	bool Write(const ice::SampleArray &frame);
+
+	// Same, with the given source timestamp, for applications that forward
+	// frames and keep their original time
+	bool Write(const ice::SampleArray &frame, const DDS_Time_t &sourceTime);
+
+	// --- Statistics ---
+	// Bytes of values before and after compression, over all frames written
+	unsigned long long GetRawBytes() const
+	{
+		return _rawBytes;
+	}
+
+	unsigned long long GetCompressedBytes() const
+	{
+		return _compressedBytes;
+	}
+
+private:
+	// --- Private methods ---
+	void CountFrame(const ice::SampleArray &frame);
+
+	// --- Private members ---
+	com::rti::medical::generated::CompressedSampleArrayDataWriter *_writer;
+
+	// Reused for every frame, so writing does not allocate
+	DdsAutoType<com::rti::medical::generated::CompressedSampleArray> _sample;
+
+	unsigned long long _rawBytes;
+	unsigned long long _compressedBytes;
+};
+
+#endif
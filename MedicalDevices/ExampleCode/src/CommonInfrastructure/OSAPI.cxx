@@ -8,36 +8,145 @@
  any incidental or consequential damages arising out of the use or inability to
  use the software.
  ******************************************************************************/
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
 #include "../CommonInfrastructure/OSAPI.h"
 
+#ifdef RTI_WIN32
+  #include <psapi.h>
+  // For GetProcessMemoryInfo, so the projects need no change
+  #pragma comment(lib, "psapi.lib")
+#endif
+
+#ifdef RTI_DARWIN
+  #include <mach/mach.h>
+#endif
+
+#ifndef RTI_WIN32
+  #include <sched.h>
+#endif
+
+#ifdef RTI_LINUX
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+#endif
+
 OSThread::OSThread(
 	ThreadFunction function, 
 	void *functionParam)
 {
 	_function = function;
 	_functionParam = functionParam;
+	_hasRequestedScheduling = true;
 }
 
+OSThread::OSThread(
+	ThreadFunction function, 
+	void *functionParam,
+	const OSThreadOptions &options)
+{
+	_function = function;
+	_functionParam = functionParam;
+	_options = options;
+	_hasRequestedScheduling = true;
+}
+
+#ifdef RTI_WIN32
+// _beginthreadex returns a handle that stays valid until it is closed, so
+// the thread can be joined.  It needs a __stdcall function.
+unsigned __stdcall OSThread::ThreadStart(void *param)
+{
+	OSThread *thread = (OSThread *)param;
+	thread->_function(thread->_functionParam);
+	return 0;
+}
+#endif
+
 void OSThread::Run()
 {
 
 #ifdef RTI_WIN32
-    _thread = (HANDLE) _beginthread(
-		(void(__cdecl*)(void*))_function,
-        0, (void*)_functionParam);
+	// Created suspended, so the scheduling applies from the first instruction
+	_thread = (HANDLE) _beginthreadex(NULL, 0, ThreadStart, this,
+		CREATE_SUSPENDED, NULL);
+	if (_options.realTime)
+	{
+		_hasRequestedScheduling =
+			SetThreadPriority(_thread, THREAD_PRIORITY_TIME_CRITICAL) != 0;
+	} else if (_options.priority != 0)
+	{
+		_hasRequestedScheduling =
+			SetThreadPriority(_thread, _options.priority) != 0;
+	}
+	if (_options.cpu >= 0 &&
+		SetThreadAffinityMask(_thread, (DWORD_PTR)1 << _options.cpu) == 0)
+	{
+		_hasRequestedScheduling = false;
+	}
+	ResumeThread(_thread);
 #else
     pthread_attr_t threadAttr;
     pthread_attr_init(&threadAttr);
     pthread_attr_setdetachstate(&threadAttr, PTHREAD_CREATE_JOINABLE);
+
+	bool scheduled = false;
+	if (_options.realTime)
+	{
+		struct sched_param param;
+		param.sched_priority = _options.priority;
+		pthread_attr_setinheritsched(&threadAttr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&threadAttr, SCHED_FIFO);
+		pthread_attr_setschedparam(&threadAttr, &param);
+		scheduled = true;
+	}
+  #ifdef RTI_LINUX
+	if (_options.cpu >= 0)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(_options.cpu, &cpus);
+		pthread_attr_setaffinity_np(&threadAttr, sizeof(cpus), &cpus);
+		scheduled = true;
+	}
+  #else
+	if (_options.cpu >= 0)
+	{
+		_hasRequestedScheduling = false;
+	}
+  #endif
+
     int error = pthread_create(
                 &_thread, 
                 &threadAttr, 
                 _function,
                 (void *)_functionParam);
+
+	// Without permission for real-time scheduling, or with a CPU that does
+	// not exist, run the thread with the default scheduling instead
+	if (error != 0 && scheduled)
+	{
+		_hasRequestedScheduling = false;
+		pthread_attr_destroy(&threadAttr);
+		pthread_attr_init(&threadAttr);
+		pthread_attr_setdetachstate(&threadAttr, PTHREAD_CREATE_JOINABLE);
+		error = pthread_create(&_thread, &threadAttr, _function,
+			(void *)_functionParam);
+	}
     pthread_attr_destroy(&threadAttr);
   #endif
 }
 
+void OSThread::Join()
+{
+#ifdef RTI_WIN32
+	WaitForSingleObject(_thread, INFINITE);
+	CloseHandle(_thread);
+#else
+	pthread_join(_thread, NULL);
+#endif
+}
+
 OSMutex::OSMutex()
 {
 #ifdef RTI_WIN32
@@ -76,3 +185,625 @@ void OSMutex::Unlock()
 #endif
 }
 
+OSCondition::OSCondition()
+{
+#ifdef RTI_WIN32
+	InitializeCriticalSection(&_criticalSection);
+	InitializeConditionVariable(&_condition);
+#else
+	pthread_mutex_init(&_mutex, NULL);
+
+	// Timed waits are measured on the monotonic clock, so they are not
+	// affected by changes to the time of day
+	pthread_condattr_t conditionAttr;
+	pthread_condattr_init(&conditionAttr);
+  #ifndef RTI_DARWIN
+	pthread_condattr_setclock(&conditionAttr, CLOCK_MONOTONIC);
+  #endif
+	pthread_cond_init(&_condition, &conditionAttr);
+	pthread_condattr_destroy(&conditionAttr);
+#endif
+}
+
+OSCondition::~OSCondition()
+{
+#ifdef RTI_WIN32
+	DeleteCriticalSection(&_criticalSection);
+#else
+	pthread_cond_destroy(&_condition);
+	pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+void OSCondition::Lock()
+{
+#ifdef RTI_WIN32
+	EnterCriticalSection(&_criticalSection);
+#else
+	pthread_mutex_lock(&_mutex);
+#endif
+}
+
+void OSCondition::Unlock()
+{
+#ifdef RTI_WIN32
+	LeaveCriticalSection(&_criticalSection);
+#else
+	pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+void OSCondition::Wait()
+{
+#ifdef RTI_WIN32
+	SleepConditionVariableCS(&_condition, &_criticalSection, INFINITE);
+#else
+	pthread_cond_wait(&_condition, &_mutex);
+#endif
+}
+
+bool OSCondition::TimedWait(int64_t timeoutNanoseconds)
+{
+	if (timeoutNanoseconds < 0)
+	{
+		timeoutNanoseconds = 0;
+	}
+#ifdef RTI_WIN32
+	return SleepConditionVariableCS(&_condition, &_criticalSection,
+		(DWORD)((timeoutNanoseconds + 999999) / 1000000)) != 0;
+#elif defined(RTI_DARWIN)
+	struct timespec time;
+	time.tv_sec = (time_t)(timeoutNanoseconds / 1000000000LL);
+	time.tv_nsec = (long)(timeoutNanoseconds % 1000000000LL);
+	return pthread_cond_timedwait_relative_np(&_condition, &_mutex,
+		&time) == 0;
+#else
+	int64_t deadline = OSGetMonotonicTime() + timeoutNanoseconds;
+	struct timespec time;
+	time.tv_sec = (time_t)(deadline / 1000000000LL);
+	time.tv_nsec = (long)(deadline % 1000000000LL);
+	return pthread_cond_timedwait(&_condition, &_mutex, &time) == 0;
+#endif
+}
+
+void OSCondition::Signal()
+{
+#ifdef RTI_WIN32
+	WakeConditionVariable(&_condition);
+#else
+	pthread_cond_signal(&_condition);
+#endif
+}
+
+void OSCondition::Broadcast()
+{
+#ifdef RTI_WIN32
+	WakeAllConditionVariable(&_condition);
+#else
+	pthread_cond_broadcast(&_condition);
+#endif
+}
+
+int64_t OSGetMonotonicTime()
+{
+#ifdef RTI_WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (int64_t)((double)counter.QuadPart * 1e9 / frequency.QuadPart);
+#elif defined(RTI_DARWIN)
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+	{
+		mach_timebase_info(&timebase);
+	}
+	return (int64_t)(mach_absolute_time() * timebase.numer / timebase.denom);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+#endif
+}
+
+int64_t OSGetProcessCpuTime()
+{
+#ifdef RTI_WIN32
+	// The times are in units of 100 ns
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel,
+		&user))
+	{
+		return 0;
+	}
+	uint64_t total = ((uint64_t)kernel.dwHighDateTime << 32) +
+		kernel.dwLowDateTime + ((uint64_t)user.dwHighDateTime << 32) +
+		user.dwLowDateTime;
+	return (int64_t)total * 100;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+	return ((int64_t)usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+		1000000000LL +
+		((int64_t)usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+#endif
+}
+
+int64_t OSGetProcessResidentMemory()
+{
+#ifdef RTI_WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+		sizeof(counters)))
+	{
+		return 0;
+	}
+	return (int64_t)counters.WorkingSetSize;
+#elif defined(RTI_DARWIN)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+		(task_info_t)&info, &count) != KERN_SUCCESS)
+	{
+		return 0;
+	}
+	return (int64_t)info.resident_size;
+#else
+	// The second field of statm is the resident size, in pages
+	FILE *statm = fopen("/proc/self/statm", "r");
+	if (statm == NULL)
+	{
+		return 0;
+	}
+	long size = 0;
+	long resident = 0;
+	int fields = fscanf(statm, "%ld %ld", &size, &resident);
+	fclose(statm);
+	if (fields != 2)
+	{
+		return 0;
+	}
+	return (int64_t)resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+OSMappedFile::OSMappedFile() : _data(NULL), _size(0)
+#ifdef RTI_WIN32
+	, _file(INVALID_HANDLE_VALUE), _mapping(NULL)
+#endif
+{
+}
+
+OSMappedFile::~OSMappedFile()
+{
+	Close();
+}
+
+bool OSMappedFile::Open(const std::string &fileName)
+{
+	Close();
+
+#ifdef RTI_WIN32
+	_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	_mapping = CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (_mapping == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	_data = (const unsigned char *)MapViewOfFile(_mapping, FILE_MAP_READ, 
+		0, 0, 0);
+	if (_data == NULL)
+	{
+		Close();
+		return false;
+	}
+	_size = (size_t)fileSize.QuadPart;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file, so the descriptor 
+	// can be closed right away
+	void *mapped = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, 
+		MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		return false;
+	}
+
+	_data = (const unsigned char *)mapped;
+	_size = (size_t)fileStat.st_size;
+#endif
+
+	return true;
+}
+
+void OSMappedFile::Close()
+{
+#ifdef RTI_WIN32
+	if (_data != NULL)
+	{
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != NULL)
+	{
+		CloseHandle(_mapping);
+		_mapping = NULL;
+	}
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (_data != NULL)
+	{
+		munmap((void *)_data, _size);
+	}
+#endif
+	_data = NULL;
+	_size = 0;
+}
+
+OSSharedMemory::OSSharedMemory() : _data(NULL), _size(0), _created(false)
+#ifdef RTI_WIN32
+	, _mapping(NULL)
+#else
+	, _device(0), _inode(0)
+#endif
+{
+}
+
+OSSharedMemory::~OSSharedMemory()
+{
+	Close();
+}
+
+bool OSSharedMemory::Create(const std::string &name, size_t size)
+{
+	Close();
+
+#ifdef RTI_WIN32
+	// The region is freed when the last handle to it is closed, so a region
+	// that already exists belongs to a process that is still running
+	std::string mappingName = "Local\\" + name;
+	_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+		(DWORD)((uint64_t)size >> 32), (DWORD)size, mappingName.c_str());
+	if (_mapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		Close();
+		return false;
+	}
+
+	_data = (unsigned char *)MapViewOfFile(_mapping, FILE_MAP_WRITE, 0, 0,
+		size);
+	if (_data == NULL)
+	{
+		Close();
+		return false;
+	}
+#else
+	// An object of the same name may belong to a process that still runs,
+	// so it is never replaced here
+	std::string objectName = "/" + name;
+	int fd = shm_open(objectName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	// A new object is filled with zeros when it is extended
+	struct stat objectStat;
+	if (fstat(fd, &objectStat) != 0 || ftruncate(fd, (off_t)size) != 0)
+	{
+		close(fd);
+		shm_unlink(objectName.c_str());
+		return false;
+	}
+
+	void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+		0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		shm_unlink(objectName.c_str());
+		return false;
+	}
+	_data = (unsigned char *)mapped;
+	_device = objectStat.st_dev;
+	_inode = objectStat.st_ino;
+#endif
+
+	_size = size;
+	_name = name;
+	_created = true;
+	return true;
+}
+
+bool OSSharedMemory::Open(const std::string &name)
+{
+	Close();
+
+#ifdef RTI_WIN32
+	std::string mappingName = "Local\\" + name;
+	_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName.c_str());
+	if (_mapping == NULL)
+	{
+		return false;
+	}
+
+	_data = (unsigned char *)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (_data == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	// The size of the view is rounded up to whole pages
+	MEMORY_BASIC_INFORMATION region;
+	if (VirtualQuery(_data, &region, sizeof(region)) == 0)
+	{
+		Close();
+		return false;
+	}
+	_size = region.RegionSize;
+#else
+	std::string objectName = "/" + name;
+	int fd = shm_open(objectName.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat objectStat;
+	if (fstat(fd, &objectStat) != 0 || objectStat.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void *mapped = mmap(NULL, (size_t)objectStat.st_size, PROT_READ,
+		MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		return false;
+	}
+	_data = (unsigned char *)mapped;
+	_size = (size_t)objectStat.st_size;
+#endif
+
+	_name = name;
+	return true;
+}
+
+void OSSharedMemory::Close()
+{
+#ifdef RTI_WIN32
+	if (_data != NULL)
+	{
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != NULL)
+	{
+		CloseHandle(_mapping);
+		_mapping = NULL;
+	}
+#else
+	if (_data != NULL)
+	{
+		munmap(_data, _size);
+	}
+	if (_created)
+	{
+		// The name is only removed if it still refers to the object this
+		// created, and not to the object of a process that replaced it
+		std::string objectName = "/" + _name;
+		int fd = shm_open(objectName.c_str(), O_RDONLY, 0);
+		if (fd >= 0)
+		{
+			struct stat objectStat;
+			if (fstat(fd, &objectStat) == 0 &&
+				objectStat.st_dev == _device && objectStat.st_ino == _inode)
+			{
+				shm_unlink(objectName.c_str());
+			}
+			close(fd);
+		}
+	}
+#endif
+	_data = NULL;
+	_size = 0;
+	_name.clear();
+	_created = false;
+}
+
+bool OSSharedMemory::Remove(const std::string &name)
+{
+#ifdef RTI_WIN32
+	(void)name;
+	return false;
+#else
+	return shm_unlink(("/" + name).c_str()) == 0;
+#endif
+}
+
+void OSWaitForChange(const volatile uint32_t *address, uint32_t value,
+	int64_t timeoutNanoseconds)
+{
+#ifdef RTI_LINUX
+	// The futex is not private, so it is found from the shared memory
+	// object, and a writer in another process wakes this thread
+	struct timespec timeout;
+	timeout.tv_sec = (time_t)(timeoutNanoseconds / 1000000000LL);
+	timeout.tv_nsec = (long)(timeoutNanoseconds % 1000000000LL);
+	syscall(SYS_futex, address, FUTEX_WAIT, value, &timeout, NULL, 0);
+#else
+	int64_t deadline = OSGetMonotonicTime() + timeoutNanoseconds;
+	while (*address == value && OSGetMonotonicTime() < deadline)
+	{
+#ifdef RTI_WIN32
+		Sleep(1);
+#else
+		usleep(1000);
+#endif
+	}
+#endif
+}
+
+void OSWakeWaiters(const volatile uint32_t *address)
+{
+#ifdef RTI_LINUX
+	syscall(SYS_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#else
+	// The waiters check the word every millisecond
+	(void)address;
+#endif
+}
+
+void OSYieldThread()
+{
+#ifdef RTI_WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+void OSSleep(int64_t nanoseconds)
+{
+#ifdef RTI_WIN32
+	Sleep((DWORD)((nanoseconds + 999999) / 1000000));
+#else
+	struct timespec duration;
+	duration.tv_sec = (time_t)(nanoseconds / 1000000000LL);
+	duration.tv_nsec = (long)(nanoseconds % 1000000000LL);
+	// A signal ends the sleep early, with the time that is left
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR)
+	{
+	}
+#endif
+}
+
+bool OSCreateDirectory(const std::string &path)
+{
+	// Create each parent directory in turn.  Errors are ignored until the 
+	// last one, because the parents usually exist already.
+	for (size_t pos = path.find_first_of("/\\", 1); 
+		pos != std::string::npos; 
+		pos = path.find_first_of("/\\", pos + 1))
+	{
+		std::string parent = path.substr(0, pos);
+#ifdef RTI_WIN32
+		CreateDirectoryA(parent.c_str(), NULL);
+#else
+		mkdir(parent.c_str(), 0755);
+#endif
+	}
+
+#ifdef RTI_WIN32
+	if (!CreateDirectoryA(path.c_str(), NULL) && 
+		GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		return false;
+	}
+#else
+	if (mkdir(path.c_str(), 0755) != 0)
+	{
+		struct stat dirStat;
+		if (stat(path.c_str(), &dirStat) != 0 || !S_ISDIR(dirStat.st_mode))
+		{
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+bool OSRenameFile(const std::string &from, const std::string &to)
+{
+#ifdef RTI_WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), 
+		MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool OSFileExists(const std::string &path)
+{
+#ifdef RTI_WIN32
+	return GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+	struct stat fileStat;
+	return stat(path.c_str(), &fileStat) == 0;
+#endif
+}
+
+bool OSListDirectory(const std::string &path, 
+	std::vector<std::string> &entries)
+{
+#ifdef RTI_WIN32
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((path + "\\*").c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	do
+	{
+		std::string name = findData.cFileName;
+		if (name != "." && name != "..")
+		{
+			entries.push_back(name);
+		}
+	} while (FindNextFileA(find, &findData));
+	FindClose(find);
+#else
+	DIR *dir = opendir(path.c_str());
+	if (dir == NULL)
+	{
+		return false;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		std::string name = entry->d_name;
+		if (name != "." && name != "..")
+		{
+			entries.push_back(name);
+		}
+	}
+	closedir(dir);
+#endif
+	return true;
+}
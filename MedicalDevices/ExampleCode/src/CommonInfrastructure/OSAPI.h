@@ -33,9 +33,23 @@
   #include <sys/select.h>
   #include <semaphore.h>
   #include <pthread.h> 
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <sys/types.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <dirent.h>
+  #include <time.h>
+  #include <sys/resource.h>
 #endif
 
+#ifdef RTI_DARWIN
+  #include <mach/mach_time.h>
+#endif
+
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 // ------------------------------------------------------------------------- //
 //
@@ -49,6 +63,32 @@
 // function.
 typedef void* (*ThreadFunction)(void *);   
 
+// ------------------------------------------------------------------------- //
+// Scheduling options of a thread
+//
+// By default a thread is scheduled like any other thread of the process.
+// Latency-critical threads can ask for a real-time policy, and can be pinned
+// to a CPU so they do not compete with other threads for it.
+// ------------------------------------------------------------------------- //
+struct OSThreadOptions
+{
+	OSThreadOptions() : realTime(false), priority(0), cpu(-1)
+	{
+	}
+
+	// Use the SCHED_FIFO policy on Linux and Mac OS, or the time-critical
+	// priority on Windows
+	bool realTime;
+
+	// SCHED_FIFO priority (1 to 99 on Linux), or the Windows thread priority
+	// (-2 to 2) when realTime is false.  Ignored on Linux and Mac OS when
+	// realTime is false.
+	int priority;
+
+	// CPU to run the thread on, or -1 for any CPU.  Not supported on Mac OS.
+	int cpu;
+};
+
 // ------------------------------------------------------------------------- //
 // Wrap threads
 //
@@ -62,10 +102,30 @@ public:
 	OSThread(ThreadFunction function, 
 		void *functionParam);
 
+	OSThread(ThreadFunction function, 
+		void *functionParam,
+		const OSThreadOptions &options);
+
 	// Run the thread
 	void Run();
 
+	// Wait for the thread function to return
+	void Join();
+
+	// False if the scheduling options could not be applied, usually because
+	// the process is not allowed to use real-time scheduling.  The thread
+	// then runs with the default scheduling.
+	bool HasRequestedScheduling() const
+	{
+		return _hasRequestedScheduling;
+	}
+
 private:
+	// --- Private methods ---
+#ifdef RTI_WIN32
+	static unsigned __stdcall ThreadStart(void *param);
+#endif
+
 	// --- Private members ---
 
 	// OS-specific thread definition
@@ -79,6 +139,10 @@ private:
 
 	// Parameter to the function
 	void *_functionParam;
+
+	// Scheduling of the thread
+	OSThreadOptions _options;
+	bool _hasRequestedScheduling;
 };
 
 // ------------------------------------------------------------------------- //
@@ -107,5 +171,249 @@ private:
 #endif
 };
 
+// ------------------------------------------------------------------------- //
+// Wrap condition variables
+//
+// A condition variable with its own mutex.  Wait and TimedWait must be called
+// with the condition locked, and return with it locked.
+// ------------------------------------------------------------------------- //
+class OSCondition
+{
+public:
+	// --- Constructor and destructor --- 
+	OSCondition();
+	~OSCondition();
+
+	// --- Lock and unlock the mutex of the condition --- 
+	void Lock();
+	void Unlock();
+
+	// --- Wait for and signal the condition --- 
+	void Wait();
+
+	// Returns false if the timeout expired before the condition was
+	// signaled
+	bool TimedWait(int64_t timeoutNanoseconds);
+
+	void Signal();
+	void Broadcast();
+
+private:
+	// --- Private members ---
+
+	// OS-specific mutex and condition variable
+#ifdef RTI_WIN32
+	CRITICAL_SECTION _criticalSection;
+	CONDITION_VARIABLE _condition;
+#else
+	pthread_mutex_t _mutex;
+	pthread_cond_t _condition;
+#endif
+};
+
+// ------------------------------------------------------------------------- //
+// Wrap the monotonic clock
+//
+// Returns a time in nanoseconds that never goes backwards, for measuring
+// intervals and deadlines.  It is unrelated to the time of day.
+// ------------------------------------------------------------------------- //
+int64_t OSGetMonotonicTime();
+
+// Returns the CPU time used by all the threads of the process so far, user
+// and system, in nanoseconds
+int64_t OSGetProcessCpuTime();
+
+// Returns the memory of the process that is resident in RAM, in bytes.  Pages
+// that are shared with other processes, or mapped more than once, are
+// counted in every mapping.
+int64_t OSGetProcessResidentMemory();
+
+// ------------------------------------------------------------------------- //
+// Wrap read-only memory-mapped files
+//
+// Maps an entire file into the address space of the process, so that large
+// files can be scanned without copying them into application buffers.  The
+// mapping is released when the object is closed or destroyed.
+// ------------------------------------------------------------------------- //
+class OSMappedFile
+{
+public:
+	// --- Constructor and destructor --- 
+	OSMappedFile();
+	~OSMappedFile();
+
+	// --- Map and unmap a file --- 
+	// Returns false if the file does not exist, is empty, or cannot be 
+	// mapped
+	bool Open(const std::string &fileName);
+	void Close();
+
+	// --- Accessors for the mapped memory --- 
+	const unsigned char *GetData() const 
+	{
+		return _data;
+	}
+
+	size_t GetSize() const 
+	{
+		return _size;
+	}
+
+private:
+	// --- Private members ---
+
+	// Start and size of the mapped region
+	const unsigned char *_data;
+	size_t _size;
+
+	// OS-specific file and mapping handles
+#ifdef RTI_WIN32
+	HANDLE _file;
+	HANDLE _mapping;
+#endif
+};
+
+// ------------------------------------------------------------------------- //
+// Wrap named shared memory
+//
+// A region of memory with a name, that other processes on the same host can
+// map.  One process creates the region and maps it read-write, and the
+// others open it by name and map it read-only.  On Linux and Mac OS this is
+// a POSIX shared memory object, and on Windows a named file mapping backed
+// by the paging file.
+// ------------------------------------------------------------------------- //
+class OSSharedMemory
+{
+public:
+	// --- Constructor and destructor --- 
+	OSSharedMemory();
+	~OSSharedMemory();
+
+	// --- Create, open and close a region --- 
+	// Creates the region with size bytes set to zero, and maps it
+	// read-write.  Returns false if a region of this name already exists,
+	// or the region cannot be created or mapped.
+	bool Create(const std::string &name, size_t size);
+
+	// Maps an existing region read-only.  Returns false if there is no
+	// region with this name, or it cannot be mapped.
+	bool Open(const std::string &name);
+
+	// Unmaps the region.  The name of a region created by this object is
+	// removed, unless another process removed it and created a new region
+	// with it, and the memory is freed once every process has closed it.
+	void Close();
+
+	// Removes the name of a region, so Create can make a new one.  Only
+	// used for a region left behind by a process that stopped: processes
+	// that map the old region keep it until they close it.  On Windows a
+	// region has no name once its last handle is closed, and one that is
+	// still open cannot be removed, so this returns false.
+	static bool Remove(const std::string &name);
+
+	// --- Accessors for the mapped memory --- 
+	const unsigned char *GetData() const 
+	{
+		return _data;
+	}
+
+	// NULL unless the region was created by this object
+	unsigned char *GetWritableData() const 
+	{
+		return _created ? _data : NULL;
+	}
+
+	size_t GetSize() const 
+	{
+		return _size;
+	}
+
+private:
+	// --- Private members ---
+
+	// Start and size of the mapped region
+	unsigned char *_data;
+	size_t _size;
+
+	// Name of the region, and whether this object created it
+	std::string _name;
+	bool _created;
+
+	// OS-specific mapping handle, or the identity of the object created,
+	// to tell whether its name still refers to it
+#ifdef RTI_WIN32
+	HANDLE _mapping;
+#else
+	dev_t _device;
+	ino_t _inode;
+#endif
+};
+
+// ------------------------------------------------------------------------- //
+// Wrap memory ordering and waiting on shared memory
+//
+// Used by lock-free structures that are shared between threads or
+// processes.  The wait and wake functions work across processes that map
+// the same shared memory, even when the waiting process maps it read-only.
+// ------------------------------------------------------------------------- //
+
+// Orders the loads before the fence before the loads after it, and the
+// stores before the fence before the stores after it.  x86 CPUs do not
+// reorder loads with loads or stores with stores, so there these only stop
+// the compiler from moving them, and cost nothing at run time.
+inline void OSReadFence()
+{
+#if defined(RTI_WIN32) && (defined(_M_IX86) || defined(_M_X64))
+	_ReadWriteBarrier();
+#elif defined(RTI_WIN32)
+	MemoryBarrier();
+#elif defined(__i386__) || defined(__x86_64__)
+	__asm__ __volatile__("" : : : "memory");
+#else
+	__sync_synchronize();
+#endif
+}
+
+inline void OSWriteFence()
+{
+	OSReadFence();
+}
+
+// Waits until the word at address no longer holds value, or the timeout
+// passes.  This may also return early, so callers check the word again.
+// On Linux the thread sleeps in a futex until it is woken; elsewhere it
+// checks the word every millisecond.
+void OSWaitForChange(const volatile uint32_t *address, uint32_t value,
+	int64_t timeoutNanoseconds);
+
+// Wakes the threads, of any process, that wait for the word at address to
+// change.  Call it after changing the word.
+void OSWakeWaiters(const volatile uint32_t *address);
+
+// Gives the rest of the time slice of the thread to other threads, such as
+// one that holds a structure a spinning thread waits for
+void OSYieldThread();
+
+// Puts the thread to sleep for at least the given time
+void OSSleep(int64_t nanoseconds);
+
+// ------------------------------------------------------------------------- //
+// Wrap file system operations
+// ------------------------------------------------------------------------- //
+
+// Creates a directory and any missing parent directories.  Returns true if
+// the directory exists when the call returns.
+bool OSCreateDirectory(const std::string &path);
+
+// Atomically renames a file, replacing the destination if it exists.
+bool OSRenameFile(const std::string &from, const std::string &to);
+
+// Returns true if a file or directory exists at the path
+bool OSFileExists(const std::string &path);
+
+// Lists the names of the entries in a directory, not including "." and "..".
+// Returns false if the directory cannot be read.
+bool OSListDirectory(const std::string &path, 
+	std::vector<std::string> &entries);
 
 #endif
@@ -0,0 +1,446 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+#include "SharedVitalsBoard.h"
+
+const char *VITALS_BOARD_DEFAULT_NAME = "MedicalVitalsBoard";
+
+// Bound of the device and metric IDs in ice.idl
+static const size_t IDENTIFIER_BOUND = 64;
+
+// Built without a stringstream, as this runs for every sample
+static void MakeStreamKey(const char *deviceId, const char *metricId,
+	int instanceId, std::string &key)
+{
+	char instance[16];
+	sprintf(instance, "%d", instanceId);
+	key.assign(deviceId);
+	key.append("|").append(metricId).append("|").append(instance);
+}
+
+static void CopyIdentifier(char *to, const char *from)
+{
+	strncpy(to, from, IDENTIFIER_BOUND);
+	to[IDENTIFIER_BOUND] = '\0';
+}
+
+// A 64-bit value may be read in two halves on 32-bit CPUs, so the heartbeat
+// is read until two reads agree
+static int64_t ReadHeartbeat(const VitalsBoardHeader *header)
+{
+	int64_t heartbeat = header->heartbeat;
+	int64_t again = header->heartbeat;
+	while (heartbeat != again)
+	{
+		heartbeat = again;
+		again = header->heartbeat;
+	}
+	return heartbeat;
+}
+
+// Checks the board of this name, that could not be created because it
+// exists.  Returns true if it may be replaced: its writer closed it, or it
+// is stalled.  The header is complete once it has the magic number, so a
+// board without one is checked again once it would be stalled, in case its
+// writer is creating it right now.  A board of another layout is never
+// replaced, as its heartbeat cannot be read.
+static bool IsBoardAbandoned(const std::string &name)
+{
+	for (int check = 0; check < 2; check++)
+	{
+		if (check > 0)
+		{
+			OSSleep(VITALS_BOARD_STALE_NANOSECONDS);
+		}
+
+		OSSharedMemory memory;
+		if (!memory.Open(name) ||
+			memory.GetSize() < sizeof(VitalsBoardHeader))
+		{
+			continue;
+		}
+
+		const VitalsBoardHeader *header =
+			(const VitalsBoardHeader *)memory.GetData();
+		if (header->magic != VITALS_BOARD_MAGIC)
+		{
+			continue;
+		}
+		OSReadFence();
+		if (header->layoutVersion != VITALS_BOARD_LAYOUT_VERSION)
+		{
+			return false;
+		}
+		return header->closed != 0 || OSGetMonotonicTime() -
+			ReadHeartbeat(header) > VITALS_BOARD_STALE_NANOSECONDS;
+	}
+	return true;
+}
+
+// Tries on a slot the writer is changing before the reader yields the CPU,
+// and before it starts to sleep between tries.  A write takes well under a
+// microsecond, so the first tries only wait for a writer that runs on
+// another CPU, and the yields for one that was preempted.
+static const int SPINS_BEFORE_YIELD = 200;
+static const int YIELDS_BEFORE_SLEEP = 100;
+
+// ----------------------------------------------------------------------------
+// VitalsBoardWriter
+
+VitalsBoardWriter::VitalsBoardWriter(const std::string &name,
+	unsigned int slotCount) :
+	_changed(false),
+	_updateCount(0),
+	_fullCount(0)
+{
+	size_t size = sizeof(VitalsBoardHeader) +
+		(size_t)slotCount * sizeof(VitalsBoardSlot);
+	bool created = slotCount > 0 && _memory.Create(name, size);
+	if (!created && slotCount > 0 && IsBoardAbandoned(name) &&
+		OSSharedMemory::Remove(name))
+	{
+		created = _memory.Create(name, size);
+	}
+	if (!created)
+	{
+		std::stringstream errss;
+		errss << "Failed to create the vitals board " << name
+			<< ", or another writer is still using it";
+		throw errss.str();
+	}
+
+	// The memory starts out filled with zeros, so every slot is free and
+	// even, and only the header needs to be filled in
+	_header = (VitalsBoardHeader *)_memory.GetWritableData();
+	_slots = (VitalsBoardSlot *)(_memory.GetWritableData() +
+		sizeof(VitalsBoardHeader));
+	_header->slotCount = slotCount;
+	_header->slotSize = sizeof(VitalsBoardSlot);
+	_header->heartbeat = OSGetMonotonicTime();
+	_header->layoutVersion = VITALS_BOARD_LAYOUT_VERSION;
+
+	// A reader that finds the magic number finds the rest of the header
+	OSWriteFence();
+	_header->magic = VITALS_BOARD_MAGIC;
+}
+
+VitalsBoardWriter::~VitalsBoardWriter()
+{
+	_header->closed = 1;
+	OSWriteFence();
+	_header->generation++;
+	OSWakeWaiters(&_header->generation);
+}
+
+bool VitalsBoardWriter::UpdateValue(const char *deviceId,
+	const char *metricId, int instanceId, float value, int64_t timestamp)
+{
+	std::string key;
+	MakeStreamKey(deviceId, metricId, instanceId, key);
+
+	std::map<std::string, uint32_t>::iterator it = _streamSlots.find(key);
+	if (it != _streamSlots.end())
+	{
+		VitalsBoardSlot &slot = _slots[it->second];
+		BeginWrite(slot);
+		slot.value.value = value;
+		slot.value.timestamp = timestamp;
+		EndWrite(slot);
+		_changed = true;
+		_updateCount++;
+		return true;
+	}
+
+	// A new stream takes a freed slot, or the first slot never used
+	uint32_t index;
+	bool reused = !_freeSlots.empty();
+	if (reused)
+	{
+		index = _freeSlots.back();
+		_freeSlots.pop_back();
+	} else if (_header->slotsUsed < _header->slotCount)
+	{
+		index = _header->slotsUsed;
+	} else
+	{
+		_fullCount++;
+		return false;
+	}
+
+	std::map<std::string, int>::const_iterator patient =
+		_devicePatients.find(deviceId);
+
+	VitalsBoardSlot &slot = _slots[index];
+	BeginWrite(slot);
+	slot.inUse = 1;
+	slot.value.patientId = patient == _devicePatients.end() ?
+		VITALS_BOARD_NO_PATIENT : patient->second;
+	slot.value.instanceId = instanceId;
+	slot.value.value = value;
+	slot.value.timestamp = timestamp;
+	CopyIdentifier(slot.value.deviceId, deviceId);
+	CopyIdentifier(slot.value.metricId, metricId);
+	EndWrite(slot);
+
+	// Readers only look at the slot once it is complete
+	if (!reused)
+	{
+		_header->slotsUsed = index + 1;
+	}
+
+	_streamSlots[key] = index;
+	_changed = true;
+	_updateCount++;
+	return true;
+}
+
+void VitalsBoardWriter::RemoveValue(const char *deviceId,
+	const char *metricId, int instanceId)
+{
+	std::string key;
+	MakeStreamKey(deviceId, metricId, instanceId, key);
+
+	std::map<std::string, uint32_t>::iterator it = _streamSlots.find(key);
+	if (it == _streamSlots.end())
+	{
+		return;
+	}
+
+	VitalsBoardSlot &slot = _slots[it->second];
+	BeginWrite(slot);
+	slot.inUse = 0;
+	EndWrite(slot);
+
+	_freeSlots.push_back(it->second);
+	_streamSlots.erase(it);
+	_changed = true;
+}
+
+void VitalsBoardWriter::SetDevicePatient(const std::string &deviceId,
+	int patientId)
+{
+	_devicePatients[deviceId] = patientId;
+	SetSlotPatients(deviceId, patientId);
+}
+
+void VitalsBoardWriter::RemoveDevicePatient(const std::string &deviceId)
+{
+	_devicePatients.erase(deviceId);
+	SetSlotPatients(deviceId, VITALS_BOARD_NO_PATIENT);
+}
+
+void VitalsBoardWriter::Publish()
+{
+	_header->heartbeat = OSGetMonotonicTime();
+	if (!_changed)
+	{
+		return;
+	}
+
+	// Every update of the batch is visible before the new generation
+	OSWriteFence();
+	_header->generation++;
+	OSWakeWaiters(&_header->generation);
+	_changed = false;
+}
+
+void VitalsBoardWriter::BeginWrite(VitalsBoardSlot &slot)
+{
+	slot.sequence++;
+	OSWriteFence();
+}
+
+void VitalsBoardWriter::EndWrite(VitalsBoardSlot &slot)
+{
+	OSWriteFence();
+	slot.sequence++;
+}
+
+void VitalsBoardWriter::SetSlotPatients(const std::string &deviceId,
+	int patientId)
+{
+	std::string prefix = deviceId + "|";
+	for (std::map<std::string, uint32_t>::const_iterator it =
+		_streamSlots.lower_bound(prefix);
+		it != _streamSlots.end() &&
+			it->first.compare(0, prefix.size(), prefix) == 0;
+		++it)
+	{
+		VitalsBoardSlot &slot = _slots[it->second];
+		BeginWrite(slot);
+		slot.value.patientId = patientId;
+		EndWrite(slot);
+		_changed = true;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// VitalsBoardReader
+
+VitalsBoardReader::VitalsBoardReader() :
+	_header(NULL),
+	_slots(NULL)
+{
+}
+
+bool VitalsBoardReader::Open(const std::string &name)
+{
+	Close();
+	if (!_memory.Open(name) ||
+		_memory.GetSize() < sizeof(VitalsBoardHeader))
+	{
+		_memory.Close();
+		return false;
+	}
+
+	const VitalsBoardHeader *header =
+		(const VitalsBoardHeader *)_memory.GetData();
+	if (header->magic != VITALS_BOARD_MAGIC)
+	{
+		_memory.Close();
+		return false;
+	}
+	OSReadFence();
+	if (header->layoutVersion != VITALS_BOARD_LAYOUT_VERSION ||
+		header->slotSize != sizeof(VitalsBoardSlot) ||
+		_memory.GetSize() < sizeof(VitalsBoardHeader) +
+			(size_t)header->slotCount * sizeof(VitalsBoardSlot))
+	{
+		_memory.Close();
+		return false;
+	}
+
+	_header = header;
+	_slots = (const VitalsBoardSlot *)(_memory.GetData() +
+		sizeof(VitalsBoardHeader));
+	return true;
+}
+
+void VitalsBoardReader::Close()
+{
+	_memory.Close();
+	_header = NULL;
+	_slots = NULL;
+}
+
+int64_t VitalsBoardReader::GetHeartbeat() const
+{
+	return ReadHeartbeat(_header);
+}
+
+bool VitalsBoardReader::IsStalled() const
+{
+	return OSGetMonotonicTime() - ReadHeartbeat(_header) >
+		VITALS_BOARD_STALE_NANOSECONDS;
+}
+
+uint32_t VitalsBoardReader::WaitForChange(uint32_t generation,
+	int64_t timeoutNanoseconds) const
+{
+	if (_header->generation == generation)
+	{
+		OSWaitForChange(&_header->generation, generation,
+			timeoutNanoseconds);
+	}
+	uint32_t current = _header->generation;
+	OSReadFence();
+	return current;
+}
+
+bool VitalsBoardReader::ReadValues(int patientId,
+	std::vector<VitalsBoardValue> &values) const
+{
+	uint32_t slotsUsed = _header->slotsUsed;
+	OSReadFence();
+
+	bool complete = true;
+	VitalsBoardValue value;
+	for (uint32_t i = 0; i < slotsUsed; i++)
+	{
+		SlotCopy copy = CopySlot(_slots[i], patientId, value);
+		if (copy == SLOT_COPIED)
+		{
+			values.push_back(value);
+		} else if (copy == SLOT_STALLED)
+		{
+			complete = false;
+		}
+	}
+	return complete;
+}
+
+bool VitalsBoardReader::ReadValue(const char *deviceId,
+	const char *metricId, int instanceId, VitalsBoardValue &value) const
+{
+	uint32_t slotsUsed = _header->slotsUsed;
+	OSReadFence();
+
+	for (uint32_t i = 0; i < slotsUsed; i++)
+	{
+		if (CopySlot(_slots[i], VITALS_BOARD_ALL_PATIENTS, value) ==
+				SLOT_COPIED &&
+			value.instanceId == instanceId &&
+			strcmp(value.deviceId, deviceId) == 0 &&
+			strcmp(value.metricId, metricId) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+VitalsBoardReader::SlotCopy VitalsBoardReader::CopySlot(
+	const VitalsBoardSlot &slot, int patientId,
+	VitalsBoardValue &value) const
+{
+	for (int tries = 1; ; tries++)
+	{
+		uint32_t sequence = slot.sequence;
+		OSReadFence();
+		if ((sequence & 1) == 0)
+		{
+			bool match = slot.inUse != 0 &&
+				(patientId == VITALS_BOARD_ALL_PATIENTS ||
+					slot.value.patientId == patientId);
+			if (match)
+			{
+				memcpy(&value, (const void *)&slot.value, sizeof(value));
+			}
+
+			OSReadFence();
+			if (slot.sequence == sequence)
+			{
+				return match ? SLOT_COPIED : SLOT_NOT_MATCHED;
+			}
+		}
+
+		// The writer is changing the slot right now.  A writer that stopped
+		// in the middle never finishes, so past the first tries the reader
+		// gives up once the heartbeat says the writer stopped.
+		if (tries < SPINS_BEFORE_YIELD)
+		{
+			continue;
+		}
+		if (IsStalled())
+		{
+			return SLOT_STALLED;
+		}
+		if (tries < SPINS_BEFORE_YIELD + YIELDS_BEFORE_SLEEP)
+		{
+			OSYieldThread();
+		} else
+		{
+			OSSleep(1000000);
+		}
+	}
+}
@@ -0,0 +1,325 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef SHARED_VITALS_BOARD_H
+#define SHARED_VITALS_BOARD_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "OSAPI.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Shared vitals board:
+// The latest value of every numeric stream received on a host, in a region
+// of shared memory that one ingest process writes, and that any number of
+// processes on the same host map read-only.  A display process reads the
+// values of its patient with a few memory copies, without a
+// DomainParticipant or a DataReader, and without its own copy of every
+// value.
+//
+// Layout of the region:
+//   VitalsBoardHeader
+//   VitalsBoardSlot  (slotCount of them, one per stream)
+//
+// Every field has a fixed size and offset, so processes built separately
+// agree on the layout.  The header holds a magic number and the version of
+// the layout, and a reader does not open a board of another version.  The
+// string lengths match the bounds of ice::UniqueDeviceIdentifier and
+// ice::MetricIdentifier.
+//
+// Readers never lock.  Each slot has a sequence number that the writer
+// makes odd before it changes the slot, and even again after.  A reader
+// copies a slot between two reads of its sequence, and copies it again if
+// the sequence was odd or has changed, so it never sees half of an update,
+// and the writer never waits for a reader.  A writer that stops in the
+// middle of a write leaves the sequence odd, so a reader that finds an odd
+// sequence for longer than a few hundred tries checks the heartbeat of the
+// writer, and gives up on a stalled board instead of spinning forever.
+//
+// Slots are only given to streams by the writer.  A new stream is written
+// to its slot before the slot is counted in slotsUsed, and the slot of a
+// stream that is removed is given to the next new stream.
+//
+// The header holds a generation number, that the writer increments after
+// each batch of updates.  A reader polls it, or waits for it to change (see
+// OSWaitForChange).
+//
+// ------------------------------------------------------------------------- //
+
+// Identifies a vitals board, and the version of its layout
+static const uint32_t VITALS_BOARD_MAGIC = 0x56424452;
+static const uint32_t VITALS_BOARD_LAYOUT_VERSION = 1;
+
+// Name of the board used when none is given
+extern const char *VITALS_BOARD_DEFAULT_NAME;
+
+// A board whose heartbeat is older than this is stalled: its writer stopped
+// or hangs.  Readers give up on the slots it left half written, and a new
+// writer may replace it.
+static const int64_t VITALS_BOARD_STALE_NANOSECONDS = 2000000000LL;
+
+// Patient of the streams of a device that is not mapped to a patient, and
+// the patient ID that matches every stream when reading
+static const int32_t VITALS_BOARD_NO_PATIENT = -1;
+static const int32_t VITALS_BOARD_ALL_PATIENTS = -2;
+
+struct VitalsBoardHeader
+{
+	uint32_t magic;
+	uint32_t layoutVersion;
+	uint32_t slotCount;
+	uint32_t slotSize;
+
+	// Incremented after each batch of updates
+	volatile uint32_t generation;
+
+	// Slots below this one have held a stream, and are read by readers
+	volatile uint32_t slotsUsed;
+
+	// Set when the writer closes the board.  A reader that sees it, or
+	// finds the board stalled, opens the board again, to find the board of
+	// the next writer.
+	volatile uint32_t closed;
+	uint32_t reserved;
+
+	// Monotonic time of the last batch of the writer, in nanoseconds, so
+	// readers can tell that a writer stopped without closing the board
+	volatile int64_t heartbeat;
+
+	uint8_t padding[24];
+};
+
+// The latest value of one stream, as copied by a reader
+struct VitalsBoardValue
+{
+	int32_t patientId;
+	int32_t instanceId;
+	float value;
+	uint32_t reserved;
+
+	// When the value was measured, from the source timestamp of the
+	// Numeric, in nanoseconds since the epoch
+	int64_t timestamp;
+
+	char deviceId[72];
+	char metricId[72];
+};
+
+// A slot is three cache lines, so a slot being written does not share a
+// cache line with the slots around it
+struct VitalsBoardSlot
+{
+	// Odd while the writer changes the slot
+	volatile uint32_t sequence;
+
+	// Nonzero while the slot holds a stream
+	uint32_t inUse;
+
+	VitalsBoardValue value;
+
+	uint8_t padding[16];
+};
+
+// ------------------------------------------------------------------------- //
+//
+// VitalsBoardWriter:
+// Creates a board, and keeps the latest values of the streams on it.  Only
+// one thread of one process writes a board.  Updates are seen by readers as
+// soon as they are made, and Publish tells the readers that wait that a
+// batch of updates is complete.
+//
+// ------------------------------------------------------------------------- //
+class VitalsBoardWriter
+{
+public:
+	// --- Constructor and destructor ---
+	// Creates a board with room for slotCount streams.  A board of the
+	// same name is only replaced if its writer closed it, or it is stalled,
+	// so a second writer started by mistake does not take the board from
+	// the readers of the first.  Throws a std::string if the board cannot
+	// be created, or another writer still uses the name.
+	VitalsBoardWriter(const std::string &name, unsigned int slotCount);
+
+	// Marks the board closed, wakes the readers, and removes the board
+	~VitalsBoardWriter();
+
+	// --- Updating values ---
+	// Sets the latest value of a stream, adding the stream if it is new.
+	// Returns false if the stream is new and the board is full.
+	bool UpdateValue(const char *deviceId, const char *metricId,
+		int instanceId, float value, int64_t timestamp);
+
+	// Called when a stream is no longer alive, so readers do not show the
+	// last value of a device that was unplugged
+	void RemoveValue(const char *deviceId, const char *metricId,
+		int instanceId);
+
+	// --- Patient-device mapping ---
+	// Sets the patient of every stream of the device, and of the streams
+	// the device adds later
+	void SetDevicePatient(const std::string &deviceId, int patientId);
+	void RemoveDevicePatient(const std::string &deviceId);
+
+	// --- Publishing ---
+	// Ends a batch of updates: increments the generation if anything
+	// changed, and wakes the readers that wait for it.  Also updates the
+	// heartbeat, so call it regularly even when no data arrives.
+	void Publish();
+
+	// --- Statistics ---
+	unsigned int GetStreamCount() const
+	{
+		return (unsigned int)_streamSlots.size();
+	}
+
+	unsigned int GetSlotCount() const
+	{
+		return _header->slotCount;
+	}
+
+	size_t GetBoardSize() const
+	{
+		return _memory.GetSize();
+	}
+
+	unsigned long GetUpdateCount() const
+	{
+		return _updateCount;
+	}
+
+	// Updates dropped because the board was full
+	unsigned long GetFullCount() const
+	{
+		return _fullCount;
+	}
+
+private:
+	// --- Private methods ---
+	void BeginWrite(VitalsBoardSlot &slot);
+	void EndWrite(VitalsBoardSlot &slot);
+	void SetSlotPatients(const std::string &deviceId, int patientId);
+
+	// --- Private members ---
+	OSSharedMemory _memory;
+	VitalsBoardHeader *_header;
+	VitalsBoardSlot *_slots;
+
+	// Slot of every stream, by stream key.  Keys start with the device ID,
+	// so the streams of a device are next to each other.
+	std::map<std::string, uint32_t> _streamSlots;
+
+	// Slots freed by removed streams
+	std::vector<uint32_t> _freeSlots;
+
+	// Patient of each device, by device ID
+	std::map<std::string, int> _devicePatients;
+
+	bool _changed;
+	unsigned long _updateCount;
+	unsigned long _fullCount;
+};
+
+// ------------------------------------------------------------------------- //
+//
+// VitalsBoardReader:
+// Maps a board read-only, and copies values from it.  Any number of readers,
+// in any number of processes, read a board at the same time.  The methods
+// are const, so one reader can be used by several threads.
+//
+// ------------------------------------------------------------------------- //
+class VitalsBoardReader
+{
+public:
+	// --- Constructor ---
+	VitalsBoardReader();
+
+	// --- Opening and closing the board ---
+	// Returns false if there is no board of this name, or it has another
+	// layout
+	bool Open(const std::string &name);
+	void Close();
+
+	bool IsOpen() const
+	{
+		return _header != NULL;
+	}
+
+	// True once the writer has closed the board
+	bool IsClosed() const
+	{
+		return _header->closed != 0;
+	}
+
+	// Monotonic time of the last batch of the writer, in nanoseconds
+	int64_t GetHeartbeat() const;
+
+	// True if the heartbeat is older than VITALS_BOARD_STALE_NANOSECONDS
+	bool IsStalled() const;
+
+	// --- Waiting for changes ---
+	uint32_t GetGeneration() const
+	{
+		return _header->generation;
+	}
+
+	// Waits until the generation is no longer the one given, or the timeout
+	// passes, and returns the current generation
+	uint32_t WaitForChange(uint32_t generation,
+		int64_t timeoutNanoseconds) const;
+
+	// --- Reading values ---
+	// Appends the values of the streams of the patient, or of every stream
+	// for VITALS_BOARD_ALL_PATIENTS.  Every value is copied whole, but
+	// values of different streams may come from different batches.  Returns
+	// false if the board is stalled with a slot half written, in which case
+	// the values of the other slots are still appended.
+	bool ReadValues(int patientId,
+		std::vector<VitalsBoardValue> &values) const;
+
+	// Copies the value of one stream.  Returns false if the stream is not
+	// on the board, or the board is stalled (see IsStalled).  This looks at
+	// every slot in use, so a display that shows many streams reads them
+	// together with ReadValues.
+	bool ReadValue(const char *deviceId, const char *metricId,
+		int instanceId, VitalsBoardValue &value) const;
+
+	size_t GetBoardSize() const
+	{
+		return _memory.GetSize();
+	}
+
+private:
+	// Result of copying one slot
+	enum SlotCopy
+	{
+		SLOT_COPIED,
+
+		// The slot does not hold a stream of the patient
+		SLOT_NOT_MATCHED,
+
+		// The slot stayed half written, and the board is stalled
+		SLOT_STALLED
+	};
+
+	// --- Private methods ---
+	// Copies the slot if it holds a stream of the patient
+	SlotCopy CopySlot(const VitalsBoardSlot &slot, int patientId,
+		VitalsBoardValue &value) const;
+
+	// --- Private members ---
+	OSSharedMemory _memory;
+	const VitalsBoardHeader *_header;
+	const VitalsBoardSlot *_slots;
+};
+
+#endif
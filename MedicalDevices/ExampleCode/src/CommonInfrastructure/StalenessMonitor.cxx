@@ -0,0 +1,205 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <sstream>
+#include "StalenessMonitor.h"
+
+using namespace std;
+
+// Approximate overhead of one node of a std::map
+static const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void *);
+
+// ----------------------------------------------------------------------------
+StalenessMonitor::StalenessMonitor(const StalenessConfig &config, int64_t now,
+	StalenessListener &listener) :
+	_config(config),
+	_wheel(config.tickLength, now),
+	_listener(listener),
+	_staleCount(0),
+	_staleEvents(0),
+	_recoveredEvents(0),
+	_forgottenEvents(0)
+{
+	if (_config.staleFactor < 1.0 || _config.minimumTimeout < 0 ||
+		_config.forgetTimeout <= 0)
+	{
+		stringstream errss;
+		errss << "StalenessMonitor: the stale factor must be at least 1, and "
+			<< "the timeouts positive";
+		throw errss.str();
+	}
+}
+
+StalenessMonitor::~StalenessMonitor()
+{
+	for (map<string, MonitoredStream *>::iterator it = _streams.begin();
+		it != _streams.end(); ++it)
+	{
+		_wheel.Cancel(*it->second);
+		delete it->second;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Samples
+void StalenessMonitor::OnNumeric(const char *deviceId, const char *metricId,
+	int instanceId, int64_t now)
+{
+	MonitoredStream &stream = FindStream(deviceId, metricId, instanceId);
+
+	// Learn the period from the time between samples, as a moving average
+	// that follows a change of rate within a few samples.  The gap that ends
+	// a stale period, or that is longer than the timeout, is an outage, not
+	// a period.
+	if (stream.status.lastSampleTime != 0 && !stream.stale)
+	{
+		int64_t delta = now - stream.status.lastSampleTime;
+		if (delta > 0 && delta <= GetTimeout(stream))
+		{
+			int64_t &period = stream.status.expectedPeriod;
+			period = period == 0 ? delta : period + (delta - period) / 8;
+		}
+	}
+	OnSample(stream, now);
+}
+
+void StalenessMonitor::OnFrame(const char *deviceId, const char *metricId,
+	int instanceId, int64_t now, int64_t frameDuration)
+{
+	MonitoredStream &stream = FindStream(deviceId, metricId, instanceId);
+	if (frameDuration > 0)
+	{
+		stream.status.expectedPeriod = frameDuration;
+	}
+	OnSample(stream, now);
+}
+
+StalenessMonitor::MonitoredStream &StalenessMonitor::FindStream(
+	const char *deviceId, const char *metricId, int instanceId)
+{
+	// The key is built in a reused string, so a sample of a known stream
+	// does not allocate
+	char instance[16];
+	sprintf(instance, "%d", instanceId);
+	_key.assign(deviceId);
+	_key += '|';
+	_key += metricId;
+	_key += '|';
+	_key += instance;
+
+	map<string, MonitoredStream *>::iterator it = _streams.find(_key);
+	if (it != _streams.end())
+	{
+		return *it->second;
+	}
+
+	MonitoredStream *stream = new MonitoredStream;
+	stream->status.deviceId = deviceId;
+	stream->status.metricId = metricId;
+	stream->status.instanceId = instanceId;
+	stream->status.lastSampleTime = 0;
+	stream->status.expectedPeriod = 0;
+	stream->stale = false;
+	stream->position = _streams.insert(make_pair(_key, stream)).first;
+	return *stream;
+}
+
+// Every sample pushes the timer of its stream out by the timeout.  A stream
+// whose period is still unknown is only forgotten if it never sends again.
+void StalenessMonitor::OnSample(MonitoredStream &stream, int64_t now)
+{
+	stream.status.lastSampleTime = now;
+
+	if (stream.stale)
+	{
+		stream.stale = false;
+		_staleCount--;
+		_recoveredEvents++;
+		_listener.StreamRecovered(stream.status);
+	}
+
+	_wheel.Schedule(stream, now + GetTimeout(stream));
+}
+
+// Stale factor times the period, and at least the minimum timeout, or the
+// forget timeout while the period is unknown
+int64_t StalenessMonitor::GetTimeout(const MonitoredStream &stream) const
+{
+	if (stream.status.expectedPeriod == 0)
+	{
+		return _config.forgetTimeout;
+	}
+
+	int64_t timeout = (int64_t)(_config.staleFactor *
+		(double)stream.status.expectedPeriod);
+	if (timeout < _config.minimumTimeout)
+	{
+		timeout = _config.minimumTimeout;
+	}
+	return timeout;
+}
+
+// ----------------------------------------------------------------------------
+// Checking
+unsigned int StalenessMonitor::Check(int64_t now)
+{
+	return _wheel.Advance(now, *this);
+}
+
+// The first expiration of a stream with a known period makes it stale, and
+// the second one, a forget timeout later, forgets it
+void StalenessMonitor::TimerExpired(TimerWheelNode &node)
+{
+	MonitoredStream &stream = static_cast<MonitoredStream &>(node);
+
+	if (!stream.stale && stream.status.expectedPeriod != 0)
+	{
+		stream.stale = true;
+		_staleCount++;
+		_staleEvents++;
+		_listener.StreamStale(stream.status);
+		_wheel.Schedule(stream,
+			stream.status.lastSampleTime + _config.forgetTimeout);
+		return;
+	}
+
+	// A stream that was never reported stale is forgotten silently
+	_forgottenEvents++;
+	if (stream.stale)
+	{
+		_staleCount--;
+		_listener.StreamForgotten(stream.status);
+	}
+	_streams.erase(stream.position);
+	delete &stream;
+}
+
+// ----------------------------------------------------------------------------
+// Metrics
+void StalenessMonitor::GetMetrics(StalenessMetrics &metrics) const
+{
+	metrics.streamCount = (unsigned int)_streams.size();
+	metrics.staleCount = _staleCount;
+	metrics.staleEvents = _staleEvents;
+	metrics.recoveredEvents = _recoveredEvents;
+	metrics.forgottenEvents = _forgottenEvents;
+
+	// The wheel is a member, so it is part of sizeof(*this)
+	metrics.memorySize = sizeof(*this);
+	for (map<string, MonitoredStream *>::const_iterator it = _streams.begin();
+		it != _streams.end(); ++it)
+	{
+		metrics.memorySize += MAP_NODE_OVERHEAD + sizeof(*it) +
+			sizeof(MonitoredStream) + it->first.capacity() +
+			it->second->status.deviceId.capacity() +
+			it->second->status.metricId.capacity();
+	}
+}
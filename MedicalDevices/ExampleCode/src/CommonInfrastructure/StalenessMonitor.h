@@ -0,0 +1,178 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef STALENESS_MONITOR_H
+#define STALENESS_MONITOR_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include "TimerWheel.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Staleness monitor:
+// Notices when a stream of device data (one device, metric and instance
+// ID) stops arriving, even though the device itself is still alive.  The
+// liveliness of a DataWriter only says that the device application is
+// running.  It does not say that each of its metrics is still being sent.
+//
+// The monitor learns the expected period of each stream:
+//  - For waveforms, from the duration of each frame (number of values times
+//    millisecondsPerSample).
+//  - For numerics, from a moving average of the time between samples.  The
+//    time between samples is not learned when it is longer than the
+//    timeout, or ends a stale period, so an outage does not lengthen the
+//    period.  A stream that slows down by more than the stale factor is
+//    therefore reported stale at each sample.
+// A stream is stale once nothing has arrived for stale factor times its
+// expected period, and never sooner than the minimum timeout.  A numeric
+// stream is not reported stale until its period is known, after its second
+// sample, since a slow stream (such as a blood pressure taken every few
+// minutes) cannot be told apart from a stopped one before that.
+//
+// Each stream has a timer in a TimerWheel, which is rescheduled by every
+// sample, so the monitor costs O(1) per sample and per expired stream, and
+// its cost does not depend on the number of streams.  The listener is told
+// when a stream becomes stale and when it recovers.  A stream that stays
+// stale for the forget timeout is forgotten, and the listener is told so it
+// can clear any alarm about it.
+//
+// Times are in nanoseconds, from a clock that does not jump, such as
+// OSGetMonotonicTime().
+//
+// ------------------------------------------------------------------------- //
+
+// A monitored stream, as seen by the listener
+struct StreamStatus
+{
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+
+	// Time of the latest sample, and the expected time between samples
+	int64_t lastSampleTime;
+	int64_t expectedPeriod;
+};
+
+class StalenessListener
+{
+public:
+	virtual ~StalenessListener()
+	{
+	}
+
+	virtual void StreamStale(const StreamStatus &stream) = 0;
+	virtual void StreamRecovered(const StreamStatus &stream) = 0;
+
+	// The stream was stale for the forget timeout, and is no longer
+	// monitored.  Streams that are forgotten without having been reported
+	// stale are not reported.
+	virtual void StreamForgotten(const StreamStatus &stream) = 0;
+};
+
+// Settings of a staleness monitor
+struct StalenessConfig
+{
+	StalenessConfig() :
+		tickLength(10000000LL),
+		staleFactor(3.0),
+		minimumTimeout(500000000LL),
+		forgetTimeout(3600000000000LL)
+	{
+	}
+
+	int64_t tickLength;
+	double staleFactor;
+	int64_t minimumTimeout;
+	int64_t forgetTimeout;
+};
+
+// Counters of a staleness monitor
+struct StalenessMetrics
+{
+	unsigned int streamCount;
+	unsigned int staleCount;
+	uint64_t staleEvents;
+	uint64_t recoveredEvents;
+	uint64_t forgottenEvents;
+	size_t memorySize;
+};
+
+class StalenessMonitor : private TimerWheelListener
+{
+public:
+	// --- Constructor and destructor ---
+	// The listener is called from OnNumeric() and OnFrame() when a stream
+	// recovers, and from Check() otherwise
+	StalenessMonitor(const StalenessConfig &config, int64_t now,
+		StalenessListener &listener);
+	~StalenessMonitor();
+
+	// --- Samples ---
+	// Records a numeric sample received at time now
+	void OnNumeric(const char *deviceId, const char *metricId,
+		int instanceId, int64_t now);
+
+	// Records a waveform frame received at time now, covering the given
+	// duration
+	void OnFrame(const char *deviceId, const char *metricId,
+		int instanceId, int64_t now, int64_t frameDuration);
+
+	// --- Checking ---
+	// Reports the streams that became stale or were forgotten up to time
+	// now.  Returns the number of streams whose timer expired.
+	unsigned int Check(int64_t now);
+
+	// --- Metrics ---
+	unsigned int GetStreamCount() const
+	{
+		return (unsigned int)_streams.size();
+	}
+
+	void GetMetrics(StalenessMetrics &metrics) const;
+
+private:
+	// --- Private types ---
+	struct MonitoredStream : public TimerWheelNode
+	{
+		StreamStatus status;
+		bool stale;
+		std::map<std::string, MonitoredStream *>::iterator position;
+	};
+
+	// --- Not copyable ---
+	StalenessMonitor(const StalenessMonitor &);
+	StalenessMonitor &operator=(const StalenessMonitor &);
+
+	// --- Private methods ---
+	MonitoredStream &FindStream(const char *deviceId, const char *metricId,
+		int instanceId);
+	void OnSample(MonitoredStream &stream, int64_t now);
+	int64_t GetTimeout(const MonitoredStream &stream) const;
+	virtual void TimerExpired(TimerWheelNode &node);
+
+	// --- Private members ---
+	StalenessConfig _config;
+	TimerWheel _wheel;
+
+	// Streams by key (device, metric and instance)
+	std::map<std::string, MonitoredStream *> _streams;
+	std::string _key;
+
+	StalenessListener &_listener;
+
+	unsigned int _staleCount;
+	uint64_t _staleEvents;
+	uint64_t _recoveredEvents;
+	uint64_t _forgottenEvents;
+};
+
+#endif
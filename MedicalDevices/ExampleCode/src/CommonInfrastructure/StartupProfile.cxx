@@ -0,0 +1,54 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include "StartupProfile.h"
+
+StartupProfile::StartupProfile()
+{
+	_start = OSGetMonotonicTime();
+}
+
+void StartupProfile::AddPhase(const std::string &name, int64_t duration)
+{
+	int64_t end = GetElapsed();
+	for (size_t i = 0; i < _phases.size(); i++)
+	{
+		if (_phases[i].name == name)
+		{
+			_phases[i].duration += duration;
+			_phases[i].end = end;
+			return;
+		}
+	}
+
+	StartupPhase phase;
+	phase.name = name;
+	phase.duration = duration;
+	phase.end = end;
+	_phases.push_back(phase);
+}
+
+int64_t StartupProfile::GetElapsed() const
+{
+	return OSGetMonotonicTime() - _start;
+}
+
+void StartupProfile::Print(std::ostream &out) const
+{
+	char line[128];
+	out << "Startup phase                      Duration      At" << std::endl;
+	for (size_t i = 0; i < _phases.size(); i++)
+	{
+		sprintf(line, "%-32s %8.1f ms %8.1f ms", _phases[i].name.c_str(),
+			_phases[i].duration / 1e6, _phases[i].end / 1e6);
+		out << line << std::endl;
+	}
+}
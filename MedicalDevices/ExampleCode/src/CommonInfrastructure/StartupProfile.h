@@ -0,0 +1,100 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef STARTUP_PROFILE_H
+#define STARTUP_PROFILE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "OSAPI.h"
+
+// ------------------------------------------------------------------------- //
+//
+// StartupProfile:
+// Records how long each phase of the startup of an application takes, such
+// as loading the QoS profiles, creating the DomainParticipant, or waiting
+// for the first DataReader to match.  A phase that happens several times
+// (such as registering each data type) accumulates its time in one entry.
+//
+// ------------------------------------------------------------------------- //
+
+struct StartupPhase
+{
+	std::string name;
+
+	// Total time spent in the phase, in nanoseconds
+	int64_t duration;
+
+	// Time from the start of the profile to the last end of the phase
+	int64_t end;
+};
+
+class StartupProfile
+{
+public:
+	// --- Constructor ---
+	// The startup begins when the profile is created
+	StartupProfile();
+
+	// --- Recording phases ---
+	void AddPhase(const std::string &name, int64_t duration);
+
+	// Time since the profile was created, in nanoseconds
+	int64_t GetElapsed() const;
+
+	const std::vector<StartupPhase> &GetPhases() const
+	{
+		return _phases;
+	}
+
+	// --- Report ---
+	// Prints one line per phase, in the order the phases first happened
+	void Print(std::ostream &out) const;
+
+private:
+	// --- Private members ---
+	int64_t _start;
+	std::vector<StartupPhase> _phases;
+};
+
+// ------------------------------------------------------------------------- //
+//
+// StartupPhaseTimer:
+// Adds the time from its creation to its destruction to a phase of a
+// profile.  The profile may be NULL, so code can be instrumented whether or
+// not a profile is being recorded.
+//
+// ------------------------------------------------------------------------- //
+class StartupPhaseTimer
+{
+public:
+	StartupPhaseTimer(StartupProfile *profile, const char *name) :
+		_profile(profile),
+		_name(name),
+		_start(profile == NULL ? 0 : OSGetMonotonicTime())
+	{
+	}
+
+	~StartupPhaseTimer()
+	{
+		if (_profile != NULL)
+		{
+			_profile->AddPhase(_name, OSGetMonotonicTime() - _start);
+		}
+	}
+
+private:
+	StartupProfile *_profile;
+	const char *_name;
+	int64_t _start;
+};
+
+#endif
@@ -0,0 +1,368 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+#include "StreamLossTracker.h"
+
+using namespace std;
+
+// Numbers remembered below the highest, to tell duplicates from reordered
+// samples
+static const int64_t SEQUENCE_WINDOW = 64;
+
+// The key of a stream, built in a reused string so a sample of a known
+// stream does not allocate
+static void BuildStreamKey(string &key, const char *deviceId,
+	const char *metricId, int instanceId)
+{
+	char instance[16];
+	sprintf(instance, "%d", instanceId);
+	key.assign(deviceId);
+	key += '|';
+	key += metricId;
+	key += '|';
+	key += instance;
+}
+
+// Number of the frame that starts at the source time, rounded to the
+// nearest frame, since source timestamps are not always exact
+static int64_t FrameNumber(int64_t sourceTime, int64_t baseTime,
+	int64_t frameDuration)
+{
+	int64_t offset = sourceTime - baseTime;
+	if (offset >= 0)
+	{
+		return (offset + frameDuration / 2) / frameDuration;
+	}
+	return -((-offset + frameDuration / 2) / frameDuration);
+}
+
+static void AddCounters(LossCounters &total, const LossCounters &counters)
+{
+	total.received += counters.received;
+	total.lost += counters.lost;
+	total.duplicates += counters.duplicates;
+	total.reordered += counters.reordered;
+	total.bursts += counters.bursts;
+	if (counters.longestBurst > total.longestBurst)
+	{
+		total.longestBurst = counters.longestBurst;
+	}
+	total.windows += counters.windows;
+	total.windowsOverThreshold += counters.windowsOverThreshold;
+	if (counters.worstWindowLoss > total.worstWindowLoss)
+	{
+		total.worstWindowLoss = counters.worstWindowLoss;
+	}
+}
+
+// ----------------------------------------------------------------------------
+StreamLossTracker::StreamLossTracker(const StreamLossConfig &config) :
+	_config(config)
+{
+	if (_config.windowDuration <= 0 || _config.forgetTimeout <= 0 ||
+		_config.lossThreshold < 0.0)
+	{
+		stringstream errss;
+		errss << "StreamLossTracker: the window duration and forget timeout "
+			<< "must be positive, and the loss threshold not negative";
+		throw errss.str();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Samples
+void StreamLossTracker::OnWriterSample(const void *writerId,
+	size_t writerIdLength, int64_t sequenceNumber, int64_t now)
+{
+	_key.assign((const char *)writerId, writerIdLength);
+	WriterMap::iterator it = _writers.find(_key);
+	if (it == _writers.end())
+	{
+		it = _writers.insert(make_pair(_key, SequenceState())).first;
+		StartSequence(it->second, now);
+	}
+	Record(it->second, sequenceNumber, now);
+}
+
+void StreamLossTracker::OnFrame(const char *deviceId, const char *metricId,
+	int instanceId, int64_t sourceTime, unsigned int valueCount,
+	int64_t samplePeriod, int64_t now)
+{
+	if (valueCount == 0 || samplePeriod <= 0)
+	{
+		return;
+	}
+	int64_t frameDuration = (int64_t)valueCount * samplePeriod;
+
+	BuildStreamKey(_key, deviceId, metricId, instanceId);
+	StreamMap::iterator it = _streams.find(_key);
+	if (it == _streams.end())
+	{
+		it = _streams.insert(make_pair(_key, TrackedStream())).first;
+		TrackedStream &added = it->second;
+		added.status.deviceId = deviceId;
+		added.status.metricId = metricId;
+		added.status.instanceId = instanceId;
+		added.status.valuesPerFrame = valueCount;
+		added.status.samplesLost = 0;
+		added.status.restarts = 0;
+		added.baseTime = sourceTime;
+		added.frameDuration = frameDuration;
+		StartSequence(added.sequence, now);
+	}
+	TrackedStream &stream = it->second;
+	SequenceState &sequence = stream.sequence;
+
+	// A new frame duration, or a jump of the source time, restarts the
+	// numbering at this frame, keeping the counts
+	if (sequence.started)
+	{
+		int64_t expected = stream.baseTime +
+			sequence.highest * stream.frameDuration;
+		int64_t jump = sourceTime - expected;
+		if (frameDuration != stream.frameDuration ||
+			jump > _config.forgetTimeout || jump < -_config.forgetTimeout)
+		{
+			stream.baseTime = sourceTime;
+			stream.frameDuration = frameDuration;
+			stream.status.restarts++;
+			sequence.started = false;
+		}
+	}
+
+	int64_t lostFrames = Record(sequence,
+		FrameNumber(sourceTime, stream.baseTime, stream.frameDuration), now);
+	if (lostFrames > 0)
+	{
+		stream.status.samplesLost += (uint64_t)lostFrames * valueCount;
+	} else if (lostFrames < 0 && stream.status.samplesLost >= valueCount)
+	{
+		stream.status.samplesLost -= valueCount;
+	}
+	stream.status.valuesPerFrame = valueCount;
+}
+
+// ----------------------------------------------------------------------------
+// Sequences
+void StreamLossTracker::StartSequence(SequenceState &sequence,
+	int64_t now) const
+{
+	memset(&sequence.counters, 0, sizeof(sequence.counters));
+	sequence.started = false;
+	sequence.highest = 0;
+	sequence.mask = 0;
+	sequence.windowStart = now;
+	sequence.windowReceived = 0;
+	sequence.windowLost = 0;
+	sequence.lastSampleTime = now;
+}
+
+// Returns the change of the number of samples lost: the numbers skipped by
+// a sample above the highest, or -1 for a sample that fills a gap
+int64_t StreamLossTracker::Record(SequenceState &sequence, int64_t number,
+	int64_t now)
+{
+	EndWindow(sequence, now);
+	sequence.lastSampleTime = now;
+	LossCounters &counters = sequence.counters;
+
+	if (!sequence.started)
+	{
+		sequence.started = true;
+		sequence.highest = number;
+		sequence.mask = 1;
+		counters.received++;
+		sequence.windowReceived++;
+		return 0;
+	}
+
+	if (number > sequence.highest)
+	{
+		int64_t shift = number - sequence.highest;
+		sequence.mask = shift >= SEQUENCE_WINDOW ? 0 : sequence.mask << shift;
+		sequence.mask |= 1;
+		sequence.highest = number;
+		counters.received++;
+		sequence.windowReceived++;
+
+		int64_t skipped = shift - 1;
+		if (skipped > 0)
+		{
+			counters.lost += (uint64_t)skipped;
+			sequence.windowLost += skipped;
+			counters.bursts++;
+			if ((uint64_t)skipped > counters.longestBurst)
+			{
+				counters.longestBurst = (uint64_t)skipped;
+			}
+		}
+		return skipped;
+	}
+
+	int64_t age = sequence.highest - number;
+	if (age < SEQUENCE_WINDOW)
+	{
+		uint64_t bit = (uint64_t)1 << age;
+		if ((sequence.mask & bit) != 0)
+		{
+			counters.duplicates++;
+			return 0;
+		}
+		sequence.mask |= bit;
+	}
+
+	// A late sample fills its gap
+	counters.received++;
+	counters.reordered++;
+	sequence.windowReceived++;
+	if (counters.lost == 0)
+	{
+		return 0;
+	}
+	counters.lost--;
+	sequence.windowLost--;
+	return -1;
+}
+
+// A sample that fills a gap of the previous window can leave the count of
+// samples lost in a window below zero, which counts as none lost
+void StreamLossTracker::EndWindow(SequenceState &sequence, int64_t now)
+{
+	int64_t elapsed = now - sequence.windowStart;
+	if (elapsed < _config.windowDuration)
+	{
+		return;
+	}
+
+	uint64_t lost = sequence.windowLost > 0 ? (uint64_t)sequence.windowLost :
+		0;
+	uint64_t total = sequence.windowReceived + lost;
+	if (total > 0)
+	{
+		LossCounters &counters = sequence.counters;
+		double loss = (double)lost / (double)total;
+		counters.windows++;
+		counters.windowLoss = loss;
+		if (loss > counters.worstWindowLoss)
+		{
+			counters.worstWindowLoss = loss;
+		}
+		if (loss > _config.lossThreshold)
+		{
+			counters.windowsOverThreshold++;
+		}
+	}
+
+	// Windows stay aligned to the first, and the windows with nothing
+	// received or lost are skipped
+	sequence.windowStart = now - elapsed % _config.windowDuration;
+	sequence.windowReceived = 0;
+	sequence.windowLost = 0;
+}
+
+// ----------------------------------------------------------------------------
+// Checking
+unsigned int StreamLossTracker::Check(int64_t now,
+	vector<StreamLossStatus> &forgotten)
+{
+	unsigned int forgottenCount = 0;
+
+	WriterMap::iterator writer = _writers.begin();
+	while (writer != _writers.end())
+	{
+		if (now - writer->second.lastSampleTime > _config.forgetTimeout)
+		{
+			_writers.erase(writer++);
+			forgottenCount++;
+			continue;
+		}
+		EndWindow(writer->second, now);
+		++writer;
+	}
+
+	StreamMap::iterator stream = _streams.begin();
+	while (stream != _streams.end())
+	{
+		if (now - stream->second.sequence.lastSampleTime >
+			_config.forgetTimeout)
+		{
+			forgotten.push_back(StreamLossStatus());
+			FillStatus(stream->second, forgotten.back());
+			_streams.erase(stream++);
+			forgottenCount++;
+			continue;
+		}
+		EndWindow(stream->second.sequence, now);
+		++stream;
+	}
+	return forgottenCount;
+}
+
+// ----------------------------------------------------------------------------
+// Queries
+void StreamLossTracker::FillStatus(const TrackedStream &stream,
+	StreamLossStatus &status) const
+{
+	status = stream.status;
+	status.frames = stream.sequence.counters;
+	status.lastSampleTime = stream.sequence.lastSampleTime;
+}
+
+bool StreamLossTracker::GetStream(const char *deviceId, const char *metricId,
+	int instanceId, StreamLossStatus &status) const
+{
+	string key;
+	BuildStreamKey(key, deviceId, metricId, instanceId);
+	StreamMap::const_iterator it = _streams.find(key);
+	if (it == _streams.end())
+	{
+		return false;
+	}
+	FillStatus(it->second, status);
+	return true;
+}
+
+void StreamLossTracker::GetStreams(vector<StreamLossStatus> &streams) const
+{
+	for (StreamMap::const_iterator it = _streams.begin();
+		it != _streams.end(); ++it)
+	{
+		streams.push_back(StreamLossStatus());
+		FillStatus(it->second, streams.back());
+	}
+}
+
+void StreamLossTracker::GetMetrics(StreamLossMetrics &metrics) const
+{
+	memset(&metrics, 0, sizeof(metrics));
+	metrics.writerCount = (unsigned int)_writers.size();
+	metrics.streamCount = (unsigned int)_streams.size();
+
+	for (WriterMap::const_iterator it = _writers.begin();
+		it != _writers.end(); ++it)
+	{
+		AddCounters(metrics.writers, it->second.counters);
+	}
+	for (StreamMap::const_iterator it = _streams.begin();
+		it != _streams.end(); ++it)
+	{
+		const LossCounters &counters = it->second.sequence.counters;
+		AddCounters(metrics.streams, counters);
+		metrics.samplesLost += it->second.status.samplesLost;
+		if (counters.windows > 0 &&
+			counters.windowLoss > _config.lossThreshold)
+		{
+			metrics.streamsOverThreshold++;
+		}
+	}
+}
@@ -0,0 +1,226 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef STREAM_LOSS_TRACKER_H
+#define STREAM_LOSS_TRACKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------- //
+//
+// Stream loss tracker:
+// Counts the samples that a best-effort DataReader never receives, receives
+// twice, or receives out of order.  The StreamingData profile is best
+// effort, so a sample dropped by the network, or replaced in the reader's
+// queue before it was taken, is lost without any notice.
+//
+// Loss is counted at two levels:
+//  - Per DataWriter, from the publication sequence number of each sample.
+//    A DataWriter numbers every sample it writes, of every instance, so a
+//    gap in the numbers is an exact count of the samples lost.  The numbers
+//    do not say which instance a lost sample belonged to.
+//  - Per waveform stream (one device, metric and instance), from the source
+//    timestamps of its frames.  Each frame starts where the previous one
+//    ended, so the source timestamp gives the number of the frame in its
+//    stream, and a gap in the numbers counts the frames, and the samples,
+//    lost from that stream.  This is what tells the loss of each bed.
+//
+// In both cases, a sample whose number is above the highest received so far
+// counts the numbers it skips as lost.  A sample whose number is below it
+// fills its gap, and is counted as reordered instead.  The last 64 numbers
+// are remembered, so a sample received again within them is counted as a
+// duplicate.  An older sample is assumed to fill a gap.
+//
+// A run of numbers lost at once is a loss burst.  Loss is also measured
+// over rolling windows of the window duration: each window records the
+// share of samples lost during it, and the windows where this share is
+// above the loss threshold are counted.
+//
+// Writers and streams that send nothing for the forget timeout are
+// forgotten.  A waveform stream whose frame duration changes, or whose
+// source timestamps jump by more than the forget timeout, starts counting
+// again from its next frame, as after a device restart.
+//
+// Times are in nanoseconds.  The times passed as now are from a local
+// clock that does not jump, such as OSGetMonotonicTime().  The tracker is
+// not thread safe.
+//
+// ------------------------------------------------------------------------- //
+
+// Settings of a stream loss tracker
+struct StreamLossConfig
+{
+	StreamLossConfig() :
+		windowDuration(10000000000LL),
+		lossThreshold(0.001),
+		forgetTimeout(60000000000LL)
+	{
+	}
+
+	int64_t windowDuration;
+
+	// Share of samples lost, above which a window is counted
+	double lossThreshold;
+
+	int64_t forgetTimeout;
+};
+
+// Counts of a sequence of numbered samples
+struct LossCounters
+{
+	uint64_t received;
+	uint64_t lost;
+	uint64_t duplicates;
+	uint64_t reordered;
+
+	// Runs of samples lost at once, and the longest
+	uint64_t bursts;
+	uint64_t longestBurst;
+
+	// Windows that ended with samples received or lost, the windows above
+	// the loss threshold, and the share of samples lost in the latest and
+	// in the worst window
+	uint64_t windows;
+	uint64_t windowsOverThreshold;
+	double windowLoss;
+	double worstWindowLoss;
+};
+
+// Loss of one waveform stream, counted in frames
+struct StreamLossStatus
+{
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+
+	LossCounters frames;
+
+	// Values in the latest frame, and values lost with the lost frames
+	unsigned int valuesPerFrame;
+	uint64_t samplesLost;
+
+	// Times the stream started counting again
+	uint64_t restarts;
+
+	// Local time the latest frame was received
+	int64_t lastSampleTime;
+};
+
+// Totals of a stream loss tracker.  The longest burst and the worst window
+// loss are the largest of any writer or stream.
+struct StreamLossMetrics
+{
+	unsigned int writerCount;
+	unsigned int streamCount;
+
+	LossCounters writers;
+	LossCounters streams;
+	uint64_t samplesLost;
+
+	// Streams whose latest window was above the loss threshold
+	unsigned int streamsOverThreshold;
+};
+
+class StreamLossTracker
+{
+public:
+	// --- Constructor ---
+	// Throws a std::string if the settings are not valid
+	StreamLossTracker(const StreamLossConfig &config);
+
+	// --- Samples ---
+	// Records a sample received at time now from the DataWriter identified
+	// by the bytes of writerId, with its publication sequence number
+	void OnWriterSample(const void *writerId, size_t writerIdLength,
+		int64_t sequenceNumber, int64_t now);
+
+	// Records a waveform frame received at time now.  The source time is
+	// the time of its first value.
+	void OnFrame(const char *deviceId, const char *metricId,
+		int instanceId, int64_t sourceTime, unsigned int valueCount,
+		int64_t samplePeriod, int64_t now);
+
+	// --- Checking ---
+	// Ends the windows that are over at time now, and forgets the writers
+	// and streams that sent nothing for the forget timeout.  The streams
+	// forgotten are added to the vector.  Returns the number of writers and
+	// streams forgotten.
+	unsigned int Check(int64_t now, std::vector<StreamLossStatus> &forgotten);
+
+	// --- Queries ---
+	// Returns false if the stream is not tracked
+	bool GetStream(const char *deviceId, const char *metricId,
+		int instanceId, StreamLossStatus &status) const;
+
+	// Adds the status of every stream to the vector
+	void GetStreams(std::vector<StreamLossStatus> &streams) const;
+
+	void GetMetrics(StreamLossMetrics &metrics) const;
+
+	const StreamLossConfig &GetConfig() const
+	{
+		return _config;
+	}
+
+private:
+	// --- Private types ---
+	// The numbers received so far in a sequence.  Bit i of the mask is set
+	// if number highest - i was received.
+	struct SequenceState
+	{
+		bool started;
+		int64_t highest;
+		uint64_t mask;
+
+		LossCounters counters;
+
+		// Current window
+		int64_t windowStart;
+		uint64_t windowReceived;
+		int64_t windowLost;
+
+		int64_t lastSampleTime;
+	};
+
+	struct TrackedStream
+	{
+		StreamLossStatus status;
+		SequenceState sequence;
+
+		// Source time of frame number 0, and the duration of the frames
+		int64_t baseTime;
+		int64_t frameDuration;
+	};
+
+	typedef std::map<std::string, SequenceState> WriterMap;
+	typedef std::map<std::string, TrackedStream> StreamMap;
+
+	// --- Private methods ---
+	void StartSequence(SequenceState &sequence, int64_t now) const;
+	int64_t Record(SequenceState &sequence, int64_t number, int64_t now);
+	void EndWindow(SequenceState &sequence, int64_t now);
+	void FillStatus(const TrackedStream &stream,
+		StreamLossStatus &status) const;
+
+	// --- Private members ---
+	StreamLossConfig _config;
+
+	// Writers by the bytes of their ID, and streams by key (device, metric
+	// and instance)
+	WriterMap _writers;
+	StreamMap _streams;
+	std::string _key;
+};
+
+#endif
@@ -0,0 +1,702 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <sstream>
+#include "StreamPipeline.h"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+// Samples
+void PipelineSample::Swap(PipelineSample &other)
+{
+	deviceId.swap(other.deviceId);
+	metricId.swap(other.metricId);
+	std::swap(instanceId, other.instanceId);
+	std::swap(patientId, other.patientId);
+	std::swap(timestamp, other.timestamp);
+	std::swap(value, other.value);
+	values.swap(other.values);
+	std::swap(samplePeriod, other.samplePeriod);
+	std::swap(entryTime, other.entryTime);
+	std::swap(queuedTime, other.queuedTime);
+}
+
+// Key of the stream of a sample: device, metric and instance
+static void GetStreamKey(const PipelineSample &sample, string &key)
+{
+	char instance[16];
+	sprintf(instance, "%d", sample.instanceId);
+	key.assign(sample.deviceId);
+	key += '|';
+	key += sample.metricId;
+	key += '|';
+	key += instance;
+}
+
+// ----------------------------------------------------------------------------
+// Operators
+PipelineOperator::PipelineOperator(const string &name,
+	unsigned int queueCapacity) :
+	_name(name),
+	_pipeline(NULL),
+	_capacity(queueCapacity == 0 ? 1 : queueCapacity),
+	_running(false),
+	_ready(false)
+{
+	_metrics.name = name;
+	_metrics.samplesIn = 0;
+	_metrics.samplesOut = 0;
+	_metrics.batches = 0;
+	_metrics.queueLength = 0;
+	_metrics.peakQueueLength = 0;
+	_metrics.queueCapacity = _capacity;
+	_metrics.heldBackCount = 0;
+	_metrics.refusedCount = 0;
+	_metrics.errorCount = 0;
+	_metrics.busyTime = 0;
+	_metrics.totalQueueLatency = 0;
+	_metrics.maxQueueLatency = 0;
+	_metrics.totalEndToEndLatency = 0;
+	_metrics.maxEndToEndLatency = 0;
+}
+
+PipelineOperator::~PipelineOperator()
+{
+}
+
+// --- Source ---
+PipelineSource::PipelineSource(const string &name,
+	unsigned int queueCapacity) :
+	PipelineOperator(name, queueCapacity)
+{
+}
+
+unsigned int PipelineSource::Offer(PipelineBatch &samples)
+{
+	if (GetPipeline() == NULL)
+	{
+		return 0;
+	}
+	return GetPipeline()->Offer(this, samples);
+}
+
+unsigned int PipelineSource::GetFreeCapacity()
+{
+	if (GetPipeline() == NULL)
+	{
+		return 0;
+	}
+	return GetPipeline()->GetFreeCapacity(this);
+}
+
+bool PipelineSource::WaitForCapacity(int64_t timeoutNanoseconds)
+{
+	if (GetPipeline() == NULL)
+	{
+		return false;
+	}
+	return GetPipeline()->WaitForCapacity(this, timeoutNanoseconds);
+}
+
+void PipelineSource::Process(PipelineBatch &input, PipelineBatch &output)
+{
+	output.swap(input);
+}
+
+// --- Map ---
+void PipelineMap::Process(PipelineBatch &input, PipelineBatch &output)
+{
+	for (size_t i = 0; i < input.size(); i++)
+	{
+		if (Map(input[i]))
+		{
+			output.push_back(PipelineSample());
+			output.back().Swap(input[i]);
+		}
+	}
+}
+
+// --- Window ---
+PipelineWindow::PipelineWindow(const string &name,
+	unsigned int queueCapacity, const string &inputMetricId,
+	const string &outputMetricId, int64_t duration,
+	PipelineAggregate aggregate, int64_t idleTimeout) :
+	PipelineOperator(name, queueCapacity),
+	_inputMetricId(inputMetricId),
+	_outputMetricId(outputMetricId),
+	_duration(duration),
+	_aggregate(aggregate),
+	_idleTimeout(idleTimeout),
+	_latest(0),
+	_lastDiscard(0)
+{
+	if (_duration <= 0)
+	{
+		stringstream errss;
+		errss << "PipelineWindow: the window duration must be positive";
+		throw errss.str();
+	}
+}
+
+// Every sample of the input metric outputs the aggregate of its stream's
+// window, with the IDs and time of that sample
+void PipelineWindow::Process(PipelineBatch &input, PipelineBatch &output)
+{
+	string key;
+	for (size_t i = 0; i < input.size(); i++)
+	{
+		PipelineSample &sample = input[i];
+		if (sample.metricId != _inputMetricId)
+		{
+			continue;
+		}
+
+		GetStreamKey(sample, key);
+		map<string, Window>::iterator it = _windows.find(key);
+		if (it == _windows.end())
+		{
+			Window empty;
+			empty.sum = 0.0;
+			empty.latest = 0;
+			it = _windows.insert(make_pair(key, empty)).first;
+		}
+		Window &window = it->second;
+
+		int64_t timestamp = sample.timestamp;
+		if (sample.IsFrame())
+		{
+			for (size_t v = 0; v < sample.values.size(); v++)
+			{
+				Add(window, sample.timestamp + (int64_t)v * sample.samplePeriod,
+					sample.values[v]);
+			}
+			if (!sample.values.empty())
+			{
+				timestamp += (int64_t)(sample.values.size() - 1) *
+					sample.samplePeriod;
+			}
+		} else
+		{
+			Add(window, timestamp, sample.value);
+		}
+		if (window.values.empty())
+		{
+			continue;
+		}
+		if (timestamp > _latest)
+		{
+			_latest = timestamp;
+		}
+
+		output.push_back(PipelineSample());
+		PipelineSample &result = output.back();
+		result.Swap(sample);
+		result.metricId = _outputMetricId;
+		result.timestamp = timestamp;
+		result.value = Aggregate(window);
+		result.values.clear();
+		result.samplePeriod = 0;
+	}
+	DiscardIdle(_latest);
+}
+
+// Values older than the window duration before the newest one are dropped.
+// Values that arrive out of order are added at their place.
+void PipelineWindow::Add(Window &window, int64_t timestamp, float value)
+{
+	WindowValue windowValue;
+	windowValue.timestamp = timestamp;
+	windowValue.value = value;
+
+	if (window.values.empty() || timestamp >= window.values.back().timestamp)
+	{
+		window.values.push_back(windowValue);
+	} else
+	{
+		std::deque<WindowValue>::iterator position = window.values.end();
+		while (position != window.values.begin() &&
+			(position - 1)->timestamp > timestamp)
+		{
+			--position;
+		}
+		window.values.insert(position, windowValue);
+	}
+	window.sum += value;
+	if (timestamp > window.latest)
+	{
+		window.latest = timestamp;
+	}
+
+	while (!window.values.empty() &&
+		window.values.front().timestamp <= window.latest - _duration)
+	{
+		window.sum -= window.values.front().value;
+		window.values.pop_front();
+	}
+}
+
+float PipelineWindow::Aggregate(const Window &window) const
+{
+	if (_aggregate == PIPELINE_MEAN)
+	{
+		return (float)(window.sum / (double)window.values.size());
+	}
+
+	float result = window.values.front().value;
+	for (size_t i = 1; i < window.values.size(); i++)
+	{
+		float value = window.values[i].value;
+		if (_aggregate == PIPELINE_MINIMUM ? value < result : value > result)
+		{
+			result = value;
+		}
+	}
+	return result;
+}
+
+// Looked at once per idle timeout of source time, so streams that stopped
+// do not keep their windows forever
+void PipelineWindow::DiscardIdle(int64_t latest)
+{
+	if (latest - _lastDiscard < _idleTimeout)
+	{
+		return;
+	}
+	_lastDiscard = latest;
+
+	map<string, Window>::iterator it = _windows.begin();
+	while (it != _windows.end())
+	{
+		if (latest - it->second.latest > _idleTimeout)
+		{
+			_windows.erase(it++);
+		} else
+		{
+			++it;
+		}
+	}
+}
+
+// --- Patient join ---
+PipelinePatientJoin::PipelinePatientJoin(const string &name,
+	unsigned int queueCapacity, const vector<string> &metricIds,
+	int64_t maxSkew, PipelinePatientResolver *resolver) :
+	PipelineOperator(name, queueCapacity),
+	_metricIds(metricIds),
+	_maxSkew(maxSkew),
+	_resolver(resolver),
+	_joined(metricIds.size())
+{
+	if (_metricIds.empty() || _resolver == NULL)
+	{
+		stringstream errss;
+		errss << "PipelinePatientJoin: a join needs metrics and a patient "
+			<< "resolver";
+		throw errss.str();
+	}
+}
+
+void PipelinePatientJoin::Process(PipelineBatch &input, PipelineBatch &output)
+{
+	for (size_t i = 0; i < input.size(); i++)
+	{
+		PipelineSample &sample = input[i];
+		size_t metric = 0;
+		while (metric < _metricIds.size() &&
+			_metricIds[metric] != sample.metricId)
+		{
+			metric++;
+		}
+		if (metric == _metricIds.size() || sample.IsFrame())
+		{
+			continue;
+		}
+
+		int patientId = sample.patientId;
+		if (patientId == PipelineSample::NO_PATIENT)
+		{
+			patientId = _resolver->GetPatient(sample.deviceId);
+		}
+		if (patientId == PipelineSample::NO_PATIENT)
+		{
+			continue;
+		}
+
+		std::vector<PipelineSample> &latest = _latest[patientId];
+		if (latest.empty())
+		{
+			latest.resize(_metricIds.size());
+		}
+
+		// An older value than the one kept is ignored
+		if (latest[metric].timestamp > sample.timestamp)
+		{
+			continue;
+		}
+		latest[metric].Swap(sample);
+		latest[metric].patientId = patientId;
+
+		int64_t timestamp = latest[metric].timestamp;
+		bool complete = true;
+		for (size_t m = 0; m < latest.size() && complete; m++)
+		{
+			int64_t skew = timestamp - latest[m].timestamp;
+			complete = !latest[m].metricId.empty() &&
+				skew <= _maxSkew && -skew <= _maxSkew;
+			_joined[m] = &latest[m];
+		}
+		if (!complete)
+		{
+			continue;
+		}
+
+		output.push_back(PipelineSample());
+		PipelineSample &result = output.back();
+		result = latest[metric];
+		result.values.clear();
+		result.samplePeriod = 0;
+		if (!Combine(patientId, _joined, result))
+		{
+			output.pop_back();
+		}
+	}
+}
+
+// --- Sink ---
+void PipelineSink::Process(PipelineBatch &input, PipelineBatch &/*output*/)
+{
+	Consume(input);
+}
+
+// ----------------------------------------------------------------------------
+// Pipeline
+StreamPipeline::StreamPipeline(unsigned int threadCount,
+	unsigned int maxBatch) :
+	_threadCount(threadCount == 0 ? 1 : threadCount),
+	_maxBatch(maxBatch == 0 ? 1 : maxBatch),
+	_stopping(false)
+{
+}
+
+StreamPipeline::~StreamPipeline()
+{
+	Stop();
+	for (size_t i = 0; i < _operators.size(); i++)
+	{
+		delete _operators[i];
+	}
+}
+
+void StreamPipeline::AddOperator(PipelineOperator *pipelineOperator)
+{
+	if (!_threads.empty() || pipelineOperator->_pipeline != NULL)
+	{
+		stringstream errss;
+		errss << "StreamPipeline: operator " << pipelineOperator->GetName()
+			<< " cannot be added";
+		throw errss.str();
+	}
+	pipelineOperator->_pipeline = this;
+	_operators.push_back(pipelineOperator);
+}
+
+void StreamPipeline::Connect(PipelineOperator *from, PipelineOperator *to)
+{
+	if (from->_pipeline != this || to->_pipeline != this || from == to ||
+		!_threads.empty())
+	{
+		stringstream errss;
+		errss << "StreamPipeline: cannot connect " << from->GetName()
+			<< " to " << to->GetName();
+		throw errss.str();
+	}
+	from->_downstream.push_back(to);
+	to->_upstream.push_back(from);
+}
+
+void StreamPipeline::Start()
+{
+	if (!_threads.empty())
+	{
+		return;
+	}
+	_stopping = false;
+	for (unsigned int i = 0; i < _threadCount; i++)
+	{
+		OSThread *thread = new OSThread(WorkerThread, this);
+		thread->Run();
+		_threads.push_back(thread);
+	}
+}
+
+void StreamPipeline::Stop()
+{
+	_condition.Lock();
+	_stopping = true;
+	_condition.Broadcast();
+	_condition.Unlock();
+
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		_threads[i]->Join();
+		delete _threads[i];
+	}
+	_threads.clear();
+}
+
+void StreamPipeline::GetMetrics(vector<PipelineOperatorMetrics> &metrics)
+{
+	_condition.Lock();
+	metrics.resize(_operators.size());
+	for (size_t i = 0; i < _operators.size(); i++)
+	{
+		metrics[i] = _operators[i]->_metrics;
+		metrics[i].queueLength = (unsigned int)_operators[i]->_queue.size();
+	}
+	_condition.Unlock();
+}
+
+// ----------------------------------------------------------------------------
+// Scheduling.  An operator is runnable when it has input and every operator
+// after it has room.  The ready list holds each runnable operator once.
+bool StreamPipeline::IsRunnable(PipelineOperator *pipelineOperator)
+{
+	if (pipelineOperator->_queue.empty())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < pipelineOperator->_downstream.size(); i++)
+	{
+		PipelineOperator *next = pipelineOperator->_downstream[i];
+		if (next->_queue.size() >= next->_capacity)
+		{
+			pipelineOperator->_metrics.heldBackCount++;
+			return false;
+		}
+	}
+	return true;
+}
+
+void StreamPipeline::Schedule(PipelineOperator *pipelineOperator)
+{
+	if (pipelineOperator->_running || pipelineOperator->_ready ||
+		!IsRunnable(pipelineOperator))
+	{
+		return;
+	}
+	pipelineOperator->_ready = true;
+	_ready.push_back(pipelineOperator);
+}
+
+// Appends the output of an operator to the queues after it.  Every queue
+// but the last gets a copy.
+void StreamPipeline::Deliver(PipelineOperator *from, PipelineBatch &output,
+	int64_t now)
+{
+	for (size_t d = 0; d < from->_downstream.size(); d++)
+	{
+		PipelineOperator *to = from->_downstream[d];
+		bool last = d + 1 == from->_downstream.size();
+		for (size_t i = 0; i < output.size(); i++)
+		{
+			to->_queue.push_back(PipelineSample());
+			if (last)
+			{
+				to->_queue.back().Swap(output[i]);
+			} else
+			{
+				to->_queue.back() = output[i];
+			}
+			to->_queue.back().queuedTime = now;
+		}
+		if (to->_queue.size() > to->_metrics.peakQueueLength)
+		{
+			to->_metrics.peakQueueLength = (unsigned int)to->_queue.size();
+		}
+	}
+}
+
+void *StreamPipeline::WorkerThread(void *param)
+{
+	StreamPipeline *pipeline = (StreamPipeline *)param;
+	pipeline->Work();
+	return NULL;
+}
+
+// Each thread takes the next ready operator, runs one batch of it without
+// the lock, passes on its output, and schedules the operators whose state
+// changed: the operator itself, the ones after it that received input, and
+// the ones before it that may have been held back by its queue.
+void StreamPipeline::Work()
+{
+	PipelineBatch input;
+	PipelineBatch output;
+
+	_condition.Lock();
+	while (!_stopping)
+	{
+		if (_ready.empty())
+		{
+			_condition.Wait();
+			continue;
+		}
+
+		PipelineOperator *current = _ready.front();
+		_ready.pop_front();
+		current->_ready = false;
+		if (!IsRunnable(current))
+		{
+			continue;
+		}
+		current->_running = true;
+
+		size_t count = current->_queue.size();
+		if (count > _maxBatch)
+		{
+			count = _maxBatch;
+		}
+		int64_t start = OSGetMonotonicTime();
+		input.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			input[i].Swap(current->_queue.front());
+			current->_queue.pop_front();
+
+			int64_t latency = start - input[i].queuedTime;
+			current->_metrics.totalQueueLatency += latency;
+			if (latency > current->_metrics.maxQueueLatency)
+			{
+				current->_metrics.maxQueueLatency = latency;
+			}
+		}
+		_condition.Unlock();
+
+		output.clear();
+		bool failed = false;
+		try
+		{
+			current->Process(input, output);
+		}
+		catch (string message)
+		{
+			failed = true;
+			output.clear();
+		}
+		int64_t end = OSGetMonotonicTime();
+
+		_condition.Lock();
+		PipelineOperatorMetrics &metrics = current->_metrics;
+		metrics.samplesIn += count;
+		metrics.samplesOut += output.size();
+		metrics.batches++;
+		metrics.busyTime += end - start;
+		if (failed)
+		{
+			metrics.errorCount++;
+		}
+		if (current->IsSink())
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				int64_t latency = end - input[i].entryTime;
+				metrics.totalEndToEndLatency += latency;
+				if (latency > metrics.maxEndToEndLatency)
+				{
+					metrics.maxEndToEndLatency = latency;
+				}
+			}
+		}
+
+		Deliver(current, output, end);
+		current->_running = false;
+
+		Schedule(current);
+		for (size_t i = 0; i < current->_downstream.size(); i++)
+		{
+			Schedule(current->_downstream[i]);
+		}
+		for (size_t i = 0; i < current->_upstream.size(); i++)
+		{
+			Schedule(current->_upstream[i]);
+		}
+
+		// Wakes up the other threads for the operators just scheduled, and
+		// the sources waiting for room
+		_condition.Broadcast();
+	}
+	_condition.Unlock();
+}
+
+// ----------------------------------------------------------------------------
+// Sources
+unsigned int StreamPipeline::Offer(PipelineSource *source,
+	PipelineBatch &samples)
+{
+	_condition.Lock();
+	size_t taken = source->_capacity > source->_queue.size() ?
+		source->_capacity - source->_queue.size() : 0;
+	if (taken > samples.size())
+	{
+		taken = samples.size();
+	}
+
+	int64_t now = OSGetMonotonicTime();
+	for (size_t i = 0; i < taken; i++)
+	{
+		source->_queue.push_back(PipelineSample());
+		PipelineSample &sample = source->_queue.back();
+		sample.Swap(samples[i]);
+		sample.entryTime = now;
+		sample.queuedTime = now;
+	}
+	source->_metrics.refusedCount += samples.size() - taken;
+	if (source->_queue.size() > source->_metrics.peakQueueLength)
+	{
+		source->_metrics.peakQueueLength = (unsigned int)source->_queue.size();
+	}
+
+	if (taken > 0)
+	{
+		Schedule(source);
+		_condition.Broadcast();
+	}
+	_condition.Unlock();
+	return (unsigned int)taken;
+}
+
+unsigned int StreamPipeline::GetFreeCapacity(PipelineSource *source)
+{
+	_condition.Lock();
+	unsigned int free = source->_capacity > source->_queue.size() ?
+		source->_capacity - (unsigned int)source->_queue.size() : 0;
+	_condition.Unlock();
+	return free;
+}
+
+bool StreamPipeline::WaitForCapacity(PipelineSource *source, int64_t timeout)
+{
+	int64_t deadline = OSGetMonotonicTime() + timeout;
+
+	_condition.Lock();
+	while (source->_queue.size() >= source->_capacity && !_stopping)
+	{
+		int64_t remaining = deadline - OSGetMonotonicTime();
+		if (remaining <= 0)
+		{
+			break;
+		}
+		_condition.TimedWait(remaining);
+	}
+	bool hasRoom = source->_queue.size() < source->_capacity;
+	_condition.Unlock();
+	return hasRoom;
+}
@@ -0,0 +1,449 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef STREAM_PIPELINE_H
+#define STREAM_PIPELINE_H
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "OSAPI.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Stream pipeline:
+// Computes derived values from streams of device data, such as a heart rate
+// from an ECG waveform, a rolling average of SpO2, or a shock index from the
+// heart rate and the blood pressure of a patient.
+//
+// A pipeline is a graph of operators.  Each operator has a bounded input
+// queue, takes the samples from it in batches, and appends its output to the
+// queues of the operators connected after it:
+//
+//     PipelineSource --> PipelineMap --> PipelineWindow --> PipelineSink
+//                                   \--> PipelinePatientJoin --/
+//
+//  - PipelineSource: where samples enter the pipeline, from any thread.
+//  - PipelineMap: transforms or drops each sample on its own.
+//  - PipelineWindow: aggregates the values of each stream over a sliding
+//    time window.
+//  - PipelinePatientJoin: combines the latest values of several metrics of
+//    one patient.
+//  - PipelineSink: where samples leave the pipeline, for example to be
+//    written by a DataWriter.
+//
+// The operators run on a pool of threads shared by the whole pipeline.  An
+// operator runs on at most one thread at a time, so it can keep state
+// without locking, and different operators run in parallel.  An operator is
+// only run when every operator after it has room in its queue, so a slow
+// operator holds back the ones before it, down to the sources.  A source
+// that is full refuses samples, and a DataReader feeding it leaves them in
+// its own queue (see the DerivedVitals application).  A queue can go over
+// its capacity by at most the output of one batch of each operator
+// connected to it.
+//
+// The pipeline keeps metrics per operator: samples in and out, the time
+// samples waited in the queue, the time spent processing, the times the
+// operator was held back, and for sinks the time from source to sink.
+//
+// ------------------------------------------------------------------------- //
+
+// ------------------------------------------------------------------------- //
+// A sample in a pipeline: one numeric value, or one frame of waveform values
+struct PipelineSample
+{
+	// Patient ID of a sample whose patient is not known
+	static const int NO_PATIENT = -1;
+
+	PipelineSample() :
+		instanceId(0),
+		patientId(NO_PATIENT),
+		timestamp(0),
+		value(0.0f),
+		samplePeriod(0),
+		entryTime(0),
+		queuedTime(0)
+	{
+	}
+
+	// Exchanges the contents of two samples without copying their strings
+	// and values
+	void Swap(PipelineSample &other);
+
+	// True for a frame of waveform values
+	bool IsFrame() const
+	{
+		return samplePeriod != 0;
+	}
+
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+	int patientId;
+
+	// Source time of the value, or of the first value of a frame, in
+	// nanoseconds since the epoch
+	int64_t timestamp;
+
+	// The value of a numeric, or the values of a frame and the time between
+	// them in nanoseconds
+	float value;
+	std::vector<float> values;
+	int64_t samplePeriod;
+
+	// Monotonic times the sample entered the pipeline and its current queue
+	int64_t entryTime;
+	int64_t queuedTime;
+};
+
+typedef std::vector<PipelineSample> PipelineBatch;
+
+// ------------------------------------------------------------------------- //
+// Counters of one operator.  The times are in nanoseconds.
+struct PipelineOperatorMetrics
+{
+	std::string name;
+
+	// Samples taken from the input queue, and samples output
+	uint64_t samplesIn;
+	uint64_t samplesOut;
+	uint64_t batches;
+
+	// Input queue
+	unsigned int queueLength;
+	unsigned int peakQueueLength;
+	unsigned int queueCapacity;
+
+	// Times the operator had input but an operator after it was full, and
+	// samples a source refused because it was full
+	uint64_t heldBackCount;
+	uint64_t refusedCount;
+
+	// Batches that failed with an exception
+	uint64_t errorCount;
+
+	// Time spent processing batches
+	int64_t busyTime;
+
+	// Time samples waited in the input queue, in total and at most
+	int64_t totalQueueLatency;
+	int64_t maxQueueLatency;
+
+	// Sinks only: time from the source to the sink, in total and at most
+	int64_t totalEndToEndLatency;
+	int64_t maxEndToEndLatency;
+};
+
+class StreamPipeline;
+
+// ------------------------------------------------------------------------- //
+//
+// PipelineOperator:
+// Base class of all operators.  An operator belongs to one StreamPipeline,
+// which deletes it.
+//
+// ------------------------------------------------------------------------- //
+class PipelineOperator
+{
+public:
+	virtual ~PipelineOperator();
+
+	const std::string &GetName() const
+	{
+		return _name;
+	}
+
+protected:
+	// --- Constructor ---
+	// The input queue holds up to queueCapacity samples
+	PipelineOperator(const std::string &name, unsigned int queueCapacity);
+
+	// --- Processing ---
+	// Processes a batch taken from the input queue, and appends the samples
+	// to pass on to the output.  The operator may swap samples out of the
+	// input.  This is called on one pool thread at a time.  An exception
+	// thrown as a std::string drops the batch and is counted as an error.
+	virtual void Process(PipelineBatch &input, PipelineBatch &output) = 0;
+
+	// True for sinks, whose input is measured from source to sink
+	virtual bool IsSink() const
+	{
+		return false;
+	}
+
+	// The pipeline the operator was added to, or NULL
+	StreamPipeline *GetPipeline() const
+	{
+		return _pipeline;
+	}
+
+private:
+	friend class StreamPipeline;
+
+	// --- Not copyable ---
+	PipelineOperator(const PipelineOperator &);
+	PipelineOperator &operator=(const PipelineOperator &);
+
+	// --- Private members, protected by the lock of the pipeline ---
+	std::string _name;
+	StreamPipeline *_pipeline;
+	std::deque<PipelineSample> _queue;
+	unsigned int _capacity;
+	std::vector<PipelineOperator *> _upstream;
+	std::vector<PipelineOperator *> _downstream;
+
+	// Running on a pool thread, or waiting in the ready queue
+	bool _running;
+	bool _ready;
+
+	PipelineOperatorMetrics _metrics;
+};
+
+// ------------------------------------------------------------------------- //
+// Where samples enter the pipeline.  Samples are offered from any thread,
+// and passed on unchanged.
+class PipelineSource : public PipelineOperator
+{
+public:
+	PipelineSource(const std::string &name, unsigned int queueCapacity);
+
+	// Moves as many samples as there is room for from the front of the
+	// batch into the pipeline, and returns how many were taken.  The samples
+	// that were taken are left empty.
+	unsigned int Offer(PipelineBatch &samples);
+
+	// Number of samples the source can take now
+	unsigned int GetFreeCapacity();
+
+	// Waits up to the timeout for the source to have room.  Returns false if
+	// it is still full.
+	bool WaitForCapacity(int64_t timeoutNanoseconds);
+
+protected:
+	virtual void Process(PipelineBatch &input, PipelineBatch &output);
+};
+
+// ------------------------------------------------------------------------- //
+// Transforms each sample on its own
+class PipelineMap : public PipelineOperator
+{
+protected:
+	PipelineMap(const std::string &name, unsigned int queueCapacity) :
+		PipelineOperator(name, queueCapacity)
+	{
+	}
+
+	// Transforms the sample in place.  Returns false to drop it.
+	virtual bool Map(PipelineSample &sample) = 0;
+
+	virtual void Process(PipelineBatch &input, PipelineBatch &output);
+};
+
+// ------------------------------------------------------------------------- //
+// Aggregates the values of one metric over a sliding time window, per stream
+// (device, metric and instance), and outputs the aggregate with a new
+// metric ID each time a sample arrives.  Samples of other metrics are
+// dropped.  The values of frames are windowed one by one.
+enum PipelineAggregate
+{
+	PIPELINE_MEAN,
+	PIPELINE_MINIMUM,
+	PIPELINE_MAXIMUM
+};
+
+class PipelineWindow : public PipelineOperator
+{
+public:
+	// Windows of streams that receive nothing for idleTimeout of source
+	// time are discarded
+	PipelineWindow(const std::string &name, unsigned int queueCapacity,
+		const std::string &inputMetricId, const std::string &outputMetricId,
+		int64_t duration, PipelineAggregate aggregate,
+		int64_t idleTimeout = 60000000000LL);
+
+	unsigned int GetStreamCount() const
+	{
+		return (unsigned int)_windows.size();
+	}
+
+protected:
+	virtual void Process(PipelineBatch &input, PipelineBatch &output);
+
+private:
+	struct WindowValue
+	{
+		int64_t timestamp;
+		float value;
+	};
+
+	struct Window
+	{
+		std::deque<WindowValue> values;
+		double sum;
+		int64_t latest;
+	};
+
+	void Add(Window &window, int64_t timestamp, float value);
+	float Aggregate(const Window &window) const;
+	void DiscardIdle(int64_t latest);
+
+	std::string _inputMetricId;
+	std::string _outputMetricId;
+	int64_t _duration;
+	PipelineAggregate _aggregate;
+	int64_t _idleTimeout;
+
+	std::map<std::string, Window> _windows;
+	int64_t _latest;
+	int64_t _lastDiscard;
+};
+
+// ------------------------------------------------------------------------- //
+// Tells which patient a device monitors.  Called from pool threads.
+class PipelinePatientResolver
+{
+public:
+	virtual ~PipelinePatientResolver()
+	{
+	}
+
+	// Returns PipelineSample::NO_PATIENT if the device monitors no patient
+	virtual int GetPatient(const std::string &deviceId) = 0;
+};
+
+// ------------------------------------------------------------------------- //
+// Keeps the latest value of each of a list of metrics, per patient, and
+// calls Combine() each time one of them arrives while the others are known
+// and no older than maxSkew of source time.  Samples of other metrics, and of
+// devices that monitor no patient, are dropped.
+class PipelinePatientJoin : public PipelineOperator
+{
+protected:
+	PipelinePatientJoin(const std::string &name, unsigned int queueCapacity,
+		const std::vector<std::string> &metricIds, int64_t maxSkew,
+		PipelinePatientResolver *resolver);
+
+	// Computes the output from the latest value of each metric, in the order
+	// of the metric IDs.  The output has the patient ID set, and the IDs of
+	// the sample that triggered the join.  Returns false to output nothing.
+	virtual bool Combine(int patientId,
+		const std::vector<const PipelineSample *> &latest,
+		PipelineSample &output) = 0;
+
+	virtual void Process(PipelineBatch &input, PipelineBatch &output);
+
+private:
+	std::vector<std::string> _metricIds;
+	int64_t _maxSkew;
+	PipelinePatientResolver *_resolver;
+
+	// Latest value of each metric, per patient
+	std::map<int, std::vector<PipelineSample> > _latest;
+	std::vector<const PipelineSample *> _joined;
+};
+
+// ------------------------------------------------------------------------- //
+// Where samples leave the pipeline.  A sink outputs nothing.
+class PipelineSink : public PipelineOperator
+{
+protected:
+	PipelineSink(const std::string &name, unsigned int queueCapacity) :
+		PipelineOperator(name, queueCapacity)
+	{
+	}
+
+	virtual void Consume(PipelineBatch &samples) = 0;
+
+	virtual void Process(PipelineBatch &input, PipelineBatch &output);
+
+	virtual bool IsSink() const
+	{
+		return true;
+	}
+};
+
+// ------------------------------------------------------------------------- //
+//
+// StreamPipeline:
+// Owns the operators and the thread pool that runs them.
+//
+// ------------------------------------------------------------------------- //
+class StreamPipeline
+{
+public:
+	// --- Constructor and destructor ---
+	// Operators take up to maxBatch samples at a time
+	StreamPipeline(unsigned int threadCount, unsigned int maxBatch);
+
+	// Stops the threads, and deletes the operators
+	~StreamPipeline();
+
+	// --- Building the pipeline ---
+	// Adds an operator, which the pipeline deletes.  Returns the operator.
+	template <typename T>
+	T *Add(T *pipelineOperator)
+	{
+		AddOperator(pipelineOperator);
+		return pipelineOperator;
+	}
+
+	// Sends the output of one operator to another.  An operator connected
+	// to several operators sends each of them a copy.
+	void Connect(PipelineOperator *from, PipelineOperator *to);
+
+	// --- Running ---
+	// Starts the threads.  Operators cannot be added once started.
+	void Start();
+
+	// Stops the threads.  Samples still queued are dropped.
+	void Stop();
+
+	// --- Metrics ---
+	// The metrics of every operator, in the order they were added
+	void GetMetrics(std::vector<PipelineOperatorMetrics> &metrics);
+
+private:
+	friend class PipelineSource;
+
+	// --- Not copyable ---
+	StreamPipeline(const StreamPipeline &);
+	StreamPipeline &operator=(const StreamPipeline &);
+
+	// --- Private methods ---
+	void AddOperator(PipelineOperator *pipelineOperator);
+	static void *WorkerThread(void *param);
+	void Work();
+
+	// Called with the lock held
+	bool IsRunnable(PipelineOperator *pipelineOperator);
+	void Schedule(PipelineOperator *pipelineOperator);
+	void Deliver(PipelineOperator *from, PipelineBatch &output, int64_t now);
+
+	unsigned int Offer(PipelineSource *source, PipelineBatch &samples);
+	unsigned int GetFreeCapacity(PipelineSource *source);
+	bool WaitForCapacity(PipelineSource *source, int64_t timeout);
+
+	// --- Private members ---
+	unsigned int _threadCount;
+	unsigned int _maxBatch;
+
+	// Protects the queues, the ready list and the metrics, and wakes up the
+	// threads and the sources waiting for room
+	OSCondition _condition;
+
+	std::vector<PipelineOperator *> _operators;
+	std::deque<PipelineOperator *> _ready;
+	std::vector<OSThread *> _threads;
+	bool _stopping;
+};
+
+#endif
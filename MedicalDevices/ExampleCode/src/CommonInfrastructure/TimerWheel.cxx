@@ -0,0 +1,213 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <sstream>
+#include "TimerWheel.h"
+
+// Largest distance between the current tick and an expiration tick
+static const uint64_t MAX_TICK_DISTANCE = 0xFFFFFFFFULL;
+
+// ----------------------------------------------------------------------------
+TimerWheel::TimerWheel(int64_t tickLength, int64_t start) :
+	_tickLength(tickLength),
+	_start(start),
+	_currentTick(0),
+	_scheduledCount(0)
+{
+	if (_tickLength <= 0)
+	{
+		std::stringstream errss;
+		errss << "TimerWheel: the tick length must be positive";
+		throw errss.str();
+	}
+
+	for (unsigned int level = 0; level < LEVELS; level++)
+	{
+		for (unsigned int slot = 0; slot < SLOTS; slot++)
+		{
+			_slots[level][slot]._next = &_slots[level][slot];
+			_slots[level][slot]._prev = &_slots[level][slot];
+		}
+	}
+}
+
+TimerWheel::~TimerWheel()
+{
+	for (unsigned int level = 0; level < LEVELS; level++)
+	{
+		for (unsigned int slot = 0; slot < SLOTS; slot++)
+		{
+			TimerWheelNode &head = _slots[level][slot];
+			while (head._next != &head)
+			{
+				Unlink(*head._next);
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Scheduling.  Expiration times are rounded up to a tick, so a timer never
+// expires before its time.
+uint64_t TimerWheel::ToTick(int64_t time) const
+{
+	if (time <= _start)
+	{
+		return 0;
+	}
+	return (uint64_t)((time - _start + _tickLength - 1) / _tickLength);
+}
+
+void TimerWheel::Schedule(TimerWheelNode &node, int64_t expiration)
+{
+	if (node.IsScheduled())
+	{
+		Unlink(node);
+	} else
+	{
+		_scheduledCount++;
+	}
+
+	// The current tick has already been processed
+	uint64_t tick = ToTick(expiration);
+	if (tick > _currentTick && tick - _currentTick > MAX_TICK_DISTANCE)
+	{
+		tick = _currentTick | MAX_TICK_DISTANCE;
+	}
+	if (tick <= _currentTick)
+	{
+		tick = _currentTick + 1;
+	}
+	node._expiration = tick;
+	Insert(node);
+}
+
+void TimerWheel::Cancel(TimerWheelNode &node)
+{
+	if (node.IsScheduled())
+	{
+		Unlink(node);
+		_scheduledCount--;
+	}
+}
+
+// The level is the highest group of SLOT_BITS bits in which the expiration
+// tick differs from the current tick, so the timer reaches level 0 exactly
+// when the current tick enters the last SLOTS ticks before it.  A timer due
+// on the next tick always goes to level 0, which is processed after the
+// cascades of that tick.
+void TimerWheel::Insert(TimerWheelNode &node)
+{
+	uint64_t difference = node._expiration ^ _currentTick;
+	unsigned int level = 0;
+	if (node._expiration != _currentTick + 1)
+	{
+		while (level + 1 < LEVELS &&
+			(difference >> (SLOT_BITS * (level + 1))) != 0)
+		{
+			level++;
+		}
+	}
+
+	unsigned int slot =
+		(unsigned int)(node._expiration >> (SLOT_BITS * level)) & (SLOTS - 1);
+	PushBack(_slots[level][slot], node);
+}
+
+// ----------------------------------------------------------------------------
+// Advancing.  When the wheel holds no timers it jumps straight to now.
+unsigned int TimerWheel::Advance(int64_t now, TimerWheelListener &listener)
+{
+	uint64_t target = now <= _start ? 0 :
+		(uint64_t)((now - _start) / _tickLength);
+	unsigned int expired = 0;
+
+	while (_currentTick < target)
+	{
+		if (_scheduledCount == 0)
+		{
+			_currentTick = target;
+			break;
+		}
+
+		_currentTick++;
+
+		// Move the timers of the higher levels down, highest level first,
+		// when the current tick enters one of their slots
+		unsigned int cascadeLevels = 0;
+		while (cascadeLevels + 1 < LEVELS &&
+			(_currentTick & ((1ULL << (SLOT_BITS * (cascadeLevels + 1))) - 1))
+				== 0)
+		{
+			cascadeLevels++;
+		}
+		for (unsigned int level = cascadeLevels; level > 0; level--)
+		{
+			Cascade(level);
+		}
+
+		// Expire the timers of this tick.  They are moved to a list of their
+		// own first, so the listener can schedule and cancel timers freely.
+		TimerWheelNode &slot =
+			_slots[0][(unsigned int)_currentTick & (SLOTS - 1)];
+		if (slot._next == &slot)
+		{
+			continue;
+		}
+
+		TimerWheelNode due;
+		due._next = slot._next;
+		due._prev = slot._prev;
+		due._next->_prev = &due;
+		due._prev->_next = &due;
+		slot._next = &slot;
+		slot._prev = &slot;
+
+		while (due._next != &due)
+		{
+			TimerWheelNode &node = *due._next;
+			Unlink(node);
+			_scheduledCount--;
+			expired++;
+			listener.TimerExpired(node);
+		}
+	}
+	return expired;
+}
+
+void TimerWheel::Cascade(unsigned int level)
+{
+	TimerWheelNode &slot = _slots[level][
+		(unsigned int)(_currentTick >> (SLOT_BITS * level)) & (SLOTS - 1)];
+	while (slot._next != &slot)
+	{
+		TimerWheelNode &node = *slot._next;
+		Unlink(node);
+		Insert(node);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// List operations
+void TimerWheel::Unlink(TimerWheelNode &node)
+{
+	node._prev->_next = node._next;
+	node._next->_prev = node._prev;
+	node._next = NULL;
+	node._prev = NULL;
+}
+
+void TimerWheel::PushBack(TimerWheelNode &head, TimerWheelNode &node)
+{
+	node._next = &head;
+	node._prev = head._prev;
+	head._prev->_next = &node;
+	head._prev = &node;
+}
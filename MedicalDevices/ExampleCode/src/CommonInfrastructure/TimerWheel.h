@@ -0,0 +1,159 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ------------------------------------------------------------------------- //
+//
+// Timer wheel:
+// Keeps a very large number of timers, such as one per monitored stream, in a
+// single thread without an OS timer per timer.  Time is counted in ticks of
+// a fixed length, and timers expire on the first tick at or after their
+// expiration time.
+//
+// The wheel has four levels of 256 slots.  A timer is placed on the lowest
+// level whose slots still tell it apart from the current tick: the first
+// level holds the timers of the next 256 ticks, one slot per tick, the
+// second level the timers of the next 65536 ticks, 256 ticks per slot, and
+// so on.  When the current tick reaches the start of a slot of a higher
+// level, the timers of that slot are moved down a level.  A timer moves down
+// at most three times, whatever its delay.
+//
+// Timers are nodes of intrusive doubly-linked lists, embedded in the objects
+// they belong to, so scheduling, rescheduling and cancelling a timer are
+// O(1) and never allocate.  Rescheduling the timer of a stream on every
+// sample is as cheap as setting a few pointers.
+//
+// Timers further away than 2^32 ticks expire early, at the last tick the
+// wheel can represent.  With 10 ms ticks that is more than a year away.
+//
+// ------------------------------------------------------------------------- //
+
+// A timer.  Objects that need a timer derive from this class.
+class TimerWheelNode
+{
+public:
+	TimerWheelNode() : _next(NULL), _prev(NULL), _expiration(0)
+	{
+	}
+
+	// True if the timer is scheduled
+	bool IsScheduled() const
+	{
+		return _next != NULL;
+	}
+
+	// Tick the timer is scheduled to expire on
+	uint64_t GetExpiration() const
+	{
+		return _expiration;
+	}
+
+private:
+	friend class TimerWheel;
+
+	TimerWheelNode *_next;
+	TimerWheelNode *_prev;
+	uint64_t _expiration;
+};
+
+// Notified of the timers that expire
+class TimerWheelListener
+{
+public:
+	virtual ~TimerWheelListener()
+	{
+	}
+
+	// Called once per expired timer, which is no longer scheduled.  The
+	// listener may schedule or cancel any timer, including this one.
+	virtual void TimerExpired(TimerWheelNode &node) = 0;
+};
+
+class TimerWheel
+{
+public:
+	// --- Constructor and destructor ---
+	// Times are in nanoseconds, and are divided into ticks of tickLength.
+	// The wheel starts at time start.
+	TimerWheel(int64_t tickLength, int64_t start);
+
+	// Cancels the timers still scheduled
+	~TimerWheel();
+
+	// --- Scheduling timers ---
+	// Schedules the timer to expire at the given time, or reschedules it if
+	// it was already scheduled.  A time that has already passed expires on
+	// the next tick.
+	void Schedule(TimerWheelNode &node, int64_t expiration);
+
+	void Cancel(TimerWheelNode &node);
+
+	// --- Advancing time ---
+	// Advances the wheel to time now, and calls the listener for each timer
+	// that expires, in the order of their expiration ticks.  Returns the
+	// number of timers that expired.
+	unsigned int Advance(int64_t now, TimerWheelListener &listener);
+
+	// --- Accessors ---
+	int64_t GetTickLength() const
+	{
+		return _tickLength;
+	}
+
+	uint64_t GetCurrentTick() const
+	{
+		return _currentTick;
+	}
+
+	unsigned int GetScheduledCount() const
+	{
+		return _scheduledCount;
+	}
+
+	// Memory used by the wheel itself, not counting the nodes
+	size_t GetMemorySize() const
+	{
+		return sizeof(*this);
+	}
+
+private:
+	// --- Private constants ---
+	static const unsigned int LEVELS = 4;
+	static const unsigned int SLOT_BITS = 8;
+	static const unsigned int SLOTS = 1 << SLOT_BITS;
+
+	// --- Not copyable ---
+	TimerWheel(const TimerWheel &);
+	TimerWheel &operator=(const TimerWheel &);
+
+	// --- Private methods ---
+	uint64_t ToTick(int64_t time) const;
+	void Insert(TimerWheelNode &node);
+	void Cascade(unsigned int level);
+
+	static void Unlink(TimerWheelNode &node);
+	static void PushBack(TimerWheelNode &head, TimerWheelNode &node);
+
+	// --- Private members ---
+	int64_t _tickLength;
+	int64_t _start;
+	uint64_t _currentTick;
+	unsigned int _scheduledCount;
+
+	// Each slot is the head of a circular list of nodes
+	TimerWheelNode _slots[LEVELS][SLOTS];
+};
+
+#endif
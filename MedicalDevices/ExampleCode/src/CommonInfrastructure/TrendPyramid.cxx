@@ -0,0 +1,244 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <sstream>
+#include <string>
+#include "TrendPyramid.h"
+
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+// A level is chosen for a query if it has at most this many buckets per
+// requested point.  The buckets are then merged down to the requested number
+// of points.
+static const unsigned int MAX_BUCKETS_PER_POINT = 4;
+
+// Bucket number of a slot that has never held data
+static const int64_t NO_BUCKET = -0x7fffffffffffffffLL - 1;
+
+// Bucket number of a timestamp, rounding towards negative infinity
+static int64_t BucketIndex(int64_t timestamp, int64_t width)
+{
+	int64_t index = timestamp / width;
+	if (timestamp % width != 0 && timestamp < 0)
+	{
+		index--;
+	}
+	return index;
+}
+
+TrendPyramid::TrendPyramid(const std::vector<TrendLevelConfig> &levels) :
+	_lastTimestamp(0)
+{
+	if (levels.empty())
+	{
+		std::stringstream errss;
+		errss << "TrendPyramid(): at least one level is required";
+		throw errss.str();
+	}
+
+	Bucket empty;
+	empty.index = NO_BUCKET;
+	empty.sum = 0;
+	empty.minValue = 0;
+	empty.maxValue = 0;
+	empty.count = 0;
+
+	_levels.resize(levels.size());
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		if (levels[i].bucketWidth <= 0 || levels[i].bucketCount == 0)
+		{
+			std::stringstream errss;
+			errss << "TrendPyramid(): invalid level configuration";
+			throw errss.str();
+		}
+		_levels[i].bucketWidth = levels[i].bucketWidth;
+		_levels[i].buckets.assign(levels[i].bucketCount, empty);
+	}
+}
+
+std::vector<TrendLevelConfig> TrendPyramid::DefaultLevels()
+{
+	std::vector<TrendLevelConfig> levels;
+	TrendLevelConfig level;
+
+	// Each level keeps a little more than a round period, so that a query
+	// for the last hour or day that ends now is still answered by it
+	level.bucketWidth = NANOSECONDS_PER_SECOND;
+	level.bucketCount = 65 * 60;
+	levels.push_back(level);
+
+	level.bucketWidth = 10 * NANOSECONDS_PER_SECOND;
+	level.bucketCount = 6 * 370;
+	levels.push_back(level);
+
+	level.bucketWidth = 60 * NANOSECONDS_PER_SECOND;
+	level.bucketCount = 25 * 60;
+	levels.push_back(level);
+
+	level.bucketWidth = 600 * NANOSECONDS_PER_SECOND;
+	level.bucketCount = 8 * 24 * 6;
+	levels.push_back(level);
+
+	return levels;
+}
+
+void TrendPyramid::Add(int64_t timestamp, float value)
+{
+	if (timestamp > _lastTimestamp)
+	{
+		_lastTimestamp = timestamp;
+	}
+
+	for (size_t i = 0; i < _levels.size(); i++)
+	{
+		Level &level = _levels[i];
+		int64_t count = (int64_t)level.buckets.size();
+		int64_t index = BucketIndex(timestamp, level.bucketWidth);
+
+		// Older than the retention of this level
+		if (index <= BucketIndex(_lastTimestamp, level.bucketWidth) - count)
+		{
+			continue;
+		}
+
+		Bucket &bucket = level.buckets[(size_t)(((index % count) + count) %
+			count)];
+		if (bucket.index == index)
+		{
+			bucket.sum += value;
+			bucket.count++;
+			if (value < bucket.minValue)
+			{
+				bucket.minValue = value;
+			}
+			if (value > bucket.maxValue)
+			{
+				bucket.maxValue = value;
+			}
+		}
+		else if (bucket.index < index)
+		{
+			// The slot held a bucket that has fallen out of the ring
+			bucket.index = index;
+			bucket.sum = value;
+			bucket.count = 1;
+			bucket.minValue = value;
+			bucket.maxValue = value;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------- //
+// Picks the finest level that retains the start of the range, and that has
+// few enough buckets in the range for the requested number of points.
+unsigned int TrendPyramid::SelectLevel(int64_t start, int64_t end,
+	unsigned int maxPoints) const
+{
+	for (size_t i = 0; i < _levels.size(); i++)
+	{
+		const Level &level = _levels[i];
+		int64_t first = BucketIndex(start, level.bucketWidth);
+		int64_t last = BucketIndex(end - 1, level.bucketWidth);
+		int64_t oldest = BucketIndex(_lastTimestamp, level.bucketWidth) -
+			(int64_t)level.buckets.size() + 1;
+
+		if (first >= oldest &&
+			last - first + 1 <= (int64_t)maxPoints * MAX_BUCKETS_PER_POINT)
+		{
+			return (unsigned int)i;
+		}
+	}
+	return (unsigned int)_levels.size() - 1;
+}
+
+int64_t TrendPyramid::Query(int64_t start, int64_t end,
+	unsigned int maxPoints, std::vector<TrendPoint> &points) const
+{
+	points.clear();
+	if (end <= start || maxPoints == 0 || _lastTimestamp == 0)
+	{
+		return 0;
+	}
+
+	const Level &level = _levels[SelectLevel(start, end, maxPoints)];
+	int64_t count = (int64_t)level.buckets.size();
+	int64_t first = BucketIndex(start, level.bucketWidth);
+	int64_t last = BucketIndex(end - 1, level.bucketWidth);
+
+	// Merge adjacent buckets so the result fits in maxPoints
+	int64_t bucketsPerPoint = (last - first + maxPoints) / maxPoints;
+
+	// Only visit buckets that this level can still hold
+	int64_t newest = BucketIndex(_lastTimestamp, level.bucketWidth);
+	int64_t begin = first > newest - count + 1 ? first : newest - count + 1;
+	int64_t finish = last < newest ? last : newest;
+
+	TrendPoint point;
+	int64_t pointNumber = -1;
+	double sum = 0;
+	point.count = 0;
+
+	for (int64_t index = begin; index <= finish; index++)
+	{
+		const Bucket &bucket = level.buckets[(size_t)(((index % count) +
+			count) % count)];
+		if (bucket.index != index || bucket.count == 0)
+		{
+			continue;
+		}
+
+		int64_t number = (index - first) / bucketsPerPoint;
+		if (number != pointNumber)
+		{
+			if (point.count > 0)
+			{
+				point.meanValue = (float)(sum / point.count);
+				points.push_back(point);
+			}
+			pointNumber = number;
+			point.startTime = (first + number * bucketsPerPoint) *
+				level.bucketWidth;
+			point.minValue = bucket.minValue;
+			point.maxValue = bucket.maxValue;
+			point.count = 0;
+			sum = 0;
+		}
+
+		sum += bucket.sum;
+		point.count += bucket.count;
+		if (bucket.minValue < point.minValue)
+		{
+			point.minValue = bucket.minValue;
+		}
+		if (bucket.maxValue > point.maxValue)
+		{
+			point.maxValue = bucket.maxValue;
+		}
+	}
+
+	if (point.count > 0)
+	{
+		point.meanValue = (float)(sum / point.count);
+		points.push_back(point);
+	}
+
+	return bucketsPerPoint * level.bucketWidth;
+}
+
+size_t TrendPyramid::GetMemorySize() const
+{
+	size_t size = sizeof(*this);
+	for (size_t i = 0; i < _levels.size(); i++)
+	{
+		size += _levels[i].buckets.size() * sizeof(Bucket);
+	}
+	return size;
+}
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef TREND_PYRAMID_H
+#define TREND_PYRAMID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// ------------------------------------------------------------------------- //
+//
+// Trend pyramids:
+// A TrendPyramid keeps the history of one numeric stream downsampled at
+// several resolutions at once (by default 1 s, 10 s, 1 min and 10 min
+// buckets).  Each bucket holds the min, max, sum and count of the samples
+// that fall into it, and every sample updates one bucket per level as it
+// arrives, so the pyramid is always up to date and never needs a scan of the
+// raw data.
+//
+// Each level is a fixed-size ring of buckets, indexed by the bucket number
+// (timestamp / bucket width) modulo the ring size.  Each slot remembers the
+// bucket number it currently holds, so gaps in the data and samples that
+// arrive late both cost O(1), and the memory of a pyramid never grows.
+//
+// A range query picks the finest level that still covers the start of the
+// range and has at most a few buckets per requested point, then merges
+// adjacent buckets down to the requested number of points.  The work of a
+// query is therefore bounded by the number of points requested, not by the
+// length of the range or the sample rate of the stream.
+//
+// ------------------------------------------------------------------------- //
+
+// Configuration of one level of the pyramid.  Times are in nanoseconds.
+struct TrendLevelConfig
+{
+	int64_t bucketWidth;
+	unsigned int bucketCount;
+};
+
+// One point of a trend, covering [startTime, startTime + width)
+struct TrendPoint
+{
+	int64_t startTime;
+	float minValue;
+	float maxValue;
+	float meanValue;
+	uint32_t count;
+};
+
+class TrendPyramid
+{
+public:
+	// --- Constructor ---
+	// Levels must be ordered from the finest to the coarsest resolution
+	TrendPyramid(const std::vector<TrendLevelConfig> &levels);
+
+	// Default levels: 1 s for 65 minutes, 10 s for 6 hours 10 minutes,
+	// 1 min for 25 hours and 10 min for 8 days
+	static std::vector<TrendLevelConfig> DefaultLevels();
+
+	// --- Adding samples ---
+	// Samples older than the retention of a level are ignored by that level
+	void Add(int64_t timestamp, float value);
+
+	// --- Querying ---
+	// Fills points with at most maxPoints points covering [start, end), and
+	// returns the width of each point in nanoseconds.  Buckets without data
+	// are left out, so a gap in the data is a gap in the trend.
+	int64_t Query(int64_t start, int64_t end, unsigned int maxPoints,
+		std::vector<TrendPoint> &points) const;
+
+	// Timestamp of the most recent sample, or zero if empty
+	int64_t GetLastTimestamp() const
+	{
+		return _lastTimestamp;
+	}
+
+	// Approximate memory used by the buckets of all levels, in bytes
+	size_t GetMemorySize() const;
+
+private:
+	// --- Private types ---
+	struct Bucket
+	{
+		int64_t index;
+		double sum;
+		float minValue;
+		float maxValue;
+		uint32_t count;
+	};
+
+	struct Level
+	{
+		int64_t bucketWidth;
+		std::vector<Bucket> buckets;
+	};
+
+	// --- Private methods ---
+	unsigned int SelectLevel(int64_t start, int64_t end,
+		unsigned int maxPoints) const;
+
+	// --- Private members ---
+	std::vector<Level> _levels;
+	int64_t _lastTimestamp;
+};
+
+#endif
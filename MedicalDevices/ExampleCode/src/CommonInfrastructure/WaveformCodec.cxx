@@ -0,0 +1,474 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "WaveformCodec.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WAVEFORM_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+// Encoding of the values of a block
+enum WaveformBlockMode
+{
+	WAVEFORM_BLOCK_XOR = 0,
+	WAVEFORM_BLOCK_DELTA = 1
+};
+
+// Bytes of the first value, and of the header of a block
+static const size_t WAVEFORM_FIRST_VALUE_BYTES = 4;
+static const size_t WAVEFORM_BLOCK_HEADER_BYTES = 2;
+
+// ------------------------------------------------------------------------- //
+// Bit level helpers
+// ------------------------------------------------------------------------- //
+
+static unsigned int CountLeadingZeros(uint32_t value)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_clz(value);
+#else
+	unsigned int count = 0;
+	while ((value & 0x80000000u) == 0)
+	{
+		value <<= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+static unsigned int CountTrailingZeros(uint32_t value)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_ctz(value);
+#else
+	unsigned int count = 0;
+	while ((value & 1u) == 0)
+	{
+		value >>= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+static uint32_t FloatToBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static uint32_t ZigZag(uint32_t delta)
+{
+	return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+static uint32_t UnZigZag(uint32_t value)
+{
+	return (value >> 1) ^ (0u - (value & 1u));
+}
+
+static void WriteLittleEndian(uint32_t value, unsigned char *out)
+{
+	out[0] = (unsigned char)value;
+	out[1] = (unsigned char)(value >> 8);
+	out[2] = (unsigned char)(value >> 16);
+	out[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t ReadLittleEndian(const unsigned char *in)
+{
+	return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+		((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// ------------------------------------------------------------------------- //
+// Block packing, shared by the scalar and vectorized versions
+// ------------------------------------------------------------------------- //
+
+// Width and shift of the bits that are set in any value of a block, given
+// the OR of its values
+static void MeaningfulBits(uint32_t orValue, unsigned int &width,
+	unsigned int &shift)
+{
+	if (orValue == 0)
+	{
+		width = 0;
+		shift = 0;
+		return;
+	}
+	shift = CountTrailingZeros(orValue);
+	width = 32 - CountLeadingZeros(orValue) - shift;
+}
+
+// Writes the header of the block, and packs its values with the narrower of
+// the two encodings.  Returns the position after the block.
+static unsigned char *PackBlock(const uint32_t *xorWords, uint32_t xorOr,
+	const uint32_t *deltaWords, uint32_t deltaOr, unsigned char *out)
+{
+	unsigned int xorWidth, xorShift, deltaWidth, deltaShift;
+	MeaningfulBits(xorOr, xorWidth, xorShift);
+	MeaningfulBits(deltaOr, deltaWidth, deltaShift);
+
+	const uint32_t *words = xorWords;
+	unsigned int mode = WAVEFORM_BLOCK_XOR;
+	unsigned int width = xorWidth;
+	unsigned int shift = xorShift;
+	if (deltaWidth < xorWidth)
+	{
+		words = deltaWords;
+		mode = WAVEFORM_BLOCK_DELTA;
+		width = deltaWidth;
+		shift = deltaShift;
+	}
+
+	*out++ = (unsigned char)((mode << 7) | width);
+	*out++ = (unsigned char)shift;
+
+	// Eight values of the same width fill exactly width bytes
+	uint64_t accumulator = 0;
+	unsigned int bits = 0;
+	for (unsigned int j = 0; j < WAVEFORM_BLOCK_SIZE; j++)
+	{
+		accumulator |= (uint64_t)(words[j] >> shift) << bits;
+		bits += width;
+		while (bits >= 8)
+		{
+			*out++ = (unsigned char)accumulator;
+			accumulator >>= 8;
+			bits -= 8;
+		}
+	}
+	return out;
+}
+
+// Reads the header of a block and unpacks its values.  Returns false if the
+// block is not valid, or does not fit in the remaining bytes.
+static bool UnpackBlock(const unsigned char *&in, const unsigned char *end,
+	uint32_t *words, unsigned int &mode)
+{
+	if ((size_t)(end - in) < WAVEFORM_BLOCK_HEADER_BYTES)
+	{
+		return false;
+	}
+	mode = in[0] >> 7;
+	unsigned int width = in[0] & 0x7f;
+	unsigned int shift = in[1];
+	in += WAVEFORM_BLOCK_HEADER_BYTES;
+	if (width > 32 || shift > 31 || width + shift > 32 ||
+		(size_t)(end - in) < width)
+	{
+		return false;
+	}
+
+	uint64_t mask = ((uint64_t)1 << width) - 1;
+	uint64_t accumulator = 0;
+	unsigned int bits = 0;
+	for (unsigned int j = 0; j < WAVEFORM_BLOCK_SIZE; j++)
+	{
+		while (bits < width)
+		{
+			accumulator |= (uint64_t)*in++ << bits;
+			bits += 8;
+		}
+		words[j] = (uint32_t)(accumulator & mask) << shift;
+		accumulator >>= width;
+		bits -= width;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------- //
+// Scalar codec
+// ------------------------------------------------------------------------- //
+
+size_t WaveformEncodedBound(unsigned int count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+	size_t blocks = (count - 1 + WAVEFORM_BLOCK_SIZE - 1) / WAVEFORM_BLOCK_SIZE;
+	return WAVEFORM_FIRST_VALUE_BYTES +
+		blocks * (WAVEFORM_BLOCK_HEADER_BYTES + 4 * WAVEFORM_BLOCK_SIZE);
+}
+
+// Encodes the values of one block starting at index start, padding a partial
+// block with values equal to the last one
+static unsigned char *EncodeBlockScalar(const float *values,
+	unsigned int start, unsigned int count, uint32_t &previous,
+	unsigned char *out)
+{
+	uint32_t xorWords[WAVEFORM_BLOCK_SIZE];
+	uint32_t deltaWords[WAVEFORM_BLOCK_SIZE];
+	uint32_t xorOr = 0;
+	uint32_t deltaOr = 0;
+	for (unsigned int j = 0; j < WAVEFORM_BLOCK_SIZE; j++)
+	{
+		uint32_t current = previous;
+		if (start + j < count)
+		{
+			current = FloatToBits(values[start + j]);
+		}
+		xorWords[j] = current ^ previous;
+		deltaWords[j] = ZigZag(current - previous);
+		xorOr |= xorWords[j];
+		deltaOr |= deltaWords[j];
+		previous = current;
+	}
+	return PackBlock(xorWords, xorOr, deltaWords, deltaOr, out);
+}
+
+size_t EncodeWaveformScalar(const float *values, unsigned int count,
+	unsigned char *encoded)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	uint32_t previous = FloatToBits(values[0]);
+	WriteLittleEndian(previous, encoded);
+	unsigned char *out = encoded + WAVEFORM_FIRST_VALUE_BYTES;
+
+	for (unsigned int i = 1; i < count; i += WAVEFORM_BLOCK_SIZE)
+	{
+		out = EncodeBlockScalar(values, i, count, previous, out);
+	}
+	return (size_t)(out - encoded);
+}
+
+bool DecodeWaveformScalar(const unsigned char *encoded, size_t length,
+	float *values, unsigned int count)
+{
+	if (count == 0)
+	{
+		return length == 0;
+	}
+	if (length < WAVEFORM_FIRST_VALUE_BYTES)
+	{
+		return false;
+	}
+
+	const unsigned char *in = encoded;
+	const unsigned char *end = encoded + length;
+	uint32_t previous = ReadLittleEndian(in);
+	in += WAVEFORM_FIRST_VALUE_BYTES;
+	memcpy(&values[0], &previous, sizeof(previous));
+
+	uint32_t words[WAVEFORM_BLOCK_SIZE];
+	for (unsigned int i = 1; i < count; i += WAVEFORM_BLOCK_SIZE)
+	{
+		unsigned int mode;
+		if (!UnpackBlock(in, end, words, mode))
+		{
+			return false;
+		}
+		for (unsigned int j = 0; j < WAVEFORM_BLOCK_SIZE; j++)
+		{
+			if (mode == WAVEFORM_BLOCK_XOR)
+			{
+				previous ^= words[j];
+			} else
+			{
+				previous += UnZigZag(words[j]);
+			}
+			if (i + j < count)
+			{
+				memcpy(&values[i + j], &previous, sizeof(previous));
+			}
+		}
+	}
+	return in == end;
+}
+
+// ------------------------------------------------------------------------- //
+// SSE2 codec
+// ------------------------------------------------------------------------- //
+
+#ifdef WAVEFORM_CODEC_SSE2
+
+// OR of the four lanes of a vector
+static uint32_t OrLanes(__m128i value)
+{
+	value = _mm_or_si128(value, _mm_srli_si128(value, 8));
+	value = _mm_or_si128(value, _mm_srli_si128(value, 4));
+	return (uint32_t)_mm_cvtsi128_si32(value);
+}
+
+static __m128i ZigZag(__m128i delta)
+{
+	return _mm_xor_si128(_mm_slli_epi32(delta, 1), _mm_srai_epi32(delta, 31));
+}
+
+static __m128i UnZigZag(__m128i value)
+{
+	__m128i sign = _mm_sub_epi32(_mm_setzero_si128(),
+		_mm_and_si128(value, _mm_set1_epi32(1)));
+	return _mm_xor_si128(_mm_srli_epi32(value, 1), sign);
+}
+
+// Running XOR and running sum of four lanes, starting from the last value
+// of the previous lanes, which is broadcast in carry
+static __m128i PrefixXor(__m128i value, __m128i carry)
+{
+	value = _mm_xor_si128(value, _mm_slli_si128(value, 4));
+	value = _mm_xor_si128(value, _mm_slli_si128(value, 8));
+	return _mm_xor_si128(value, carry);
+}
+
+static __m128i PrefixSum(__m128i value, __m128i carry)
+{
+	value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+	value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+	return _mm_add_epi32(value, carry);
+}
+
+static __m128i LastLane(__m128i value)
+{
+	return _mm_shuffle_epi32(value, 0xFF);
+}
+
+size_t EncodeWaveform(const float *values, unsigned int count,
+	unsigned char *encoded)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	uint32_t previous = FloatToBits(values[0]);
+	WriteLittleEndian(previous, encoded);
+	unsigned char *out = encoded + WAVEFORM_FIRST_VALUE_BYTES;
+
+	uint32_t xorWords[WAVEFORM_BLOCK_SIZE];
+	uint32_t deltaWords[WAVEFORM_BLOCK_SIZE];
+	unsigned int i = 1;
+
+	// Full blocks: each value and the value before it are loaded as two
+	// overlapping vectors
+	for (; i + WAVEFORM_BLOCK_SIZE <= count; i += WAVEFORM_BLOCK_SIZE)
+	{
+		const __m128i *current = (const __m128i *)(values + i);
+		const __m128i *before = (const __m128i *)(values + i - 1);
+		__m128i current0 = _mm_loadu_si128(current);
+		__m128i current1 = _mm_loadu_si128(current + 1);
+		__m128i before0 = _mm_loadu_si128(before);
+		__m128i before1 = _mm_loadu_si128(before + 1);
+
+		__m128i xor0 = _mm_xor_si128(current0, before0);
+		__m128i xor1 = _mm_xor_si128(current1, before1);
+		__m128i delta0 = ZigZag(_mm_sub_epi32(current0, before0));
+		__m128i delta1 = ZigZag(_mm_sub_epi32(current1, before1));
+
+		_mm_storeu_si128((__m128i *)xorWords, xor0);
+		_mm_storeu_si128((__m128i *)(xorWords + 4), xor1);
+		_mm_storeu_si128((__m128i *)deltaWords, delta0);
+		_mm_storeu_si128((__m128i *)(deltaWords + 4), delta1);
+
+		out = PackBlock(xorWords, OrLanes(_mm_or_si128(xor0, xor1)),
+			deltaWords, OrLanes(_mm_or_si128(delta0, delta1)), out);
+	}
+
+	// The last, partial block
+	if (i < count)
+	{
+		previous = FloatToBits(values[i - 1]);
+		out = EncodeBlockScalar(values, i, count, previous, out);
+	}
+	return (size_t)(out - encoded);
+}
+
+bool DecodeWaveform(const unsigned char *encoded, size_t length,
+	float *values, unsigned int count)
+{
+	if (count == 0)
+	{
+		return length == 0;
+	}
+	if (length < WAVEFORM_FIRST_VALUE_BYTES)
+	{
+		return false;
+	}
+
+	const unsigned char *in = encoded;
+	const unsigned char *end = encoded + length;
+	uint32_t first = ReadLittleEndian(in);
+	in += WAVEFORM_FIRST_VALUE_BYTES;
+	memcpy(&values[0], &first, sizeof(first));
+
+	__m128i carry = _mm_set1_epi32((int)first);
+	uint32_t words[WAVEFORM_BLOCK_SIZE];
+	uint32_t decoded[WAVEFORM_BLOCK_SIZE];
+	for (unsigned int i = 1; i < count; i += WAVEFORM_BLOCK_SIZE)
+	{
+		unsigned int mode;
+		if (!UnpackBlock(in, end, words, mode))
+		{
+			return false;
+		}
+
+		__m128i low = _mm_loadu_si128((const __m128i *)words);
+		__m128i high = _mm_loadu_si128((const __m128i *)(words + 4));
+		if (mode == WAVEFORM_BLOCK_XOR)
+		{
+			low = PrefixXor(low, carry);
+			high = PrefixXor(high, LastLane(low));
+		} else
+		{
+			low = PrefixSum(UnZigZag(low), carry);
+			high = PrefixSum(UnZigZag(high), LastLane(low));
+		}
+		carry = LastLane(high);
+
+		if (i + WAVEFORM_BLOCK_SIZE <= count)
+		{
+			_mm_storeu_si128((__m128i *)(values + i), low);
+			_mm_storeu_si128((__m128i *)(values + i + 4), high);
+		} else
+		{
+			_mm_storeu_si128((__m128i *)decoded, low);
+			_mm_storeu_si128((__m128i *)(decoded + 4), high);
+			memcpy(values + i, decoded, (count - i) * sizeof(float));
+		}
+	}
+	return in == end;
+}
+
+bool IsWaveformCodecVectorized()
+{
+	return true;
+}
+
+#else
+
+size_t EncodeWaveform(const float *values, unsigned int count,
+	unsigned char *encoded)
+{
+	return EncodeWaveformScalar(values, count, encoded);
+}
+
+bool DecodeWaveform(const unsigned char *encoded, size_t length,
+	float *values, unsigned int count)
+{
+	return DecodeWaveformScalar(encoded, length, values, count);
+}
+
+bool IsWaveformCodecVectorized()
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef WAVEFORM_CODEC_H
+#define WAVEFORM_CODEC_H
+
+#include <stddef.h>
+
+// ------------------------------------------------------------------------- //
+//
+// Waveform codec:
+// Lossless compression of a frame of waveform values, such as the values of
+// an ice::SampleArray.  Consecutive ECG and pleth samples are close to each
+// other, so the bits of consecutive floats mostly agree.
+//
+// The first value is stored as is.  The following values are grouped in
+// blocks of eight, and each value is replaced by either:
+//  - the XOR of its bits with the bits of the previous value, or
+//  - the zig-zag encoded difference of its bits, read as an integer, with
+//    the bits of the previous value,
+// whichever needs fewer bits for the block.  The bits that are zero in every
+// value of the block, at the top and at the bottom, are dropped, and the
+// remaining bits of the eight values are packed together.  A block costs two
+// header bytes (mode and width, and shift) plus exactly one byte per bit of
+// width.  A flat signal costs two bytes per block.
+//
+// Unlike the bit-by-bit XOR encoding of the segment files, every value of a
+// block has the same width, so the transforms and their inverse are done
+// four values at a time with SSE2 on x86 processors.  The scalar versions
+// produce and accept exactly the same bytes, and are used on other
+// processors.
+//
+// All multi-byte values are stored little-endian, so encoded frames can be
+// exchanged between any processors.
+//
+// ------------------------------------------------------------------------- //
+
+// Number of values in a block
+static const unsigned int WAVEFORM_BLOCK_SIZE = 8;
+
+// Largest number of bytes the encoding of count values can take
+size_t WaveformEncodedBound(unsigned int count);
+
+// Encodes count values into the buffer, which must hold at least
+// WaveformEncodedBound(count) bytes.  Returns the number of bytes written.
+size_t EncodeWaveform(const float *values, unsigned int count,
+	unsigned char *encoded);
+
+// Decodes count values from the length bytes of an encoded frame.  Returns
+// false if the bytes are not a valid encoding of count values.
+bool DecodeWaveform(const unsigned char *encoded, size_t length,
+	float *values, unsigned int count);
+
+// Portable versions of the encoder and decoder, used where SSE2 is not
+// available, and by the benchmarks for comparison
+size_t EncodeWaveformScalar(const float *values, unsigned int count,
+	unsigned char *encoded);
+bool DecodeWaveformScalar(const unsigned char *encoded, size_t length,
+	float *values, unsigned int count);
+
+// True if EncodeWaveform and DecodeWaveform use SSE2
+bool IsWaveformCodecVectorized();
+
+#endif
@@ -0,0 +1,322 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include "WaveformJitterBuffer.h"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+WaveformJitterBuffer::WaveformJitterBuffer(const WaveformJitterConfig &config) :
+	_config(config),
+	_samplePeriod(0),
+	_blockSize(0),
+	_nextTransit(0),
+	_transitKnown(false),
+	_baseTransit(0),
+	_jitter(0),
+	_playing(false),
+	_position(0),
+	_delay(0),
+	_lastValue(numeric_limits<float>::quiet_NaN())
+{
+	if (_config.blockDuration <= 0 || _config.minimumDelay < 0 ||
+		_config.maximumDelay < _config.minimumDelay ||
+		_config.transitQuantile < 0.0 || _config.transitQuantile > 1.0 ||
+		_config.transitWindow == 0 || _config.maxConcealedGap < 0 ||
+		_config.maxFrames == 0)
+	{
+		stringstream errss;
+		errss << "WaveformJitterBuffer: the block duration, transit window "
+			<< "and frame count must be positive, the quantile between 0 "
+			<< "and 1, and the delays ordered";
+		throw errss.str();
+	}
+	memset(&_metrics, 0, sizeof(_metrics));
+}
+
+void WaveformJitterBuffer::Reset()
+{
+	_frames.clear();
+	_samplePeriod = 0;
+	_blockSize = 0;
+	_transits.clear();
+	_nextTransit = 0;
+	_transitKnown = false;
+	_baseTransit = 0;
+	_jitter = 0;
+	_playing = false;
+	_position = 0;
+	_delay = 0;
+	_lastValue = numeric_limits<float>::quiet_NaN();
+}
+
+// ----------------------------------------------------------------------------
+// Frames
+WaveformFrameResult WaveformJitterBuffer::AddFrame(int64_t sourceTime,
+	int64_t arrivalTime, const float *values, unsigned int count,
+	int64_t samplePeriod)
+{
+	if (count == 0 || samplePeriod <= 0)
+	{
+		return WAVEFORM_FRAME_INVALID;
+	}
+	_metrics.framesIn++;
+
+	if (samplePeriod != _samplePeriod)
+	{
+		if (_samplePeriod != 0)
+		{
+			Reset();
+			_metrics.resyncs++;
+		}
+		_samplePeriod = samplePeriod;
+		_blockSize = (unsigned int)((_config.blockDuration +
+			samplePeriod / 2) / samplePeriod);
+		if (_blockSize == 0)
+		{
+			_blockSize = 1;
+		}
+	}
+
+	UpdateTransit(arrivalTime - sourceTime);
+
+	if (_playing && sourceTime + (int64_t)count * samplePeriod <= _position)
+	{
+		_metrics.lateFrames++;
+		return WAVEFORM_FRAME_LATE;
+	}
+	if (_frames.find(sourceTime) != _frames.end())
+	{
+		_metrics.duplicateFrames++;
+		return WAVEFORM_FRAME_DUPLICATE;
+	}
+
+	_frames[sourceTime].values.assign(values, values + count);
+	while (_frames.size() > _config.maxFrames)
+	{
+		_frames.erase(_frames.begin());
+		_metrics.droppedFrames++;
+	}
+	return WAVEFORM_FRAME_QUEUED;
+}
+
+// ----------------------------------------------------------------------------
+// The base transit is the smallest transit of the window, and the jitter
+// how much later than it the quantile of the frames arrived.  A mean and
+// deviation of the transit are pulled up by the few frames of a stall, but
+// say little about the next stall, and play the usual frames later than
+// needed.  The window holds a few hundred frames, so sorting a copy of it
+// costs a few microseconds per frame.
+void WaveformJitterBuffer::UpdateTransit(int64_t transit)
+{
+	if (_transits.size() < _config.transitWindow)
+	{
+		_transits.push_back(transit);
+	} else
+	{
+		_transits[_nextTransit] = transit;
+		_nextTransit = (_nextTransit + 1) % _transits.size();
+	}
+
+	_sortedTransits = _transits;
+	size_t quantile = (size_t)(_config.transitQuantile *
+		(double)(_sortedTransits.size() - 1) + 0.5);
+	std::nth_element(_sortedTransits.begin(),
+		_sortedTransits.begin() + quantile, _sortedTransits.end());
+	int64_t quantileTransit = _sortedTransits[quantile];
+	_baseTransit = *std::min_element(_sortedTransits.begin(),
+		_sortedTransits.begin() + quantile + 1);
+	_jitter = quantileTransit - _baseTransit;
+	_transitKnown = true;
+}
+
+int64_t WaveformJitterBuffer::GetTargetDelay() const
+{
+	int64_t delay = _jitter;
+	if (delay < _config.minimumDelay)
+	{
+		return _config.minimumDelay;
+	}
+	if (delay > _config.maximumDelay)
+	{
+		return _config.maximumDelay;
+	}
+	return delay;
+}
+
+int64_t WaveformJitterBuffer::GetFrameEnd(FrameMap::const_iterator frame) const
+{
+	return frame->first + (int64_t)frame->second.values.size() * _samplePeriod;
+}
+
+// ----------------------------------------------------------------------------
+// The sample of a frame whose source time is closest to the time, if it is
+// within half a sample period, since the source times of frames are not
+// always exact multiples of the sample period apart.
+WaveformJitterBuffer::SampleState WaveformJitterBuffer::GetSample(int64_t time,
+	float &value) const
+{
+	FrameMap::const_iterator next = _frames.upper_bound(time);
+	FrameMap::const_iterator previous = next;
+	bool hasPrevious = next != _frames.begin();
+	if (hasPrevious)
+	{
+		--previous;
+		size_t index = (size_t)((time - previous->first + _samplePeriod / 2) /
+			_samplePeriod);
+		if (index < previous->second.values.size())
+		{
+			value = previous->second.values[index];
+			return SAMPLE_BUFFERED;
+		}
+	}
+
+	// The time is after the last frame, or in a gap between two frames
+	if (next == _frames.end())
+	{
+		return SAMPLE_NOT_ARRIVED;
+	}
+	if (!hasPrevious)
+	{
+		return SAMPLE_LOST;
+	}
+
+	const vector<float> &before = previous->second.values;
+	int64_t beforeTime = GetFrameEnd(previous) - _samplePeriod;
+	int64_t span = next->first - beforeTime;
+	if (span - _samplePeriod > _config.maxConcealedGap)
+	{
+		return SAMPLE_LOST;
+	}
+
+	float a = before[before.size() - 1];
+	float b = next->second.values[0];
+	value = a + (b - a) * (float)((double)(time - beforeTime) / (double)span);
+	return SAMPLE_CONCEALED;
+}
+
+// The last frame that was played is kept, to interpolate a gap after it
+void WaveformJitterBuffer::DropPlayedFrames()
+{
+	while (_frames.size() >= 2)
+	{
+		FrameMap::iterator second = _frames.begin();
+		++second;
+		if (GetFrameEnd(second) > _position)
+		{
+			break;
+		}
+		_frames.erase(_frames.begin());
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Playout
+unsigned int WaveformJitterBuffer::GetBlock(int64_t now,
+	vector<float> &values)
+{
+	values.clear();
+	if (!_transitKnown || _blockSize == 0)
+	{
+		return 0;
+	}
+
+	// Source time that should be played now.  A block hands out the
+	// samples of a block duration at once, so the delay is that of its last
+	// sample, which has to have arrived as well.
+	const int64_t span = (int64_t)_blockSize * _samplePeriod;
+	int64_t ideal = now - _baseTransit - GetTargetDelay() - span;
+	bool repeat = false;
+
+	if (!_playing)
+	{
+		if (_frames.empty() || ideal < _frames.begin()->first)
+		{
+			return 0;
+		}
+		int64_t first = _frames.begin()->first;
+		_position = first + (ideal - first + _samplePeriod / 2) /
+			_samplePeriod * _samplePeriod;
+		_playing = true;
+	} else
+	{
+		// Stay on the grid of sample times when moving the position
+		int64_t error = ideal - _position;
+		if (error > _config.maximumDelay || error < -_config.maximumDelay)
+		{
+			int64_t steps = error / _samplePeriod;
+			_position += steps * _samplePeriod;
+			_metrics.resyncs++;
+		} else if (error >= _samplePeriod)
+		{
+			_position += _samplePeriod;
+			_metrics.samplesSkipped++;
+		} else if (error <= -_samplePeriod)
+		{
+			repeat = true;
+		}
+	}
+	_delay = now - _baseTransit - _position - span;
+
+	values.resize(_blockSize, numeric_limits<float>::quiet_NaN());
+	unsigned int filled = 0;
+	if (repeat)
+	{
+		values[filled++] = _lastValue;
+		_metrics.samplesRepeated++;
+	}
+
+	while (filled < _blockSize)
+	{
+		float value = 0.0f;
+		SampleState state = GetSample(_position, value);
+		if (state == SAMPLE_NOT_ARRIVED)
+		{
+			// The rest of the block stays NaN, and the position waits for
+			// the data
+			_metrics.samplesMissing += _blockSize - filled;
+			_metrics.underruns++;
+			break;
+		}
+
+		if (state == SAMPLE_LOST)
+		{
+			value = numeric_limits<float>::quiet_NaN();
+			_metrics.samplesMissing++;
+		} else if (state == SAMPLE_CONCEALED)
+		{
+			_metrics.samplesConcealed++;
+		} else
+		{
+			_metrics.samplesPlayed++;
+		}
+		values[filled++] = value;
+		_lastValue = value;
+		_position += _samplePeriod;
+	}
+
+	DropPlayedFrames();
+	return _blockSize;
+}
+
+// ----------------------------------------------------------------------------
+// Metrics
+void WaveformJitterBuffer::GetMetrics(WaveformJitterMetrics &metrics) const
+{
+	metrics = _metrics;
+	metrics.targetDelay = _transitKnown ? GetTargetDelay() : 0;
+	metrics.delay = _delay;
+	metrics.jitter = _jitter;
+	metrics.bufferedFrames = (unsigned int)_frames.size();
+}
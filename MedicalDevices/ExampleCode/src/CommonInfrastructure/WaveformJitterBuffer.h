@@ -0,0 +1,244 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef WAVEFORM_JITTER_BUFFER_H
+#define WAVEFORM_JITTER_BUFFER_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+// ------------------------------------------------------------------------- //
+//
+// Waveform jitter buffer:
+// Turns the frames of one waveform stream (one device, metric and
+// instance), as they arrive from the network, into blocks of samples at a
+// fixed cadence for a renderer.  The StreamingData profile is best effort,
+// so frames can arrive late, out of order, twice, or not at all, and the
+// time between two arrivals varies.
+//
+// Frames are kept in order of source timestamp, which is the time of their
+// first sample.  Each sample of a frame is one sample period after the
+// previous one.
+//
+// Playout delay:
+// The transit of a frame is the time it arrived, on the local clock, minus
+// its source time, on the device's clock, so it includes the time the device
+// took to fill the frame, and the difference between the two clocks, which
+// is unknown but does not matter: the buffer keeps the transits of the last
+// frames, and plays each sample at its source time plus the smallest of
+// these transits (the base transit) plus a delay.  The delay is how much
+// later than the base transit the given quantile of the frames arrived, so
+// that share of the frames arrives before it is played, and is kept between
+// the minimum and maximum delay.  The delay rises with the first frames
+// that arrive later than usual, and only shrinks once they have left the
+// window, so a network that stalls now and then is waited for until it has
+// been calm for a window of frames.  With fixed delays, the base transit
+// still follows the clocks of the device and of the host as they drift.
+//
+// Playout:
+// Each call to GetBlock() hands out one block of samples, of the block
+// duration, starting where the previous block ended.  Samples that are in
+// the buffer are played as is.  A gap between two frames of at most the
+// largest concealed gap is filled by a straight line between the samples on
+// either side.  Longer gaps are played as NaN, which a renderer should draw
+// as a break in the trace.
+//
+// When the next sample has not arrived yet, the block is an underrun: the
+// rest of the block is NaN, and the playout position does not move, so the
+// playout waits for the late data instead of skipping it.  When the playout
+// position drifts from where the delay puts it, one sample per block is
+// skipped or repeated to catch up, which changes the speed of the trace by
+// less than a renderer shows.  A drift of more than the maximum delay
+// resynchronizes at once.
+//
+// Times are in nanoseconds.  The arrival times and the times passed to
+// GetBlock() are from a local clock that does not jump, such as
+// OSGetMonotonicTime().  The buffer is not thread safe.
+//
+// ------------------------------------------------------------------------- //
+
+// Settings of a jitter buffer
+struct WaveformJitterConfig
+{
+	WaveformJitterConfig() :
+		blockDuration(40000000LL),
+		minimumDelay(20000000LL),
+		maximumDelay(2000000000LL),
+		transitQuantile(0.98),
+		transitWindow(600),
+		maxConcealedGap(100000000LL),
+		maxFrames(256)
+	{
+	}
+
+	// Duration of the blocks handed out by GetBlock()
+	int64_t blockDuration;
+
+	// Bounds of the delay added to the base transit
+	int64_t minimumDelay;
+	int64_t maximumDelay;
+
+	// Share of the frames that should arrive before they are played, and
+	// the number of frames whose transit is kept to estimate it
+	double transitQuantile;
+	unsigned int transitWindow;
+
+	// Largest gap filled by interpolation
+	int64_t maxConcealedGap;
+
+	// Largest number of frames buffered.  The oldest frames are dropped
+	// beyond it.
+	unsigned int maxFrames;
+};
+
+// What happened to a frame passed to AddFrame()
+enum WaveformFrameResult
+{
+	WAVEFORM_FRAME_QUEUED,
+
+	// All of its samples were already played
+	WAVEFORM_FRAME_LATE,
+
+	// A frame with the same source time is already buffered
+	WAVEFORM_FRAME_DUPLICATE,
+
+	// No values, or no sample period
+	WAVEFORM_FRAME_INVALID
+};
+
+// Counters of a jitter buffer
+struct WaveformJitterMetrics
+{
+	uint64_t framesIn;
+	uint64_t lateFrames;
+	uint64_t duplicateFrames;
+	uint64_t droppedFrames;
+
+	// Samples handed out from frames, filled by interpolation, and played
+	// as NaN
+	uint64_t samplesPlayed;
+	uint64_t samplesConcealed;
+	uint64_t samplesMissing;
+
+	// Blocks that ran out of data, jumps to the playout position, and
+	// samples skipped or repeated to follow the delay
+	uint64_t underruns;
+	uint64_t resyncs;
+	uint64_t samplesSkipped;
+	uint64_t samplesRepeated;
+
+	// Delay added to the base transit, that the playout follows, and the
+	// delay of the last block played.  The jitter is how much later than
+	// the base transit the quantile of the frames arrived.
+	int64_t targetDelay;
+	int64_t delay;
+	int64_t jitter;
+
+	unsigned int bufferedFrames;
+};
+
+class WaveformJitterBuffer
+{
+public:
+	// --- Constructor ---
+	// Throws a std::string if the settings are not valid
+	WaveformJitterBuffer(const WaveformJitterConfig &config);
+
+	// --- Frames ---
+	// Adds a frame that arrived at a local time.  Late frames are not kept,
+	// but their transit is still used to adapt the delay.  A frame with
+	// another sample period than the previous frames restarts the playout.
+	WaveformFrameResult AddFrame(int64_t sourceTime, int64_t arrivalTime,
+		const float *values, unsigned int count, int64_t samplePeriod);
+
+	// --- Playout ---
+	// Fills the values with the next block of samples, due at local time
+	// now, and returns their number.  Returns 0 until a frame is due.  The
+	// renderer should call it once per block duration.
+	unsigned int GetBlock(int64_t now, std::vector<float> &values);
+
+	// Number of samples in a block, 0 until the sample period is known
+	unsigned int GetBlockSize() const
+	{
+		return _blockSize;
+	}
+
+	// --- Metrics ---
+	// Delay of the last block played, beyond the base transit
+	int64_t GetDelay() const
+	{
+		return _delay;
+	}
+
+	uint64_t GetUnderrunCount() const
+	{
+		return _metrics.underruns;
+	}
+
+	void GetMetrics(WaveformJitterMetrics &metrics) const;
+
+	// --- Reset ---
+	// Drops the frames and the transit estimates, keeping the counters
+	void Reset();
+
+private:
+	// --- Private types ---
+	struct Frame
+	{
+		std::vector<float> values;
+	};
+	typedef std::map<int64_t, Frame> FrameMap;
+
+	// What the buffer has for the source time of a sample
+	enum SampleState
+	{
+		SAMPLE_BUFFERED,
+		SAMPLE_CONCEALED,
+		SAMPLE_LOST,
+		SAMPLE_NOT_ARRIVED
+	};
+
+	// --- Private methods ---
+	void UpdateTransit(int64_t transit);
+	int64_t GetTargetDelay() const;
+	int64_t GetFrameEnd(FrameMap::const_iterator frame) const;
+	SampleState GetSample(int64_t time, float &value) const;
+	void DropPlayedFrames();
+
+	// --- Private members ---
+	WaveformJitterConfig _config;
+	int64_t _samplePeriod;
+	unsigned int _blockSize;
+
+	// Frames by source time
+	FrameMap _frames;
+
+	// Transits of the last frames, oldest first from _nextTransit once the
+	// window is full, and the estimates made from them
+	std::vector<int64_t> _transits;
+	size_t _nextTransit;
+	std::vector<int64_t> _sortedTransits;
+	bool _transitKnown;
+	int64_t _baseTransit;
+	int64_t _jitter;
+
+	// Source time of the next sample to play
+	bool _playing;
+	int64_t _position;
+	int64_t _delay;
+
+	// Last value played, repeated when the playout slows down
+	float _lastValue;
+
+	WaveformJitterMetrics _metrics;
+};
+
+#endif
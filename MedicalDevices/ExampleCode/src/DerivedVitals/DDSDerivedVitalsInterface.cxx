@@ -0,0 +1,376 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include "DDSDerivedVitalsInterface.h"
+#include "../CommonInfrastructure/DDSLoanedBatch.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+// Largest number of samples taken from a DataReader at a time
+static const unsigned int STREAMING_BATCH_SAMPLES = 64;
+
+// Bound of the identifiers in ice.idl
+static const size_t IDENTIFIER_BOUND = 64;
+
+static int64_t ToNanoseconds(const DDS_Time_t &time)
+{
+	return (int64_t)time.sec * 1000000000LL + time.nanosec;
+}
+
+static DDS_Time_t ToTime(int64_t nanoseconds)
+{
+	DDS_Time_t time;
+	time.sec = (DDS_Long)(nanoseconds / 1000000000LL);
+	time.nanosec = (DDS_UnsignedLong)(nanoseconds % 1000000000LL);
+	return time;
+}
+
+static void CopyIdentifier(char *destination, const std::string &source)
+{
+	strncpy(destination, source.c_str(), IDENTIFIER_BOUND);
+	destination[IDENTIFIER_BOUND] = '\0';
+}
+
+// ----------------------------------------------------------------------------
+// Numeric sink.  A failed write does not stop the rest of the batch, but is
+// reported to the pipeline, which counts it as an error of the sink.
+void DDSNumericSink::Consume(PipelineBatch &samples)
+{
+	unsigned int failed = 0;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const PipelineSample &sample = samples[i];
+		CopyIdentifier(_sample.unique_device_identifier, sample.deviceId);
+		CopyIdentifier(_sample.metric_id, sample.metricId);
+		_sample.instance_id = sample.instanceId;
+		_sample.value = sample.value;
+
+		if (_writer->write_w_timestamp(_sample, DDS_HANDLE_NIL,
+			ToTime(sample.timestamp)) != DDS_RETCODE_OK)
+		{
+			failed++;
+		}
+	}
+
+	if (failed > 0)
+	{
+		std::stringstream errss;
+		errss << "Failure to write " << failed << " derived Numerics";
+		throw errss.str();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// The DDSDerivedVitalsInterface is the network interface to the derived
+// vitals application.  This creates DataReaders to receive device data and
+// patient-device mappings, and a DataWriter to send the derived numerics.
+//
+// The device data is sent on domain 5, the same domain used by the device
+// data replay.
+// ------------------------------------------------------------------------- //
+
+DDSDerivedVitalsInterface::DDSDerivedVitalsInterface(bool multicastAvailable)
+{
+	memset(&_statistics, 0, sizeof(_statistics));
+
+	_communicator = new DDSCommunicator();
+
+	std::vector<std::string> xmlFiles;
+
+	// Adding the XML files that contain profiles used by this application
+	xmlFiles.push_back(
+		"file://../../../src/Config/qos_profiles.xml");
+
+	// Configuring this application for multicast or no multicast.  Note that
+	// if you have no multicast, you will have to edit the XML QoS
+	// configuration to add the IP addresses of applications you want to
+	// discover and communicate with.
+	std::string participantProfile;
+	if (multicastAvailable)
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT;
+	} else
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
+	}
+
+	if (NULL == _communicator->CreateParticipant(5, xmlFiles,
+				ICE_QOS_LIBRARY, participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	// The Subscriber has the default QoS, so its DataReaders match the
+	// DataWriters of the devices.  The mappings are read on a coherent
+	// Subscriber of their own (see DDSPatientTransfer.h).
+	DDS::Publisher *pub = _communicator->CreatePublisher();
+	DDS::Subscriber *sub = _communicator->CreateSubscriber();
+	if (pub == NULL || sub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Publisher or Subscriber object";
+		throw errss.str();
+	}
+
+	// This application processes the whole unit, so it receives the device
+	// data of every patient group, and the default partition
+	// (see DDSPatientRouting.h)
+	SubscribeToAllPatientGroups(sub);
+
+	DDS::Topic *numericTopic = _communicator->CreateTopic<ice::Numeric>(
+		ice::NumericTopic);
+	DDS::Topic *sampleArrayTopic =
+		_communicator->CreateTopic<ice::SampleArray>(ice::SampleArrayTopic);
+	DDS::Topic *mappingTopic =
+		_communicator->CreateTopic<DevicePatientMapping>(
+			DevicePatientMappingTopic);
+
+	// The device data uses the same streaming profile as the other
+	// applications that read device data
+	DDS::DataReader *reader = sub->create_datareader_with_profile(
+		numericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING,
+		NULL, DDS_STATUS_MASK_NONE);
+	_numericReader = ice::NumericDataReader::narrow(reader);
+	if (_numericReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create Numeric reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	reader = sub->create_datareader_with_profile(
+		sampleArrayTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING,
+		NULL, DDS_STATUS_MASK_NONE);
+	_sampleArrayReader = ice::SampleArrayDataReader::narrow(reader);
+	if (_sampleArrayReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create SampleArray reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	_mappingReader = new DDSPatientMappingReader(
+		_communicator->GetParticipant(), mappingTopic,
+		ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES);
+
+	// The derived values are streaming data like the values they come from
+	DDS::DataWriter *writer = pub->create_datawriter_with_profile(
+		numericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING,
+		NULL, DDS_STATUS_MASK_NONE);
+	_numericWriter = ice::NumericDataWriter::narrow(writer);
+	if (_numericWriter == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create Numeric writer. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	// Create ReadConditions that trigger when there is any data in the
+	// DataReaders' queues, and attach them to a single WaitSet
+	_numericCondition = _numericReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_sampleArrayCondition = _sampleArrayReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+
+	_waitSet = new DDS::WaitSet();
+	_waitSet->attach_condition(_numericCondition);
+	_waitSet->attach_condition(_sampleArrayCondition);
+	_waitSet->attach_condition(_mappingReader->GetCondition());
+}
+
+// ----------------------------------------------------------------------------
+// Destructor.
+// Deletes the WaitSet, the DataReaders, the DataWriter, and the Communicator
+// object
+DDSDerivedVitalsInterface::~DDSDerivedVitalsInterface()
+{
+	_waitSet->detach_condition(_numericCondition);
+	_waitSet->detach_condition(_sampleArrayCondition);
+	_waitSet->detach_condition(_mappingReader->GetCondition());
+	delete _waitSet;
+
+	_numericReader->delete_readcondition(_numericCondition);
+	_sampleArrayReader->delete_readcondition(_sampleArrayCondition);
+
+	DDS::Subscriber *sub = _numericReader->get_subscriber();
+	sub->delete_datareader(_numericReader);
+	sub->delete_datareader(_sampleArrayReader);
+	delete _mappingReader;
+
+	_numericWriter->get_publisher()->delete_datawriter(_numericWriter);
+
+	delete _communicator;
+}
+
+DDSNumericSink *DDSDerivedVitalsInterface::CreateNumericSink(
+	const std::string &name, unsigned int queueCapacity)
+{
+	return new DDSNumericSink(name, queueCapacity, _numericWriter);
+}
+
+// ----------------------------------------------------------------------------
+// Waits for data.  Mappings are applied first, so the samples that arrive
+// together with a new mapping are joined with that mapping.
+unsigned long DDSDerivedVitalsInterface::ReadAvailableData(
+	PipelineSource &source, PatientMappingListener &mappings,
+	const DDS_Duration_t &timeout)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode == DDS_RETCODE_TIMEOUT)
+	{
+		return 0;
+	}
+	if (retcode != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure waiting for device data";
+		throw errss.str();
+	}
+
+	_mappingReader->ProcessChanges(mappings);
+
+	int64_t fullTimeout =
+		(int64_t)timeout.sec * 1000000000LL + timeout.nanosec;
+	unsigned long offered = 0;
+	for (int i = 0; i < activeConditions.length(); i++)
+	{
+		if (activeConditions[i] == _numericCondition)
+		{
+			offered += OfferNumerics(source, fullTimeout);
+		}
+		else if (activeConditions[i] == _sampleArrayCondition)
+		{
+			offered += OfferSampleArrays(source, fullTimeout);
+		}
+	}
+	return offered;
+}
+
+// ----------------------------------------------------------------------------
+// Takes no more samples than the source has room for.  If the source stays
+// full for the timeout, the samples left are taken on a later call.
+unsigned long DDSDerivedVitalsInterface::OfferNumerics(
+	PipelineSource &source, int64_t fullTimeout)
+{
+	LoanedBatch<ice::Numeric> batch;
+	unsigned long offered = 0;
+	while (1)
+	{
+		unsigned int room = source.GetFreeCapacity();
+		if (room == 0)
+		{
+			_statistics.sourceFullCount++;
+			if (!source.WaitForCapacity(fullTimeout))
+			{
+				break;
+			}
+			continue;
+		}
+		if (room > STREAMING_BATCH_SAMPLES)
+		{
+			room = STREAMING_BATCH_SAMPLES;
+		}
+		if (!batch.TakeNext(_numericReader, _numericCondition, room))
+		{
+			break;
+		}
+
+		_batch.resize(batch.GetLength());
+		size_t count = 0;
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			if (!batch.IsValid(i))
+			{
+				continue;
+			}
+			const ice::Numeric &numeric = batch.GetData(i);
+			PipelineSample &sample = _batch[count++];
+			sample.deviceId = numeric.unique_device_identifier;
+			sample.metricId = numeric.metric_id;
+			sample.instanceId = numeric.instance_id;
+			sample.patientId = PipelineSample::NO_PATIENT;
+			sample.timestamp =
+				ToNanoseconds(batch.GetInfo(i).source_timestamp);
+			sample.value = numeric.value;
+			sample.values.clear();
+			sample.samplePeriod = 0;
+		}
+		batch.Return();
+
+		_batch.resize(count);
+		offered += source.Offer(_batch);
+	}
+	_statistics.numericsIn += offered;
+	return offered;
+}
+
+unsigned long DDSDerivedVitalsInterface::OfferSampleArrays(
+	PipelineSource &source, int64_t fullTimeout)
+{
+	LoanedBatch<ice::SampleArray> batch;
+	unsigned long offered = 0;
+	while (1)
+	{
+		unsigned int room = source.GetFreeCapacity();
+		if (room == 0)
+		{
+			_statistics.sourceFullCount++;
+			if (!source.WaitForCapacity(fullTimeout))
+			{
+				break;
+			}
+			continue;
+		}
+		if (room > STREAMING_BATCH_SAMPLES)
+		{
+			room = STREAMING_BATCH_SAMPLES;
+		}
+		if (!batch.TakeNext(_sampleArrayReader, _sampleArrayCondition, room))
+		{
+			break;
+		}
+
+		_batch.resize(batch.GetLength());
+		size_t count = 0;
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const ice::SampleArray &frame = batch.GetData(i);
+			if (!batch.IsValid(i) || frame.millisecondsPerSample <= 0)
+			{
+				continue;
+			}
+			PipelineSample &sample = _batch[count++];
+			sample.deviceId = frame.unique_device_identifier;
+			sample.metricId = frame.metric_id;
+			sample.instanceId = frame.instance_id;
+			sample.patientId = PipelineSample::NO_PATIENT;
+			sample.timestamp =
+				ToNanoseconds(batch.GetInfo(i).source_timestamp);
+			sample.value = 0.0f;
+			sample.values.assign(frame.values.get_contiguous_buffer(),
+				frame.values.get_contiguous_buffer() + frame.values.length());
+			sample.samplePeriod =
+				(int64_t)frame.millisecondsPerSample * 1000000LL;
+		}
+		batch.Return();
+
+		_batch.resize(count);
+		offered += source.Offer(_batch);
+	}
+	_statistics.framesIn += offered;
+	return offered;
+}
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_DERIVED_VITALS_INTERFACE_H
+#define DDS_DERIVED_VITALS_INTERFACE_H
+
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
+#include "../CommonInfrastructure/StreamPipeline.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// The derived vitals interface feeds a StreamPipeline from DDS, and sends
+// what comes out of it back on DDS.
+//
+// Reading:
+// --------
+// ice::Numeric and ice::SampleArray data is read with the StreamingData QoS
+// profile, converted to PipelineSamples with the source timestamp of each
+// sample, and offered to a PipelineSource.  Only as many samples as the
+// source has room for are taken from the DataReaders at a time.  When the
+// pipeline falls behind, the rest stays in the DataReaders' queues, and
+// their resource limits and the reliability protocol push back on the
+// devices, instead of the application buffering without bound.
+//
+// The patient-device mappings are read on a Subscriber with the
+// PatientTransfer profile, so a transfer is applied at once.
+//
+// Writing:
+// --------
+// The derived values are written as ice::Numeric samples by a
+// DDSNumericSink, the last operator of the pipeline, with the source
+// timestamp of the value they were derived from.  Applications that
+// display numerics show them without knowing they are derived.
+//
+// ----------------------------------------------------------------------------
+
+// Samples read since the application started
+struct DerivedVitalsStatistics
+{
+	uint64_t numericsIn;
+	uint64_t framesIn;
+
+	// Times the pipeline source was full when data was available
+	uint64_t sourceFullCount;
+};
+
+// ------------------------------------------------------------------------- //
+// Writes every sample that reaches it as an ice::Numeric.  Runs on the
+// threads of the pipeline.
+class DDSNumericSink : public PipelineSink
+{
+public:
+	DDSNumericSink(const std::string &name, unsigned int queueCapacity,
+		ice::NumericDataWriter *writer) :
+		PipelineSink(name, queueCapacity),
+		_writer(writer)
+	{
+	}
+
+protected:
+	virtual void Consume(PipelineBatch &samples);
+
+private:
+	ice::NumericDataWriter *_writer;
+
+	// Reused for every sample, so writing does not allocate
+	DdsAutoType<ice::Numeric> _sample;
+};
+
+class DDSDerivedVitalsInterface
+{
+
+public:
+
+	// --- Constructor ---
+	// Creates the DomainParticipant, the DataReaders of the device data and
+	// of the patient-device mappings, and the DataWriter of the derived
+	// values.  Throws a std::string if any of them cannot be created.
+	DDSDerivedVitalsInterface(bool multicastAvailable);
+
+	// --- Destructor ---
+	// Any sink created by this interface must be deleted first
+	~DDSDerivedVitalsInterface();
+
+	// --- Getter for Communicator ---
+	DDSCommunicator *GetCommunicator()
+	{
+		return _communicator;
+	}
+
+	// --- Pipeline sink ---
+	// Creates a sink that writes to the Numeric DataWriter of this interface,
+	// to be added to a pipeline
+	DDSNumericSink *CreateNumericSink(const std::string &name,
+		unsigned int queueCapacity);
+
+	// --- Reading data ---
+	// Waits up to the timeout for data, passes the mapping changes to the
+	// listener, and offers the device data to the source.  While the source
+	// is full, waits up to the timeout for it to have room.  Returns the
+	// number of device samples offered.
+	unsigned long ReadAvailableData(PipelineSource &source,
+		PatientMappingListener &mappings, const DDS_Duration_t &timeout);
+
+	// --- Statistics ---
+	const DerivedVitalsStatistics &GetStatistics() const
+	{
+		return _statistics;
+	}
+
+private:
+	// --- Private methods ---
+	unsigned long OfferNumerics(PipelineSource &source,
+		int64_t fullTimeout);
+	unsigned long OfferSampleArrays(PipelineSource &source,
+		int64_t fullTimeout);
+
+	// --- Private members ---
+
+	// Used to create basic DDS entities that all applications need
+	DDSCommunicator *_communicator;
+
+	ice::NumericDataReader *_numericReader;
+	ice::SampleArrayDataReader *_sampleArrayReader;
+	DDSPatientMappingReader *_mappingReader;
+	ice::NumericDataWriter *_numericWriter;
+
+	DDS::ReadCondition *_numericCondition;
+	DDS::ReadCondition *_sampleArrayCondition;
+	DDS::WaitSet *_waitSet;
+
+	// Converted samples, reused between calls
+	PipelineBatch _batch;
+
+	DerivedVitalsStatistics _statistics;
+};
+
+#endif
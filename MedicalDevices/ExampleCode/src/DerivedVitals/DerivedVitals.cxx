@@ -0,0 +1,279 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "DDSDerivedVitalsInterface.h"
+#include "VitalsOperators.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This application computes derived vitals from the device data, and sends
+// them back as ice::Numeric samples with their own metric IDs:
+//
+//  - DERIVED_PULSE_RATE: a pulse rate, from the peaks of a waveform (the
+//    plethysmogram by default, or an ECG lead with --waveform-metric).
+//  - DERIVED_SPO2_MEAN: the mean SpO2 of each device over a sliding window.
+//  - DERIVED_SHOCK_INDEX: the derived pulse rate divided by the systolic
+//    blood pressure, for each patient whose devices send both.
+//
+// The values are computed by a StreamPipeline:
+//
+//   source -+-> pulse rate ------+------------------> sink
+//           |                    v                   ^  ^
+//           +-> systolic filter --> shock index -----/  |
+//           +-> SpO2 window ----------------------------/
+//
+// The metrics of each operator are printed every ten seconds.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+// Capacity of the queue of each operator, and largest batch
+static const unsigned int QUEUE_CAPACITY = 1024;
+static const unsigned int MAX_BATCH = 64;
+
+// A shock index is only computed from values at most this far apart
+static const int64_t SHOCK_INDEX_MAX_SKEW = 600LL * NANOSECONDS_PER_SECOND;
+
+static double PerSecond(uint64_t count, long seconds)
+{
+	return seconds <= 0 ? 0.0 : (double)count / (double)seconds;
+}
+
+static void PrintMetrics(const vector<PipelineOperatorMetrics> &current,
+	const vector<PipelineOperatorMetrics> &last, long seconds)
+{
+	for (size_t i = 0; i < current.size(); i++)
+	{
+		const PipelineOperatorMetrics &now = current[i];
+		PipelineOperatorMetrics before = now;
+		if (i < last.size())
+		{
+			before = last[i];
+		}
+		uint64_t samplesIn = now.samplesIn - before.samplesIn;
+
+		cout << "  " << now.name << ": "
+			<< PerSecond(samplesIn, seconds) << " in/s, "
+			<< PerSecond(now.samplesOut - before.samplesOut, seconds)
+			<< " out/s, queue " << now.queueLength << " (peak "
+			<< now.peakQueueLength << " of " << now.queueCapacity << ")";
+		if (samplesIn > 0)
+		{
+			cout << ", waited "
+				<< (double)(now.totalQueueLatency - before.totalQueueLatency) /
+					(double)samplesIn / 1000.0 << " us avg";
+		}
+		cout << ", busy " << (double)(now.busyTime - before.busyTime) /
+			1000000.0 / (double)seconds << " ms/s";
+		if (now.heldBackCount != before.heldBackCount)
+		{
+			cout << ", held back " << now.heldBackCount - before.heldBackCount;
+		}
+		if (now.refusedCount != before.refusedCount)
+		{
+			cout << ", refused " << now.refusedCount - before.refusedCount;
+		}
+		if (now.errorCount != before.errorCount)
+		{
+			cout << ", errors " << now.errorCount - before.errorCount;
+		}
+		if (now.maxEndToEndLatency > 0 && samplesIn > 0)
+		{
+			cout << ", end to end "
+				<< (double)(now.totalEndToEndLatency -
+					before.totalEndToEndLatency) / (double)samplesIn / 1000.0
+				<< " us avg, " << now.maxEndToEndLatency / 1000 << " us max";
+		}
+		cout << endl;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	bool multicastAvailable = true;
+	long threadCount = 2;
+	long windowSeconds = 10;
+	string waveformMetric = "MDC_PULS_OXIM_PLETH";
+	string spo2Metric = "MDC_PULS_OXIM_SAT_O2";
+	string systolicMetric = "MDC_PRESS_BLD_NONINV_SYS";
+
+	// Process the command-line arguments
+	for (int i = 0; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-multicast"))
+		{
+			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--threads") && i + 1 < argc)
+		{
+			threadCount = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--window-seconds") && i + 1 < argc)
+		{
+			windowSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--waveform-metric") && i + 1 < argc)
+		{
+			waveformMetric = argv[++i];
+		} else if (0 == strcmp(argv[i], "--spo2-metric") && i + 1 < argc)
+		{
+			spo2Metric = argv[++i];
+		} else if (0 == strcmp(argv[i], "--systolic-metric") && i + 1 < argc)
+		{
+			systolicMetric = argv[++i];
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else if (i > 0)
+		{
+			// If we have a parameter that is not the first one, and is not
+			// recognized, return an error.
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	if (threadCount <= 0 || windowSeconds <= 0)
+	{
+		cout << "The thread count and the window must be positive" << endl;
+		return -1;
+	}
+
+	try
+	{
+		PatientDirectory patients;
+
+		// --------------------------------------------------------------------
+		// This is the network interface for this application - it reads
+		// the device data into the pipeline, and writes what comes out of
+		// it.  It is created before the pipeline, so the pipeline and its
+		// sink are deleted first.
+		DDSDerivedVitalsInterface vitalsInterface(multicastAvailable);
+
+		StreamPipeline pipeline((unsigned int)threadCount, MAX_BATCH);
+		PipelineSource *source = pipeline.Add(
+			new PipelineSource("source", QUEUE_CAPACITY));
+		PulseRateDetector *pulseRate = pipeline.Add(
+			new PulseRateDetector("pulse rate", QUEUE_CAPACITY,
+				waveformMetric));
+		PipelineWindow *spo2Window = pipeline.Add(
+			new PipelineWindow("SpO2 window", QUEUE_CAPACITY, spo2Metric,
+				DERIVED_SPO2_MEAN, windowSeconds * NANOSECONDS_PER_SECOND,
+				PIPELINE_MEAN));
+		MetricFilter *systolic = pipeline.Add(
+			new MetricFilter("systolic filter", QUEUE_CAPACITY,
+				systolicMetric));
+		ShockIndexJoin *shockIndex = pipeline.Add(
+			new ShockIndexJoin("shock index", QUEUE_CAPACITY,
+				DERIVED_PULSE_RATE, systolicMetric, SHOCK_INDEX_MAX_SKEW,
+				&patients));
+		DDSNumericSink *sink = pipeline.Add(
+			vitalsInterface.CreateNumericSink("sink", QUEUE_CAPACITY));
+
+		pipeline.Connect(source, pulseRate);
+		pipeline.Connect(source, spo2Window);
+		pipeline.Connect(source, systolic);
+		pipeline.Connect(pulseRate, sink);
+		pipeline.Connect(pulseRate, shockIndex);
+		pipeline.Connect(systolic, shockIndex);
+		pipeline.Connect(spo2Window, sink);
+		pipeline.Connect(shockIndex, sink);
+		pipeline.Start();
+
+		cout << "Deriving vitals on " << threadCount << " threads from "
+			<< waveformMetric << ", " << spo2Metric << " and "
+			<< systolicMetric << endl;
+
+		DDS_Duration_t waitTime = {0, 100000000};
+		DDS_Time_t lastReport = {0, 0};
+		vector<PipelineOperatorMetrics> lastMetrics;
+		vector<PipelineOperatorMetrics> metrics;
+		DerivedVitalsStatistics last = vitalsInterface.GetStatistics();
+
+		while (1)
+		{
+			vitalsInterface.ReadAvailableData(*source, patients, waitTime);
+
+			DDS_Time_t now;
+			vitalsInterface.GetCommunicator()->GetParticipant()->
+				get_current_time(now);
+
+			// Once every ten seconds, report the metrics of the pipeline
+			if (now.sec - lastReport.sec >= 10)
+			{
+				pipeline.GetMetrics(metrics);
+				const DerivedVitalsStatistics &current =
+					vitalsInterface.GetStatistics();
+				if (lastReport.sec != 0)
+				{
+					long seconds = now.sec - lastReport.sec;
+					cout << "In: " << PerSecond(current.numericsIn -
+							last.numericsIn, seconds) << " Numerics/s, "
+						<< PerSecond(current.framesIn - last.framesIn,
+							seconds) << " SampleArrays/s, source full "
+						<< current.sourceFullCount - last.sourceFullCount
+						<< " times" << endl;
+					PrintMetrics(metrics, lastMetrics, seconds);
+				}
+				lastReport = now;
+				lastMetrics = metrics;
+				last = current;
+			}
+		}
+	}
+	catch (string message)
+	{
+		cout << "Application exception: " << message << endl;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --no-multicast" <<
+		"                 Do not use multicast " <<
+		"(note you must edit XML" << endl <<
+		"                                   " <<
+		"config to include IP addresses)"
+		<< endl;
+	cout <<
+		"    --threads <n>" <<
+		"                  Threads running the pipeline (default: 2)"
+		<< endl;
+	cout <<
+		"    --window-seconds <n>" <<
+		"           Duration of the SpO2 window (default: 10)"
+		<< endl;
+	cout <<
+		"    --waveform-metric <id>" <<
+		"         Waveform the pulse rate is derived from" <<
+		endl << "                                   " <<
+		"(default: MDC_PULS_OXIM_PLETH)"
+		<< endl;
+	cout <<
+		"    --spo2-metric <id>" <<
+		"             SpO2 numeric (default: MDC_PULS_OXIM_SAT_O2)"
+		<< endl;
+	cout <<
+		"    --systolic-metric <id>" <<
+		"         Systolic blood pressure numeric" <<
+		endl << "                                   " <<
+		"(default: MDC_PRESS_BLD_NONINV_SYS)"
+		<< endl;
+}
@@ -0,0 +1,254 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include "VitalsOperators.h"
+
+using namespace std;
+
+const char *DERIVED_PULSE_RATE = "DERIVED_PULSE_RATE";
+const char *DERIVED_SPO2_MEAN = "DERIVED_SPO2_MEAN";
+const char *DERIVED_SHOCK_INDEX = "DERIVED_SHOCK_INDEX";
+const char *DERIVED_PATIENT_DEVICE_PREFIX = "DERIVED_PATIENT_";
+
+// Beats closer together than this are one beat, which limits the rate to
+// 240 beats per minute
+static const int64_t REFRACTORY_PERIOD = 250000000LL;
+
+// Intervals longer than this (a rate under 20 beats per minute) are gaps in
+// the signal, not beats
+static const int64_t MAX_BEAT_INTERVAL = 3000000000LL;
+
+// Time constant of the decay of the minimum and maximum
+static const double ENVELOPE_DECAY_TIME = 2000000000.0;
+
+// Streams that send nothing for this long are forgotten
+static const int64_t IDLE_STREAM_TIMEOUT = 60000000000LL;
+
+// ----------------------------------------------------------------------------
+// Pulse rate
+PulseRateDetector::PulseRateDetector(const string &name,
+	unsigned int queueCapacity, const string &waveformMetricId) :
+	PipelineMap(name, queueCapacity),
+	_waveformMetricId(waveformMetricId),
+	_lastDiscard(0)
+{
+}
+
+bool PulseRateDetector::Map(PipelineSample &sample)
+{
+	if (sample.metricId != _waveformMetricId || !sample.IsFrame() ||
+		sample.values.empty())
+	{
+		return false;
+	}
+
+	char instance[16];
+	sprintf(instance, "%d", sample.instanceId);
+	_key.assign(sample.deviceId);
+	_key += '|';
+	_key += instance;
+
+	map<string, StreamState>::iterator it = _streams.find(_key);
+	if (it == _streams.end())
+	{
+		StreamState empty;
+		empty.minimum = sample.values[0];
+		empty.maximum = sample.values[0];
+		empty.above = false;
+		empty.lastBeat = 0;
+		empty.lastTime = 0;
+		empty.intervalCount = 0;
+		empty.nextInterval = 0;
+		it = _streams.insert(make_pair(_key, empty)).first;
+	}
+	StreamState &state = it->second;
+
+	float decay = (float)((double)sample.samplePeriod / ENVELOPE_DECAY_TIME);
+	if (decay > 1.0f)
+	{
+		decay = 1.0f;
+	}
+
+	int64_t time = sample.timestamp;
+	for (size_t i = 0; i < sample.values.size();
+		i++, time += sample.samplePeriod)
+	{
+		// Frames that overlap the previous one are only used from where the
+		// previous one ended
+		if (time <= state.lastTime)
+		{
+			continue;
+		}
+		state.lastTime = time;
+
+		float value = sample.values[i];
+		state.minimum = value < state.minimum ? value :
+			state.minimum + (value - state.minimum) * decay;
+		state.maximum = value > state.maximum ? value :
+			state.maximum + (value - state.maximum) * decay;
+
+		// A beat must rise above 60% of the range, and fall back under 40%
+		// before the next one
+		float range = state.maximum - state.minimum;
+		if (range <= 0.0f)
+		{
+			continue;
+		}
+		if (state.above)
+		{
+			state.above = value > state.minimum + 0.4f * range;
+			continue;
+		}
+		if (value < state.minimum + 0.6f * range)
+		{
+			continue;
+		}
+		state.above = true;
+
+		int64_t interval = time - state.lastBeat;
+		if (state.lastBeat != 0 && interval < REFRACTORY_PERIOD)
+		{
+			continue;
+		}
+		if (state.lastBeat != 0 && interval <= MAX_BEAT_INTERVAL)
+		{
+			state.intervals[state.nextInterval] = interval;
+			state.nextInterval = (state.nextInterval + 1) % INTERVAL_COUNT;
+			if (state.intervalCount < INTERVAL_COUNT)
+			{
+				state.intervalCount++;
+			}
+		}
+		state.lastBeat = time;
+	}
+
+	// A stream that lost its beats for longer than the longest interval has
+	// no rate until it has beats again
+	if (state.lastTime - state.lastBeat > MAX_BEAT_INTERVAL)
+	{
+		state.intervalCount = 0;
+		state.nextInterval = 0;
+	}
+
+	int64_t lastTime = state.lastTime;
+	unsigned int intervalCount = state.intervalCount;
+	int64_t total = 0;
+	for (unsigned int i = 0; i < intervalCount; i++)
+	{
+		total += state.intervals[i];
+	}
+	DiscardIdle(lastTime);
+	if (intervalCount == 0)
+	{
+		return false;
+	}
+
+	sample.metricId = DERIVED_PULSE_RATE;
+	sample.timestamp = lastTime;
+	sample.value = (float)(60.0e9 * intervalCount / (double)total);
+	sample.values.clear();
+	sample.samplePeriod = 0;
+	return true;
+}
+
+void PulseRateDetector::DiscardIdle(int64_t now)
+{
+	if (now - _lastDiscard < IDLE_STREAM_TIMEOUT)
+	{
+		return;
+	}
+	_lastDiscard = now;
+
+	map<string, StreamState>::iterator it = _streams.begin();
+	while (it != _streams.end())
+	{
+		if (now - it->second.lastTime > IDLE_STREAM_TIMEOUT)
+		{
+			_streams.erase(it++);
+		} else
+		{
+			++it;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Shock index
+ShockIndexJoin::ShockIndexJoin(const string &name,
+	unsigned int queueCapacity, const string &heartRateMetricId,
+	const string &systolicMetricId, int64_t maxSkew,
+	PipelinePatientResolver *resolver) :
+	PipelinePatientJoin(name, queueCapacity,
+		MetricIds(heartRateMetricId, systolicMetricId), maxSkew, resolver)
+{
+}
+
+vector<string> ShockIndexJoin::MetricIds(const string &heartRateMetricId,
+	const string &systolicMetricId)
+{
+	vector<string> metricIds;
+	metricIds.push_back(heartRateMetricId);
+	metricIds.push_back(systolicMetricId);
+	return metricIds;
+}
+
+// The shock index belongs to the patient rather than to either device, so
+// it is sent with a device ID made from the patient ID
+bool ShockIndexJoin::Combine(int patientId,
+	const vector<const PipelineSample *> &latest, PipelineSample &output)
+{
+	float heartRate = latest[0]->value;
+	float systolic = latest[1]->value;
+	if (systolic <= 0.0f || heartRate < 0.0f)
+	{
+		return false;
+	}
+
+	char device[64];
+	sprintf(device, "%s%d", DERIVED_PATIENT_DEVICE_PREFIX, patientId);
+	output.deviceId = device;
+	output.metricId = DERIVED_SHOCK_INDEX;
+	output.instanceId = 0;
+	output.value = heartRate / systolic;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// Patient directory
+int PatientDirectory::GetPatient(const string &deviceId)
+{
+	int patientId = PipelineSample::NO_PATIENT;
+	_mutex.Lock();
+	map<string, int>::const_iterator it = _patients.find(deviceId);
+	if (it != _patients.end())
+	{
+		patientId = it->second;
+	}
+	_mutex.Unlock();
+	return patientId;
+}
+
+void PatientDirectory::MappingsChanged(
+	const vector<PatientMappingChange> &changes)
+{
+	_mutex.Lock();
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		if (changes[i].removed)
+		{
+			_patients.erase(changes[i].deviceId);
+		} else
+		{
+			_patients[changes[i].deviceId] = changes[i].patientId;
+		}
+	}
+	_mutex.Unlock();
+}
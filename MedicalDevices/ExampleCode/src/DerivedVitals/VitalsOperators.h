@@ -0,0 +1,146 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef VITALS_OPERATORS_H
+#define VITALS_OPERATORS_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../CommonInfrastructure/StreamPipeline.h"
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
+
+// ------------------------------------------------------------------------- //
+//
+// The operators of the derived vitals pipeline.  They only deal with
+// PipelineSamples, so they know nothing about DDS.
+//
+// ------------------------------------------------------------------------- //
+
+// Metric IDs of the derived values
+extern const char *DERIVED_PULSE_RATE;
+extern const char *DERIVED_SPO2_MEAN;
+extern const char *DERIVED_SHOCK_INDEX;
+
+// Device ID of the values derived from several devices of one patient, with
+// the patient ID appended
+extern const char *DERIVED_PATIENT_DEVICE_PREFIX;
+
+// ------------------------------------------------------------------------- //
+// Passes on the samples of one metric, and drops the others
+class MetricFilter : public PipelineMap
+{
+public:
+	MetricFilter(const std::string &name, unsigned int queueCapacity,
+		const std::string &metricId) :
+		PipelineMap(name, queueCapacity),
+		_metricId(metricId)
+	{
+	}
+
+protected:
+	virtual bool Map(PipelineSample &sample)
+	{
+		return sample.metricId == _metricId;
+	}
+
+private:
+	std::string _metricId;
+};
+
+// ------------------------------------------------------------------------- //
+// Derives a pulse rate, in beats per minute, from a waveform with one peak
+// per beat, such as an ECG lead or a plethysmogram.
+//
+// A beat is a rising crossing of an adaptive threshold, 60% of the way from
+// the minimum to the maximum of the recent values, at least a refractory
+// period after the previous beat.  The minimum and maximum decay towards
+// the signal, so the threshold follows changes of amplitude.  The rate is
+// the mean of the last eight beat intervals, output once per frame.  Frames
+// of other metrics are dropped, and so are frames before the rate is known.
+class PulseRateDetector : public PipelineMap
+{
+public:
+	PulseRateDetector(const std::string &name, unsigned int queueCapacity,
+		const std::string &waveformMetricId);
+
+	unsigned int GetStreamCount() const
+	{
+		return (unsigned int)_streams.size();
+	}
+
+protected:
+	virtual bool Map(PipelineSample &sample);
+
+private:
+	static const unsigned int INTERVAL_COUNT = 8;
+
+	struct StreamState
+	{
+		float minimum;
+		float maximum;
+		bool above;
+		int64_t lastBeat;
+		int64_t lastTime;
+		int64_t intervals[INTERVAL_COUNT];
+		unsigned int intervalCount;
+		unsigned int nextInterval;
+	};
+
+	void DiscardIdle(int64_t now);
+
+	std::string _waveformMetricId;
+	std::map<std::string, StreamState> _streams;
+	std::string _key;
+	int64_t _lastDiscard;
+};
+
+// ------------------------------------------------------------------------- //
+// Computes the shock index of each patient, heart rate divided by systolic
+// blood pressure, from the latest values of both, which may come from
+// different devices.  A shock index above about 0.9 is a sign of shock.
+class ShockIndexJoin : public PipelinePatientJoin
+{
+public:
+	ShockIndexJoin(const std::string &name, unsigned int queueCapacity,
+		const std::string &heartRateMetricId,
+		const std::string &systolicMetricId, int64_t maxSkew,
+		PipelinePatientResolver *resolver);
+
+protected:
+	virtual bool Combine(int patientId,
+		const std::vector<const PipelineSample *> &latest,
+		PipelineSample &output);
+
+private:
+	static std::vector<std::string> MetricIds(
+		const std::string &heartRateMetricId,
+		const std::string &systolicMetricId);
+};
+
+// ------------------------------------------------------------------------- //
+// The patient each device monitors, kept up to date from the patient-device
+// mappings by the thread that reads DDS, and read by the pipeline threads
+class PatientDirectory : public PipelinePatientResolver,
+	public PatientMappingListener
+{
+public:
+	virtual int GetPatient(const std::string &deviceId);
+
+	virtual void MappingsChanged(
+		const std::vector<PatientMappingChange> &changes);
+
+private:
+	OSMutex _mutex;
+	std::map<std::string, int> _patients;
+};
+
+#endif
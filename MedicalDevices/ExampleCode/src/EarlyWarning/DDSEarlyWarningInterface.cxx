@@ -0,0 +1,299 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "DDSEarlyWarningInterface.h"
+#include "../CommonInfrastructure/DDSLoanedBatch.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+const char *EARLY_WARNING_SCORE = "EARLY_WARNING_SCORE";
+const char *EARLY_WARNING_VITALS = "EARLY_WARNING_VITALS";
+const char *EARLY_WARNING_PATIENT_DEVICE_PREFIX = "EARLY_WARNING_PATIENT_";
+
+// Largest number of samples taken from a DataReader at a time, and in one
+// call to ReadAvailableData(), so the scores are still computed on time
+// when the numerics arrive faster than they are read
+static const unsigned int STREAMING_BATCH_SAMPLES = 64;
+static const unsigned long MAX_SAMPLES_PER_READ = 4096;
+
+// ----------------------------------------------------------------------------
+// Patients
+bool EarlyWarningPatients::GetPatient(const std::string &deviceId,
+	int &patientId) const
+{
+	std::map<std::string, int>::const_iterator it = _patients.find(deviceId);
+	if (it == _patients.end())
+	{
+		return false;
+	}
+	patientId = it->second;
+	return true;
+}
+
+void EarlyWarningPatients::MappingsChanged(
+	const std::vector<PatientMappingChange> &changes)
+{
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		if (changes[i].removed)
+		{
+			_patients.erase(changes[i].deviceId);
+		} else
+		{
+			_patients[changes[i].deviceId] = changes[i].patientId;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// The DDSEarlyWarningInterface is the network interface to the early warning
+// application.  This creates DataReaders to receive numerics and
+// patient-device mappings, and a DataWriter to send the scores.
+//
+// The device data is sent on domain 5, the same domain used by the device
+// data replay.
+// ------------------------------------------------------------------------- //
+
+DDSEarlyWarningInterface::DDSEarlyWarningInterface(bool multicastAvailable,
+	const std::map<std::string, EarlyWarningVital> &metrics) :
+	_metrics(metrics)
+{
+	memset(&_statistics, 0, sizeof(_statistics));
+
+	_communicator = new DDSCommunicator();
+
+	std::vector<std::string> xmlFiles;
+
+	// Adding the XML files that contain profiles used by this application
+	xmlFiles.push_back(
+		"file://../../../src/Config/qos_profiles.xml");
+
+	// Configuring this application for multicast or no multicast.  Note that
+	// if you have no multicast, you will have to edit the XML QoS
+	// configuration to add the IP addresses of applications you want to
+	// discover and communicate with.
+	std::string participantProfile;
+	if (multicastAvailable)
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT;
+	} else
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
+	}
+
+	if (NULL == _communicator->CreateParticipant(5, xmlFiles,
+				ICE_QOS_LIBRARY, participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	// The Subscriber has the default QoS, so its DataReaders match the
+	// DataWriters of the devices.  The mappings are read on a coherent
+	// Subscriber of their own (see DDSPatientTransfer.h).
+	DDS::Publisher *pub = _communicator->CreatePublisher();
+	DDS::Subscriber *sub = _communicator->CreateSubscriber();
+	if (pub == NULL || sub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Publisher or Subscriber object";
+		throw errss.str();
+	}
+
+	// The scores are computed for the whole unit, so this application
+	// receives the device data of every patient group
+	SubscribeToAllPatientGroups(sub);
+
+	DDS::Topic *numericTopic = _communicator->CreateTopic<ice::Numeric>(
+		ice::NumericTopic);
+	DDS::Topic *mappingTopic =
+		_communicator->CreateTopic<DevicePatientMapping>(
+			DevicePatientMappingTopic);
+
+	DDS::DataReader *reader = sub->create_datareader_with_profile(
+		numericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING,
+		NULL, DDS_STATUS_MASK_NONE);
+	_numericReader = ice::NumericDataReader::narrow(reader);
+	if (_numericReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create Numeric reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	_mappingReader = new DDSPatientMappingReader(
+		_communicator->GetParticipant(), mappingTopic,
+		ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES);
+
+	// The scores are numerics like the vitals they come from.  The profile
+	// keeps the last score of each patient for late-joining displays.
+	DDS::DataWriter *writer = pub->create_datawriter_with_profile(
+		numericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING,
+		NULL, DDS_STATUS_MASK_NONE);
+	_numericWriter = ice::NumericDataWriter::narrow(writer);
+	if (_numericWriter == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create Numeric writer. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	// Create a ReadCondition that triggers when there is any data in the
+	// Numeric DataReader's queue, and attach it to a WaitSet with the
+	// condition of the mappings
+	_numericCondition = _numericReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+
+	_waitSet = new DDS::WaitSet();
+	_waitSet->attach_condition(_numericCondition);
+	_waitSet->attach_condition(_mappingReader->GetCondition());
+}
+
+// ----------------------------------------------------------------------------
+// Destructor.
+// Deletes the WaitSet, the DataReaders, the DataWriter, and the Communicator
+// object
+DDSEarlyWarningInterface::~DDSEarlyWarningInterface()
+{
+	_waitSet->detach_condition(_numericCondition);
+	_waitSet->detach_condition(_mappingReader->GetCondition());
+	delete _waitSet;
+
+	_numericReader->delete_readcondition(_numericCondition);
+	_numericReader->get_subscriber()->delete_datareader(_numericReader);
+	delete _mappingReader;
+
+	_numericWriter->get_publisher()->delete_datawriter(_numericWriter);
+
+	delete _communicator;
+}
+
+// ----------------------------------------------------------------------------
+// Waits for data.  Mappings are applied first, so the numerics that arrive
+// together with a new mapping are stored for the new patient.
+unsigned long DDSEarlyWarningInterface::ReadAvailableData(
+	EarlyWarningEngine &engine, int32_t now, const DDS_Duration_t &timeout)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode == DDS_RETCODE_TIMEOUT)
+	{
+		return 0;
+	}
+	if (retcode != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure waiting for device data";
+		throw errss.str();
+	}
+
+	_mappingReader->ProcessChanges(_patients);
+
+	LoanedBatch<ice::Numeric> batch;
+	unsigned long taken = 0;
+	unsigned long stored = 0;
+	while (taken < MAX_SAMPLES_PER_READ && batch.TakeNext(_numericReader,
+		_numericCondition, STREAMING_BATCH_SAMPLES))
+	{
+		taken += batch.GetLength();
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			if (!batch.IsValid(i))
+			{
+				continue;
+			}
+			_statistics.numericsIn++;
+
+			const ice::Numeric &numeric = batch.GetData(i);
+			std::map<std::string, EarlyWarningVital>::const_iterator vital =
+				_metrics.find(numeric.metric_id);
+			if (vital == _metrics.end())
+			{
+				continue;
+			}
+
+			int patientId = 0;
+			if (!_patients.GetPatient(numeric.unique_device_identifier,
+				patientId))
+			{
+				_statistics.unmappedCount++;
+				continue;
+			}
+
+			engine.SetVital(engine.GetSlot(patientId), vital->second,
+				numeric.value, now);
+			stored++;
+		}
+		batch.Return();
+	}
+
+	_statistics.vitalsIn += stored;
+	return stored;
+}
+
+// ----------------------------------------------------------------------------
+// Writes or disposes one value of a patient
+bool DDSEarlyWarningInterface::WriteValue(int patientId,
+	const char *metricId, float value, bool dispose)
+{
+	sprintf(_sample.unique_device_identifier, "%s%d",
+		EARLY_WARNING_PATIENT_DEVICE_PREFIX, patientId);
+	strcpy(_sample.metric_id, metricId);
+	_sample.instance_id = 0;
+	_sample.value = value;
+
+	if (dispose)
+	{
+		return _numericWriter->dispose(_sample, DDS_HANDLE_NIL) ==
+			DDS_RETCODE_OK;
+	}
+	return _numericWriter->write(_sample, DDS_HANDLE_NIL) == DDS_RETCODE_OK;
+}
+
+// ----------------------------------------------------------------------------
+// A failed write does not stop the other scores from being written, but is
+// reported once they all are.
+void DDSEarlyWarningInterface::PublishScores(
+	const std::vector<EarlyWarningScoreChange> &changes)
+{
+	unsigned int failed = 0;
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		const EarlyWarningScoreChange &change = changes[i];
+		bool dispose = change.score == EARLY_WARNING_UNKNOWN_SCORE;
+
+		if (!WriteValue(change.patientId, EARLY_WARNING_SCORE,
+				(float)change.score, dispose) ||
+			!WriteValue(change.patientId, EARLY_WARNING_VITALS,
+				(float)change.vitalCount, dispose))
+		{
+			failed++;
+		} else if (dispose)
+		{
+			_statistics.scoresDisposed++;
+		} else
+		{
+			_statistics.scoresWritten++;
+		}
+	}
+
+	if (failed > 0)
+	{
+		std::stringstream errss;
+		errss << "Failure to write " << failed << " early warning scores";
+		throw errss.str();
+	}
+}
@@ -0,0 +1,157 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_EARLY_WARNING_INTERFACE_H
+#define DDS_EARLY_WARNING_INTERFACE_H
+
+#include <map>
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+#include "EarlyWarningEngine.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// The early warning interface feeds an EarlyWarningEngine from DDS, and
+// sends the scores that changed back on DDS.
+//
+// Reading:
+// --------
+// ice::Numeric data is read with the StreamingData QoS profile.  The
+// numerics whose metric ID is one of the vitals of the score, and whose
+// device is mapped to a patient, are stored in the engine with the time
+// they were received.  The reception time is used rather than the source
+// timestamp, so a device with a wrong clock does not make its values look
+// older or newer than they are.
+//
+// The patient-device mappings are read on a Subscriber with the
+// PatientTransfer profile, so a transfer is applied at once.
+//
+// Writing:
+// --------
+// Each patient's score is written as an ice::Numeric with the metric ID
+// EARLY_WARNING_SCORE, and the number of vitals it is based on with the
+// metric ID EARLY_WARNING_VITALS.  The device ID is EARLY_WARNING_PATIENT_
+// followed by the patient ID.  They are only written when they change.
+// When a patient no longer has any recent vital, the score is unknown, and
+// both instances are disposed.
+//
+// ----------------------------------------------------------------------------
+
+// Metric IDs of the values written
+extern const char *EARLY_WARNING_SCORE;
+extern const char *EARLY_WARNING_VITALS;
+
+// Device ID of the values of a patient, with the patient ID appended
+extern const char *EARLY_WARNING_PATIENT_DEVICE_PREFIX;
+
+// Counts since the application started
+struct EarlyWarningStatistics
+{
+	uint64_t numericsIn;
+
+	// Numerics stored in the engine, and numerics of the vitals that were
+	// dropped because their device is not mapped to a patient
+	uint64_t vitalsIn;
+	uint64_t unmappedCount;
+
+	uint64_t scoresWritten;
+	uint64_t scoresDisposed;
+};
+
+// ------------------------------------------------------------------------- //
+// The patient of every device that is mapped to one
+class EarlyWarningPatients : public PatientMappingListener
+{
+public:
+	// Returns false if the device is not mapped to a patient
+	bool GetPatient(const std::string &deviceId, int &patientId) const;
+
+	virtual void MappingsChanged(
+		const std::vector<PatientMappingChange> &changes);
+
+private:
+	std::map<std::string, int> _patients;
+};
+
+class DDSEarlyWarningInterface
+{
+
+public:
+
+	// --- Constructor ---
+	// Creates the DomainParticipant, the DataReaders of the numerics and of
+	// the patient-device mappings, and the DataWriter of the scores.  The
+	// metrics map the metric ID of each vital of the score to the vital.
+	// Throws a std::string if any of them cannot be created.
+	DDSEarlyWarningInterface(bool multicastAvailable,
+		const std::map<std::string, EarlyWarningVital> &metrics);
+
+	// --- Destructor ---
+	~DDSEarlyWarningInterface();
+
+	// --- Getter for Communicator ---
+	DDSCommunicator *GetCommunicator()
+	{
+		return _communicator;
+	}
+
+	// --- Reading data ---
+	// Waits up to the timeout for data, applies the mapping changes, and
+	// stores the vitals in the engine, received at the time now in seconds.
+	// Takes a bounded number of numerics, and leaves the rest for the next
+	// call.  Returns the number of vitals stored.
+	unsigned long ReadAvailableData(EarlyWarningEngine &engine,
+		int32_t now, const DDS_Duration_t &timeout);
+
+	// --- Writing scores ---
+	// Writes the changed scores, and disposes the unknown ones.  Throws a
+	// std::string if any of them cannot be written.
+	void PublishScores(const std::vector<EarlyWarningScoreChange> &changes);
+
+	// --- Statistics ---
+	const EarlyWarningStatistics &GetStatistics() const
+	{
+		return _statistics;
+	}
+
+private:
+	// --- Private methods ---
+	bool WriteValue(int patientId, const char *metricId, float value,
+		bool dispose);
+
+	// --- Private members ---
+
+	// Used to create basic DDS entities that all applications need
+	DDSCommunicator *_communicator;
+
+	ice::NumericDataReader *_numericReader;
+	DDSPatientMappingReader *_mappingReader;
+	ice::NumericDataWriter *_numericWriter;
+
+	DDS::ReadCondition *_numericCondition;
+	DDS::WaitSet *_waitSet;
+
+	std::map<std::string, EarlyWarningVital> _metrics;
+	EarlyWarningPatients _patients;
+
+	// Reused for every score, so writing does not allocate
+	DdsAutoType<ice::Numeric> _sample;
+
+	EarlyWarningStatistics _statistics;
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "DDSEarlyWarningInterface.h"
+#include "EarlyWarningEngine.h"
+#include "../CommonInfrastructure/OSAPI.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This application computes an early warning score for every patient of the
+// unit, once a second, from the latest heart rate, respiration rate, SpO2,
+// systolic blood pressure and temperature numerics of the patient's devices
+// (see EarlyWarningEngine.h).  The scores that changed are sent as
+// ice::Numeric samples (see DDSEarlyWarningInterface.h).
+//
+// Patients whose score became unknown are removed from the engine, so the
+// columns only hold the patients that are being monitored.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_SECOND = 1000000000LL;
+
+// Seconds between two reports of the statistics
+static const int32_t REPORT_SECONDS = 10;
+
+// Adds the default metric IDs of each vital
+static void AddDefaultMetrics(map<string, EarlyWarningVital> &metrics)
+{
+	metrics["MDC_PULS_RATE"] = EARLY_WARNING_HEART_RATE;
+	metrics["MDC_PULS_OXIM_PULS_RATE"] = EARLY_WARNING_HEART_RATE;
+	metrics["MDC_ECG_HEART_RATE"] = EARLY_WARNING_HEART_RATE;
+	metrics["MDC_RESP_RATE"] = EARLY_WARNING_RESPIRATION_RATE;
+	metrics["MDC_CO2_RESP_RATE"] = EARLY_WARNING_RESPIRATION_RATE;
+	metrics["MDC_PULS_OXIM_SAT_O2"] = EARLY_WARNING_SPO2;
+	metrics["MDC_PRESS_BLD_NONINV_SYS"] = EARLY_WARNING_SYSTOLIC;
+	metrics["MDC_PRESS_BLD_ART_SYS"] = EARLY_WARNING_SYSTOLIC;
+	metrics["MDC_TEMP_BODY"] = EARLY_WARNING_TEMPERATURE;
+}
+
+// Returns false if the name is not the name of a vital
+static bool ParseVital(const char *name, EarlyWarningVital &vital)
+{
+	static const char *names[EARLY_WARNING_VITAL_COUNT] =
+		{ "hr", "rr", "spo2", "sys", "temp" };
+	for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+	{
+		if (0 == strcmp(name, names[i]))
+		{
+			vital = (EarlyWarningVital)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char *argv[])
+{
+	bool multicastAvailable = true;
+	map<string, EarlyWarningVital> metrics;
+	AddDefaultMetrics(metrics);
+
+	// Process the command-line arguments
+	for (int i = 0; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-multicast"))
+		{
+			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--metric") && i + 2 < argc)
+		{
+			EarlyWarningVital vital;
+			if (!ParseVital(argv[i + 2], vital))
+			{
+				cout << "Bad vital: " << argv[i + 2] << endl;
+				PrintHelp();
+				return -1;
+			}
+			metrics[argv[i + 1]] = vital;
+			i += 2;
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else if (i > 0)
+		{
+			// If we have a parameter that is not the first one, and is not
+			// recognized, return an error.
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	try
+	{
+		// --------------------------------------------------------------------
+		// This is the network interface for this application - it stores
+		// the vitals it reads in the engine, and writes the scores that
+		// changed.
+		DDSEarlyWarningInterface warningInterface(multicastAvailable,
+			metrics);
+		EarlyWarningEngine engine(EARLY_WARNING_DEFAULT_MAX_AGES);
+
+		cout << "Computing early warning scores from " << metrics.size()
+			<< " metrics" << (IsEarlyWarningVectorized() ? " with SSE2" : "")
+			<< endl;
+
+		int64_t start = OSGetMonotonicTime();
+		int32_t lastScored = 0;
+		int32_t lastReport = 0;
+		int64_t scoringTime = 0;
+		vector<EarlyWarningScoreChange> changes;
+		EarlyWarningStatistics last = warningInterface.GetStatistics();
+
+		while (1)
+		{
+			// Read until the next second starts
+			int64_t elapsed = OSGetMonotonicTime() - start;
+			int64_t untilNext = ((int64_t)lastScored + 1) *
+				NANOSECONDS_PER_SECOND - elapsed;
+			if (untilNext > 0)
+			{
+				DDS_Duration_t waitTime;
+				waitTime.sec = (DDS_Long)(untilNext / NANOSECONDS_PER_SECOND);
+				waitTime.nanosec =
+					(DDS_UnsignedLong)(untilNext % NANOSECONDS_PER_SECOND);
+				warningInterface.ReadAvailableData(engine,
+					(int32_t)(elapsed / NANOSECONDS_PER_SECOND), waitTime);
+				continue;
+			}
+
+			// Score every patient, and send the scores that changed
+			int32_t now = (int32_t)(elapsed / NANOSECONDS_PER_SECOND);
+			int64_t scoringStart = OSGetMonotonicTime();
+			engine.ComputeScores(now);
+			changes.clear();
+			engine.TakeChangedScores(changes);
+			scoringTime += OSGetMonotonicTime() - scoringStart;
+
+			warningInterface.PublishScores(changes);
+			for (size_t i = 0; i < changes.size(); i++)
+			{
+				if (changes[i].score == EARLY_WARNING_UNKNOWN_SCORE)
+				{
+					engine.RemovePatient(changes[i].patientId);
+				}
+			}
+			lastScored = now;
+
+			if (now - lastReport >= REPORT_SECONDS)
+			{
+				const EarlyWarningStatistics &current =
+					warningInterface.GetStatistics();
+				int32_t seconds = now - lastReport;
+				cout << "Patients: " << engine.GetPatientCount()
+					<< ", vitals in: " << current.vitalsIn - last.vitalsIn
+					<< " (unmapped " << current.unmappedCount -
+						last.unmappedCount << "), scores written: "
+					<< current.scoresWritten - last.scoresWritten
+					<< ", disposed: " << current.scoresDisposed -
+						last.scoresDisposed << ", scoring "
+					<< (double)scoringTime / 1000.0 / (double)seconds
+					<< " us/s" << endl;
+				lastReport = now;
+				last = current;
+				scoringTime = 0;
+			}
+		}
+	}
+	catch (string message)
+	{
+		cout << "Application exception: " << message << endl;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --no-multicast" <<
+		"                 Do not use multicast " <<
+		"(note you must edit XML" << endl <<
+		"                                   " <<
+		"config to include IP addresses)"
+		<< endl;
+	cout <<
+		"    --metric <id> <vital>" <<
+		"          Also read the numeric <id> as a vital:" <<
+		endl << "                                   " <<
+		"hr, rr, spo2, sys or temp.  Can be repeated"
+		<< endl;
+}
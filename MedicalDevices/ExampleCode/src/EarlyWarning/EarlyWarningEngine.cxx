@@ -0,0 +1,383 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <limits>
+#include "EarlyWarningEngine.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EARLY_WARNING_SSE2
+#include <emmintrin.h>
+#endif
+
+// Number of slots scored at a time.  The columns are padded to a multiple
+// of it.
+static const unsigned int EARLY_WARNING_BLOCK_SIZE = 4;
+
+// Largest age of each vital, in seconds.  A NIBP is usually measured every
+// 15 to 30 minutes, and a temperature even less often.
+const int32_t EARLY_WARNING_DEFAULT_MAX_AGES[EARLY_WARNING_VITAL_COUNT] =
+{
+	60,		// Heart rate
+	60,		// Respiration rate
+	60,		// SpO2
+	1800,	// Systolic blood pressure
+	3600	// Temperature
+};
+
+// ------------------------------------------------------------------------- //
+// Score bands
+// ------------------------------------------------------------------------- //
+
+// A step adds its points when the value is below the threshold, or when it
+// is at or above the threshold
+struct EarlyWarningStep
+{
+	EarlyWarningVital vital;
+	bool below;
+	float threshold;
+	float points;
+};
+
+// The NEWS2 bands, as steps, grouped by vital in the order of
+// EarlyWarningVital.  For example, a heart rate of 40 or less is
+// below both 40.5 and 50.5, and scores 2 + 1 = 3 points.
+//
+//  Heart rate:       <= 40: 3, 41-50: 1, 91-110: 1, 111-130: 2, >= 131: 3
+//  Respiration rate: <= 8: 3, 9-11: 1, 21-24: 2, >= 25: 3
+//  SpO2:             <= 91: 3, 92-93: 2, 94-95: 1
+//  Systolic:         <= 90: 3, 91-100: 2, 101-110: 1, >= 220: 3
+//  Temperature:      <= 35.0: 3, 35.1-36.0: 1, 38.1-39.0: 1, >= 39.1: 2
+static const EarlyWarningStep EARLY_WARNING_STEPS[] =
+{
+	{ EARLY_WARNING_HEART_RATE, true, 40.5f, 2.0f },
+	{ EARLY_WARNING_HEART_RATE, true, 50.5f, 1.0f },
+	{ EARLY_WARNING_HEART_RATE, false, 90.5f, 1.0f },
+	{ EARLY_WARNING_HEART_RATE, false, 110.5f, 1.0f },
+	{ EARLY_WARNING_HEART_RATE, false, 130.5f, 1.0f },
+	{ EARLY_WARNING_RESPIRATION_RATE, true, 8.5f, 2.0f },
+	{ EARLY_WARNING_RESPIRATION_RATE, true, 11.5f, 1.0f },
+	{ EARLY_WARNING_RESPIRATION_RATE, false, 20.5f, 2.0f },
+	{ EARLY_WARNING_RESPIRATION_RATE, false, 24.5f, 1.0f },
+	{ EARLY_WARNING_SPO2, true, 91.5f, 1.0f },
+	{ EARLY_WARNING_SPO2, true, 93.5f, 1.0f },
+	{ EARLY_WARNING_SPO2, true, 95.5f, 1.0f },
+	{ EARLY_WARNING_SYSTOLIC, true, 90.5f, 1.0f },
+	{ EARLY_WARNING_SYSTOLIC, true, 100.5f, 1.0f },
+	{ EARLY_WARNING_SYSTOLIC, true, 110.5f, 1.0f },
+	{ EARLY_WARNING_SYSTOLIC, false, 219.5f, 3.0f },
+	{ EARLY_WARNING_TEMPERATURE, true, 35.05f, 2.0f },
+	{ EARLY_WARNING_TEMPERATURE, true, 36.05f, 1.0f },
+	{ EARLY_WARNING_TEMPERATURE, false, 38.05f, 1.0f },
+	{ EARLY_WARNING_TEMPERATURE, false, 39.05f, 1.0f }
+};
+
+static const unsigned int EARLY_WARNING_STEP_COUNT =
+	sizeof(EARLY_WARNING_STEPS) / sizeof(EARLY_WARNING_STEPS[0]);
+
+// ------------------------------------------------------------------------- //
+// Patients
+// ------------------------------------------------------------------------- //
+
+EarlyWarningEngine::EarlyWarningEngine(const int32_t *maxAgeSeconds)
+{
+	for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+	{
+		// The vectorized age comparison adds one to the largest age
+		_maxAgeSeconds[i] = maxAgeSeconds[i];
+		if (_maxAgeSeconds[i] == std::numeric_limits<int32_t>::max())
+		{
+			_maxAgeSeconds[i]--;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// New slots have no value, an unknown score, and an unknown score taken, so
+// they are not reported until they have a recent value.
+void EarlyWarningEngine::Resize(unsigned int capacity)
+{
+	for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+	{
+		_values[i].resize(capacity, std::numeric_limits<float>::quiet_NaN());
+		_times[i].resize(capacity, 0);
+	}
+	_scores.resize(capacity, EARLY_WARNING_UNKNOWN_SCORE);
+	_vitalCounts.resize(capacity, 0);
+	_takenScores.resize(capacity, EARLY_WARNING_UNKNOWN_SCORE);
+	_takenVitalCounts.resize(capacity, 0);
+}
+
+unsigned int EarlyWarningEngine::GetSlot(int patientId)
+{
+	std::map<int, unsigned int>::const_iterator it = _slots.find(patientId);
+	if (it != _slots.end())
+	{
+		return it->second;
+	}
+
+	unsigned int slot = (unsigned int)_patientIds.size();
+	if (slot >= _scores.size())
+	{
+		// Doubling keeps the cost of adding a patient constant on average
+		unsigned int capacity = slot * 2;
+		if (capacity < EARLY_WARNING_BLOCK_SIZE)
+		{
+			capacity = EARLY_WARNING_BLOCK_SIZE;
+		}
+		Resize(capacity);
+	}
+
+	_patientIds.push_back(patientId);
+	_slots[patientId] = slot;
+	return slot;
+}
+
+bool EarlyWarningEngine::RemovePatient(int patientId)
+{
+	std::map<int, unsigned int>::iterator it = _slots.find(patientId);
+	if (it == _slots.end())
+	{
+		return false;
+	}
+
+	unsigned int slot = it->second;
+	unsigned int last = (unsigned int)_patientIds.size() - 1;
+	_slots.erase(it);
+
+	if (slot != last)
+	{
+		for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+		{
+			_values[i][slot] = _values[i][last];
+			_times[i][slot] = _times[i][last];
+		}
+		_scores[slot] = _scores[last];
+		_vitalCounts[slot] = _vitalCounts[last];
+		_takenScores[slot] = _takenScores[last];
+		_takenVitalCounts[slot] = _takenVitalCounts[last];
+		_patientIds[slot] = _patientIds[last];
+		_slots[_patientIds[slot]] = slot;
+	}
+
+	// The last slot becomes padding again
+	for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+	{
+		_values[i][last] = std::numeric_limits<float>::quiet_NaN();
+		_times[i][last] = 0;
+	}
+	_scores[last] = EARLY_WARNING_UNKNOWN_SCORE;
+	_vitalCounts[last] = 0;
+	_takenScores[last] = EARLY_WARNING_UNKNOWN_SCORE;
+	_takenVitalCounts[last] = 0;
+	_patientIds.pop_back();
+	return true;
+}
+
+// ------------------------------------------------------------------------- //
+// Scoring
+// ------------------------------------------------------------------------- //
+
+// ----------------------------------------------------------------------------
+// A value is recent if it was received at most the largest age before now.
+// A NaN value, such as the value of a vital that was never received, is
+// never recent, and fails every comparison of the steps.
+void EarlyWarningEngine::ComputeScoresScalar(int32_t now)
+{
+	unsigned int capacity = (unsigned int)_scores.size();
+	for (unsigned int slot = 0; slot < capacity; slot++)
+	{
+		float score = 0.0f;
+		int32_t vitalCount = 0;
+		unsigned int s = 0;
+
+		for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+		{
+			float value = _values[i][slot];
+			float total = 0.0f;
+			for (; s < EARLY_WARNING_STEP_COUNT &&
+				EARLY_WARNING_STEPS[s].vital == i; s++)
+			{
+				const EarlyWarningStep &step = EARLY_WARNING_STEPS[s];
+				bool hit = step.below ? value < step.threshold :
+					value >= step.threshold;
+				if (hit)
+				{
+					total += step.points;
+				}
+			}
+
+			if (now - _times[i][slot] <= _maxAgeSeconds[i] && value == value)
+			{
+				score += total;
+				vitalCount++;
+			}
+		}
+
+		_vitalCounts[slot] = vitalCount;
+		_scores[slot] = vitalCount > 0 ? (int32_t)score :
+			EARLY_WARNING_UNKNOWN_SCORE;
+	}
+}
+
+#if defined(EARLY_WARNING_SSE2)
+
+// ----------------------------------------------------------------------------
+// The same computation as ComputeScoresScalar(), on four slots at a time.  The
+// comparisons give masks of all ones or all zeros, which select the points
+// of the steps, and the points of the vitals that are recent.
+void EarlyWarningEngine::ComputeScores(int32_t now)
+{
+	__m128 thresholds[EARLY_WARNING_STEP_COUNT];
+	__m128 points[EARLY_WARNING_STEP_COUNT];
+	for (unsigned int s = 0; s < EARLY_WARNING_STEP_COUNT; s++)
+	{
+		thresholds[s] = _mm_set1_ps(EARLY_WARNING_STEPS[s].threshold);
+		points[s] = _mm_set1_ps(EARLY_WARNING_STEPS[s].points);
+	}
+
+	__m128i ageLimits[EARLY_WARNING_VITAL_COUNT];
+	for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+	{
+		ageLimits[i] = _mm_set1_epi32(_maxAgeSeconds[i] + 1);
+	}
+
+	const __m128i nowTimes = _mm_set1_epi32(now);
+	const __m128i ones = _mm_set1_epi32(1);
+	const __m128i unknown = _mm_set1_epi32(EARLY_WARNING_UNKNOWN_SCORE);
+
+	unsigned int capacity = (unsigned int)_scores.size();
+	for (unsigned int slot = 0; slot < capacity;
+		slot += EARLY_WARNING_BLOCK_SIZE)
+	{
+		__m128 score = _mm_setzero_ps();
+		__m128i vitalCount = _mm_setzero_si128();
+		unsigned int s = 0;
+
+		for (int i = 0; i < EARLY_WARNING_VITAL_COUNT; i++)
+		{
+			__m128 values = _mm_loadu_ps(&_values[i][slot]);
+			__m128 total = _mm_setzero_ps();
+			for (; s < EARLY_WARNING_STEP_COUNT &&
+				EARLY_WARNING_STEPS[s].vital == i; s++)
+			{
+				__m128 hit = EARLY_WARNING_STEPS[s].below ?
+					_mm_cmplt_ps(values, thresholds[s]) :
+					_mm_cmpge_ps(values, thresholds[s]);
+				total = _mm_add_ps(total, _mm_and_ps(hit, points[s]));
+			}
+
+			__m128i times = _mm_loadu_si128(
+				(const __m128i *)&_times[i][slot]);
+			__m128i young = _mm_cmplt_epi32(_mm_sub_epi32(nowTimes, times),
+				ageLimits[i]);
+			__m128 recent = _mm_and_ps(_mm_castsi128_ps(young),
+				_mm_cmpord_ps(values, values));
+
+			score = _mm_add_ps(score, _mm_and_ps(recent, total));
+			vitalCount = _mm_add_epi32(vitalCount,
+				_mm_and_si128(_mm_castps_si128(recent), ones));
+		}
+
+		// Slots with no recent vital get the unknown score
+		__m128i none = _mm_cmpeq_epi32(vitalCount, _mm_setzero_si128());
+		__m128i scores = _mm_or_si128(
+			_mm_andnot_si128(none, _mm_cvttps_epi32(score)),
+			_mm_and_si128(none, unknown));
+
+		_mm_storeu_si128((__m128i *)&_scores[slot], scores);
+		_mm_storeu_si128((__m128i *)&_vitalCounts[slot], vitalCount);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Most scores do not change from one second to the next, so blocks of four
+// slots that are all unchanged are skipped with one comparison.
+void EarlyWarningEngine::TakeChangedScores(
+	std::vector<EarlyWarningScoreChange> &changes)
+{
+	unsigned int count = (unsigned int)_patientIds.size();
+	for (unsigned int first = 0; first < count;
+		first += EARLY_WARNING_BLOCK_SIZE)
+	{
+		__m128i same = _mm_and_si128(
+			_mm_cmpeq_epi32(
+				_mm_loadu_si128((const __m128i *)&_scores[first]),
+				_mm_loadu_si128((const __m128i *)&_takenScores[first])),
+			_mm_cmpeq_epi32(
+				_mm_loadu_si128((const __m128i *)&_vitalCounts[first]),
+				_mm_loadu_si128((const __m128i *)&_takenVitalCounts[first])));
+		if (_mm_movemask_epi8(same) == 0xFFFF)
+		{
+			continue;
+		}
+
+		unsigned int end = first + EARLY_WARNING_BLOCK_SIZE;
+		if (end > count)
+		{
+			end = count;
+		}
+		for (unsigned int slot = first; slot < end; slot++)
+		{
+			if (_scores[slot] == _takenScores[slot] &&
+				_vitalCounts[slot] == _takenVitalCounts[slot])
+			{
+				continue;
+			}
+			EarlyWarningScoreChange change;
+			change.patientId = _patientIds[slot];
+			change.score = _scores[slot];
+			change.vitalCount = _vitalCounts[slot];
+			changes.push_back(change);
+			_takenScores[slot] = _scores[slot];
+			_takenVitalCounts[slot] = _vitalCounts[slot];
+		}
+	}
+}
+
+bool IsEarlyWarningVectorized()
+{
+	return true;
+}
+
+#else
+
+void EarlyWarningEngine::ComputeScores(int32_t now)
+{
+	ComputeScoresScalar(now);
+}
+
+void EarlyWarningEngine::TakeChangedScores(
+	std::vector<EarlyWarningScoreChange> &changes)
+{
+	unsigned int count = (unsigned int)_patientIds.size();
+	for (unsigned int slot = 0; slot < count; slot++)
+	{
+		if (_scores[slot] == _takenScores[slot] &&
+			_vitalCounts[slot] == _takenVitalCounts[slot])
+		{
+			continue;
+		}
+		EarlyWarningScoreChange change;
+		change.patientId = _patientIds[slot];
+		change.score = _scores[slot];
+		change.vitalCount = _vitalCounts[slot];
+		changes.push_back(change);
+		_takenScores[slot] = _scores[slot];
+		_takenVitalCounts[slot] = _vitalCounts[slot];
+	}
+}
+
+bool IsEarlyWarningVectorized()
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef EARLY_WARNING_ENGINE_H
+#define EARLY_WARNING_ENGINE_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+// ------------------------------------------------------------------------- //
+//
+// Early warning scores:
+// An aggregate score of how far a patient's vitals are from normal, in the
+// style of the NEWS2 score.  Each of the heart rate, respiration rate, SpO2,
+// systolic blood pressure and temperature scores 0 to 3 points, depending on
+// the band its value is in, and the score is the sum of the points.
+//
+// The engine keeps the latest value of each vital in struct-of-arrays
+// columns: one array of floats per vital, and one array of the times the
+// values were received, indexed by the slot of the patient.  The slots are
+// dense, so recomputing the scores of every patient walks each column from
+// start to end, instead of following a pointer per patient and per vital.
+//
+// The points of a vital are a sum of steps: each step adds its points when
+// the value is below (or at or above) its threshold.  The thresholds are
+// half way between the whole numbers of the bands, so values that are
+// rounded for display score as the bands say.  With SSE2, the scores of four
+// patients are computed at a time, with one comparison per step and no
+// branch.  The scalar version computes exactly the same scores, and is used
+// on other processors.
+//
+// A vital scores no points if the patient has no value for it, or if its
+// value is older than the largest age of that vital.  The largest ages
+// differ, because a non-invasive blood pressure or a temperature is only
+// measured every few minutes.  A patient with no recent value at all has an
+// unknown score.
+//
+// The engine is not thread safe.
+//
+// ------------------------------------------------------------------------- //
+
+// The vitals of the score
+enum EarlyWarningVital
+{
+	EARLY_WARNING_HEART_RATE = 0,
+	EARLY_WARNING_RESPIRATION_RATE,
+	EARLY_WARNING_SPO2,
+	EARLY_WARNING_SYSTOLIC,
+	EARLY_WARNING_TEMPERATURE,
+	EARLY_WARNING_VITAL_COUNT
+};
+
+// Score of a patient with no recent value
+static const int32_t EARLY_WARNING_UNKNOWN_SCORE = -1;
+
+// Patients whose score changed since the last time the changes were taken
+struct EarlyWarningScoreChange
+{
+	int patientId;
+
+	// EARLY_WARNING_UNKNOWN_SCORE if no value is recent enough
+	int32_t score;
+
+	// Vitals that had a recent value
+	int32_t vitalCount;
+};
+
+class EarlyWarningEngine
+{
+public:
+	// --- Constructor ---
+	// The largest age of each vital is in seconds, indexed by
+	// EarlyWarningVital
+	EarlyWarningEngine(const int32_t *maxAgeSeconds);
+
+	// --- Patients ---
+	// Returns the slot of a patient, adding the patient at the end of the
+	// columns the first time
+	unsigned int GetSlot(int patientId);
+
+	// Removes a patient.  The last patient is moved to the slot of the
+	// removed one, so the slots stay dense.  Returns false if the patient
+	// has no slot.
+	bool RemovePatient(int patientId);
+
+	unsigned int GetPatientCount() const
+	{
+		return (unsigned int)_patientIds.size();
+	}
+
+	int GetPatientId(unsigned int slot) const
+	{
+		return _patientIds[slot];
+	}
+
+	// --- Vitals ---
+	// Sets the latest value of a vital, received at a time in seconds.  The
+	// times must not be negative.
+	void SetVital(unsigned int slot, EarlyWarningVital vital, float value,
+		int32_t time)
+	{
+		_values[vital][slot] = value;
+		_times[vital][slot] = time;
+	}
+
+	// --- Scoring ---
+	// Recomputes the score of every patient at a time in seconds, with SSE2
+	// where available
+	void ComputeScores(int32_t now);
+
+	// Portable version, used where SSE2 is not available, and by the
+	// benchmark for comparison
+	void ComputeScoresScalar(int32_t now);
+
+	// Score of a slot, as of the last ComputeScores()
+	int32_t GetScore(unsigned int slot) const
+	{
+		return _scores[slot];
+	}
+
+	int32_t GetVitalCount(unsigned int slot) const
+	{
+		return _vitalCounts[slot];
+	}
+
+	// Appends the patients whose score or count of recent vitals changed
+	// since the last call, and remembers their new score
+	void TakeChangedScores(std::vector<EarlyWarningScoreChange> &changes);
+
+private:
+	// --- Private methods ---
+	void Resize(unsigned int capacity);
+
+	// --- Private members ---
+	int32_t _maxAgeSeconds[EARLY_WARNING_VITAL_COUNT];
+
+	// Patient of each slot, and slot of each patient
+	std::vector<int> _patientIds;
+	std::map<int, unsigned int> _slots;
+
+	// The columns.  They are padded to a multiple of four slots, and the
+	// padding has no value, so its score stays unknown.
+	std::vector<float> _values[EARLY_WARNING_VITAL_COUNT];
+	std::vector<int32_t> _times[EARLY_WARNING_VITAL_COUNT];
+	std::vector<int32_t> _scores;
+	std::vector<int32_t> _vitalCounts;
+
+	// What TakeChangedScores() last returned for each slot
+	std::vector<int32_t> _takenScores;
+	std::vector<int32_t> _takenVitalCounts;
+};
+
+// Default largest age of each vital, in seconds, indexed by
+// EarlyWarningVital
+extern const int32_t EARLY_WARNING_DEFAULT_MAX_AGES[EARLY_WARNING_VITAL_COUNT];
+
+// True if ComputeScores uses SSE2
+bool IsEarlyWarningVectorized();
+
+#endif
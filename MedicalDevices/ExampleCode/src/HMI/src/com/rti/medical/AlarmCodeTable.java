@@ -0,0 +1,74 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+
+package com.rti.medical;
+
+import ice.Numeric;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+
+import com.rti.medical.generated.AlarmCode;
+import com.rti.medical.generated.AlarmCodeKind;
+import com.rti.medical.generated.AlarmValue;
+import com.rti.medical.generated.CompactAlarm;
+
+// Keeps the codes received on the AlarmCode topic, so the values of
+// CompactAlarms can be expanded back into full Numerics.
+class AlarmCodeTable implements SampleListener<AlarmCode> {
+
+	// Device and metric IDs, by code table and code
+	private final HashMap<Long, String> _deviceIds =
+			new HashMap<Long, String>();
+	private final HashMap<Long, String> _metricIds =
+			new HashMap<Long, String>();
+
+	@Override
+	public void processSample(AlarmCode sample) {
+		if (sample.kind.equals(AlarmCodeKind.DEVICE_CODE)) {
+			_deviceIds.put(key(sample.table_id, sample.code), sample.name);
+		} else if (sample.kind.equals(AlarmCodeKind.METRIC_CODE)) {
+			_metricIds.put(key(sample.table_id, sample.code), sample.name);
+		}
+	}
+
+	// ------------------------------------------------------------------------
+	// Returns the values of the alarm as Numerics, or null if a code of the
+	// alarm has not been received yet.
+	// ------------------------------------------------------------------------
+	public ArrayList<Numeric> expand(CompactAlarm alarm) {
+		ArrayList<Numeric> numerics = new ArrayList<Numeric>();
+		for (int i = 0; i < alarm.values.size(); i++) {
+			AlarmValue value = (AlarmValue)alarm.values.get(i);
+			String deviceId =
+					_deviceIds.get(key(alarm.table_id, value.device_code));
+			String metricId =
+					_metricIds.get(key(alarm.table_id, value.metric_code));
+			if (deviceId == null || metricId == null) {
+				return null;
+			}
+
+			Numeric numeric = new Numeric();
+			numeric.unique_device_identifier = deviceId;
+			numeric.metric_id = metricId;
+			numeric.instance_id = value.instance_id;
+			numeric.value = value.value;
+			numerics.add(numeric);
+		}
+		return numerics;
+	}
+
+	// Codes are unsigned in the IDL, and are combined with their table into
+	// one key
+	private static Long key(int tableId, int code) {
+		return ((long)tableId << 32) | (code & 0xffffffffL);
+	}
+}
@@ -13,31 +13,67 @@ package com.rti.medical;
 
 import ice.Numeric;
 
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.Iterator;
 import java.util.Vector;
 
-import com.rti.medical.generated.Alarm;
+import com.rti.medical.generated.CompactAlarm;
 
-class AlarmListener implements SampleListener<Alarm> {
+class AlarmListener implements SampleListener<CompactAlarm> {
 
 	/**
 	 * 
 	 */
 	private final ICEDisplay _display;
+
+	// Looks up the devices and metrics that alarm values refer to
+	private final AlarmCodeTable _codeTable;
+
+	// Latest alarm of each patient that could not be displayed yet, because
+	// the codes it refers to have not arrived
+	private final HashMap<Integer, CompactAlarm> _pendingAlarms =
+			new HashMap<Integer, CompactAlarm>();
 	
-	public AlarmListener(ICEDisplay display) {
+	public AlarmListener(ICEDisplay display, AlarmCodeTable codeTable) {
 		_display = display;
+		_codeTable = codeTable;
 	}
 	
 	@Override
-	public void processSample(Alarm sample) {
+	public void processSample(CompactAlarm sample) {
+		if (!display(sample)) {
+			// The sample is loaned by the DataReader, so keep a copy
+			_pendingAlarms.put(sample.patient_id, new CompactAlarm(sample));
+		} else {
+			_pendingAlarms.remove(sample.patient_id);
+		}
+	}
+
+	// Called when new codes arrive, to display the alarms that were waiting
+	// for them
+	public void processPendingAlarms() {
+		Iterator<CompactAlarm> pending = _pendingAlarms.values().iterator();
+		while (pending.hasNext()) {
+			if (display(pending.next())) {
+				pending.remove();
+			}
+		}
+	}
+
+	private boolean display(CompactAlarm sample) {
+		ArrayList<Numeric> values = _codeTable.expand(sample);
+		if (values == null) {
+			return false;
+		}
+
 		Vector<String> alarmData = new Vector<String>();
 		alarmData.add(Integer.toString(sample.patient_id));
 		alarmData.add(sample.alarmKind.toString());
 		
 		String columnData = new String();
-		for (int i = 0; i < sample.device_alarm_values.size(); i++) {
-			Numeric deviceNumericData = 
-					(Numeric)sample.device_alarm_values.get(i);
+		for (int i = 0; i < values.size(); i++) {
+			Numeric deviceNumericData = values.get(i);
 			columnData += "DeviceID: ";
 			columnData += deviceNumericData.unique_device_identifier;
 			columnData += " Value: ";
@@ -47,6 +83,7 @@ class AlarmListener implements SampleListener<Alarm> {
 		alarmData.add(columnData);
 		
 		_display.addOrUpdateAlarmData(alarmData);
+		return true;
 	}
 	
 }
\ No newline at end of file
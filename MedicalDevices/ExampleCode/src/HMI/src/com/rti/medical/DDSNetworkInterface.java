@@ -14,10 +14,14 @@ package com.rti.medical;
 import java.util.ArrayList;
 
 import com.rti.dds.infrastructure.Duration_t;
-import com.rti.medical.generated.Alarm;
-import com.rti.medical.generated.AlarmTopic;
+import com.rti.dds.infrastructure.RETCODE_TIMEOUT;
+import com.rti.medical.generated.AlarmCode;
+import com.rti.medical.generated.AlarmCodeTopic;
+import com.rti.medical.generated.CompactAlarm;
+import com.rti.medical.generated.CompactAlarmTopic;
 import com.rti.medical.generated.ICE_QOS_LIBRARY;
-import com.rti.medical.generated.QOS_PROFILE_ALARM;
+import com.rti.medical.generated.QOS_PROFILE_ALARM_CODES;
+import com.rti.medical.generated.QOS_PROFILE_COMPACT_ALARM;
 import com.rti.medical.generated.QOS_PROFILE_PARTICIPANT;
 import com.rti.medical.generated.QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
 
@@ -30,7 +34,10 @@ public class DDSNetworkInterface {
 	private final DDSCommunicator _communicator;
 	
 	// DataReader for Alarm data
-	private final GenericDataReader<Alarm> _reader;
+	private final GenericDataReader<CompactAlarm> _reader;
+
+	// DataReader for the codes that alarms refer to
+	private final GenericDataReader<AlarmCode> _codeReader;
 	
 
 	// --- Public Methods --- //
@@ -67,26 +74,55 @@ public class DDSNetworkInterface {
 		// --- Create an Alarm Data Reader --- //
 		// This uses a topic name that has been defined as a constant in the
 		// alarm.idl file.
-		_reader = new GenericDataReader<Alarm>(
-				_communicator, AlarmTopic.VALUE,
-				Alarm.class,
+		_reader = new GenericDataReader<CompactAlarm>(
+				_communicator, CompactAlarmTopic.VALUE,
+				CompactAlarm.class,
+				ICE_QOS_LIBRARY.VALUE,
+				QOS_PROFILE_COMPACT_ALARM.VALUE);
+
+		// --- Create an Alarm Code Data Reader --- //
+		// Receives the device and metric IDs that alarms refer to by code
+		_codeReader = new GenericDataReader<AlarmCode>(
+				_communicator, AlarmCodeTopic.VALUE,
+				AlarmCode.class,
 				ICE_QOS_LIBRARY.VALUE,
-				QOS_PROFILE_ALARM.VALUE);
+				QOS_PROFILE_ALARM_CODES.VALUE);
 	}
 	
 	// ------------------------------------------------------------------------
 	// Add a listener to the Alarm DataReader that receives Alarm updates
 	// ------------------------------------------------------------------------
-	public void addAlarmListener(SampleListener<Alarm> listener) {
+	public void addAlarmListener(SampleListener<CompactAlarm> listener) {
 		_reader.addListener(listener);
 	}
+
+	// ------------------------------------------------------------------------
+	// Add a listener to the AlarmCode DataReader that receives new codes
+	// ------------------------------------------------------------------------
+	public void addAlarmCodeListener(SampleListener<AlarmCode> listener) {
+		_codeReader.addListener(listener);
+	}
 	
 	// ------------------------------------------------------------------------
 	// Block the current thread until alarms become available, or a timeout
-	// has occurred.
+	// has occurred.  Codes that have arrived are processed before and after
+	// waiting, so alarms can be expanded as soon as possible.
 	// ------------------------------------------------------------------------
 	public void waitForAlarms(Duration_t waitTime) 
 			throws InterruptedException {
-		_reader.waitForData(waitTime);
+		takeAlarmCodes();
+		try {
+			_reader.waitForData(waitTime);
+		} finally {
+			takeAlarmCodes();
+		}
+	}
+
+	private void takeAlarmCodes() throws InterruptedException {
+		try {
+			_codeReader.waitForData(new Duration_t(0, 0));
+		} catch (RETCODE_TIMEOUT e) {
+			// No new codes
+		}
 	}
 }
@@ -13,6 +13,7 @@ package com.rti.medical;
 
 import com.rti.dds.infrastructure.Duration_t;
 import com.rti.dds.infrastructure.RETCODE_TIMEOUT;
+import com.rti.medical.generated.AlarmCode;
 
 
 public class ICEAlarmDisplayApp {
@@ -49,10 +50,25 @@ public class ICEAlarmDisplayApp {
 			// This displays alarms
 			final ICEDisplay display = new ICEDisplay();
 			
+			// Alarms refer to devices and metrics by code.  The table keeps
+			// the codes as they arrive.
+			AlarmCodeTable codeTable = new AlarmCodeTable();
+			dataInterface.addAlarmCodeListener(codeTable);
+
 			// Listener that updates the display when an alarm arrives. This
 			// class is notified when Alarms arrive, and updates the UI.
-			dataInterface.addAlarmListener(
-					new AlarmListener(display));
+			final AlarmListener alarmListener = 
+					new AlarmListener(display, codeTable);
+			dataInterface.addAlarmListener(alarmListener);
+
+			// Alarms that arrived before their codes are displayed when the
+			// codes arrive
+			dataInterface.addAlarmCodeListener(
+					new SampleListener<AlarmCode>() {
+				public void processSample(AlarmCode sample) {
+					alarmListener.processPendingAlarms();
+				}
+			});
 
 			//Schedule a job for the event-dispatching thread:
 	        //creating and showing this application's GUI.
@@ -0,0 +1,288 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include "DDSInfusionInterlockInterface.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+const char *INFUSION_INTERLOCK_REQUESTOR = "InfusionInterlock";
+
+// Converts a DDS timestamp to nanoseconds, the unit used by the engine
+static int64_t ToNanoseconds(const DDS_Time_t &time)
+{
+	return (int64_t)time.sec * 1000000000LL + time.nanosec;
+}
+
+// Bound of the string<64> device identifier in ice.idl
+static const size_t IDENTIFIER_BOUND = 64;
+
+// Applies the patient-device mapping changes to the engine
+class InterlockMappingUpdater : public PatientMappingListener
+{
+public:
+	InterlockMappingUpdater(InterlockEngine &engine) :
+		_engine(engine)
+	{
+	}
+
+	virtual void MappingsChanged(
+		const std::vector<PatientMappingChange> &changes)
+	{
+		for (size_t i = 0; i < changes.size(); i++)
+		{
+			if (changes[i].removed)
+			{
+				_engine.RemoveDevicePatient(changes[i].deviceId);
+			} else
+			{
+				_engine.SetDevicePatient(changes[i].deviceId,
+					changes[i].patientId);
+			}
+		}
+	}
+
+private:
+	InterlockEngine &_engine;
+};
+
+// ----------------------------------------------------------------------------
+// The DDSInfusionInterlockInterface is the network interface to the infusion
+// interlock.  This creates DataReaders to receive numerics, patient-device
+// mappings and pump status, and a DataWriter to send infusion objectives.
+//
+// The device data is sent on domain 5, the same domain used by the device
+// data replay.
+// ------------------------------------------------------------------------- //
+
+DDSInfusionInterlockInterface::DDSInfusionInterlockInterface(
+	bool multicastAvailable) :
+	_objectiveCount(0),
+	_writeFailureCount(0)
+{
+	_communicator = new DDSCommunicator();
+
+	std::vector<std::string> xmlFiles;
+
+	// Adding the XML files that contain profiles used by this application
+	xmlFiles.push_back(
+		"file://../../../src/Config/qos_profiles.xml");
+
+	// Configuring this application for multicast or no multicast.  Note that
+	// if you have no multicast, you will have to edit the XML QoS
+	// configuration to add the IP addresses of applications you want to
+	// discover and communicate with.
+	std::string participantProfile;
+	if (multicastAvailable)
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT;
+	} else
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
+	}
+
+	if (NULL == _communicator->CreateParticipant(5, xmlFiles,
+				ICE_QOS_LIBRARY, participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	// The Subscriber has the default QoS, so its DataReaders match the
+	// DataWriters of the devices.  The mappings are read on a coherent
+	// Subscriber of their own (see DDSPatientTransfer.h).
+	DDS::Publisher *pub = _communicator->CreatePublisher();
+	DDS::Subscriber *sub = _communicator->CreateSubscriber();
+	if (pub == NULL || sub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Publisher or Subscriber object";
+		throw errss.str();
+	}
+
+	// The interlock watches the whole unit, so this application receives
+	// the device data of every patient group
+	SubscribeToAllPatientGroups(sub);
+
+	_numericReader = new GenericDataReader<ice::Numeric>(_communicator,
+		ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+
+	DDS::Topic *mappingTopic =
+		_communicator->CreateTopic<DevicePatientMapping>(
+			DevicePatientMappingTopic);
+	_mappingReader = new DDSPatientMappingReader(
+		_communicator->GetParticipant(), mappingTopic,
+		ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES);
+
+	_statusReader = new GenericDataReader<ice::InfusionStatus>(
+		_communicator, ice::InfusionStatusTopic, ICE_QOS_LIBRARY,
+		QOS_PROFILE_INFUSION_CONTROL);
+	_objectiveWriter = new GenericDataWriter<ice::InfusionObjective>(
+		_communicator, ice::InfusionObjectiveTopic, ICE_QOS_LIBRARY,
+		QOS_PROFILE_INFUSION_CONTROL);
+
+	// Every objective has the same requestor and asks for a stop, so only
+	// the key is set before each write
+	strcpy(_objective.requestor, INFUSION_INTERLOCK_REQUESTOR);
+	_objective.stopInfusion = DDS_BOOLEAN_TRUE;
+
+	_waitSet = new DDS::WaitSet();
+	_waitSet->attach_condition(_numericReader->GetCondition());
+	_waitSet->attach_condition(_mappingReader->GetCondition());
+	_waitSet->attach_condition(_statusReader->GetCondition());
+}
+
+// ----------------------------------------------------------------------------
+// Destructor.
+// Deletes the WaitSet, the DataReaders, the DataWriter, and the Communicator
+// object
+DDSInfusionInterlockInterface::~DDSInfusionInterlockInterface()
+{
+	_waitSet->detach_condition(_numericReader->GetCondition());
+	_waitSet->detach_condition(_mappingReader->GetCondition());
+	_waitSet->detach_condition(_statusReader->GetCondition());
+	delete _waitSet;
+
+	delete _numericReader;
+	delete _mappingReader;
+	delete _statusReader;
+	delete _objectiveWriter;
+
+	delete _communicator;
+}
+
+int64_t DDSInfusionInterlockInterface::GetCurrentTime()
+{
+	DDS_Time_t now;
+	_communicator->GetParticipant()->get_current_time(now);
+	return ToNanoseconds(now);
+}
+
+// ----------------------------------------------------------------------------
+// Waits for data.  The mappings and the pump status are applied first, so
+// the numerics that arrive together with them are checked against the new
+// state.
+void DDSInfusionInterlockInterface::ProcessAvailableData(
+	InterlockEngine &engine, const DDS_Duration_t &timeout,
+	std::vector<InterlockStop> &completed)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode == DDS_RETCODE_TIMEOUT)
+	{
+		return;
+	}
+	if (retcode != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure waiting for interlock data";
+		throw errss.str();
+	}
+
+	ProcessMappings(engine);
+	ProcessPumpStatus(engine, completed);
+	ProcessNumerics(engine);
+}
+
+void DDSInfusionInterlockInterface::ProcessMappings(InterlockEngine &engine)
+{
+	InterlockMappingUpdater updater(engine);
+	_mappingReader->ProcessChanges(updater);
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available pump status.  A pump that is no longer alive is
+// removed from the engine.
+void DDSInfusionInterlockInterface::ProcessPumpStatus(InterlockEngine &engine,
+	std::vector<InterlockStop> &completed)
+{
+	LoanedBatch<ice::InfusionStatus> batch;
+	DdsAutoType<ice::InfusionStatus> key;
+
+	while (_statusReader->Take(batch))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			if (batch.IsValid(i))
+			{
+				const ice::InfusionStatus &status = batch.GetData(i);
+				engine.OnPumpStatus(status.unique_device_identifier,
+					status.infusionActive ? true : false,
+					ToNanoseconds(info.reception_timestamp), completed);
+			} else if (info.instance_state != DDS_ALIVE_INSTANCE_STATE &&
+				_statusReader->GetDataReader()->get_key_value(key,
+					info.instance_handle) == DDS_RETCODE_OK)
+			{
+				engine.RemovePump(key.unique_device_identifier);
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available numerics, and stops the pumps as soon as a batch has
+// been checked, before the next batch is taken.
+void DDSInfusionInterlockInterface::ProcessNumerics(InterlockEngine &engine)
+{
+	LoanedBatch<ice::Numeric> batch;
+
+	while (_numericReader->Take(batch))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			if (!batch.IsValid(i))
+			{
+				continue;
+			}
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			const ice::Numeric &numeric = batch.GetData(i);
+			engine.OnNumeric(numeric.unique_device_identifier,
+				numeric.metric_id, numeric.value,
+				ToNanoseconds(info.source_timestamp),
+				ToNanoseconds(info.reception_timestamp), _commands);
+		}
+
+		if (!_commands.empty())
+		{
+			StopPumps(engine);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Writes a stop objective to each commanded pump.  The write is synchronous,
+// so the time recorded after it is the time the objective left this
+// application.
+void DDSInfusionInterlockInterface::StopPumps(InterlockEngine &engine)
+{
+	for (size_t i = 0; i < _commands.size(); i++)
+	{
+		const std::string &pumpId = _commands[i].pumpId;
+		strncpy(_objective.unique_device_identifier, pumpId.c_str(),
+			IDENTIFIER_BOUND);
+		_objective.unique_device_identifier[IDENTIFIER_BOUND] = '\0';
+
+		if (_objectiveWriter->Write(_objective))
+		{
+			engine.OnCommandSent(pumpId, GetCurrentTime());
+			_objectiveCount++;
+		} else
+		{
+			engine.OnCommandFailed(pumpId);
+			_writeFailureCount++;
+		}
+	}
+	_commands.clear();
+}
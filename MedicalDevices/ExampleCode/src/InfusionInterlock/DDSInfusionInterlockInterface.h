@@ -0,0 +1,145 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_INFUSION_INTERLOCK_INTERFACE_H
+#define DDS_INFUSION_INTERLOCK_INTERFACE_H
+
+#include <sstream>
+#include <vector>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataReader.h"
+#include "../CommonInfrastructure/DDSGenericDataWriter.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
+#include "InterlockEngine.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// The infusion interlock interface receives numerics, patient-device
+// mappings and the status of the infusion pumps, and stops the pumps of a
+// patient whose numerics break an alarm condition.
+//
+// Reading sensor data:
+// --------------------
+// ice::Numeric data is read with the StreamingData QoS profile, and every
+// numeric is checked against the rules of the engine as soon as it is
+// taken.  The source timestamp of a numeric is the time it was measured at
+// the sensor.
+//
+// Reading pump status:
+// --------------------
+// ice::InfusionStatus data is read with the InfusionControl QoS profile.
+// Every device that sends one is a pump.  A pump that reports it is no
+// longer infusing confirms a stop, and a pump that is no longer alive is
+// forgotten.
+//
+// Stopping pumps:
+// ---------------
+// An ice::InfusionObjective with stopInfusion set is written to each pump
+// the engine decides to stop, with the InfusionControl QoS profile, from the
+// thread that read the numeric.  That profile sends the objective
+// synchronously and reliably, with a high transport priority, and repairs a
+// lost objective within milliseconds (see qos_profiles.xml).
+//
+// All DataReaders are read by a single thread that waits on one WaitSet, so
+// the engine needs no locking.  The mappings and the pump status are
+// processed before the numerics, so a numeric is checked against the
+// latest state of the pumps.
+//
+// For information on the data types, please see the ice.idl and
+// patient.idl files.
+//
+// For information on the quality of service, please see the
+// qos_profiles.xml file.
+//
+// ----------------------------------------------------------------------------
+
+// Requestor of the objectives written by the interlock
+extern const char *INFUSION_INTERLOCK_REQUESTOR;
+
+class DDSInfusionInterlockInterface
+{
+
+public:
+
+	// --- Constructor ---
+	// Creates the DomainParticipant, the DataReaders of the numerics, the
+	// patient-device mappings and the pump status, and the DataWriter of
+	// the objectives.  Throws a std::string if any of them cannot be
+	// created.
+	DDSInfusionInterlockInterface(bool multicastAvailable);
+
+	// --- Destructor ---
+	~DDSInfusionInterlockInterface();
+
+	// --- Getter for Communicator ---
+	DDSCommunicator *GetCommunicator()
+	{
+		return _communicator;
+	}
+
+	// --- Processes received data ---
+	// Waits up to the timeout for data, passes it to the engine, and stops
+	// the pumps the engine commands.  Appends the stops the pumps confirmed.
+	// Throws a std::string if waiting fails.
+	void ProcessAvailableData(InterlockEngine &engine,
+		const DDS_Duration_t &timeout, std::vector<InterlockStop> &completed);
+
+	// --- Time ---
+	// The current time of the DDS clock, in nanoseconds
+	int64_t GetCurrentTime();
+
+	// --- Statistics ---
+	unsigned long GetObjectiveCount() const
+	{
+		return _objectiveCount;
+	}
+
+	unsigned long GetWriteFailureCount() const
+	{
+		return _writeFailureCount;
+	}
+
+private:
+	// --- Private methods ---
+	void ProcessMappings(InterlockEngine &engine);
+	void ProcessPumpStatus(InterlockEngine &engine,
+		std::vector<InterlockStop> &completed);
+	void ProcessNumerics(InterlockEngine &engine);
+	void StopPumps(InterlockEngine &engine);
+
+	// --- Private members ---
+
+	// Used to create basic DDS entities that all applications need
+	DDSCommunicator *_communicator;
+
+	GenericDataReader<ice::Numeric> *_numericReader;
+	DDSPatientMappingReader *_mappingReader;
+	GenericDataReader<ice::InfusionStatus> *_statusReader;
+	GenericDataWriter<ice::InfusionObjective> *_objectiveWriter;
+
+	// WaitSet used to wait for data on all readers
+	DDS::WaitSet *_waitSet;
+
+	// Reused for every objective and command, so stopping a pump does not
+	// allocate
+	DdsAutoType<ice::InfusionObjective> _objective;
+	std::vector<InterlockCommand> _commands;
+
+	unsigned long _objectiveCount;
+	unsigned long _writeFailureCount;
+};
+
+#endif
@@ -0,0 +1,211 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "DDSInfusionInterlockInterface.h"
+#include "InterlockEngine.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This application stops the infusion pumps of a patient as soon as one of
+// the patient's numerics breaks an alarm condition, such as an SpO2 below
+// 85%, and confirms each stop from the InfusionStatus of the pump (see
+// InterlockEngine.h).
+//
+// Every stop is printed with its latency from the sensor to the pump, and
+// the stops that take longer than the latency budget are printed as
+// violations, including the ones the pump has not confirmed yet.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+
+// Seconds between two reports of the statistics
+static const int32_t REPORT_SECONDS = 60;
+
+// Prints one stop, with the latency of each step of its path
+static void PrintStop(const char *what, const InterlockStop &stop,
+	int64_t now)
+{
+	cout << what << ": pump " << stop.pumpId << " of patient "
+		<< stop.patientId << ", " << stop.metricId << " = " << stop.value
+		<< " from " << stop.deviceId;
+	if (stop.confirmed)
+	{
+		cout << ", sensor to receive "
+			<< (double)(stop.receivedTime - stop.sensorTime) /
+				NANOSECONDS_PER_MILLISECOND
+			<< " ms, to command "
+			<< (double)(stop.commandTime - stop.sensorTime) /
+				NANOSECONDS_PER_MILLISECOND
+			<< " ms, to pump stop "
+			<< (double)(stop.confirmedTime - stop.sensorTime) /
+				NANOSECONDS_PER_MILLISECOND << " ms";
+	} else
+	{
+		cout << ", not confirmed after "
+			<< (double)(now - stop.sensorTime) / NANOSECONDS_PER_MILLISECOND
+			<< " ms";
+	}
+	cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	bool multicastAvailable = true;
+	long budgetMs = 250;
+	vector<InterlockRule> rules;
+
+	// Process the command-line arguments
+	for (int i = 0; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-multicast"))
+		{
+			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--rule") && i + 1 < argc)
+		{
+			InterlockRule rule;
+			if (!ParseInterlockRule(argv[++i], rule))
+			{
+				cout << "Bad rule: " << argv[i] << endl;
+				PrintHelp();
+				return -1;
+			}
+			rules.push_back(rule);
+		} else if (0 == strcmp(argv[i], "--budget-ms") && i + 1 < argc)
+		{
+			budgetMs = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else if (i > 0)
+		{
+			// If we have a parameter that is not the first one, and is not
+			// recognized, return an error.
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (budgetMs <= 0)
+	{
+		cout << "The latency budget must be positive" << endl;
+		return -1;
+	}
+	if (rules.empty())
+	{
+		AddDefaultInterlockRules(rules);
+	}
+
+	try
+	{
+		InterlockEngine engine(rules,
+			(int64_t)budgetMs * NANOSECONDS_PER_MILLISECOND);
+
+		// --------------------------------------------------------------------
+		// This is the network interface for this application - it passes
+		// the numerics, mappings and pump status it reads to the engine,
+		// and writes the objectives that stop the pumps.
+		DDSInfusionInterlockInterface interlockInterface(multicastAvailable);
+
+		cout << "Infusion interlock running with " << rules.size()
+			<< " rules and a budget of " << budgetMs << " ms" << endl;
+		for (size_t i = 0; i < rules.size(); i++)
+		{
+			cout << "    " << rules[i].metricId
+				<< (rules[i].below ? " < " : " > ") << rules[i].threshold
+				<< endl;
+		}
+
+		// The budget is checked at least every 10 ms, so a stop that is
+		// not confirmed is reported soon after the budget is spent
+		DDS_Duration_t waitTime = {0, 10000000};
+		int64_t lastReport = interlockInterface.GetCurrentTime();
+		vector<InterlockStop> stops;
+
+		while (1)
+		{
+			stops.clear();
+			interlockInterface.ProcessAvailableData(engine, waitTime, stops);
+
+			int64_t now = interlockInterface.GetCurrentTime();
+			for (size_t i = 0; i < stops.size(); i++)
+			{
+				PrintStop(stops[i].overBudget ? "Budget violation" :
+					"Pump stopped", stops[i], now);
+			}
+
+			stops.clear();
+			engine.CheckBudget(now, stops);
+			for (size_t i = 0; i < stops.size(); i++)
+			{
+				PrintStop("Budget violation", stops[i], now);
+			}
+
+			if (now - lastReport >=
+				(int64_t)REPORT_SECONDS * 1000 * NANOSECONDS_PER_MILLISECOND)
+			{
+				const InterlockStatistics &statistics =
+					engine.GetStatistics();
+				cout << "Pumps: " << engine.GetPumpCount()
+					<< ", conditions fired: " << statistics.conditionsFired
+					<< " (unmapped " << statistics.unmappedCount
+					<< "), stops commanded: " << statistics.stopsCommanded
+					<< ", confirmed: " << statistics.stopsConfirmed
+					<< ", pending: " << engine.GetPendingCount()
+					<< ", budget violations: "
+					<< statistics.budgetViolations << ", write failures: "
+					<< interlockInterface.GetWriteFailureCount()
+					<< ", max latency "
+					<< (double)statistics.maxLatency /
+						NANOSECONDS_PER_MILLISECOND << " ms" << endl;
+				lastReport = now;
+			}
+		}
+	}
+	catch (string message)
+	{
+		cout << "Application exception: " << message << endl;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --no-multicast" <<
+		"                 Do not use multicast " <<
+		"(note you must edit XML" << endl <<
+		"                                   " <<
+		"config to include IP addresses)"
+		<< endl;
+	cout <<
+		"    --rule <metric><op><value>" <<
+		"     Stop the pumps when a numeric is below (<)" << endl <<
+		"                                   " <<
+		"or above (>) a value.  Can be repeated (default:" << endl <<
+		"                                   " <<
+		"MDC_PULS_OXIM_SAT_O2<85 and MDC_RESP_RATE<8)"
+		<< endl;
+	cout <<
+		"    --budget-ms <n>" <<
+		"                Sensor to pump stop latency budget" << endl <<
+		"                                   " <<
+		"(default: 250)"
+		<< endl;
+}
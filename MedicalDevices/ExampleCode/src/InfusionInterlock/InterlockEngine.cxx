@@ -0,0 +1,250 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "InterlockEngine.h"
+
+bool ParseInterlockRule(const std::string &text, InterlockRule &rule)
+{
+	size_t position = text.find_first_of("<>");
+	if (position == std::string::npos || position == 0 ||
+		position + 1 >= text.size())
+	{
+		return false;
+	}
+
+	const char *threshold = text.c_str() + position + 1;
+	char *end = NULL;
+	float value = (float)strtod(threshold, &end);
+	if (end == threshold || *end != '\0')
+	{
+		return false;
+	}
+
+	rule.metricId = text.substr(0, position);
+	rule.below = text[position] == '<';
+	rule.threshold = value;
+	return true;
+}
+
+void AddDefaultInterlockRules(std::vector<InterlockRule> &rules)
+{
+	InterlockRule rule;
+	rule.below = true;
+
+	rule.metricId = "MDC_PULS_OXIM_SAT_O2";
+	rule.threshold = 85.0f;
+	rules.push_back(rule);
+
+	rule.metricId = "MDC_RESP_RATE";
+	rule.threshold = 8.0f;
+	rules.push_back(rule);
+}
+
+InterlockEngine::InterlockEngine(const std::vector<InterlockRule> &rules,
+	int64_t latencyBudget) :
+	_rules(rules),
+	_latencyBudget(latencyBudget)
+{
+	memset(&_statistics, 0, sizeof(_statistics));
+}
+
+void InterlockEngine::SetDevicePatient(const std::string &deviceId,
+	int patientId)
+{
+	_devicePatients[deviceId] = patientId;
+}
+
+void InterlockEngine::RemoveDevicePatient(const std::string &deviceId)
+{
+	_devicePatients.erase(deviceId);
+}
+
+// ----------------------------------------------------------------------------
+// There are only a few rules, and most numerics break none of them, so the
+// rules are searched before the patient of the device is looked up.
+const InterlockRule *InterlockEngine::FindBrokenRule(
+	const std::string &metricId, float value) const
+{
+	for (size_t i = 0; i < _rules.size(); i++)
+	{
+		const InterlockRule &rule = _rules[i];
+		if (rule.metricId != metricId)
+		{
+			continue;
+		}
+		if (rule.below ? value < rule.threshold : value > rule.threshold)
+		{
+			return &rule;
+		}
+	}
+	return NULL;
+}
+
+unsigned int InterlockEngine::OnNumeric(const std::string &deviceId,
+	const std::string &metricId, float value, int64_t sensorTime,
+	int64_t receivedTime, std::vector<InterlockCommand> &commands)
+{
+	_statistics.numericsIn++;
+	if (FindBrokenRule(metricId, value) == NULL)
+	{
+		return 0;
+	}
+	_statistics.conditionsFired++;
+
+	std::map<std::string, int>::const_iterator patient =
+		_devicePatients.find(deviceId);
+	if (patient == _devicePatients.end())
+	{
+		_statistics.unmappedCount++;
+		return 0;
+	}
+
+	// A patient has only a few pumps, and conditions fire rarely, so the
+	// pumps are searched rather than indexed by patient
+	unsigned int count = 0;
+	for (std::map<std::string, PumpState>::iterator it = _pumps.begin();
+		it != _pumps.end(); ++it)
+	{
+		PumpState &pump = it->second;
+		if (!pump.infusing || pump.stopping)
+		{
+			continue;
+		}
+		std::map<std::string, int>::const_iterator pumpPatient =
+			_devicePatients.find(it->first);
+		if (pumpPatient == _devicePatients.end() ||
+			pumpPatient->second != patient->second)
+		{
+			continue;
+		}
+
+		pump.stopping = true;
+		InterlockStop &stop = pump.stop;
+		stop.pumpId = it->first;
+		stop.patientId = patient->second;
+		stop.deviceId = deviceId;
+		stop.metricId = metricId;
+		stop.value = value;
+		stop.sensorTime = sensorTime;
+		stop.receivedTime = receivedTime;
+		stop.commandTime = 0;
+		stop.confirmedTime = 0;
+		stop.confirmed = false;
+		stop.overBudget = false;
+
+		InterlockCommand command;
+		command.pumpId = it->first;
+		command.patientId = patient->second;
+		commands.push_back(command);
+		count++;
+	}
+	return count;
+}
+
+void InterlockEngine::OnCommandSent(const std::string &pumpId, int64_t time)
+{
+	std::map<std::string, PumpState>::iterator it = _pumps.find(pumpId);
+	if (it != _pumps.end() && it->second.stopping)
+	{
+		it->second.stop.commandTime = time;
+		_statistics.stopsCommanded++;
+	}
+}
+
+void InterlockEngine::OnCommandFailed(const std::string &pumpId)
+{
+	std::map<std::string, PumpState>::iterator it = _pumps.find(pumpId);
+	if (it != _pumps.end())
+	{
+		it->second.stopping = false;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// A pump that is being stopped and still reports it is infusing has not
+// received the objective yet, so it stays pending.
+void InterlockEngine::OnPumpStatus(const std::string &pumpId,
+	bool infusionActive, int64_t receivedTime,
+	std::vector<InterlockStop> &completed)
+{
+	std::map<std::string, PumpState>::iterator it = _pumps.find(pumpId);
+	if (it == _pumps.end())
+	{
+		PumpState pump;
+		pump.infusing = infusionActive;
+		pump.stopping = false;
+		_pumps.insert(std::make_pair(pumpId, pump));
+		return;
+	}
+
+	PumpState &pump = it->second;
+	pump.infusing = infusionActive;
+	if (!pump.stopping || infusionActive)
+	{
+		return;
+	}
+
+	pump.stopping = false;
+	InterlockStop &stop = pump.stop;
+	stop.confirmed = true;
+	stop.confirmedTime = receivedTime;
+
+	int64_t latency = receivedTime - stop.sensorTime;
+	if (latency > _statistics.maxLatency)
+	{
+		_statistics.maxLatency = latency;
+	}
+	if (latency > _latencyBudget && !stop.overBudget)
+	{
+		_statistics.budgetViolations++;
+	}
+	stop.overBudget = latency > _latencyBudget;
+	_statistics.stopsConfirmed++;
+	completed.push_back(stop);
+}
+
+void InterlockEngine::RemovePump(const std::string &pumpId)
+{
+	_pumps.erase(pumpId);
+}
+
+void InterlockEngine::CheckBudget(int64_t now,
+	std::vector<InterlockStop> &late)
+{
+	for (std::map<std::string, PumpState>::iterator it = _pumps.begin();
+		it != _pumps.end(); ++it)
+	{
+		PumpState &pump = it->second;
+		if (!pump.stopping || pump.stop.overBudget ||
+			now - pump.stop.sensorTime <= _latencyBudget)
+		{
+			continue;
+		}
+		pump.stop.overBudget = true;
+		_statistics.budgetViolations++;
+		late.push_back(pump.stop);
+	}
+}
+
+unsigned int InterlockEngine::GetPendingCount() const
+{
+	unsigned int count = 0;
+	for (std::map<std::string, PumpState>::const_iterator it =
+		_pumps.begin(); it != _pumps.end(); ++it)
+	{
+		if (it->second.stopping)
+		{
+			count++;
+		}
+	}
+	return count;
+}
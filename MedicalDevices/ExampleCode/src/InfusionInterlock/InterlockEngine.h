@@ -0,0 +1,203 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef INTERLOCK_ENGINE_H
+#define INTERLOCK_ENGINE_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------- //
+//
+// Infusion interlock:
+// Decides which infusion pumps to stop when an alarm condition fires for a
+// patient, and tracks each stop until the pump confirms it.
+//
+// An alarm condition is a rule on the value of a numeric, such as an SpO2
+// below 85%.  When a numeric of a device that is mapped to a patient breaks
+// a rule, every pump of that patient that is infusing is stopped once.  A
+// pump is any device that sends an InfusionStatus, and its patient is found
+// through the same patient-device mapping as the sensors.
+//
+// Each stop records the times of the whole path, in nanoseconds of the DDS
+// clock: the source time of the numeric at the sensor, the time the
+// interlock received it, the time the objective was sent, and the time the
+// InfusionStatus of the pump reported it was no longer infusing.  The
+// latency of a stop is from the sensor to the confirmation, so the clocks
+// of the hosts must be synchronized for it to be meaningful.
+//
+// The interlock never restarts a pump.  A pump that reports it is infusing
+// again, because a clinician restarted it, can be stopped again by the next
+// numeric that breaks a rule.
+//
+// The engine is not thread safe.
+//
+// ------------------------------------------------------------------------- //
+
+// An alarm condition on the value of a numeric
+struct InterlockRule
+{
+	std::string metricId;
+
+	// True if the condition fires below the threshold, false if above
+	bool below;
+	float threshold;
+};
+
+// Parses a rule of the form METRIC<value or METRIC>value.  Returns false if
+// the text is not a rule.
+bool ParseInterlockRule(const std::string &text, InterlockRule &rule);
+
+// Adds the default rules: an SpO2 below 85%, and a respiration rate below 8
+// breaths per minute, the usual signs of opioid-induced respiratory
+// depression
+void AddDefaultInterlockRules(std::vector<InterlockRule> &rules);
+
+// A pump that must be sent a stop objective
+struct InterlockCommand
+{
+	std::string pumpId;
+	int patientId;
+};
+
+// The path of one stop, from the sensor to the confirmation by the pump
+struct InterlockStop
+{
+	std::string pumpId;
+	int patientId;
+
+	// The numeric that broke a rule
+	std::string deviceId;
+	std::string metricId;
+	float value;
+
+	// Times in nanoseconds of the DDS clock.  The command and confirmed
+	// times are zero until they happen.
+	int64_t sensorTime;
+	int64_t receivedTime;
+	int64_t commandTime;
+	int64_t confirmedTime;
+
+	bool confirmed;
+
+	// True once the stop took, or has been pending for, longer than the
+	// latency budget
+	bool overBudget;
+};
+
+// Counts since the engine was created
+struct InterlockStatistics
+{
+	uint64_t numericsIn;
+
+	// Numerics that broke a rule, and whether their device was mapped
+	uint64_t conditionsFired;
+	uint64_t unmappedCount;
+
+	uint64_t stopsCommanded;
+	uint64_t stopsConfirmed;
+	uint64_t budgetViolations;
+
+	// Largest sensor-to-confirmation latency of a confirmed stop, in
+	// nanoseconds
+	int64_t maxLatency;
+};
+
+class InterlockEngine
+{
+public:
+	// --- Constructor ---
+	// The latency budget is in nanoseconds, from the sensor to the
+	// confirmation of a stop
+	InterlockEngine(const std::vector<InterlockRule> &rules,
+		int64_t latencyBudget);
+
+	// --- Patient-device mapping ---
+	void SetDevicePatient(const std::string &deviceId, int patientId);
+	void RemoveDevicePatient(const std::string &deviceId);
+
+	// --- Sensor data ---
+	// Checks a numeric against the rules, and appends a command for every
+	// pump of its patient that is infusing and is not already being
+	// stopped.  Returns the number of commands appended.
+	unsigned int OnNumeric(const std::string &deviceId,
+		const std::string &metricId, float value, int64_t sensorTime,
+		int64_t receivedTime, std::vector<InterlockCommand> &commands);
+
+	// Records the time the stop objective of a pump was sent
+	void OnCommandSent(const std::string &pumpId, int64_t time);
+
+	// Abandons the stop of a pump whose objective could not be sent, so the
+	// next numeric that breaks a rule commands it again
+	void OnCommandFailed(const std::string &pumpId);
+
+	// --- Pump data ---
+	// Records the status of a pump.  A pump that is being stopped and
+	// reports it is no longer infusing completes its stop, which is
+	// appended to the completed stops.
+	void OnPumpStatus(const std::string &pumpId, bool infusionActive,
+		int64_t receivedTime, std::vector<InterlockStop> &completed);
+
+	// Forgets a pump that is no longer alive.  A stop in progress is
+	// abandoned.
+	void RemovePump(const std::string &pumpId);
+
+	// --- Latency budget ---
+	// Appends the stops that have been pending for longer than the budget
+	// at the time now, once each
+	void CheckBudget(int64_t now, std::vector<InterlockStop> &late);
+
+	int64_t GetLatencyBudget() const
+	{
+		return _latencyBudget;
+	}
+
+	// --- Accessors ---
+	unsigned int GetPumpCount() const
+	{
+		return (unsigned int)_pumps.size();
+	}
+
+	unsigned int GetPendingCount() const;
+
+	const InterlockStatistics &GetStatistics() const
+	{
+		return _statistics;
+	}
+
+private:
+	// --- Private types ---
+	struct PumpState
+	{
+		bool infusing;
+		bool stopping;
+		InterlockStop stop;
+	};
+
+	// --- Private methods ---
+	const InterlockRule *FindBrokenRule(const std::string &metricId,
+		float value) const;
+
+	// --- Private members ---
+	std::vector<InterlockRule> _rules;
+	int64_t _latencyBudget;
+
+	// Patient of every mapped device, sensors and pumps alike
+	std::map<std::string, int> _devicePatients;
+
+	// Every pump that sent a status, by device ID
+	std::map<std::string, PumpState> _pumps;
+
+	InterlockStatistics _statistics;
+};
+
+#endif
@@ -8,6 +8,7 @@
  any incidental or consequential damages arising out of the use or inability to
  use the software.
  ******************************************************************************/
+#include <string.h>
 #include "DDSPatientDeviceInterface.h"
 #include "../Generated/profiles.h"
 
@@ -42,10 +43,11 @@ using namespace com::rti::medical::generated;
 // ------------------------------------------------------------------------- //
 
 DDSPatientDevicePubInterface::DDSPatientDevicePubInterface(
-	bool multicastAvailable) 
+	bool multicastAvailable, bool fastStart, StartupProfile *startupProfile) 
 {
 
 	_communicator = new DDSCommunicator();
+	_communicator->SetStartupProfile(startupProfile);
 
 	std::vector<std::string> xmlFiles;
 
@@ -76,8 +78,20 @@ DDSPatientDevicePubInterface::DDSPatientDevicePubInterface(
 	// Topics, etc.  Note:  The string constants with the QoS library name and 
 	// the QoS profile name are configured as constants in the .idl file.  The
 	// profiles themselves are configured in the .xml file.
-	if (NULL == _communicator->CreateParticipant(5, xmlFiles, 
-				ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES)) 
+	//
+	// In fast-start mode, the DomainParticipant is created disabled, so it
+	// does not start discovery until all of its entities exist.
+	DDS::DomainParticipant *participant = NULL;
+	if (fastStart) 
+	{
+		participant = _communicator->CreateDisabledParticipant(5, xmlFiles,
+			ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES_FAST_START);
+	} else 
+	{
+		participant = _communicator->CreateParticipant(5, xmlFiles, 
+			ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES);
+	}
+	if (NULL == participant) 
 	{
 		std::stringstream errss;
 		errss << "Failed to create DomainParticipant object";
@@ -86,9 +100,12 @@ DDSPatientDevicePubInterface::DDSPatientDevicePubInterface(
 
 	// Create a Publisher
 	// This application only writes data, so we only need to create a
-	// publisher.  
+	// publisher.  The publisher uses the patient transfer profile, which
+	// enables coherent access, so that a transfer can group the changes of
+	// several mappings into one coherent set.
 	// Note that one Publisher can be used to create multiple DataWriters
-	DDS::Publisher *pub = _communicator->CreatePublisher();
+	DDS::Publisher *pub = _communicator->CreatePublisher(ICE_QOS_LIBRARY,
+		QOS_PROFILE_PATIENT_TRANSFER);
 
 	if (pub == NULL) 
 	{
@@ -110,31 +127,27 @@ DDSPatientDevicePubInterface::DDSPatientDevicePubInterface(
 	// you define your topic name in IDL, but it is a best practice for
 	// ensuring the data interface of an application is all defined in one 
 	// place. You can register all topics and types up-front, if you nee
-	DDS::Topic *topic = _communicator->CreateTopic<DevicePatientMapping>( 
-		DevicePatientMappingTopic);
-
 
 	// Create a DataWriter.  
-	// This creates a single DataWriter that writes patient-device 
-	// mapping data, with QoS  that is used for State Data.	Note: The string 
-	// constants with the QoS library name and the QoS profile name are 
-	// configured as constants in the .idl file.  The profiles themselves 
-	// are configured in the .xml file.
-	DDS::DataWriter *writer = pub->create_datawriter_with_profile(topic, 
-		ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES,
-		NULL, DDS_STATUS_MASK_NONE);
-
-	// Downcast the generic datawriter to a device-patient mapping DataWriter 
-	_writer = DevicePatientMappingDataWriter::narrow(writer);
-
-	if (_writer == NULL) 
+	// This creates the Topic, and a single DataWriter that writes 
+	// patient-device mapping data, with QoS that is used for State Data,
+	// from the Publisher created above.  Note: The string constants with the
+	// QoS library name and the QoS profile name are configured as constants
+	// in the .idl file.  The profiles themselves are configured in the .xml
+	// file.
+	_writer = new GenericDataWriter<DevicePatientMapping>(_communicator,
+		DevicePatientMappingTopic, ICE_QOS_LIBRARY,
+		QOS_PROFILE_PATIENT_DEVICES);
+
+	// Announce the DomainParticipant and the DataWriter at once
+	if (fastStart) 
 	{
-		std::stringstream errss;
-		errss << 
-			"Failure to create DevicePatientMapping writer. Inconsistent Qos?";
-		throw errss.str();
+		_communicator->EnableParticipant();
 	}
 
+	// Checks for acknowledgments of mappings sent with PublishAsync
+	DDS_Duration_t checkPeriod = {0, 10000000};
+	_asyncPublisher = new DDSAsyncPublisher(checkPeriod);
 }
 
 // ----------------------------------------------------------------------------
@@ -142,8 +155,10 @@ DDSPatientDevicePubInterface::DDSPatientDevicePubInterface(
 // Deletes the DataWriter, and the Communicator object
 DDSPatientDevicePubInterface::~DDSPatientDevicePubInterface()
 {
-	DDS::Publisher *pub = _writer->get_publisher();
-	pub->delete_datawriter(_writer);
+	// Stop checking for acknowledgments before deleting the DataWriter
+	delete _asyncPublisher;
+
+	delete _writer;
 	_writer = NULL;
 
 	delete _communicator;
@@ -156,19 +171,74 @@ DDSPatientDevicePubInterface::~DDSPatientDevicePubInterface()
 // any DataReader that shares the same Topic
 bool DDSPatientDevicePubInterface::Publish(DdsAutoType<DevicePatientMapping> data)
 {
-	DDS_ReturnCode_t retcode = DDS_RETCODE_OK;
-	DDS_InstanceHandle_t handle = DDS_HANDLE_NIL;
-
 	// This actually sends the device-patient mapping data over the network.  
-	retcode = _writer->write(data, handle);
+	return _writer->Write(data);
+
+}
+
+// ----------------------------------------------------------------------------
+// Sends the device-patient mapping the same way as Publish, but also tracks
+// its acknowledgment by the reliable DataReaders, without blocking this thread
+PublicationFuture DDSPatientDevicePubInterface::PublishAsync(
+	DdsAutoType<DevicePatientMapping> data,
+	const DDS_Duration_t &deadline,
+	PublicationListener *listener)
+{
+	return _asyncPublisher->Publish<DevicePatientMapping>(
+		_writer->GetDataWriter(), data, deadline, listener);
+}
+
+// ----------------------------------------------------------------------------
+// Waits on the PublicationMatched status of the DataWriter until a DataReader
+// has matched it.  The time spent waiting is recorded as the first
+// publication match phase of the startup profile.
+bool DDSPatientDevicePubInterface::WaitForFirstMatch(
+	const DDS_Duration_t &timeout)
+{
+	StartupPhaseTimer timer(_communicator->GetStartupProfile(), 
+		"first publication match");
 
-	if (retcode != DDS_RETCODE_OK) 
+	DDS::DataWriter *writer = _writer->GetDataWriter();
+	DDS_PublicationMatchedStatus status;
+	writer->get_publication_matched_status(status);
+	if (status.current_count > 0) 
 	{
-		return false;
+		return true;
 	}
 
-	return true;
+	DDS::StatusCondition *condition = writer->get_statuscondition();
+	condition->set_enabled_statuses(DDS_PUBLICATION_MATCHED_STATUS);
+
+	DDS::WaitSet waitSet;
+	waitSet.attach_condition(condition);
+
+	DDS::ConditionSeq activeConditions;
+	DDS_Duration_t remaining = timeout;
+	int64_t deadline = OSGetMonotonicTime() + 
+		(int64_t)timeout.sec * 1000000000 + timeout.nanosec;
+
+	bool matched = false;
+	while (!matched) 
+	{
+		if (waitSet.wait(activeConditions, remaining) != DDS_RETCODE_OK) 
+		{
+			break;
+		}
+		writer->get_publication_matched_status(status);
+		matched = (status.current_count > 0);
 
+		// Wait again only for the rest of the timeout
+		int64_t left = deadline - OSGetMonotonicTime();
+		if (left <= 0) 
+		{
+			break;
+		}
+		remaining.sec = (DDS_Long)(left / 1000000000);
+		remaining.nanosec = (DDS_UnsignedLong)(left % 1000000000);
+	}
+
+	waitSet.detach_condition(condition);
+	return matched;
 }
 
 // ----------------------------------------------------------------------------
@@ -178,21 +248,54 @@ bool DDSPatientDevicePubInterface::Publish(DdsAutoType<DevicePatientMapping> dat
 // this patient, and the mapping between them should be deleted
 bool DDSPatientDevicePubInterface::Delete(DdsAutoType<DevicePatientMapping> data)
 {
-	DDS_ReturnCode_t retcode = DDS_RETCODE_OK;
-	DDS_InstanceHandle_t handle = DDS_HANDLE_NIL;
-
 	// Note that the deletion maps to an "unregister" in the RTI Connext
 	// DDS world.  This allows the instance to be cleaned up entirely, 
 	// so the space can be reused for another instance.  If you call
 	// "dispose" it will not clean up the space for a new instance - 
 	// instead it marks the current instance disposed and expects that you
 	// might reuse the same instance again later.
-	retcode = _writer->unregister_instance(data, handle);
+	return _writer->Unregister(data);
+}
 
-	if (retcode != DDS_RETCODE_OK)
+// ----------------------------------------------------------------------------
+// Sends all the mapping changes of the transfer between
+// begin_coherent_changes and end_coherent_changes, so they are delivered as
+// one coherent set.  A removal unregisters the mapping, the same way as
+// Delete.
+bool DDSPatientDevicePubInterface::Transfer(const PatientTransfer &transfer)
+{
+	DDS::Publisher *pub = _writer->GetDataWriter()->get_publisher();
+	if (pub->begin_coherent_changes() != DDS_RETCODE_OK)
 	{
 		return false;
 	}
 
-	return true;
+	bool sent = true;
+	DdsAutoType<DevicePatientMapping> data;
+	const std::vector<PatientMappingChange> &changes = transfer.GetChanges();
+	for (size_t i = 0; i < changes.size() && sent; i++)
+	{
+		// Device IDs are bounded to 64 characters in ice.idl
+		if (changes[i].deviceId.size() > 64)
+		{
+			sent = false;
+			break;
+		}
+		strcpy(data.device_id, changes[i].deviceId.c_str());
+		data.patient_id = changes[i].patientId;
+
+		if (changes[i].removed)
+		{
+			sent = _writer->Unregister(data);
+		} else
+		{
+			sent = _writer->Write(data);
+		}
+	}
+
+	if (pub->end_coherent_changes() != DDS_RETCODE_OK)
+	{
+		return false;
+	}
+	return sent;
 }
@@ -12,7 +12,10 @@
 #define DDS_PATIENT_DEVICE_INTERFACE_H
 
 #include <sstream>
+#include "../CommonInfrastructure/DDSAsyncPublisher.h"
 #include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataWriter.h"
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
 #include "../CommonInfrastructure/DDSTypeWrapper.h"
 #include "../Generated/patient.h"
 #include "../Generated/patientSupport.h"
@@ -32,6 +35,10 @@
 // both existing and late-joining applications that subscribe to patient-device
 // data.
 //
+// Changes to the mappings of several devices, such as moving a patient to
+// another bed, can be sent as one coherent set with Transfer, so that
+// applications never see the half-remapped states in between.
+//
 // For information on the patient-device data type, please see the 
 // patient.idl and ice.idl files.  
 //
@@ -49,7 +56,14 @@ public:
 	// DomainParticipant, creating all publishers and subscribers, topics 
 	// writers and readers.  Takes as input a vector of xml QoS files that
 	// should be loaded to find QoS profiles and libraries.
-	DDSPatientDevicePubInterface(bool multicastAvailable);
+	//
+	// In fast-start mode, the DomainParticipant uses a QoS profile with
+	// tuned discovery, and is created disabled and enabled only after the
+	// DataWriter is created, so the DataWriter is announced together with
+	// the DomainParticipant.  If a startup profile is given, the time spent
+	// in each startup phase is recorded into it.
+	DDSPatientDevicePubInterface(bool multicastAvailable, 
+		bool fastStart = false, StartupProfile *startupProfile = NULL);
 
 	// --- Destructor --- 
 	~DDSPatientDevicePubInterface();
@@ -72,12 +86,34 @@ public:
 			DdsAutoType<com::rti::medical::generated::DevicePatientMapping> 
 				data);
 
+	// --- Sends the device-patient mapping without blocking ---
+	// Same as Publish, but returns a future that completes when every
+	// reliable application subscribing to patient-device data has
+	// acknowledged the mapping, or when the deadline passes.
+	PublicationFuture PublishAsync(
+			DdsAutoType<com::rti::medical::generated::DevicePatientMapping>
+				data,
+			const DDS_Duration_t &deadline,
+			PublicationListener *listener = NULL);
+
+	// --- Waits for the first subscribing application ---
+	// Blocks until at least one DataReader of patient-device data matches the
+	// DataWriter, or the timeout passes.  Returns false on timeout.
+	bool WaitForFirstMatch(const DDS_Duration_t &timeout);
+
 	// --- Deletes the patient-device mapping---
 	// "Deletes" the patient-device mapping from the system - removing the DDS  
 	// instance from all applications.
 	bool Delete(DdsAutoType<com::rti::medical::generated::DevicePatientMapping>
 				data);
 
+	// --- Sends a set of mapping changes together ---
+	// Publishes and deletes the mappings of the transfer as one coherent
+	// set.  Subscribers that use the PatientTransfer QoS profile apply all
+	// the changes at once.  If a change fails, the changes before it are
+	// still sent when the set ends, and false is returned.
+	bool Transfer(const PatientTransfer &transfer);
+
 private:
 	// --- Private members ---
 
@@ -85,7 +121,11 @@ private:
 	DDSCommunicator *_communicator;
 
 	// Device-patient mapping publisher specific to this application
-	com::rti::medical::generated::DevicePatientMappingDataWriter *_writer;
+	GenericDataWriter<com::rti::medical::generated::DevicePatientMapping>
+		*_writer;
+
+	// Completes the futures returned by PublishAsync
+	DDSAsyncPublisher *_asyncPublisher;
 };
 
 #endif
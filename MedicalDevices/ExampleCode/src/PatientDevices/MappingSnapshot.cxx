@@ -0,0 +1,581 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include "MappingSnapshot.h"
+#include "../CommonInfrastructure/OSAPI.h"
+
+using namespace std;
+using namespace com::rti::medical::generated;
+
+// Device IDs are bounded to 64 characters in ice.idl
+static const size_t DEVICE_ID_BOUND = 64;
+
+// Layout of the binary format
+static const char BINARY_MAGIC[4] = {'P', 'D', 'M', 'S'};
+static const uint32_t BINARY_VERSION = 1;
+static const size_t BINARY_HEADER_SIZE = 16;
+static const size_t BINARY_RECORD_SIZE = DEVICE_ID_BOUND + 4;
+
+// Smaller files are not worth starting a thread for each part
+static const size_t MIN_BYTES_PER_THREAD = 256 * 1024;
+
+// ----------------------------------------------------------------------------
+// Parsing one part of a file
+struct SnapshotPart
+{
+	const unsigned char *begin;
+	const unsigned char *end;
+	bool binary;
+
+	// Only the first part of a CSV file can start with a header
+	bool first;
+
+	std::vector<DeviceMapping> mappings;
+
+	// Lines (or records) in the part, and the one of the first error,
+	// counting from 1, or 0 if there is no error
+	unsigned int lineCount;
+	unsigned int errorLine;
+	std::string error;
+};
+
+static uint32_t ReadLittleEndian32(const unsigned char *data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+		((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void WriteLittleEndian32(unsigned char *data, uint32_t value)
+{
+	data[0] = (unsigned char)value;
+	data[1] = (unsigned char)(value >> 8);
+	data[2] = (unsigned char)(value >> 16);
+	data[3] = (unsigned char)(value >> 24);
+}
+
+static bool IsBlank(unsigned char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parses a whole field as a 32-bit patient ID
+static bool ParsePatientId(const unsigned char *begin,
+	const unsigned char *end, PatientId &patientId)
+{
+	bool negative = false;
+	if (begin < end && (*begin == '-' || *begin == '+'))
+	{
+		negative = *begin == '-';
+		begin++;
+	}
+	if (begin == end)
+	{
+		return false;
+	}
+
+	int64_t value = 0;
+	for (; begin < end; begin++)
+	{
+		if (*begin < '0' || *begin > '9')
+		{
+			return false;
+		}
+		value = value * 10 + (*begin - '0');
+		if (value > 2147483648LL)
+		{
+			return false;
+		}
+	}
+	if (negative)
+	{
+		value = -value;
+	}
+	if (value > 2147483647LL)
+	{
+		return false;
+	}
+	patientId = (PatientId)value;
+	return true;
+}
+
+static void ParseCsv(SnapshotPart &part)
+{
+	bool headerAllowed = part.first;
+	const unsigned char *line = part.begin;
+	while (line < part.end)
+	{
+		const unsigned char *lineEnd = (const unsigned char *)memchr(line,
+			'\n', part.end - line);
+		if (lineEnd == NULL)
+		{
+			lineEnd = part.end;
+		}
+		part.lineCount++;
+
+		const unsigned char *begin = line;
+		const unsigned char *end = lineEnd;
+		line = lineEnd < part.end ? lineEnd + 1 : part.end;
+		while (begin < end && IsBlank(*begin))
+		{
+			begin++;
+		}
+		while (end > begin && IsBlank(end[-1]))
+		{
+			end--;
+		}
+		if (begin == end || *begin == '#')
+		{
+			continue;
+		}
+
+		const unsigned char *comma = (const unsigned char *)memchr(begin,
+			',', end - begin);
+		if (comma == NULL)
+		{
+			part.errorLine = part.lineCount;
+			part.error = "expected device_id,patient_id";
+			return;
+		}
+		const unsigned char *deviceEnd = comma;
+		while (deviceEnd > begin && IsBlank(deviceEnd[-1]))
+		{
+			deviceEnd--;
+		}
+		const unsigned char *patient = comma + 1;
+		while (patient < end && IsBlank(*patient))
+		{
+			patient++;
+		}
+
+		PatientId patientId = 0;
+		if (!ParsePatientId(patient, end, patientId))
+		{
+			if (headerAllowed)
+			{
+				headerAllowed = false;
+				continue;
+			}
+			part.errorLine = part.lineCount;
+			part.error = "the patient ID is not a 32-bit number";
+			return;
+		}
+		headerAllowed = false;
+
+		size_t deviceLength = deviceEnd - begin;
+		if (deviceLength == 0 || deviceLength > DEVICE_ID_BOUND)
+		{
+			part.errorLine = part.lineCount;
+			part.error = "the device ID must have 1 to 64 characters";
+			return;
+		}
+
+		part.mappings.push_back(DeviceMapping());
+		part.mappings.back().deviceId.assign((const char *)begin,
+			deviceLength);
+		part.mappings.back().patientId = patientId;
+	}
+}
+
+static void ParseBinary(SnapshotPart &part)
+{
+	for (const unsigned char *record = part.begin; record < part.end;
+		record += BINARY_RECORD_SIZE)
+	{
+		part.lineCount++;
+
+		const unsigned char *nul = (const unsigned char *)memchr(record, 0,
+			DEVICE_ID_BOUND);
+		size_t deviceLength = nul == NULL ? DEVICE_ID_BOUND : nul - record;
+		if (deviceLength == 0)
+		{
+			part.errorLine = part.lineCount;
+			part.error = "the device ID is empty";
+			return;
+		}
+
+		part.mappings.push_back(DeviceMapping());
+		part.mappings.back().deviceId.assign((const char *)record,
+			deviceLength);
+		part.mappings.back().patientId = (PatientId)(int32_t)
+			ReadLittleEndian32(record + DEVICE_ID_BOUND);
+	}
+}
+
+static void *ParsePartThread(void *param)
+{
+	SnapshotPart *part = (SnapshotPart *)param;
+	if (part->binary)
+	{
+		ParseBinary(*part);
+	} else
+	{
+		ParseCsv(*part);
+	}
+	return NULL;
+}
+
+// Hashes the contents eight bytes at a time, so an unchanged file is
+// recognized in a fraction of the time it takes to parse it
+static uint64_t Checksum(const unsigned char *data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * 1099511628211ULL;
+	}
+	for (; i < size; i++)
+	{
+		hash = (hash ^ data[i]) * 1099511628211ULL;
+	}
+	return hash ^ (uint64_t)size;
+}
+
+static bool DeviceLess(const DeviceMapping &first,
+	const DeviceMapping &second)
+{
+	return first.deviceId < second.deviceId;
+}
+
+// ----------------------------------------------------------------------------
+// Snapshot
+MappingSnapshot::MappingSnapshot() :
+	_duplicateCount(0),
+	_checksum(0),
+	_loaded(false)
+{
+}
+
+bool MappingSnapshot::Load(const string &fileName, unsigned int threadCount)
+{
+	OSMappedFile file;
+	if (!file.Open(fileName))
+	{
+		stringstream errss;
+		errss << "Mapping snapshot " << fileName
+			<< " cannot be read, or is empty";
+		throw errss.str();
+	}
+	const unsigned char *data = file.GetData();
+	size_t size = file.GetSize();
+
+	uint64_t checksum = Checksum(data, size);
+	if (_loaded && checksum == _checksum)
+	{
+		return false;
+	}
+
+	// Find the records, or the lines
+	bool binary = size >= BINARY_HEADER_SIZE &&
+		memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+	const unsigned char *begin = data;
+	const unsigned char *end = data + size;
+	if (binary)
+	{
+		uint32_t version = ReadLittleEndian32(data + 4);
+		uint32_t count = ReadLittleEndian32(data + 8);
+		uint32_t recordSize = ReadLittleEndian32(data + 12);
+		if (version != BINARY_VERSION || recordSize != BINARY_RECORD_SIZE ||
+			size != BINARY_HEADER_SIZE + (size_t)count * BINARY_RECORD_SIZE)
+		{
+			stringstream errss;
+			errss << "Mapping snapshot " << fileName
+				<< " has an unknown version, or is truncated";
+			throw errss.str();
+		}
+		begin += BINARY_HEADER_SIZE;
+	}
+
+	// Split the file into parts, at record or line boundaries
+	size_t partCount = size / MIN_BYTES_PER_THREAD;
+	if (partCount > threadCount)
+	{
+		partCount = threadCount;
+	}
+	if (partCount == 0)
+	{
+		partCount = 1;
+	}
+	vector<SnapshotPart> parts(partCount);
+	const unsigned char *partBegin = begin;
+	for (size_t i = 0; i < partCount; i++)
+	{
+		const unsigned char *partEnd = end;
+		if (i + 1 < partCount)
+		{
+			if (binary)
+			{
+				size_t records = (end - begin) / BINARY_RECORD_SIZE;
+				partEnd = begin + records * (i + 1) / partCount *
+					BINARY_RECORD_SIZE;
+			} else
+			{
+				partEnd = begin + (end - begin) * (i + 1) / partCount;
+				if (partEnd < partBegin)
+				{
+					partEnd = partBegin;
+				}
+				const unsigned char *newline = (const unsigned char *)
+					memchr(partEnd, '\n', end - partEnd);
+				partEnd = newline == NULL ? end : newline + 1;
+			}
+		}
+		parts[i].begin = partBegin;
+		parts[i].end = partEnd;
+		parts[i].binary = binary;
+		parts[i].first = i == 0;
+		parts[i].lineCount = 0;
+		parts[i].errorLine = 0;
+		partBegin = partEnd;
+	}
+
+	// Parse the first part on this thread, and the others in parallel
+	vector<OSThread *> threads;
+	for (size_t i = 1; i < partCount; i++)
+	{
+		threads.push_back(new OSThread(ParsePartThread, &parts[i]));
+		threads.back()->Run();
+	}
+	ParsePartThread(&parts[0]);
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i]->Join();
+		delete threads[i];
+	}
+
+	// Report the first error in the file
+	unsigned int lineOffset = 0;
+	size_t total = 0;
+	for (size_t i = 0; i < partCount; i++)
+	{
+		if (parts[i].errorLine != 0)
+		{
+			stringstream errss;
+			errss << "Mapping snapshot " << fileName
+				<< (binary ? ", record " : ", line ")
+				<< lineOffset + parts[i].errorLine << ": " << parts[i].error;
+			throw errss.str();
+		}
+		lineOffset += parts[i].lineCount;
+		total += parts[i].mappings.size();
+	}
+
+	// Sort the mappings by device, keeping the order of the file for each
+	// device, and keep the last mapping of each device
+	vector<DeviceMapping> mappings;
+	mappings.reserve(total);
+	for (size_t i = 0; i < partCount; i++)
+	{
+		for (size_t j = 0; j < parts[i].mappings.size(); j++)
+		{
+			mappings.push_back(DeviceMapping());
+			mappings.back().deviceId.swap(parts[i].mappings[j].deviceId);
+			mappings.back().patientId = parts[i].mappings[j].patientId;
+		}
+	}
+	stable_sort(mappings.begin(), mappings.end(), DeviceLess);
+
+	unsigned int duplicateCount = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < mappings.size(); i++)
+	{
+		if (i + 1 < mappings.size() &&
+			mappings[i + 1].deviceId == mappings[i].deviceId)
+		{
+			duplicateCount++;
+			continue;
+		}
+		if (kept != i)
+		{
+			mappings[kept].deviceId.swap(mappings[i].deviceId);
+			mappings[kept].patientId = mappings[i].patientId;
+		}
+		kept++;
+	}
+	mappings.resize(kept);
+
+	_mappings.swap(mappings);
+	_duplicateCount = duplicateCount;
+	_checksum = checksum;
+	_loaded = true;
+	return true;
+}
+
+// The file is written under a temporary name and renamed, so a reader never
+// sees it half written
+void MappingSnapshot::SaveBinary(const string &fileName) const
+{
+	string temporaryName = fileName + ".tmp";
+	FILE *file = fopen(temporaryName.c_str(), "wb");
+	if (file == NULL)
+	{
+		stringstream errss;
+		errss << "Cannot create mapping snapshot " << temporaryName;
+		throw errss.str();
+	}
+
+	unsigned char header[BINARY_HEADER_SIZE];
+	memcpy(header, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	WriteLittleEndian32(header + 4, BINARY_VERSION);
+	WriteLittleEndian32(header + 8, (uint32_t)_mappings.size());
+	WriteLittleEndian32(header + 12, (uint32_t)BINARY_RECORD_SIZE);
+	bool written = fwrite(header, sizeof(header), 1, file) == 1;
+
+	unsigned char record[BINARY_RECORD_SIZE];
+	for (size_t i = 0; i < _mappings.size() && written; i++)
+	{
+		memset(record, 0, DEVICE_ID_BOUND);
+		memcpy(record, _mappings[i].deviceId.c_str(),
+			min(_mappings[i].deviceId.size(), DEVICE_ID_BOUND));
+		WriteLittleEndian32(record + DEVICE_ID_BOUND,
+			(uint32_t)_mappings[i].patientId);
+		written = fwrite(record, sizeof(record), 1, file) == 1;
+	}
+
+	if (fclose(file) != 0 || !written ||
+		!OSRenameFile(temporaryName, fileName))
+	{
+		remove(temporaryName.c_str());
+		stringstream errss;
+		errss << "Cannot write mapping snapshot " << fileName;
+		throw errss.str();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Published mappings
+
+// A change, with the patient it is grouped under
+struct GroupedChange
+{
+	PatientId patientId;
+	PatientMappingChange change;
+};
+
+static bool PatientLess(const GroupedChange &first,
+	const GroupedChange &second)
+{
+	return first.patientId < second.patientId;
+}
+
+// Both the published mappings and the snapshot are sorted by device, so one
+// pass over both finds every difference
+void PublishedMappings::Diff(const MappingSnapshot &snapshot,
+	unsigned int maxChanges, vector<PatientTransfer> &transfers,
+	MappingDiffCounts &counts) const
+{
+	memset(&counts, 0, sizeof(counts));
+	transfers.clear();
+
+	const vector<DeviceMapping> &mappings = snapshot.GetMappings();
+	vector<GroupedChange> changes;
+	map<string, PatientId>::const_iterator published = _mappings.begin();
+	size_t next = 0;
+	while (published != _mappings.end() || next < mappings.size())
+	{
+		GroupedChange grouped;
+		if (next == mappings.size() || (published != _mappings.end() &&
+			published->first < mappings[next].deviceId))
+		{
+			grouped.patientId = published->second;
+			grouped.change.deviceId = published->first;
+			grouped.change.patientId = 0;
+			grouped.change.removed = true;
+			changes.push_back(grouped);
+			counts.removed++;
+			++published;
+			continue;
+		}
+
+		if (published == _mappings.end() ||
+			mappings[next].deviceId < published->first)
+		{
+			counts.added++;
+		} else
+		{
+			bool same = published->second == mappings[next].patientId;
+			++published;
+			if (same)
+			{
+				counts.unchanged++;
+				next++;
+				continue;
+			}
+			counts.changed++;
+		}
+		grouped.patientId = mappings[next].patientId;
+		grouped.change.deviceId = mappings[next].deviceId;
+		grouped.change.patientId = mappings[next].patientId;
+		grouped.change.removed = false;
+		changes.push_back(grouped);
+		next++;
+	}
+
+	// Group the changes by patient, and fill the transfers without
+	// splitting a patient unless it has too many changes
+	stable_sort(changes.begin(), changes.end(), PatientLess);
+	if (maxChanges == 0)
+	{
+		maxChanges = (unsigned int)changes.size();
+	}
+	size_t groupBegin = 0;
+	while (groupBegin < changes.size())
+	{
+		size_t groupEnd = groupBegin + 1;
+		while (groupEnd < changes.size() &&
+			changes[groupEnd].patientId == changes[groupBegin].patientId)
+		{
+			groupEnd++;
+		}
+
+		for (size_t i = groupBegin; i < groupEnd; i++)
+		{
+			size_t length = transfers.empty() ? 0 :
+				transfers.back().GetChanges().size();
+			bool startsGroup = i == groupBegin;
+			if (transfers.empty() || length >= maxChanges ||
+				(startsGroup && length + (groupEnd - groupBegin) > maxChanges))
+			{
+				transfers.push_back(PatientTransfer());
+			}
+
+			const PatientMappingChange &change = changes[i].change;
+			if (change.removed)
+			{
+				transfers.back().Unmap(change.deviceId);
+			} else
+			{
+				transfers.back().Map(change.deviceId, change.patientId);
+			}
+		}
+		groupBegin = groupEnd;
+	}
+}
+
+void PublishedMappings::Apply(const PatientTransfer &transfer)
+{
+	const vector<PatientMappingChange> &changes = transfer.GetChanges();
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		if (changes[i].removed)
+		{
+			_mappings.erase(changes[i].deviceId);
+		} else
+		{
+			_mappings[changes[i].deviceId] = changes[i].patientId;
+		}
+	}
+}
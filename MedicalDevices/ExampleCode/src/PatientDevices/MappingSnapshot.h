@@ -0,0 +1,147 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef MAPPING_SNAPSHOT_H
+#define MAPPING_SNAPSHOT_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Mapping snapshots:
+// In a hospital, the patient-device mappings come from the ADT (admission,
+// discharge and transfer) system, which exports all of them at once as a
+// snapshot file.  A MappingSnapshot loads such a file, and PublishedMappings
+// compares it to the mappings already published, so that a refresh only
+// sends the mappings that were added, changed or removed.
+//
+// Two file formats are read.  The format is recognized from the first bytes
+// of the file.
+//
+//  - CSV: one "device_id,patient_id" line per device.  Empty lines and
+//    lines starting with '#' are ignored, and so is a first line whose
+//    patient ID is not a number, such as a header.
+//
+//  - Binary: a 16-byte header ("PDMS", then the version, the record count
+//    and the record size, as little-endian 32-bit integers), followed by
+//    fixed-size records of a 64-byte device ID padded with NUL characters
+//    and a little-endian 32-bit patient ID.  MappingSnapshot::SaveBinary
+//    writes this format.
+//
+// The file is memory-mapped and split into one part per thread, which are
+// parsed in parallel.  If a device appears several times, its last line
+// wins.  The ADT export should write the snapshot to a temporary file and
+// rename it, so a snapshot is never read while it is being written.
+//
+// ------------------------------------------------------------------------- //
+
+// The mapping of one device
+struct DeviceMapping
+{
+	std::string deviceId;
+	com::rti::medical::generated::PatientId patientId;
+};
+
+class MappingSnapshot
+{
+public:
+	// --- Constructor ---
+	MappingSnapshot();
+
+	// --- Loading ---
+	// Loads the mappings of a snapshot file, parsing it on up to
+	// threadCount threads.  If the file has the same contents as the
+	// snapshot loaded last, it is not parsed again and false is returned.
+	// Throws a std::string if the file cannot be read or is not valid, and
+	// the mappings loaded before are kept.
+	bool Load(const std::string &fileName, unsigned int threadCount);
+
+	// --- Saving ---
+	// Writes the mappings in the binary format.  Throws a std::string if
+	// the file cannot be written.
+	void SaveBinary(const std::string &fileName) const;
+
+	// --- Accessors ---
+	// The mappings, sorted by device ID, one per device
+	const std::vector<DeviceMapping> &GetMappings() const
+	{
+		return _mappings;
+	}
+
+	// Devices that appeared more than once in the file
+	unsigned int GetDuplicateCount() const
+	{
+		return _duplicateCount;
+	}
+
+	// Checksum of the contents of the file
+	uint64_t GetChecksum() const
+	{
+		return _checksum;
+	}
+
+	// A snapshot has been loaded
+	bool IsLoaded() const
+	{
+		return _loaded;
+	}
+
+private:
+	std::vector<DeviceMapping> _mappings;
+	unsigned int _duplicateCount;
+	uint64_t _checksum;
+	bool _loaded;
+};
+
+// Number of mappings of each kind found by a comparison
+struct MappingDiffCounts
+{
+	unsigned int added;
+	unsigned int changed;
+	unsigned int removed;
+	unsigned int unchanged;
+};
+
+// ------------------------------------------------------------------------- //
+// The mappings that were published
+class PublishedMappings
+{
+public:
+	// --- Comparing ---
+	// Computes the changes that turn the published mappings into the ones
+	// of the snapshot.  The changes are grouped by patient (the new one, or
+	// the old one for a removed mapping), and split into transfers of at
+	// most maxChanges changes.  The changes of one patient are only split
+	// if there are more than maxChanges of them, so each patient's devices
+	// still change at once.
+	void Diff(const MappingSnapshot &snapshot, unsigned int maxChanges,
+		std::vector<PatientTransfer> &transfers,
+		MappingDiffCounts &counts) const;
+
+	// --- Updating ---
+	// Records that the changes of the transfer were published
+	void Apply(const PatientTransfer &transfer);
+
+	// --- Accessors ---
+	unsigned int GetCount() const
+	{
+		return (unsigned int)_mappings.size();
+	}
+
+private:
+	std::map<std::string, com::rti::medical::generated::PatientId>
+		_mappings;
+};
+
+#endif
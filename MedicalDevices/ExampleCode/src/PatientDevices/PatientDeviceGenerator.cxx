@@ -8,13 +8,16 @@
  any incidental or consequential damages arising out of the use or inability to
  use the software.
  ******************************************************************************/
+#include <stdlib.h>
 #include <vector>
 #include <list>
 #include <iostream>
 #include "../Generated/patient.h"
 #include "../Generated/patientSupport.h"
 #include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/StartupProfile.h"
 #include "DDSPatientDeviceInterface.h"
+#include "MappingSnapshot.h"
 
 using namespace std;
 using namespace com::rti::medical::generated;
@@ -24,8 +27,11 @@ void PrintHelp();
 
 // ------------------------------------------------------------------------- //
 // This application sends patient-device mapping information over RTI 
-// Connext DDS. This is a simple application that uses pre-configured data
-// for two patients.  
+// Connext DDS. By default, this is a simple application that uses
+// pre-configured data for two patients.  With --mappings, it sends the
+// mappings of a snapshot file exported by the ADT system instead, and with
+// --watch-seconds it reloads the file periodically and sends only the
+// mappings that were added, changed or removed (see MappingSnapshot.h).
 // 
 // It sends the device-patient mapping for these two patients with the QoS 
 // that is used for state data, meaning that this data is:
@@ -36,6 +42,47 @@ void PrintHelp();
 //
 // ------------------------------------------------------------------------- //
 
+// Sends the changes that turn the published mappings into the snapshot, and
+// prints what was sent if anything was, or if the snapshot was reloaded.
+// This runs at every refresh, so the mappings of a transfer that fails, or
+// that is deferred by the maximum changes per transfer, are sent on the next
+// refresh even if the file has not changed.
+static void PublishSnapshotChanges(
+	DDSPatientDevicePubInterface &patientDevicePub,
+	const MappingSnapshot &snapshot, PublishedMappings &published,
+	unsigned int maxTransferChanges, bool reloaded)
+{
+	std::vector<PatientTransfer> transfers;
+	MappingDiffCounts counts;
+	published.Diff(snapshot, maxTransferChanges, transfers, counts);
+	if (transfers.empty() && !reloaded)
+	{
+		return;
+	}
+
+	unsigned int failed = 0;
+	for (size_t i = 0; i < transfers.size(); i++)
+	{
+		if (patientDevicePub.Transfer(transfers[i]))
+		{
+			published.Apply(transfers[i]);
+		} else
+		{
+			failed++;
+		}
+	}
+
+	cout << snapshot.GetMappings().size() << " mappings: " << counts.added
+		<< " added, " << counts.changed << " changed, " << counts.removed
+		<< " removed, " << counts.unchanged << " unchanged, sent in "
+		<< transfers.size() << " transfers";
+	if (failed > 0)
+	{
+		cout << " (" << failed << " failed, retried on the next refresh)";
+	}
+	cout << endl;
+}
+
 int main(int argc, char *argv[])
 {
 
@@ -44,11 +91,39 @@ int main(int argc, char *argv[])
 
 	// Process the command-line arguments
 	bool multicastAvailable = true;
+	bool fastStart = false;
+	bool profileStartup = false;
+	string mappingFile;
+	string binaryFile;
+	long watchSeconds = 0;
+	long parseThreads = 4;
+	long maxTransferChanges = 1000;
 	for (int i = 0; i < argc; i++)
 	{
 		if (0 == strcmp(argv[i], "--no-multicast"))
 		{
 			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--fast-start"))
+		{
+			fastStart = true;
+		} else if (0 == strcmp(argv[i], "--profile-startup"))
+		{
+			profileStartup = true;
+		} else if (0 == strcmp(argv[i], "--mappings") && i + 1 < argc)
+		{
+			mappingFile = argv[++i];
+		} else if (0 == strcmp(argv[i], "--save-binary") && i + 1 < argc)
+		{
+			binaryFile = argv[++i];
+		} else if (0 == strcmp(argv[i], "--watch-seconds") && i + 1 < argc)
+		{
+			watchSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--parse-threads") && i + 1 < argc)
+		{
+			parseThreads = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--max-transfer") && i + 1 < argc)
+		{
+			maxTransferChanges = atol(argv[++i]);
 		} else if (0 == strcmp(argv[i], "--help"))
 		{
 			PrintHelp();
@@ -64,6 +139,14 @@ int main(int argc, char *argv[])
 
 	}
 
+	if (watchSeconds < 0 || parseThreads <= 0 || maxTransferChanges <= 0 ||
+		(mappingFile.empty() && (watchSeconds > 0 || !binaryFile.empty())))
+	{
+		cout << "The counts must be positive, and --watch-seconds and " <<
+			"--save-binary need --mappings" << endl;
+		return -1;
+	}
+
 	// Create a mapping between patients and devices
 	std::map<int, std::vector<std::string> > patientDeviceMappings;
 
@@ -82,6 +165,10 @@ int main(int argc, char *argv[])
 
 	patientDeviceMappings[1] = patient2Devices;
 
+	// Records the time spent in each phase of startup, from here to the
+	// acknowledgment of the first mapping
+	StartupProfile startupProfile;
+
 	try 
 	{
 
@@ -91,35 +178,116 @@ int main(int argc, char *argv[])
 		// transport (shared memory or over the network).  Look into this class
 		// to see what you need to do to implement an RTI Connext DDS 
 		// application that writes data.
-		DDSPatientDevicePubInterface patientDevicePub(multicastAvailable);
+		DDSPatientDevicePubInterface patientDevicePub(multicastAvailable,
+			fastStart, profileStartup ? &startupProfile : NULL);
 
 
 		DDS_Duration_t send_period = {0,100000000};
 
 		cout << "Sending device-patient mappings over RTI Connext DDS" << endl;
 
+		// When profiling startup, the first mapping is sent as soon as an
+		// application subscribes, and startup ends when it acknowledges it
+		if (profileStartup)
+		{
+			DDS_Duration_t matchTimeout = {10, 0};
+			if (!patientDevicePub.WaitForFirstMatch(matchTimeout))
+			{
+				cout << "No application subscribing to device-patient " <<
+					"mappings was found" << endl;
+			} else
+			{
+				DdsAutoType<DevicePatientMapping> patientDevice;
+				patientDevice.patient_id = 1;
+				strcpy(patientDevice.device_id, 
+					patientDeviceMappings[0][0].c_str());
 
-		// Write all patient-device mappings up to the number specified
-		for (int i = 0; i < numPatients; i++) 
+				StartupPhaseTimer timer(&startupProfile, 
+					"first acknowledged sample");
+				PublicationFuture future = patientDevicePub.PublishAsync(
+					patientDevice, matchTimeout);
+				if (future.Wait(matchTimeout) != PUBLICATION_ACKNOWLEDGED)
+				{
+					cout << "The first device-patient mapping was not " <<
+						"acknowledged" << endl;
+				}
+			}
+			startupProfile.Print(cout);
+		}
+
+
+		// With a snapshot file, send its mappings, and the changes to them
+		// at each refresh.  A file that has not changed is not parsed again,
+		// but the changes not sent yet are.  A snapshot that cannot be
+		// loaded leaves the published mappings as they are.
+		if (!mappingFile.empty())
 		{
+			MappingSnapshot snapshot;
+			PublishedMappings published;
+			DDS_Duration_t watchPeriod = {(DDS_Long)watchSeconds, 0};
+			while (1)
+			{
+				try
+				{
+					int64_t start = OSGetMonotonicTime();
+					bool reloaded = snapshot.Load(mappingFile,
+						(unsigned int)parseThreads);
+					if (reloaded)
+					{
+						cout << "Loaded " << mappingFile << " in " <<
+							(OSGetMonotonicTime() - start) / 1000 << " us";
+						if (snapshot.GetDuplicateCount() > 0)
+						{
+							cout << ", " << snapshot.GetDuplicateCount() <<
+								" duplicate devices";
+						}
+						cout << endl;
+
+						if (!binaryFile.empty())
+						{
+							snapshot.SaveBinary(binaryFile);
+						}
+					}
 
-			// Allocate a device patient mapping structure
-			DdsAutoType<DevicePatientMapping> patientDevice;
+					if (snapshot.IsLoaded())
+					{
+						PublishSnapshotChanges(patientDevicePub, snapshot,
+							published, (unsigned int)maxTransferChanges,
+							reloaded);
+					}
+				}
+				catch (string message)
+				{
+					cout << "Mappings not refreshed: " << message << endl;
+				}
 
-			for (int j = 0; j < patientDeviceMappings.size(); j++)
+				if (watchSeconds == 0)
+				{
+					break;
+				}
+				NDDSUtility::sleep(watchPeriod);
+			}
+			numPatients = 0;
+		}
+
+		// Write all patient-device mappings up to the number specified.  The
+		// devices of each patient are sent as one transfer, so applications
+		// see all of them start monitoring the patient at once.
+		for (int i = 0; i < numPatients; i++) 
+		{
+			PatientTransfer transfer;
+
+			for (int j = 0; j < patientDeviceMappings[i].size(); j++)
 			{
 				// We use integers as a placeholder for a real patient 
 				// identifier
-				patientDevice.patient_id = i + 1;
-				strcpy(patientDevice.device_id, 
-					patientDeviceMappings[i][j].c_str());
-
-				// Write the data to the network.  This is a thin wrapper 
-				// around the RTI Connext DDS DataWriter that writes data to
-				// the network.
-				patientDevicePub.Publish(patientDevice);
-			}			
+				transfer.Map(patientDeviceMappings[i][j], i + 1);
+			}
 
+			// Write the data to the network.  This is a thin wrapper 
+			// around the RTI Connext DDS DataWriter that writes the 
+			// mappings to the network as one coherent set.
+			patientDevicePub.Transfer(transfer);
 
 			NDDSUtility::sleep(send_period);
 		}
@@ -148,5 +316,41 @@ void PrintHelp()
 		"                                   " <<
 		"config to include IP addresses)" 
 		<< endl;
+	cout << 
+		"    --fast-start" <<
+		"                   Use tuned discovery, and announce all " << 
+		"entities at once" << endl;
+	cout << 
+		"    --profile-startup" <<
+		"              Print how long each startup phase takes" 
+		<< endl;
+	cout <<
+		"    --mappings <file>" <<
+		"              Send the mappings of an ADT snapshot file" <<
+		endl << "                                   " <<
+		"(CSV or binary) instead of the built-in ones"
+		<< endl;
+	cout <<
+		"    --watch-seconds <n>" <<
+		"            Reload the snapshot every n seconds, and send" <<
+		endl << "                                   " <<
+		"only the changes (default: 0, load once)"
+		<< endl;
+	cout <<
+		"    --parse-threads <n>" <<
+		"            Threads parsing the snapshot (default: 4)"
+		<< endl;
+	cout <<
+		"    --max-transfer <n>" <<
+		"             Largest number of changes sent as one" <<
+		endl << "                                   " <<
+		"coherent set (default: 1000)"
+		<< endl;
+	cout <<
+		"    --save-binary <file>" <<
+		"           Also write each loaded snapshot in the" <<
+		endl << "                                   " <<
+		"binary format, which loads faster"
+		<< endl;
 
 }
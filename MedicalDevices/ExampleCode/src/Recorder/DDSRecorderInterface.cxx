@@ -0,0 +1,453 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include "DDSRecorderInterface.h"
+#include "../CommonInfrastructure/DDSLoanedBatch.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+// Largest length of a device or metric ID, not counting the terminator
+static const size_t IDENTIFIER_BOUND = 64;
+
+// Converts a DDS timestamp to nanoseconds, the unit used in segment files
+static int64_t ToNanoseconds(const DDS_Time_t &time)
+{
+	return (int64_t)time.sec * 1000000000LL + time.nanosec;
+}
+
+// ----------------------------------------------------------------------------
+// The DDSRecorderInterface is the network interface to the recorder
+// application.  This creates DataReaders in order to receive all streaming
+// device data over the network (or shared memory), so it can be stored.
+//
+// This interface is built from:
+// 1. Network data types and topic names defined in the IDL file
+// 2. XML configuration files that describe the QoS profiles that should be
+//    used by individual DataWriters and DataReaders.  These describe the
+//    movement and persistence characteristics of the data (how reliable should
+//    this be?), as well as other QoS such as resource limits.
+// 3. The code itself creates DataReaders, and selects which QoS profile to use
+//    when creating the DataReaders.
+//
+// Reading streaming device data:
+// ------------------------------
+// This application receives ice::Numeric and ice::SampleArray data from all
+// devices.  The data is received reliably from the reliable streaming
+// DataWriters of the devices.
+//
+// Writing technical alarms:
+// -------------------------
+// The technical alarms about streams that stop arriving are sent with the
+// alarm profile, so that applications that start late still receive the
+// alarms that are active.
+//
+// For information on the data types, please see the ice.idl and alarm.idl
+// files.
+//
+// For information on the quality of service for streaming data, please
+// see the qos_profiles.xml file.
+// ------------------------------------------------------------------------- //
+
+DDSRecorderInterface::DDSRecorderInterface(bool multicastAvailable,
+	unsigned int maxInstances, int64_t staleTimeout,
+	const StalenessConfig &stalenessConfig)
+{
+	_communicator = new DDSCommunicator();
+
+	std::vector<std::string> xmlFiles;
+
+	// Adding the XML files that contain profiles used by this application
+	xmlFiles.push_back(
+		"file://../../../src/Config/qos_profiles.xml");
+
+	std::string participantProfile;
+
+	// Configuring this application for multicast or no multicast.  Note that
+	// if you have no multicast, you will have to edit the XML QoS
+	// configuration to add the IP addresses of applications you want to
+	// discover and communicate with.
+	if (multicastAvailable)
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT;
+	} else
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
+	}
+
+	// Create a DomainParticipant
+	// Start by creating a DomainParticipant.  Generally you will have only
+	// one DomainParticipant per application.  The device data is sent on
+	// domain 5, the same domain used by the device data replay.
+	if (NULL == _communicator->CreateParticipant(5, xmlFiles,
+				ICE_QOS_LIBRARY, participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	// Create a Subscriber
+	// This application reads the device data, and only writes technical
+	// alarms about it.
+	// Note that one Subscriber can be used to create multiple DataReaders
+	DDS::Subscriber *sub = _communicator->CreateSubscriber();
+
+	if (sub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Subscriber object";
+		throw errss.str();
+	}
+
+	// This application processes the whole unit, so it receives the device
+	// data of every patient group, and the default partition
+	// (see DDSPatientRouting.h)
+	SubscribeToAllPatientGroups(sub);
+
+	// Creating Topics
+	// The topic names are the constants defined in the ice.idl file, and
+	// used by all devices that send data.
+	DDS::Topic *numericTopic = _communicator->CreateTopic<ice::Numeric>(
+		ice::NumericTopic);
+	DDS::Topic *sampleArrayTopic =
+		_communicator->CreateTopic<ice::SampleArray>(ice::SampleArrayTopic);
+	DDS::Topic *compressedTopic =
+		_communicator->CreateTopic<CompressedSampleArray>(
+			CompressedSampleArrayTopic);
+	DDS::Topic *technicalAlarmTopic =
+		_communicator->CreateTopic<TechnicalAlarm>(TechnicalAlarmTopic);
+
+	// Create the DataReaders.
+	// These use the recorder profile for streaming data, which receives the
+	// streaming data reliably.
+	DDS::DataReader *reader = CreateInstanceLimitedReader(sub,
+		numericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING_RECORDER,
+		maxInstances);
+	_numericReader = ice::NumericDataReader::narrow(reader);
+	if (_numericReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create Numeric reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	_numericInstances = new InstanceTracker(_numericReader, staleTimeout);
+
+	reader = sub->create_datareader_with_profile(
+		sampleArrayTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING_RECORDER,
+		NULL, DDS_STATUS_MASK_NONE);
+	_sampleArrayReader = ice::SampleArrayDataReader::narrow(reader);
+	if (_sampleArrayReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create SampleArray reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	reader = sub->create_datareader_with_profile(
+		compressedTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING_RECORDER,
+		NULL, DDS_STATUS_MASK_NONE);
+	_compressedReader = CompressedSampleArrayDataReader::narrow(reader);
+	if (_compressedReader == NULL)
+	{
+		std::stringstream errss;
+		errss <<
+			"Failure to create CompressedSampleArray reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+	_decodedValues.resize(MAX_SAMPLE_ARRAY_VALUES);
+
+	// Create ReadConditions that trigger when there is any data in the
+	// DataReaders' queues, and attach both of them to a single WaitSet so
+	// one thread can record all the device data.
+	_numericCondition = _numericReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_sampleArrayCondition = _sampleArrayReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_compressedCondition = _compressedReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+
+	_waitSet = new DDS::WaitSet();
+	_waitSet->attach_condition(_numericCondition);
+	_waitSet->attach_condition(_sampleArrayCondition);
+	_waitSet->attach_condition(_compressedCondition);
+
+	// Create a Publisher and the DataWriter of the technical alarms
+	DDS::Publisher *pub = _communicator->CreatePublisher();
+	if (pub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Publisher object";
+		throw errss.str();
+	}
+
+	DDS::DataWriter *writer = pub->create_datawriter_with_profile(
+		technicalAlarmTopic, ICE_QOS_LIBRARY, QOS_PROFILE_ALARM,
+		NULL, DDS_STATUS_MASK_NONE);
+	_technicalAlarmWriter = TechnicalAlarmDataWriter::narrow(writer);
+	if (_technicalAlarmWriter == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create TechnicalAlarm writer. Inconsistent Qos?";
+		throw errss.str();
+	}
+	_technicalAlarm.kind = DATA_STALE;
+
+	_staleness = new StalenessMonitor(stalenessConfig, OSGetMonotonicTime(),
+		*this);
+}
+
+// ----------------------------------------------------------------------------
+// Destructor.
+// Deletes the staleness monitor, the WaitSet, the DataReaders, the
+// DataWriter, and the Communicator object
+DDSRecorderInterface::~DDSRecorderInterface()
+{
+	delete _staleness;
+
+	_waitSet->detach_condition(_numericCondition);
+	_waitSet->detach_condition(_sampleArrayCondition);
+	_waitSet->detach_condition(_compressedCondition);
+	delete _waitSet;
+
+	delete _numericInstances;
+
+	_numericReader->delete_readcondition(_numericCondition);
+	_sampleArrayReader->delete_readcondition(_sampleArrayCondition);
+	_compressedReader->delete_readcondition(_compressedCondition);
+
+	DDS::Subscriber *sub = _numericReader->get_subscriber();
+	sub->delete_datareader(_numericReader);
+	sub->delete_datareader(_sampleArrayReader);
+	sub->delete_datareader(_compressedReader);
+	_numericReader = NULL;
+	_sampleArrayReader = NULL;
+	_compressedReader = NULL;
+
+	_technicalAlarmWriter->get_publisher()->delete_datawriter(
+		_technicalAlarmWriter);
+	_technicalAlarmWriter = NULL;
+
+	delete _communicator;
+}
+
+// ----------------------------------------------------------------------------
+// Waits for device data, and records every sample that is available on
+// either DataReader.
+unsigned long DDSRecorderInterface::RecordAvailableData(SegmentStore &store,
+	const DDS_Duration_t &timeout)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode == DDS_RETCODE_TIMEOUT)
+	{
+		return 0;
+	}
+	if (retcode != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure waiting for device data";
+		throw errss.str();
+	}
+
+	unsigned long recorded = 0;
+	for (int i = 0; i < activeConditions.length(); i++)
+	{
+		if (activeConditions[i] == _numericCondition)
+		{
+			recorded += RecordNumerics(store);
+		}
+		else if (activeConditions[i] == _sampleArrayCondition)
+		{
+			recorded += RecordSampleArrays(store);
+		}
+		else if (activeConditions[i] == _compressedCondition)
+		{
+			recorded += RecordCompressedSampleArrays(store);
+		}
+	}
+	return recorded;
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available Numeric samples, and appends them to their segments.
+// The samples are loaned from the DataReader, and returned after they have
+// been recorded, or if recording them throws.  Every sample updates the
+// instance tracker.
+unsigned long DDSRecorderInterface::RecordNumerics(SegmentStore &store)
+{
+	LoanedBatch<ice::Numeric> batch;
+	unsigned long recorded = 0;
+	int64_t now = OSGetMonotonicTime();
+
+	while (batch.TakeNext(_numericReader, _numericCondition))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			_numericInstances->OnSample(info, now);
+			if (!batch.IsValid(i))
+			{
+				continue;
+			}
+			const ice::Numeric &numeric = batch.GetData(i);
+			_staleness->OnNumeric(numeric.unique_device_identifier,
+				numeric.metric_id, numeric.instance_id, now);
+			store.AppendNumeric(numeric.unique_device_identifier,
+				numeric.metric_id, numeric.instance_id,
+				ToNanoseconds(info.source_timestamp), numeric.value, now);
+			recorded++;
+		}
+	}
+	return recorded;
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available SampleArray samples, and appends them to their
+// segments.  The source timestamp of a frame is used as the time of its
+// first value, and the following values are spaced by millisecondsPerSample.
+// The next frame of a stream is expected after the duration of this one.
+unsigned long DDSRecorderInterface::RecordSampleArrays(SegmentStore &store)
+{
+	LoanedBatch<ice::SampleArray> batch;
+	unsigned long recorded = 0;
+	int64_t now = OSGetMonotonicTime();
+
+	while (batch.TakeNext(_sampleArrayReader, _sampleArrayCondition))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			if (!batch.IsValid(i) || batch.GetData(i).values.length() == 0)
+			{
+				continue;
+			}
+			const ice::SampleArray &frame = batch.GetData(i);
+			store.AppendSampleArray(frame.unique_device_identifier,
+				frame.metric_id, frame.instance_id,
+				ToNanoseconds(batch.GetInfo(i).source_timestamp),
+				(int64_t)frame.millisecondsPerSample * 1000000LL,
+				frame.values.get_contiguous_buffer(),
+				frame.values.length(), now);
+			_staleness->OnFrame(frame.unique_device_identifier,
+				frame.metric_id, frame.instance_id, now,
+				(int64_t)frame.millisecondsPerSample * 1000000LL *
+					frame.values.length());
+			recorded += frame.values.length();
+		}
+	}
+	return recorded;
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available CompressedSampleArray samples, decompresses their
+// values, and appends them to their segments the same way as SampleArray
+// samples.  Frames that cannot be decompressed are skipped.
+unsigned long DDSRecorderInterface::RecordCompressedSampleArrays(
+	SegmentStore &store)
+{
+	LoanedBatch<CompressedSampleArray> batch;
+	unsigned long recorded = 0;
+	int64_t now = OSGetMonotonicTime();
+
+	while (batch.TakeNext(_compressedReader, _compressedCondition))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			if (!batch.IsValid(i))
+			{
+				continue;
+			}
+			const CompressedSampleArray &frame = batch.GetData(i);
+			if (frame.value_count == 0 ||
+				frame.value_count > _decodedValues.size() ||
+				!DecompressWaveformValues(frame, &_decodedValues[0]))
+			{
+				continue;
+			}
+			store.AppendSampleArray(frame.unique_device_identifier,
+				frame.metric_id, frame.instance_id,
+				ToNanoseconds(batch.GetInfo(i).source_timestamp),
+				(int64_t)frame.millisecondsPerSample * 1000000LL,
+				&_decodedValues[0], frame.value_count, now);
+			_staleness->OnFrame(frame.unique_device_identifier,
+				frame.metric_id, frame.instance_id, now,
+				(int64_t)frame.millisecondsPerSample * 1000000LL *
+					frame.value_count);
+			recorded += frame.value_count;
+		}
+	}
+	return recorded;
+}
+
+// ----------------------------------------------------------------------------
+// Staleness of the streams.  The monitor calls back StreamStale() and
+// StreamForgotten() from CheckStaleStreams(), and StreamRecovered() while
+// the samples are being recorded.
+unsigned int DDSRecorderInterface::CheckStaleStreams()
+{
+	return _staleness->Check(OSGetMonotonicTime());
+}
+
+void DDSRecorderInterface::StreamStale(const StreamStatus &stream)
+{
+	WriteTechnicalAlarm(stream, true);
+}
+
+void DDSRecorderInterface::StreamRecovered(const StreamStatus &stream)
+{
+	WriteTechnicalAlarm(stream, false);
+}
+
+// The stream is no longer monitored, so its alarm instance is disposed
+void DDSRecorderInterface::StreamForgotten(const StreamStatus &stream)
+{
+	WriteTechnicalAlarm(stream, false);
+	if (_technicalAlarmWriter->dispose(_technicalAlarm, DDS_HANDLE_NIL)
+		!= DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure to dispose TechnicalAlarm";
+		throw errss.str();
+	}
+}
+
+void DDSRecorderInterface::WriteTechnicalAlarm(const StreamStatus &stream,
+	bool active)
+{
+	strncpy(_technicalAlarm.unique_device_identifier,
+		stream.deviceId.c_str(), IDENTIFIER_BOUND);
+	_technicalAlarm.unique_device_identifier[IDENTIFIER_BOUND] = '\0';
+	strncpy(_technicalAlarm.metric_id, stream.metricId.c_str(),
+		IDENTIFIER_BOUND);
+	_technicalAlarm.metric_id[IDENTIFIER_BOUND] = '\0';
+	_technicalAlarm.instance_id = stream.instanceId;
+	_technicalAlarm.active = active ? DDS_BOOLEAN_TRUE : DDS_BOOLEAN_FALSE;
+
+	// The monitor uses the monotonic clock, which only means something in
+	// this process, so the time of the latest sample is sent on the clock of
+	// the participant, like the timestamps of the samples
+	DDS_Time_t now;
+	_communicator->GetParticipant()->get_current_time(now);
+	_technicalAlarm.last_sample_time = ToNanoseconds(now) -
+		(OSGetMonotonicTime() - stream.lastSampleTime);
+	_technicalAlarm.expected_period = stream.expectedPeriod;
+
+	if (_technicalAlarmWriter->write(_technicalAlarm, DDS_HANDLE_NIL)
+		!= DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure to write TechnicalAlarm";
+		throw errss.str();
+	}
+}
@@ -0,0 +1,166 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_RECORDER_INTERFACE_H
+#define DDS_RECORDER_INTERFACE_H
+
+#include <sstream>
+#include <vector>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/waveform.h"
+#include "../Generated/waveformSupport.h"
+#include "../Generated/alarm.h"
+#include "../Generated/alarmSupport.h"
+#include "../CommonInfrastructure/DDSInstanceTracker.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/DDSWaveformAdapter.h"
+#include "../CommonInfrastructure/StalenessMonitor.h"
+#include "SegmentStore.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// The recorder interface receives streaming device data over the network (or
+// shared memory) so that it can be stored in columnar segment files.
+//
+// Reading streaming device data:
+// ------------------------------
+// This application receives ice::Numeric and ice::SampleArray data from every
+// device on the domain.  It uses the StreamingRecorder QoS profile, which
+// requests reliable delivery from the reliable streaming DataWriters, so
+// that the recording does not silently lose samples when the recorder falls
+// briefly behind.
+//
+// Waveforms sent on the CompressedSampleArray topic (see waveform.idl) are
+// decompressed and recorded exactly like ice::SampleArray data.
+//
+// Samples are taken from both DataReaders in a single thread that waits on a
+// WaitSet, and are taken in batches using the loaned buffers of the
+// DataReaders, so no copy is made between the middleware and the segment
+// files.
+//
+// The Numeric DataReader purges the instances of devices that are unplugged,
+// and holds at most a maximum of instances, so the recorder can run for weeks
+// while devices are plugged in and unplugged (see DDSInstanceTracker.h).
+//
+// Writing technical alarms:
+// -------------------------
+// Every stream (device, metric and instance) the recorder receives is
+// watched by a StalenessMonitor.  When a stream stops arriving for a few
+// of its periods, while its device may still be alive, the recorder sends
+// an active TechnicalAlarm of kind DATA_STALE, and sends it again inactive
+// when the stream recovers.  The alarm instance is disposed when the stream
+// is forgotten.
+//
+// For information on the device data types, please see the ice.idl file.
+//
+// For information on the quality of service for streaming data, please
+// see the qos_profiles.xml file.
+//
+// ----------------------------------------------------------------------------
+class DDSRecorderInterface : private StalenessListener
+{
+
+public:
+
+	// --- Constructor ---
+	// Initializes the interface, including creating a DomainParticipant,
+	// a subscriber, topics and DataReaders for Numeric and SampleArray data.
+	// The Numeric DataReader holds at most maxInstances instances, and
+	// instances that have not been updated for staleTimeout nanoseconds are
+	// counted as stale.  The streams are watched for staleness with the
+	// given settings.
+	DDSRecorderInterface(bool multicastAvailable,
+		unsigned int maxInstances = UNLIMITED_INSTANCES,
+		int64_t staleTimeout = 0,
+		const StalenessConfig &stalenessConfig = StalenessConfig());
+
+	// --- Destructor ---
+	~DDSRecorderInterface();
+
+	// --- Getter for Communicator ---
+	// Accessor for the communicator (the class that sets up the basic
+	// DDS infrastructure like the DomainParticipant).
+	// This allows access to the DDS DomainParticipant/Publisher/Subscriber
+	// classes
+	DDSCommunicator *GetCommunicator()
+	{
+		return _communicator;
+	}
+
+	// --- Records received data ---
+	// Waits up to the timeout for device data to arrive, and appends all
+	// the data that is available to the segment store.  Returns the number
+	// of samples recorded.
+	unsigned long RecordAvailableData(SegmentStore &store,
+		const DDS_Duration_t &timeout);
+
+	// --- Instances ---
+	void GetNumericInstanceMetrics(InstanceMetrics &metrics) const
+	{
+		_numericInstances->GetMetrics(metrics, OSGetMonotonicTime());
+	}
+
+	// --- Staleness ---
+	// Sends the technical alarms of the streams that became stale or were
+	// forgotten since the last call.  Returns the number of streams whose
+	// timer expired.
+	unsigned int CheckStaleStreams();
+
+	void GetStalenessMetrics(StalenessMetrics &metrics) const
+	{
+		_staleness->GetMetrics(metrics);
+	}
+
+private:
+	// --- Private methods ---
+	unsigned long RecordNumerics(SegmentStore &store);
+	unsigned long RecordSampleArrays(SegmentStore &store);
+	unsigned long RecordCompressedSampleArrays(SegmentStore &store);
+
+	void WriteTechnicalAlarm(const StreamStatus &stream, bool active);
+	virtual void StreamStale(const StreamStatus &stream);
+	virtual void StreamRecovered(const StreamStatus &stream);
+	virtual void StreamForgotten(const StreamStatus &stream);
+
+	// --- Private members ---
+
+	// Used to create basic DDS entities that all applications need
+	DDSCommunicator *_communicator;
+
+	// Device data readers specific to this application
+	ice::NumericDataReader *_numericReader;
+	ice::SampleArrayDataReader *_sampleArrayReader;
+	com::rti::medical::generated::CompressedSampleArrayDataReader
+		*_compressedReader;
+
+	// Conditions and WaitSet used to wait for data on both readers
+	DDS::ReadCondition *_numericCondition;
+	DDS::ReadCondition *_sampleArrayCondition;
+	DDS::ReadCondition *_compressedCondition;
+	DDS::WaitSet *_waitSet;
+
+	// Instances of the Numeric DataReader
+	InstanceTracker *_numericInstances;
+
+	// Values of the compressed frame being recorded
+	std::vector<float> _decodedValues;
+
+	// Staleness of every stream, and the writer of the technical alarms
+	StalenessMonitor *_staleness;
+	com::rti::medical::generated::TechnicalAlarmDataWriter
+		*_technicalAlarmWriter;
+	DdsAutoType<com::rti::medical::generated::TechnicalAlarm>
+		_technicalAlarm;
+};
+
+#endif
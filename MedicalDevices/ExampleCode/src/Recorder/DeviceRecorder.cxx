@@ -0,0 +1,200 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "DDSRecorderInterface.h"
+#include "SegmentStore.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This application records all ice::Numeric and ice::SampleArray data on the
+// domain into columnar segment files, one directory per device and metric.
+//
+// Unlike the SQLite databases written by RTI Recording Service (see the
+// replay directory), the segment files are append-only and compressed per
+// column, and finished segments can be memory-mapped and scanned in place
+// by the ColumnarSegmentReader class.
+//
+// The segments of streams idle for --idle-seconds are closed, and their
+// Numeric instances reported as stale.  The Numeric DataReader purges the
+// instances of devices that are unplugged, and holds at most
+// --max-instances instances.
+//
+// A stream that stops arriving for --stale-factor times its period raises a
+// TechnicalAlarm of kind DATA_STALE, which clears when the stream resumes.
+//
+// ------------------------------------------------------------------------- //
+
+int main(int argc, char *argv[])
+{
+	bool multicastAvailable = true;
+	std::string directory = "recording";
+	long segmentSeconds = 3600;
+	long idleSeconds = 30;
+	unsigned long maxInstances = 100000;
+	double staleFactor = 3.0;
+
+	// Process the command-line arguments
+	for (int i = 0; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-multicast"))
+		{
+			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--dir") && i + 1 < argc)
+		{
+			directory = argv[++i];
+		} else if (0 == strcmp(argv[i], "--segment-seconds") && i + 1 < argc)
+		{
+			segmentSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--idle-seconds") && i + 1 < argc)
+		{
+			idleSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--max-instances") && i + 1 < argc)
+		{
+			maxInstances = strtoul(argv[++i], NULL, 10);
+		} else if (0 == strcmp(argv[i], "--stale-factor") && i + 1 < argc)
+		{
+			staleFactor = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else if (i > 0)
+		{
+			// If we have a parameter that is not the first one, and is not
+			// recognized, return an error.
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	try
+	{
+		// --------------------------------------------------------------------
+		// This is the network interface for this application - this is what
+		// actually receives the device data from the transport (shared memory
+		// or over the network).  Look into this class to see what you need to
+		// do to implement an RTI Connext DDS application that reads data.
+		StalenessConfig stalenessConfig;
+		stalenessConfig.staleFactor = staleFactor;
+
+		DDSRecorderInterface recorderInterface(multicastAvailable,
+			(unsigned int)maxInstances,
+			(int64_t)idleSeconds * 1000000000LL, stalenessConfig);
+
+		SegmentStore store(directory,
+			(int64_t)segmentSeconds * 1000000000LL);
+
+		cout << "Recording device data into " << directory << endl;
+
+		// The wait is short so that stale streams are noticed soon after
+		// their timeout, even when no other data arrives
+		DDS_Duration_t waitTime = {0, 100000000};
+		DDS_Time_t lastReport = {0, 0};
+		uint64_t lastReportCount = 0;
+
+		while (1)
+		{
+			recorderInterface.RecordAvailableData(store, waitTime);
+			recorderInterface.CheckStaleStreams();
+
+			DDS_Time_t now;
+			recorderInterface.GetCommunicator()->GetParticipant()->
+				get_current_time(now);
+
+			// Once every ten seconds, close the segments of streams that
+			// have stopped sending, and report the ingest rate
+			if (now.sec - lastReport.sec >= 10)
+			{
+				store.CloseIdleSegments(OSGetMonotonicTime(),
+					(int64_t)idleSeconds * 1000000000LL);
+
+				if (lastReport.sec != 0)
+				{
+					cout << "Recorded "
+						<< (store.GetSampleCount() - lastReportCount) /
+							(now.sec - lastReport.sec)
+						<< " samples/s, " << store.GetOpenSegmentCount()
+						<< " open segments, "
+						<< store.GetClosedSegmentCount()
+						<< " finished segments" << endl;
+
+					InstanceMetrics instances;
+					recorderInterface.GetNumericInstanceMetrics(instances);
+					cout << instances.instanceCount << " Numeric instances ("
+						<< instances.peakInstanceCount << " peak, "
+						<< instances.staleCount << " stale), "
+						<< instances.addedCount << " added, "
+						<< instances.purgedCount << " purged, "
+						<< instances.readerSampleCount << " samples held, "
+						<< instances.rejectedSampleCount << " rejected"
+						<< endl;
+
+					StalenessMetrics staleness;
+					recorderInterface.GetStalenessMetrics(staleness);
+					cout << staleness.streamCount << " monitored streams ("
+						<< staleness.memorySize / 1024 << " KB), "
+						<< staleness.staleCount << " stale, "
+						<< staleness.staleEvents << " stale and "
+						<< staleness.recoveredEvents << " recovered events"
+						<< endl;
+				}
+				lastReport = now;
+				lastReportCount = store.GetSampleCount();
+			}
+		}
+	}
+	catch (string message)
+	{
+		cout << "Application exception: " << message << endl;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --no-multicast" <<
+		"                 Do not use multicast " <<
+		"(note you must edit XML" << endl <<
+		"                                   " <<
+		"config to include IP addresses)"
+		<< endl;
+	cout <<
+		"    --dir <path>" <<
+		"                   Directory to record into (default: recording)"
+		<< endl;
+	cout <<
+		"    --segment-seconds <n>" <<
+		"          Time covered by one segment file (default: 3600)"
+		<< endl;
+	cout <<
+		"    --idle-seconds <n>" <<
+		"             Close segments of streams idle this long (default: 30)"
+		<< endl;
+	cout <<
+		"    --max-instances <n>" <<
+		"            Numeric instances to hold (default: 100000, 0 for" <<
+		endl << "                                   no limit)"
+		<< endl;
+	cout <<
+		"    --stale-factor <x>" <<
+		"             Raise a stale data alarm after this many" <<
+		endl << "                                   periods (default: 3)"
+		<< endl;
+}
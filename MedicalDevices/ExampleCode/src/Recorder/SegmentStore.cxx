@@ -0,0 +1,180 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <sstream>
+#include "SegmentStore.h"
+
+// Device and metric identifiers become directory names, so replace any
+// character that has a meaning to the file system.
+static std::string ToPathComponent(const char *identifier)
+{
+	std::string component(identifier);
+	for (size_t i = 0; i < component.size(); i++)
+	{
+		char c = component[i];
+		if (c == '/' || c == '\\' || c == ':' || c == '*' || c == '?' ||
+			c == '"' || c == '<' || c == '>' || c == '|')
+		{
+			component[i] = '_';
+		}
+	}
+	if (component.empty() || component == "." || component == "..")
+	{
+		component = "_" + component;
+	}
+	return component;
+}
+
+SegmentStore::SegmentStore(const std::string &rootDirectory,
+	int64_t segmentDuration,
+	unsigned int samplesPerBlock) :
+	_rootDirectory(rootDirectory),
+	_segmentDuration(segmentDuration),
+	_samplesPerBlock(samplesPerBlock),
+	_sampleCount(0),
+	_closedSegments(0)
+{
+	if (!OSCreateDirectory(_rootDirectory))
+	{
+		std::stringstream errss;
+		errss << "Failed to create recording directory " << _rootDirectory;
+		throw errss.str();
+	}
+}
+
+SegmentStore::~SegmentStore()
+{
+	CloseAll();
+}
+
+void SegmentStore::AppendNumeric(const char *deviceId, const char *metricId,
+	int instanceId, int64_t timestamp, float value, int64_t receptionTime)
+{
+	ColumnarSegmentWriter *writer = GetWriter(SEGMENT_NUMERIC,
+		deviceId, metricId, instanceId, timestamp, receptionTime);
+	writer->Append(timestamp, value);
+	_sampleCount++;
+}
+
+void SegmentStore::AppendSampleArray(const char *deviceId,
+	const char *metricId, int instanceId, int64_t timestamp, int64_t period,
+	const float *values, unsigned int count, int64_t receptionTime)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	ColumnarSegmentWriter *writer = GetWriter(SEGMENT_SAMPLE_ARRAY,
+		deviceId, metricId, instanceId, timestamp, receptionTime);
+	writer->Append(timestamp, period, values, count);
+	_sampleCount += count;
+}
+
+// ------------------------------------------------------------------------- //
+// Finds the open segment of a stream, rolling over to a new segment when the
+// current one covers more than the segment duration.
+ColumnarSegmentWriter *SegmentStore::GetWriter(SegmentStreamKind kind,
+	const char *deviceId, const char *metricId,
+	int instanceId, int64_t timestamp, int64_t receptionTime)
+{
+	std::stringstream keyss;
+	keyss << kind << '|' << deviceId << '|' << metricId << '|' << instanceId;
+	std::string key = keyss.str();
+
+	std::map<std::string, OpenStream>::iterator it = _streams.find(key);
+	if (it != _streams.end())
+	{
+		if (timestamp - it->second.writer->GetFirstTimestamp() <
+			_segmentDuration)
+		{
+			it->second.lastReceptionTime = receptionTime;
+			return it->second.writer;
+		}
+		CloseStream(it);
+	}
+
+	std::stringstream dirss;
+	dirss << _rootDirectory << "/" << ToPathComponent(deviceId) << "/"
+		<< ToPathComponent(metricId) << "." << instanceId;
+	if (!OSCreateDirectory(dirss.str()))
+	{
+		std::stringstream errss;
+		errss << "Failed to create recording directory " << dirss.str();
+		throw errss.str();
+	}
+
+	OpenStream stream;
+	stream.writer = new ColumnarSegmentWriter(
+		GetSegmentFileName(dirss.str(), kind, timestamp), kind,
+		deviceId, metricId, instanceId, _samplesPerBlock);
+	stream.lastReceptionTime = receptionTime;
+	_streams[key] = stream;
+	return stream.writer;
+}
+
+// ------------------------------------------------------------------------- //
+// Names a new segment after its first timestamp.  The segment is renamed
+// over this name when it is closed, so a name that is taken, by a finished
+// segment or by the partial file of one, gets the first free sequence
+// number instead.
+std::string SegmentStore::GetSegmentFileName(const std::string &directory,
+	SegmentStreamKind kind, int64_t timestamp) const
+{
+	const char *extension =
+		(kind == SEGMENT_NUMERIC ? ".numeric.seg" : ".wave.seg");
+	for (unsigned int sequence = 0; ; sequence++)
+	{
+		std::stringstream filess;
+		filess << directory << "/" << timestamp;
+		if (sequence > 0)
+		{
+			filess << "-" << sequence;
+		}
+		filess << extension;
+		if (!OSFileExists(filess.str()) &&
+			!OSFileExists(filess.str() + ".partial"))
+		{
+			return filess.str();
+		}
+	}
+}
+
+void SegmentStore::CloseIdleSegments(int64_t now, int64_t idleTimeout)
+{
+	std::map<std::string, OpenStream>::iterator it = _streams.begin();
+	while (it != _streams.end())
+	{
+		std::map<std::string, OpenStream>::iterator current = it++;
+		if (now - current->second.lastReceptionTime > idleTimeout)
+		{
+			CloseStream(current);
+		}
+	}
+}
+
+void SegmentStore::CloseAll()
+{
+	while (!_streams.empty())
+	{
+		CloseStream(_streams.begin());
+	}
+}
+
+void SegmentStore::CloseStream(std::map<std::string, OpenStream>::iterator it)
+{
+	ColumnarSegmentWriter *writer = it->second.writer;
+	_streams.erase(it);
+
+	// Deleting the writer closes the segment, and renames it so that it
+	// is visible to readers
+	delete writer;
+	_closedSegments++;
+}
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef SEGMENT_STORE_H
+#define SEGMENT_STORE_H
+
+#include <map>
+#include <string>
+#include "../CommonInfrastructure/ColumnarSegment.h"
+
+// ------------------------------------------------------------------------- //
+//
+// SegmentStore:
+// Keeps one open ColumnarSegmentWriter per recorded stream (device, metric
+// and instance), and routes incoming samples to it.  Segments are stored
+// under the root directory as:
+//
+//   <root>/<device id>/<metric id>.<instance id>/<first timestamp>.<kind>.seg
+//
+// where kind is "numeric" for ice::Numeric and "wave" for ice::SampleArray.
+// A segment never replaces another one: if a stream repeats a first
+// timestamp, or goes back in time, and a segment of that name exists, a
+// sequence number is added to the new name:
+//
+//   <first timestamp>-<sequence>.<kind>.seg
+//
+// A segment is closed, and a new one started, when it covers more than the
+// configured segment duration.  Segments of streams that stop sending are
+// closed by CloseIdleSegments, so that a device that is unplugged does not
+// keep a partial file open forever.  Whether a stream stopped is decided on
+// the local clock, from the time its samples were received, so a device
+// whose clock is off is not closed early or kept open.
+//
+// ------------------------------------------------------------------------- //
+class SegmentStore
+{
+public:
+	// --- Constructor and destructor ---
+	// Durations are in nanoseconds
+	SegmentStore(const std::string &rootDirectory,
+		int64_t segmentDuration,
+		unsigned int samplesPerBlock = 1024);
+
+	// Closes all open segments
+	~SegmentStore();
+
+	// --- Recording samples ---
+	// The timestamp is the source timestamp of the sample, which is
+	// recorded.  The reception time is the local time the sample was
+	// received, in nanoseconds of OSGetMonotonicTime().
+	void AppendNumeric(const char *deviceId, const char *metricId,
+		int instanceId, int64_t timestamp, float value,
+		int64_t receptionTime);
+
+	void AppendSampleArray(const char *deviceId, const char *metricId,
+		int instanceId, int64_t timestamp, int64_t period,
+		const float *values, unsigned int count, int64_t receptionTime);
+
+	// --- Closing segments ---
+
+	// Closes segments that have not received data since idleTimeout
+	// before now, on the clock of the reception times
+	void CloseIdleSegments(int64_t now, int64_t idleTimeout);
+
+	void CloseAll();
+
+	// --- Statistics ---
+	uint64_t GetSampleCount() const
+	{
+		return _sampleCount;
+	}
+
+	unsigned int GetOpenSegmentCount() const
+	{
+		return (unsigned int)_streams.size();
+	}
+
+	unsigned int GetClosedSegmentCount() const
+	{
+		return _closedSegments;
+	}
+
+private:
+	// --- Private types ---
+	struct OpenStream
+	{
+		ColumnarSegmentWriter *writer;
+		int64_t lastReceptionTime;
+	};
+
+	// --- Private methods ---
+	ColumnarSegmentWriter *GetWriter(SegmentStreamKind kind,
+		const char *deviceId, const char *metricId,
+		int instanceId, int64_t timestamp, int64_t receptionTime);
+
+	void CloseStream(std::map<std::string, OpenStream>::iterator it);
+
+	std::string GetSegmentFileName(const std::string &directory,
+		SegmentStreamKind kind, int64_t timestamp) const;
+
+	// --- Private members ---
+	std::string _rootDirectory;
+	int64_t _segmentDuration;
+	unsigned int _samplesPerBlock;
+
+	// Open segments, by stream key
+	std::map<std::string, OpenStream> _streams;
+
+	uint64_t _sampleCount;
+	unsigned int _closedSegments;
+};
+
+#endif
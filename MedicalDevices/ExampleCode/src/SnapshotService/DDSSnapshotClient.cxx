@@ -0,0 +1,216 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "DDSSnapshotClient.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+// Bound of the string<64> requester ID in trend.idl
+static const size_t IDENTIFIER_BOUND = 64;
+
+// Built without a stringstream, as this runs for every live sample
+static void MakeStreamKey(const char *deviceId, const char *metricId,
+	int instanceId, std::string &key)
+{
+	char instance[16];
+	sprintf(instance, "%d", instanceId);
+	key.assign(deviceId);
+	key.append("|").append(metricId).append("|").append(instance);
+}
+
+DDSSnapshotClient::DDSSnapshotClient(DDSCommunicator *communicator,
+	const std::string &requesterId) :
+	_requesterId(requesterId.substr(0, IDENTIFIER_BOUND)),
+	_pending(false),
+	_requestId(0),
+	_service(DDS_HANDLE_NIL),
+	_batchCount(0)
+{
+	_requestWriter = new GenericDataWriter<SnapshotRequest>(communicator,
+		SnapshotRequestTopic, ICE_QOS_LIBRARY, QOS_PROFILE_TREND_QUERY);
+	_replyReader = new GenericDataReader<SnapshotReply>(communicator,
+		SnapshotReplyTopic, ICE_QOS_LIBRARY, QOS_PROFILE_TREND_QUERY);
+}
+
+DDSSnapshotClient::~DDSSnapshotClient()
+{
+	delete _replyReader;
+	delete _requestWriter;
+}
+
+// ----------------------------------------------------------------------------
+// Waits on the matched statuses of both entities.  A request sent before the
+// service matches the request DataWriter is lost, and so is a reply sent
+// before the service matches the reply DataReader.
+bool DDSSnapshotClient::WaitForService(const DDS_Duration_t &timeout)
+{
+	DDS::DataWriter *writer = _requestWriter->GetDataWriter();
+	DDS::DataReader *reader = _replyReader->GetDataReader();
+	DDS::StatusCondition *writerCondition = writer->get_statuscondition();
+	DDS::StatusCondition *readerCondition = reader->get_statuscondition();
+	writerCondition->set_enabled_statuses(DDS_PUBLICATION_MATCHED_STATUS);
+	readerCondition->set_enabled_statuses(DDS_SUBSCRIPTION_MATCHED_STATUS);
+
+	DDS::WaitSet waitSet;
+	waitSet.attach_condition(writerCondition);
+	waitSet.attach_condition(readerCondition);
+
+	DDS::ConditionSeq activeConditions;
+	DDS_Duration_t remaining = timeout;
+	int64_t deadline = OSGetMonotonicTime() +
+		(int64_t)timeout.sec * 1000000000 + timeout.nanosec;
+
+	bool matched = false;
+	while (true)
+	{
+		DDS_PublicationMatchedStatus writerStatus;
+		DDS_SubscriptionMatchedStatus readerStatus;
+		writer->get_publication_matched_status(writerStatus);
+		reader->get_subscription_matched_status(readerStatus);
+		matched = writerStatus.current_count > 0 &&
+			readerStatus.current_count > 0;
+		if (matched)
+		{
+			break;
+		}
+
+		// Wait again only for the rest of the timeout
+		int64_t left = deadline - OSGetMonotonicTime();
+		if (left <= 0)
+		{
+			break;
+		}
+		remaining.sec = (DDS_Long)(left / 1000000000);
+		remaining.nanosec = (DDS_UnsignedLong)(left % 1000000000);
+		if (waitSet.wait(activeConditions, remaining) != DDS_RETCODE_OK)
+		{
+			break;
+		}
+	}
+
+	waitSet.detach_condition(writerCondition);
+	waitSet.detach_condition(readerCondition);
+	return matched;
+}
+
+bool DDSSnapshotClient::Request(int patientId, int waveformWindowMs)
+{
+	DdsAutoType<SnapshotRequest> request;
+	strcpy(request.requester_id, _requesterId.c_str());
+	request.request_id = ++_requestId;
+	request.patient_id = patientId;
+	request.waveform_window_ms = waveformWindowMs;
+
+	_service = DDS_HANDLE_NIL;
+	_receivedBatches.clear();
+	_liveTimes.clear();
+	_batchCount = 0;
+	_pending = _requestWriter->Write(request);
+	return _pending;
+}
+
+void DDSSnapshotClient::OnLiveSample(const char *deviceId,
+	const char *metricId, int instanceId, int64_t sourceTime)
+{
+	if (!_pending)
+	{
+		return;
+	}
+
+	std::string key;
+	MakeStreamKey(deviceId, metricId, instanceId, key);
+	std::map<std::string, int64_t>::iterator it = _liveTimes.find(key);
+	if (it == _liveTimes.end())
+	{
+		_liveTimes.insert(std::make_pair(key, sourceTime));
+	} else if (sourceTime > it->second)
+	{
+		it->second = sourceTime;
+	}
+}
+
+bool DDSSnapshotClient::IsNewerLive(const char *deviceId,
+	const char *metricId, int instanceId, int64_t sourceTime) const
+{
+	std::string key;
+	MakeStreamKey(deviceId, metricId, instanceId, key);
+	std::map<std::string, int64_t>::const_iterator it = _liveTimes.find(key);
+	return it != _liveTimes.end() && it->second >= sourceTime;
+}
+
+// ----------------------------------------------------------------------------
+// Replies to other stations, and to requests that were abandoned, are
+// dropped.  The first reply to the pending request picks the service, by
+// the DataWriter that sent it, and the replies of other services are
+// dropped.  A reply received twice is only passed to the listener once.
+bool DDSSnapshotClient::ProcessReplies(SnapshotListener &listener)
+{
+	LoanedBatch<SnapshotReply> batch;
+
+	while (_replyReader->Take(batch))
+	{
+		for (LoanedBatch<SnapshotReply>::ValidIterator it = batch.begin();
+			it != batch.end(); ++it)
+		{
+			const SnapshotReply &reply = *it;
+			if (!_pending || reply.request_id != _requestId ||
+				strcmp(reply.requester_id, _requesterId.c_str()) != 0)
+			{
+				continue;
+			}
+			const DDS_InstanceHandle_t &writer =
+				it.GetInfo().publication_handle;
+			if (_receivedBatches.empty())
+			{
+				_service = writer;
+			} else if (!DDS_InstanceHandle_equals(&writer, &_service))
+			{
+				continue;
+			}
+			if (!_receivedBatches.insert(reply.batch_index).second)
+			{
+				continue;
+			}
+
+			for (int i = 0; i < reply.numerics.length(); i++)
+			{
+				const SnapshotNumeric &numeric = reply.numerics[i];
+				if (!IsNewerLive(numeric.device_id, numeric.metric_id,
+					numeric.instance_id, numeric.source_time))
+				{
+					listener.SnapshotNumericReceived(numeric);
+				}
+			}
+			for (int i = 0; i < reply.waveforms.length(); i++)
+			{
+				const SnapshotWaveform &waveform = reply.waveforms[i];
+				if (!IsNewerLive(waveform.device_id, waveform.metric_id,
+					waveform.instance_id, waveform.source_time))
+				{
+					listener.SnapshotWaveformReceived(waveform);
+				}
+			}
+
+			if (_receivedBatches.size() >= (size_t)reply.batch_count)
+			{
+				_pending = false;
+				_batchCount = (unsigned int)reply.batch_count;
+				_liveTimes.clear();
+				listener.SnapshotComplete();
+			}
+		}
+	}
+	return !_pending && _batchCount > 0;
+}
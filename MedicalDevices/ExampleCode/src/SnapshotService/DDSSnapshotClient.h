@@ -0,0 +1,153 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_SNAPSHOT_CLIENT_H
+#define DDS_SNAPSHOT_CLIENT_H
+
+#include <map>
+#include <set>
+#include <string>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataReader.h"
+#include "../CommonInfrastructure/DDSGenericDataWriter.h"
+#include "../Generated/trend.h"
+#include "../Generated/trendSupport.h"
+
+// ------------------------------------------------------------------------- //
+//
+// Receives the data of a snapshot.  The callbacks are called from the
+// thread that calls DDSSnapshotClient::ProcessReplies.
+//
+// ------------------------------------------------------------------------- //
+class SnapshotListener
+{
+public:
+	virtual ~SnapshotListener()
+	{
+	}
+
+	// The latest value of a stream that has no newer live sample
+	virtual void SnapshotNumericReceived(
+		const com::rti::medical::generated::SnapshotNumeric &numeric) = 0;
+
+	// The latest window of a stream that has no newer live frame
+	virtual void SnapshotWaveformReceived(
+		const com::rti::medical::generated::SnapshotWaveform &waveform) = 0;
+
+	// Every reply of the snapshot was received
+	virtual void SnapshotComplete()
+	{
+	}
+};
+
+// ------------------------------------------------------------------------- //
+//
+// DDSSnapshotClient:
+// Asks the snapshot service for the latest data of every stream, so a
+// station that starts late can show all of them at once, and hands the
+// streams over to the live data.
+//
+// The station creates its live DataReaders first, then sends the request,
+// and passes the source time of every live sample to OnLiveSample until the
+// snapshot is complete.  The data of the snapshot is then only passed to the
+// listener for the streams that have no newer live sample, so a value from
+// the snapshot never replaces a newer live value.  Once the snapshot is
+// complete, the live data is all the station needs.
+//
+// The requests and replies use the same QoS profile as the trend queries.
+// Neither is durable, so WaitForService waits until the service is
+// discovered before a request is sent.  When more than one snapshot service
+// answers, the snapshot is made of the replies of the service whose reply
+// arrived first: two services do not see the same samples, so their
+// batches cannot be mixed.
+//
+// ------------------------------------------------------------------------- //
+class DDSSnapshotClient
+{
+public:
+	// --- Constructor and destructor ---
+	// Creates the request DataWriter and the reply DataReader from the
+	// communicator.  The requester ID tells the replies to this station
+	// apart from the replies to other stations.  Throws a std::string on
+	// failure.
+	DDSSnapshotClient(DDSCommunicator *communicator,
+		const std::string &requesterId);
+
+	~DDSSnapshotClient();
+
+	// --- Discovery ---
+	// Blocks until a snapshot service has matched both the request
+	// DataWriter and the reply DataReader, or the timeout passes.  Returns
+	// false on timeout.
+	bool WaitForService(const DDS_Duration_t &timeout);
+
+	// --- Request ---
+	// Asks for the snapshot of a patient, or of SNAPSHOT_ALL_PATIENTS, with
+	// waveform windows of the given length (zero for numerics only).  A
+	// previous request that is not complete is abandoned.  Returns false if
+	// the request cannot be sent.
+	bool Request(int patientId, int waveformWindowMs);
+
+	// --- Handover ---
+	// Records the source time of a live sample, in nanoseconds since the
+	// epoch.  Does nothing when no request is pending.
+	void OnLiveSample(const char *deviceId, const char *metricId,
+		int instanceId, int64_t sourceTime);
+
+	// --- Replies ---
+	// Takes the available replies, and passes the data of the ones that
+	// answer the pending request to the listener.  Returns true when the
+	// snapshot is complete.
+	bool ProcessReplies(SnapshotListener &listener);
+
+	bool IsPending() const
+	{
+		return _pending;
+	}
+
+	// --- Accessors ---
+	// Triggers when there are replies to process
+	DDS::ReadCondition *GetCondition()
+	{
+		return _replyReader->GetCondition();
+	}
+
+	// Number of replies in the last complete snapshot
+	unsigned int GetBatchCount() const
+	{
+		return _batchCount;
+	}
+
+private:
+	// --- Private methods ---
+	bool IsNewerLive(const char *deviceId, const char *metricId,
+		int instanceId, int64_t sourceTime) const;
+
+	// --- Private members ---
+	std::string _requesterId;
+	GenericDataWriter<com::rti::medical::generated::SnapshotRequest>
+		*_requestWriter;
+	GenericDataReader<com::rti::medical::generated::SnapshotReply>
+		*_replyReader;
+
+	// The pending request, the DataWriter of the service that answers it,
+	// and the replies received from that service
+	bool _pending;
+	DDS_Long _requestId;
+	DDS_InstanceHandle_t _service;
+	std::set<DDS_Long> _receivedBatches;
+	unsigned int _batchCount;
+
+	// Source time of the latest live sample of each stream, by stream key,
+	// while a request is pending
+	std::map<std::string, int64_t> _liveTimes;
+};
+
+#endif
@@ -0,0 +1,451 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include "DDSSnapshotServiceInterface.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+// Converts a DDS timestamp to nanoseconds, the unit used by the store
+static int64_t ToNanoseconds(const DDS_Time_t &time)
+{
+	return (int64_t)time.sec * 1000000000LL + time.nanosec;
+}
+
+// Bound of the string<64> identifiers in ice.idl and trend.idl
+static const size_t IDENTIFIER_BOUND = 64;
+
+// Copies an identifier into a string field of a sample
+static void CopyIdentifier(char *destination, const char *source)
+{
+	strncpy(destination, source, IDENTIFIER_BOUND);
+	destination[IDENTIFIER_BOUND] = '\0';
+}
+
+// Gets the key of an instance that is no longer alive, from the sample that
+// reports it.  Returns false for any other sample.
+template <typename T>
+static bool GetRemovedKey(GenericDataReader<T> *reader,
+	const DDS_SampleInfo &info, T &key)
+{
+	if (info.valid_data ||
+		info.instance_state == DDS_ALIVE_INSTANCE_STATE)
+	{
+		return false;
+	}
+	return reader->GetDataReader()->get_key_value(key,
+		info.instance_handle) == DDS_RETCODE_OK;
+}
+
+// Applies the patient-device mapping changes to the snapshot store
+class SnapshotStoreMappingUpdater : public PatientMappingListener
+{
+public:
+	SnapshotStoreMappingUpdater(SnapshotStore &store) :
+		_store(store)
+	{
+	}
+
+	virtual void MappingsChanged(
+		const std::vector<PatientMappingChange> &changes)
+	{
+		for (size_t i = 0; i < changes.size(); i++)
+		{
+			if (changes[i].removed)
+			{
+				_store.RemoveDevicePatient(changes[i].deviceId);
+			} else
+			{
+				_store.SetDevicePatient(changes[i].deviceId,
+					changes[i].patientId);
+			}
+		}
+	}
+
+private:
+	SnapshotStore &_store;
+};
+
+// ----------------------------------------------------------------------------
+// The DDSSnapshotServiceInterface is the network interface to the snapshot
+// service.  This creates DataReaders to receive device data, patient-device
+// mappings and snapshot requests, and a DataWriter to send snapshot replies.
+//
+// This interface is built from:
+// 1. Network data types and topic names defined in the IDL files
+// 2. XML configuration files that describe the QoS profiles that should be
+//    used by individual DataWriters and DataReaders.  These describe the
+//    movement and persistence characteristics of the data (how reliable should
+//    this be?), as well as other QoS such as resource limits.
+// 3. The code itself creates DataReaders and DataWriters, and selects which
+//    QoS profile to use when creating them.
+//
+// For information on the data types, please see the ice.idl, patient.idl and
+// trend.idl files.
+//
+// For information on the quality of service, please see the
+// qos_profiles.xml file.
+// ------------------------------------------------------------------------- //
+
+DDSSnapshotServiceInterface::DDSSnapshotServiceInterface(
+	bool multicastAvailable) :
+	_requestCount(0),
+	_replyCount(0)
+{
+	_communicator = new DDSCommunicator();
+
+	std::vector<std::string> xmlFiles;
+
+	// Adding the XML files that contain profiles used by this application
+	xmlFiles.push_back(
+		"file://../../../src/Config/qos_profiles.xml");
+
+	std::string participantProfile;
+
+	// Configuring this application for multicast or no multicast.  Note that
+	// if you have no multicast, you will have to edit the XML QoS
+	// configuration to add the IP addresses of applications you want to
+	// discover and communicate with.
+	if (multicastAvailable)
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT;
+	} else
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
+	}
+
+	// Create a DomainParticipant
+	// Start by creating a DomainParticipant.  Generally you will have only
+	// one DomainParticipant per application.  The device data is sent on
+	// domain 5, the same domain used by the device data replay.
+	if (NULL == _communicator->CreateParticipant(5, xmlFiles,
+				ICE_QOS_LIBRARY, participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	// Create a Publisher and a Subscriber
+	// The Subscriber has the default QoS, so its DataReaders match the
+	// DataWriters of the devices and clients.  The mappings are read on a
+	// Subscriber of their own (see DDSPatientTransfer.h).
+	// Note that one Subscriber can be used to create multiple DataReaders
+	DDS::Publisher *pub = _communicator->CreatePublisher();
+	DDS::Subscriber *sub = _communicator->CreateSubscriber();
+
+	if (pub == NULL || sub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Publisher or Subscriber object";
+		throw errss.str();
+	}
+
+	// This application serves the whole unit, so it receives the device
+	// data of every patient group, and the default partition
+	// (see DDSPatientRouting.h)
+	SubscribeToAllPatientGroups(sub);
+
+	// Create the DataReaders and the DataWriter, and their Topics.
+	// The device data uses the same streaming profile as the applications
+	// that display it, the patient-device mapping uses the state data
+	// profile used by its DataWriter, and the requests and replies use the
+	// same profile as the trend queries.  The topic names are the constants
+	// defined in the .idl files.
+	_numericReader = new GenericDataReader<ice::Numeric>(_communicator,
+		ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+	_sampleArrayReader = new GenericDataReader<ice::SampleArray>(
+		_communicator, ice::SampleArrayTopic, ICE_QOS_LIBRARY,
+		QOS_PROFILE_STREAMING);
+
+	DDS::Topic *mappingTopic =
+		_communicator->CreateTopic<DevicePatientMapping>(
+			DevicePatientMappingTopic);
+	_mappingReader = new DDSPatientMappingReader(
+		_communicator->GetParticipant(), mappingTopic,
+		ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES);
+
+	_requestReader = new GenericDataReader<SnapshotRequest>(_communicator,
+		SnapshotRequestTopic, ICE_QOS_LIBRARY, QOS_PROFILE_TREND_QUERY);
+	_replyWriter = new GenericDataWriter<SnapshotReply>(_communicator,
+		SnapshotReplyTopic, ICE_QOS_LIBRARY, QOS_PROFILE_TREND_QUERY);
+
+	// Attach the conditions of all DataReaders to a single WaitSet so one
+	// thread can update the store and answer requests.
+	_waitSet = new DDS::WaitSet();
+	_waitSet->attach_condition(_numericReader->GetCondition());
+	_waitSet->attach_condition(_sampleArrayReader->GetCondition());
+	_waitSet->attach_condition(_mappingReader->GetCondition());
+	_waitSet->attach_condition(_requestReader->GetCondition());
+}
+
+// ----------------------------------------------------------------------------
+// Destructor.
+// Deletes the WaitSet, the DataReaders, the DataWriter, and the Communicator
+// object
+DDSSnapshotServiceInterface::~DDSSnapshotServiceInterface()
+{
+	_waitSet->detach_condition(_numericReader->GetCondition());
+	_waitSet->detach_condition(_sampleArrayReader->GetCondition());
+	_waitSet->detach_condition(_mappingReader->GetCondition());
+	_waitSet->detach_condition(_requestReader->GetCondition());
+	delete _waitSet;
+
+	delete _numericReader;
+	delete _sampleArrayReader;
+	delete _mappingReader;
+	delete _requestReader;
+	delete _replyWriter;
+
+	delete _communicator;
+}
+
+// ----------------------------------------------------------------------------
+// Waits for data, and processes everything that is available on any of the
+// DataReaders.  Device data and mappings are processed before requests, so a
+// request that arrives together with new data is answered with it.
+void DDSSnapshotServiceInterface::ProcessAvailableData(SnapshotStore &store,
+	const DDS_Duration_t &timeout)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode == DDS_RETCODE_TIMEOUT)
+	{
+		return;
+	}
+	if (retcode != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure waiting for snapshot service data";
+		throw errss.str();
+	}
+
+	bool requests = false;
+	for (int i = 0; i < activeConditions.length(); i++)
+	{
+		if (activeConditions[i] == _numericReader->GetCondition())
+		{
+			ProcessNumerics(store);
+		}
+		else if (activeConditions[i] == _sampleArrayReader->GetCondition())
+		{
+			ProcessSampleArrays(store);
+		}
+		else if (activeConditions[i] == _mappingReader->GetCondition())
+		{
+			ProcessMappings(store);
+		}
+		else if (activeConditions[i] == _requestReader->GetCondition())
+		{
+			requests = true;
+		}
+	}
+
+	if (requests)
+	{
+		ProcessRequests(store);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available Numeric samples, and keeps the latest value of each
+// stream.  A stream that is no longer alive is removed.
+void DDSSnapshotServiceInterface::ProcessNumerics(SnapshotStore &store)
+{
+	LoanedBatch<ice::Numeric> batch;
+	DdsAutoType<ice::Numeric> key;
+
+	while (_numericReader->Take(batch))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			if (batch.IsValid(i))
+			{
+				const ice::Numeric &numeric = batch.GetData(i);
+				store.AddNumeric(numeric.unique_device_identifier,
+					numeric.metric_id, numeric.instance_id,
+					ToNanoseconds(info.source_timestamp), numeric.value);
+			} else if (GetRemovedKey<ice::Numeric>(_numericReader, info,
+				key))
+			{
+				store.RemoveNumeric(key.unique_device_identifier,
+					key.metric_id, key.instance_id);
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available SampleArray frames, and adds them to the windows of
+// their streams.  A stream that is no longer alive is removed.
+void DDSSnapshotServiceInterface::ProcessSampleArrays(SnapshotStore &store)
+{
+	LoanedBatch<ice::SampleArray> batch;
+	DdsAutoType<ice::SampleArray> key;
+
+	while (_sampleArrayReader->Take(batch))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			if (batch.IsValid(i))
+			{
+				const ice::SampleArray &frame = batch.GetData(i);
+				if (frame.values.length() == 0)
+				{
+					continue;
+				}
+				store.AddFrame(frame.unique_device_identifier,
+					frame.metric_id, frame.instance_id,
+					ToNanoseconds(info.source_timestamp),
+					frame.millisecondsPerSample, &frame.values[0],
+					(unsigned int)frame.values.length());
+			} else if (GetRemovedKey<ice::SampleArray>(_sampleArrayReader,
+				info, key))
+			{
+				store.RemoveWindow(key.unique_device_identifier,
+					key.metric_id, key.instance_id);
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Applies all available patient-device mapping changes.  A mapping that is
+// no longer alive means the device stopped monitoring the patient.
+void DDSSnapshotServiceInterface::ProcessMappings(SnapshotStore &store)
+{
+	SnapshotStoreMappingUpdater updater(store);
+	_mappingReader->ProcessChanges(updater);
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available snapshot requests, and answers each of them
+void DDSSnapshotServiceInterface::ProcessRequests(SnapshotStore &store)
+{
+	LoanedBatch<SnapshotRequest> batch;
+
+	while (_requestReader->Take(batch))
+	{
+		for (LoanedBatch<SnapshotRequest>::ValidIterator it = batch.begin();
+			it != batch.end(); ++it)
+		{
+			AnswerRequest(store, *it);
+			_requestCount++;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Sends the latest data of every stream that matches the request, packed
+// into as few replies as the bounds of the reply type allow.  Reply i holds
+// the i-th group of MAX_SNAPSHOT_NUMERICS numerics and of
+// MAX_SNAPSHOT_WAVEFORMS windows.
+void DDSSnapshotServiceInterface::AnswerRequest(SnapshotStore &store,
+	const SnapshotRequest &request)
+{
+	int patientId = request.patient_id == SNAPSHOT_ALL_PATIENTS ?
+		SnapshotStore::ALL_PATIENTS : request.patient_id;
+
+	std::vector<const SnapshotNumericValue *> numerics;
+	std::vector<const SnapshotWindow *> windows;
+	store.FindNumerics(patientId, numerics);
+	if (request.waveform_window_ms > 0)
+	{
+		store.FindWindows(patientId, windows);
+	}
+
+	size_t numericBatches = (numerics.size() + MAX_SNAPSHOT_NUMERICS - 1) /
+		MAX_SNAPSHOT_NUMERICS;
+	size_t windowBatches = (windows.size() + MAX_SNAPSHOT_WAVEFORMS - 1) /
+		MAX_SNAPSHOT_WAVEFORMS;
+	size_t batchCount = numericBatches > windowBatches ?
+		numericBatches : windowBatches;
+
+	// A request that matches no data still gets an answer, so the
+	// requester does not wait for a reply that never comes
+	if (batchCount == 0)
+	{
+		batchCount = 1;
+	}
+
+	DDS_Time_t now;
+	_communicator->GetParticipant()->get_current_time(now);
+
+	CopyIdentifier(_reply.requester_id, request.requester_id);
+	_reply.request_id = request.request_id;
+	_reply.batch_count = (DDS_Long)batchCount;
+	_reply.snapshot_time = ToNanoseconds(now);
+
+	size_t numeric = 0;
+	size_t window = 0;
+	for (size_t b = 0; b < batchCount; b++)
+	{
+		_reply.batch_index = (DDS_Long)b;
+
+		DDS_Long length = 0;
+		_reply.numerics.length(MAX_SNAPSHOT_NUMERICS);
+		for (; numeric < numerics.size() && length < MAX_SNAPSHOT_NUMERICS;
+			numeric++, length++)
+		{
+			SnapshotNumeric &sample = _reply.numerics[length];
+			CopyIdentifier(sample.device_id,
+				numerics[numeric]->deviceId.c_str());
+			CopyIdentifier(sample.metric_id,
+				numerics[numeric]->metricId.c_str());
+			sample.instance_id = numerics[numeric]->instanceId;
+			sample.value = numerics[numeric]->value;
+			sample.source_time = numerics[numeric]->timestamp;
+		}
+		_reply.numerics.length(length);
+
+		length = 0;
+		_reply.waveforms.length(MAX_SNAPSHOT_WAVEFORMS);
+		for (; window < windows.size() && length < MAX_SNAPSHOT_WAVEFORMS;
+			window++, length++)
+		{
+			SnapshotWaveform &sample = _reply.waveforms[length];
+			CopyIdentifier(sample.device_id,
+				windows[window]->deviceId.c_str());
+			CopyIdentifier(sample.metric_id,
+				windows[window]->metricId.c_str());
+			sample.instance_id = windows[window]->instanceId;
+			sample.millisecondsPerSample =
+				windows[window]->millisecondsPerSample;
+			sample.source_time = windows[window]->timestamp;
+
+			windows[window]->CopyLatest(request.waveform_window_ms,
+				MAX_SNAPSHOT_WAVEFORM_VALUES, _values);
+			sample.values.length((DDS_Long)_values.size());
+			for (size_t v = 0; v < _values.size(); v++)
+			{
+				sample.values[(DDS_Long)v] = _values[v];
+			}
+		}
+		_reply.waveforms.length(length);
+
+		// The remaining replies of a snapshot that cannot be sent are not
+		// sent either, and the requester sees an incomplete snapshot
+		if (!_replyWriter->Write(_reply))
+		{
+			return;
+		}
+		_replyCount++;
+
+		// A reply is never written again, so its instance is unregistered
+		// right away.  The reply is still delivered reliably, and the
+		// DataWriter then forgets the instance (see the TrendQuery profile).
+		_replyWriter->Unregister(_reply);
+	}
+}
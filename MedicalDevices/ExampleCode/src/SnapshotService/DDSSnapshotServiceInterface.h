@@ -0,0 +1,144 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_SNAPSHOT_SERVICE_INTERFACE_H
+#define DDS_SNAPSHOT_SERVICE_INTERFACE_H
+
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataReader.h"
+#include "../CommonInfrastructure/DDSGenericDataWriter.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+#include "../Generated/trend.h"
+#include "../Generated/trendSupport.h"
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
+#include "SnapshotStore.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// The snapshot service interface receives numeric and waveform device data
+// and patient-device mappings, and answers snapshot requests from stations
+// that start late, such as an HMI that was restarted.
+//
+// Reading device data:
+// --------------------
+// This application receives ice::Numeric and ice::SampleArray data from
+// every device on the domain with the StreamingData QoS profile, and keeps
+// the latest value of each numeric stream and the latest window of each
+// waveform stream.  That profile does not keep any history for a station
+// that starts late, so without this service a station shows each stream only
+// when its device sends again, which for a blood pressure can be minutes.
+//
+// A stream whose instance is no longer alive is removed from the store, so
+// a station is not sent the last value of a device that was unplugged.
+//
+// Reading patient-device mappings:
+// --------------------------------
+// The DevicePatientMapping data tells the service which devices currently
+// monitor each patient, so a snapshot request for a patient is answered with
+// the streams of those devices.
+//
+// Answering snapshot requests:
+// ----------------------------
+// Each SnapshotRequest is answered with the whole snapshot, in as few
+// SnapshotReply samples as the bounds of the reply allow, instead of one
+// sample per stream.  The station then shows live data as it arrives (see
+// DDSSnapshotClient.h).
+//
+// All DataReaders are read by a single thread that waits on one WaitSet, so
+// the snapshot store needs no locking.
+//
+// For information on the data types, please see the ice.idl, patient.idl and
+// trend.idl files.
+//
+// For information on the quality of service, please see the
+// qos_profiles.xml file.
+//
+// ----------------------------------------------------------------------------
+class DDSSnapshotServiceInterface
+{
+
+public:
+
+	// --- Constructor ---
+	// Initializes the interface, including creating a DomainParticipant,
+	// a publisher, a subscriber, topics, DataReaders and a DataWriter.
+	DDSSnapshotServiceInterface(bool multicastAvailable);
+
+	// --- Destructor ---
+	~DDSSnapshotServiceInterface();
+
+	// --- Getter for Communicator ---
+	// Accessor for the communicator (the class that sets up the basic
+	// DDS infrastructure like the DomainParticipant).
+	// This allows access to the DDS DomainParticipant/Publisher/Subscriber
+	// classes
+	DDSCommunicator *GetCommunicator()
+	{
+		return _communicator;
+	}
+
+	// --- Processes received data ---
+	// Waits up to the timeout for data to arrive, adds any device data and
+	// patient-device mappings to the store, and answers any requests.
+	void ProcessAvailableData(SnapshotStore &store,
+		const DDS_Duration_t &timeout);
+
+	// --- Statistics ---
+	unsigned long GetRequestCount() const
+	{
+		return _requestCount;
+	}
+
+	unsigned long GetReplyCount() const
+	{
+		return _replyCount;
+	}
+
+private:
+	// --- Private methods ---
+	void ProcessNumerics(SnapshotStore &store);
+	void ProcessSampleArrays(SnapshotStore &store);
+	void ProcessMappings(SnapshotStore &store);
+	void ProcessRequests(SnapshotStore &store);
+	void AnswerRequest(SnapshotStore &store,
+		const com::rti::medical::generated::SnapshotRequest &request);
+
+	// --- Private members ---
+
+	// Used to create basic DDS entities that all applications need
+	DDSCommunicator *_communicator;
+
+	// Readers and writer specific to this application
+	GenericDataReader<ice::Numeric> *_numericReader;
+	GenericDataReader<ice::SampleArray> *_sampleArrayReader;
+	DDSPatientMappingReader *_mappingReader;
+	GenericDataReader<com::rti::medical::generated::SnapshotRequest>
+		*_requestReader;
+	GenericDataWriter<com::rti::medical::generated::SnapshotReply>
+		*_replyWriter;
+
+	// WaitSet used to wait for data on all readers
+	DDS::WaitSet *_waitSet;
+
+	// Reused for every reply, so answering a request does not allocate
+	DdsAutoType<com::rti::medical::generated::SnapshotReply> _reply;
+	std::vector<float> _values;
+
+	unsigned long _requestCount;
+	unsigned long _replyCount;
+};
+
+#endif
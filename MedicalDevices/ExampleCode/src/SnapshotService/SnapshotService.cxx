@@ -0,0 +1,150 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "DDSSnapshotServiceInterface.h"
+#include "SnapshotStore.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This application keeps the latest value of every ice::Numeric stream, and
+// the latest window of every ice::SampleArray stream on the domain, and
+// answers SnapshotRequests from stations that start late.
+//
+// The device data is sent with a volatile QoS, so a station that restarts
+// sees nothing of a stream until its device sends again: a second for most
+// numerics, but minutes for a non-invasive blood pressure.  With this
+// service, the station asks for a snapshot as soon as it starts, receives
+// every stream in a few large replies, and then shows the live data (see
+// DDSSnapshotClient.h).
+//
+// Streams that have not been updated for --stale-seconds are removed, so a
+// station is not sent the last value of a device that stopped sending.
+//
+// ------------------------------------------------------------------------- //
+
+int main(int argc, char *argv[])
+{
+	bool multicastAvailable = true;
+	long windowSeconds = 10;
+	long staleSeconds = 3600;
+
+	// Process the command-line arguments
+	for (int i = 0; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-multicast"))
+		{
+			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--window-seconds") && i + 1 < argc)
+		{
+			windowSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--stale-seconds") && i + 1 < argc)
+		{
+			staleSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else if (i > 0)
+		{
+			// If we have a parameter that is not the first one, and is not
+			// recognized, return an error.
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (windowSeconds <= 0 || staleSeconds <= 0)
+	{
+		cout << "The window and stale times must be positive" << endl;
+		return -1;
+	}
+
+	try
+	{
+		SnapshotStore store((unsigned int)windowSeconds * 1000);
+
+		// --------------------------------------------------------------------
+		// This is the network interface for this application - this is what
+		// actually receives the device data and snapshot requests, and sends
+		// the snapshot replies.  Look into this class to see what you need
+		// to do to implement an RTI Connext DDS application that reads and
+		// writes data.
+		DDSSnapshotServiceInterface snapshotInterface(multicastAvailable);
+
+		cout << "Snapshot service running" << endl;
+
+		DDS_Duration_t waitTime = {1, 0};
+		DDS_Time_t lastReport = {0, 0};
+		DDS_Time_t lastCleanup = {0, 0};
+
+		while (1)
+		{
+			snapshotInterface.ProcessAvailableData(store, waitTime);
+
+			DDS_Time_t now;
+			snapshotInterface.GetCommunicator()->GetParticipant()->
+				get_current_time(now);
+
+			// The stale streams are removed once a second, not after every
+			// sample
+			if (now.sec != lastCleanup.sec)
+			{
+				store.RemoveOlderThan(
+					(int64_t)(now.sec - staleSeconds) * 1000000000LL +
+					now.nanosec);
+				lastCleanup = now;
+			}
+
+			if (now.sec - lastReport.sec >= 60)
+			{
+				cout << store.GetNumericCount() << " numeric streams, "
+					<< store.GetWindowCount() << " waveform windows, "
+					<< store.GetMemorySize() / 1024 << " KB, "
+					<< snapshotInterface.GetRequestCount()
+					<< " requests answered in "
+					<< snapshotInterface.GetReplyCount() << " replies"
+					<< endl;
+				lastReport = now;
+			}
+		}
+	}
+	catch (string message)
+	{
+		cout << "Application exception: " << message << endl;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --no-multicast" <<
+		"                 Do not use multicast " <<
+		"(note you must edit XML" << endl <<
+		"                                   " <<
+		"config to include IP addresses)"
+		<< endl;
+	cout <<
+		"    --window-seconds <n>" <<
+		"           Waveform window kept per stream (default: 10)"
+		<< endl;
+	cout <<
+		"    --stale-seconds <n>" <<
+		"            Remove streams idle this long (default: 3600)"
+		<< endl;
+}
@@ -0,0 +1,304 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include "SnapshotStore.h"
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+
+// Built without a stringstream, as this runs for every sample
+static void MakeStreamKey(const char *deviceId, const char *metricId,
+	int instanceId, std::string &key)
+{
+	char instance[16];
+	sprintf(instance, "%d", instanceId);
+	key.assign(deviceId);
+	key.append("|").append(metricId).append("|").append(instance);
+}
+
+// Number of values in a window of the given length
+static size_t WindowCapacity(unsigned int windowMilliseconds,
+	int millisecondsPerSample)
+{
+	if (millisecondsPerSample <= 0)
+	{
+		return 1;
+	}
+	size_t capacity = windowMilliseconds / millisecondsPerSample;
+	return capacity == 0 ? 1 : capacity;
+}
+
+void SnapshotWindow::CopyLatest(unsigned int windowMilliseconds,
+	size_t maxValues, std::vector<float> &values) const
+{
+	size_t length = WindowCapacity(windowMilliseconds, millisecondsPerSample);
+	if (length > count)
+	{
+		length = count;
+	}
+	if (length > maxValues)
+	{
+		length = maxValues;
+	}
+
+	values.resize(length);
+	size_t index = (next + ring.size() - length) % ring.size();
+	for (size_t i = 0; i < length; i++)
+	{
+		values[i] = ring[index];
+		index = (index + 1) % ring.size();
+	}
+}
+
+SnapshotStore::SnapshotStore(unsigned int windowMilliseconds) :
+	_windowMilliseconds(windowMilliseconds)
+{
+}
+
+SnapshotStore::~SnapshotStore()
+{
+	for (std::map<std::string, SnapshotNumericValue *>::iterator it =
+		_numerics.begin(); it != _numerics.end(); ++it)
+	{
+		delete it->second;
+	}
+	for (std::map<std::string, SnapshotWindow *>::iterator it =
+		_windows.begin(); it != _windows.end(); ++it)
+	{
+		delete it->second;
+	}
+}
+
+void SnapshotStore::AddNumeric(const char *deviceId, const char *metricId,
+	int instanceId, int64_t timestamp, float value)
+{
+	std::string key;
+	MakeStreamKey(deviceId, metricId, instanceId, key);
+
+	std::map<std::string, SnapshotNumericValue *>::iterator it =
+		_numerics.find(key);
+	if (it == _numerics.end())
+	{
+		SnapshotNumericValue *numeric = new SnapshotNumericValue();
+		numeric->deviceId = deviceId;
+		numeric->metricId = metricId;
+		numeric->instanceId = instanceId;
+		numeric->timestamp = 0;
+		it = _numerics.insert(std::make_pair(key, numeric)).first;
+	}
+
+	SnapshotNumericValue *numeric = it->second;
+	if (timestamp < numeric->timestamp)
+	{
+		return;
+	}
+	numeric->value = value;
+	numeric->timestamp = timestamp;
+}
+
+void SnapshotStore::AddFrame(const char *deviceId, const char *metricId,
+	int instanceId, int64_t timestamp, int millisecondsPerSample,
+	const float *values, unsigned int count)
+{
+	std::string key;
+	MakeStreamKey(deviceId, metricId, instanceId, key);
+
+	std::map<std::string, SnapshotWindow *>::iterator it =
+		_windows.find(key);
+	if (it == _windows.end())
+	{
+		SnapshotWindow *window = new SnapshotWindow();
+		window->deviceId = deviceId;
+		window->metricId = metricId;
+		window->instanceId = instanceId;
+		window->millisecondsPerSample = millisecondsPerSample;
+		window->timestamp = 0;
+		window->ring.resize(WindowCapacity(_windowMilliseconds,
+			millisecondsPerSample));
+		window->next = 0;
+		window->count = 0;
+		it = _windows.insert(std::make_pair(key, window)).first;
+	}
+
+	SnapshotWindow *window = it->second;
+	if (timestamp <= window->timestamp)
+	{
+		return;
+	}
+
+	// A frame normally follows the previous one by its own duration.  A
+	// later frame means frames were lost, and the values in the window are
+	// no longer contiguous.
+	int64_t frameDuration = (int64_t)count * millisecondsPerSample *
+		NANOSECONDS_PER_MILLISECOND;
+	if (window->millisecondsPerSample != millisecondsPerSample)
+	{
+		window->millisecondsPerSample = millisecondsPerSample;
+		window->ring.resize(WindowCapacity(_windowMilliseconds,
+			millisecondsPerSample));
+		window->next = 0;
+		window->count = 0;
+	} else if (window->count > 0 &&
+		timestamp - window->timestamp > 2 * frameDuration)
+	{
+		window->next = 0;
+		window->count = 0;
+	}
+
+	size_t capacity = window->ring.size();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		window->ring[window->next] = values[i];
+		window->next = (window->next + 1) % capacity;
+	}
+	window->count += count;
+	if (window->count > capacity)
+	{
+		window->count = capacity;
+	}
+	window->timestamp = timestamp;
+}
+
+void SnapshotStore::RemoveNumeric(const char *deviceId, const char *metricId,
+	int instanceId)
+{
+	std::string key;
+	MakeStreamKey(deviceId, metricId, instanceId, key);
+
+	std::map<std::string, SnapshotNumericValue *>::iterator it =
+		_numerics.find(key);
+	if (it != _numerics.end())
+	{
+		delete it->second;
+		_numerics.erase(it);
+	}
+}
+
+void SnapshotStore::RemoveWindow(const char *deviceId, const char *metricId,
+	int instanceId)
+{
+	std::string key;
+	MakeStreamKey(deviceId, metricId, instanceId, key);
+
+	std::map<std::string, SnapshotWindow *>::iterator it =
+		_windows.find(key);
+	if (it != _windows.end())
+	{
+		delete it->second;
+		_windows.erase(it);
+	}
+}
+
+unsigned int SnapshotStore::RemoveOlderThan(int64_t timestamp)
+{
+	unsigned int removed = 0;
+	std::map<std::string, SnapshotNumericValue *>::iterator numeric =
+		_numerics.begin();
+	while (numeric != _numerics.end())
+	{
+		if (numeric->second->timestamp < timestamp)
+		{
+			delete numeric->second;
+			_numerics.erase(numeric++);
+			removed++;
+		} else
+		{
+			++numeric;
+		}
+	}
+
+	std::map<std::string, SnapshotWindow *>::iterator window =
+		_windows.begin();
+	while (window != _windows.end())
+	{
+		if (window->second->timestamp < timestamp)
+		{
+			delete window->second;
+			_windows.erase(window++);
+			removed++;
+		} else
+		{
+			++window;
+		}
+	}
+	return removed;
+}
+
+void SnapshotStore::SetDevicePatient(const std::string &deviceId,
+	int patientId)
+{
+	_devicePatients[deviceId] = patientId;
+}
+
+void SnapshotStore::RemoveDevicePatient(const std::string &deviceId)
+{
+	_devicePatients.erase(deviceId);
+}
+
+void SnapshotStore::FindNumerics(int patientId,
+	std::vector<const SnapshotNumericValue *> &numerics) const
+{
+	FindDeviceStreams(patientId, _numerics, numerics);
+}
+
+void SnapshotStore::FindWindows(int patientId,
+	std::vector<const SnapshotWindow *> &windows) const
+{
+	FindDeviceStreams(patientId, _windows, windows);
+}
+
+// The stream keys start with the device ID and a separator, so the streams
+// of a device are a contiguous range of the map
+template <typename S>
+void SnapshotStore::FindDeviceStreams(int patientId,
+	const std::map<std::string, S *> &streams,
+	std::vector<const S *> &found) const
+{
+	typedef typename std::map<std::string, S *>::const_iterator Iterator;
+
+	if (patientId == ALL_PATIENTS)
+	{
+		for (Iterator it = streams.begin(); it != streams.end(); ++it)
+		{
+			found.push_back(it->second);
+		}
+		return;
+	}
+
+	for (std::map<std::string, int>::const_iterator device =
+		_devicePatients.begin(); device != _devicePatients.end(); ++device)
+	{
+		if (device->second != patientId)
+		{
+			continue;
+		}
+
+		std::string prefix = device->first + "|";
+		for (Iterator it = streams.lower_bound(prefix);
+			it != streams.end() &&
+				it->first.compare(0, prefix.size(), prefix) == 0;
+			++it)
+		{
+			found.push_back(it->second);
+		}
+	}
+}
+
+size_t SnapshotStore::GetMemorySize() const
+{
+	size_t size = _numerics.size() * sizeof(SnapshotNumericValue);
+	for (std::map<std::string, SnapshotWindow *>::const_iterator it =
+		_windows.begin(); it != _windows.end(); ++it)
+	{
+		size += sizeof(SnapshotWindow) +
+			it->second->ring.size() * sizeof(float);
+	}
+	return size;
+}
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef SNAPSHOT_STORE_H
+#define SNAPSHOT_STORE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "../CommonInfrastructure/OSAPI.h"
+
+// ------------------------------------------------------------------------- //
+//
+// SnapshotStore:
+// Keeps the latest value of every numeric stream, and the latest window of
+// every waveform stream, so that a station that starts late can be sent
+// everything it has to display at once.
+//
+// Streams are found by key (device, metric and instance), and the keys
+// start with the device ID, so the streams of a patient's devices are found
+// without looking at any stream of another patient.
+//
+// Timestamps are in nanoseconds, and a sample that is older than the one
+// already stored for its stream is ignored.
+//
+// ------------------------------------------------------------------------- //
+
+// Latest value of one numeric stream
+struct SnapshotNumericValue
+{
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+	float value;
+	int64_t timestamp;
+};
+
+// Latest values of one waveform stream, kept in a ring that holds the
+// window length at the stream's sample period
+struct SnapshotWindow
+{
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+	int millisecondsPerSample;
+
+	// Time of the last frame added to the window
+	int64_t timestamp;
+
+	// The ring, the index of the next value to write, and the number of
+	// values in the ring
+	std::vector<float> ring;
+	size_t next;
+	size_t count;
+
+	// Copies the last values of the window that fit in windowMilliseconds,
+	// and at most maxValues of them, oldest first
+	void CopyLatest(unsigned int windowMilliseconds, size_t maxValues,
+		std::vector<float> &values) const;
+};
+
+class SnapshotStore
+{
+public:
+	// Patient ID that matches every stream
+	static const int ALL_PATIENTS = -1;
+
+	// --- Constructor and destructor ---
+	// Waveform windows hold windowMilliseconds of values
+	SnapshotStore(unsigned int windowMilliseconds = 10000);
+
+	~SnapshotStore();
+
+	// --- Adding data ---
+	void AddNumeric(const char *deviceId, const char *metricId,
+		int instanceId, int64_t timestamp, float value);
+
+	// Adds a frame of count values to the window of its stream.  A frame
+	// that does not follow the end of the window, because frames were lost
+	// or the sample period changed, starts a new window.
+	void AddFrame(const char *deviceId, const char *metricId,
+		int instanceId, int64_t timestamp, int millisecondsPerSample,
+		const float *values, unsigned int count);
+
+	// --- Removing data ---
+	// Called when a stream is no longer alive, so a station is not sent
+	// the last value of a device that was unplugged
+	void RemoveNumeric(const char *deviceId, const char *metricId,
+		int instanceId);
+	void RemoveWindow(const char *deviceId, const char *metricId,
+		int instanceId);
+
+	// Removes the streams that have not been updated since the timestamp.
+	// Returns the number of streams removed.
+	unsigned int RemoveOlderThan(int64_t timestamp);
+
+	// --- Patient-device mapping ---
+	void SetDevicePatient(const std::string &deviceId, int patientId);
+	void RemoveDevicePatient(const std::string &deviceId);
+
+	// --- Finding streams ---
+	// Appends the streams of the patient's devices, or of every device for
+	// ALL_PATIENTS
+	void FindNumerics(int patientId,
+		std::vector<const SnapshotNumericValue *> &numerics) const;
+	void FindWindows(int patientId,
+		std::vector<const SnapshotWindow *> &windows) const;
+
+	// --- Statistics ---
+	unsigned int GetNumericCount() const
+	{
+		return (unsigned int)_numerics.size();
+	}
+
+	unsigned int GetWindowCount() const
+	{
+		return (unsigned int)_windows.size();
+	}
+
+	unsigned int GetWindowMilliseconds() const
+	{
+		return _windowMilliseconds;
+	}
+
+	size_t GetMemorySize() const;
+
+private:
+	// --- Private methods ---
+	template <typename S>
+	void FindDeviceStreams(int patientId,
+		const std::map<std::string, S *> &streams,
+		std::vector<const S *> &found) const;
+
+	// --- Private members ---
+	unsigned int _windowMilliseconds;
+
+	// All streams, by stream key
+	std::map<std::string, SnapshotNumericValue *> _numerics;
+	std::map<std::string, SnapshotWindow *> _windows;
+
+	// Patient of each device, by device ID
+	std::map<std::string, int> _devicePatients;
+};
+
+#endif
@@ -0,0 +1,408 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include "DDSTrendServiceInterface.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+// Converts a DDS timestamp to nanoseconds, the unit used by the trends
+static int64_t ToNanoseconds(const DDS_Time_t &time)
+{
+	return (int64_t)time.sec * 1000000000LL + time.nanosec;
+}
+
+// Bound of the string<64> identifiers in ice.idl and trend.idl
+static const size_t IDENTIFIER_BOUND = 64;
+
+// Copies an identifier into a string field of a sample
+static void CopyIdentifier(char *destination, const char *source)
+{
+	strncpy(destination, source, IDENTIFIER_BOUND);
+	destination[IDENTIFIER_BOUND] = '\0';
+}
+
+// Applies the patient-device mapping changes to the trend store
+class TrendStoreMappingUpdater : public PatientMappingListener
+{
+public:
+	TrendStoreMappingUpdater(TrendStore &store) :
+		_store(store)
+	{
+	}
+
+	virtual void MappingsChanged(
+		const std::vector<PatientMappingChange> &changes)
+	{
+		for (size_t i = 0; i < changes.size(); i++)
+		{
+			if (changes[i].removed)
+			{
+				_store.RemoveDevicePatient(changes[i].deviceId);
+			} else
+			{
+				_store.SetDevicePatient(changes[i].deviceId,
+					changes[i].patientId);
+			}
+		}
+	}
+
+private:
+	TrendStore &_store;
+};
+
+// ----------------------------------------------------------------------------
+// The DDSTrendServiceInterface is the network interface to the trend service.
+// This creates DataReaders to receive numeric device data, patient-device
+// mappings and trend requests, and a DataWriter to send trend replies.
+//
+// This interface is built from:
+// 1. Network data types and topic names defined in the IDL files
+// 2. XML configuration files that describe the QoS profiles that should be
+//    used by individual DataWriters and DataReaders.  These describe the
+//    movement and persistence characteristics of the data (how reliable should
+//    this be?), as well as other QoS such as resource limits.
+// 3. The code itself creates DataReaders and DataWriters, and selects which
+//    QoS profile to use when creating them.
+//
+// For information on the data types, please see the ice.idl, patient.idl and
+// trend.idl files.
+//
+// For information on the quality of service, please see the
+// qos_profiles.xml file.
+// ------------------------------------------------------------------------- //
+
+DDSTrendServiceInterface::DDSTrendServiceInterface(bool multicastAvailable,
+	unsigned int maxInstances, int64_t staleTimeout) :
+	_requestCount(0)
+{
+	_communicator = new DDSCommunicator();
+
+	std::vector<std::string> xmlFiles;
+
+	// Adding the XML files that contain profiles used by this application
+	xmlFiles.push_back(
+		"file://../../../src/Config/qos_profiles.xml");
+
+	std::string participantProfile;
+
+	// Configuring this application for multicast or no multicast.  Note that
+	// if you have no multicast, you will have to edit the XML QoS
+	// configuration to add the IP addresses of applications you want to
+	// discover and communicate with.
+	if (multicastAvailable)
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT;
+	} else
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
+	}
+
+	// Create a DomainParticipant
+	// Start by creating a DomainParticipant.  Generally you will have only
+	// one DomainParticipant per application.  The device data is sent on
+	// domain 5, the same domain used by the device data replay.
+	if (NULL == _communicator->CreateParticipant(5, xmlFiles,
+				ICE_QOS_LIBRARY, participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	// Create a Publisher and a Subscriber
+	// The Subscriber has the default QoS, so its DataReaders match the
+	// DataWriters of the devices and clients.  The mappings are read on a
+	// Subscriber of their own (see DDSPatientTransfer.h).
+	// Note that one Subscriber can be used to create multiple DataReaders
+	DDS::Publisher *pub = _communicator->CreatePublisher();
+	DDS::Subscriber *sub = _communicator->CreateSubscriber();
+
+	if (pub == NULL || sub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Publisher or Subscriber object";
+		throw errss.str();
+	}
+
+	// This application processes the whole unit, so it receives the device
+	// data of every patient group, and the default partition
+	// (see DDSPatientRouting.h)
+	SubscribeToAllPatientGroups(sub);
+
+	// Creating Topics
+	// The topic names are the constants defined in the .idl files.
+	DDS::Topic *numericTopic = _communicator->CreateTopic<ice::Numeric>(
+		ice::NumericTopic);
+	DDS::Topic *mappingTopic =
+		_communicator->CreateTopic<DevicePatientMapping>(
+			DevicePatientMappingTopic);
+	DDS::Topic *requestTopic = _communicator->CreateTopic<TrendRequest>(
+		TrendRequestTopic);
+	DDS::Topic *replyTopic = _communicator->CreateTopic<TrendReply>(
+		TrendReplyTopic);
+
+	// Create the DataReaders.
+	// The numeric data uses the same streaming profile as the other
+	// applications that display device data, and the patient-device
+	// mapping uses the state data profile used by its DataWriter.
+	DDS::DataReader *reader = CreateInstanceLimitedReader(sub,
+		numericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING, maxInstances);
+	_numericReader = ice::NumericDataReader::narrow(reader);
+	if (_numericReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create Numeric reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	_mappingReader = new DDSPatientMappingReader(
+		_communicator->GetParticipant(), mappingTopic,
+		ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES);
+
+	reader = sub->create_datareader_with_profile(
+		requestTopic, ICE_QOS_LIBRARY, QOS_PROFILE_TREND_QUERY,
+		NULL, DDS_STATUS_MASK_NONE);
+	_requestReader = TrendRequestDataReader::narrow(reader);
+	if (_requestReader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create TrendRequest reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	_numericInstances = new InstanceTracker(_numericReader, staleTimeout);
+
+	// Create the DataWriter that sends the trend replies
+	DDS::DataWriter *writer = pub->create_datawriter_with_profile(
+		replyTopic, ICE_QOS_LIBRARY, QOS_PROFILE_TREND_QUERY,
+		NULL, DDS_STATUS_MASK_NONE);
+	_replyWriter = TrendReplyDataWriter::narrow(writer);
+	if (_replyWriter == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create TrendReply writer. Inconsistent Qos?";
+		throw errss.str();
+	}
+
+	// Create ReadConditions that trigger when there is any data in the
+	// DataReaders' queues, and attach all of them to a single WaitSet so
+	// one thread can update the trends and answer requests.
+	_numericCondition = _numericReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_requestCondition = _requestReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+
+	_waitSet = new DDS::WaitSet();
+	_waitSet->attach_condition(_numericCondition);
+	_waitSet->attach_condition(_mappingReader->GetCondition());
+	_waitSet->attach_condition(_requestCondition);
+}
+
+// ----------------------------------------------------------------------------
+// Destructor.
+// Deletes the WaitSet, the DataReaders, the DataWriter, and the Communicator
+// object
+DDSTrendServiceInterface::~DDSTrendServiceInterface()
+{
+	_waitSet->detach_condition(_numericCondition);
+	_waitSet->detach_condition(_mappingReader->GetCondition());
+	_waitSet->detach_condition(_requestCondition);
+	delete _waitSet;
+
+	delete _numericInstances;
+
+	_numericReader->delete_readcondition(_numericCondition);
+	_requestReader->delete_readcondition(_requestCondition);
+
+	delete _mappingReader;
+
+	DDS::Subscriber *sub = _numericReader->get_subscriber();
+	sub->delete_datareader(_numericReader);
+	sub->delete_datareader(_requestReader);
+	_numericReader = NULL;
+	_requestReader = NULL;
+
+	DDS::Publisher *pub = _replyWriter->get_publisher();
+	pub->delete_datawriter(_replyWriter);
+	_replyWriter = NULL;
+
+	delete _communicator;
+}
+
+// ----------------------------------------------------------------------------
+// Waits for data, and processes everything that is available on any of the
+// DataReaders.  Mappings are processed before requests, so a request that
+// arrives together with a new mapping sees that mapping.
+void DDSTrendServiceInterface::ProcessAvailableData(TrendStore &store,
+	const DDS_Duration_t &timeout)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode == DDS_RETCODE_TIMEOUT)
+	{
+		return;
+	}
+	if (retcode != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure waiting for trend service data";
+		throw errss.str();
+	}
+
+	bool requests = false;
+	for (int i = 0; i < activeConditions.length(); i++)
+	{
+		if (activeConditions[i] == _numericCondition)
+		{
+			ProcessNumerics(store);
+		}
+		else if (activeConditions[i] == _mappingReader->GetCondition())
+		{
+			ProcessMappings(store);
+		}
+		else if (activeConditions[i] == _requestCondition)
+		{
+			requests = true;
+		}
+	}
+
+	if (requests)
+	{
+		ProcessRequests(store);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available Numeric samples, and adds them to the trends of their
+// streams.  Every sample, including the ones that only report that an
+// instance is no longer alive, updates the instance tracker.
+void DDSTrendServiceInterface::ProcessNumerics(TrendStore &store)
+{
+	ice::NumericSeq dataSeq;
+	DDS_SampleInfoSeq infoSeq;
+	int64_t now = OSGetMonotonicTime();
+
+	while (_numericReader->take_w_condition(dataSeq, infoSeq,
+		DDS_LENGTH_UNLIMITED, _numericCondition) == DDS_RETCODE_OK)
+	{
+		for (int i = 0; i < dataSeq.length(); i++)
+		{
+			_numericInstances->OnSample(infoSeq[i], now);
+			if (!infoSeq[i].valid_data)
+			{
+				continue;
+			}
+			store.AddNumeric(dataSeq[i].unique_device_identifier,
+				dataSeq[i].metric_id, dataSeq[i].instance_id,
+				ToNanoseconds(infoSeq[i].source_timestamp),
+				dataSeq[i].value);
+		}
+		_numericReader->return_loan(dataSeq, infoSeq);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Applies all available patient-device mapping changes.  A mapping that is
+// no longer alive means the device stopped monitoring the patient.
+void DDSTrendServiceInterface::ProcessMappings(TrendStore &store)
+{
+	TrendStoreMappingUpdater updater(store);
+	_mappingReader->ProcessChanges(updater);
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available trend requests, and answers each of them
+void DDSTrendServiceInterface::ProcessRequests(TrendStore &store)
+{
+	TrendRequestSeq dataSeq;
+	DDS_SampleInfoSeq infoSeq;
+
+	while (_requestReader->take_w_condition(dataSeq, infoSeq,
+		DDS_LENGTH_UNLIMITED, _requestCondition) == DDS_RETCODE_OK)
+	{
+		for (int i = 0; i < dataSeq.length(); i++)
+		{
+			if (infoSeq[i].valid_data)
+			{
+				AnswerRequest(store, dataSeq[i]);
+				_requestCount++;
+			}
+		}
+		_requestReader->return_loan(dataSeq, infoSeq);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Sends one reply per stream of the patient that matches the request.  The
+// points are copied straight from the pyramid query into the reply sample.
+void DDSTrendServiceInterface::AnswerRequest(TrendStore &store,
+	const TrendRequest &request)
+{
+	std::vector<const TrendSeries *> series;
+	store.FindSeries(request.patient_id, request.metric_id, series);
+
+	unsigned int maxPoints = MAX_TREND_POINTS;
+	if (request.max_points > 0 && request.max_points < MAX_TREND_POINTS)
+	{
+		maxPoints = request.max_points;
+	}
+
+	CopyIdentifier(_reply.requester_id, request.requester_id);
+	_reply.request_id = request.request_id;
+	_reply.patient_id = request.patient_id;
+	_reply.series_count = (DDS_Long)series.size();
+
+	// A request that matches no data still gets an answer, so the
+	// requester does not wait for a reply that never comes
+	if (series.empty())
+	{
+		_reply.series_index = 0;
+		_reply.device_id[0] = '\0';
+		CopyIdentifier(_reply.metric_id, request.metric_id);
+		_reply.instance_id = 0;
+		_reply.point_width = 0;
+		_reply.points.length(0);
+		_replyWriter->write(_reply, DDS_HANDLE_NIL);
+		return;
+	}
+
+	for (size_t s = 0; s < series.size(); s++)
+	{
+		_reply.point_width = series[s]->pyramid.Query(request.start_time,
+			request.end_time, maxPoints, _points);
+
+		_reply.series_index = (DDS_Long)s;
+		CopyIdentifier(_reply.device_id, series[s]->deviceId.c_str());
+		CopyIdentifier(_reply.metric_id, series[s]->metricId.c_str());
+		_reply.instance_id = series[s]->instanceId;
+
+		_reply.points.length((DDS_Long)_points.size());
+		for (size_t p = 0; p < _points.size(); p++)
+		{
+			TrendSample &sample = _reply.points[(DDS_Long)p];
+			sample.start_time = _points[p].startTime;
+			sample.min_value = _points[p].minValue;
+			sample.max_value = _points[p].maxValue;
+			sample.mean_value = _points[p].meanValue;
+			sample.sample_count = _points[p].count;
+		}
+
+		// The remaining series of a request that cannot be sent are
+		// not sent either, and the requester sees an incomplete answer
+		if (_replyWriter->write(_reply, DDS_HANDLE_NIL) != DDS_RETCODE_OK)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_TREND_SERVICE_INTERFACE_H
+#define DDS_TREND_SERVICE_INTERFACE_H
+
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+#include "../Generated/trend.h"
+#include "../Generated/trendSupport.h"
+#include "../CommonInfrastructure/DDSInstanceTracker.h"
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
+#include "TrendStore.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// The trend service interface receives numeric device data and patient-device
+// mappings, and answers trend requests from applications such as the HMI.
+//
+// Reading numeric device data:
+// ----------------------------
+// This application receives ice::Numeric data from every device on the
+// domain with the StreamingData QoS profile, and adds every sample to the
+// trend pyramids of its stream as it arrives.
+//
+// Reading patient-device mappings:
+// --------------------------------
+// The DevicePatientMapping data tells the service which devices currently
+// monitor each patient, so a trend request for a patient is answered with the
+// streams of those devices.  The mappings are read on a Subscriber with
+// coherent access, so the changes of a patient transfer are applied to the
+// store all at once.
+//
+// The Numeric DataReader sees one instance per device, metric and instance
+// ID.  It purges the instances of devices that are unplugged, and holds at
+// most a maximum of instances, so its instances do not accumulate over
+// weeks of uptime (see DDSInstanceTracker.h).
+//
+// Answering trend requests:
+// -------------------------
+// Each TrendRequest is answered with one TrendReply per matching stream.  The
+// replies are built from the trend pyramids, so the time to answer a request
+// depends on the number of points requested, not the length of the range.
+//
+// All three DataReaders are read by a single thread that waits on one
+// WaitSet, so the trend store needs no locking.
+//
+// For information on the data types, please see the ice.idl, patient.idl and
+// trend.idl files.
+//
+// For information on the quality of service, please see the
+// qos_profiles.xml file.
+//
+// ----------------------------------------------------------------------------
+class DDSTrendServiceInterface
+{
+
+public:
+
+	// --- Constructor ---
+	// Initializes the interface, including creating a DomainParticipant,
+	// a publisher, a subscriber, topics, DataReaders and a DataWriter.
+	// The Numeric DataReader holds at most maxInstances instances, and
+	// instances that have not been updated for staleTimeout nanoseconds are
+	// counted as stale.
+	DDSTrendServiceInterface(bool multicastAvailable,
+		unsigned int maxInstances = UNLIMITED_INSTANCES,
+		int64_t staleTimeout = 0);
+
+	// --- Destructor ---
+	~DDSTrendServiceInterface();
+
+	// --- Getter for Communicator ---
+	// Accessor for the communicator (the class that sets up the basic
+	// DDS infrastructure like the DomainParticipant).
+	// This allows access to the DDS DomainParticipant/Publisher/Subscriber
+	// classes
+	DDSCommunicator *GetCommunicator()
+	{
+		return _communicator;
+	}
+
+	// --- Processes received data ---
+	// Waits up to the timeout for data to arrive, adds any numeric data and
+	// patient-device mappings to the store, and answers any trend requests.
+	void ProcessAvailableData(TrendStore &store,
+		const DDS_Duration_t &timeout);
+
+	// --- Statistics ---
+	unsigned long GetRequestCount() const
+	{
+		return _requestCount;
+	}
+
+	// --- Instances ---
+	void GetNumericInstanceMetrics(InstanceMetrics &metrics) const
+	{
+		_numericInstances->GetMetrics(metrics, OSGetMonotonicTime());
+	}
+
+private:
+	// --- Private methods ---
+	void ProcessNumerics(TrendStore &store);
+	void ProcessMappings(TrendStore &store);
+	void ProcessRequests(TrendStore &store);
+	void AnswerRequest(TrendStore &store,
+		const com::rti::medical::generated::TrendRequest &request);
+
+	// --- Private members ---
+
+	// Used to create basic DDS entities that all applications need
+	DDSCommunicator *_communicator;
+
+	// Readers and writer specific to this application
+	ice::NumericDataReader *_numericReader;
+	DDSPatientMappingReader *_mappingReader;
+	com::rti::medical::generated::TrendRequestDataReader *_requestReader;
+	com::rti::medical::generated::TrendReplyDataWriter *_replyWriter;
+
+	// Conditions and WaitSet used to wait for data on all readers
+	DDS::ReadCondition *_numericCondition;
+	DDS::ReadCondition *_requestCondition;
+	DDS::WaitSet *_waitSet;
+
+	// Instances of the Numeric DataReader
+	InstanceTracker *_numericInstances;
+
+	// Reused for every reply, so answering a request does not allocate
+	DdsAutoType<com::rti::medical::generated::TrendReply> _reply;
+	std::vector<TrendPoint> _points;
+
+	unsigned long _requestCount;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "DDSTrendServiceInterface.h"
+#include "TrendStore.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This application keeps the trend history of every ice::Numeric stream on
+// the domain, and answers TrendRequests from applications such as the HMI.
+//
+// Every sample updates min/max/mean buckets at 1 s, 10 s, 1 min and 10 min
+// resolution as it arrives (see TrendPyramid.h), so a request for hours of
+// data is answered from a few thousand precomputed buckets instead of a scan
+// of the raw samples.
+//
+// With --recording, the service starts with the history recorded by the
+// DeviceRecorder application.
+//
+// The Numeric DataReader purges the instances of devices that are unplugged,
+// and holds at most --max-instances instances, rejecting the samples of new
+// instances once it is full, so the memory of the service stays bounded as
+// devices come and go.  Instances not updated for --stale-seconds are
+// reported as stale.
+//
+// ------------------------------------------------------------------------- //
+
+int main(int argc, char *argv[])
+{
+	bool multicastAvailable = true;
+	std::string recording;
+	unsigned long maxInstances = 100000;
+	long staleSeconds = 300;
+
+	// Process the command-line arguments
+	for (int i = 0; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-multicast"))
+		{
+			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--recording") && i + 1 < argc)
+		{
+			recording = argv[++i];
+		} else if (0 == strcmp(argv[i], "--max-instances") && i + 1 < argc)
+		{
+			maxInstances = strtoul(argv[++i], NULL, 10);
+		} else if (0 == strcmp(argv[i], "--stale-seconds") && i + 1 < argc)
+		{
+			staleSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else if (i > 0)
+		{
+			// If we have a parameter that is not the first one, and is not
+			// recognized, return an error.
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	try
+	{
+		TrendStore store;
+
+		if (!recording.empty())
+		{
+			uint64_t loaded = store.LoadRecording(recording);
+			cout << "Loaded " << loaded << " samples of "
+				<< store.GetSeriesCount() << " streams from " << recording
+				<< endl;
+		}
+
+		// --------------------------------------------------------------------
+		// This is the network interface for this application - this is what
+		// actually receives the device data and trend requests, and sends
+		// the trend replies.  Look into this class to see what you need to
+		// do to implement an RTI Connext DDS application that reads and
+		// writes data.
+		DDSTrendServiceInterface trendInterface(multicastAvailable,
+			(unsigned int)maxInstances,
+			(int64_t)staleSeconds * 1000000000LL);
+
+		cout << "Trend service running" << endl;
+
+		DDS_Duration_t waitTime = {1, 0};
+		DDS_Time_t lastReport = {0, 0};
+
+		while (1)
+		{
+			trendInterface.ProcessAvailableData(store, waitTime);
+
+			DDS_Time_t now;
+			trendInterface.GetCommunicator()->GetParticipant()->
+				get_current_time(now);
+
+			if (now.sec - lastReport.sec >= 60)
+			{
+				cout << store.GetSeriesCount() << " streams, "
+					<< store.GetMemorySize() / 1024 << " KB of trends, "
+					<< trendInterface.GetRequestCount()
+					<< " requests answered" << endl;
+
+				InstanceMetrics instances;
+				trendInterface.GetNumericInstanceMetrics(instances);
+				cout << instances.instanceCount << " Numeric instances ("
+					<< instances.peakInstanceCount << " peak, "
+					<< instances.staleCount << " stale), "
+					<< instances.addedCount << " added, "
+					<< instances.purgedCount << " purged, "
+					<< instances.readerSampleCount << " samples held, "
+					<< instances.rejectedSampleCount << " rejected" << endl;
+				lastReport = now;
+			}
+		}
+	}
+	catch (string message)
+	{
+		cout << "Application exception: " << message << endl;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --no-multicast" <<
+		"                 Do not use multicast " <<
+		"(note you must edit XML" << endl <<
+		"                                   " <<
+		"config to include IP addresses)"
+		<< endl;
+	cout <<
+		"    --recording <path>" <<
+		"             Start with the history recorded by DeviceRecorder"
+		<< endl;
+	cout <<
+		"    --max-instances <n>" <<
+		"            Numeric instances to hold (default: 100000, 0 for" <<
+		endl << "                                   no limit)"
+		<< endl;
+	cout <<
+		"    --stale-seconds <n>" <<
+		"            Report Numeric instances idle this long (default: 300)"
+		<< endl;
+}
@@ -0,0 +1,139 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdio.h>
+#include "TrendStore.h"
+#include "../CommonInfrastructure/ColumnarSegment.h"
+
+TrendStore::TrendStore(const std::vector<TrendLevelConfig> &levels) :
+	_levels(levels)
+{
+}
+
+TrendStore::~TrendStore()
+{
+	for (std::map<std::string, TrendSeries *>::iterator it = _series.begin();
+		it != _series.end(); ++it)
+	{
+		delete it->second;
+	}
+}
+
+void TrendStore::AddNumeric(const char *deviceId, const char *metricId,
+	int instanceId, int64_t timestamp, float value)
+{
+	// Built without a stringstream, as this runs for every sample
+	char instance[16];
+	sprintf(instance, "%d", instanceId);
+	std::string key(deviceId);
+	key.append("|").append(metricId).append("|").append(instance);
+
+	std::map<std::string, TrendSeries *>::iterator it = _series.find(key);
+	if (it == _series.end())
+	{
+		TrendSeries *series = new TrendSeries(deviceId, metricId,
+			instanceId, _levels);
+		it = _series.insert(std::make_pair(key, series)).first;
+		_deviceSeries[series->deviceId].push_back(series);
+	}
+	it->second->pyramid.Add(timestamp, value);
+}
+
+uint64_t TrendStore::LoadRecording(const std::string &directory)
+{
+	std::vector<std::string> segments;
+	FindSegmentFiles(directory, segments);
+
+	uint64_t added = 0;
+	std::vector<int64_t> timestamps;
+	std::vector<float> values;
+
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		ColumnarSegmentReader reader(segments[i]);
+		const SegmentFileHeader &header = reader.GetFileHeader();
+		if (header.streamKind != SEGMENT_NUMERIC)
+		{
+			continue;
+		}
+
+		for (unsigned int b = 0; b < reader.GetBlockCount(); b++)
+		{
+			const SegmentBlockHeader &block = reader.GetBlockHeader(b);
+			if (block.sampleCount == 0)
+			{
+				continue;
+			}
+			if (values.size() < block.sampleCount)
+			{
+				timestamps.resize(block.sampleCount);
+				values.resize(block.sampleCount);
+			}
+			unsigned int count = reader.DecodeBlock(b, &timestamps[0],
+				&values[0]);
+			for (unsigned int v = 0; v < count; v++)
+			{
+				AddNumeric(header.deviceId, header.metricId,
+					header.instanceId, timestamps[v], values[v]);
+			}
+			added += count;
+		}
+	}
+	return added;
+}
+
+void TrendStore::SetDevicePatient(const std::string &deviceId, int patientId)
+{
+	_devicePatients[deviceId] = patientId;
+}
+
+void TrendStore::RemoveDevicePatient(const std::string &deviceId)
+{
+	_devicePatients.erase(deviceId);
+}
+
+void TrendStore::FindSeries(int patientId, const std::string &metricId,
+	std::vector<const TrendSeries *> &series) const
+{
+	for (std::map<std::string, int>::const_iterator it =
+		_devicePatients.begin(); it != _devicePatients.end(); ++it)
+	{
+		if (it->second != patientId)
+		{
+			continue;
+		}
+
+		std::map<std::string, std::vector<TrendSeries *> >::const_iterator
+			device = _deviceSeries.find(it->first);
+		if (device == _deviceSeries.end())
+		{
+			continue;
+		}
+
+		for (size_t i = 0; i < device->second.size(); i++)
+		{
+			if (metricId.empty() || device->second[i]->metricId == metricId)
+			{
+				series.push_back(device->second[i]);
+			}
+		}
+	}
+}
+
+size_t TrendStore::GetMemorySize() const
+{
+	size_t size = 0;
+	for (std::map<std::string, TrendSeries *>::const_iterator it =
+		_series.begin(); it != _series.end(); ++it)
+	{
+		size += sizeof(TrendSeries) + it->second->pyramid.GetMemorySize();
+	}
+	return size;
+}
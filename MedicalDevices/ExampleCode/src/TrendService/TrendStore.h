@@ -0,0 +1,100 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef TREND_STORE_H
+#define TREND_STORE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "../CommonInfrastructure/TrendPyramid.h"
+
+// ------------------------------------------------------------------------- //
+//
+// TrendStore:
+// Keeps one TrendPyramid per numeric stream (device, metric and instance),
+// and the latest patient each device is monitoring, so the trends of a
+// patient can be found without looking at any stream of another patient.
+//
+// History is kept per device, and a trend query for a patient returns the
+// streams of the devices currently mapped to that patient.
+//
+// ------------------------------------------------------------------------- //
+
+// History of one stream
+struct TrendSeries
+{
+	TrendSeries(const std::string &device, const std::string &metric,
+		int instance, const std::vector<TrendLevelConfig> &levels) :
+		deviceId(device),
+		metricId(metric),
+		instanceId(instance),
+		pyramid(levels)
+	{
+	}
+
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+	TrendPyramid pyramid;
+};
+
+class TrendStore
+{
+public:
+	// --- Constructor and destructor ---
+	TrendStore(const std::vector<TrendLevelConfig> &levels =
+		TrendPyramid::DefaultLevels());
+
+	~TrendStore();
+
+	// --- Adding data ---
+	// Timestamps are in nanoseconds
+	void AddNumeric(const char *deviceId, const char *metricId,
+		int instanceId, int64_t timestamp, float value);
+
+	// Adds the numeric segments found under a recording directory written
+	// by the DeviceRecorder, so the trends start with the recorded history.
+	// Returns the number of samples added.
+	uint64_t LoadRecording(const std::string &directory);
+
+	// --- Patient-device mapping ---
+	void SetDevicePatient(const std::string &deviceId, int patientId);
+	void RemoveDevicePatient(const std::string &deviceId);
+
+	// --- Finding trends ---
+	// Appends the series of the patient's devices to series.  An empty
+	// metric ID matches every metric.
+	void FindSeries(int patientId, const std::string &metricId,
+		std::vector<const TrendSeries *> &series) const;
+
+	// --- Statistics ---
+	unsigned int GetSeriesCount() const
+	{
+		return (unsigned int)_series.size();
+	}
+
+	size_t GetMemorySize() const;
+
+private:
+	// --- Private members ---
+	std::vector<TrendLevelConfig> _levels;
+
+	// All series, by stream key
+	std::map<std::string, TrendSeries *> _series;
+
+	// Series of each device, by device ID
+	std::map<std::string, std::vector<TrendSeries *> > _deviceSeries;
+
+	// Patient of each device, by device ID
+	std::map<std::string, int> _devicePatients;
+};
+
+#endif
@@ -0,0 +1,195 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include "DDSVitalsBoardInterface.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+// Converts a DDS timestamp to nanoseconds, the unit used by the board
+static int64_t ToNanoseconds(const DDS_Time_t &time)
+{
+	return (int64_t)time.sec * 1000000000LL + time.nanosec;
+}
+
+// Applies the patient-device mapping changes to the board
+class BoardMappingUpdater : public PatientMappingListener
+{
+public:
+	BoardMappingUpdater(VitalsBoardWriter &board) :
+		_board(board)
+	{
+	}
+
+	virtual void MappingsChanged(
+		const std::vector<PatientMappingChange> &changes)
+	{
+		for (size_t i = 0; i < changes.size(); i++)
+		{
+			if (changes[i].removed)
+			{
+				_board.RemoveDevicePatient(changes[i].deviceId);
+			} else
+			{
+				_board.SetDevicePatient(changes[i].deviceId,
+					changes[i].patientId);
+			}
+		}
+	}
+
+private:
+	VitalsBoardWriter &_board;
+};
+
+// ----------------------------------------------------------------------------
+// The DDSVitalsBoardInterface is the network interface of the vitals board.
+// This creates DataReaders to receive numerics and patient-device mappings.
+//
+// The device data is sent on domain 5, the same domain used by the device
+// data replay.
+// ------------------------------------------------------------------------- //
+
+DDSVitalsBoardInterface::DDSVitalsBoardInterface(bool multicastAvailable)
+{
+	_communicator = new DDSCommunicator();
+
+	std::vector<std::string> xmlFiles;
+
+	// Adding the XML files that contain profiles used by this application
+	xmlFiles.push_back(
+		"file://../../../src/Config/qos_profiles.xml");
+
+	// Configuring this application for multicast or no multicast.  Note that
+	// if you have no multicast, you will have to edit the XML QoS
+	// configuration to add the IP addresses of applications you want to
+	// discover and communicate with.
+	std::string participantProfile;
+	if (multicastAvailable)
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT;
+	} else
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
+	}
+
+	if (NULL == _communicator->CreateParticipant(5, xmlFiles,
+				ICE_QOS_LIBRARY, participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create DomainParticipant object";
+		throw errss.str();
+	}
+
+	// The Subscriber has the default QoS, so its DataReaders match the
+	// DataWriters of the devices.  The mappings are read on a coherent
+	// Subscriber of their own (see DDSPatientTransfer.h).
+	DDS::Subscriber *sub = _communicator->CreateSubscriber();
+	if (sub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Subscriber object";
+		throw errss.str();
+	}
+
+	// The board holds the values of every patient of the host, so this
+	// application receives the device data of every patient group
+	SubscribeToAllPatientGroups(sub);
+
+	_numericReader = new GenericDataReader<ice::Numeric>(_communicator,
+		ice::NumericTopic, ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING);
+
+	DDS::Topic *mappingTopic =
+		_communicator->CreateTopic<DevicePatientMapping>(
+			DevicePatientMappingTopic);
+	_mappingReader = new DDSPatientMappingReader(
+		_communicator->GetParticipant(), mappingTopic,
+		ICE_QOS_LIBRARY, QOS_PROFILE_PATIENT_DEVICES);
+
+	_waitSet = new DDS::WaitSet();
+	_waitSet->attach_condition(_numericReader->GetCondition());
+	_waitSet->attach_condition(_mappingReader->GetCondition());
+}
+
+// ----------------------------------------------------------------------------
+// Destructor.
+// Deletes the WaitSet, the DataReaders, and the Communicator object
+DDSVitalsBoardInterface::~DDSVitalsBoardInterface()
+{
+	_waitSet->detach_condition(_numericReader->GetCondition());
+	_waitSet->detach_condition(_mappingReader->GetCondition());
+	delete _waitSet;
+
+	delete _numericReader;
+	delete _mappingReader;
+
+	delete _communicator;
+}
+
+// ----------------------------------------------------------------------------
+// Waits for data.  The mappings are applied first, so the numerics that
+// arrive together with them are shown for their new patient.  The board is
+// published even when the wait times out, so its heartbeat keeps going.
+void DDSVitalsBoardInterface::ProcessAvailableData(VitalsBoardWriter &board,
+	const DDS_Duration_t &timeout)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode != DDS_RETCODE_OK && retcode != DDS_RETCODE_TIMEOUT)
+	{
+		std::stringstream errss;
+		errss << "Failure waiting for vitals board data";
+		throw errss.str();
+	}
+
+	if (retcode == DDS_RETCODE_OK)
+	{
+		ProcessMappings(board);
+		ProcessNumerics(board);
+	}
+	board.Publish();
+}
+
+void DDSVitalsBoardInterface::ProcessMappings(VitalsBoardWriter &board)
+{
+	BoardMappingUpdater updater(board);
+	_mappingReader->ProcessChanges(updater);
+}
+
+// ----------------------------------------------------------------------------
+// Takes all available numerics.  A stream that is no longer alive is
+// removed from the board.
+void DDSVitalsBoardInterface::ProcessNumerics(VitalsBoardWriter &board)
+{
+	LoanedBatch<ice::Numeric> batch;
+	DdsAutoType<ice::Numeric> key;
+
+	while (_numericReader->Take(batch))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			if (batch.IsValid(i))
+			{
+				const ice::Numeric &numeric = batch.GetData(i);
+				board.UpdateValue(numeric.unique_device_identifier,
+					numeric.metric_id, numeric.instance_id, numeric.value,
+					ToNanoseconds(info.source_timestamp));
+			} else if (info.instance_state != DDS_ALIVE_INSTANCE_STATE &&
+				_numericReader->GetDataReader()->get_key_value(key,
+					info.instance_handle) == DDS_RETCODE_OK)
+			{
+				board.RemoveValue(key.unique_device_identifier,
+					key.metric_id, key.instance_id);
+			}
+		}
+	}
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_VITALS_BOARD_INTERFACE_H
+#define DDS_VITALS_BOARD_INTERFACE_H
+
+#include <sstream>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSGenericDataReader.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/SharedVitalsBoard.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/patient.h"
+#include "../Generated/patientSupport.h"
+#include "../CommonInfrastructure/DDSPatientTransfer.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// The vitals board interface receives numerics and patient-device mappings,
+// and keeps the latest value of every numeric on a shared vitals board, for
+// the display processes of the same host (see SharedVitalsBoard.h).
+//
+// Reading sensor data:
+// --------------------
+// ice::Numeric data is read with the StreamingData QoS profile, from every
+// patient group.  Each numeric replaces the value of its stream on the
+// board, and a stream whose instance is no longer alive is removed from it.
+//
+// Reading patient-device mappings:
+// --------------------------------
+// DevicePatientMapping data is read with the PatientDeviceProfile QoS
+// profile, and sets the patient of the streams of each device, so a display
+// reads the values of its patient without knowing its devices.
+//
+// All DataReaders are read by a single thread that waits on one WaitSet,
+// which is also the only thread that writes the board.  The updates of the
+// data taken after one wait are published to the readers of the board
+// together.
+//
+// For information on the data types, please see the ice.idl and
+// patient.idl files.
+//
+// For information on the quality of service, please see the
+// qos_profiles.xml file.
+//
+// ----------------------------------------------------------------------------
+class DDSVitalsBoardInterface
+{
+
+public:
+
+	// --- Constructor ---
+	// Creates the DomainParticipant, and the DataReaders of the numerics and
+	// of the patient-device mappings.  Throws a std::string if any of them
+	// cannot be created.
+	DDSVitalsBoardInterface(bool multicastAvailable);
+
+	// --- Destructor ---
+	~DDSVitalsBoardInterface();
+
+	// --- Getter for Communicator ---
+	DDSCommunicator *GetCommunicator()
+	{
+		return _communicator;
+	}
+
+	// --- Processes received data ---
+	// Waits up to the timeout for data, writes it to the board, and
+	// publishes the board.  Throws a std::string if waiting fails.
+	void ProcessAvailableData(VitalsBoardWriter &board,
+		const DDS_Duration_t &timeout);
+
+private:
+	// --- Private methods ---
+	void ProcessMappings(VitalsBoardWriter &board);
+	void ProcessNumerics(VitalsBoardWriter &board);
+
+	// --- Private members ---
+
+	// Used to create basic DDS entities that all applications need
+	DDSCommunicator *_communicator;
+
+	GenericDataReader<ice::Numeric> *_numericReader;
+	DDSPatientMappingReader *_mappingReader;
+
+	// WaitSet used to wait for data on all readers
+	DDS::WaitSet *_waitSet;
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "DDSVitalsBoardInterface.h"
+#include "../CommonInfrastructure/SharedVitalsBoard.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This application keeps the latest value of every ice::Numeric stream on a
+// shared vitals board, a region of shared memory that the display and
+// analysis processes of the same host map read-only (see
+// SharedVitalsBoard.h).
+//
+// Without it, each of these processes creates its own DomainParticipant and
+// DataReader, receives every numeric, and keeps its own copy of every
+// latest value.  With it, only this process receives the numerics, and the
+// others read the values of their patient from the board with a
+// VitalsBoardReader, polling it or waiting for it to change.
+//
+// ------------------------------------------------------------------------- //
+
+int main(int argc, char *argv[])
+{
+	bool multicastAvailable = true;
+	string boardName = VITALS_BOARD_DEFAULT_NAME;
+	long slotCount = 4096;
+
+	// Process the command-line arguments
+	for (int i = 0; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-multicast"))
+		{
+			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--board") && i + 1 < argc)
+		{
+			boardName = argv[++i];
+		} else if (0 == strcmp(argv[i], "--slots") && i + 1 < argc)
+		{
+			slotCount = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else if (i > 0)
+		{
+			// If we have a parameter that is not the first one, and is not
+			// recognized, return an error.
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+	if (slotCount <= 0)
+	{
+		cout << "The number of slots must be positive" << endl;
+		return -1;
+	}
+
+	try
+	{
+		VitalsBoardWriter board(boardName, (unsigned int)slotCount);
+
+		// --------------------------------------------------------------------
+		// This is the network interface for this application - it receives
+		// the numerics and mappings, and writes them to the board.
+		DDSVitalsBoardInterface boardInterface(multicastAvailable);
+
+		cout << "Vitals board " << boardName << " running with "
+			<< slotCount << " slots, " << board.GetBoardSize() / 1024
+			<< " KB" << endl;
+
+		// The board is published at least every 100 ms, which is the
+		// heartbeat readers see while no data arrives
+		DDS_Duration_t waitTime = {0, 100000000};
+		DDS_Time_t lastReport = {0, 0};
+
+		while (1)
+		{
+			boardInterface.ProcessAvailableData(board, waitTime);
+
+			DDS_Time_t now;
+			boardInterface.GetCommunicator()->GetParticipant()->
+				get_current_time(now);
+			if (now.sec - lastReport.sec >= 60)
+			{
+				cout << board.GetStreamCount() << " streams of "
+					<< board.GetSlotCount() << " slots, "
+					<< board.GetUpdateCount() << " updates, "
+					<< board.GetFullCount() << " dropped because the board "
+					<< "is full" << endl;
+				lastReport = now;
+			}
+		}
+	}
+	catch (string message)
+	{
+		cout << "Application exception: " << message << endl;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --no-multicast" <<
+		"                 Do not use multicast " <<
+		"(note you must edit XML" << endl <<
+		"                                   " <<
+		"config to include IP addresses)"
+		<< endl;
+	cout <<
+		"    --board <name>" <<
+		"                 Name of the shared memory board" << endl <<
+		"                                   " <<
+		"(default: " << VITALS_BOARD_DEFAULT_NAME << ")"
+		<< endl;
+	cout <<
+		"    --slots <n>" <<
+		"                    Streams the board holds (default: 4096)"
+		<< endl;
+}
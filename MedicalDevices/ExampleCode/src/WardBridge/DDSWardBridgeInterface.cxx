@@ -0,0 +1,606 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <string.h>
+#include "DDSWardBridgeInterface.h"
+#include "../CommonInfrastructure/DDSLoanedBatch.h"
+#include "../CommonInfrastructure/DDSPatientRouting.h"
+#include "../CommonInfrastructure/OSAPI.h"
+#include "../Generated/profiles.h"
+
+using namespace com::rti::medical::generated;
+
+// Number of streaming samples taken at a time.  Alarms are forwarded between
+// batches.
+static const DDS_Long STREAMING_BATCH_SAMPLES = 64;
+
+// Bound of the ice::SampleArray identifiers in ice.idl.  The bound of the
+// values is in DDSWaveformAdapter.h.
+static const size_t IDENTIFIER_BOUND = 64;
+
+static int64_t ToNanoseconds(const DDS_Time_t &time)
+{
+	return (int64_t)time.sec * 1000000000LL + time.nanosec;
+}
+
+static DDS_Time_t ToTime(int64_t nanoseconds)
+{
+	DDS_Time_t time;
+	time.sec = (DDS_Long)(nanoseconds / 1000000000LL);
+	time.nanosec = (DDS_UnsignedLong)(nanoseconds % 1000000000LL);
+	return time;
+}
+
+static void CopyIdentifier(char *destination, const std::string &source)
+{
+	strncpy(destination, source.c_str(), IDENTIFIER_BOUND);
+	destination[IDENTIFIER_BOUND] = '\0';
+}
+
+static int64_t ToSequenceNumber(const DDS_SequenceNumber_t &number)
+{
+	return (int64_t)number.high * 4294967296LL + number.low;
+}
+
+// Counts a sample in the loss of the DataWriter that sent it.  Disposals
+// have sequence numbers too, so they are counted, but the other invalid
+// samples may be made by the DataReader itself, and are not.
+static void RecordWriterSample(StreamLossTracker &tracker,
+	const DDS_SampleInfo &info, int64_t now)
+{
+	if (info.valid_data ||
+		info.instance_state == DDS_NOT_ALIVE_DISPOSED_INSTANCE_STATE)
+	{
+		tracker.OnWriterSample(&info.publication_handle,
+			sizeof(info.publication_handle.keyHash),
+			ToSequenceNumber(info.publication_sequence_number), now);
+	}
+}
+
+// Creates a DataReader of type T, or throws a std::string
+template <typename T>
+static typename T::DataReader *CreateReader(DDS::Subscriber *sub,
+	DDS::Topic *topic, const char *qosProfile, const char *typeName)
+{
+	typename T::DataReader *reader = T::DataReader::narrow(
+		sub->create_datareader_with_profile(topic, ICE_QOS_LIBRARY,
+			qosProfile, NULL, DDS_STATUS_MASK_NONE));
+	if (reader == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create " << typeName <<
+			" reader. Inconsistent Qos?";
+		throw errss.str();
+	}
+	return reader;
+}
+
+// Creates a DataWriter of type T, or throws a std::string
+template <typename T>
+static typename T::DataWriter *CreateWriter(DDS::Publisher *pub,
+	DDS::Topic *topic, const char *qosProfile, const char *typeName)
+{
+	typename T::DataWriter *writer = T::DataWriter::narrow(
+		pub->create_datawriter_with_profile(topic, ICE_QOS_LIBRARY,
+			qosProfile, NULL, DDS_STATUS_MASK_NONE));
+	if (writer == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failure to create " << typeName <<
+			" writer. Inconsistent Qos?";
+		throw errss.str();
+	}
+	return writer;
+}
+
+// Writes every sample available on the reader with the writer, keeping its
+// source timestamp, and disposes the instances disposed on the ward domain.
+// Returns the number of samples forwarded.
+template <typename T>
+static unsigned long ForwardSamples(typename T::DataReader *reader,
+	DDS::ReadCondition *condition, typename T::DataWriter *writer)
+{
+	LoanedBatch<T> batch;
+	unsigned long forwarded = 0;
+	while (batch.TakeNext(reader, condition))
+	{
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			if (batch.IsValid(i))
+			{
+				if (writer->write_w_timestamp(batch.GetData(i),
+					DDS_HANDLE_NIL, info.source_timestamp) == DDS_RETCODE_OK)
+				{
+					forwarded++;
+				}
+			} else if (info.instance_state ==
+				DDS_NOT_ALIVE_DISPOSED_INSTANCE_STATE)
+			{
+				DdsAutoType<T> key;
+				if (reader->get_key_value(key, info.instance_handle) ==
+					DDS_RETCODE_OK)
+				{
+					writer->dispose(key, DDS_HANDLE_NIL);
+				}
+			}
+		}
+	}
+	return forwarded;
+}
+
+// ----------------------------------------------------------------------------
+// The DDSWardBridgeInterface is the network interface to the ward bridge
+// application.  It reads the device data and alarms of a ward on one domain,
+// and writes the reduced data and the alarms on another domain.
+//
+// Both DomainParticipants load the same QoS profiles, from the
+// qos_profiles.xml file.
+// ------------------------------------------------------------------------- //
+
+DDSWardBridgeInterface::DDSWardBridgeInterface(bool multicastAvailable,
+	long wardDomain, long centralDomain, const StreamLossConfig &lossConfig)
+{
+	memset(&_statistics, 0, sizeof(_statistics));
+	_numericLoss = new StreamLossTracker(lossConfig);
+	_waveformLoss = new StreamLossTracker(lossConfig);
+
+	_wardCommunicator = new DDSCommunicator();
+	_centralCommunicator = new DDSCommunicator();
+
+	std::vector<std::string> xmlFiles;
+
+	// Adding the XML files that contain profiles used by this application
+	xmlFiles.push_back(
+		"file://../../../src/Config/qos_profiles.xml");
+
+	// Configuring this application for multicast or no multicast.  Note that
+	// if you have no multicast, you will have to edit the XML QoS
+	// configuration to add the IP addresses of applications you want to
+	// discover and communicate with.  The priority lanes are defined on top
+	// of the multicast participant profile, so they are only used with
+	// multicast.
+	std::string participantProfile;
+	bool lanes = multicastAvailable;
+	if (multicastAvailable)
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT;
+	} else
+	{
+		participantProfile = QOS_PROFILE_PARTICIPANT_NO_MULTICAST;
+	}
+
+	// Create a DomainParticipant on each domain
+	if (NULL == _wardCommunicator->CreateParticipant(wardDomain, xmlFiles,
+				ICE_QOS_LIBRARY, participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create ward DomainParticipant object";
+		throw errss.str();
+	}
+	if (NULL == _centralCommunicator->CreateParticipant(centralDomain,
+				xmlFiles, ICE_QOS_LIBRARY,
+				lanes ? std::string(QOS_PROFILE_PRIORITY_LANES) :
+					participantProfile))
+	{
+		std::stringstream errss;
+		errss << "Failed to create central DomainParticipant object";
+		throw errss.str();
+	}
+
+	// The ward side only reads, and the central side only writes.  Alarms
+	// and streaming data have their own Publisher when the lanes are used.
+	DDS::Subscriber *sub = _wardCommunicator->CreateSubscriber();
+	DDS::Publisher *alarmPub = NULL;
+	DDS::Publisher *streamingPub = NULL;
+	if (lanes)
+	{
+		alarmPub = _centralCommunicator->CreatePublisher(ICE_QOS_LIBRARY,
+			QOS_PROFILE_ALARM_LANE);
+		streamingPub = _centralCommunicator->CreatePublisher(
+			ICE_QOS_LIBRARY, QOS_PROFILE_STREAMING_LANE);
+	} else
+	{
+		alarmPub = _centralCommunicator->CreatePublisher();
+		streamingPub = alarmPub;
+	}
+	if (sub == NULL || alarmPub == NULL || streamingPub == NULL)
+	{
+		std::stringstream errss;
+		errss << "Failed to create Subscriber or Publisher object";
+		throw errss.str();
+	}
+
+	// This application processes the whole unit, so it receives the device
+	// data of every patient group, and the default partition
+	// (see DDSPatientRouting.h)
+	SubscribeToAllPatientGroups(sub);
+
+	// Readers on the ward domain
+	DDS::Topic *topic = _wardCommunicator->CreateTopic<ice::Numeric>(
+		ice::NumericTopic);
+	_numericReader = CreateReader<ice::Numeric>(sub, topic,
+		QOS_PROFILE_STREAMING, "Numeric");
+	topic = _wardCommunicator->CreateTopic<ice::SampleArray>(
+		ice::SampleArrayTopic);
+	_sampleArrayReader = CreateReader<ice::SampleArray>(sub, topic,
+		QOS_PROFILE_STREAMING, "SampleArray");
+	topic = _wardCommunicator->CreateTopic<Alarm>(AlarmTopic);
+	_alarmReader = CreateReader<Alarm>(sub, topic, QOS_PROFILE_ALARM,
+		"Alarm");
+	topic = _wardCommunicator->CreateTopic<CompactAlarm>(CompactAlarmTopic);
+	_compactAlarmReader = CreateReader<CompactAlarm>(sub, topic,
+		QOS_PROFILE_COMPACT_ALARM, "CompactAlarm");
+	topic = _wardCommunicator->CreateTopic<AlarmCode>(AlarmCodeTopic);
+	_alarmCodeReader = CreateReader<AlarmCode>(sub, topic,
+		QOS_PROFILE_ALARM_CODES, "AlarmCode");
+	topic = _wardCommunicator->CreateTopic<TechnicalAlarm>(
+		TechnicalAlarmTopic);
+	_technicalAlarmReader = CreateReader<TechnicalAlarm>(sub, topic,
+		QOS_PROFILE_ALARM, "TechnicalAlarm");
+
+	// Writers on the central domain
+	topic = _centralCommunicator->CreateTopic<NumericSummary>(
+		NumericSummaryTopic);
+	_summaryWriter = CreateWriter<NumericSummary>(streamingPub, topic,
+		lanes ? QOS_PROFILE_STREAMING_LANE : QOS_PROFILE_STREAMING,
+		"NumericSummary");
+	topic = _centralCommunicator->CreateTopic<CompressedSampleArray>(
+		CompressedSampleArrayTopic);
+	_compressedWriter = new DDSCompressedSampleArrayWriter(streamingPub,
+		topic, ICE_QOS_LIBRARY,
+		lanes ? QOS_PROFILE_STREAMING_LANE : QOS_PROFILE_STREAMING);
+	topic = _centralCommunicator->CreateTopic<Alarm>(AlarmTopic);
+	_alarmWriter = CreateWriter<Alarm>(alarmPub, topic,
+		lanes ? QOS_PROFILE_ALARM_LANE : QOS_PROFILE_ALARM, "Alarm");
+	topic = _centralCommunicator->CreateTopic<CompactAlarm>(
+		CompactAlarmTopic);
+	_compactAlarmWriter = CreateWriter<CompactAlarm>(alarmPub, topic,
+		lanes ? QOS_PROFILE_ALARM_LANE : QOS_PROFILE_COMPACT_ALARM,
+		"CompactAlarm");
+	topic = _centralCommunicator->CreateTopic<AlarmCode>(AlarmCodeTopic);
+	_alarmCodeWriter = CreateWriter<AlarmCode>(alarmPub, topic,
+		QOS_PROFILE_ALARM_CODES, "AlarmCode");
+	topic = _centralCommunicator->CreateTopic<TechnicalAlarm>(
+		TechnicalAlarmTopic);
+	_technicalAlarmWriter = CreateWriter<TechnicalAlarm>(alarmPub, topic,
+		lanes ? QOS_PROFILE_ALARM_LANE : QOS_PROFILE_ALARM,
+		"TechnicalAlarm");
+	topic = _centralCommunicator->CreateTopic<StreamLossSummary>(
+		StreamLossSummaryTopic);
+	_lossWriter = CreateWriter<StreamLossSummary>(streamingPub, topic,
+		lanes ? QOS_PROFILE_STREAMING_LANE : QOS_PROFILE_STREAMING,
+		"StreamLossSummary");
+
+	// Create ReadConditions that trigger when there is any data in the
+	// DataReaders' queues, and attach them to a single WaitSet so one
+	// thread can forward all the data
+	_numericCondition = _numericReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_sampleArrayCondition = _sampleArrayReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_alarmCondition = _alarmReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_compactAlarmCondition = _compactAlarmReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_alarmCodeCondition = _alarmCodeReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+	_technicalAlarmCondition = _technicalAlarmReader->create_readcondition(
+		DDS_ANY_SAMPLE_STATE, DDS_ANY_VIEW_STATE, DDS_ANY_INSTANCE_STATE);
+
+	_waitSet = new DDS::WaitSet();
+	_waitSet->attach_condition(_numericCondition);
+	_waitSet->attach_condition(_sampleArrayCondition);
+	_waitSet->attach_condition(_alarmCondition);
+	_waitSet->attach_condition(_compactAlarmCondition);
+	_waitSet->attach_condition(_alarmCodeCondition);
+	_waitSet->attach_condition(_technicalAlarmCondition);
+}
+
+// ----------------------------------------------------------------------------
+// Destructor.
+// Deletes the WaitSet, the DataReaders, the DataWriters, and the
+// Communicator objects
+DDSWardBridgeInterface::~DDSWardBridgeInterface()
+{
+	_waitSet->detach_condition(_numericCondition);
+	_waitSet->detach_condition(_sampleArrayCondition);
+	_waitSet->detach_condition(_alarmCondition);
+	_waitSet->detach_condition(_compactAlarmCondition);
+	_waitSet->detach_condition(_alarmCodeCondition);
+	_waitSet->detach_condition(_technicalAlarmCondition);
+	delete _waitSet;
+
+	_numericReader->delete_readcondition(_numericCondition);
+	_sampleArrayReader->delete_readcondition(_sampleArrayCondition);
+	_alarmReader->delete_readcondition(_alarmCondition);
+	_compactAlarmReader->delete_readcondition(_compactAlarmCondition);
+	_alarmCodeReader->delete_readcondition(_alarmCodeCondition);
+	_technicalAlarmReader->delete_readcondition(_technicalAlarmCondition);
+
+	DDS::Subscriber *sub = _numericReader->get_subscriber();
+	sub->delete_datareader(_numericReader);
+	sub->delete_datareader(_sampleArrayReader);
+	sub->delete_datareader(_alarmReader);
+	sub->delete_datareader(_compactAlarmReader);
+	sub->delete_datareader(_alarmCodeReader);
+	sub->delete_datareader(_technicalAlarmReader);
+
+	_summaryWriter->get_publisher()->delete_datawriter(_summaryWriter);
+	delete _compressedWriter;
+	_alarmWriter->get_publisher()->delete_datawriter(_alarmWriter);
+	_compactAlarmWriter->get_publisher()->delete_datawriter(
+		_compactAlarmWriter);
+	_alarmCodeWriter->get_publisher()->delete_datawriter(_alarmCodeWriter);
+	_technicalAlarmWriter->get_publisher()->delete_datawriter(
+		_technicalAlarmWriter);
+	_lossWriter->get_publisher()->delete_datawriter(_lossWriter);
+
+	delete _wardCommunicator;
+	delete _centralCommunicator;
+	delete _numericLoss;
+	delete _waveformLoss;
+}
+
+// ----------------------------------------------------------------------------
+// Waits for data on the ward domain.  Alarms are forwarded first, whichever
+// conditions triggered.
+unsigned long DDSWardBridgeInterface::ForwardAvailableData(
+	WardAggregator &aggregator, const DDS_Duration_t &timeout)
+{
+	DDS::ConditionSeq activeConditions;
+
+	DDS_ReturnCode_t retcode = _waitSet->wait(activeConditions, timeout);
+	if (retcode == DDS_RETCODE_TIMEOUT)
+	{
+		return 0;
+	}
+	if (retcode != DDS_RETCODE_OK)
+	{
+		std::stringstream errss;
+		errss << "Failure waiting for ward data";
+		throw errss.str();
+	}
+
+	unsigned long received = ForwardAlarms();
+	for (int i = 0; i < activeConditions.length(); i++)
+	{
+		if (activeConditions[i] == _numericCondition)
+		{
+			received += AggregateNumerics(aggregator);
+		}
+		else if (activeConditions[i] == _sampleArrayCondition)
+		{
+			received += AggregateSampleArrays(aggregator);
+		}
+	}
+	return received;
+}
+
+void DDSWardBridgeInterface::Flush(WardAggregator &aggregator, int64_t now)
+{
+	aggregator.Flush(now, _summaries, _frames);
+	SendSummaries();
+	SendFrames();
+}
+
+// ----------------------------------------------------------------------------
+// Forwards the codes before the alarms, so a central application can look
+// up the codes of a CompactAlarm as soon as it receives it
+unsigned long DDSWardBridgeInterface::ForwardAlarms()
+{
+	unsigned long forwarded = 0;
+	forwarded += ForwardSamples<AlarmCode>(_alarmCodeReader,
+		_alarmCodeCondition, _alarmCodeWriter);
+	forwarded += ForwardSamples<CompactAlarm>(_compactAlarmReader,
+		_compactAlarmCondition, _compactAlarmWriter);
+	forwarded += ForwardSamples<Alarm>(_alarmReader, _alarmCondition,
+		_alarmWriter);
+	forwarded += ForwardSamples<TechnicalAlarm>(_technicalAlarmReader,
+		_technicalAlarmCondition, _technicalAlarmWriter);
+
+	_statistics.alarmsIn += forwarded;
+	_statistics.alarmsOut += forwarded;
+	return forwarded;
+}
+
+// ----------------------------------------------------------------------------
+// Streaming data is taken in batches, and the output of each batch is sent
+// before the alarms that arrived meanwhile are forwarded
+unsigned long DDSWardBridgeInterface::AggregateNumerics(
+	WardAggregator &aggregator)
+{
+	LoanedBatch<ice::Numeric> batch;
+	unsigned long received = 0;
+	while (batch.TakeNext(_numericReader, _numericCondition,
+		STREAMING_BATCH_SAMPLES))
+	{
+		int64_t now = OSGetMonotonicTime();
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			RecordWriterSample(*_numericLoss, batch.GetInfo(i), now);
+			if (!batch.IsValid(i))
+			{
+				continue;
+			}
+			const ice::Numeric &numeric = batch.GetData(i);
+			aggregator.AddNumeric(numeric.unique_device_identifier,
+				numeric.metric_id, numeric.instance_id,
+				ToNanoseconds(batch.GetInfo(i).source_timestamp),
+				numeric.value, _summaries);
+			received++;
+		}
+		batch.Return();
+
+		SendSummaries();
+		ForwardAlarms();
+	}
+	_statistics.numericsIn += received;
+	return received;
+}
+
+unsigned long DDSWardBridgeInterface::AggregateSampleArrays(
+	WardAggregator &aggregator)
+{
+	LoanedBatch<ice::SampleArray> batch;
+	unsigned long received = 0;
+	while (batch.TakeNext(_sampleArrayReader, _sampleArrayCondition,
+		STREAMING_BATCH_SAMPLES))
+	{
+		int64_t now = OSGetMonotonicTime();
+		for (int i = 0; i < batch.GetLength(); i++)
+		{
+			const DDS_SampleInfo &info = batch.GetInfo(i);
+			RecordWriterSample(*_waveformLoss, info, now);
+			if (!batch.IsValid(i))
+			{
+				continue;
+			}
+			const ice::SampleArray &frame = batch.GetData(i);
+			int64_t sourceTime = ToNanoseconds(info.source_timestamp);
+			_waveformLoss->OnFrame(frame.unique_device_identifier,
+				frame.metric_id, frame.instance_id, sourceTime,
+				(unsigned int)frame.values.length(),
+				(int64_t)frame.millisecondsPerSample * 1000000LL, now);
+			aggregator.AddSampleArray(frame.unique_device_identifier,
+				frame.metric_id, frame.instance_id, sourceTime,
+				frame.millisecondsPerSample,
+				frame.values.get_contiguous_buffer(),
+				(unsigned int)frame.values.length(), _frames);
+			_statistics.framesIn++;
+			_statistics.waveformValuesIn += frame.values.length();
+			received++;
+		}
+		batch.Return();
+
+		SendFrames();
+		ForwardAlarms();
+	}
+	return received;
+}
+
+// ----------------------------------------------------------------------------
+// Sending the output of the aggregator
+void DDSWardBridgeInterface::SendSummaries()
+{
+	for (size_t i = 0; i < _summaries.size(); i++)
+	{
+		const WardNumericSummary &summary = _summaries[i];
+		CopyIdentifier(_summarySample.unique_device_identifier,
+			summary.deviceId);
+		CopyIdentifier(_summarySample.metric_id, summary.metricId);
+		_summarySample.instance_id = summary.instanceId;
+		_summarySample.start_time = summary.startTime;
+		_summarySample.period = summary.period;
+		_summarySample.min_value = summary.minValue;
+		_summarySample.max_value = summary.maxValue;
+		_summarySample.last_value = summary.lastValue;
+		_summarySample.sample_count = summary.sampleCount;
+
+		if (_summaryWriter->write_w_timestamp(_summarySample, DDS_HANDLE_NIL,
+			ToTime(summary.startTime)) == DDS_RETCODE_OK)
+		{
+			_statistics.summariesOut++;
+		}
+	}
+	_summaries.clear();
+}
+
+void DDSWardBridgeInterface::SendFrames()
+{
+	for (size_t i = 0; i < _frames.size(); i++)
+	{
+		const WardWaveformFrame &frame = _frames[i];
+		unsigned int count = (unsigned int)frame.values.size();
+		if (count > MAX_SAMPLE_ARRAY_VALUES ||
+			!_frameSample.values.ensure_length(count,
+				MAX_SAMPLE_ARRAY_VALUES))
+		{
+			continue;
+		}
+		CopyIdentifier(_frameSample.unique_device_identifier,
+			frame.deviceId);
+		CopyIdentifier(_frameSample.metric_id, frame.metricId);
+		_frameSample.instance_id = frame.instanceId;
+		_frameSample.millisecondsPerSample = frame.millisecondsPerSample;
+		if (count > 0)
+		{
+			memcpy(_frameSample.values.get_contiguous_buffer(),
+				&frame.values[0], count * sizeof(float));
+		}
+
+		if (_compressedWriter->Write(_frameSample, ToTime(frame.timestamp)))
+		{
+			_statistics.framesOut++;
+			_statistics.waveformValuesOut += count;
+		}
+	}
+	_frames.clear();
+	_statistics.waveformBytesRaw = _compressedWriter->GetRawBytes();
+	_statistics.waveformBytesOut = _compressedWriter->GetCompressedBytes();
+}
+
+// ----------------------------------------------------------------------------
+// Sending the loss of the waveform streams
+unsigned int DDSWardBridgeInterface::PublishLossSummaries()
+{
+	// The writers are only checked, to end their windows and forget the
+	// writers that went away
+	_lossStreams.clear();
+	int64_t now = OSGetMonotonicTime();
+	_numericLoss->Check(now, _lossStreams);
+	_waveformLoss->Check(now, _lossStreams);
+	for (size_t i = 0; i < _lossStreams.size(); i++)
+	{
+		WriteLossSummary(_lossStreams[i], true);
+	}
+
+	_lossStreams.clear();
+	_waveformLoss->GetStreams(_lossStreams);
+	unsigned int sent = 0;
+	for (size_t i = 0; i < _lossStreams.size(); i++)
+	{
+		if (WriteLossSummary(_lossStreams[i], false))
+		{
+			sent++;
+		}
+	}
+	return sent;
+}
+
+bool DDSWardBridgeInterface::WriteLossSummary(
+	const StreamLossStatus &stream, bool dispose)
+{
+	CopyIdentifier(_lossSample.unique_device_identifier, stream.deviceId);
+	CopyIdentifier(_lossSample.metric_id, stream.metricId);
+	_lossSample.instance_id = stream.instanceId;
+	if (dispose)
+	{
+		return _lossWriter->dispose(_lossSample, DDS_HANDLE_NIL) ==
+			DDS_RETCODE_OK;
+	}
+
+	const LossCounters &frames = stream.frames;
+	_lossSample.frames_received = frames.received;
+	_lossSample.frames_lost = frames.lost;
+	_lossSample.samples_lost = stream.samplesLost;
+	_lossSample.duplicate_frames = frames.duplicates;
+	_lossSample.reordered_frames = frames.reordered;
+	_lossSample.loss_bursts = (DDS_UnsignedLong)frames.bursts;
+	_lossSample.longest_burst = (DDS_UnsignedLong)frames.longestBurst;
+	_lossSample.window_duration =
+		_waveformLoss->GetConfig().windowDuration;
+	_lossSample.window_loss = (float)frames.windowLoss;
+	_lossSample.worst_window_loss = (float)frames.worstWindowLoss;
+	_lossSample.windows = (DDS_UnsignedLong)frames.windows;
+	_lossSample.windows_over_threshold =
+		(DDS_UnsignedLong)frames.windowsOverThreshold;
+	return _lossWriter->write(_lossSample, DDS_HANDLE_NIL) == DDS_RETCODE_OK;
+}
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef DDS_WARD_BRIDGE_INTERFACE_H
+#define DDS_WARD_BRIDGE_INTERFACE_H
+
+#include <sstream>
+#include <vector>
+#include "../CommonInfrastructure/DDSCommunicator.h"
+#include "../CommonInfrastructure/DDSTypeWrapper.h"
+#include "../CommonInfrastructure/DDSWaveformAdapter.h"
+#include "../CommonInfrastructure/StreamLossTracker.h"
+#include "../Generated/ice.h"
+#include "../Generated/iceSupport.h"
+#include "../Generated/alarm.h"
+#include "../Generated/alarmSupport.h"
+#include "../Generated/ward.h"
+#include "../Generated/wardSupport.h"
+#include "WardAggregator.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// The ward bridge interface connects two domains: the ward domain, where the
+// devices of one ward send their data at full rate, and the central domain,
+// where a central station watches many wards.
+//
+// Reading from the ward domain:
+// -----------------------------
+// ice::Numeric and ice::SampleArray data is read with the StreamingData QoS
+// profile, and reduced by a WardAggregator.  Alarm, CompactAlarm,
+// AlarmCode and TechnicalAlarm data is read with the same profiles used by
+// the applications that send it.
+//
+// Writing to the central domain:
+// ------------------------------
+// Numerics are sent as NumericSummary samples (see ward.idl), and decimated
+// waveforms on the CompressedSampleArray topic (see waveform.idl), so the
+// waveforms of a whole ward take less of the central network.  Central
+// applications decompress them back to ice::SampleArray frames with the
+// waveform adapters (see DDSWaveformAdapter.h).  Alarms, and the codes
+// CompactAlarms refer to, are forwarded unchanged as soon as they arrive,
+// with their original source timestamps.
+//
+// Streaming data is taken in small batches, and alarms are forwarded
+// between batches, so an alarm never waits for a burst of waveforms to be
+// processed.  When multicast is available, the central DomainParticipant
+// uses the priority lanes (see the PriorityLanes profile), so forwarded
+// alarms are also not queued behind waveforms on the network.
+//
+// Counting loss:
+// --------------
+// The streaming data is best effort, so samples lost on the ward network
+// would otherwise go unnoticed.  The bridge counts the samples lost from
+// each DataWriter, from their publication sequence numbers, and the frames
+// lost from each waveform stream, from their source timestamps (see
+// StreamLossTracker.h).  Once per loss window, it sends the loss of every
+// waveform stream as a StreamLossSummary (see ward.idl) on the central
+// domain, so the central station sees the waveform loss of each bed.
+//
+// ----------------------------------------------------------------------------
+
+// Samples received and sent by the bridge since it started
+struct WardBridgeStatistics
+{
+	uint64_t numericsIn;
+	uint64_t framesIn;
+	uint64_t waveformValuesIn;
+	uint64_t alarmsIn;
+
+	uint64_t summariesOut;
+	uint64_t framesOut;
+	uint64_t waveformValuesOut;
+	uint64_t alarmsOut;
+
+	// Bytes of waveform values sent, before and after compression
+	uint64_t waveformBytesRaw;
+	uint64_t waveformBytesOut;
+};
+
+class DDSWardBridgeInterface
+{
+
+public:
+
+	// --- Constructor ---
+	// Creates a DomainParticipant on each domain, the DataReaders on the
+	// ward domain and the DataWriters on the central domain.  Throws a
+	// std::string if any of them cannot be created.
+	// The loss of the streaming data is counted with the given settings.
+	DDSWardBridgeInterface(bool multicastAvailable, long wardDomain,
+		long centralDomain,
+		const StreamLossConfig &lossConfig = StreamLossConfig());
+
+	// --- Destructor ---
+	~DDSWardBridgeInterface();
+
+	// --- Getters for Communicators ---
+	DDSCommunicator *GetWardCommunicator()
+	{
+		return _wardCommunicator;
+	}
+
+	DDSCommunicator *GetCentralCommunicator()
+	{
+		return _centralCommunicator;
+	}
+
+	// --- Forwarding data ---
+	// Waits up to the timeout for data on the ward domain, forwards the
+	// alarms that are available, and passes the streaming data through the
+	// aggregator, sending what it produces.  Returns the number of samples
+	// read.
+	unsigned long ForwardAvailableData(WardAggregator &aggregator,
+		const DDS_Duration_t &timeout);
+
+	// Sends the summaries and frames that the aggregator finishes at time
+	// now, in nanoseconds
+	void Flush(WardAggregator &aggregator, int64_t now);
+
+	// --- Statistics ---
+	const WardBridgeStatistics &GetStatistics() const
+	{
+		return _statistics;
+	}
+
+	// --- Loss ---
+	// Ends the loss windows that are over, sends the loss of every waveform
+	// stream, and disposes the loss of the streams that stopped.  Returns
+	// the number of StreamLossSummary samples sent.
+	unsigned int PublishLossSummaries();
+
+	// Loss of the Numeric and SampleArray data
+	void GetNumericLossMetrics(StreamLossMetrics &metrics) const
+	{
+		_numericLoss->GetMetrics(metrics);
+	}
+
+	void GetWaveformLossMetrics(StreamLossMetrics &metrics) const
+	{
+		_waveformLoss->GetMetrics(metrics);
+	}
+
+	// Returns false if the waveform stream is not tracked
+	bool GetWaveformLoss(const char *deviceId, const char *metricId,
+		int instanceId, StreamLossStatus &status) const
+	{
+		return _waveformLoss->GetStream(deviceId, metricId, instanceId,
+			status);
+	}
+
+private:
+	// --- Private methods ---
+	unsigned long ForwardAlarms();
+	unsigned long AggregateNumerics(WardAggregator &aggregator);
+	unsigned long AggregateSampleArrays(WardAggregator &aggregator);
+	void SendSummaries();
+	void SendFrames();
+	bool WriteLossSummary(const StreamLossStatus &stream, bool dispose);
+
+	// --- Private members ---
+
+	// One communicator per domain
+	DDSCommunicator *_wardCommunicator;
+	DDSCommunicator *_centralCommunicator;
+
+	// Readers on the ward domain
+	ice::NumericDataReader *_numericReader;
+	ice::SampleArrayDataReader *_sampleArrayReader;
+	com::rti::medical::generated::AlarmDataReader *_alarmReader;
+	com::rti::medical::generated::CompactAlarmDataReader
+		*_compactAlarmReader;
+	com::rti::medical::generated::AlarmCodeDataReader *_alarmCodeReader;
+	com::rti::medical::generated::TechnicalAlarmDataReader
+		*_technicalAlarmReader;
+
+	DDS::ReadCondition *_numericCondition;
+	DDS::ReadCondition *_sampleArrayCondition;
+	DDS::ReadCondition *_alarmCondition;
+	DDS::ReadCondition *_compactAlarmCondition;
+	DDS::ReadCondition *_alarmCodeCondition;
+	DDS::ReadCondition *_technicalAlarmCondition;
+	DDS::WaitSet *_waitSet;
+
+	// Writers on the central domain
+	com::rti::medical::generated::NumericSummaryDataWriter *_summaryWriter;
+	DDSCompressedSampleArrayWriter *_compressedWriter;
+	com::rti::medical::generated::AlarmDataWriter *_alarmWriter;
+	com::rti::medical::generated::CompactAlarmDataWriter
+		*_compactAlarmWriter;
+	com::rti::medical::generated::AlarmCodeDataWriter *_alarmCodeWriter;
+	com::rti::medical::generated::TechnicalAlarmDataWriter
+		*_technicalAlarmWriter;
+
+	// Output of the aggregator, and the samples it is sent in, reused
+	// between calls
+	std::vector<WardNumericSummary> _summaries;
+	std::vector<WardWaveformFrame> _frames;
+	DdsAutoType<com::rti::medical::generated::NumericSummary> _summarySample;
+	DdsAutoType<ice::SampleArray> _frameSample;
+
+	WardBridgeStatistics _statistics;
+
+	// Loss of the streaming data, and the writer of the loss summaries
+	StreamLossTracker *_numericLoss;
+	StreamLossTracker *_waveformLoss;
+	com::rti::medical::generated::StreamLossSummaryDataWriter *_lossWriter;
+	DdsAutoType<com::rti::medical::generated::StreamLossSummary>
+		_lossSample;
+	std::vector<StreamLossStatus> _lossStreams;
+};
+
+#endif
@@ -0,0 +1,252 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <sstream>
+#include "WardAggregator.h"
+
+static std::string StreamKey(const char *deviceId, const char *metricId,
+	int instanceId)
+{
+	std::stringstream keyss;
+	keyss << deviceId << '|' << metricId << '|' << instanceId;
+	return keyss.str();
+}
+
+// Start of the period that contains the timestamp
+static int64_t PeriodStart(int64_t timestamp, int64_t period)
+{
+	int64_t start = timestamp - timestamp % period;
+	return start > timestamp ? start - period : start;
+}
+
+// ----------------------------------------------------------------------------
+WardAggregator::WardAggregator(int64_t numericPeriod,
+	unsigned int waveformFactor, int64_t waveformFrameDuration,
+	int64_t staleTimeout, unsigned int maxFrameValues) :
+	_numericPeriod(numericPeriod),
+	_waveformFactor(waveformFactor),
+	_waveformFrameDuration(waveformFrameDuration),
+	_staleTimeout(staleTimeout),
+	_maxFrameValues(maxFrameValues)
+{
+	if (_numericPeriod <= 0 || _waveformFactor == 0 ||
+		(_waveformFactor > 1 && _waveformFactor % 2 != 0) ||
+		_maxFrameValues < 2)
+	{
+		std::stringstream errss;
+		errss << "WardAggregator: invalid numeric period or waveform factor";
+		throw errss.str();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Numerics
+void WardAggregator::AddNumeric(const char *deviceId, const char *metricId,
+	int instanceId, int64_t timestamp, float value,
+	std::vector<WardNumericSummary> &summaries)
+{
+	std::string key = StreamKey(deviceId, metricId, instanceId);
+	std::map<std::string, NumericStream>::iterator it = _numerics.find(key);
+	if (it == _numerics.end())
+	{
+		NumericStream stream;
+		stream.summary.deviceId = deviceId;
+		stream.summary.metricId = metricId;
+		stream.summary.instanceId = instanceId;
+		stream.summary.period = _numericPeriod;
+		stream.summary.sampleCount = 0;
+		it = _numerics.insert(std::make_pair(key, stream)).first;
+	}
+
+	NumericStream &stream = it->second;
+	WardNumericSummary &summary = stream.summary;
+	int64_t start = PeriodStart(timestamp, _numericPeriod);
+
+	// A sample of a later period finishes the current one.  A late sample
+	// of an earlier period is counted in the current one.
+	if (summary.sampleCount > 0 && start > summary.startTime)
+	{
+		summaries.push_back(summary);
+		summary.sampleCount = 0;
+	}
+
+	if (summary.sampleCount == 0)
+	{
+		summary.startTime = start;
+		summary.minValue = value;
+		summary.maxValue = value;
+	} else
+	{
+		summary.minValue = value < summary.minValue ? value : summary.minValue;
+		summary.maxValue = value > summary.maxValue ? value : summary.maxValue;
+	}
+	summary.lastValue = value;
+	summary.sampleCount++;
+	stream.lastTimestamp = timestamp;
+}
+
+// ----------------------------------------------------------------------------
+// Waveforms
+void WardAggregator::AddSampleArray(const char *deviceId,
+	const char *metricId, int instanceId, int64_t timestamp,
+	int millisecondsPerSample, const float *values, unsigned int count,
+	std::vector<WardWaveformFrame> &frames)
+{
+	std::string key = StreamKey(deviceId, metricId, instanceId);
+	std::map<std::string, WaveformStream>::iterator it = _waveforms.find(key);
+	if (it == _waveforms.end())
+	{
+		WaveformStream stream;
+		stream.frame.deviceId = deviceId;
+		stream.frame.metricId = metricId;
+		stream.frame.instanceId = instanceId;
+		stream.inputMilliseconds = millisecondsPerSample;
+		stream.bucketCount = 0;
+		it = _waveforms.insert(std::make_pair(key, stream)).first;
+	}
+
+	WaveformStream &stream = it->second;
+	stream.lastTimestamp = timestamp;
+
+	if (_waveformFactor == 1)
+	{
+		WardWaveformFrame frame = stream.frame;
+		frame.timestamp = timestamp;
+		frame.millisecondsPerSample = millisecondsPerSample;
+		frame.values.assign(values, values + count);
+		frames.push_back(frame);
+		return;
+	}
+
+	// The decimated values of different sample rates cannot share a frame
+	if (millisecondsPerSample != stream.inputMilliseconds)
+	{
+		FinishFrame(stream, frames);
+		stream.bucketCount = 0;
+		stream.inputMilliseconds = millisecondsPerSample;
+	}
+
+	int64_t spacing = (int64_t)millisecondsPerSample * 1000000LL;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		AddWaveformValue(stream, timestamp + spacing * i, values[i], frames);
+	}
+}
+
+void WardAggregator::AddWaveformValue(WaveformStream &stream,
+	int64_t timestamp, float value, std::vector<WardWaveformFrame> &frames)
+{
+	if (stream.bucketCount == 0)
+	{
+		stream.bucketMin = value;
+		stream.bucketMax = value;
+		stream.minFirst = true;
+		stream.bucketTimestamp = timestamp;
+	} else if (value < stream.bucketMin)
+	{
+		stream.bucketMin = value;
+		stream.minFirst = false;
+	} else if (value > stream.bucketMax)
+	{
+		stream.bucketMax = value;
+		stream.minFirst = true;
+	}
+
+	if (++stream.bucketCount < _waveformFactor)
+	{
+		return;
+	}
+	stream.bucketCount = 0;
+
+	// Two values per bucket, so each value stands for half a bucket
+	WardWaveformFrame &frame = stream.frame;
+	if (frame.values.empty())
+	{
+		frame.timestamp = stream.bucketTimestamp;
+		frame.millisecondsPerSample =
+			stream.inputMilliseconds * (int)_waveformFactor / 2;
+	}
+	frame.values.push_back(stream.minFirst ? stream.bucketMin :
+		stream.bucketMax);
+	frame.values.push_back(stream.minFirst ? stream.bucketMax :
+		stream.bucketMin);
+
+	int64_t duration = (int64_t)frame.values.size() *
+		frame.millisecondsPerSample * 1000000LL;
+	if (duration >= _waveformFrameDuration ||
+		frame.values.size() + 2 > _maxFrameValues)
+	{
+		FinishFrame(stream, frames);
+	}
+}
+
+void WardAggregator::FinishFrame(WaveformStream &stream,
+	std::vector<WardWaveformFrame> &frames)
+{
+	if (!stream.frame.values.empty())
+	{
+		frames.push_back(stream.frame);
+		stream.frame.values.clear();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Flushing.  A period or frame is kept open for one more period or frame
+// duration, so samples that arrive a little late still fall into it.
+void WardAggregator::Flush(int64_t now,
+	std::vector<WardNumericSummary> &summaries,
+	std::vector<WardWaveformFrame> &frames)
+{
+	std::map<std::string, NumericStream>::iterator numeric =
+		_numerics.begin();
+	while (numeric != _numerics.end())
+	{
+		WardNumericSummary &summary = numeric->second.summary;
+		if (summary.sampleCount > 0 &&
+			summary.startTime + 2 * _numericPeriod <= now)
+		{
+			summaries.push_back(summary);
+			summary.sampleCount = 0;
+		}
+
+		if (numeric->second.lastTimestamp + _staleTimeout < now)
+		{
+			if (summary.sampleCount > 0)
+			{
+				summaries.push_back(summary);
+			}
+			_numerics.erase(numeric++);
+		} else
+		{
+			++numeric;
+		}
+	}
+
+	std::map<std::string, WaveformStream>::iterator waveform =
+		_waveforms.begin();
+	while (waveform != _waveforms.end())
+	{
+		WaveformStream &stream = waveform->second;
+		if (!stream.frame.values.empty() &&
+			stream.frame.timestamp + 2 * _waveformFrameDuration <= now)
+		{
+			FinishFrame(stream, frames);
+		}
+
+		if (stream.lastTimestamp + _staleTimeout < now)
+		{
+			FinishFrame(stream, frames);
+			_waveforms.erase(waveform++);
+		} else
+		{
+			++waveform;
+		}
+	}
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#ifndef WARD_AGGREGATOR_H
+#define WARD_AGGREGATOR_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------- //
+//
+// WardAggregator:
+// Reduces the full-rate device data of a ward to what a central station
+// needs, one stream (device, metric and instance) at a time:
+//
+//  - Numerics are summarized over fixed periods (1 s by default), aligned to
+//    multiples of the period.  Each summary holds the minimum, maximum and
+//    last value of the period.  A summary is finished when the first sample
+//    of the next period arrives, or by Flush() once the period is over.
+//
+//  - Waveforms are decimated by a factor, keeping their shape: each bucket of
+//    factor samples is replaced by its minimum and maximum, in the order
+//    they occurred.  Peaks such as the QRS complex of an ECG survive, where
+//    keeping one sample out of every factor would miss most of them.  The
+//    decimated values are sent in frames covering a fixed duration, so the
+//    number of frames drops along with the number of values.
+//
+// Times are in nanoseconds.  Streams that send nothing for the stale timeout
+// are forgotten, so the memory used follows the streams currently active.
+//
+// ------------------------------------------------------------------------- //
+
+// Summary of the numerics of one stream over one period
+struct WardNumericSummary
+{
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+	int64_t startTime;
+	int64_t period;
+	float minValue;
+	float maxValue;
+	float lastValue;
+	unsigned int sampleCount;
+};
+
+// Decimated waveform frame.  The timestamp is the time of its first value.
+struct WardWaveformFrame
+{
+	std::string deviceId;
+	std::string metricId;
+	int instanceId;
+	int64_t timestamp;
+	int millisecondsPerSample;
+	std::vector<float> values;
+};
+
+class WardAggregator
+{
+public:
+	// --- Constructor ---
+	// The waveform factor must be 1, which sends waveforms unchanged, or an
+	// even number, so the decimated values are evenly spaced.  Decimated
+	// frames hold at most maxFrameValues values.
+	WardAggregator(int64_t numericPeriod, unsigned int waveformFactor,
+		int64_t waveformFrameDuration, int64_t staleTimeout,
+		unsigned int maxFrameValues);
+
+	// --- Adding data ---
+	// Appends the summaries and frames this sample finishes
+	void AddNumeric(const char *deviceId, const char *metricId,
+		int instanceId, int64_t timestamp, float value,
+		std::vector<WardNumericSummary> &summaries);
+
+	// The timestamp is the time of the first value of the frame
+	void AddSampleArray(const char *deviceId, const char *metricId,
+		int instanceId, int64_t timestamp, int millisecondsPerSample,
+		const float *values, unsigned int count,
+		std::vector<WardWaveformFrame> &frames);
+
+	// --- Flushing ---
+	// Appends the summaries of periods that ended more than one period
+	// before now, and the frames that have waited longer than their
+	// duration, and forgets the streams idle for the stale timeout
+	void Flush(int64_t now, std::vector<WardNumericSummary> &summaries,
+		std::vector<WardWaveformFrame> &frames);
+
+	// --- Statistics ---
+	unsigned int GetNumericStreamCount() const
+	{
+		return (unsigned int)_numerics.size();
+	}
+
+	unsigned int GetWaveformStreamCount() const
+	{
+		return (unsigned int)_waveforms.size();
+	}
+
+private:
+	// --- Private types ---
+	struct NumericStream
+	{
+		WardNumericSummary summary;
+		int64_t lastTimestamp;
+	};
+
+	struct WaveformStream
+	{
+		WardWaveformFrame frame;
+		int inputMilliseconds;
+		int64_t lastTimestamp;
+
+		// Bucket being decimated
+		unsigned int bucketCount;
+		float bucketMin;
+		float bucketMax;
+		bool minFirst;
+		int64_t bucketTimestamp;
+	};
+
+	// --- Private methods ---
+	void AddWaveformValue(WaveformStream &stream, int64_t timestamp,
+		float value, std::vector<WardWaveformFrame> &frames);
+	void FinishFrame(WaveformStream &stream,
+		std::vector<WardWaveformFrame> &frames);
+
+	// --- Private members ---
+	int64_t _numericPeriod;
+	unsigned int _waveformFactor;
+	int64_t _waveformFrameDuration;
+	int64_t _staleTimeout;
+	unsigned int _maxFrameValues;
+
+	// Streams by key (device, metric and instance)
+	std::map<std::string, NumericStream> _numerics;
+	std::map<std::string, WaveformStream> _waveforms;
+};
+
+#endif
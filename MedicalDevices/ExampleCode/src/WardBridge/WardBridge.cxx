@@ -0,0 +1,308 @@
+/*******************************************************************************
+ (c) 2005-2014 Copyright, Real-Time Innovations, Inc.  All rights reserved.
+ RTI grants Licensee a license to use, modify, compile, and create derivative
+ works of the Software.  Licensee has the right to distribute object form only
+ for use with RTI products.  The Software is provided "as is", with no warranty
+ of any type, including any warranty for fitness for any purpose. RTI is under
+ no obligation to maintain or support the Software.  RTI shall not be liable for
+ any incidental or consequential damages arising out of the use or inability to
+ use the software.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "DDSWardBridgeInterface.h"
+#include "WardAggregator.h"
+
+using namespace std;
+
+void PrintHelp();
+
+// ------------------------------------------------------------------------- //
+// This application bridges the device data of one ward to a central station.
+// It reads every ice::Numeric and ice::SampleArray sample on the ward domain,
+// and sends on the central domain:
+//
+//  - One NumericSummary per numeric stream and period (1 s by default), with
+//    the minimum, maximum and last value of the period.
+//  - Waveforms decimated by --waveform-factor, keeping the minimum and
+//    maximum of each bucket of samples so that peaks are not lost, and
+//    sent compressed without loss on the CompressedSampleArray topic.
+//  - Every Alarm, CompactAlarm, AlarmCode and TechnicalAlarm sample,
+//    unchanged and as soon as it arrives.
+//  - One StreamLossSummary per waveform stream and loss window (10 s by
+//    default), with the frames the bridge did not receive.
+//
+// With one bridge per ward, the data that reaches the central domain grows
+// with the number of wards and streams, not with the sample rate of every
+// device.  The input and output rates, and the samples lost on the ward
+// domain, are printed every ten seconds.
+//
+// ------------------------------------------------------------------------- //
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000LL;
+
+// Largest number of values in an ice::SampleArray
+static const unsigned int MAX_FRAME_VALUES = 400;
+
+static double PerSecond(uint64_t count, long seconds)
+{
+	return seconds <= 0 ? 0.0 : (double)count / (double)seconds;
+}
+
+// Share of the samples received or lost that were lost, in percent
+static double LossPercent(const LossCounters &counters)
+{
+	uint64_t total = counters.received + counters.lost;
+	return total == 0 ? 0.0 : 100.0 * (double)counters.lost / (double)total;
+}
+
+int main(int argc, char *argv[])
+{
+	bool multicastAvailable = true;
+	long wardDomain = 5;
+	long centralDomain = 6;
+	long numericPeriodMs = 1000;
+	long waveformFactor = 10;
+	long frameMs = 250;
+	long staleSeconds = 30;
+	long lossWindowSeconds = 10;
+	double lossThreshold = 0.001;
+
+	// Process the command-line arguments
+	for (int i = 0; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--no-multicast"))
+		{
+			multicastAvailable = false;
+		} else if (0 == strcmp(argv[i], "--ward-domain") && i + 1 < argc)
+		{
+			wardDomain = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--central-domain") && i + 1 < argc)
+		{
+			centralDomain = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--numeric-period-ms") &&
+			i + 1 < argc)
+		{
+			numericPeriodMs = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--waveform-factor") && i + 1 < argc)
+		{
+			waveformFactor = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--frame-ms") && i + 1 < argc)
+		{
+			frameMs = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--stale-seconds") && i + 1 < argc)
+		{
+			staleSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--loss-window-seconds") &&
+			i + 1 < argc)
+		{
+			lossWindowSeconds = atol(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--loss-threshold") && i + 1 < argc)
+		{
+			lossThreshold = atof(argv[++i]);
+		} else if (0 == strcmp(argv[i], "--help"))
+		{
+			PrintHelp();
+			return 0;
+		} else if (i > 0)
+		{
+			// If we have a parameter that is not the first one, and is not
+			// recognized, return an error.
+			cout << "Bad parameter: " << argv[i] << endl;
+			PrintHelp();
+			return -1;
+		}
+	}
+
+	if (wardDomain == centralDomain)
+	{
+		cout << "The ward and central domains must be different" << endl;
+		return -1;
+	}
+	if (numericPeriodMs <= 0 || frameMs <= 0 || waveformFactor <= 0 ||
+		(waveformFactor > 1 && waveformFactor % 2 != 0))
+	{
+		cout << "The periods must be positive, and the waveform factor 1 or "
+			<< "an even number" << endl;
+		return -1;
+	}
+	if (lossWindowSeconds <= 0 || lossThreshold < 0.0)
+	{
+		cout << "The loss window must be positive, and the loss threshold "
+			<< "not negative" << endl;
+		return -1;
+	}
+
+	try
+	{
+		WardAggregator aggregator(
+			(int64_t)numericPeriodMs * NANOSECONDS_PER_MILLISECOND,
+			(unsigned int)waveformFactor,
+			(int64_t)frameMs * NANOSECONDS_PER_MILLISECOND,
+			(int64_t)staleSeconds * 1000000000LL, MAX_FRAME_VALUES);
+
+		// --------------------------------------------------------------------
+		// This is the network interface for this application - it reads
+		// the ward data and writes the central data.  Look into this class
+		// to see how one application bridges two domains.
+		StreamLossConfig lossConfig;
+		lossConfig.windowDuration = (int64_t)lossWindowSeconds * 1000000000LL;
+		lossConfig.lossThreshold = lossThreshold;
+		DDSWardBridgeInterface bridgeInterface(multicastAvailable,
+			wardDomain, centralDomain, lossConfig);
+
+		cout << "Bridging ward domain " << wardDomain << " to central domain "
+			<< centralDomain << endl;
+
+		DDS_Duration_t waitTime = {0, 100000000};
+		DDS_Time_t lastFlush = {0, 0};
+		DDS_Time_t lastReport = {0, 0};
+		DDS_Time_t lastLoss = {0, 0};
+		WardBridgeStatistics last = bridgeInterface.GetStatistics();
+
+		while (1)
+		{
+			bridgeInterface.ForwardAvailableData(aggregator, waitTime);
+
+			DDS_Time_t now;
+			bridgeInterface.GetWardCommunicator()->GetParticipant()->
+				get_current_time(now);
+
+			// Finish the periods and frames of streams that went quiet
+			if (now.sec != lastFlush.sec)
+			{
+				bridgeInterface.Flush(aggregator,
+					(int64_t)now.sec * 1000000000LL + now.nanosec);
+				lastFlush = now;
+			}
+
+			// Once per loss window, send the loss of the waveform streams
+			if (now.sec - lastLoss.sec >= lossWindowSeconds)
+			{
+				if (lastLoss.sec != 0)
+				{
+					bridgeInterface.PublishLossSummaries();
+				}
+				lastLoss = now;
+			}
+
+			// Once every ten seconds, report the input and output rates
+			if (now.sec - lastReport.sec >= 10)
+			{
+				const WardBridgeStatistics &current =
+					bridgeInterface.GetStatistics();
+				if (lastReport.sec != 0)
+				{
+					long seconds = now.sec - lastReport.sec;
+					uint64_t valuesIn =
+						current.numericsIn - last.numericsIn +
+						current.waveformValuesIn - last.waveformValuesIn;
+					uint64_t valuesOut =
+						current.summariesOut - last.summariesOut +
+						current.waveformValuesOut - last.waveformValuesOut;
+
+					cout << "In:  " << PerSecond(current.numericsIn -
+							last.numericsIn, seconds) << " Numerics/s, "
+						<< PerSecond(current.framesIn - last.framesIn,
+							seconds) << " SampleArrays/s ("
+						<< PerSecond(current.waveformValuesIn -
+							last.waveformValuesIn, seconds) << " values/s), "
+						<< PerSecond(current.alarmsIn - last.alarmsIn,
+							seconds) << " alarms/s" << endl;
+					cout << "Out: " << PerSecond(current.summariesOut -
+							last.summariesOut, seconds)
+						<< " NumericSummaries/s, "
+						<< PerSecond(current.framesOut - last.framesOut,
+							seconds) << " CompressedSampleArrays/s ("
+						<< PerSecond(current.waveformValuesOut -
+							last.waveformValuesOut, seconds)
+						<< " values/s), "
+						<< PerSecond(current.alarmsOut - last.alarmsOut,
+							seconds) << " alarms/s" << endl;
+					cout << aggregator.GetNumericStreamCount()
+						<< " numeric and " << aggregator.GetWaveformStreamCount()
+						<< " waveform streams, reduction "
+						<< (valuesOut == 0 ? 0.0 :
+							(double)valuesIn / (double)valuesOut)
+						<< "x, waveform compression "
+						<< (current.waveformBytesOut == 0 ? 0.0 :
+							(double)current.waveformBytesRaw /
+							(double)current.waveformBytesOut)
+						<< "x" << endl;
+
+					StreamLossMetrics numericLoss;
+					StreamLossMetrics waveformLoss;
+					bridgeInterface.GetNumericLossMetrics(numericLoss);
+					bridgeInterface.GetWaveformLossMetrics(waveformLoss);
+					cout << "Loss: " << LossPercent(numericLoss.writers)
+						<< "% of Numerics (" << numericLoss.writers.lost
+						<< " lost, " << numericLoss.writers.duplicates
+						<< " duplicate, " << numericLoss.writers.reordered
+						<< " reordered), " << LossPercent(waveformLoss.writers)
+						<< "% of SampleArrays (" << waveformLoss.writers.lost
+						<< " lost, " << waveformLoss.writers.duplicates
+						<< " duplicate, " << waveformLoss.writers.reordered
+						<< " reordered), " << waveformLoss.streamsOverThreshold
+						<< " of " << waveformLoss.streamCount
+						<< " waveform streams over the threshold" << endl;
+				}
+				lastReport = now;
+				last = current;
+			}
+		}
+	}
+	catch (string message)
+	{
+		cout << "Application exception: " << message << endl;
+	}
+
+	return 0;
+}
+
+void PrintHelp()
+{
+	cout << "Valid options are: " << endl;
+	cout <<
+		"    --no-multicast" <<
+		"                 Do not use multicast " <<
+		"(note you must edit XML" << endl <<
+		"                                   " <<
+		"config to include IP addresses)"
+		<< endl;
+	cout <<
+		"    --ward-domain <n>" <<
+		"              Domain of the ward devices (default: 5)"
+		<< endl;
+	cout <<
+		"    --central-domain <n>" <<
+		"           Domain of the central station (default: 6)"
+		<< endl;
+	cout <<
+		"    --numeric-period-ms <n>" <<
+		"        Period of the numeric summaries (default: 1000)"
+		<< endl;
+	cout <<
+		"    --waveform-factor <n>" <<
+		"          Waveform decimation factor, 1 or even (default: 10)"
+		<< endl;
+	cout <<
+		"    --frame-ms <n>" <<
+		"                 Duration of a decimated waveform frame" <<
+		endl << "                                   (default: 250)"
+		<< endl;
+	cout <<
+		"    --stale-seconds <n>" <<
+		"            Forget streams idle this long (default: 30)"
+		<< endl;
+	cout <<
+		"    --loss-window-seconds <n>" <<
+		"      Window of the loss summaries (default: 10)"
+		<< endl;
+	cout <<
+		"    --loss-threshold <share>" <<
+		"       Share of frames lost above which a window" <<
+		endl << "                                   " <<
+		"is counted (default: 0.001)"
+		<< endl;
+}